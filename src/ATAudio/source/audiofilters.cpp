@@ -505,6 +505,208 @@ uint64 ATFilterResampleStereo16(sint16 *d, const float *s1, const float *s2, uin
 
 ///////////////////////////////////////////////////////////////////////////
 
+#if VD_CPU_X86 || VD_CPU_X64
+template<bool T_Stereo>
+void ATFilterMixScaledMono16_SSE2(float *VDRESTRICT dstL, float *VDRESTRICT dstR, const sint16 *VDRESTRICT src, uint32 n, float scale) {
+	const __m128 vscale = _mm_set1_ps(scale);
+
+	for(uint32 n4 = n >> 2; n4; --n4) {
+		const __m128i s16 = _mm_loadl_epi64((const __m128i *)src);
+		const __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s16, s16), 16)), vscale);
+		src += 4;
+
+		_mm_storeu_ps(dstL, _mm_add_ps(_mm_loadu_ps(dstL), v));
+		dstL += 4;
+
+		if constexpr (T_Stereo) {
+			_mm_storeu_ps(dstR, _mm_add_ps(_mm_loadu_ps(dstR), v));
+			dstR += 4;
+		}
+	}
+
+	for(n &= 3; n; --n) {
+		const float v = (float)*src++ * scale;
+
+		*dstL++ += v;
+
+		if constexpr (T_Stereo)
+			*dstR++ += v;
+	}
+}
+
+void ATFilterMixMonoToStereo_SSE2(float *VDRESTRICT dstL, float *VDRESTRICT dstR, const float *VDRESTRICT src, uint32 n) {
+	for(uint32 n4 = n >> 2; n4; --n4) {
+		const __m128 v = _mm_loadu_ps(src);
+		src += 4;
+
+		_mm_storeu_ps(dstL, _mm_add_ps(_mm_loadu_ps(dstL), v));
+		_mm_storeu_ps(dstR, _mm_add_ps(_mm_loadu_ps(dstR), v));
+		dstL += 4;
+		dstR += 4;
+	}
+
+	for(n &= 3; n; --n) {
+		const float v = *src++;
+
+		*dstL++ += v;
+		*dstR++ += v;
+	}
+}
+
+void ATFilterDownmixStereoToMono_SSE2(float *VDRESTRICT dstL, float *VDRESTRICT dstR, const float *VDRESTRICT srcL, const float *VDRESTRICT srcR, uint32 n) {
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	for(uint32 n4 = n >> 2; n4; --n4) {
+		const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(srcL), _mm_loadu_ps(srcR)), half);
+		srcL += 4;
+		srcR += 4;
+
+		_mm_storeu_ps(dstL, v);
+		_mm_storeu_ps(dstR, v);
+		dstL += 4;
+		dstR += 4;
+	}
+
+	for(n &= 3; n; --n)
+		*dstL++ = *dstR++ = (*srcL++ + *srcR++) * 0.5f;
+}
+#endif
+
+#if VD_CPU_ARM64
+template<bool T_Stereo>
+void ATFilterMixScaledMono16_NEON(float *VDRESTRICT dstL, float *VDRESTRICT dstR, const sint16 *VDRESTRICT src, uint32 n, float scale) {
+	const float32x4_t vscale = vdupq_n_f32(scale);
+
+	for(uint32 n4 = n >> 2; n4; --n4) {
+		// separate multiply and add to avoid fusing, so results match the scalar path
+		const float32x4_t v = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(src))), vscale);
+		src += 4;
+
+		vst1q_f32(dstL, vaddq_f32(vld1q_f32(dstL), v));
+		dstL += 4;
+
+		if constexpr (T_Stereo) {
+			vst1q_f32(dstR, vaddq_f32(vld1q_f32(dstR), v));
+			dstR += 4;
+		}
+	}
+
+	for(n &= 3; n; --n) {
+		const float v = (float)*src++ * scale;
+
+		*dstL++ += v;
+
+		if constexpr (T_Stereo)
+			*dstR++ += v;
+	}
+}
+
+void ATFilterMixMonoToStereo_NEON(float *VDRESTRICT dstL, float *VDRESTRICT dstR, const float *VDRESTRICT src, uint32 n) {
+	for(uint32 n4 = n >> 2; n4; --n4) {
+		const float32x4_t v = vld1q_f32(src);
+		src += 4;
+
+		vst1q_f32(dstL, vaddq_f32(vld1q_f32(dstL), v));
+		vst1q_f32(dstR, vaddq_f32(vld1q_f32(dstR), v));
+		dstL += 4;
+		dstR += 4;
+	}
+
+	for(n &= 3; n; --n) {
+		const float v = *src++;
+
+		*dstL++ += v;
+		*dstR++ += v;
+	}
+}
+
+void ATFilterDownmixStereoToMono_NEON(float *VDRESTRICT dstL, float *VDRESTRICT dstR, const float *VDRESTRICT srcL, const float *VDRESTRICT srcR, uint32 n) {
+	for(uint32 n4 = n >> 2; n4; --n4) {
+		const float32x4_t v = vmulq_n_f32(vaddq_f32(vld1q_f32(srcL), vld1q_f32(srcR)), 0.5f);
+		srcL += 4;
+		srcR += 4;
+
+		vst1q_f32(dstL, v);
+		vst1q_f32(dstR, v);
+		dstL += 4;
+		dstR += 4;
+	}
+
+	for(n &= 3; n; --n)
+		*dstL++ = *dstR++ = (*srcL++ + *srcR++) * 0.5f;
+}
+#endif
+
+template<bool T_Stereo>
+void ATFilterMixScaledMono16_Scalar(float *VDRESTRICT dstL, float *VDRESTRICT dstR, const sint16 *VDRESTRICT src, uint32 n, float scale) {
+	for(uint32 i=0; i<n; ++i) {
+		const float v = (float)src[i] * scale;
+
+		dstL[i] += v;
+
+		if constexpr (T_Stereo)
+			dstR[i] += v;
+	}
+}
+
+void ATFilterMixScaledMono16(float *dstL, float *dstR, const sint16 *src, uint32 n, float scale) {
+#if VD_CPU_X86 || VD_CPU_X64
+	if (SSE2_enabled) {
+		if (dstR)
+			ATFilterMixScaledMono16_SSE2<true>(dstL, dstR, src, n, scale);
+		else
+			ATFilterMixScaledMono16_SSE2<false>(dstL, dstR, src, n, scale);
+		return;
+	}
+#endif
+
+#if VD_CPU_ARM64
+	if (dstR)
+		ATFilterMixScaledMono16_NEON<true>(dstL, dstR, src, n, scale);
+	else
+		ATFilterMixScaledMono16_NEON<false>(dstL, dstR, src, n, scale);
+#else
+	if (dstR)
+		ATFilterMixScaledMono16_Scalar<true>(dstL, dstR, src, n, scale);
+	else
+		ATFilterMixScaledMono16_Scalar<false>(dstL, dstR, src, n, scale);
+#endif
+}
+
+void ATFilterMixMonoToStereo(float *dstL, float *dstR, const float *src, uint32 n) {
+#if VD_CPU_X86 || VD_CPU_X64
+	if (SSE2_enabled)
+		return ATFilterMixMonoToStereo_SSE2(dstL, dstR, src, n);
+#endif
+
+#if VD_CPU_ARM64
+	ATFilterMixMonoToStereo_NEON(dstL, dstR, src, n);
+#else
+	for(uint32 i=0; i<n; ++i) {
+		const float v = src[i];
+
+		dstL[i] += v;
+		dstR[i] += v;
+	}
+#endif
+}
+
+void ATFilterDownmixStereoToMono(float *dstL, float *dstR, const float *srcL, const float *srcR, uint32 n) {
+#if VD_CPU_X86 || VD_CPU_X64
+	if (SSE2_enabled)
+		return ATFilterDownmixStereoToMono_SSE2(dstL, dstR, srcL, srcR, n);
+#endif
+
+#if VD_CPU_ARM64
+	ATFilterDownmixStereoToMono_NEON(dstL, dstR, srcL, srcR, n);
+#else
+	for(uint32 i=0; i<n; ++i)
+		dstL[i] = dstR[i] = (srcL[i] + srcR[i]) * 0.5f;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////
+
 void ATFilterComputeSymmetricFIR_8_32F_Scalar(float *dst, size_t n, const float *kernel) {
 	const float k0 = kernel[0];
 	const float k1 = kernel[1];
@@ -649,15 +649,9 @@ void ATAudioOutput::InternalWriteAudio(
 			memset(dstLeft + kPreFilterOffset, 0, sizeof(float) * count);
 
 			if (mbFilterStereo)
-				memcpy(dstRight + kPreFilterOffset, 0, sizeof(float) * count);
+				memset(dstRight + kPreFilterOffset, 0, sizeof(float) * count);
 		} else if (mbFilterStereo && pushStereoAsMono && right) {
-			float *VDRESTRICT mixDstLeft = dstLeft + kPreFilterOffset;
-			float *VDRESTRICT mixDstRight = dstRight + kPreFilterOffset;
-			const float *VDRESTRICT mixSrcLeft = left;
-			const float *VDRESTRICT mixSrcRight = right;
-
-			for(size_t i=0; i<count; ++i)
-				mixDstLeft[i] = mixDstRight[i] = (mixSrcLeft[i] + mixSrcRight[i]) * 0.5f;
+			ATFilterDownmixStereoToMono(dstLeft + kPreFilterOffset, dstRight + kPreFilterOffset, left, right, count);
 		} else {
 			memcpy(dstLeft + kPreFilterOffset, left, sizeof(float) * count);
 
@@ -705,12 +699,7 @@ void ATAudioOutput::InternalWriteAudio(
 				}
 
 				// mix mono buffer into stereo buffers
-				for(uint32 i=0; i<count; ++i) {
-					float v = mMonoMixBuffer[i];
-
-					dstLeft[kPreFilterOffset + i] += v;
-					dstRight[kPreFilterOffset + i] += v;
-				}
+				ATFilterMixMonoToStereo(dstLeft + kPreFilterOffset, dstRight + kPreFilterOffset, mMonoMixBuffer, count);
 
 				dcLevels[1] = dcLevels[0];
 			}
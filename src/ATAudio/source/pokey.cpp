@@ -3320,6 +3320,12 @@ void ATPokeyEmulator::FlushAudio(bool pushAudio, uint64 timestamp) {
 			pushAudio,
 			mbStereoAsMono,
 			t64);
+	} else if (mpAudioTap) {
+		mpAudioTap->WriteRawAudio(
+			mpRenderer->GetOutputBuffer(),
+			mpSlave && mbStereoSoftEnable ? mpSlave->mpRenderer->GetOutputBuffer() : nullptr,
+			endBlockResult.mSamples,
+			endBlockResult.mTimestamp);
 	}
 
 	mpRenderer->StartBlock();
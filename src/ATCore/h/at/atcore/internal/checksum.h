@@ -33,6 +33,10 @@ void ATChecksumUpdateSHA256_SSE2(ATChecksumStateSHA256& VDRESTRICT state, const
 
 void ATChecksumUpdateSHA256_SHA(ATChecksumStateSHA256& VDRESTRICT state, const void *src, size_t numBlocks);
 void ATChecksumUpdateSHA256_Optimized(ATChecksumStateSHA256& VDRESTRICT state, const void *src, size_t numBlocks);
+
+// Four independent streams of the same block count, one per SSE2 lane.
+void ATChecksumUpdateSHA256x4_SSE2(ATChecksumStateSHA256 *const *states, const void *const *srcs, size_t numBlocks);
+bool ATChecksumUpdateSHA256x4_Optimized(ATChecksumStateSHA256 *const *states, const void *const *srcs, size_t numBlocks);
 #elif VD_CPU_ARM64
 void ATChecksumUpdateSHA256_Optimized(ATChecksumStateSHA256& VDRESTRICT state, const void* src, size_t numBlocks);
 #endif
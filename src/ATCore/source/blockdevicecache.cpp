@@ -0,0 +1,441 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Core library - block device sector cache
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+//	As a special exception, this library can also be redistributed and/or
+//	modified under an alternate license. See COPYING.RMT in the same source
+//	archive for details.
+
+#include <stdafx.h>
+#include <vd2/system/bitmath.h>
+#include <at/atcore/blockdevicecache.h>
+
+ATBlockDeviceCache::ATBlockDeviceCache() {
+}
+
+ATBlockDeviceCache::~ATBlockDeviceCache() {
+	Shutdown();
+}
+
+void ATBlockDeviceCache::Init(uint32 sectorCount, ReadFn readFn, WriteFn writeFn, bool writeBehind) {
+	Shutdown();
+
+	mSectorCount = sectorCount;
+	mpReadFn = std::move(readFn);
+	mpWriteFn = std::move(writeFn);
+	mbWriteBehind = writeBehind;
+
+	// Lines are referenced by pointer from the lookup and write queue, so
+	// the pool must never reallocate.
+	mLines.reserve(kMaxLines);
+
+	mWorker.Start(1, "Block device cache");
+}
+
+void ATBlockDeviceCache::Shutdown() {
+	if (!IsInited())
+		return;
+
+	try {
+		Flush();
+	} catch(const MyError&) {
+	}
+
+	mWorker.Shutdown();
+
+	mLineLookup.clear();
+	mLines.clear();
+	mWriteQueue.clear();
+	mDirtyLineCount = 0;
+	mReadAheadLimit = 0;
+	mLastReadEnd = ~(uint32)0;
+	mDeferredError.clear();
+	mStats = {};
+
+	mpReadFn = nullptr;
+	mpWriteFn = nullptr;
+}
+
+void ATBlockDeviceCache::SetSectorCount(uint32 sectorCount) {
+	vdsynchronized(mMutex) {
+		mSectorCount = sectorCount;
+	}
+}
+
+void ATBlockDeviceCache::ReadSectors(void *data, uint32 lba, uint32 n) {
+	uint8 *dst = (uint8 *)data;
+
+	// Kick readahead once the guest is clearly streaming; a single
+	// contiguous pair of reads is the usual signature of a file load.
+	const bool sequential = (lba == mLastReadEnd);
+	mLastReadEnd = lba + n;
+
+	while(n) {
+		const uint32 lineIndex = lba >> kLineShift;
+		const uint32 offset = lba & (kSectorsPerLine - 1);
+		const uint32 count = std::min<uint32>(n, kSectorsPerLine - offset);
+		const uint16 mask = (uint16)(((1U << count) - 1) << offset);
+		bool hit = false;
+
+		vdsynchronized(mMutex) {
+			Line *line = FindLine(lineIndex);
+
+			if (line && (line->mValidMask & mask) == mask) {
+				memcpy(dst, line->mData[offset], count * 512);
+				line->mLastUse = ++mUseCounter;
+				mStats.mReadHitSectors += count;
+				hit = true;
+			}
+		}
+
+		if (!hit) {
+			// Fetch the whole line so that nearby accesses hit. Sectors that
+			// are already valid in the cache -- particularly dirty ones --
+			// take precedence over what we read here.
+			alignas(16) uint8 buf[kSectorsPerLine][512];
+			const uint32 lineCount = GetLineSectorCount(lineIndex);
+			const uint32 readCount = std::max<uint32>(lineCount, offset + count);
+
+			vdsynchronized(mIOMutex) {
+				mpReadFn(buf, lineIndex << kLineShift, readCount);
+			}
+
+			vdsynchronized(mMutex) {
+				FillLine(lineIndex, buf[0], readCount);
+
+				Line *line = FindLine(lineIndex);
+				memcpy(dst, line->mData[offset], count * 512);
+				mStats.mReadMissSectors += count;
+			}
+		}
+
+		dst += count * 512;
+		lba += count;
+		n -= count;
+	}
+
+	if (sequential)
+		QueueReadAhead((lba + kSectorsPerLine - 1) >> kLineShift);
+}
+
+void ATBlockDeviceCache::WriteSectors(const void *data, uint32 lba, uint32 n) {
+	ThrowDeferredError();
+
+	if (!mbWriteBehind) {
+		vdsynchronized(mIOMutex) {
+			mpWriteFn(data, lba, n);
+		}
+	} else {
+		// Bound the amount of unwritten data so that a slow host disk pushes
+		// back on the guest instead of growing the cache without limit.
+		bool throttle = false;
+		vdsynchronized(mMutex) {
+			throttle = mDirtyLineCount >= kMaxDirtyLines;
+		}
+
+		if (throttle) {
+			WaitForIdle();
+			ThrowDeferredError();
+		}
+	}
+
+	const uint8 *src = (const uint8 *)data;
+
+	vdsynchronized(mMutex) {
+		while(n) {
+			const uint32 lineIndex = lba >> kLineShift;
+			const uint32 offset = lba & (kSectorsPerLine - 1);
+			const uint32 count = std::min<uint32>(n, kSectorsPerLine - offset);
+			const uint16 mask = (uint16)(((1U << count) - 1) << offset);
+
+			Line *line = FindLine(lineIndex);
+
+			// In write-through mode, don't pull lines into the cache just for
+			// writes, only keep existing ones coherent.
+			if (!line && mbWriteBehind)
+				line = AllocLine(lineIndex);
+
+			if (line) {
+				memcpy(line->mData[offset], src, count * 512);
+				line->mValidMask |= mask;
+				line->mLastUse = ++mUseCounter;
+
+				if (mbWriteBehind) {
+					line->mDirtyMask |= mask;
+					QueueWrite(*line);
+				}
+			}
+
+			src += count * 512;
+			lba += count;
+			n -= count;
+		}
+	}
+}
+
+void ATBlockDeviceCache::Flush() {
+	if (!IsInited())
+		return;
+
+	WaitForIdle();
+	ThrowDeferredError();
+}
+
+ATBlockDeviceCacheStats ATBlockDeviceCache::GetStats() const {
+	ATBlockDeviceCacheStats stats;
+
+	vdsynchronized(mMutex) {
+		stats = mStats;
+		stats.mCachedSectors = 0;
+		stats.mDirtySectors = 0;
+
+		for(const Line& line : mLines) {
+			stats.mCachedSectors += VDCountBits(line.mValidMask);
+			stats.mDirtySectors += VDCountBits(line.mDirtyMask);
+		}
+	}
+
+	return stats;
+}
+
+ATBlockDeviceCache::Line *ATBlockDeviceCache::FindLine(uint32 lineIndex) {
+	auto it = mLineLookup.find(lineIndex);
+
+	return it != mLineLookup.end() ? it->second : nullptr;
+}
+
+ATBlockDeviceCache::Line *ATBlockDeviceCache::AllocLine(uint32 lineIndex) {
+	Line *line = nullptr;
+
+	if (mLines.size() < kMaxLines) {
+		line = &mLines.push_back();
+	} else {
+		// Evict the least recently used line that has no write outstanding.
+		// The dirty line limit guarantees that one exists.
+		for(Line& candidate : mLines) {
+			if (!candidate.mbWritePending && (!line || candidate.mLastUse < line->mLastUse))
+				line = &candidate;
+		}
+
+		VDASSERT(line);
+		mLineLookup.erase(line->mLineIndex);
+	}
+
+	line->mLineIndex = lineIndex;
+	line->mValidMask = 0;
+	line->mDirtyMask = 0;
+	line->mLastUse = ++mUseCounter;
+	line->mbWritePending = false;
+
+	mLineLookup.insert(lineIndex).first->second = line;
+	return line;
+}
+
+void ATBlockDeviceCache::FillLine(uint32 lineIndex, const uint8 *src, uint32 count) {
+	Line *line = FindLine(lineIndex);
+	if (!line)
+		line = AllocLine(lineIndex);
+
+	for(uint32 i = 0; i < count; ++i) {
+		const uint16 bit = (uint16)(1U << i);
+
+		if (!(line->mValidMask & bit)) {
+			memcpy(line->mData[i], src + 512*i, 512);
+			line->mValidMask |= bit;
+		}
+	}
+
+	line->mLastUse = ++mUseCounter;
+}
+
+uint32 ATBlockDeviceCache::GetLineSectorCount(uint32 lineIndex) const {
+	const uint32 lineStart = lineIndex << kLineShift;
+
+	if (lineStart >= mSectorCount)
+		return 0;
+
+	return std::min<uint32>(kSectorsPerLine, mSectorCount - lineStart);
+}
+
+void ATBlockDeviceCache::QueueWrite(Line& line) {
+	if (line.mbWritePending)
+		return;
+
+	line.mbWritePending = true;
+	mWriteQueue.push_back(&line);
+	++mDirtyLineCount;
+
+	if (!mbWriteTaskQueued) {
+		mbWriteTaskQueued = true;
+		++mPendingTasks;
+
+		mWorker.Post([this] { RunWriteBehind(); });
+	}
+}
+
+void ATBlockDeviceCache::QueueReadAhead(uint32 lineIndex) {
+	uint32 startLine;
+	uint32 endLine;
+
+	vdsynchronized(mMutex) {
+		endLine = lineIndex + kReadAheadLines;
+		startLine = std::max(lineIndex, mReadAheadLimit);
+
+		// the previous readahead window may have been far away
+		if (startLine >= endLine + kReadAheadLines)
+			startLine = lineIndex;
+
+		if (startLine >= endLine)
+			return;
+
+		mReadAheadLimit = endLine;
+		++mPendingTasks;
+	}
+
+	mWorker.Post([=, this] { RunReadAhead(startLine, endLine); });
+}
+
+void ATBlockDeviceCache::WaitForIdle() {
+	for(;;) {
+		vdsynchronized(mMutex) {
+			if (!mPendingTasks)
+				return;
+		}
+
+		mTaskDone.wait();
+	}
+}
+
+void ATBlockDeviceCache::RunWriteBehind() {
+	alignas(16) uint8 buf[kSectorsPerLine][512];
+
+	for(;;) {
+		Line *line;
+		uint32 lba;
+		uint16 dirtyMask;
+
+		vdsynchronized(mMutex) {
+			if (mWriteQueue.empty()) {
+				mbWriteTaskQueued = false;
+				--mPendingTasks;
+				break;
+			}
+
+			line = mWriteQueue.front();
+			mWriteQueue.erase(mWriteQueue.begin());
+
+			lba = line->mLineIndex << kLineShift;
+			dirtyMask = line->mDirtyMask;
+			line->mDirtyMask = 0;
+			memcpy(buf, line->mData, sizeof buf);
+		}
+
+		// write out contiguous runs of dirty sectors
+		try {
+			vdsynchronized(mIOMutex) {
+				uint32 i = 0;
+
+				while(i < kSectorsPerLine) {
+					if (!(dirtyMask & (1U << i))) {
+						++i;
+						continue;
+					}
+
+					uint32 j = i + 1;
+					while(j < kSectorsPerLine && (dirtyMask & (1U << j)))
+						++j;
+
+					mpWriteFn(buf[i], lba + i, j - i);
+					i = j;
+				}
+			}
+		} catch(MyError& e) {
+			vdsynchronized(mMutex) {
+				if (mDeferredError.empty())
+					mDeferredError = std::move(e);
+			}
+		}
+
+		vdsynchronized(mMutex) {
+			mStats.mWriteBehindSectors += VDCountBits(dirtyMask);
+
+			// If the line was dirtied again while we were writing it, it goes
+			// back on the queue; otherwise it can be evicted again.
+			if (line->mDirtyMask)
+				mWriteQueue.push_back(line);
+			else {
+				line->mbWritePending = false;
+				--mDirtyLineCount;
+			}
+		}
+	}
+
+	mTaskDone.signal();
+}
+
+void ATBlockDeviceCache::RunReadAhead(uint32 startLine, uint32 endLine) {
+	alignas(16) uint8 buf[kSectorsPerLine][512];
+
+	for(uint32 lineIndex = startLine; lineIndex < endLine; ++lineIndex) {
+		uint32 count;
+
+		vdsynchronized(mMutex) {
+			count = GetLineSectorCount(lineIndex);
+
+			const Line *line = FindLine(lineIndex);
+			if (line && (line->mValidMask & ((1U << count) - 1)) == ((1U << count) - 1))
+				count = 0;
+		}
+
+		if (!count)
+			continue;
+
+		try {
+			vdsynchronized(mIOMutex) {
+				mpReadFn(buf, lineIndex << kLineShift, count);
+			}
+		} catch(const MyError&) {
+			// Readahead is speculative; let the real read report the error.
+			break;
+		}
+
+		vdsynchronized(mMutex) {
+			FillLine(lineIndex, buf[0], count);
+			mStats.mReadAheadSectors += count;
+		}
+	}
+
+	vdsynchronized(mMutex) {
+		--mPendingTasks;
+	}
+
+	mTaskDone.signal();
+}
+
+void ATBlockDeviceCache::ThrowDeferredError() {
+	MyError e;
+
+	vdsynchronized(mMutex) {
+		if (mDeferredError.empty())
+			return;
+
+		// The error is sticky: the backing store is missing data the guest
+		// believes was written, so later operations must keep failing.
+		e = mDeferredError;
+	}
+
+	throw e;
+}
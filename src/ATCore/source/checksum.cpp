@@ -19,7 +19,10 @@
 //	archive for details.
 
 #include <stdafx.h>
+#include <algorithm>
+#include <numeric>
 #include <vd2/system/binary.h>
+#include <vd2/system/vdstl.h>
 #include <at/atcore/checksum.h>
 #include <at/atcore/internal/checksum.h>
 
@@ -247,3 +250,48 @@ ATChecksumSHA256 ATComputeChecksumSHA256(const void *src, size_t len) {
 	engine.Process(src, len);
 	return engine.Finalize();
 }
+
+void ATComputeChecksumsSHA256(ATChecksumSHA256 *dst, const void *const *srcs, const size_t *lens, size_t n) {
+#if VD_CPU_X86 || VD_CPU_X64
+	// Group buffers by length so that the lanes of each group share as many
+	// whole blocks as possible; the tails are finished one buffer at a time.
+	vdfastvector<size_t> order(n);
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [=](size_t x, size_t y) { return lens[x] > lens[y]; });
+
+	for(size_t base = 0; base < n; base += 4) {
+		const size_t count = std::min<size_t>(n - base, 4);
+
+		ATChecksumEngineSHA256 engines[4];
+		ATChecksumStateSHA256 *states[4];
+		const void *laneSrcs[4];
+
+		// Unused lanes hash a copy of the first buffer into a scratch state. The
+		// first buffer is the longest, so it always has enough blocks.
+		for(size_t i = 0; i < 4; ++i) {
+			const size_t idx = order[base + (i < count ? i : 0)];
+
+			states[i] = &engines[i].mState;
+			laneSrcs[i] = srcs[idx];
+		}
+
+		const size_t commonBlocks = lens[order[base + count - 1]] >> 6;
+		size_t consumed = 0;
+
+		if (count > 1 && commonBlocks && ATChecksumUpdateSHA256x4_Optimized(states, laneSrcs, commonBlocks))
+			consumed = commonBlocks << 6;
+
+		for(size_t i = 0; i < count; ++i) {
+			const size_t idx = order[base + i];
+			ATChecksumEngineSHA256& engine = engines[i];
+
+			engine.mTotalBytes = consumed;
+			engine.Process((const char *)srcs[idx] + consumed, lens[idx] - consumed);
+			dst[idx] = engine.Finalize();
+		}
+	}
+#else
+	for(size_t i = 0; i < n; ++i)
+		dst[i] = ATComputeChecksumSHA256(srcs[i], lens[i]);
+#endif
+}
@@ -330,4 +330,148 @@ void ATChecksumUpdateSHA256_Optimized(ATChecksumStateSHA256& VDRESTRICT state, c
 	}
 }
 
+namespace {
+	template<int N>
+	__m128i ATChecksumRotr32x4(__m128i v) {
+		return _mm_or_si128(_mm_srli_epi32(v, N), _mm_slli_epi32(v, 32 - N));
+	}
+
+	void ATChecksumTranspose4x4(__m128i& a, __m128i& b, __m128i& c, __m128i& d) {
+		const __m128i t0 = _mm_unpacklo_epi32(a, b);
+		const __m128i t1 = _mm_unpacklo_epi32(c, d);
+		const __m128i t2 = _mm_unpackhi_epi32(a, b);
+		const __m128i t3 = _mm_unpackhi_epi32(c, d);
+
+		a = _mm_unpacklo_epi64(t0, t1);
+		b = _mm_unpackhi_epi64(t0, t1);
+		c = _mm_unpacklo_epi64(t2, t3);
+		d = _mm_unpackhi_epi64(t2, t3);
+	}
+}
+
+void ATChecksumUpdateSHA256x4_SSE2(ATChecksumStateSHA256 *const *states, const void *const *srcs, size_t numBlocks) {
+	using namespace nsATChecksum;
+
+	// This runs four independent SHA-256 streams with one stream per 32-bit
+	// lane, so unlike the single-stream SSE2 routine above, the round function
+	// is vectorized too. Each lane does exactly the same work as the scalar
+	// version; the only overhead is transposing the message words and state.
+
+	const char *VDRESTRICT src[4] = {
+		(const char *)srcs[0],
+		(const char *)srcs[1],
+		(const char *)srcs[2],
+		(const char *)srcs[3],
+	};
+
+	const auto byteSwap = [](__m128i v) {
+		v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+		return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+	};
+
+	__m128i H[8];
+	for(int i = 0; i < 8; i += 4) {
+		H[i+0] = _mm_load_si128((const __m128i *)&states[0]->H[i]);
+		H[i+1] = _mm_load_si128((const __m128i *)&states[1]->H[i]);
+		H[i+2] = _mm_load_si128((const __m128i *)&states[2]->H[i]);
+		H[i+3] = _mm_load_si128((const __m128i *)&states[3]->H[i]);
+
+		ATChecksumTranspose4x4(H[i+0], H[i+1], H[i+2], H[i+3]);
+	}
+
+	__m128i W[16];
+
+	while(numBlocks--) {
+		for(int i = 0; i < 16; i += 4) {
+			__m128i r0 = _mm_loadu_si128((const __m128i *)(src[0] + i*4));
+			__m128i r1 = _mm_loadu_si128((const __m128i *)(src[1] + i*4));
+			__m128i r2 = _mm_loadu_si128((const __m128i *)(src[2] + i*4));
+			__m128i r3 = _mm_loadu_si128((const __m128i *)(src[3] + i*4));
+
+			ATChecksumTranspose4x4(r0, r1, r2, r3);
+
+			W[i+0] = byteSwap(r0);
+			W[i+1] = byteSwap(r1);
+			W[i+2] = byteSwap(r2);
+			W[i+3] = byteSwap(r3);
+		}
+
+		src[0] += 64;
+		src[1] += 64;
+		src[2] += 64;
+		src[3] += 64;
+
+		__m128i a = H[0];
+		__m128i b = H[1];
+		__m128i c = H[2];
+		__m128i d = H[3];
+		__m128i e = H[4];
+		__m128i f = H[5];
+		__m128i g = H[6];
+		__m128i h = H[7];
+
+		for(uint32 i = 0; i < 64; ++i) {
+			__m128i w;
+
+			if (i < 16)
+				w = W[i];
+			else {
+				const __m128i w15 = W[(i - 15) & 15];
+				const __m128i w2 = W[(i - 2) & 15];
+
+				const __m128i s0 = _mm_xor_si128(_mm_xor_si128(ATChecksumRotr32x4<7>(w15), ATChecksumRotr32x4<18>(w15)), _mm_srli_epi32(w15, 3));
+				const __m128i s1 = _mm_xor_si128(_mm_xor_si128(ATChecksumRotr32x4<17>(w2), ATChecksumRotr32x4<19>(w2)), _mm_srli_epi32(w2, 10));
+
+				w = _mm_add_epi32(_mm_add_epi32(W[i & 15], s0), _mm_add_epi32(W[(i - 7) & 15], s1));
+				W[i & 15] = w;
+			}
+
+			const __m128i bsig1 = _mm_xor_si128(_mm_xor_si128(ATChecksumRotr32x4<6>(e), ATChecksumRotr32x4<11>(e)), ATChecksumRotr32x4<25>(e));
+			const __m128i ch = _mm_xor_si128(g, _mm_and_si128(e, _mm_xor_si128(f, g)));
+			const __m128i t1 = _mm_add_epi32(_mm_add_epi32(_mm_add_epi32(h, bsig1), _mm_add_epi32(ch, w)), _mm_set1_epi32((int)K[i]));
+
+			const __m128i bsig0 = _mm_xor_si128(_mm_xor_si128(ATChecksumRotr32x4<2>(a), ATChecksumRotr32x4<13>(a)), ATChecksumRotr32x4<22>(a));
+			const __m128i maj = _mm_or_si128(_mm_and_si128(a, b), _mm_and_si128(c, _mm_or_si128(a, b)));
+			const __m128i t2 = _mm_add_epi32(bsig0, maj);
+
+			h = g;
+			g = f;
+			f = e;
+			e = _mm_add_epi32(d, t1);
+			d = c;
+			c = b;
+			b = a;
+			a = _mm_add_epi32(t1, t2);
+		}
+
+		H[0] = _mm_add_epi32(H[0], a);
+		H[1] = _mm_add_epi32(H[1], b);
+		H[2] = _mm_add_epi32(H[2], c);
+		H[3] = _mm_add_epi32(H[3], d);
+		H[4] = _mm_add_epi32(H[4], e);
+		H[5] = _mm_add_epi32(H[5], f);
+		H[6] = _mm_add_epi32(H[6], g);
+		H[7] = _mm_add_epi32(H[7], h);
+	}
+
+	for(int i = 0; i < 8; i += 4) {
+		ATChecksumTranspose4x4(H[i+0], H[i+1], H[i+2], H[i+3]);
+
+		_mm_store_si128((__m128i *)&states[0]->H[i], H[i+0]);
+		_mm_store_si128((__m128i *)&states[1]->H[i], H[i+1]);
+		_mm_store_si128((__m128i *)&states[2]->H[i], H[i+2]);
+		_mm_store_si128((__m128i *)&states[3]->H[i], H[i+3]);
+	}
+}
+
+bool ATChecksumUpdateSHA256x4_Optimized(ATChecksumStateSHA256 *const *states, const void *const *srcs, size_t numBlocks) {
+	// The SHA extensions are much faster on a single stream than four SSE2
+	// lanes are on four, so only go multi-buffer without them.
+	if (!SSE2_enabled || (CPUGetEnabledExtensions() & CPUF_SUPPORTS_SHA))
+		return false;
+
+	ATChecksumUpdateSHA256x4_SSE2(states, srcs, numBlocks);
+	return true;
+}
+
 #endif
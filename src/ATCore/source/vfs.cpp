@@ -418,11 +418,15 @@ VDStringW ATMakeVFSPathForZipFile(const wchar_t *path, const wchar_t *fileName)
 
 class ATVFSFileViewDirect : public ATVFSFileView {
 public:
-	ATVFSFileViewDirect(VDFileStream&& fs, const wchar_t *name, bool write, bool update)
+	ATVFSFileViewDirect(VDFileStream&& fs, const wchar_t *path, const wchar_t *name, bool write, bool update)
 		: mFileStream(std::move(fs))
+		, mMemoryStream(nullptr, 0)
 	{
 		mpStream = &mFileStream;
 		mFileName =  name;
+
+		if (!write)
+			TryMap(path);
 	}
 
 	ATVFSFileViewDirect(const wchar_t *path, bool write, bool update)
@@ -432,9 +436,13 @@ public:
 				? nsVDFile::kOpenExisting | nsVDFile::kWrite | nsVDFile::kDenyAll
 				: nsVDFile::kCreateAlways | nsVDFile::kWrite | nsVDFile::kDenyAll
 			: nsVDFile::kOpenExisting | nsVDFile::kRead | nsVDFile::kDenyNone)
+		, mMemoryStream(nullptr, 0)
 	{
 		mpStream = &mFileStream;
 		mFileName = VDFileSplitPath(path);
+
+		if (!write)
+			TryMap(path);
 	}
 
 	bool IsSourceReadOnly() const override {
@@ -442,7 +450,25 @@ public:
 	}
 
 private:
+	void TryMap(const wchar_t *path) {
+		// Cap the mapping at the same 256MB limit used for gzip streams; the
+		// memory stream can't address beyond 4GB anyway, and nothing we load
+		// gets anywhere close to this.
+		if (!mMapping.TryMapReadOnly(mFileStream, path, 0x10000000))
+			return;
+
+		const uint8 *p = (const uint8 *)mMapping.GetData();
+		const size_t len = mMapping.GetSize();
+
+		mMemoryStream = VDMemoryStream(p, (uint32)len);
+		mpStream = &mMemoryStream;
+
+		SetMemoryView(vdspan<const uint8>(p, len), true);
+	}
+
 	VDFileStream mFileStream;
+	VDFileMapping mMapping;
+	VDMemoryStream mMemoryStream;
 };
 
 class ATVFSFileViewGZip : public ATVFSFileView {
@@ -481,6 +507,7 @@ public:
 		}
 
 		mMemoryStream = VDMemoryStream(mBuffer.data(), size);
+		SetMemoryView(vdspan<const uint8>(mBuffer.data(), size), false);
 	}
 
 	bool IsSourceReadOnly() const override { return true; }
@@ -523,6 +550,21 @@ public:
 
 		mpStream = &mMemoryStream;
 		mFileName = fileName;
+
+		SetMemoryView(vdspan<const uint8>(mBuffer.data(), mBuffer.size()), false);
+	}
+
+	// Create a view that references a stored entry in place within the memory
+	// view of the archive. The archive reference keeps the parent view and
+	// therefore the span alive.
+	ATVFSFileViewZip(ATVFSZipArchive& zipArch, vdspan<const uint8> span, bool mapped, const wchar_t *fileName)
+		: mMemoryStream(span.data(), (uint32)span.size())
+		, mpZipArchive(&zipArch)
+	{
+		mpStream = &mMemoryStream;
+		mFileName = fileName;
+
+		SetMemoryView(span, mapped);
 	}
 
 	bool IsSourceReadOnly() const override { return true; }
@@ -536,15 +578,35 @@ private:
 
 vdrefptr<ATVFSFileView> ATVFSZipArchive::OpenStream(sint32 idx) {
 	const VDZipArchive::FileInfo& info = mZipArchive.GetFileInfo(idx);
+	vdrefptr<ATVFSFileView> view;
+
+	// If the entry is stored and the archive is already in memory, reference
+	// the entry in place rather than copying it out through the inflater.
+	if (!info.mbPacked && info.mbSupported && info.mCompressedSize == info.mUncompressedSize && mpZipView->HasMemoryView()) {
+		const vdspan<const uint8> archiveSpan = mpZipView->GetMemoryView();
+		const uint64 offset = mZipArchive.GetRawDataOffset(idx);
+
+		if (offset <= archiveSpan.size() && archiveSpan.size() - offset >= info.mUncompressedSize) {
+			const vdspan<const uint8> entrySpan = archiveSpan.subspan((size_t)offset, info.mUncompressedSize);
 
-	vdautoptr<IVDInflateStream> zs { mZipArchive.OpenDecodedStream(idx) };
-	vdfastvector<uint8> buffer;
+			if (VDCRCTable::CRC32.CRC(entrySpan.data(), entrySpan.size()) != info.mCRC32)
+				throw MyError("Read error on compressed data (CRC error).");
 
-	buffer.resize(info.mUncompressedSize);
-	zs->Read(buffer.data(), info.mUncompressedSize);
-	zs->VerifyCRC();
+			view = new ATVFSFileViewZip(*this, entrySpan, mpZipView->IsMemoryViewMapped(), info.mDecodedFileName.c_str());
+		}
+	}
+
+	if (!view) {
+		vdautoptr<IVDInflateStream> zs { mZipArchive.OpenDecodedStream(idx) };
+		vdfastvector<uint8> buffer;
+
+		buffer.resize(info.mUncompressedSize);
+		zs->Read(buffer.data(), info.mUncompressedSize);
+		zs->VerifyCRC();
+
+		view = new ATVFSFileViewZip(*this, std::move(buffer), info.mDecodedFileName.c_str());
+	}
 
-	vdrefptr<ATVFSFileView> view(new ATVFSFileViewZip(*this, std::move(buffer), info.mDecodedFileName.c_str()));
 	view->SetTryOpenSibling(
 		[self = vdrefptr(this)](const wchar_t *name) -> vdrefptr<ATVFSFileView> {
 			return self->TryOpenStream(name);
@@ -594,11 +656,12 @@ void ATVFSOpenFileView(const wchar_t *vfsPath, bool write, bool update, ATVFSFil
 				view->SetTryOpenSibling(
 					[baseDir = VDFileSplitPathLeft(basePath)](const wchar_t *name) -> vdrefptr<ATVFSFileView> {
 						VDFileStream f;
+						const VDStringW path = VDMakePath(baseDir, VDStringSpanW(name));
 
-						if (!f.tryOpen(VDMakePath(baseDir, VDStringSpanW(name)).c_str()))
+						if (!f.tryOpen(path.c_str()))
 							return nullptr;
 
-						return vdrefptr(new ATVFSFileViewDirect(std::move(f), name, false, false));
+						return vdrefptr(new ATVFSFileViewDirect(std::move(f), path.c_str(), name, false, false));
 					}
 				);
 				break;
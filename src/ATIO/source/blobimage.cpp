@@ -30,6 +30,7 @@ public:
 	ATBlobImage(ATImageType type) : mType(type) {}
 
 	void Load(IVDRandomAccessStream& stream);
+	void Load(ATVFSFileView& view);
 	void Load(const void *src, uint32 len);
 
 	void *AsInterface(uint32 id) override;
@@ -40,13 +41,22 @@ public:
 	std::optional<uint32> GetImageFileCRC() const override;
 	std::optional<ATChecksumSHA256> GetImageFileSHA256() const override;
 
-	uint32 GetSize() const override { return (uint32)mProgram.size(); }
-	const void *GetBuffer() const override { return mProgram.data(); }
+	uint32 GetSize() const override { return mSize; }
+	const void *GetBuffer() const override { return mpData; }
 
 private:
+	void CheckSize(uint64 len) const;
+	void SetOwnedData();
+
 	const ATImageType mType;
 
+	const uint8 *mpData = nullptr;
+	uint32 mSize = 0;
+
+	// Either the image owns a copy of the data, or it references the in-memory
+	// buffer of the source view and keeps the view alive.
 	vdfastvector<uint8> mProgram;
+	vdrefptr<ATVFSFileView> mpSourceView;
 
 	mutable uint64 mChecksum = 0;
 	mutable ATChecksumSHA256 mSHA256 {};
@@ -68,7 +78,7 @@ ATImageType ATBlobImage::GetImageType() const {
 
 uint64 ATBlobImage::GetChecksum() const {
 	if (mbChecksumDirty) {
-		mChecksum = ATComputeBlockChecksum(kATBaseChecksum, mProgram.data(), mProgram.size());
+		mChecksum = ATComputeBlockChecksum(kATBaseChecksum, mpData, mSize);
 		mbChecksumDirty = false;
 	}
 
@@ -81,7 +91,7 @@ std::optional<uint32> ATBlobImage::GetImageFileCRC() const {
 
 std::optional<ATChecksumSHA256> ATBlobImage::GetImageFileSHA256() const {
 	if (mbSHA256Dirty) {
-		mSHA256 = ATComputeChecksumSHA256(mProgram.data(), mProgram.size());
+		mSHA256 = ATComputeChecksumSHA256(mpData, mSize);
 		mbSHA256Dirty = false;
 	}
 
@@ -93,24 +103,46 @@ void ATBlobImage::Load(IVDRandomAccessStream& stream) {
 	mbSHA256Dirty = true;
 
 	auto len = stream.Length();
-
-	if (mType == kATImageType_SaveState) {
-		if (len > 0x10000000U)
-			throw MyError("Save state too large: %llu bytes", (unsigned long long)len);
-	} else if (mType == kATImageType_SAP) {
-		if (len > 0x100000U)
-			throw MyError("SAP module too large: %llu bytes", (unsigned long long)len);
-	} else {
-		if (len > 0x10000000U)
-			throw MyError("Executable too large: %llu bytes", (unsigned long long)len);
-	}
+	CheckSize(len);
 
 	uint32 len32 = (uint32)len;
 
+	mpSourceView.clear();
 	mProgram.resize(len32);
 
 	stream.Seek(0);
 	stream.Read(mProgram.data(), (sint32)len32);
+
+	SetOwnedData();
+}
+
+void ATBlobImage::Load(ATVFSFileView& view) {
+	if (!view.HasMemoryView()) {
+		Load(view.GetStream());
+		return;
+	}
+
+	mbChecksumDirty = true;
+	mbSHA256Dirty = true;
+
+	const vdspan<const uint8> span = view.GetMemoryView();
+	CheckSize(span.size());
+
+	// Don't hold on to a mapping of a host file, as that would block the user
+	// from replacing the file and would let in-place writes change the image
+	// underneath the cached checksums. The mapping still saves the read.
+	if (view.IsMemoryViewMapped()) {
+		mpSourceView.clear();
+		mProgram.assign(span.begin(), span.end());
+
+		SetOwnedData();
+		return;
+	}
+
+	mProgram.clear();
+	mpSourceView = &view;
+	mpData = span.data();
+	mSize = (uint32)span.size();
 }
 
 void ATBlobImage::Load(const void *src, uint32 len) {
@@ -118,7 +150,28 @@ void ATBlobImage::Load(const void *src, uint32 len) {
 	mbSHA256Dirty = true;
 
 	const uint8 *src8 = (const uint8 *)src;
+	mpSourceView.clear();
 	mProgram.assign(src8, src8 + len);
+
+	SetOwnedData();
+}
+
+void ATBlobImage::CheckSize(uint64 len) const {
+	if (mType == kATImageType_SaveState) {
+		if (len > 0x10000000U)
+			throw MyError("Save state too large: %llu bytes", (unsigned long long)len);
+	} else if (mType == kATImageType_SAP) {
+		if (len > 0x100000U)
+			throw MyError("SAP module too large: %llu bytes", (unsigned long long)len);
+	} else {
+		if (len > 0x10000000U)
+			throw MyError("Executable too large: %llu bytes", (unsigned long long)len);
+	}
+}
+
+void ATBlobImage::SetOwnedData() {
+	mpData = mProgram.data();
+	mSize = (uint32)mProgram.size();
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -128,7 +181,7 @@ void ATLoadBlobImage(ATImageType type, const wchar_t *path, IATBlobImage **ppIma
 	
 	ATVFSOpenFileView(path, false, ~view);
 
-	return ATLoadBlobImage(type, view->GetStream(), ppImage);
+	return ATLoadBlobImage(type, *view, ppImage);
 }
 
 void ATLoadBlobImage(ATImageType type, IVDRandomAccessStream& stream, IATBlobImage **ppImage) {
@@ -139,6 +192,14 @@ void ATLoadBlobImage(ATImageType type, IVDRandomAccessStream& stream, IATBlobIma
 	*ppImage = img.release();
 }
 
+void ATLoadBlobImage(ATImageType type, ATVFSFileView& view, IATBlobImage **ppImage) {
+	vdrefptr<ATBlobImage> img(new ATBlobImage(type));
+
+	img->Load(view);
+
+	*ppImage = img.release();
+}
+
 void ATCreateBlobImage(ATImageType type, const void *src, uint32 len, IATBlobImage **ppImage) {
 	vdrefptr<ATBlobImage> img(new ATBlobImage(type));
 
@@ -335,12 +335,12 @@ bool ATImageLoadAuto(const wchar_t *origPath, const wchar_t *imagePath, ATVFSFil
 	// Load the resource.
 	if (loadType == kATImageType_Program) {
 		vdrefptr<IATBlobImage> programImage;
-		ATLoadBlobImage(kATImageType_Program, stream, ~programImage);
+		ATLoadBlobImage(kATImageType_Program, view, ~programImage);
 
 		*ppImage = programImage.release();
 	} else if (loadType == kATImageType_BasicProgram) {
 		vdrefptr<IATBlobImage> basicProgramImage;
-		ATLoadBlobImage(kATImageType_BasicProgram, stream, ~basicProgramImage);
+		ATLoadBlobImage(kATImageType_BasicProgram, view, ~basicProgramImage);
 
 		*ppImage = basicProgramImage.release();
 	} else if (loadType == kATImageType_Cartridge) {
@@ -361,12 +361,12 @@ bool ATImageLoadAuto(const wchar_t *origPath, const wchar_t *imagePath, ATVFSFil
 		*ppImage = diskImage.release();
 	} else if (loadType == kATImageType_SaveState) {
 		vdrefptr<IATBlobImage> saveStateImage;
-		ATLoadBlobImage(kATImageType_SaveState, stream, ~saveStateImage);
+		ATLoadBlobImage(kATImageType_SaveState, view, ~saveStateImage);
 
 		*ppImage = saveStateImage.release();
 	} else if (loadType == kATImageType_SAP) {
 		vdrefptr<IATBlobImage> sapImage;
-		ATLoadBlobImage(kATImageType_SAP, stream, ~sapImage);
+		ATLoadBlobImage(kATImageType_SAP, view, ~sapImage);
 
 		*ppImage = sapImage.release();
 	} else if (loadType != kATImageType_SaveState2) {
@@ -15,6 +15,12 @@ struct ATNetTcpListeningSocket {
 	IATEmuNetSocketListener *mpHandler;
 };
 
+// Contiguous piece of a scatter/gather payload.
+struct ATNetTcpDataSpan {
+	const void *mpData;
+	uint32 mLength;
+};
+
 class ATNetTcpRingBuffer {
 public:
 	ATNetTcpRingBuffer();
@@ -25,6 +31,10 @@ public:
 
 	uint32 Write(const void *p, uint32 n);
 	void Read(uint32 offset, void *p, uint32 n) const;
+
+	// Return the range [offset, offset+n) in place as up to two spans, split
+	// at the wrap point. Returns the number of spans used.
+	uint32 GetReadSpans(uint32 offset, uint32 n, ATNetTcpDataSpan spans[2]) const;
 	void Ack(uint32 n);
 
 	uint32 GetSpace() const { return mSize - mLevel; }
@@ -144,7 +154,7 @@ public:
 public:
 	void OnPacket(const ATEthernetPacket& packet, const ATIPv4HeaderInfo& iphdr, const uint8 *data, const uint32 len);
 
-	uint32 EncodePacket(uint8 *dst, uint32 len, uint32 srcIpAddr, uint32 dstIpAddr, const ATTcpHeaderInfo& hdrInfo, const void *data, uint32 dataLen, const void *opts = nullptr, uint32 optLen = 0);
+	uint32 EncodePacket(uint8 *dst, uint32 len, uint32 srcIpAddr, uint32 dstIpAddr, const ATTcpHeaderInfo& hdrInfo, const ATNetTcpDataSpan *spans, uint32 numSpans, const void *opts = nullptr, uint32 optLen = 0);
 	void SendReset(const ATIPv4HeaderInfo& iphdr, uint16 srcPort, uint16 dstPort, const ATTcpHeaderInfo& origTcpHdr);
 	void SendReset(uint32 srcIpAddr, uint32 dstIpAddr, uint16 srcPort, uint16 dstPort, const ATTcpHeaderInfo& origTcpHdr);
 	void SendFrame(uint32 dstIpAddr, const void *data, uint32 len);
@@ -194,6 +204,7 @@ public:
 
 	void TryTransmitMore(bool immediate);
 	void Transmit(bool ack, int retransmitCount = 0, bool enableWindowProbe = false);
+	void DelayAck();
 
 public:
 	void OnClockEvent(uint32 eventid, uint32 userid) override;
@@ -218,6 +229,7 @@ private:
 	};
 
 	TransmitStatus GetTransmitStatus() const;
+	void TransmitSegment(bool ack, int retransmitCount, bool enableWindowProbe);
 	void ClearEvents();
 	void ProcessSynOptions(const ATEthernetPacket& packet, const ATTcpHeaderInfo& tcpHdr, const uint8 *data);
 	void ChangeToTimeWait();
@@ -229,6 +241,7 @@ private:
 		kEventId_Retransmit,
 		kEventId_WindowProbe,
 		kEventId_ZeroWindowProbe,
+		kEventId_DelayedAck,
 	};
 
 	const ATNetTcpConnectionKey mConnKey;
@@ -247,6 +260,7 @@ private:
 	uint32	mEventRetransmit = 0;
 	uint32	mEventWindowProbe = 0;
 	uint32	mEventZeroWindowProbe = 0;
+	uint32	mEventDelayedAck = 0;
 
 	struct PacketTimer {
 		uint32 mNext;
@@ -265,6 +279,9 @@ private:
 	uint32 mXmitWindowLimit = 0;
 	uint32 mXmitNext = 0;
 
+	// Last receive sequence number we have ACKed, for coalescing ACKs.
+	uint32 mRecvLastAckSent = 0;
+
 	// This is the minimum window we require before sending data, to mitigate SWS.
 	// It is set to min(max_window/2, mss).
 	uint32 mXmitWindowThreshold = 0;
@@ -289,6 +306,11 @@ private:
 	char mXmitBuf[32768];
 
 	static const uint32 kMaxRetransmits = 5;
+
+	// Maximum number of segments sent back to back before yielding to the
+	// transmit timer. The segments in a burst are queued to the bus on the
+	// same timestamp and delivered together.
+	static constexpr uint32 kMaxBurstSegments = 32;
 };
 
 #endif	// f_ATNETWORK_TCPSTACK_H
@@ -127,24 +127,22 @@ void ATEthernetBus::TransmitFrame(uint32 source, const ATEthernetPacket& packet)
 	qp->mPacket.mpData = (const uint8 *)(qp + 1);
 	qp->mClockEventId = 0;
 	qp->mNextPacketId = 0;
+	qp->mLastPacketId = packetId;
 
 	// check if we already have a packet queued on this timestamp; if not, register a timed event,
-	// else add the new packet at the end of the chain
+	// else add the new packet at the end of the chain so that the whole chain is delivered on
+	// the same clock event
 	auto r = mPacketsByTimestamp.insert({ qp->mPacket.mTimestamp, qp});
 	if (r.second) {
 		qp->mClockEventId = mClocks[packet.mClockIndex]->AddClockEvent(qp->mPacket.mTimestamp, this, packetId);
 		VDASSERT(qp->mClockEventId);
 	} else {
-		QueuedPacket *prev = r.first->second;
+		QueuedPacket *head = r.first->second;
+		auto it = mPackets.find(head->mLastPacketId);
+		VDASSERT(it != mPackets.end());
 
-		while(prev->mNextPacketId) {
-			auto it = mPackets.find(prev->mNextPacketId);
-			VDASSERT(it != mPackets.end());
-
-			prev = it->second;
-		}
-
-		prev->mNextPacketId = packetId;
+		it->second->mNextPacketId = packetId;
+		head->mLastPacketId = packetId;
 	}
 
 	mPackets[packetId] = qp;
@@ -166,51 +164,7 @@ void ATEthernetBus::OnClockEvent(uint32 eventid, uint32 userid) {
 			VDVERIFY(mPacketsByTimestamp.erase(qp->mPacket.mTimestamp) > 0);
 		}
 
-		union {
-			ATEthernetArpFrameInfo arpInfo;
-			ATIPv4HeaderInfo ipv4Info;
-			ATIPv6HeaderInfo ipv6Info;
-		} dec;
-
-		ATEthernetFrameDecodedType decType = kATEthernetFrameDecodedType_None;
-		const void *decInfo = NULL;
-
-		if (qp->mPacket.mLength >= 2) {
-			const uint8 *data = qp->mPacket.mpData;
-
-			switch(VDReadUnalignedBEU16(data)) {
-				case kATEthernetFrameType_ARP:
-					if (ATEthernetDecodeArpPacket(dec.arpInfo, data + 2, qp->mPacket.mLength - 2)) {
-						decInfo = &dec.arpInfo;
-						decType = kATEthernetFrameDecodedType_ARP;
-					}
-					break;
-
-				case kATEthernetFrameType_IP:
-					if (ATIPv4DecodeHeader(dec.ipv4Info, data + 2, qp->mPacket.mLength - 2)) {
-						decInfo = &dec.ipv4Info;
-						decType = kATEthernetFrameDecodedType_IPv4;
-					}
-					break;
-					
-				case kATEthernetFrameType_IPv6:
-					if (ATIPv6DecodeHeader(dec.ipv6Info, data + 2, qp->mPacket.mLength - 2)) {
-						decInfo = &dec.ipv6Info;
-						decType = kATEthernetFrameDecodedType_IPv6;
-					}
-					break;
-			}
-		}
-
-		for(Endpoints::const_iterator itEP(mEndpoints.begin()), itEPEnd(mEndpoints.end());
-			itEP != itEPEnd;
-			++itEP)
-		{
-			const Endpoint& ep = *itEP;
-
-			if (ep.mId != qp->mSourceId)
-				ep.mpEndpoint->ReceiveFrame(qp->mPacket, decType, decInfo);
-		}
+		DispatchFrame(qp->mSourceId, qp->mPacket);
 
 		userid = qp->mNextPacketId;
 
@@ -218,3 +172,61 @@ void ATEthernetBus::OnClockEvent(uint32 eventid, uint32 userid) {
 		free(qp);
 	} while(userid);
 }
+
+void ATEthernetBus::DeliverFrame(uint32 source, const ATEthernetPacket& packet) {
+	ATEthernetPacket packet2(packet);
+	packet2.mTimestamp = mClocks[packet.mClockIndex]->GetTimestamp(0);
+
+	DispatchFrame(source, packet2);
+}
+
+void ATEthernetBus::DispatchFrame(uint32 source, const ATEthernetPacket& packet) {
+	union {
+		ATEthernetArpFrameInfo arpInfo;
+		ATIPv4HeaderInfo ipv4Info;
+		ATIPv6HeaderInfo ipv6Info;
+	} dec;
+
+	ATEthernetFrameDecodedType decType = kATEthernetFrameDecodedType_None;
+	const void *decInfo = NULL;
+
+	if (packet.mLength >= 2) {
+		const uint8 *data = packet.mpData;
+
+		switch(VDReadUnalignedBEU16(data)) {
+			case kATEthernetFrameType_ARP:
+				if (ATEthernetDecodeArpPacket(dec.arpInfo, data + 2, packet.mLength - 2)) {
+					decInfo = &dec.arpInfo;
+					decType = kATEthernetFrameDecodedType_ARP;
+				}
+				break;
+
+			case kATEthernetFrameType_IP:
+				if (ATIPv4DecodeHeader(dec.ipv4Info, data + 2, packet.mLength - 2)) {
+					decInfo = &dec.ipv4Info;
+					decType = kATEthernetFrameDecodedType_IPv4;
+				}
+				break;
+				
+			case kATEthernetFrameType_IPv6:
+				if (ATIPv6DecodeHeader(dec.ipv6Info, data + 2, packet.mLength - 2)) {
+					decInfo = &dec.ipv6Info;
+					decType = kATEthernetFrameDecodedType_IPv6;
+				}
+				break;
+		}
+	}
+
+	if (mpMonitor)
+		mpMonitor->OnFrameDelivered(source, packet);
+
+	for(Endpoints::const_iterator itEP(mEndpoints.begin()), itEPEnd(mEndpoints.end());
+		itEP != itEPEnd;
+		++itEP)
+	{
+		const Endpoint& ep = *itEP;
+
+		if (ep.mId != source)
+			ep.mpEndpoint->ReceiveFrame(packet, decType, decInfo);
+	}
+}
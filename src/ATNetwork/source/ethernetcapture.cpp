@@ -0,0 +1,301 @@
+#include <stdafx.h>
+#include <vd2/system/error.h>
+#include <vd2/system/file.h>
+#include <at/atnetwork/ethernetcapture.h>
+
+ATEthernetCaptureWriter::ATEthernetCaptureWriter() {
+}
+
+ATEthernetCaptureWriter::~ATEthernetCaptureWriter() {
+	Shutdown();
+}
+
+void ATEthernetCaptureWriter::Init(const wchar_t *path, ATEthernetBus& bus, uint32 clockIndex, uint32 localEndpointId) {
+	Shutdown();
+
+	vdautoptr<VDFileStream> fs(new VDFileStream);
+	fs->open(path, nsVDFile::kWrite | nsVDFile::kDenyAll | nsVDFile::kCreateAlways | nsVDFile::kSequential);
+
+	vdautoptr<VDBufferedWriteStream> bs(new VDBufferedWriteStream(fs, 65536));
+
+	ATEthernetCaptureFileHeader hdr {};
+	hdr.mSignature = hdr.kSignature;
+	hdr.mVersion = hdr.kVersion;
+	bs->Write(&hdr, sizeof hdr);
+
+	mpFile = std::move(fs);
+	mpStream = std::move(bs);
+
+	mpBus = &bus;
+	mpClock = bus.GetClock(clockIndex);
+	mLocalEndpointId = localEndpointId;
+	mLastTimestamp = mpClock->GetTimestamp(0);
+	mFrameCount = 0;
+	mbErrorState = false;
+	mError.clear();
+
+	bus.SetMonitor(this);
+}
+
+void ATEthernetCaptureWriter::Close() {
+	if (mpStream && !mbErrorState) {
+		try {
+			mpStream->Flush();
+			mpStream.reset();
+			mpFile->close();
+		} catch(MyError& e) {
+			mError.TransferFrom(e);
+			mbErrorState = true;
+		}
+	}
+
+	Shutdown();
+
+	if (mbErrorState) {
+		mbErrorState = false;
+
+		MyError e;
+		e.TransferFrom(mError);
+		throw e;
+	}
+}
+
+void ATEthernetCaptureWriter::Shutdown() {
+	if (mpBus) {
+		mpBus->SetMonitor(nullptr);
+		mpBus = nullptr;
+	}
+
+	mpClock = nullptr;
+
+	if (mpStream) {
+		if (!mbErrorState) {
+			try {
+				mpStream->Flush();
+			} catch(const MyError&) {
+			}
+		}
+
+		mpStream.reset();
+	}
+
+	mpFile.reset();
+}
+
+void ATEthernetCaptureWriter::OnFrameDelivered(uint32 sourceId, const ATEthernetPacket& packet) {
+	if (!mpStream || mbErrorState || packet.mLength > 0xFFFF)
+		return;
+
+	ATEthernetCaptureRecordHeader hdr {};
+	hdr.mTimeDelta = packet.mTimestamp - mLastTimestamp;
+	hdr.mLength = (uint16)packet.mLength;
+	hdr.mFlags = (sourceId == mLocalEndpointId) ? hdr.kFlag_Local : 0;
+	memcpy(hdr.mDstAddr, packet.mDstAddr.mAddr, 6);
+	memcpy(hdr.mSrcAddr, packet.mSrcAddr.mAddr, 6);
+
+	try {
+		mpStream->Write(&hdr, sizeof hdr);
+		mpStream->Write(packet.mpData, packet.mLength);
+	} catch(MyError& e) {
+		// stop capturing; the error is reported when the capture is closed
+		mError.TransferFrom(e);
+		mbErrorState = true;
+		return;
+	}
+
+	mLastTimestamp = packet.mTimestamp;
+	++mFrameCount;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ATEthernetCapturePlayer::ATEthernetCapturePlayer() {
+}
+
+ATEthernetCapturePlayer::~ATEthernetCapturePlayer() {
+	Shutdown();
+}
+
+void ATEthernetCapturePlayer::Load(const wchar_t *path) {
+	VDFile f(path);
+
+	const sint64 size = f.size();
+	if (size > 0x10000000)
+		throw MyError("Ethernet capture file is too large.");
+
+	mData.resize((size_t)size);
+	f.read(mData.data(), (long)size);
+
+	ParseRecords();
+}
+
+void ATEthernetCapturePlayer::Load(const void *data, size_t len) {
+	mData.assign((const uint8 *)data, (const uint8 *)data + len);
+
+	ParseRecords();
+}
+
+void ATEthernetCapturePlayer::Init(ATEthernetBus& bus, uint32 clockIndex) {
+	Shutdown();
+
+	mpBus = &bus;
+	mpClock = bus.GetClock(clockIndex);
+	mClockIndex = clockIndex;
+	mEndpointId = bus.AddEndpoint(this);
+	mStartTime = mpClock->GetTimestamp(0);
+
+	mNextRecord = 0;
+	mNextLocalRecord = 0;
+	mFramesPlayed = 0;
+	mLocalFramesMatched = 0;
+	mLocalFramesDiverged = 0;
+
+	DeliverDueFrames();
+}
+
+void ATEthernetCapturePlayer::Shutdown() {
+	if (mClockEventId) {
+		mpClock->RemoveClockEvent(mClockEventId);
+		mClockEventId = 0;
+	}
+
+	if (mEndpointId) {
+		mpBus->RemoveEndpoint(mEndpointId);
+		mEndpointId = 0;
+	}
+
+	mpClock = nullptr;
+	mpBus = nullptr;
+}
+
+ATEthernetCapturePlayer::Status ATEthernetCapturePlayer::GetStatus() const {
+	Status status {};
+	status.mFramesPlayed = mFramesPlayed;
+	status.mFramesToPlay = mFramesToPlay;
+	status.mLocalFramesMatched = mLocalFramesMatched;
+	status.mLocalFramesDiverged = mLocalFramesDiverged;
+	status.mLocalFramesExpected = mLocalFramesExpected;
+
+	return status;
+}
+
+void ATEthernetCapturePlayer::ReceiveFrame(const ATEthernetPacket& packet, ATEthernetFrameDecodedType decType, const void *decInfo) {
+	// The only other transmitter on the bus during replay should be the local
+	// adapter, so anything we receive should match the next local frame in the
+	// capture, at the same time.
+	const uint32 n = (uint32)mRecords.size();
+
+	while(mNextLocalRecord < n && !mRecords[mNextLocalRecord].mbLocal)
+		++mNextLocalRecord;
+
+	if (mNextLocalRecord >= n) {
+		++mLocalFramesDiverged;
+		return;
+	}
+
+	const Record& rec = mRecords[mNextLocalRecord++];
+	const uint8 *src = mData.data() + rec.mOffset;
+
+	if (packet.mTimestamp - mStartTime == rec.mTime
+		&& packet.mLength == rec.mLength
+		&& !memcmp(packet.mDstAddr.mAddr, src - 12, 6)
+		&& !memcmp(packet.mSrcAddr.mAddr, src - 6, 6)
+		&& !memcmp(packet.mpData, src, rec.mLength))
+	{
+		++mLocalFramesMatched;
+	} else {
+		++mLocalFramesDiverged;
+	}
+}
+
+void ATEthernetCapturePlayer::OnClockEvent(uint32 eventid, uint32 userid) {
+	mClockEventId = 0;
+
+	DeliverDueFrames();
+}
+
+void ATEthernetCapturePlayer::ParseRecords() {
+	mRecords.clear();
+	mFramesToPlay = 0;
+	mLocalFramesExpected = 0;
+
+	const size_t size = mData.size();
+	ATEthernetCaptureFileHeader hdr;
+
+	if (size < sizeof hdr)
+		throw MyError("Invalid Ethernet capture file: file is truncated.");
+
+	memcpy(&hdr, mData.data(), sizeof hdr);
+
+	if (hdr.mSignature != hdr.kSignature)
+		throw MyError("Invalid Ethernet capture file: bad signature.");
+
+	if (hdr.mVersion != hdr.kVersion)
+		throw MyError("Unsupported Ethernet capture file version: %u.", hdr.mVersion);
+
+	size_t offset = sizeof hdr;
+	uint32 t = 0;
+
+	while(offset < size) {
+		ATEthernetCaptureRecordHeader rhdr;
+
+		if (size - offset < sizeof rhdr)
+			throw MyError("Invalid Ethernet capture file: record header is truncated.");
+
+		memcpy(&rhdr, mData.data() + offset, sizeof rhdr);
+		offset += sizeof rhdr;
+
+		if (size - offset < rhdr.mLength)
+			throw MyError("Invalid Ethernet capture file: frame is truncated.");
+
+		t += rhdr.mTimeDelta;
+
+		Record& rec = mRecords.push_back();
+		rec.mTime = t;
+		rec.mOffset = (uint32)offset;
+		rec.mLength = rhdr.mLength;
+		rec.mbLocal = (rhdr.mFlags & rhdr.kFlag_Local) != 0;
+
+		if (rec.mbLocal)
+			++mLocalFramesExpected;
+		else
+			++mFramesToPlay;
+
+		offset += rhdr.mLength;
+	}
+}
+
+void ATEthernetCapturePlayer::DeliverDueFrames() {
+	const uint32 now = mpClock->GetTimestamp(0);
+	const uint32 n = (uint32)mRecords.size();
+
+	while(mNextRecord < n) {
+		const Record& rec = mRecords[mNextRecord];
+
+		if (rec.mbLocal) {
+			++mNextRecord;
+			continue;
+		}
+
+		const uint32 t = mStartTime + rec.mTime;
+		if ((sint32)(t - now) > 0) {
+			mClockEventId = mpClock->AddClockEvent(t, this, 0);
+			break;
+		}
+
+		++mNextRecord;
+		++mFramesPlayed;
+
+		// record payload is preceded by the destination and source addresses
+		const uint8 *src = mData.data() + rec.mOffset;
+
+		ATEthernetPacket pkt {};
+		pkt.mClockIndex = mClockIndex;
+		memcpy(pkt.mDstAddr.mAddr, src - 12, 6);
+		memcpy(pkt.mSrcAddr.mAddr, src - 6, 6);
+		pkt.mpData = src;
+		pkt.mLength = rec.mLength;
+
+		mpBus->DeliverFrame(mEndpointId, pkt);
+	}
+}
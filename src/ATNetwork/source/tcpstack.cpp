@@ -89,6 +89,27 @@ void ATNetTcpRingBuffer::Read(uint32 offset, void *p, uint32 n) const {
 	}
 }
 
+uint32 ATNetTcpRingBuffer::GetReadSpans(uint32 offset, uint32 n, ATNetTcpDataSpan spans[2]) const {
+	VDASSERT(offset <= mLevel && mLevel - offset >= n);
+
+	if (!n)
+		return 0;
+
+	uint32 readPtr = mReadPtr + offset;
+	if (readPtr >= mSize)
+		readPtr -= mSize;
+
+	const uint32 toWrap = mSize - readPtr;
+	if (n <= toWrap) {
+		spans[0] = { mpBuffer + readPtr, n };
+		return 1;
+	}
+
+	spans[0] = { mpBuffer + readPtr, toWrap };
+	spans[1] = { mpBuffer, n - toWrap };
+	return 2;
+}
+
 void ATNetTcpRingBuffer::Ack(uint32 n) {
 	VDASSERT(n <= mLevel);
 
@@ -274,12 +295,17 @@ void ATNetTcpStack::OnPacket(const ATEthernetPacket& packet, const ATIPv4HeaderI
 	conn->Transmit(true);
 }
 
-uint32 ATNetTcpStack::EncodePacket(uint8 *dst, uint32 len, uint32 srcIpAddr, uint32 dstIpAddr, const ATTcpHeaderInfo& hdrInfo, const void *data, uint32 dataLen, const void *opts, uint32 optLen) {
-	if (len < 22 + 20 + dataLen)
+uint32 ATNetTcpStack::EncodePacket(uint8 *dst, uint32 len, uint32 srcIpAddr, uint32 dstIpAddr, const ATTcpHeaderInfo& hdrInfo, const ATNetTcpDataSpan *spans, uint32 numSpans, const void *opts, uint32 optLen) {
+	const uint32 optLenM4 = (optLen + 3) & ~3;
+	uint32 dataLen = 0;
+
+	for(uint32 i = 0; i < numSpans; ++i)
+		dataLen += spans[i].mLength;
+
+	if (len < 22 + 20 + optLenM4 + dataLen)
 		return 0;
 
 	// encode EtherType and IPv4 header
-	const uint32 optLenM4 = (optLen + 3) & ~3;
 	ATIPv4HeaderInfo iphdr;
 	mpIpStack->InitHeader(iphdr);
 	iphdr.mSrcAddr = srcIpAddr;
@@ -320,13 +346,23 @@ uint32 ATNetTcpStack::EncodePacket(uint8 *dst, uint32 len, uint32 srcIpAddr, uin
 	// Note that the Internet checksum is associative, so we can do the sums in
 	// any order.
 
+	// gather the payload directly into the frame, then checksum it there; the
+	// spans may split at an odd offset, so summing them in place would
+	// require byte swapping
+	uint8 *payload = dst + 20 + optLenM4;
+
+	for(uint32 i = 0; i < numSpans; ++i) {
+		memcpy(payload, spans[i].mpData, spans[i].mLength);
+		payload += spans[i].mLength;
+	}
+
 	// checksum pseudo-header
 	uint64 newSum64 = iphdr.mSrcAddr;
 	newSum64 += iphdr.mDstAddr;
 	newSum64 += VDToBE32(0x60000 + 20 + dataLen + optLenM4);
 
 	// checksum data payload
-	const uint8 *chksrc = (const uint8 *)data;
+	const uint8 *chksrc = dst + 20 + optLenM4;
 	for(uint32 dataLen4 = dataLen >> 2; dataLen4; --dataLen4) {
 		newSum64 += VDReadUnalignedU32(chksrc);
 		chksrc += 4;
@@ -343,11 +379,6 @@ uint32 ATNetTcpStack::EncodePacket(uint8 *dst, uint32 len, uint32 srcIpAddr, uin
 	// checksum header and write
 	VDWriteUnalignedU16(dst + 16, ATIPComputeChecksum(newSum64, dst, 5 + (optLenM4 >> 2)));
 
-	dst += 20 + optLenM4;
-
-	if (dataLen)
-		memcpy(dst, data, dataLen);
-
 	return 22 + 20 + dataLen + optLenM4;
 }
 
@@ -371,7 +402,7 @@ void ATNetTcpStack::SendReset(uint32 srcIpAddr, uint32 dstIpAddr, uint16 srcPort
 		tcpHeader.mAckNo = origTcpHdr.mSequenceNo + 1;
 	}
 
-	VDVERIFY(EncodePacket(rstPacket + 2, 42, dstIpAddr, srcIpAddr, tcpHeader, NULL, 0));
+	VDVERIFY(EncodePacket(rstPacket + 2, 42, dstIpAddr, srcIpAddr, tcpHeader, nullptr, 0));
 
 	SendFrame(srcIpAddr, rstPacket + 2, 42);
 }
@@ -729,12 +760,18 @@ void ATNetTcpConnection::OnPacket(const ATEthernetPacket& packet, const ATIPv4He
 	uint32 ackLen = tcpHdr.mDataLength + (tcpHdr.mbFIN ? 1 : 0);
 	bool ackNeeded = tcpHdr.mbSYN;
 
+	// Plain in-sequence data can have its ACK coalesced with others; SYN, FIN,
+	// out of sequence data, and window overflows must be ACKed right away.
+	bool ackImmediate = tcpHdr.mbSYN || tcpHdr.mbFIN;
+
 	if (ackLen) {
 		// we always need to reply if data is coming in
 		ackNeeded = true;
 
 		// check if the new data is where we expect it to be
-		if (tcpHdr.mSequenceNo == mRecvRing.GetTailSeq()) {
+		if (tcpHdr.mSequenceNo != mRecvRing.GetTailSeq())
+			ackImmediate = true;
+		else {
 			// check how much space we have
 			const uint32 recvSpace = mRecvRing.GetSpace();
 			uint32 tc = ackLen;
@@ -742,8 +779,10 @@ void ATNetTcpConnection::OnPacket(const ATEthernetPacket& packet, const ATIPv4He
 			// truncate the new data if we don't have enough space; note that we
 			// explicitly must ACK with win=0 on one byte on closed window, as this
 			// is required for the sender to probe the window
-			if (tc > recvSpace)
+			if (tc > recvSpace) {
 				tc = recvSpace;
+				ackImmediate = true;
+			}
 
 			if (tc) {
 				// check if we received data after shutting down receive -- if so, reset
@@ -797,12 +836,38 @@ void ATNetTcpConnection::OnPacket(const ATEthernetPacket& packet, const ATIPv4He
 	}
 
 	// check if we need a reply packet or if we received an ACK and can transmit now
-	if (ackNeeded)
-		Transmit(true);
-	else if (!mEventTransmit)
+	if (ackNeeded) {
+		if (ackImmediate)
+			Transmit(true);
+		else
+			DelayAck();
+	} else if (!mEventTransmit)
 		TryTransmitMore(true);
 }
 
+void ATNetTcpConnection::DelayAck() {
+	// If we have data to send, the ACK can ride along with it.
+	if (GetTransmitStatus() == kTransmitStatus_Yes) {
+		Transmit(true);
+		return;
+	}
+
+	// Don't let the sender run out of window waiting for us -- once half of
+	// the receive buffer has arrived unacknowledged, ACK immediately. This
+	// gives one ACK per several segments when a burst of them arrives on the
+	// same bus event instead of one per segment.
+	if (mRecvRing.GetTailSeq() - mRecvLastAckSent >= sizeof(mRecvBuf) / 2) {
+		Transmit(true);
+		return;
+	}
+
+	if (!mEventDelayedAck) {
+		IATEthernetClock *clk = mpTcpStack->GetClock();
+
+		mEventDelayedAck = clk->AddClockEvent(clk->GetTimestamp(1), this, kEventId_DelayedAck);
+	}
+}
+
 void ATNetTcpConnection::TryTransmitMore(bool immediate) {
 	auto transmitStatus = GetTransmitStatus();
 	IATEthernetClock *clk = mpTcpStack->GetClock();
@@ -842,10 +907,26 @@ void ATNetTcpConnection::TryTransmitMore(bool immediate) {
 }
 
 void ATNetTcpConnection::Transmit(bool ack, int retransmitCount, bool enableWindowProbe) {
+	TransmitSegment(ack, retransmitCount, enableWindowProbe);
+
+	// Keep sending as long as the window allows, so that bulk transfers go
+	// out as a burst instead of one segment per transmit timer tick.
+	for(uint32 i = 1; i < kMaxBurstSegments; ++i) {
+		if (!mpTcpStack || GetTransmitStatus() != kTransmitStatus_Yes)
+			break;
+
+		TransmitSegment(true, 0, false);
+	}
+
+	// queue future transmits as needed
+	if (mpTcpStack)
+		TryTransmitMore(false);
+}
+
+void ATNetTcpConnection::TransmitSegment(bool ack, int retransmitCount, bool enableWindowProbe) {
 	uint8 replyPacket[kMaxMSS + 44];
-	uint8 data[kMaxMSS];
 
-	VDASSERT(sizeof(data) >= mXmitMaxSegment);
+	VDASSERT(kMaxMSS >= mXmitMaxSegment);
 
 	// Kill the window probe and transmit timers, as we are going to actually send a packet.
 	if (mEventWindowProbe) {
@@ -863,6 +944,11 @@ void ATNetTcpConnection::Transmit(bool ack, int retransmitCount, bool enableWind
 		mEventTransmit = 0;
 	}
 
+	if (mEventDelayedAck) {
+		mpTcpStack->GetClock()->RemoveClockEvent(mEventDelayedAck);
+		mEventDelayedAck = 0;
+	}
+
 	// Check if we are sending a SYN packet. The SYN occupies a sequence number, which
 	// we fake in the transmit buffer with a dummy byte. However, there is no byte sent
 	// in the payload to correspond to the SYN and we must not send it.
@@ -951,9 +1037,13 @@ void ATNetTcpConnection::Transmit(bool ack, int retransmitCount, bool enableWind
 	replyTcpHeader.mAckNo = ack ? mRecvRing.GetBaseSeq() + mRecvRing.GetLevel() + (mbFinReceived ? 1 : 0) : 0;
 	replyTcpHeader.mSequenceNo = mXmitNext;
 	replyTcpHeader.mWindow = mRecvRing.GetSpace();
-	
-	if (dataLen)
-		mXmitRing.Read(xmitOffset, data, dataLen);
+
+	if (ack)
+		mRecvLastAckSent = mRecvRing.GetTailSeq();
+
+	// Encode the payload straight out of the transmit ring.
+	ATNetTcpDataSpan dataSpans[2];
+	const uint32 numDataSpans = mXmitRing.GetReadSpans(xmitOffset, dataLen, dataSpans);
 
 	// If we are sending a SYN, include MSS. We do this both for origination and a reply.
 	uint8 optdat[4];
@@ -969,7 +1059,7 @@ void ATNetTcpConnection::Transmit(bool ack, int retransmitCount, bool enableWind
 		optLen = 4;
 	}
 
-	uint32 replyLen = mpTcpStack->EncodePacket(replyPacket + 2, sizeof replyPacket - 2, mConnKey.mLocalAddress, mConnKey.mRemoteAddress, replyTcpHeader, data, dataLen, opts, optLen);
+	uint32 replyLen = mpTcpStack->EncodePacket(replyPacket + 2, sizeof replyPacket - 2, mConnKey.mLocalAddress, mConnKey.mRemoteAddress, replyTcpHeader, dataSpans, numDataSpans, opts, optLen);
 
 	// do state transitions now, if we are sending FIN
 	if (fin) {
@@ -1012,9 +1102,6 @@ void ATNetTcpConnection::Transmit(bool ack, int retransmitCount, bool enableWind
 		if (!mEventRetransmit)
 			mEventRetransmit = clk->AddClockEvent(clk->GetTimestamp(3000), this, kEventId_Retransmit);
 	}
-
-	// queue future transmits as needed
-	TryTransmitMore(false);
 }
 
 void ATNetTcpConnection::OnClockEvent(uint32 eventid, uint32 userid) {
@@ -1107,6 +1194,12 @@ void ATNetTcpConnection::OnClockEvent(uint32 eventid, uint32 userid) {
 			}
 
 			return;
+
+		case kEventId_DelayedAck:
+			mEventDelayedAck = 0;
+
+			Transmit(true);
+			return;
 	}
 }
 
@@ -1263,6 +1356,11 @@ void ATNetTcpConnection::ClearEvents() {
 		clk->RemoveClockEvent(mEventZeroWindowProbe);
 		mEventZeroWindowProbe = 0;
 	}
+
+	if (mEventDelayedAck) {
+		clk->RemoveClockEvent(mEventDelayedAck);
+		mEventDelayedAck = 0;
+	}
 }
 
 void ATNetTcpConnection::ProcessSynOptions(const ATEthernetPacket& packet, const ATTcpHeaderInfo& tcpHdr, const uint8 *data) {
@@ -0,0 +1,50 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef f_AT_ATNETWORKSOCKETS_INTERNAL_SOCKETWAIT_H
+#define f_AT_ATNETWORKSOCKETS_INTERNAL_SOCKETWAIT_H
+
+#include <vd2/system/function.h>
+
+class VDSignal;
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	Socket readiness backend
+//
+//	The socket worker only handles sockets that have been signaled. A
+//	socket wait watches the signal that a socket's network events are
+//	reported on, and calls its handler from a backend thread each time the
+//	signal fires. Destroying the wait blocks until any handler call in
+//	progress has returned, so it must not be done while holding a lock that
+//	the handler takes.
+//
+//	The only backend is the Win32 one in socketwait_win32.cpp, built on
+//	registered waits. There is no poll() or epoll() backend: the sockets
+//	report their network events through WSAEventSelect(), so such a backend
+//	would also need the socket classes to track readiness themselves.
+//
+///////////////////////////////////////////////////////////////////////////
+
+class IATNetSocketWait {
+public:
+	virtual ~IATNetSocketWait() = default;
+};
+
+// Returns null if the wait can't be created.
+IATNetSocketWait *ATNetCreateSocketWait(VDSignal& signal, vdfunction<void()> handler);
+
+#endif
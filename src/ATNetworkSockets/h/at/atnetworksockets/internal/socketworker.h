@@ -17,12 +17,14 @@
 #ifndef f_AT_ATNETWORKSOCKETS_INTERNAL_SOCKETWORKER_H
 #define f_AT_ATNETWORKSOCKETS_INTERNAL_SOCKETWORKER_H
 
-#include <bitset>
 #include <WinSock2.h>
 #include <vd2/system/refcount.h>
 #include <vd2/system/thread.h>
+#include <vd2/system/vdalloc.h>
+#include <vd2/system/vdstl.h>
 #include <at/atnetwork/socket.h>
 #include <at/atnetworksockets/internal/socketutils.h>
+#include <at/atnetworksockets/internal/socketwait.h>
 
 class ATNetSocketWorker;
 class IATAsyncDispatcher;
@@ -88,7 +90,12 @@ protected:
 		Closed
 	} mState = State::Created;
 
-	VDSignalPersistent mSocketSignal;
+	// Network event for the socket. It is watched by a socket wait rather
+	// than by the worker directly, which avoids the 64 handle limit on waits
+	// and lets the worker handle only the sockets that were signaled.
+	VDSignal mSocketSignal;
+	vdautoptr<IATNetSocketWait> mpSocketWait;
+
 	SOCKET mSocketHandle = INVALID_SOCKET;
 
 	bool mbRequestedShutdownSend = false;
@@ -107,6 +114,8 @@ protected:
 	ATSocketError mError = ATSocketError::None;
 
 	int mSocketIndex = -1;
+	bool mbUpdatePending = false;
+	bool mbSignalPending = false;
 
 	IATAsyncDispatcher *mpOnEventDispatcher = nullptr;
 	uint64 mOnEventToken = 0;
@@ -252,27 +261,24 @@ public:
 	vdrefptr<ATNetListenSocket> CreateListenSocket(const ATSocketAddress& bindAddress);
 	vdrefptr<ATNetDatagramSocket> CreateDatagramSocket(const ATSocketAddress& bindAddress, bool dualStack);
 
-	void RequestSocketUpdate_Locked(const ATNetSocket& socket);
+	void RequestSocketUpdate_Locked(ATNetSocket& socket);
 
 private:
-	static constexpr size_t kMaxSockets = 63;
-
 	bool RegisterSocket_Locked(ATNetSocket& s);
 
+	static void OnSocketSignaled(ATNetSocket& sock);
+
 	void ThreadRun() override;
 
 	vdrefptr<ATNetSocketSyncContext> mpSyncContext;
 
 	VDCriticalSection mMutex;
 	VDSignal mWakeSignal;
-	VDSignal mSocketSignal;
 	bool mbExitRequested = false;
-	bool mbUpdateSockets = false;
-
-	uint8 mNumSockets = 0;
-	vdrefptr<ATNetSocket> mSocketTable[kMaxSockets];
 
-	std::bitset<kMaxSockets> mSocketsNeedUpdate;
+	vdvector<vdrefptr<ATNetSocket>> mSocketTable;
+	vdfastvector<ATNetSocket *> mSocketsToUpdate;
+	vdfastvector<ATNetSocket *> mSignaledSockets;
 };
 
 #endif
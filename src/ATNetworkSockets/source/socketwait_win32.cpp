@@ -0,0 +1,73 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/vdalloc.h>
+#include <at/atnetworksockets/internal/socketwait.h>
+
+// Registered waits are serviced by the system thread pool, which groups them
+// into batches of up to 64 handles per wait thread. This avoids the handle
+// limit of WaitForMultipleObjects() without the worker having to poll every
+// socket.
+class ATNetSocketWaitW32 final : public IATNetSocketWait {
+public:
+	ATNetSocketWaitW32(vdfunction<void()> handler);
+	~ATNetSocketWaitW32();
+
+	bool Init(VDSignal& signal);
+
+private:
+	static void CALLBACK OnSignaled(void *p, BOOLEAN timedOut);
+
+	vdfunction<void()> mpHandler;
+	HANDLE mhWait = nullptr;
+};
+
+ATNetSocketWaitW32::ATNetSocketWaitW32(vdfunction<void()> handler)
+	: mpHandler(std::move(handler))
+{
+}
+
+ATNetSocketWaitW32::~ATNetSocketWaitW32() {
+	// INVALID_HANDLE_VALUE waits for any callback in flight
+	if (mhWait)
+		UnregisterWaitEx(mhWait, INVALID_HANDLE_VALUE);
+}
+
+bool ATNetSocketWaitW32::Init(VDSignal& signal) {
+	if (!RegisterWaitForSingleObject(&mhWait, signal.getHandle(), OnSignaled, this, INFINITE, WT_EXECUTEINWAITTHREAD)) {
+		mhWait = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+void CALLBACK ATNetSocketWaitW32::OnSignaled(void *p, BOOLEAN timedOut) {
+	((ATNetSocketWaitW32 *)p)->mpHandler();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+IATNetSocketWait *ATNetCreateSocketWait(VDSignal& signal, vdfunction<void()> handler) {
+	vdautoptr<ATNetSocketWaitW32> wait(new ATNetSocketWaitW32(std::move(handler)));
+
+	if (!wait->Init(signal))
+		return nullptr;
+
+	return wait.release();
+}
@@ -35,9 +35,14 @@ ATNetSocket::ATNetSocket(ATNetSocketSyncContext& syncContext)
 ATNetSocket::~ATNetSocket() {
 	// we must always Shutdown() the socket before beginning dtor
 	VDASSERT(mSocketHandle == INVALID_SOCKET);
+	VDASSERT(!mpSocketWait);
 }
 
 void ATNetSocket::Shutdown() {
+	// This waits for any in-flight wait callback, so it must not be called
+	// with the mutex held on a registered socket.
+	mpSocketWait.reset();
+
 	vdfunction<void(const ATSocketStatus&)> eventFn;
 
 	vdsynchronized(mpSyncContext->mCallbackMutex) {
@@ -757,8 +762,6 @@ void ATNetStreamSocket::DoClose_Locked() {
 	if (mSocketHandle != INVALID_SOCKET) {
 		closesocket(mSocketHandle);
 		mSocketHandle = INVALID_SOCKET;
-
-		mSocketSignal.unsignal();
 	}
 
 	QueueEvent_Locked();
@@ -856,8 +859,6 @@ void ATNetListenSocket::Update() {
 			if (mSocketHandle != INVALID_SOCKET) {
 				closesocket(mSocketHandle);
 				mSocketHandle = INVALID_SOCKET;
-
-				mSocketSignal.unsignal();
 			}
 
 			QueueEvent_Locked();
@@ -1336,8 +1337,6 @@ void ATNetDatagramSocket::DoClose_Locked() {
 	if (mSocketHandle != INVALID_SOCKET) {
 		closesocket(mSocketHandle);
 		mSocketHandle = INVALID_SOCKET;
-
-		mSocketSignal.unsignal();
 	}
 
 	QueueEvent_Locked();
@@ -1380,8 +1379,6 @@ uint32 ATNetDatagramSocket::SplitWrite(void *dst, uint32 dstOffset, size_t dstLe
 ATNetSocketWorker::ATNetSocketWorker()
 	: VDThread("Net socket worker")
 {
-	mSocketsNeedUpdate.reset();
-
 	mpSyncContext = new ATNetSocketSyncContext;
 	mpSyncContext->mpWorker = this;
 }
@@ -1467,29 +1464,32 @@ vdrefptr<ATNetDatagramSocket> ATNetSocketWorker::CreateDatagramSocket(const ATSo
 	return s;
 }
 
-void ATNetSocketWorker::RequestSocketUpdate_Locked(const ATNetSocket& socket) {
+void ATNetSocketWorker::RequestSocketUpdate_Locked(ATNetSocket& socket) {
 	if (socket.mSocketIndex < 0)
 		return;
 
-	if (mSocketsNeedUpdate[socket.mSocketIndex])
+	if (socket.mbUpdatePending)
 		return;
 
-	mSocketsNeedUpdate[socket.mSocketIndex] = true;
+	socket.mbUpdatePending = true;
 
-	if (!mbUpdateSockets) {
-		mbUpdateSockets = true;
+	const bool wake = mSocketsToUpdate.empty();
+	mSocketsToUpdate.push_back(&socket);
 
+	if (wake)
 		mWakeSignal();
-	}
 }
 
 bool ATNetSocketWorker::RegisterSocket_Locked(ATNetSocket& s) {
 	vdsynchronized(mpSyncContext->mMutex) {
-		if (mNumSockets >= kMaxSockets)
+		// The wait callback can fire immediately, but it will block on the
+		// lock until the socket is in the table.
+		s.mpSocketWait = ATNetCreateSocketWait(s.mSocketSignal, [&s] { OnSocketSignaled(s); });
+		if (!s.mpSocketWait)
 			return false;
 
-		mSocketTable[mNumSockets] = &s;
-		s.mSocketIndex = mNumSockets++;
+		s.mSocketIndex = (int)mSocketTable.size();
+		mSocketTable.emplace_back(&s);
 
 		RequestSocketUpdate_Locked(s);
 	}
@@ -1497,118 +1497,114 @@ bool ATNetSocketWorker::RegisterSocket_Locked(ATNetSocket& s) {
 	return true;
 }
 
-void ATNetSocketWorker::ThreadRun() {
-	const VDSignalBase *signalWaitArray[kMaxSockets + 1] {};
-	size_t numActiveSockets = 0;
+void ATNetSocketWorker::OnSocketSignaled(ATNetSocket& sock) {
+	vdsynchronized(sock.mpSyncContext->mMutex) {
+		ATNetSocketWorker *worker = sock.mpSyncContext->mpWorker;
 
-	signalWaitArray[0] = &mWakeSignal;
+		// removed sockets and sockets already queued are ignored
+		if (worker && sock.mSocketIndex >= 0 && !sock.mbSignalPending) {
+			sock.mbSignalPending = true;
 
-	for(;;) {
-		int idx = VDSignalBase::waitMultiple(signalWaitArray, numActiveSockets + 1);
-		if (idx < 0)
-			break;
+			const bool wake = worker->mSignaledSockets.empty();
+			worker->mSignaledSockets.push_back(&sock);
 
-		// check if it was the wake signal
-		if (idx == 0) {
-			vdvector<vdrefptr<ATNetSocket>> socketsToDestroy;
-			std::bitset<kMaxSockets> socketsToUpdate;
-			socketsToUpdate.reset();
-			
-			vdsynchronized(mpSyncContext->mMutex) {
-				if (mbExitRequested)
-					break;
-
-				if (mbUpdateSockets) {
-					mbUpdateSockets = false;
+			if (wake)
+				worker->mWakeSignal();
+		}
+	}
+}
 
-					// Add in any new sockets.
-					while(numActiveSockets < mNumSockets) {
-						signalWaitArray[numActiveSockets + 1] = &mSocketTable[numActiveSockets]->mSocketSignal;
-						++numActiveSockets;
-					}
+void ATNetSocketWorker::ThreadRun() {
+	// Sockets are only removed from the table by this thread, and removed
+	// sockets are kept alive until their wait is unregistered, so the socket
+	// lists can be walked outside of the lock.
+	vdfastvector<ATNetSocket *> socketsToUpdate;
+	vdfastvector<ATNetSocket *> signaledSockets;
+	vdvector<vdrefptr<ATNetSocket>> socketsToDestroy;
 
-					// Any added sockets will be at the end, so run over them
-					// in reverse order.
-					for (size_t i = 0; i < numActiveSockets; ++i) {
-						if (!mSocketsNeedUpdate[i])
-							continue;
+	for(;;) {
+		mWakeSignal.wait();
 
-						mSocketsNeedUpdate[i] = false;
+		vdsynchronized(mpSyncContext->mMutex) {
+			if (mbExitRequested)
+				break;
 
-						ATNetSocket *sock = mSocketTable[i];
-						if (sock->IsAbandoned()) {
-							--mNumSockets;
-							--numActiveSockets;
+			signaledSockets.swap(mSignaledSockets);
 
-							sock->mSocketIndex = -1;
-							signalWaitArray[i + 1] = nullptr;
+			for(ATNetSocket *sock : signaledSockets)
+				sock->mbSignalPending = false;
 
-							// we have to be careful not to do a Release() on a socket in here
-							// since it risks a deadlock
-							socketsToDestroy.emplace_back(std::move(mSocketTable[i]));
-							mSocketTable[i] = nullptr;
+			for(ATNetSocket *sock : mSocketsToUpdate) {
+				sock->mbUpdatePending = false;
 
-							if (i < mNumSockets) {
-								signalWaitArray[i + 1] = signalWaitArray[mNumSockets + 1];
-								signalWaitArray[mNumSockets + 1] = nullptr;
+				if (sock->IsAbandoned()) {
+					// swap the last socket into the vacated slot
+					const int index = sock->mSocketIndex;
+					sock->mSocketIndex = -1;
 
-								mSocketTable[i] = std::move(mSocketTable[mNumSockets]);
-								mSocketTable[i]->mSocketIndex = i;
-								mSocketsNeedUpdate[i] = mSocketsNeedUpdate[mNumSockets];
-								mSocketsNeedUpdate[mNumSockets] = false;
-							}
+					// we have to be careful not to do a Release() on a socket in here
+					// since it risks a deadlock
+					socketsToDestroy.emplace_back(std::move(mSocketTable[index]));
 
-							--i;
+					if ((size_t)index + 1 < mSocketTable.size()) {
+						mSocketTable[index] = std::move(mSocketTable.back());
+						mSocketTable[index]->mSocketIndex = index;
+					}
 
-							// If the socket is abandoned, hard close it even if it has already
-							// been soft closed. This prevents us from having orphaned sockets
-							// in the socket table that can be held open indefinitely by a remote
-							// host that isn't reading the remaining data.
-							if (!sock->IsHardClosing_Locked())
-								sock->CloseSocket(true);
+					mSocketTable.pop_back();
 
-						} else {
-							socketsToUpdate[i] = true;
-						}
-					}
+					// If the socket is abandoned, hard close it even if it has already
+					// been soft closed. This prevents us from having orphaned sockets
+					// in the socket table that can be held open indefinitely by a remote
+					// host that isn't reading the remaining data.
+					if (!sock->IsHardClosing_Locked())
+						sock->CloseSocket(true);
+				} else {
+					socketsToUpdate.push_back(sock);
 				}
 			}
 
-			// update sockets now
-			for(size_t i = 0; i < numActiveSockets; ++i) {
-				if (socketsToUpdate[i])
-					mSocketTable[i]->Update();
-			}
+			mSocketsToUpdate.clear();
+		}
 
-			while(!socketsToDestroy.empty()) {
-				// If the socket has been abandoned, we may still need to process
-				// a pending close.
-				socketsToDestroy.back()->Update();
+		// update sockets now
+		for(ATNetSocket *sock : socketsToUpdate)
+			sock->Update();
 
-				socketsToDestroy.back()->Shutdown();
-				socketsToDestroy.pop_back();
-			}
+		socketsToUpdate.clear();
 
-			continue;
+		// handle network events on signaled sockets, skipping any that were
+		// just removed
+		for(ATNetSocket *sock : signaledSockets) {
+			if (sock->mSocketIndex >= 0)
+				sock->HandleSocketSignal();
 		}
 
-		// it was a socket signal -- have the socket do its thing
-		mSocketTable[idx - 1]->HandleSocketSignal();
+		signaledSockets.clear();
+
+		while(!socketsToDestroy.empty()) {
+			// If the socket has been abandoned, we may still need to process
+			// a pending close.
+			socketsToDestroy.back()->Update();
+
+			socketsToDestroy.back()->Shutdown();
+			socketsToDestroy.pop_back();
+		}
 	}
 
 	// dump existing sockets
 	{
-		vdvector<vdrefptr<ATNetSocket>> socketsToDestroy;
-
 		vdsynchronized(mpSyncContext->mMutex) {
 			for(auto& s : mSocketTable) {
-				if (s) {
-					socketsToDestroy.emplace_back(std::move(s));
-					s = nullptr;
-				}
+				s->mSocketIndex = -1;
+				s->mbUpdatePending = false;
+				s->mbSignalPending = false;
+				socketsToDestroy.emplace_back(std::move(s));
 			}
 
-			mNumSockets = 0;
+			mSocketTable.clear();
+			mSocketsToUpdate.clear();
+			mSignaledSockets.clear();
 
 			mpSyncContext->mpWorker = nullptr;
 		}
@@ -11,4 +11,43 @@ typedef ATTestAssertionException AssertionException;
 #define TEST_ASSERT AT_TEST_ASSERT
 #define TEST_ASSERTF AT_TEST_ASSERTF
 
+// Deterministic xorshift generator for randomized tests, so that failures
+// reproduce from run to run.
+class ATTestRandom {
+public:
+	ATTestRandom(uint32 seed = 0x12345678) : mState(seed) {}
+
+	uint32 Next() {
+		mState ^= mState << 13;
+		mState ^= mState >> 17;
+		mState ^= mState << 5;
+		return mState;
+	}
+
+	uint32 Next(uint32 range) { return Next() % range; }
+
+private:
+	uint32 mState;
+};
+
+// Uniquely named scratch directory under the system temp path for tests that
+// need real files. The directory and everything in it are deleted when the
+// object is destroyed.
+class ATTestTempDirectory {
+	ATTestTempDirectory(const ATTestTempDirectory&) = delete;
+	ATTestTempDirectory& operator=(const ATTestTempDirectory&) = delete;
+public:
+	ATTestTempDirectory();
+	~ATTestTempDirectory();
+
+	const wchar_t *GetPath() const { return mPath.c_str(); }
+	VDStringW MakePath(const wchar_t *name) const;
+
+	// Create or overwrite a file in the directory, returning its full path.
+	VDStringW AddFile(const wchar_t *name, const void *data, size_t len) const;
+
+private:
+	VDStringW mPath;
+};
+
 #endif
@@ -0,0 +1,87 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Test module
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef f_TESTNET_H
+#define f_TESTNET_H
+
+#include <vd2/system/vdstl.h>
+#include <at/atnetwork/ethernet.h>
+#include "test.h"
+
+// Manually stepped Ethernet clock with millisecond ticks.
+class ATTestNetClock final : public IATEthernetClock {
+public:
+	uint32 GetTime() const { return mTime; }
+
+	uint32 GetTimestamp(sint32 offsetMS) override { return mTime + offsetMS; }
+	sint32 SubtractTimestamps(uint32 t1, uint32 t2) override { return (sint32)(t1 - t2); }
+
+	uint32 AddClockEvent(uint32 timestamp, IATEthernetClockEventSink *sink, uint32 userid) override {
+		// same as the simulator clock: events can't fire on the current tick
+		if ((sint32)(timestamp - mTime) <= 0)
+			timestamp = mTime + 1;
+
+		if (!++mNextEventId)
+			++mNextEventId;
+
+		mEvents.push_back({ timestamp, mNextEventId, sink, userid });
+		return mNextEventId;
+	}
+
+	void RemoveClockEvent(uint32 eventid) override {
+		for(auto it = mEvents.begin(); it != mEvents.end(); ++it) {
+			if (it->mId == eventid) {
+				mEvents.erase(it);
+				return;
+			}
+		}
+
+		AT_TEST_ASSERT(!"Removing nonexistent clock event.");
+	}
+
+	bool RunNextEvent() {
+		if (mEvents.empty())
+			return false;
+
+		auto itNext = mEvents.begin();
+		for(auto it = itNext + 1; it != mEvents.end(); ++it) {
+			if ((sint32)(it->mTimestamp - itNext->mTimestamp) < 0)
+				itNext = it;
+		}
+
+		const Event ev = *itNext;
+		mEvents.erase(itNext);
+
+		mTime = ev.mTimestamp;
+		ev.mpSink->OnClockEvent(ev.mId, ev.mUserId);
+		return true;
+	}
+
+private:
+	struct Event {
+		uint32 mTimestamp;
+		uint32 mId;
+		IATEthernetClockEventSink *mpSink;
+		uint32 mUserId;
+	};
+
+	uint32 mTime = 0;
+	uint32 mNextEventId = 0;
+	vdfastvector<Event> mEvents;
+};
+
+#endif
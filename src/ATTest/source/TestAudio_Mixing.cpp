@@ -0,0 +1,141 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/cpuaccel.h>
+#include <at/ataudio/audiofilters.h>
+#include "test.h"
+
+namespace {
+	// Buffers are padded on both sides so that the kernels can be run at
+	// every alignment and checked for writes outside of the block.
+	constexpr uint32 kATTestMixMaxLen = 75;
+	constexpr uint32 kATTestMixPad = 8;
+	constexpr uint32 kATTestMixBufLen = kATTestMixMaxLen + kATTestMixPad * 2;
+
+	void ATTestMixFill(float *dst, uint32 n, ATTestRandom& rng) {
+		for(uint32 i = 0; i < n; ++i)
+			dst[i] = (float)(sint32)rng.Next() * (1.0f / 65536.0f);
+	}
+
+	void ATTestMixCompare(const float *ref, const float *test, const char *name, uint32 n, uint32 offset) {
+		// bitwise -- the kernels must not change any rounding
+		for(uint32 i = 0; i < kATTestMixBufLen; ++i)
+			AT_TEST_ASSERTF(!memcmp(&ref[i], &test[i], sizeof(float)), "%s: mismatch at %u (length %u, offset %u)", name, i, n, offset);
+	}
+
+	// The reference loops are the scalar loops the mixing kernels replaced in
+	// the sample player and audio output.
+	void ATTestMixRun(const char *extName) {
+		ATTestRandom rng;
+
+		float refL[kATTestMixBufLen];
+		float refR[kATTestMixBufLen];
+		float testL[kATTestMixBufLen];
+		float testR[kATTestMixBufLen];
+		float srcL[kATTestMixBufLen];
+		float srcR[kATTestMixBufLen];
+		sint16 src16[kATTestMixBufLen];
+
+		for(uint32 n = 0; n <= kATTestMixMaxLen; ++n) {
+			for(uint32 offset = 0; offset < 4; ++offset) {
+				const uint32 start = kATTestMixPad + offset;
+
+				ATTestMixFill(refL, kATTestMixBufLen, rng);
+				ATTestMixFill(refR, kATTestMixBufLen, rng);
+				ATTestMixFill(srcL, kATTestMixBufLen, rng);
+				ATTestMixFill(srcR, kATTestMixBufLen, rng);
+
+				for(sint16& v : src16)
+					v = (sint16)rng.Next();
+
+				// include the extremes
+				src16[start] = -0x8000;
+				src16[start + 1] = 0x7FFF;
+
+				const float vol = (float)rng.Next(0x10000) * (1.0f / 0x8000);
+
+				// mono sample into mono
+				memcpy(testL, refL, sizeof testL);
+
+				for(uint32 i = 0; i < n; ++i)
+					refL[start + i] += (float)src16[start + i] * vol;
+
+				ATFilterMixScaledMono16(testL + start, nullptr, src16 + start, n, vol);
+				ATTestMixCompare(refL, testL, extName, n, offset);
+
+				// mono sample into stereo
+				memcpy(testL, refL, sizeof testL);
+				memcpy(testR, refR, sizeof testR);
+
+				for(uint32 i = 0; i < n; ++i) {
+					const float sample = (float)src16[start + i] * vol;
+					refL[start + i] += sample;
+					refR[start + i] += sample;
+				}
+
+				ATFilterMixScaledMono16(testL + start, testR + start, src16 + start, n, vol);
+				ATTestMixCompare(refL, testL, extName, n, offset);
+				ATTestMixCompare(refR, testR, extName, n, offset);
+
+				// mono mix buffer into stereo
+				memcpy(testL, refL, sizeof testL);
+				memcpy(testR, refR, sizeof testR);
+
+				for(uint32 i = 0; i < n; ++i) {
+					const float v = srcL[start + i];
+
+					refL[start + i] += v;
+					refR[start + i] += v;
+				}
+
+				ATFilterMixMonoToStereo(testL + start, testR + start, srcL + start, n);
+				ATTestMixCompare(refL, testL, extName, n, offset);
+				ATTestMixCompare(refR, testR, extName, n, offset);
+
+				// stereo to mono downmix
+				memcpy(testL, refL, sizeof testL);
+				memcpy(testR, refR, sizeof testR);
+
+				for(uint32 i = 0; i < n; ++i)
+					refL[start + i] = refR[start + i] = (srcL[start + i] + srcR[start + i]) * 0.5f;
+
+				ATFilterDownmixStereoToMono(testL + start, testR + start, srcL + start, srcR + start, n);
+				ATTestMixCompare(refL, testL, extName, n, offset);
+				ATTestMixCompare(refR, testR, extName, n, offset);
+			}
+		}
+	}
+}
+
+AT_DEFINE_TEST(Audio_Mixing) {
+	const long ex = CPUCheckForExtensions();
+
+#if VD_CPU_X86 || VD_CPU_X64
+	CPUEnableExtensions(ex & (CPUF_SUPPORTS_MMX | CPUF_SUPPORTS_INTEGER_SSE));
+	ATTestMixRun("Scalar");
+
+	if (ex & CPUF_SUPPORTS_SSE2) {
+		CPUEnableExtensions(ex);
+		ATTestMixRun("SSE2");
+	}
+#else
+	ATTestMixRun("NEON");
+#endif
+
+	CPUEnableExtensions(ex);
+	return 0;
+}
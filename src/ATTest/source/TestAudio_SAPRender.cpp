@@ -0,0 +1,127 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/binary.h>
+#include <vd2/system/file.h>
+#include "saprender.h"
+#include "test.h"
+
+namespace {
+	constexpr uint32 kATTestSAPFrames = 25;
+
+	struct ATTestSAPPeaks {
+		uint32 mChannels;
+		uint32 mFrames;
+		sint32 mPeak[2];
+	};
+
+	// Build a type R file that plays a tone on channel 1 of the given POKEY
+	// and keeps the other POKEY (if any) silent, changing pitch every frame.
+	// Misframing the register dumps moves the tone to the wrong POKEY.
+	vdfastvector<uint8> ATTestSAPMakeTypeR(bool stereo, int tonePokey) {
+		const char *hdr = stereo
+			? "SAP\r\nTYPE R\r\nSTEREO\r\nTIME 00:00.500\r\n\r\n"
+			: "SAP\r\nTYPE R\r\nTIME 00:00.500\r\n\r\n";
+
+		vdfastvector<uint8> sap((const uint8 *)hdr, (const uint8 *)hdr + strlen(hdr));
+
+		const int numPokeys = stereo ? 2 : 1;
+		for(uint32 frame = 0; frame < kATTestSAPFrames; ++frame) {
+			for(int pokey = 0; pokey < numPokeys; ++pokey) {
+				uint8 regs[9] {};
+
+				if (pokey == tonePokey) {
+					regs[0] = (uint8)(0x20 + frame);	// AUDF1
+					regs[1] = 0xAF;						// AUDC1: pure tone, volume 15
+				}
+
+				sap.insert(sap.end(), regs, regs + 9);
+			}
+		}
+
+		return sap;
+	}
+
+	ATTestSAPPeaks ATTestSAPRender(ATTestTempDirectory& dir, const wchar_t *name, const vdfastvector<uint8>& sap) {
+		ATSAPRenderJob job;
+		job.mSrcPath = dir.AddFile(name, sap.data(), sap.size());
+		job.mDstPath = dir.MakePath(L"out.wav");
+
+		ATRenderSAPToWAV(job);
+		AT_TEST_ASSERT(job.mbSucceeded);
+
+		AT_TEST_ASSERT(job.mAudioSeconds > 0.4 && job.mAudioSeconds < 0.6);
+
+		VDFile f(job.mDstPath.c_str());
+		vdfastvector<uint8> wav((size_t)f.size());
+		f.read(wav.data(), (long)wav.size());
+		f.close();
+
+		// 16-bit PCM with an 18 byte format chunk, as written by ATAudioWriter
+		AT_TEST_ASSERT(wav.size() >= 46);
+		AT_TEST_ASSERT(!memcmp(wav.data(), "RIFF", 4) && !memcmp(&wav[8], "WAVE", 4) && !memcmp(&wav[38], "data", 4));
+
+		ATTestSAPPeaks peaks {};
+		peaks.mChannels = VDReadUnalignedLEU16(&wav[22]);
+		AT_TEST_ASSERT(peaks.mChannels == 1 || peaks.mChannels == 2);
+
+		const uint32 dataLen = VDReadUnalignedLEU32(&wav[42]);
+		AT_TEST_ASSERT(dataLen <= wav.size() - 46);
+
+		peaks.mFrames = dataLen / (2 * peaks.mChannels);
+
+		const uint8 *src = &wav[46];
+		for(uint32 i = 0; i < peaks.mFrames; ++i) {
+			for(uint32 ch = 0; ch < peaks.mChannels; ++ch) {
+				const sint32 v = abs((sint16)VDReadUnalignedLEU16(src));
+				src += 2;
+
+				if (peaks.mPeak[ch] < v)
+					peaks.mPeak[ch] = v;
+			}
+		}
+
+		return peaks;
+	}
+}
+
+AT_DEFINE_TEST(Audio_SAPRender) {
+	static constexpr sint32 kSilentPeak = 16;
+	static constexpr sint32 kTonePeak = 1000;
+
+	ATTestTempDirectory dir;
+
+	// mono
+	ATTestSAPPeaks peaks = ATTestSAPRender(dir, L"mono.sap", ATTestSAPMakeTypeR(false, 0));
+
+	AT_TEST_ASSERT(peaks.mChannels == 1);
+	AT_TEST_ASSERT(peaks.mFrames > 44100 * 4 / 10);
+	AT_TEST_ASSERT(peaks.mPeak[0] > kTonePeak);
+
+	// stereo, with the tone on each POKEY in turn; the other channel must
+	// stay silent
+	for(int tonePokey = 0; tonePokey < 2; ++tonePokey) {
+		peaks = ATTestSAPRender(dir, L"stereo.sap", ATTestSAPMakeTypeR(true, tonePokey));
+
+		AT_TEST_ASSERT(peaks.mChannels == 2);
+		AT_TEST_ASSERT(peaks.mFrames > 44100 * 4 / 10);
+		AT_TEST_ASSERTF(peaks.mPeak[tonePokey] > kTonePeak, "Tone on POKEY %d: tone channel peak %d", tonePokey + 1, peaks.mPeak[tonePokey]);
+		AT_TEST_ASSERTF(peaks.mPeak[tonePokey ^ 1] < kSilentPeak, "Tone on POKEY %d: silent channel peak %d", tonePokey + 1, peaks.mPeak[tonePokey ^ 1]);
+	}
+
+	return 0;
+}
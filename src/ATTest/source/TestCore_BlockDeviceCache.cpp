@@ -0,0 +1,268 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/error.h>
+#include <vd2/system/thread.h>
+#include <at/atcore/blockdevicecache.h>
+#include "test.h"
+
+namespace {
+	// In-memory backing store that records the writes that reach it. A write
+	// can be held on the worker thread to force the emulation side to run
+	// ahead of it, and writes can be made to fail.
+	class ATTestBlockStore {
+	public:
+		ATTestBlockStore(uint32 sectorCount) : mData(sectorCount * 512) {}
+
+		uint32 GetSectorCount() const { return (uint32)(mData.size() >> 9); }
+		uint8 *GetSector(uint32 lba) { return &mData[lba * 512]; }
+
+		void InitCache(ATBlockDeviceCache& cache, bool writeBehind) {
+			cache.Init(GetSectorCount(),
+				[this](void *data, uint32 lba, uint32 n) { Read(data, lba, n); },
+				[this](const void *data, uint32 lba, uint32 n) { Write(data, lba, n); },
+				writeBehind);
+		}
+
+		void Read(void *data, uint32 lba, uint32 n) {
+			AT_TEST_ASSERT(lba + n <= GetSectorCount());
+
+			memcpy(data, GetSector(lba), n * 512);
+			mReadSectors += n;
+		}
+
+		void Write(const void *data, uint32 lba, uint32 n) {
+			AT_TEST_ASSERT(lba + n <= GetSectorCount());
+
+			if (mbHoldNextWrite) {
+				mbHoldNextWrite = false;
+				mWriteEntered.signal();
+				mWriteRelease.wait();
+			}
+
+			if (mbFailWrites)
+				throw MyError("Simulated write failure at sector %u.", lba);
+
+			memcpy(GetSector(lba), data, n * 512);
+
+			for(uint32 i = 0; i < n; ++i)
+				mWriteLog.push_back({ lba + i, ((const uint8 *)data)[512 * i] });
+		}
+
+		struct WriteLogEntry {
+			uint32 mLBA;
+			uint8 mFirstByte;
+		};
+
+		vdfastvector<uint8> mData;
+		vdfastvector<WriteLogEntry> mWriteLog;
+		uint32 mReadSectors = 0;
+
+		bool mbHoldNextWrite = false;
+		bool mbFailWrites = false;
+		VDSignal mWriteEntered;
+		VDSignal mWriteRelease;
+	};
+
+	void ATTestBlockDeviceCacheFill(void *data, uint32 n, ATTestRandom& rng) {
+		for(uint32 i = 0; i < n * 128; ++i)
+			((uint32 *)data)[i] = rng.Next();
+	}
+
+	void ATTestBlockDeviceCacheTestReadAhead() {
+		// larger than the cache so that lines are evicted along the way
+		ATTestRandom rng;
+		ATTestBlockStore store(20000);
+		ATTestBlockDeviceCacheFill(store.mData.data(), store.GetSectorCount(), rng);
+
+		ATBlockDeviceCache cache;
+		store.InitCache(cache, false);
+
+		// Stream the disk in small sequential reads, letting readahead finish
+		// after each one: only the first line should miss.
+		uint8 buf[8 * 512];
+		for(uint32 lba = 0; lba < store.GetSectorCount(); lba += 8) {
+			cache.ReadSectors(buf, lba, 8);
+			cache.Flush();
+
+			AT_TEST_ASSERTF(!memcmp(buf, store.GetSector(lba), sizeof buf), "Read mismatch at sector %u", lba);
+		}
+
+		ATBlockDeviceCacheStats stats = cache.GetStats();
+		AT_TEST_ASSERT(stats.mReadMissSectors == 8);
+		AT_TEST_ASSERT(stats.mReadHitSectors == store.GetSectorCount() - 8);
+		AT_TEST_ASSERT(stats.mReadAheadSectors == store.GetSectorCount() - 16);
+
+		// every sector was fetched from the backing store exactly once
+		AT_TEST_ASSERT(store.mReadSectors == store.GetSectorCount());
+
+		// Stream again without waiting, racing the guest reads against
+		// readahead, then do scattered reads.
+		for(uint32 lba = 0; lba < store.GetSectorCount(); lba += 8) {
+			cache.ReadSectors(buf, lba, 8);
+			AT_TEST_ASSERTF(!memcmp(buf, store.GetSector(lba), sizeof buf), "Read mismatch at sector %u", lba);
+		}
+
+		for(int i = 0; i < 5000; ++i) {
+			const uint32 n = 1 + rng.Next(8);
+			const uint32 lba = rng.Next(store.GetSectorCount() - n + 1);
+
+			cache.ReadSectors(buf, lba, n);
+			AT_TEST_ASSERTF(!memcmp(buf, store.GetSector(lba), n * 512), "Read mismatch at sector %u", lba);
+		}
+
+		cache.Shutdown();
+	}
+
+	void ATTestBlockDeviceCacheTestWriteOrdering() {
+		ATTestRandom rng;
+		ATTestBlockStore store(8192);
+
+		ATBlockDeviceCache cache;
+		store.InitCache(cache, true);
+
+		// Hold the first write-behind on the worker, then rewrite the same
+		// sector and its neighbor while it is in flight. The newest data must
+		// be visible to reads immediately and must land last.
+		uint8 sec[512];
+
+		memset(sec, 0xA1, sizeof sec);
+		store.mbHoldNextWrite = true;
+		cache.WriteSectors(sec, 5, 1);
+		store.mWriteEntered.wait();
+
+		memset(sec, 0xB2, sizeof sec);
+		cache.WriteSectors(sec, 5, 1);
+		memset(sec, 0xC3, sizeof sec);
+		cache.WriteSectors(sec, 6, 1);
+
+		cache.ReadSectors(sec, 5, 1);
+		AT_TEST_ASSERT(sec[0] == 0xB2 && sec[511] == 0xB2);
+
+		store.mWriteRelease.signal();
+		cache.Flush();
+
+		AT_TEST_ASSERT(store.GetSector(5)[0] == 0xB2);
+		AT_TEST_ASSERT(store.GetSector(6)[0] == 0xC3);
+
+		vdfastvector<uint8> sector5Writes;
+		for(const auto& entry : store.mWriteLog) {
+			if (entry.mLBA == 5)
+				sector5Writes.push_back(entry.mFirstByte);
+		}
+
+		AT_TEST_ASSERT(sector5Writes.size() == 2);
+		AT_TEST_ASSERT(sector5Writes[0] == 0xA1 && sector5Writes[1] == 0xB2);
+
+		// Random reads and writes against a reference copy, across more lines
+		// than the dirty line limit so that writes are throttled. Reads must
+		// always see the latest writes, and the backing store must match
+		// after a flush.
+		vdfastvector<uint8> ref(store.mData);
+		uint8 buf[16 * 512];
+
+		for(int pass = 0; pass < 4; ++pass) {
+			for(int i = 0; i < 5000; ++i) {
+				const uint32 n = 1 + rng.Next(16);
+				const uint32 lba = rng.Next(store.GetSectorCount() - n + 1);
+
+				if (rng.Next(2)) {
+					ATTestBlockDeviceCacheFill(buf, n, rng);
+					memcpy(&ref[lba * 512], buf, n * 512);
+					cache.WriteSectors(buf, lba, n);
+				} else {
+					cache.ReadSectors(buf, lba, n);
+					AT_TEST_ASSERTF(!memcmp(buf, &ref[lba * 512], n * 512), "Read mismatch at sector %u", lba);
+				}
+			}
+
+			cache.Flush();
+
+			const ATBlockDeviceCacheStats stats = cache.GetStats();
+			AT_TEST_ASSERT(stats.mDirtySectors == 0);
+			AT_TEST_ASSERT(!memcmp(store.mData.data(), ref.data(), ref.size()));
+		}
+
+		cache.Shutdown();
+	}
+
+	void ATTestBlockDeviceCacheTestErrors() {
+		ATTestBlockStore store(1024);
+		uint8 sec[512] {};
+
+		// Write-through reports errors directly and doesn't latch them.
+		{
+			ATBlockDeviceCache cache;
+			store.InitCache(cache, false);
+
+			store.mbFailWrites = true;
+
+			bool failed = false;
+			try {
+				cache.WriteSectors(sec, 10, 1);
+			} catch(const MyError&) {
+				failed = true;
+			}
+
+			AT_TEST_ASSERT(failed);
+
+			store.mbFailWrites = false;
+			cache.WriteSectors(sec, 10, 1);
+			cache.Flush();
+		}
+
+		// A failed write-behind is reported by the next flush and by every
+		// write and flush after it, even once the store recovers.
+		ATBlockDeviceCache cache;
+		store.InitCache(cache, true);
+
+		store.mbFailWrites = true;
+		cache.WriteSectors(sec, 20, 1);
+
+		const auto expectFailure = [](const auto& fn) {
+			try {
+				fn();
+			} catch(const MyError& e) {
+				AT_TEST_ASSERT(!strcmp(e.c_str(), "Simulated write failure at sector 20."));
+				return;
+			}
+
+			AT_TEST_ASSERT(!"Expected deferred write error");
+		};
+
+		expectFailure([&] { cache.Flush(); });
+
+		store.mbFailWrites = false;
+
+		expectFailure([&] { cache.WriteSectors(sec, 30, 1); });
+		expectFailure([&] { cache.Flush(); });
+
+		// reads are unaffected
+		cache.ReadSectors(sec, 0, 1);
+
+		// Shutdown eats the error.
+		cache.Shutdown();
+	}
+}
+
+AT_DEFINE_TEST(Core_BlockDeviceCache) {
+	ATTestBlockDeviceCacheTestReadAhead();
+	ATTestBlockDeviceCacheTestWriteOrdering();
+	ATTestBlockDeviceCacheTestErrors();
+
+	return 0;
+}
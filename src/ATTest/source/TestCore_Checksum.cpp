@@ -2,6 +2,7 @@
 #include <vd2/system/vdtypes.h>
 #include <vd2/system/vdstl.h>
 #include <vd2/system/cpuaccel.h>
+#include <vd2/system/zip.h>
 #include <at/atcore/checksum.h>
 #include <test.h>
 #include <stdexcept>
@@ -223,6 +224,69 @@ DEFINE_TEST(Core_Checksum) {
 			TEST_ASSERT(c == d);
 		}
 
+		// Check multi-buffer hashing against the same vectors, with a mix of
+		// lengths so that lanes both share blocks and finish separately.
+		const void *srcs[128];
+		size_t lens[128];
+		ATChecksumSHA256 multi[128];
+
+		for(int i=0; i<128; ++i) {
+			srcs[i] = buf;
+			lens[i] = (size_t)i + 1;
+		}
+
+		ATComputeChecksumsSHA256(multi, srcs, lens, 128);
+
+		for(int i=0; i<128; ++i)
+			TEST_ASSERT(multi[i] == kChecksums[i]);
+
+		// Check multi-buffer hashing with different contents in every lane,
+		// against the single-buffer path. Buffers are grouped four at a time
+		// by descending length, so each group of lengths below lands in one
+		// set of lanes: the same block count, lanes ending in different
+		// blocks, lanes ending on and just past a block boundary, and a
+		// partial group at the end.
+		static constexpr size_t kLens[] {
+			4096, 4096, 4096, 4096,
+			1000,  900,  700,  130,
+			 640,  639,  577,  576,
+			 129,  128,   64,   63,
+			  55,    1,    0
+		};
+
+		static constexpr size_t kNumLens = vdcountof(kLens);
+
+		ATTestRandom rng(0x5EED1234);
+		vdfastvector<uint8> laneData[kNumLens];
+		const void *laneSrcs[kNumLens];
+		size_t laneLens[kNumLens];
+		ATChecksumSHA256 laneMulti[kNumLens];
+
+		for(size_t i=0; i<kNumLens; ++i) {
+			laneData[i].resize(kLens[i] + 1);
+
+			for(uint8& v : laneData[i])
+				v = (uint8)rng.Next();
+
+			laneSrcs[i] = laneData[i].data();
+			laneLens[i] = kLens[i];
+		}
+
+		// hash in a shuffled order so that the length sort has work to do
+		for(size_t i=kNumLens-1; i; --i) {
+			const size_t j = rng.Next((uint32)i + 1);
+
+			std::swap(laneSrcs[i], laneSrcs[j]);
+			std::swap(laneLens[i], laneLens[j]);
+		}
+
+		for(size_t n=1; n<=kNumLens; ++n) {
+			ATComputeChecksumsSHA256(laneMulti, laneSrcs, laneLens, n);
+
+			for(size_t i=0; i<n; ++i)
+				TEST_ASSERTF(laneMulti[i] == ATComputeChecksumSHA256(laneSrcs[i], laneLens[i]), "Multi-buffer SHA-256 mismatch: buffer %u of %u, length %u", (unsigned)i, (unsigned)n, (unsigned)laneLens[i]);
+		}
+
 		AT_TEST_TRACEF("%-10s  OK", name);
 	};
 
@@ -348,6 +412,137 @@ DEFINE_TEST_NONAUTO(Core_ChecksumSpeed) {
 	return 0;
 }
 
+DEFINE_TEST_NONAUTO(Core_ChecksumSpeedMulti) {
+	// Hash 16 buffers of 64K each, one at a time and through the multi-buffer
+	// path.
+	static constexpr size_t kNumBuffers = 16;
+	static constexpr size_t kBufferSize = 65536;
+
+	vdblock<char> buf(kNumBuffers * kBufferSize);
+
+	for(size_t i=0; i<buf.size(); ++i)
+		buf[i] = (char)(i ^ (i >> 16));
+
+	const void *srcs[kNumBuffers];
+	size_t lens[kNumBuffers];
+
+	for(size_t i=0; i<kNumBuffers; ++i) {
+		srcs[i] = buf.data() + kBufferSize * i;
+		lens[i] = kBufferSize;
+	}
+
+	auto test = [&](const char *name, bool multi) {
+		CPUCoreLock coreLock;
+
+		ATChecksumSHA256 results[kNumBuffers];
+		unsigned long long tmin = ~(unsigned long long)0;
+		unsigned long long tsum = 0;
+
+		for(int j=0; j<100; ++j) {
+#ifdef VD_CPU_ARM64
+			volatile unsigned long long t1 = _ReadStatusReg(ARM64_PMCCNTR_EL0);
+#else
+			volatile unsigned long long t1 = __rdtsc();
+#endif
+
+			if (multi)
+				ATComputeChecksumsSHA256(results, srcs, lens, kNumBuffers);
+			else {
+				for(size_t i=0; i<kNumBuffers; ++i)
+					results[i] = ATComputeChecksumSHA256(srcs[i], lens[i]);
+			}
+
+#ifdef VD_CPU_ARM64
+			volatile unsigned long long t2 = _ReadStatusReg(ARM64_PMCCNTR_EL0) - t1;
+#else
+			volatile unsigned long long t2 = __rdtsc() - t1;
+#endif
+
+			if (t2 < tmin)
+				tmin = t2;
+
+			tsum += t2;
+		}
+
+		const double totalBytes = (double)(kNumBuffers * kBufferSize);
+		printf("%-16s min %.2f cpb, avg %.2f cpb\n", name, (double)tmin / totalBytes, (double)tsum / (totalBytes * 100.0));
+	};
+
+	long ex = CPUCheckForExtensions();
+
+#if VD_CPU_X86 || VD_CPU_X64
+	CPUEnableExtensions(ex & ~CPUF_SUPPORTS_SHA);
+	test("Single (no SHA)", false);
+	test("Multi (no SHA)", true);
+#endif
+
+	CPUEnableExtensions(ex);
+	test("Single", false);
+	test("Multi", true);
+
+	return 0;
+}
+
+DEFINE_TEST_NONAUTO(Core_ChecksumSpeedCRC32) {
+	vdblock<char> buf(65536);
+
+	for(int i=0; i<65536; ++i)
+		buf[i] = (char)i;
+
+	auto test = [&](const char *name) {
+		CPUCoreLock coreLock;
+
+		unsigned long long tmin = ~(unsigned long long)0;
+		unsigned long long tsum = 0;
+
+		for(int j=0; j<1000; ++j) {
+#ifdef VD_CPU_ARM64
+			volatile unsigned long long t1 = _ReadStatusReg(ARM64_PMCCNTR_EL0);
+#else
+			volatile unsigned long long t1 = __rdtsc();
+#endif
+
+			[[maybe_unused]] volatile uint32 crc = VDCRCTable::CRC32.CRC(buf.data(), buf.size());
+
+#ifdef VD_CPU_ARM64
+			volatile unsigned long long t2 = _ReadStatusReg(ARM64_PMCCNTR_EL0) - t1;
+#else
+			volatile unsigned long long t2 = __rdtsc() - t1;
+#endif
+
+			if (t2 < tmin)
+				tmin = t2;
+
+			tsum += t2;
+		}
+
+		printf("%-10s min %.2f cpb, avg %.2f cpb\n", name, (double)tmin / 65536.0, (double)tsum / 65536000.0);
+	};
+
+	long ex = CPUCheckForExtensions();
+
+#if VD_CPU_X86 || VD_CPU_X64
+	CPUEnableExtensions(ex & ~CPUF_SUPPORTS_CLMUL);
+	test("Table");
+
+	if (ex & CPUF_SUPPORTS_CLMUL) {
+		CPUEnableExtensions(ex);
+		test("CLMUL");
+	}
+#else
+	CPUEnableExtensions(ex & ~VDCPUF_SUPPORTS_CRC32);
+	test("Table");
+
+	if (ex & VDCPUF_SUPPORTS_CRC32) {
+		CPUEnableExtensions(ex);
+		test("CRC32");
+	}
+#endif
+
+	CPUEnableExtensions(ex);
+	return 0;
+}
+
 DEFINE_TEST_NONAUTO(Core_ChecksumSpeedSystem) {
 	CPUCoreLock coreLock;
 
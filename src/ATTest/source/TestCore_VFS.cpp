@@ -15,10 +15,159 @@
 //	with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdafx.h>
+#include <vd2/system/binary.h>
+#include <vd2/system/file.h>
+#include <vd2/system/text.h>
 #include <vd2/system/vdtypes.h>
+#include <vd2/system/zip.h>
 #include <at/atcore/vfs.h>
 #include <test.h>
 
+namespace {
+	vdfastvector<uint8> ATTestVFSMakeData(uint32 len, ATTestRandom& rng) {
+		vdfastvector<uint8> data(len);
+
+		for(uint8& v : data)
+			v = (uint8)rng.Next();
+
+		return data;
+	}
+
+	// Read a stream to the end in odd-sized chunks, then check that a read
+	// past the end fails.
+	vdfastvector<uint8> ATTestVFSReadStream(IVDRandomAccessStream& stream) {
+		vdfastvector<uint8> data;
+		uint8 buf[1000];
+
+		stream.Seek(0);
+
+		for(;;) {
+			const sint32 actual = stream.ReadData(buf, sizeof buf);
+			AT_TEST_ASSERT(actual >= 0 && actual <= (sint32)sizeof buf);
+
+			if (!actual)
+				break;
+
+			data.insert(data.end(), buf, buf + actual);
+		}
+
+		AT_TEST_ASSERT(stream.Pos() == stream.Length());
+		AT_TEST_ASSERT(stream.ReadData(buf, 1) == 0);
+
+		bool threw = false;
+		try {
+			stream.Read(buf, 1);
+		} catch(const MyError&) {
+			threw = true;
+		}
+
+		AT_TEST_ASSERT(threw);
+
+		// reread the tail after seeking back from the end
+		if (!data.empty()) {
+			const uint32 tailLen = std::min<uint32>((uint32)data.size(), 17);
+
+			stream.Seek(stream.Length() - tailLen);
+			stream.Read(buf, tailLen);
+			AT_TEST_ASSERT(!memcmp(buf, data.data() + data.size() - tailLen, tailLen));
+		}
+
+		return data;
+	}
+
+	// Check a view's memory view and stream against the expected contents.
+	void ATTestVFSCheckView(ATVFSFileView& view, const vdfastvector<uint8>& expected, bool expectMemoryView) {
+		AT_TEST_ASSERT(view.HasMemoryView() == expectMemoryView);
+
+		if (expectMemoryView) {
+			const vdspan<const uint8> span = view.GetMemoryView();
+
+			AT_TEST_ASSERT(span.size() == expected.size());
+			AT_TEST_ASSERT(span.empty() || !memcmp(span.data(), expected.data(), expected.size()));
+		}
+
+		AT_TEST_ASSERT(view.GetStream().Length() == (sint64)expected.size());
+		AT_TEST_ASSERT(ATTestVFSReadStream(view.GetStream()) == expected);
+	}
+
+	struct ATTestVFSZipEntry {
+		const char *mpName;
+		vdfastvector<uint8> mData;
+		uint32 mLocalExtraLen;
+	};
+
+	// Build a zip archive of stored entries. The local headers can have extra
+	// fields that the central directory doesn't, so that the data offset must
+	// come from the local header.
+	vdfastvector<uint8> ATTestVFSMakeStoredZip(const vdvector<ATTestVFSZipEntry>& entries) {
+		vdfastvector<uint8> zip;
+		vdfastvector<uint32> offsets;
+
+		const auto put16 = [&](uint32 v) { zip.push_back((uint8)v); zip.push_back((uint8)(v >> 8)); };
+		const auto put32 = [&](uint32 v) { put16(v & 0xFFFF); put16(v >> 16); };
+		const auto putName = [&](const char *s) { zip.insert(zip.end(), (const uint8 *)s, (const uint8 *)s + strlen(s)); };
+
+		for(const ATTestVFSZipEntry& e : entries) {
+			const uint32 crc = VDCRCTable::CRC32.CRC(e.mData.data(), e.mData.size());
+
+			offsets.push_back((uint32)zip.size());
+
+			put32(0x04034b50);
+			put16(10);		// version required
+			put16(0);		// flags
+			put16(0);		// method: stored
+			put16(0);		// time
+			put16(0);		// date
+			put32(crc);
+			put32((uint32)e.mData.size());
+			put32((uint32)e.mData.size());
+			put16((uint32)strlen(e.mpName));
+			put16(e.mLocalExtraLen);
+			putName(e.mpName);
+			zip.resize(zip.size() + e.mLocalExtraLen, 0);
+			zip.insert(zip.end(), e.mData.begin(), e.mData.end());
+		}
+
+		const uint32 dirStart = (uint32)zip.size();
+
+		for(size_t i = 0; i < entries.size(); ++i) {
+			const ATTestVFSZipEntry& e = entries[i];
+
+			put32(0x02014b50);
+			put16(10);		// version created
+			put16(10);		// version required
+			put16(0);		// flags
+			put16(0);		// method: stored
+			put16(0);		// time
+			put16(0);		// date
+			put32(VDCRCTable::CRC32.CRC(e.mData.data(), e.mData.size()));
+			put32((uint32)e.mData.size());
+			put32((uint32)e.mData.size());
+			put16((uint32)strlen(e.mpName));
+			put16(0);		// extra field length
+			put16(0);		// comment length
+			put16(0);		// disk number
+			put16(0);		// internal attributes
+			put32(0);		// external attributes
+			put32(offsets[i]);
+			putName(e.mpName);
+		}
+
+		const uint32 dirEnd = (uint32)zip.size();
+
+		put32(0x06054b50);
+		put16(0);
+		put16(0);
+		put16((uint32)entries.size());
+		put16((uint32)entries.size());
+		put32(dirEnd - dirStart);
+		put32(dirStart);
+		put16(0);
+
+		return zip;
+	}
+}
+
 DEFINE_TEST(Core_VFSMakePath) {
 	VDStringW s;
 
@@ -61,3 +210,82 @@ DEFINE_TEST(Core_VFSEncodePath) {
 	return 0;
 }
 
+DEFINE_TEST(Core_VFSMemoryView) {
+	ATTestTempDirectory dir;
+	ATTestRandom rng;
+
+	// Direct views of host files are mapped and must read the same as a plain
+	// file stream. Empty files can't be mapped and go through the stream.
+	static constexpr uint32 kFileSizes[] { 0, 1, 999, 1000, 4096, 65537 };
+
+	for(uint32 size : kFileSizes) {
+		const vdfastvector<uint8> data = ATTestVFSMakeData(size, rng);
+		const VDStringW path = dir.AddFile(VDStringW().sprintf(L"file%u.bin", size).c_str(), data.data(), data.size());
+
+		VDFileStream fs(path.c_str());
+		AT_TEST_ASSERT(ATTestVFSReadStream(fs) == data);
+
+		vdrefptr<ATVFSFileView> view;
+		ATVFSOpenFileView(path.c_str(), false, ~view);
+
+		ATTestVFSCheckView(*view, data, size > 0);
+		AT_TEST_ASSERT(!size || view->IsMemoryViewMapped());
+	}
+
+	// Stored zip entries in a mapped archive are referenced in place and must
+	// read the same as the inflater path. The last entry ends right at the
+	// central directory.
+	vdvector<ATTestVFSZipEntry> entries;
+	entries.push_back(ATTestVFSZipEntry { "empty.bin", {}, 0 });
+	entries.push_back(ATTestVFSZipEntry { "one.bin", ATTestVFSMakeData(1, rng), 5 });
+	entries.push_back(ATTestVFSZipEntry { "mid.bin", ATTestVFSMakeData(5000, rng), 0 });
+	entries.push_back(ATTestVFSZipEntry { "last.bin", ATTestVFSMakeData(4096, rng), 12 });
+
+	const vdfastvector<uint8> zipData = ATTestVFSMakeStoredZip(entries);
+	const VDStringW zipPath = dir.AddFile(L"test.zip", zipData.data(), zipData.size());
+
+	{
+		VDFileStream zfs(zipPath.c_str());
+		VDZipArchive zip;
+		zip.Init(&zfs);
+
+		for(const ATTestVFSZipEntry& e : entries) {
+			const sint32 idx = zip.FindFile(e.mpName);
+			AT_TEST_ASSERT(idx >= 0);
+
+			vdfastvector<uint8> streamData(e.mData.size());
+			vdautoptr<IVDInflateStream> zs { zip.OpenDecodedStream(idx) };
+
+			zs->Read(streamData.data(), (sint32)streamData.size());
+			zs->VerifyCRC();
+			AT_TEST_ASSERT(streamData == e.mData);
+
+			vdrefptr<ATVFSFileView> view;
+			ATVFSOpenFileView(ATMakeVFSPathForZipFile(zipPath.c_str(), VDTextAToW(e.mpName).c_str()).c_str(), false, ~view);
+
+			ATTestVFSCheckView(*view, streamData, true);
+			AT_TEST_ASSERT(view->IsMemoryViewMapped());
+		}
+	}
+
+	// A stored entry that fails its CRC must not be referenced in place.
+	{
+		vdfastvector<uint8> badZipData = zipData;
+		// first byte of mid.bin, after the headers and data of the first two entries
+		++badZipData[(30 + 9) + (30 + 7 + 5 + 1) + (30 + 7)];
+
+		const VDStringW badZipPath = dir.AddFile(L"bad.zip", badZipData.data(), badZipData.size());
+		vdrefptr<ATVFSFileView> view;
+		bool threw = false;
+
+		try {
+			ATVFSOpenFileView(ATMakeVFSPathForZipFile(badZipPath.c_str(), L"mid.bin").c_str(), false, ~view);
+		} catch(const MyError&) {
+			threw = true;
+		}
+
+		AT_TEST_ASSERT(threw);
+	}
+
+	return 0;
+}
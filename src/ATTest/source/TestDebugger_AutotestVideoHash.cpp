@@ -0,0 +1,105 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include "debuggerautotest.h"
+#include "gtia.h"
+#include "test.h"
+
+namespace {
+	using Mode = ATAutotestVideoHashMatcher::Mode;
+
+	ATGTIAVideoHash ATTestMakeVideoHash(uint64 seed) {
+		ATGTIAVideoHash hash {};
+
+		for(int i = 0; i < 240; ++i)
+			hash.mLineHashes[i] = seed * 0x9E3779B97F4A7C15ULL + (uint64)i;
+
+		hash.mFrameHash = seed;
+		return hash;
+	}
+}
+
+AT_DEFINE_TEST(Debugger_AutotestVideoHash) {
+	const ATGTIAVideoHash frameA = ATTestMakeVideoHash(0x1111);
+	const ATGTIAVideoHash frameB = ATTestMakeVideoHash(0x2222);
+
+	// check completes on the first frame and never fails
+	{
+		ATAutotestVideoHashMatcher m(Mode::Check, 0, -1, false);
+
+		AT_TEST_ASSERT(!m.IsCompleted());
+		AT_TEST_ASSERT(m.OnHash(frameA));
+		AT_TEST_ASSERT(m.IsCompleted() && !m.IsFailed());
+		AT_TEST_ASSERT(!m.OnHash(frameB));
+	}
+
+	// wait keeps going through mismatches and completes on a match
+	{
+		ATAutotestVideoHashMatcher m(Mode::Wait, frameB.mFrameHash, -1, false);
+
+		AT_TEST_ASSERT(!m.OnHash(frameA));
+		AT_TEST_ASSERT(!m.OnHash(frameA));
+		AT_TEST_ASSERT(!m.IsCompleted() && !m.IsFailed());
+
+		AT_TEST_ASSERT(m.OnHash(frameB));
+		AT_TEST_ASSERT(m.IsCompleted() && !m.IsFailed());
+		AT_TEST_ASSERT(!m.OnHash(frameA));
+	}
+
+	// wait on a single line, where only that line matches
+	{
+		ATGTIAVideoHash frameC = frameA;
+		frameC.mLineHashes[92] = frameB.mLineHashes[92];
+
+		ATAutotestVideoHashMatcher m(Mode::Wait, frameB.mLineHashes[92], 92, false);
+
+		AT_TEST_ASSERT(!m.OnHash(frameA));
+		AT_TEST_ASSERT(m.OnHash(frameC));
+		AT_TEST_ASSERT(m.IsCompleted() && !m.IsFailed());
+	}
+
+	// assert passes on a match
+	{
+		ATAutotestVideoHashMatcher m(Mode::Assert, frameA.mFrameHash, -1, false);
+
+		AT_TEST_ASSERT(m.OnHash(frameA));
+		AT_TEST_ASSERT(m.IsCompleted() && !m.IsFailed());
+	}
+
+	// assert fails on the first mismatching frame, and the failure sticks
+	{
+		ATAutotestVideoHashMatcher m(Mode::Assert, frameA.mFrameHash, -1, false);
+
+		AT_TEST_ASSERT(m.OnHash(frameB));
+		AT_TEST_ASSERT(m.IsCompleted() && m.IsFailed());
+		AT_TEST_ASSERT(!strcmp(m.GetFailureMessage(), "Assertion failed: video hash is 0000000000002222, expected 0000000000001111"));
+
+		AT_TEST_ASSERT(!m.OnHash(frameA));
+		AT_TEST_ASSERT(m.IsFailed());
+	}
+
+	// line assert failures report the scanline
+	{
+		ATAutotestVideoHashMatcher m(Mode::Assert, frameA.mLineHashes[0], 0, false);
+
+		AT_TEST_ASSERT(m.OnHash(frameB));
+		AT_TEST_ASSERT(m.IsFailed());
+		AT_TEST_ASSERT(!strncmp(m.GetFailureMessage(), "Assertion failed: video hash for line 8 is ", 43));
+	}
+
+	return 0;
+}
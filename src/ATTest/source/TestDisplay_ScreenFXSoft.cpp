@@ -0,0 +1,209 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/cpuaccel.h>
+#include <vd2/system/time.h>
+#include <vd2/Kasumi/pixmaputils.h>
+#include <vd2/VDDisplay/display.h>
+#include <vd2/VDDisplay/screenfxsoft.h>
+#include "test.h"
+
+namespace {
+	constexpr uint32 kATTestSoftFXMaxRows = 12;
+	constexpr uint32 kATTestSoftFXMaxLen = 64;
+
+	// Scalar reference for the vertical filter kernel, accumulating in the
+	// same order as the vector versions.
+	void ATTestSoftFXSumRowsRef(float *dst, const float *const *rows, const float *weights, uint32 numRows, uint32 n) {
+		for(uint32 i = 0; i < n; ++i) {
+			float sum = rows[0][i] * weights[0];
+
+			for(uint32 k = 1; k < numRows; ++k)
+				sum = sum + rows[k][i] * weights[k];
+
+			dst[i] = sum;
+		}
+	}
+
+	void ATTestSoftFXTestSumRows(const char *extName) {
+		const VDDisplayScreenFXSoft::SumRowsFn sumRows = VDDisplayScreenFXSoft::GetSumRowsFn();
+
+		ATTestRandom rng;
+		float src[kATTestSoftFXMaxRows][kATTestSoftFXMaxLen];
+		float weights[kATTestSoftFXMaxRows];
+		float ref[kATTestSoftFXMaxLen];
+		float test[kATTestSoftFXMaxLen];
+		const float *rows[kATTestSoftFXMaxRows];
+
+		for(uint32 numRows = 1; numRows <= kATTestSoftFXMaxRows; ++numRows) {
+			for(uint32 n = 4; n <= kATTestSoftFXMaxLen; n += 4) {
+				for(uint32 k = 0; k < kATTestSoftFXMaxRows; ++k) {
+					for(float& v : src[k])
+						v = (float)rng.Next(0x10000) * (1.0f / 0x8000);
+
+					weights[k] = (float)(sint32)rng.Next(0x10000) * (1.0f / 0x10000) - 0.5f;
+					rows[k] = src[k];
+				}
+
+				ATTestSoftFXSumRowsRef(ref, rows, weights, numRows, n);
+
+				sumRows(test, rows, weights, numRows, n);
+				AT_TEST_ASSERTF(!memcmp(ref, test, n * sizeof(float)), "%s: mismatch (%u rows, length %u)", extName, numRows, n);
+
+				// The destination may alias the last row, as in the upsampling
+				// pass.
+				float *const aliased = src[numRows - 1];
+				sumRows(aliased, rows, weights, numRows, n);
+				AT_TEST_ASSERTF(!memcmp(ref, aliased, n * sizeof(float)), "%s: aliased mismatch (%u rows, length %u)", extName, numRows, n);
+			}
+		}
+	}
+
+	VDVideoDisplayScreenFXInfo ATTestSoftFXMakeParams(bool distortion, bool bloom) {
+		VDVideoDisplayScreenFXInfo fx {};
+		fx.mDistortionX = distortion ? 60.0f : 0.0f;
+		fx.mDistortionYRatio = 0.5f;
+		fx.mbBloomEnabled = bloom;
+		fx.mBloomRadius = 8.0f;
+		fx.mBloomDirectIntensity = 0.80f;
+		fx.mBloomIndirectIntensity = 0.40f;
+
+		return fx;
+	}
+
+	void ATTestSoftFXFillSource(VDPixmapBuffer& src, ATTestRandom& rng) {
+		for(sint32 y = 0; y < src.h; ++y) {
+			uint32 *row = (uint32 *)((char *)src.data + src.pitch * y);
+			uint32 c = rng.Next() & 0xFFFFFF;
+
+			for(sint32 x = 0; x < src.w; ++x) {
+				if (!rng.Next(8))
+					c = rng.Next() & 0xFFFFFF;
+
+				row[x] = c;
+			}
+		}
+	}
+
+	void ATTestSoftFXRender(VDPixmapBuffer& dst, const VDPixmap& src, uint32 dstw, uint32 dsth, const VDVideoDisplayScreenFXInfo& fx) {
+		VDDisplayScreenFXSoft softfx;
+
+		softfx.Apply(dst, src, dstw, dsth, (float)dstw / (float)dsth, fx);
+	}
+}
+
+AT_DEFINE_TEST(Display_ScreenFXSoft) {
+	const long ex = CPUCheckForExtensions();
+
+#if VD_CPU_X86 || VD_CPU_X64
+	const long exNoAVX2 = ex & ~CPUF_SUPPORTS_AVX2;
+#else
+	const long exNoAVX2 = ex;
+#endif
+
+	// kernel against the scalar reference, with and without AVX2
+	CPUEnableExtensions(exNoAVX2);
+	ATTestSoftFXTestSumRows("Vector");
+
+	if (ex != exNoAVX2) {
+		CPUEnableExtensions(ex);
+		ATTestSoftFXTestSumRows("AVX2");
+	}
+
+	// The whole pipeline must give the same image regardless of the kernel
+	// used, including for odd sizes that leave a 4-float tail in the AVX2
+	// kernel.
+	ATTestRandom rng;
+	VDPixmapBuffer src(61, 47, nsVDPixmap::kPixFormat_XRGB8888);
+	ATTestSoftFXFillSource(src, rng);
+
+	static constexpr struct {
+		bool mbDistortion;
+		bool mbBloom;
+		uint32 mWidth;
+		uint32 mHeight;
+	} kCases[] {
+		{ true,  false, 150, 101 },
+		{ false, true,  150, 101 },
+		{ true,  true,  150, 101 },
+		{ true,  true,  61,  47 },
+		{ false, true,  61,  47 },
+	};
+
+	for(const auto& c : kCases) {
+		const VDVideoDisplayScreenFXInfo fx = ATTestSoftFXMakeParams(c.mbDistortion, c.mbBloom);
+		VDPixmapBuffer ref;
+		VDPixmapBuffer test;
+
+		CPUEnableExtensions(exNoAVX2);
+		ATTestSoftFXRender(ref, src, c.mWidth, c.mHeight, fx);
+
+		CPUEnableExtensions(ex);
+		ATTestSoftFXRender(test, src, c.mWidth, c.mHeight, fx);
+
+		AT_TEST_ASSERT(ref.w == (sint32)c.mWidth && ref.h == (sint32)c.mHeight);
+		AT_TEST_ASSERT(test.w == ref.w && test.h == ref.h);
+
+		for(sint32 y = 0; y < ref.h; ++y) {
+			AT_TEST_ASSERTF(!memcmp((const char *)ref.data + ref.pitch * y, (const char *)test.data + test.pitch * y, ref.w * 4),
+				"Mismatch: distortion %d, bloom %d, %ux%u, row %d", c.mbDistortion, c.mbBloom, c.mWidth, c.mHeight, y);
+		}
+	}
+
+	CPUEnableExtensions(ex);
+	return 0;
+}
+
+AT_DEFINE_TEST_NONAUTO(Display_ScreenFXSoftBench) {
+	// Typical source size for a PAL frame with overscan, rendered to a 1080p
+	// output area.
+	ATTestRandom rng;
+	VDPixmapBuffer src(376, 288, nsVDPixmap::kPixFormat_XRGB8888);
+	ATTestSoftFXFillSource(src, rng);
+
+	static constexpr struct {
+		const char *mpName;
+		bool mbDistortion;
+		bool mbBloom;
+	} kCases[] {
+		{ "Distortion        ", true,  false },
+		{ "Bloom             ", false, true  },
+		{ "Distortion + bloom", true,  true  },
+	};
+
+	VDDisplayScreenFXSoft softfx;
+	VDPixmapBuffer dst;
+
+	for(const auto& c : kCases) {
+		static constexpr int kFrames = 120;
+		const VDVideoDisplayScreenFXInfo fx = ATTestSoftFXMakeParams(c.mbDistortion, c.mbBloom);
+
+		// warm up the distortion map and buffers
+		softfx.Apply(dst, src, 1920, 1080, 16.0f / 9.0f, fx);
+
+		const uint64 t0 = VDGetPreciseTick();
+
+		for(int i = 0; i < kFrames; ++i)
+			softfx.Apply(dst, src, 1920, 1080, 16.0f / 9.0f, fx);
+
+		const double t = (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick() / (double)kFrames;
+
+		printf("%s: %6.2fms/frame at 1920x1080 (%.0f fps)\n", c.mpName, t * 1e+3, 1.0 / t);
+	}
+
+	return 0;
+}
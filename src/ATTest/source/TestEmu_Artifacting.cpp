@@ -0,0 +1,170 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/vdalloc.h>
+#include "artifacting.h"
+#include "gtia.h"
+#include "test.h"
+
+namespace {
+	constexpr uint32 kATTestArtifactY1 = 8;
+	constexpr uint32 kATTestArtifactY2 = 248;
+	constexpr uint32 kATTestArtifactSplitY = 131;
+	constexpr uint32 N = ATArtifactingEngine::N;
+	constexpr uint32 M = ATArtifactingEngine::M;
+
+	struct ATTestArtifactFrame {
+		uint8 mSrc8[M][N];
+		uint32 mSrc32[M][N*2];
+		bool mbHiRes[M];
+
+		VDALIGN(16) uint32 mDst[M][N*2];
+	};
+
+	struct ATTestArtifactMode {
+		bool mbPAL;
+		bool mbChroma;
+		bool mbChromaHi;
+		bool mb32;
+	};
+
+	void ATTestArtifactFill(ATTestArtifactFrame& frame, ATTestRandom& rng) {
+		// Runs of the same color with occasional changes, more like real
+		// playfield data than noise and with plenty of chroma transitions
+		// between scanlines.
+		for(uint32 y = 0; y < M; ++y) {
+			uint8 c = (uint8)rng.Next();
+
+			for(uint32 x = 0; x < N; ++x) {
+				if (!rng.Next(8))
+					c = (uint8)rng.Next();
+
+				frame.mSrc8[y][x] = c;
+			}
+
+			for(uint32 x = 0; x < N*2; ++x)
+				frame.mSrc32[y][x] = rng.Next();
+
+			frame.mbHiRes[y] = (rng.Next() & 1) != 0;
+		}
+	}
+
+	void ATTestArtifactBeginFrame(ATArtifactingEngine& ae, const ATTestArtifactMode& mode, bool blend) {
+		ae.BeginFrame(mode.mbPAL, mode.mbChroma, mode.mbChromaHi, blend, blend, false, false, false, false, false, false);
+	}
+
+	// Artifact scanlines one at a time through the engine's own delay line,
+	// as GTIA did before banding.
+	void ATTestArtifactSequential(ATArtifactingEngine& ae, ATTestArtifactFrame& frame, const ATTestArtifactMode& mode) {
+		for(uint32 y = kATTestArtifactY1; y < kATTestArtifactY2; ++y) {
+			if (mode.mb32) {
+				memcpy(frame.mDst[y], frame.mSrc32[y], sizeof frame.mDst[y]);
+				ae.Artifact32(y, frame.mDst[y], N*2, false, false);
+			} else
+				ae.Artifact8(y, frame.mDst[y], frame.mSrc8[y], frame.mbHiRes[y], false, false);
+		}
+	}
+
+	// Artifact in bands the same way as GTIA, with the frame split into two
+	// calls so that the second continues from the delay line left by the
+	// first.
+	void ATTestArtifactBanded(ATArtifactingEngine& ae, ATTestArtifactFrame& frame, const ATTestArtifactMode& mode) {
+		const auto run = [&](uint32 y1, uint32 y2) {
+			if (mode.mb32) {
+				// in place, as for VBXE and 14MHz output
+				for(uint32 y = y1; y < y2; ++y)
+					memcpy(frame.mDst[y], frame.mSrc32[y], sizeof frame.mDst[y]);
+
+				ae.ForEachBand(y1, y2,
+					[&](uint32 y, ATArtifactingEngine::DelayLine& delayLine) {
+						ae.PrimeDelayLine32(frame.mDst[y], N*2, delayLine);
+					},
+					[&](uint32 band1, uint32 band2, ATArtifactingEngine::DelayLine& delayLine) {
+						for(uint32 y = band1; y < band2; ++y)
+							ae.Artifact32(y, frame.mDst[y], N*2, false, false, delayLine);
+					}
+				);
+			} else {
+				ae.ForEachBand(y1, y2,
+					[&](uint32 y, ATArtifactingEngine::DelayLine& delayLine) {
+						ae.PrimeDelayLine8(y, frame.mSrc8[y], frame.mbHiRes[y], delayLine);
+					},
+					[&](uint32 band1, uint32 band2, ATArtifactingEngine::DelayLine& delayLine) {
+						for(uint32 y = band1; y < band2; ++y)
+							ae.Artifact8(y, frame.mDst[y], frame.mSrc8[y], frame.mbHiRes[y], false, false, delayLine);
+					}
+				);
+			}
+		};
+
+		run(kATTestArtifactY1, kATTestArtifactSplitY);
+		run(kATTestArtifactSplitY, kATTestArtifactY2);
+	}
+}
+
+AT_DEFINE_TEST(Emu_Artifacting) {
+	static constexpr ATTestArtifactMode kModes[] {
+		{ false, false, false, false },
+		{ false, true,  false, false },
+		{ false, true,  true,  false },
+		{ true,  false, false, false },
+		{ true,  true,  false, false },
+		{ true,  true,  true,  false },
+		{ true,  true,  false, true  },
+		{ false, false, false, true  },
+	};
+
+	ATTestRandom rng;
+	vdautoptr<ATTestArtifactFrame> frame(new ATTestArtifactFrame);
+	vdautoptr<ATTestArtifactFrame> refFrame(new ATTestArtifactFrame);
+
+	for(const ATTestArtifactMode& mode : kModes) {
+		for(uint32 bandCount : { 2, 3, 8 }) {
+			vdautoptr<ATArtifactingEngine> refEngine(new ATArtifactingEngine);
+			vdautoptr<ATArtifactingEngine> engine(new ATArtifactingEngine);
+
+			for(ATArtifactingEngine *ae : { refEngine.get(), engine.get() }) {
+				ae->SetColorParams(ATGetColorPresetByIndex(0), nullptr, nullptr, ATMonitorMode::Color, 0);
+				ae->SetForcedBandCount(bandCount);
+			}
+
+			// Two frames, the second blended with the first, so that the frame
+			// history is covered as well.
+			for(int frameIndex = 0; frameIndex < 2; ++frameIndex) {
+				ATTestArtifactFill(*frame, rng);
+				memset(frame->mDst, 0, sizeof frame->mDst);
+				memcpy(refFrame.get(), frame.get(), sizeof *frame);
+
+				ATTestArtifactBeginFrame(*refEngine, mode, frameIndex > 0);
+				ATTestArtifactSequential(*refEngine, *refFrame, mode);
+
+				ATTestArtifactBeginFrame(*engine, mode, frameIndex > 0);
+				ATTestArtifactBanded(*engine, *frame, mode);
+
+				const uint32 w = mode.mb32 || mode.mbChromaHi ? N*2 : N;
+
+				for(uint32 y = kATTestArtifactY1; y < kATTestArtifactY2; ++y) {
+					AT_TEST_ASSERTF(!memcmp(frame->mDst[y], refFrame->mDst[y], w * sizeof(uint32)),
+						"Mismatch: PAL %d, chroma %d, hi %d, 32-bit %d, %u bands, frame %d, row %u",
+						mode.mbPAL, mode.mbChroma, mode.mbChromaHi, mode.mb32, bandCount, frameIndex, y);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
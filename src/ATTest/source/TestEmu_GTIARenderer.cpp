@@ -0,0 +1,560 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/time.h>
+#include <vd2/system/vdalloc.h>
+#include "gtiarenderer.h"
+#include "test.h"
+
+namespace {
+	// Line buffers are laid out like GTIA's, with the alignment the renderer
+	// requires for its vector paths.
+	struct ATTestGTIALine {
+		VDALIGN(16) uint8 mMerge[ATGTIARenderer::kLineBufferSize];
+		VDALIGN(16) uint8 mAntic[ATGTIARenderer::kLineBufferSize];
+		VDALIGN(16) uint8 mOutput[456];
+		uint8 mPRIOR;
+		bool mbHires;
+		bool mbPMGraphics;
+	};
+
+	constexpr int kATTestGTIALineStart = 34;
+	constexpr int kATTestGTIALineEnd = 222;
+
+	// Fill the playfield as ANTIC would for the line's mode: BAK/PF2 with
+	// PF1 luma bits in hires, one playfield color per clock in lores, and
+	// two-bit pixel pairs in the GTIA modes.
+	void ATTestGTIAFillPlayfield(ATTestGTIALine& line, ATTestRandom& rng) {
+		static constexpr uint8 kLoresPF[] { 0, ATGTIA::PF0, ATGTIA::PF1, ATGTIA::PF2, ATGTIA::PF3 };
+
+		memset(line.mMerge, 0, sizeof line.mMerge);
+		memset(line.mAntic, 0, sizeof line.mAntic);
+
+		for(int x = kATTestGTIALineStart; x < kATTestGTIALineEnd; ++x) {
+			if (line.mbHires) {
+				line.mAntic[x] = (uint8)rng.Next(4);
+				line.mMerge[x] = ATGTIA::PF2;
+			} else if (line.mPRIOR & 0xC0) {
+				line.mAntic[x] = (uint8)rng.Next(4);
+			} else {
+				line.mMerge[x] = kLoresPF[rng.Next(5)];
+			}
+		}
+	}
+
+	// Fill a mixed line, where PRIOR switches the GTIA modes on or off mid-line.
+	// ANTIC keeps sending data in its own mode, so like ATGTIAEmulator::SyncTo(),
+	// convert the line buffers wherever GTIA's mode doesn't match ANTIC's and
+	// replace the playfield bits in the GTIA modes. Turning on a GTIA mode also
+	// ends hires mode for the rest of the line. GTIA sees each change one clock
+	// after the renderer does.
+	void ATTestGTIAFillMixedPlayfield(ATTestGTIALine& line, bool anticHires, const uint8 (*changes)[2], uint32 numChanges, ATTestRandom& rng) {
+		static constexpr uint8 kPFTable[4] { ATGTIA::PF0, ATGTIA::PF1, ATGTIA::PF2, ATGTIA::PF3 };
+		static constexpr uint8 kPriTable[16] { 0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3 };
+
+		const uint8 initialPRIOR = line.mPRIOR;
+
+		line.mbHires = anticHires;
+		line.mPRIOR = 0;
+		ATTestGTIAFillPlayfield(line, rng);
+
+		line.mPRIOR = initialPRIOR;
+		line.mbHires = anticHires && !(initialPRIOR & 0xC0);
+
+		uint8 *const merge = line.mMerge;
+		uint8 *const antic = line.mAntic;
+		const auto convert = [=](int x) {
+			if (anticHires) {
+				if (merge[x] & ATGTIA::PF2)
+					merge[x] = (uint8)(1 << antic[x]);
+			} else
+				antic[x] = kPriTable[merge[x]];
+		};
+
+		uint8 prior = initialPRIOR;
+		bool hires = line.mbHires;
+		bool converted = false;
+		uint32 changeIndex = 0;
+
+		for(int x = kATTestGTIALineStart; x < kATTestGTIALineEnd; ++x) {
+			while(changeIndex < numChanges && changes[changeIndex][0] < x) {
+				prior = changes[changeIndex++][1];
+
+				if (prior & 0xC0)
+					hires = false;
+			}
+
+			if ((hires || (prior & 0xC0)) != anticHires) {
+				// the first conversion starts a clock early for mode 8 -> 10
+				if (!converted) {
+					converted = true;
+
+					if (x > kATTestGTIALineStart)
+						convert(x - 1);
+				}
+
+				convert(x);
+			}
+
+			switch(prior & 0xC0) {
+				case 0x80:
+					{
+						const int pairStart = (x - 1) & ~1;
+						const uint8 c = (uint8)(antic[pairStart] * 4 + antic[pairStart + 1]);
+						const uint8 pf = c & 4 ? kPFTable[c & 3] : 0;
+
+						merge[x] = anticHires || merge[x] ? pf : 0;
+					}
+					break;
+
+				case 0x40:
+				case 0xC0:
+					merge[x] = 0;
+					break;
+			}
+		}
+	}
+
+	// Merge a player or missile image into the line. The bits may include PF3
+	// for the fifth player.
+	void ATTestGTIAAddObject(ATTestGTIALine& line, int x, int w, uint8 bits) {
+		for(int i = 0; i < w && x + i < kATTestGTIALineEnd; ++i)
+			line.mMerge[x + i] |= bits;
+
+		line.mbPMGraphics = true;
+	}
+
+	void ATTestGTIARenderLine(ATGTIARenderer& r, ATTestGTIALine& line, bool split, bool mixed = false, const uint8 (*priorChanges)[2] = nullptr, uint32 numPRIORChanges = 0) {
+		r.SetPMSpanSplitting(split);
+		r.SetRegisterImmediate(0x1B, line.mPRIOR);
+		r.BeginScanline(-1, line.mOutput, line.mMerge, line.mAntic, line.mbHires);
+
+		for(uint32 i = 0; i < numPRIORChanges; ++i)
+			r.AddRegisterChange(priorChanges[i][0], 0x1B, priorChanges[i][1]);
+
+		r.RenderScanline(kATTestGTIALineEnd, true, line.mbPMGraphics, mixed);
+		r.EndScanline();
+	}
+
+	void ATTestGTIAInitRenderer(ATGTIARenderer& r, ATTestRandom& rng) {
+		r.SetVBlank(false);
+
+		for(uint8 reg = 0x12; reg <= 0x1A; ++reg)
+			r.SetRegisterImmediate(reg, (uint8)(rng.Next() & 0xFE));
+	}
+}
+
+AT_DEFINE_TEST(Emu_GTIARenderer) {
+	ATTestRandom rng;
+	vdautoptr<ATGTIARenderer> r(new ATGTIARenderer);
+	vdautoptr<ATTestGTIALine> line(new ATTestGTIALine);
+	VDALIGN(16) uint8 refOutput[456];
+	uint8 priorChanges[3][2];
+
+	for(int i = 0; i < 20000; ++i) {
+		if (!(i % 100))
+			ATTestGTIAInitRenderer(*r, rng);
+
+		r->SetSECAMMode(rng.Next(8) == 0);
+
+		line->mPRIOR = (uint8)rng.Next();
+		line->mbPMGraphics = false;
+
+		// Some lines are mixed, with PRIOR switching GTIA modes and hires
+		// mode off mid-line.
+		const bool mixed = rng.Next(4) == 0;
+		uint32 numPRIORChanges = 0;
+
+		if (mixed) {
+			int x = kATTestGTIALineStart;
+
+			for(;;) {
+				x += 1 + rng.Next(80);
+				if (x >= kATTestGTIALineEnd || numPRIORChanges >= vdcountof(priorChanges))
+					break;
+
+				priorChanges[numPRIORChanges][0] = (uint8)x;
+				priorChanges[numPRIORChanges][1] = (uint8)rng.Next();
+				++numPRIORChanges;
+			}
+
+			ATTestGTIAFillMixedPlayfield(*line, (rng.Next() & 1) != 0, priorChanges, numPRIORChanges, rng);
+		} else {
+			line->mbHires = !(line->mPRIOR & 0xC0) && (rng.Next() & 1);
+
+			ATTestGTIAFillPlayfield(*line, rng);
+		}
+
+		const uint32 numObjects = rng.Next(6);
+		for(uint32 j = 0; j < numObjects; ++j) {
+			uint8 bits = (uint8)(0x10 << rng.Next(4));
+
+			// fifth player
+			if (rng.Next(4) == 0)
+				bits |= ATGTIA::PF3;
+
+			ATTestGTIAAddObject(*line, kATTestGTIALineStart + rng.Next(kATTestGTIALineEnd - kATTestGTIALineStart), 1 + rng.Next(32), bits);
+		}
+
+		ATTestGTIARenderLine(*r, *line, false, mixed, priorChanges, numPRIORChanges);
+		memcpy(refOutput, line->mOutput, sizeof refOutput);
+
+		ATTestGTIARenderLine(*r, *line, true, mixed, priorChanges, numPRIORChanges);
+
+		for(int x = 0; x < kATTestGTIALineEnd * 2; ++x)
+			AT_TEST_ASSERTF(refOutput[x] == line->mOutput[x], "Output mismatch: PRIOR %02X, hires %d, PRIOR changes %u, objects %u, offset %d", line->mPRIOR, line->mbHires, numPRIORChanges, numObjects, x);
+	}
+
+	return 0;
+}
+
+AT_DEFINE_TEST_NONAUTO(Emu_GTIARendererBench) {
+	struct BenchCase {
+		const char *mpName;
+		uint8 mPRIOR;
+		bool mbHires;
+	};
+
+	static constexpr BenchCase kCases[] {
+		{ "ANTIC 2 (hires)  ", 0x01, true },
+		{ "ANTIC E (lores)  ", 0x01, false },
+		{ "GTIA 9           ", 0x41, false },
+		{ "GTIA 10          ", 0x81, false },
+		{ "GTIA 11          ", 0xC1, false },
+	};
+
+	ATTestRandom rng;
+	vdautoptr<ATGTIARenderer> r(new ATGTIARenderer);
+	vdautoptr<ATTestGTIALine> line(new ATTestGTIALine);
+
+	ATTestGTIAInitRenderer(*r, rng);
+
+	for(const BenchCase& bc : kCases) {
+		line->mPRIOR = bc.mPRIOR;
+		line->mbHires = bc.mbHires;
+		line->mbPMGraphics = false;
+
+		ATTestGTIAFillPlayfield(*line, rng);
+
+		const auto timeLine = [&](bool split) {
+			static constexpr int kIterations = 200000;
+
+			const uint64 t0 = VDGetPreciseTick();
+
+			for(int i = 0; i < kIterations; ++i)
+				ATTestGTIARenderLine(*r, *line, split);
+
+			return (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick() / (double)kIterations;
+		};
+
+		const double tNoPM = timeLine(true);
+
+		// typical sprite usage: two double-width players and a missile
+		ATTestGTIAAddObject(*line, 80, 16, ATGTIA::P0);
+		ATTestGTIAAddObject(*line, 140, 16, ATGTIA::P1);
+		ATTestGTIAAddObject(*line, 100, 2, ATGTIA::P2);
+
+		const double tFull = timeLine(false);
+		const double tSplit = timeLine(true);
+
+		printf("%s: no P/M %6.1fns, P/M full %6.1fns, P/M split %6.1fns (%.2fx)\n", bc.mpName, tNoPM * 1e+9, tFull * 1e+9, tSplit * 1e+9, tFull / tSplit);
+	}
+
+	return 0;
+}
+
+namespace {
+	// A line as it is fed to the renderer each frame for the line cache tests,
+	// including mid-line register changes. Lines stay the same from frame to
+	// frame unless mutated, so most of them are served from the cache.
+	struct ATTestGTIACacheLine {
+		ATTestGTIALine mLine;
+		uint8 mChanges[6][3];
+		uint32 mNumChanges;
+		bool mbPFGraphics;
+		bool mbMixed;
+		bool mbVBlank;
+		bool mbSplitRender;
+	};
+
+	// Add a change to colors or PRIOR, possibly at or past the end of the
+	// render where it is only committed by EndScanline(). GTIA converts the
+	// line buffers and flags the line as mixed when PRIOR switches in or out
+	// of the GTIA modes, so a line with a PRIOR change is always mixed.
+	void ATTestGTIAAddCacheLineChange(ATTestGTIACacheLine& cl, ATTestRandom& rng) {
+		uint8 (&change)[3] = cl.mChanges[cl.mNumChanges++];
+
+		change[0] = (uint8)rng.Next(kATTestGTIALineEnd + 8);
+		change[1] = (uint8)(0x12 + rng.Next(10));
+		change[2] = (uint8)rng.Next();
+
+		if (change[1] == 0x1B)
+			cl.mbMixed = true;
+	}
+
+	bool ATTestGTIAHasPRIORChange(const ATTestGTIACacheLine& cl) {
+		for(uint32 i = 0; i < cl.mNumChanges; ++i) {
+			if (cl.mChanges[i][1] == 0x1B)
+				return true;
+		}
+
+		return false;
+	}
+
+	void ATTestGTIARandomizeCacheLine(ATTestGTIACacheLine& cl, ATTestRandom& rng) {
+		ATTestGTIALine& line = cl.mLine;
+
+		line.mPRIOR = (uint8)rng.Next();
+		line.mbHires = !(line.mPRIOR & 0xC0) && (rng.Next() & 1);
+		line.mbPMGraphics = false;
+
+		ATTestGTIAFillPlayfield(line, rng);
+
+		const uint32 numObjects = rng.Next(4);
+		for(uint32 j = 0; j < numObjects; ++j)
+			ATTestGTIAAddObject(line, kATTestGTIALineStart + rng.Next(kATTestGTIALineEnd - kATTestGTIALineStart), 1 + rng.Next(32), (uint8)(0x10 << rng.Next(4)));
+
+		cl.mbMixed = rng.Next(4) == 0;
+		cl.mNumChanges = 0;
+
+		const uint32 numChanges = rng.Next(4) ? rng.Next(4) : 0;
+		for(uint32 j = 0; j < numChanges; ++j)
+			ATTestGTIAAddCacheLineChange(cl, rng);
+
+		cl.mbPFGraphics = rng.Next(8) != 0;
+		cl.mbVBlank = rng.Next(16) == 0;
+		cl.mbSplitRender = rng.Next(16) == 0;
+	}
+
+	// Render a line with the line cache in use if y is non-negative.
+	void ATTestGTIARenderCacheLine(ATGTIARenderer& r, const ATTestGTIACacheLine& cl, int y, uint8 *dst) {
+		const ATTestGTIALine& line = cl.mLine;
+
+		r.SetVBlank(cl.mbVBlank);
+		r.SetRegisterImmediate(0x1B, line.mPRIOR);
+		r.BeginScanline(y, dst, line.mMerge, line.mAntic, line.mbHires);
+
+		for(uint32 i = 0; i < cl.mNumChanges; ++i)
+			r.AddRegisterChange(cl.mChanges[i][0], cl.mChanges[i][1], cl.mChanges[i][2]);
+
+		// A line rendered in pieces, as for an immediate screen update, must
+		// bypass the cache.
+		if (cl.mbSplitRender)
+			r.RenderScanline(100, cl.mbPFGraphics, line.mbPMGraphics, cl.mbMixed);
+
+		r.RenderScanline(kATTestGTIALineEnd, cl.mbPFGraphics, line.mbPMGraphics, cl.mbMixed);
+		r.EndScanline();
+	}
+}
+
+AT_DEFINE_TEST(Emu_GTIARendererCache) {
+	static constexpr int kLines = 64;
+	static constexpr int kFrames = 300;
+
+	ATTestRandom rng;
+	vdautoptr<ATGTIARenderer> rc(new ATGTIARenderer);
+	vdautoptr<ATGTIARenderer> ru(new ATGTIARenderer);
+	vdautoarrayptr<ATTestGTIACacheLine> lines(new ATTestGTIACacheLine[kLines]);
+	VDALIGN(16) uint8 cachedOutput[456];
+	VDALIGN(16) uint8 uncachedOutput[456];
+
+	for(int y = 0; y < kLines; ++y)
+		ATTestGTIARandomizeCacheLine(lines[y], rng);
+
+	for(int frame = 0; frame < kFrames; ++frame) {
+		// Occasionally change state that applies to the whole frame. The
+		// renderers see identical inputs, so any difference in output or in
+		// the register state left for later lines is a cache bug.
+		if (frame % 50 == 0) {
+			for(uint8 reg = 0x12; reg <= 0x1A; ++reg) {
+				const uint8 v = (uint8)(rng.Next() & 0xFE);
+
+				rc->SetRegisterImmediate(reg, v);
+				ru->SetRegisterImmediate(reg, v);
+			}
+		}
+
+		const bool secam = (frame / 30) % 4 == 3;
+		rc->SetSECAMMode(secam);
+		ru->SetSECAMMode(secam);
+
+		const bool analysis = frame % 40 == 39;
+		rc->SetAnalysisMode(analysis);
+		ru->SetAnalysisMode(analysis);
+
+		// Mutate a few lines, either completely or in just one input. The
+		// inputs are kept to what GTIA can produce, as the fast renderers
+		// don't handle P/M data on lines without P/M graphics or playfield
+		// data in unmixed GTIA mode lines.
+		const uint32 numMutations = rng.Next(4);
+		for(uint32 i = 0; i < numMutations; ++i) {
+			ATTestGTIACacheLine& cl = lines[rng.Next(kLines)];
+			ATTestGTIALine& line = cl.mLine;
+
+			switch(rng.Next(9)) {
+				case 0:
+					ATTestGTIARandomizeCacheLine(cl, rng);
+					break;
+
+				case 1:
+					{
+						const int x = kATTestGTIALineStart + rng.Next(kATTestGTIALineEnd - kATTestGTIALineStart);
+
+						if (line.mbHires || (line.mPRIOR & 0xC0))
+							line.mAntic[x] ^= (uint8)(1 + rng.Next(3));
+						else
+							line.mMerge[x] = (line.mMerge[x] & 0xF0) + (line.mMerge[x] & 0x0F ? 0 : ATGTIA::PF1);
+					}
+					break;
+
+				case 2:
+					if (cl.mNumChanges)
+						cl.mChanges[rng.Next(cl.mNumChanges)][2] ^= (uint8)(1 << rng.Next(8));
+					break;
+
+				case 3:
+					if (cl.mNumChanges < vdcountof(cl.mChanges))
+						ATTestGTIAAddCacheLineChange(cl, rng);
+					break;
+
+				case 4:
+					if (!ATTestGTIAHasPRIORChange(cl))
+						cl.mbMixed = !cl.mbMixed;
+					break;
+
+				case 5:
+					cl.mbVBlank = !cl.mbVBlank;
+					break;
+
+				case 6:
+					ATTestGTIAAddObject(line, kATTestGTIALineStart + rng.Next(kATTestGTIALineEnd - kATTestGTIALineStart), 1 + rng.Next(32), (uint8)(0x10 << rng.Next(4)));
+					break;
+
+				case 7:
+					// a hires playfield is also valid as lores
+					line.mbHires = false;
+					break;
+
+				case 8:
+					// priority, fifth player and multicolor players
+					line.mPRIOR ^= (uint8)(1 << rng.Next(6));
+					break;
+			}
+		}
+
+		// Keep a few lines changing every frame for a while, so that they
+		// stop going through the cache and later come back to a stale entry.
+		if (frame % 100 < 20) {
+			for(int y = 0; y < 4; ++y)
+				lines[y].mbVBlank = !lines[y].mbVBlank;
+		}
+
+		for(int y = 0; y < kLines; ++y) {
+			ATTestGTIARenderCacheLine(*rc, lines[y], y, cachedOutput);
+			ATTestGTIARenderCacheLine(*ru, lines[y], -1, uncachedOutput);
+
+			for(int x = 0; x < 456; ++x)
+				AT_TEST_ASSERTF(cachedOutput[x] == uncachedOutput[x], "Output mismatch: frame %d, line %d, offset %d", frame, y, x);
+		}
+	}
+
+	return 0;
+}
+
+AT_DEFINE_TEST_NONAUTO(Emu_GTIARendererCacheBench) {
+	// A static frame with a color change on every fourth line, timed with the
+	// cache bypassed, with every line hitting the cache, and with every line
+	// missing the cache.
+	struct BenchCase {
+		const char *mpName;
+		uint8 mPRIOR;
+		bool mbHires;
+		bool mbPMGraphics;
+	};
+
+	static constexpr BenchCase kCases[] {
+		{ "ANTIC 2 (hires)  ", 0x01, true,  false },
+		{ "ANTIC E (lores)  ", 0x01, false, false },
+		{ "ANTIC E + P/M    ", 0x01, false, true  },
+		{ "GTIA 9           ", 0x41, false, false },
+		{ "GTIA 11 + P/M    ", 0xC1, false, true  },
+	};
+
+	static constexpr int kLines = 192;
+	static constexpr int kFrames = 500;
+
+	ATTestRandom rng;
+	vdautoptr<ATGTIARenderer> r(new ATGTIARenderer);
+	vdautoarrayptr<ATTestGTIACacheLine> lines(new ATTestGTIACacheLine[kLines]);
+	VDALIGN(16) uint8 output[456];
+
+	ATTestGTIAInitRenderer(*r, rng);
+
+	for(const BenchCase& bc : kCases) {
+		for(int y = 0; y < kLines; ++y) {
+			ATTestGTIACacheLine& cl = lines[y];
+
+			cl.mLine.mPRIOR = bc.mPRIOR;
+			cl.mLine.mbHires = bc.mbHires;
+			cl.mLine.mbPMGraphics = false;
+			ATTestGTIAFillPlayfield(cl.mLine, rng);
+
+			if (bc.mbPMGraphics) {
+				ATTestGTIAAddObject(cl.mLine, 80, 16, ATGTIA::P0);
+				ATTestGTIAAddObject(cl.mLine, 140, 16, ATGTIA::P1);
+			}
+
+			cl.mNumChanges = (y & 3) ? 0 : 1;
+			cl.mChanges[0][0] = 30;
+			cl.mChanges[0][1] = 0x16;
+			cl.mChanges[0][2] = (uint8)(y & 0xFE);
+
+			cl.mbPFGraphics = true;
+			cl.mbMixed = false;
+			cl.mbVBlank = false;
+			cl.mbSplitRender = false;
+		}
+
+		const auto timeFrames = [&](bool useCache, bool miss) {
+			const uint64 t0 = VDGetPreciseTick();
+
+			for(int frame = 0; frame < kFrames; ++frame) {
+				for(int y = 0; y < kLines; ++y) {
+					// flip a playfield bit each frame to force a miss
+					if (miss)
+						lines[y].mLine.mAntic[kATTestGTIALineStart] ^= 1;
+
+					ATTestGTIARenderCacheLine(*r, lines[y], useCache ? y : -1, output);
+				}
+			}
+
+			return (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick() / (double)(kFrames * kLines);
+		};
+
+		const double tUncached = timeFrames(false, false);
+
+		// prime the cache before timing hits
+		timeFrames(true, false);
+
+		const double tHit = timeFrames(true, false);
+		const double tMiss = timeFrames(true, true);
+
+		printf("%s: uncached %6.1fns, hit %6.1fns (%.2fx), miss %6.1fns (%.2fx)\n", bc.mpName, tUncached * 1e+9, tHit * 1e+9, tUncached / tHit, tMiss * 1e+9, tUncached / tMiss);
+	}
+
+	return 0;
+}
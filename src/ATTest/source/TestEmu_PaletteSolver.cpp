@@ -0,0 +1,175 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/time.h>
+#include <vd2/system/vdalloc.h>
+#include "gtia.h"
+#include "palettegenerator.h"
+#include "palettesolver.h"
+#include "test.h"
+
+namespace {
+	float ATTestPaletteRandUnit(ATTestRandom& rng) {
+		return (float)rng.Next(0x10000) / 65535.0f;
+	}
+
+	// Random parameters over the range that the solver searches, plus the
+	// settings that it leaves alone but that still go into the score.
+	ATColorParams ATTestPaletteRandomParams(ATTestRandom& rng) {
+		ATColorParams params = ATGetColorPresetByIndex(rng.Next(ATGetColorPresetCount()));
+
+		params.mHueStart		= -60.0f + 360.0f * ATTestPaletteRandUnit(rng);
+		params.mHueRange		= 540.0f * ATTestPaletteRandUnit(rng);
+		params.mBrightness		= -0.20f + 0.40f * ATTestPaletteRandUnit(rng);
+		params.mContrast		= 0.01f + 1.49f * ATTestPaletteRandUnit(rng);
+		params.mSaturation		= 0.01f + 0.74f * ATTestPaletteRandUnit(rng);
+		params.mGammaCorrect	= 0.5f + 1.5f * ATTestPaletteRandUnit(rng);
+		params.mbUsePALQuirks	= (rng.Next() & 1) != 0;
+		params.mLumaRampMode	= (ATLumaRampMode)rng.Next(kATLumaRampModeCount);
+		params.mColorMatchingMode = (ATColorMatchingMode)rng.Next(5);
+
+		return params;
+	}
+
+	// The score as the solver originally computed it, from the full palette
+	// generator.
+	uint32 ATTestPaletteGeneratorScore(const ATColorParams& params, const uint32 target[256]) {
+		ATColorPaletteGenerator gen;
+		gen.Generate(params, ATMonitorMode::Color);
+
+		uint32 error = 0;
+		for(int i=0; i<256; ++i) {
+			if (!(i & 15))
+				continue;
+
+			const uint32 c = target[i];
+			const uint32 d = gen.mPalette[i];
+
+			const sint32 dr = (sint32)((c >> 16) & 0xFF) - (sint32)((d >> 16) & 0xFF);
+			const sint32 dg = (sint32)((c >>  8) & 0xFF) - (sint32)((d >>  8) & 0xFF);
+			const sint32 db = (sint32)((c >>  0) & 0xFF) - (sint32)((d >>  0) & 0xFF);
+
+			error += (uint32)(dr * dr + dg * dg + db * db);
+		}
+
+		return error;
+	}
+}
+
+AT_DEFINE_TEST(Emu_PaletteSolver) {
+	// The solver computes the palette with different operation order than the
+	// generator, and the fast path also approximates pow(), so an entry can
+	// occasionally round the other way. Such differences are bounded by
+	// comparing against the generator's own palette: the score there is the
+	// squared distance between the two palettes, which must be small, and by
+	// the triangle inequality the scores against any other target then can't
+	// differ by more than that distance.
+	static constexpr uint32 kMaxSelfScore[2] = { 4, 2 };
+
+	ATTestRandom rng;
+	vdautoptr<ATColorPaletteGenerator> gen(new ATColorPaletteGenerator);
+
+	for(int pass = 0; pass < 500; ++pass) {
+		const ATColorParams params = ATTestPaletteRandomParams(rng);
+		const ATColorParams targetParams = ATTestPaletteRandomParams(rng);
+
+		uint32 selfPalette[256];
+		gen->Generate(params, ATMonitorMode::Color);
+		memcpy(selfPalette, gen->mPalette, sizeof selfPalette);
+
+		uint32 targetPalette[256];
+		gen->Generate(targetParams, ATMonitorMode::Color);
+		memcpy(targetPalette, gen->mPalette, sizeof targetPalette);
+
+		const uint32 refScore = ATTestPaletteGeneratorScore(params, targetPalette);
+
+		for(int reference = 0; reference < 2; ++reference) {
+			const uint32 selfScore = ATComputeColorPaletteSolverScore(params, selfPalette, reference != 0);
+			const uint32 score = ATComputeColorPaletteSolverScore(params, targetPalette, reference != 0);
+
+			AT_TEST_ASSERTF(selfScore <= kMaxSelfScore[reference],
+				"Pass %d (%s): score against generator palette is %u", pass, reference ? "reference" : "fast", selfScore);
+
+			const double dist = fabs(sqrt((double)score) - sqrt((double)refScore));
+			AT_TEST_ASSERTF(dist <= sqrt((double)selfScore) + 1e-6,
+				"Pass %d (%s): score %u, expected %u (max distance %u)", pass, reference ? "reference" : "fast", score, refScore, selfScore);
+		}
+	}
+
+	return 0;
+}
+
+AT_DEFINE_TEST_NONAUTO(Emu_PaletteSolverBench) {
+	ATTestRandom rng;
+	vdautoptr<ATColorPaletteGenerator> gen(new ATColorPaletteGenerator);
+
+	// Target that the solver can reach exactly, differing from the initial
+	// state only in the parameters that it searches.
+	const ATColorParams initialParams = ATGetColorPresetByIndex(0);
+	const ATColorParams randomParams = ATTestPaletteRandomParams(rng);
+	ATColorParams targetParams = initialParams;
+	targetParams.mHueStart		= randomParams.mHueStart;
+	targetParams.mHueRange		= randomParams.mHueRange;
+	targetParams.mBrightness	= randomParams.mBrightness;
+	targetParams.mContrast		= randomParams.mContrast;
+	targetParams.mSaturation	= randomParams.mSaturation;
+	targetParams.mGammaCorrect	= randomParams.mGammaCorrect;
+
+	uint32 targetPalette[256];
+	gen->Generate(targetParams, ATMonitorMode::Color);
+	memcpy(targetPalette, gen->mPalette, sizeof targetPalette);
+
+	// scoring throughput
+	static constexpr int kScores = 20000;
+	static volatile uint32 sSink;
+	uint32 sink = 0;
+
+	uint64 t0 = VDGetPreciseTick();
+	for(int i = 0; i < kScores; ++i)
+		sink += ATTestPaletteGeneratorScore(initialParams, targetPalette);
+	const double tGen = (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick() / kScores;
+
+	t0 = VDGetPreciseTick();
+	for(int i = 0; i < kScores; ++i)
+		sink += ATComputeColorPaletteSolverScore(initialParams, targetPalette, false);
+	const double tFast = (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick() / kScores;
+
+	sSink = sink;
+
+	printf("Score via generator: %6.2fus\n", tGen * 1e+6);
+	printf("Score via solver:    %6.2fus (%.1fx)\n", tFast * 1e+6, tGen / tFast);
+
+	// full solve from a preset toward a random target
+	vdautoptr<IATColorPaletteSolver> solver(ATCreateColorPaletteSolver());
+
+	t0 = VDGetPreciseTick();
+	solver->Init(initialParams, targetPalette, false, false);
+
+	uint32 iterations = 0;
+	while(solver->Iterate() != IATColorPaletteSolver::Status::Finished)
+		++iterations;
+
+	const double tSolve = (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick();
+
+	printf("Solve: %.2fs, %u iterations, %u threads, final error %u (initial %u)\n",
+		tSolve, iterations, VDGetLogicalProcessorCount(),
+		solver->GetCurrentError().value_or(0),
+		ATComputeColorPaletteSolverScore(initialParams, targetPalette, false));
+
+	return 0;
+}
@@ -0,0 +1,182 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/time.h>
+#include <vd2/system/vdalloc.h>
+#include <vd2/system/vdstl.h>
+#include "vbxeoverlaytext.h"
+#include "test.h"
+
+namespace {
+	struct ATTestVBXEOvTextLine {
+		uint32 mTextAddr;
+		uint32 mTextRow;
+		int mWidth;
+		bool mbTrans;
+	};
+
+	// Overlay widths in color clocks for narrow, normal and wide text, each
+	// with and without the extra fetch for horizontal scrolling.
+	constexpr int kATTestVBXEOvTextWidths[] { 128, 130, 160, 162, 168, 170 };
+
+	void ATTestVBXERandomizeOvTextLine(ATTestVBXEOvTextLine& line, ATTestRandom& rng) {
+		line.mTextAddr = rng.Next(0x7F000);
+		line.mTextRow = rng.Next(8);
+		line.mWidth = kATTestVBXEOvTextWidths[rng.Next(vdcountof(kATTestVBXEOvTextWidths))];
+		line.mbTrans = (rng.Next() & 1) != 0;
+	}
+}
+
+AT_DEFINE_TEST(Emu_VBXEOverlayText) {
+	static constexpr uint32 kLines = 64;
+	static constexpr int kFrames = 500;
+	static constexpr size_t kMaxBytes = ATVBXEOverlayTextCache::kMaxWidth * 4;
+
+	ATTestRandom rng;
+	vdblock<uint8> mem(0x80000);
+	vdautoptr<ATVBXEOverlayTextCache> cache(new ATVBXEOverlayTextCache);
+	ATTestVBXEOvTextLine lines[kLines];
+	uint8 cachedDecode[kMaxBytes];
+	uint8 cachedTrans[kMaxBytes];
+	uint8 refDecode[kMaxBytes];
+	uint8 refTrans[kMaxBytes];
+
+	for(uint8& v : mem)
+		v = (uint8)rng.Next();
+
+	for(ATTestVBXEOvTextLine& line : lines)
+		ATTestVBXERandomizeOvTextLine(line, rng);
+
+	// The last line wraps around the end of VBXE memory and is never cached.
+	lines[kLines - 1].mTextAddr = 0x7FFF0;
+
+	uint32 chAddr = 0x1000;
+
+	for(int frame = 0; frame < kFrames; ++frame) {
+		// Every fifth frame is left unchanged, so every line that can be
+		// cached must come from the cache.
+		const bool unchanged = frame % 5 == 4;
+
+		if (!unchanged) {
+			if (frame % 50 == 0)
+				chAddr = rng.Next(0x80000 >> 11) << 11;
+
+			const uint32 numMutations = rng.Next(4);
+			for(uint32 i = 0; i < numMutations; ++i) {
+				ATTestVBXEOvTextLine& line = lines[rng.Next(kLines - 1)];
+				const uint32 offset = rng.Next((uint32)line.mWidth);
+
+				switch(rng.Next(6)) {
+					case 0:
+						ATTestVBXERandomizeOvTextLine(line, rng);
+						break;
+
+					case 1:
+						// character or attribute
+						mem[line.mTextAddr + offset] ^= (uint8)(1 << rng.Next(8));
+						break;
+
+					case 2:
+						// glyph row of a character in use
+						mem[chAddr + ((uint32)mem[line.mTextAddr + (offset & ~1)] << 3) + line.mTextRow] ^= (uint8)(1 << rng.Next(8));
+						break;
+
+					case 3:
+						line.mbTrans = !line.mbTrans;
+						break;
+
+					case 4:
+						line.mTextRow = (line.mTextRow + 1) & 7;
+						break;
+
+					case 5:
+						line.mWidth = kATTestVBXEOvTextWidths[rng.Next(vdcountof(kATTestVBXEOvTextWidths))];
+						break;
+				}
+			}
+		}
+
+		for(uint32 y = 0; y < kLines; ++y) {
+			const ATTestVBXEOvTextLine& line = lines[y];
+			const size_t len = (size_t)line.mWidth * 4;
+
+			memset(cachedDecode, 0xCD, sizeof cachedDecode);
+			memset(cachedTrans, 0xCD, sizeof cachedTrans);
+			memset(refDecode, 0xCD, sizeof refDecode);
+			memset(refTrans, 0xCD, sizeof refTrans);
+
+			const bool hit = cache->Decode(y, cachedDecode, cachedTrans, mem.data(), line.mTextAddr, chAddr, line.mTextRow, line.mWidth, line.mbTrans);
+			ATVBXEDecodeOverlayText(refDecode, refTrans, mem.data(), line.mTextAddr, &mem[chAddr + line.mTextRow], 0, line.mWidth, line.mbTrans);
+
+			AT_TEST_ASSERTF(!memcmp(cachedDecode, refDecode, len), "Decode mismatch: frame %d, line %u", frame, y);
+			AT_TEST_ASSERTF(!line.mbTrans || !memcmp(cachedTrans, refTrans, len), "Translucency mismatch: frame %d, line %u", frame, y);
+
+			if (y == kLines - 1) {
+				AT_TEST_ASSERTF(!hit, "Wrapping line was cached: frame %d", frame);
+			} else if (unchanged) {
+				AT_TEST_ASSERTF(hit, "Unchanged line was decoded again: frame %d, line %u", frame, y);
+			}
+		}
+	}
+
+	return 0;
+}
+
+AT_DEFINE_TEST_NONAUTO(Emu_VBXEOverlayTextBench) {
+	// A static 80x30 text screen in normal width, timed with every line
+	// decoded and with every line coming from the cache.
+	static constexpr uint32 kLines = 240;
+	static constexpr int kFrames = 500;
+	static constexpr int kWidth = 160;
+
+	ATTestRandom rng;
+	vdblock<uint8> mem(0x80000);
+	vdautoptr<ATVBXEOverlayTextCache> cache(new ATVBXEOverlayTextCache);
+	uint8 decode[kWidth * 4];
+	uint8 trans[kWidth * 4];
+
+	for(uint8& v : mem)
+		v = (uint8)rng.Next();
+
+	for(int i = 0; i < 2; ++i) {
+		const bool useTrans = i != 0;
+
+		const auto timeFrames = [&](bool useCache) {
+			const uint64 t0 = VDGetPreciseTick();
+
+			for(int frame = 0; frame < kFrames; ++frame) {
+				for(uint32 y = 0; y < kLines; ++y) {
+					const uint32 textAddr = (y >> 3) * kWidth;
+
+					if (useCache)
+						cache->Decode(y, decode, trans, mem.data(), textAddr, 0x10000, y & 7, kWidth, useTrans);
+					else
+						ATVBXEDecodeOverlayText(decode, trans, mem.data(), textAddr, &mem[0x10000 + (y & 7)], 0, kWidth, useTrans);
+				}
+			}
+
+			return (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick() / (double)(kFrames * kLines);
+		};
+
+		const double tDecode = timeFrames(false);
+		const double tCached = timeFrames(true);
+
+		printf("%s: decode %6.1fns, cached %6.1fns (%.2fx)\n", useTrans ? "translucent" : "opaque     ", tDecode * 1e+9, tCached * 1e+9, tDecode / tCached);
+	}
+
+	return 0;
+}
@@ -0,0 +1,300 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/vdalloc.h>
+#include <at/atcore/deviceport.h>
+#include <at/atcore/scheduler.h>
+#include "xep80.h"
+#include "test.h"
+
+namespace {
+	// Just enough of a port manager to connect the XEP80 to joystick port 1.
+	// Replies from the XEP80 are dropped, as the test runs it in burst mode.
+	class ATTestXEP80PortManager final : public IATDevicePortManager {
+	public:
+		void AllocControllerPort(int controllerIndex, IATDeviceControllerPort **port) override { *port = nullptr; }
+		int AllocInput() override { return 0; }
+		void FreeInput(int index) override {}
+		void SetInput(int index, uint32 rval) override {}
+		uint32 GetOutputState() const override { return mOutputState; }
+
+		int AllocOutput(ATPortOutputFn fn, void *ptr, uint32 changeMask) override {
+			mpOutputFn = fn;
+			mpOutputData = ptr;
+			mOutputMask = changeMask;
+			return 0;
+		}
+
+		void ModifyOutputMask(int index, uint32 changeMask) override { mOutputMask = changeMask; }
+		void FreeOutput(int index) override { mpOutputFn = nullptr; }
+
+		void SetOutputState(uint32 state) {
+			const uint32 delta = mOutputState ^ state;
+
+			mOutputState = state;
+
+			if ((delta & mOutputMask) && mpOutputFn)
+				mpOutputFn(mpOutputData, state);
+		}
+
+	private:
+		uint32 mOutputState = 0xFF;
+		uint32 mOutputMask = 0;
+		ATPortOutputFn mpOutputFn = nullptr;
+		void *mpOutputData = nullptr;
+	};
+
+	struct ATTestXEP80 {
+		ATScheduler mScheduler;
+		ATTestXEP80PortManager mPort;
+		ATXEP80Emulator mXEP80;
+
+		ATTestXEP80(bool incremental) {
+			mScheduler.SetRate(VDFraction(7159090, 4));
+			mXEP80.Init(&mScheduler, &mPort);
+			mXEP80.SetIncrementalRedraw(incremental);
+		}
+
+		~ATTestXEP80() {
+			mXEP80.Shutdown();
+		}
+
+		// Send a 9-bit word over joystick port bit 0 at 15.7KHz: start bit,
+		// D0-D8, and stop bit, followed by two bit times of idle.
+		void SendWord(uint32 v) {
+			static constexpr uint32 kCyclesPerBit = 114;
+
+			const uint32 bits = (v << 1) + 0x1C00;
+
+			for(int i = 0; i < 13; ++i) {
+				mPort.SetOutputState(bits & (1 << i) ? 0xFF : 0xFE);
+
+				for(uint32 j = 0; j < kCyclesPerBit; ++j) {
+					ATSCHEDULER_ADVANCE(&mScheduler);
+				}
+			}
+		}
+	};
+
+	// Check that pixels outside of the dirty rects are unchanged from the
+	// previous frame.
+	bool ATTestXEP80CheckDirtyRects(const VDPixmap& frame, const vdfastvector<uint8>& prevFrame, const vdfastvector<vdrect32>& dirtyRects) {
+		const size_t rowBytes = (size_t)((frame.w + 7) >> 3);
+
+		for(sint32 y = 0; y < frame.h; ++y) {
+			const uint8 *row = (const uint8 *)frame.data + frame.pitch * y;
+			const uint8 *prevRow = prevFrame.data() + rowBytes * y;
+
+			for(sint32 x = 0; x < frame.w; ++x) {
+				const uint8 bit = 0x80 >> (x & 7);
+
+				if (!((row[x >> 3] ^ prevRow[x >> 3]) & bit))
+					continue;
+
+				bool dirty = false;
+				for(const vdrect32& r : dirtyRects) {
+					if (r.contains(vdpoint32(x, y))) {
+						dirty = true;
+						break;
+					}
+				}
+
+				if (!dirty)
+					return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+AT_DEFINE_TEST(Emu_XEP80Render) {
+	// Drive two XEP80s with the same commands, one redrawing only changed text
+	// cells and the other redrawing everything every frame, and check that
+	// they produce the same frames.
+	vdautoptr<ATTestXEP80> inc(new ATTestXEP80(true));
+	vdautoptr<ATTestXEP80> full(new ATTestXEP80(false));
+
+	ATTestRandom rng;
+
+	const auto send = [&](uint32 v) {
+		inc->SendWord(v);
+		full->SendWord(v);
+	};
+
+	const auto sendWithParam = [&](uint8 param, uint8 cmd) {
+		// commands take their parameter from the last character received
+		send(param);
+		send(0x100 + cmd);
+	};
+
+	// burst mode, so that the XEP80 doesn't reply to each byte
+	send(0x1D3);
+
+	vdfastvector<uint8> prevFrame;
+	uint32 prevChangeCount = 0;
+	int incrementalFrames = 0;
+
+	static constexpr int kFrames = 600;
+
+	for(int frame = 0; frame < kFrames; ++frame) {
+		const uint32 numOps = rng.Next(6);
+
+		for(uint32 i = 0; i < numOps; ++i) {
+			switch(rng.Next(17)) {
+				case 0:
+				case 1:
+				case 2:
+				case 3:
+				case 4:
+					// print normal and inverse characters, sometimes a whole run
+					{
+						const uint32 n = rng.Next(4) ? 1 : 1 + rng.Next(100);
+
+						for(uint32 j = 0; j < n; ++j)
+							send((0x20 + rng.Next(0x5D)) | (rng.Next(4) ? 0 : 0x80));
+					}
+					break;
+
+				case 5:
+					// EOL, insert line, delete line, cursor up/down/left/right
+					{
+						static constexpr uint8 kControlChars[] { 0x9B, 0x9C, 0x9D, 0x1C, 0x1D, 0x1E, 0x1F };
+
+						send(kControlChars[rng.Next(vdcountof(kControlChars))]);
+					}
+					break;
+
+				case 6:
+					// set cursor horizontal/vertical position
+					send(0x100 + rng.Next(80));
+					send(0x180 + rng.Next(24));
+					break;
+
+				case 7:
+					// cursor off, on, or blinking
+					send(0x1D8 + rng.Next(3));
+					break;
+
+				case 8:
+					// white on black or black on white
+					send(0x1DE + rng.Next(2));
+					break;
+
+				case 9:
+					// Attribute latch 0 or 1, toggling blink, reverse, underline,
+					// and double width. Active low.
+					sendWithParam((uint8)(0xFF ^ (rng.Next(16) & 0x05) ^ (rng.Next(4) ? 0 : 0x30)), 0xF4 + rng.Next(2));
+					break;
+
+				case 10:
+					// video control register: field blink, cursor blink, cursor
+					// reverse, and reverse video
+					sendWithParam((uint8)rng.Next(16), 0xED);
+					break;
+
+				case 11:
+					// Horizontal sync start, via the timing chain. The defaults
+					// have sync starting at 82; 84 and 86 cause the prefetch
+					// to jitter between two characters on ATASCII rows.
+					{
+						static constexpr uint8 kHorzSyncStarts[] { 82, 84, 86 };
+
+						sendWithParam(2, 0xF6);
+						sendWithParam(kHorzSyncStarts[rng.Next(3)], 0xF7);
+					}
+					break;
+
+				case 12:
+					// Direct VRAM write at the cursor address, which doesn't
+					// invalidate the frame until the next tick.
+					sendWithParam((uint8)rng.Next(80), 0xE4);
+					sendWithParam((uint8)rng.Next(24), 0xE2);
+					sendWithParam((uint8)rng.Next(256), 0xE3);
+					break;
+
+				case 13:
+					// switch between ATASCII and the international charset, with
+					// the internal charset once in a while
+					send(0x1D4 + (rng.Next(8) ? rng.Next(2) : 2));
+					break;
+
+				case 14:
+					// clear, rarely
+					if (!rng.Next(8))
+						send(0x7D);
+					break;
+
+				case 15:
+					// Point a single row at a different charset through the row
+					// address table in internal RAM, which changes the font of
+					// only that row.
+					sendWithParam((uint8)(0x20 + rng.Next(24)), 0xE4);
+					sendWithParam((uint8)(rng.Next(24) + 0x20 * rng.Next(3)), 0xE5);
+					break;
+
+				case 16:
+					// just let time pass for blinking
+					break;
+			}
+		}
+
+		inc->mXEP80.Tick(5);
+		full->mXEP80.Tick(5);
+		inc->mXEP80.UpdateFrame();
+		full->mXEP80.UpdateFrame();
+
+		const VDPixmap& incFrame = inc->mXEP80.GetFrameBuffer();
+		const VDPixmap& fullFrame = full->mXEP80.GetFrameBuffer();
+
+		AT_TEST_ASSERTF(incFrame.w == fullFrame.w && incFrame.h == fullFrame.h, "Frame size mismatch at frame %d", frame);
+
+		const size_t rowBytes = (size_t)((incFrame.w + 7) >> 3);
+
+		for(sint32 y = 0; y < incFrame.h; ++y) {
+			const uint8 *incRow = (const uint8 *)incFrame.data + incFrame.pitch * y;
+			const uint8 *fullRow = (const uint8 *)fullFrame.data + fullFrame.pitch * y;
+
+			AT_TEST_ASSERTF(!memcmp(incRow, fullRow, rowBytes), "Frame mismatch at frame %d, row %d", frame, y);
+		}
+
+		// The dirty rects, if any, must cover every pixel that changed since
+		// the last frame seen.
+		const uint32 changeCount = inc->mXEP80.GetFrameChangeCount();
+		const auto& dirtyRects = inc->mXEP80.GetFrameDirtyRects();
+
+		if (changeCount == prevChangeCount) {
+			AT_TEST_ASSERTF(ATTestXEP80CheckDirtyRects(incFrame, prevFrame, {}), "Frame changed without a change count bump at frame %d", frame);
+		} else if (!dirtyRects.empty()) {
+			AT_TEST_ASSERTF(inc->mXEP80.GetFrameDirtyBaseChangeCount() == prevChangeCount, "Dirty rects are relative to the wrong change count at frame %d", frame);
+			AT_TEST_ASSERTF(ATTestXEP80CheckDirtyRects(incFrame, prevFrame, dirtyRects), "Pixels changed outside of the dirty rects at frame %d", frame);
+
+			++incrementalFrames;
+		}
+
+		prevChangeCount = changeCount;
+		prevFrame.resize(rowBytes * incFrame.h);
+
+		for(sint32 y = 0; y < incFrame.h; ++y)
+			memcpy(prevFrame.data() + rowBytes * y, (const uint8 *)incFrame.data + incFrame.pitch * y, rowBytes);
+	}
+
+	// make sure that the comparison actually covered incremental updates
+	AT_TEST_ASSERTF(incrementalFrames > kFrames / 4, "Only %d of %d frames were incremental updates", incrementalFrames, kFrames);
+
+	return 0;
+}
@@ -0,0 +1,205 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/file.h>
+#include <vd2/system/filesys.h>
+#include <vd2/system/threadpool.h>
+#include <vd2/system/vdalloc.h>
+#include <vd2/system/zip.h>
+#include <at/atcore/checksum.h>
+#include <at/atcore/vfs.h>
+#include "imageindex.h"
+#include "test.h"
+
+namespace {
+	const ATImageIndexEntry *ATTestImageIndexFind(const ATImageIndex& index, const VDStringW& path) {
+		const ATImageIndexEntry *found = nullptr;
+
+		for(size_t i = 0, n = index.GetCount(); i < n; ++i) {
+			const ATImageIndexEntry& e = index.GetEntry(i);
+
+			if (e.mPath == path)
+				found = &e;
+		}
+
+		AT_TEST_ASSERT(index.FindByPath(path.c_str()) == found);
+		return found;
+	}
+
+	void ATTestImageIndexCheckEntry(const ATImageIndexEntry *e, const void *data, size_t len, ATImageType type) {
+		AT_TEST_ASSERT(e);
+		AT_TEST_ASSERT(e->IsImage());
+		AT_TEST_ASSERT(e->mImageType == type);
+		AT_TEST_ASSERT(e->mSize == len);
+		AT_TEST_ASSERT(e->mCRC32 == VDCRCTable::CRC32.CRC(data, len));
+		AT_TEST_ASSERT(e->mSHA256 == ATComputeChecksumSHA256(data, len));
+	}
+}
+
+AT_DEFINE_TEST(IO_ImageIndex) {
+	static constexpr uint8 kProgram1[] { 0xFF, 0xFF, 0x00, 0x20, 0x00, 0x20, 0x60 };
+	static constexpr uint8 kProgram2[] { 0xFF, 0xFF, 0x00, 0x30, 0x01, 0x30, 0xA9, 0x00 };
+	static constexpr uint8 kProgram3[] { 0xFF, 0xFF, 0x00, 0x40, 0x02, 0x40, 0xA9, 0x01, 0x60 };
+
+	ATTestTempDirectory dir;
+
+	// Two copies of the same program, a zero-length image and a non-image
+	// file that should both be skipped, a zip with no images that should
+	// get a negative entry, and a zip with images in a subdirectory.
+	const VDStringW path1 = dir.AddFile(L"game.xex", kProgram1, sizeof kProgram1);
+	const VDStringW path2 = dir.AddFile(L"copy.obx", kProgram1, sizeof kProgram1);
+	dir.AddFile(L"empty.atr", nullptr, 0);
+	dir.AddFile(L"readme.txt", "readme", 6);
+
+	const VDStringW docsZipPath = dir.MakePath(L"docs.zip");
+	{
+		VDFileStream fs(docsZipPath.c_str(), nsVDFile::kWrite | nsVDFile::kDenyAll | nsVDFile::kCreateAlways);
+		vdautoptr<IVDZipArchiveWriter> zw(VDCreateZipArchiveWriter(fs));
+
+		zw->BeginFile(L"manual.txt").Write("manual", 6);
+		zw->EndFile();
+		zw->Finalize();
+	}
+
+	const VDStringW subPath = dir.MakePath(L"sub");
+	VDCreateDirectory(subPath.c_str());
+
+	// Larger zip members of different lengths exercise the batched SHA-256
+	// path, which hashes whole blocks of several members together.
+	vdfastvector<uint8> bigPrograms[3];
+	static constexpr const wchar_t *kBigNames[3] { L"big1.xex", L"big2.xex", L"big3.xex" };
+
+	for(int i = 0; i < 3; ++i) {
+		const uint32 len = 300 + 250 * i;
+		vdfastvector<uint8>& prog = bigPrograms[i];
+
+		prog = { 0xFF, 0xFF, 0x00, 0x50, (uint8)(len - 7), (uint8)(0x50 + ((len - 7) >> 8)) };
+
+		while(prog.size() < len)
+			prog.push_back((uint8)(prog.size() * 7 + i));
+	}
+
+	const VDStringW zipPath = VDMakePath(subPath.c_str(), L"games.zip");
+	{
+		VDFileStream fs(zipPath.c_str(), nsVDFile::kWrite | nsVDFile::kDenyAll | nsVDFile::kCreateAlways);
+		vdautoptr<IVDZipArchiveWriter> zw(VDCreateZipArchiveWriter(fs));
+
+		zw->BeginFile(L"inner.xex").Write(kProgram2, sizeof kProgram2);
+		zw->EndFile();
+		zw->BeginFile(L"notes.txt").Write("notes", 5);
+		zw->EndFile();
+
+		for(int i = 0; i < 3; ++i) {
+			zw->BeginFile(kBigNames[i]).Write(bigPrograms[i].data(), (sint32)bigPrograms[i].size());
+			zw->EndFile();
+		}
+
+		zw->Finalize();
+	}
+
+	const VDStringW zipMemberPath = ATMakeVFSPathForZipFile(zipPath.c_str(), L"inner.xex");
+
+	VDThreadPool pool;
+	pool.Start(2);
+
+	// initial build
+	ATImageIndex index;
+	ATImageIndexUpdateStats stats = ATImageIndexUpdate(index, dir.GetPath(), pool, nullptr);
+
+	AT_TEST_ASSERT(stats.mFilesScanned == 4);
+	AT_TEST_ASSERT(stats.mFilesReused == 0);
+	AT_TEST_ASSERT(stats.mErrors == 0);
+	AT_TEST_ASSERT(stats.mEntriesIndexed == 6);
+	AT_TEST_ASSERT(index.GetCount() == 7);
+
+	const ATImageIndexEntry *docsEntry = ATTestImageIndexFind(index, docsZipPath);
+	AT_TEST_ASSERT(docsEntry && !docsEntry->IsImage());
+
+	// host size/timestamp checked lookups
+	const ATImageIndexEntry *e1 = ATTestImageIndexFind(index, path1);
+	AT_TEST_ASSERT(e1 && e1->mHostSize == sizeof kProgram1);
+	AT_TEST_ASSERT(index.FindByPath(path1.c_str(), e1->mHostSize, e1->mHostTimestamp) == e1);
+	AT_TEST_ASSERT(!index.FindByPath(path1.c_str(), e1->mHostSize + 1, e1->mHostTimestamp));
+	AT_TEST_ASSERT(!index.FindByPath(path1.c_str(), e1->mHostSize, e1->mHostTimestamp + 1));
+	AT_TEST_ASSERT(!index.FindByPath(dir.MakePath(L"readme.txt").c_str()));
+
+	ATTestImageIndexCheckEntry(ATTestImageIndexFind(index, path1), kProgram1, sizeof kProgram1, kATImageType_Program);
+	ATTestImageIndexCheckEntry(ATTestImageIndexFind(index, path2), kProgram1, sizeof kProgram1, kATImageType_Program);
+	ATTestImageIndexCheckEntry(ATTestImageIndexFind(index, zipMemberPath), kProgram2, sizeof kProgram2, kATImageType_Program);
+
+	for(int i = 0; i < 3; ++i) {
+		ATTestImageIndexCheckEntry(
+			ATTestImageIndexFind(index, ATMakeVFSPathForZipFile(zipPath.c_str(), kBigNames[i])),
+			bigPrograms[i].data(), bigPrograms[i].size(), kATImageType_Program);
+	}
+
+	// save/load round trip; the index file goes in the subdirectory, where it
+	// is too small to be a firmware candidate and has no image extension
+	const VDStringW indexPath = VDMakePath(subPath.c_str(), L"test.idx");
+	index.Save(indexPath.c_str());
+
+	ATImageIndex index2;
+	index2.Load(indexPath.c_str());
+
+	AT_TEST_ASSERT(index2.GetCount() == index.GetCount());
+
+	for(size_t i = 0; i < index.GetCount(); ++i) {
+		const ATImageIndexEntry& e1 = index.GetEntry(i);
+		const ATImageIndexEntry *e2 = ATTestImageIndexFind(index2, e1.mPath);
+
+		AT_TEST_ASSERT(e2);
+		AT_TEST_ASSERT(e2->mHostSize == e1.mHostSize);
+		AT_TEST_ASSERT(e2->mHostTimestamp == e1.mHostTimestamp);
+		AT_TEST_ASSERT(e2->mCRC32 == e1.mCRC32);
+		AT_TEST_ASSERT(e2->mSHA256 == e1.mSHA256);
+		AT_TEST_ASSERT(e2->mImageType == e1.mImageType);
+		AT_TEST_ASSERT(e2->IsImage() == e1.IsImage());
+	}
+
+	// the default index location is only picked up at the root of a tree
+	ATImageIndex index3;
+	AT_TEST_ASSERT(!ATImageIndexLoadForDirectory(index3, dir.GetPath()));
+	AT_TEST_ASSERT(index3.GetCount() == 0);
+
+	index.Save(ATImageIndexGetDefaultPath(subPath.c_str()).c_str());
+	AT_TEST_ASSERT(ATImageIndexLoadForDirectory(index3, subPath.c_str()));
+	AT_TEST_ASSERT(index3.GetCount() == index.GetCount());
+	VDRemoveFile(ATImageIndexGetDefaultPath(subPath.c_str()).c_str());
+
+	// rescanning an unchanged tree reuses every file, including both zips
+	stats = ATImageIndexUpdate(index2, dir.GetPath(), pool, nullptr);
+
+	AT_TEST_ASSERT(stats.mFilesScanned == 4);
+	AT_TEST_ASSERT(stats.mFilesReused == 4);
+	AT_TEST_ASSERT(stats.mEntriesIndexed == 6);
+	AT_TEST_ASSERT(index2.GetCount() == 7);
+
+	// changing one file rescans only that file
+	dir.AddFile(L"game.xex", kProgram3, sizeof kProgram3);
+
+	stats = ATImageIndexUpdate(index2, dir.GetPath(), pool, nullptr);
+
+	AT_TEST_ASSERT(stats.mFilesScanned == 4);
+	AT_TEST_ASSERT(stats.mFilesReused == 3);
+	AT_TEST_ASSERT(index2.GetCount() == 7);
+
+	ATTestImageIndexCheckEntry(ATTestImageIndexFind(index2, path1), kProgram3, sizeof kProgram3, kATImageType_Program);
+	ATTestImageIndexCheckEntry(ATTestImageIndexFind(index2, path2), kProgram1, sizeof kProgram1, kATImageType_Program);
+
+	pool.Shutdown();
+	return 0;
+}
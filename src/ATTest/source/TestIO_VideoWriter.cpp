@@ -0,0 +1,277 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/error.h>
+#include <vd2/system/file.h>
+#include <vd2/system/filesys.h>
+#include <vd2/system/fraction.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/vdalloc.h>
+#include <vd2/Kasumi/pixmap.h>
+#include <vd2/Kasumi/pixmapops.h>
+#include <vd2/Kasumi/pixmaputils.h>
+#include <at/ataudio/audiooutput.h>
+#include "decode_png.h"
+#include "gtia.h"
+#include "videoencoder.h"
+#include "videowriter.h"
+#include "test.h"
+
+namespace {
+	constexpr uint32 kATTestVWWidth = 64;
+	constexpr uint32 kATTestVWHeight = 48;
+	constexpr uint32 kATTestVWSamplesPerFrame = 800;
+	constexpr uint64 kATTestVWTicksPerFrame = 1000;
+
+	// Each frame carries its index in the red channel so that the image
+	// sequence can be checked for order, and a position gradient in the
+	// other channels so that a misplaced row or column is caught.
+	uint32 ATTestVWPixel(uint32 frameIndex, uint32 x, uint32 y) {
+		return ((frameIndex & 0xFF) << 16) + ((y * 4) << 8) + x * 4;
+	}
+
+	void ATTestVWFillFrame(VDPixmapBuffer& buf, uint32 frameIndex) {
+		for(uint32 y = 0; y < kATTestVWHeight; ++y) {
+			uint32 *row = (uint32 *)((char *)buf.data + buf.pitch * (ptrdiff_t)y);
+
+			for(uint32 x = 0; x < kATTestVWWidth; ++x)
+				row[x] = ATTestVWPixel(frameIndex, x, y);
+		}
+	}
+
+	// Decode one image of the sequence and return the index of the source
+	// frame that it holds, or -1 if it doesn't hold exactly one source frame.
+	sint32 ATTestVWDecodeFrame(const VDStringW& path) {
+		vdblock<uint8> data;
+		{
+			VDFile f(path.c_str());
+			data.resize((size_t)f.size());
+			f.read(data.data(), (long)data.size());
+		}
+
+		vdautoptr<IVDImageDecoderPNG> decoder(VDCreateImageDecoderPNG());
+		AT_TEST_ASSERT(decoder->Decode(data.data(), (uint32)data.size()) == kPNGDecodeOK);
+
+		const VDPixmap& decoded = decoder->GetFrameBuffer();
+		AT_TEST_ASSERT(decoded.w == (sint32)kATTestVWWidth && decoded.h == (sint32)kATTestVWHeight);
+
+		VDPixmapBuffer rgb(kATTestVWWidth, kATTestVWHeight, nsVDPixmap::kPixFormat_XRGB8888);
+		VDPixmapBlt(rgb, decoded);
+
+		const uint32 frameIndex = (*(const uint32 *)rgb.data >> 16) & 0xFF;
+
+		for(uint32 y = 0; y < kATTestVWHeight; ++y) {
+			const uint32 *row = (const uint32 *)((const char *)rgb.data + rgb.pitch * (ptrdiff_t)y);
+
+			for(uint32 x = 0; x < kATTestVWWidth; ++x) {
+				if ((row[x] & 0xFFFFFF) != ATTestVWPixel(frameIndex, x, y))
+					return -1;
+			}
+		}
+
+		return (sint32)frameIndex;
+	}
+
+	VDStringW ATTestVWFramePath(const VDStringW& prefix, uint32 index) {
+		VDStringW path;
+		path.sprintf(L"%ls-%06u.png", prefix.c_str(), index);
+		return path;
+	}
+
+	// Drives a video writer the way the simulator does: one video frame and
+	// one frame's worth of audio per tick, with the first frame only used to
+	// establish the timestamp base.
+	class ATTestVWDriver {
+	public:
+		ATTestVWDriver(const VDStringW& prefix) {
+			IATVideoWriter *vw = nullptr;
+			ATCreateVideoWriter(&vw);
+			mpWriter = vw;
+
+			mpWriter->Init((prefix + L".png").c_str(), kATVideoEncoding_PNGSequence, 0, 0,
+				kATTestVWWidth, kATTestVWHeight, VDFraction(60, 1), 1.0,
+				ATVideoRecordingResamplingMode::Nearest, ATVideoRecordingScalingMode::None,
+				nullptr, 48000.0, false, 60000.0, false, true, nullptr);
+
+			mFrame.init(kATTestVWWidth, kATTestVWHeight, nsVDPixmap::kPixFormat_XRGB8888);
+			memset(mSilence, 0, sizeof mSilence);
+
+			ATTestVWFillFrame(mFrame, 0);
+			mpWriter->AsVideoTap()->WriteFrame(mFrame, 0, kATTestVWTicksPerFrame, 1.0f);
+			mpWriter->AsAudioTap()->WriteRawAudio(mSilence, nullptr, kATTestVWSamplesPerFrame, 0);
+		}
+
+		IATVideoWriter& operator*() const { return *mpWriter; }
+		IATVideoWriter *operator->() const { return mpWriter; }
+
+		void WriteFrame(uint32 frameIndex) {
+			const uint64 t = (uint64)(frameIndex + 1) * kATTestVWTicksPerFrame;
+
+			ATTestVWFillFrame(mFrame, frameIndex);
+			mpWriter->AsVideoTap()->WriteFrame(mFrame, t, t + kATTestVWTicksPerFrame, 1.0f);
+
+			// The frame buffer is reused right away, as the emulator does; the
+			// writer must have taken its own copy.
+			memset(mFrame.data, 0xFF, mFrame.pitch * (size_t)kATTestVWHeight);
+
+			mpWriter->AsAudioTap()->WriteRawAudio(mSilence, nullptr, kATTestVWSamplesPerFrame, (uint32)t);
+		}
+
+	private:
+		vdautoptr<IATVideoWriter> mpWriter;
+		VDPixmapBuffer mFrame;
+		float mSilence[kATTestVWSamplesPerFrame];
+	};
+}
+
+AT_DEFINE_TEST(IO_VideoWriter) {
+	ATTestTempDirectory dir;
+
+	// Frames are written back to back without waiting on the encoder, so the
+	// frame queue overflows whenever the encoder falls behind. Every frame
+	// must still produce exactly one image, either the frame itself or a
+	// repeat of an earlier one, and shutdown must drain everything that is
+	// still in flight.
+	{
+		static constexpr uint32 kFrameCount = 120;
+		const VDStringW prefix = dir.MakePath(L"seq");
+
+		ATTestVWDriver vw(prefix);
+
+		for(uint32 i = 0; i < kFrameCount; ++i)
+			vw.WriteFrame(i);
+
+		vw->Shutdown();
+		vw->CheckExceptions();
+
+		sint32 lastFrameIndex = -1;
+		for(uint32 i = 0; i < kFrameCount; ++i) {
+			const sint32 frameIndex = ATTestVWDecodeFrame(ATTestVWFramePath(prefix, i));
+
+			AT_TEST_ASSERTF(frameIndex >= 0, "Image %u does not hold a source frame", i);
+			AT_TEST_ASSERTF(frameIndex <= (sint32)i, "Image %u holds later frame %d", i, frameIndex);
+			AT_TEST_ASSERTF(frameIndex >= lastFrameIndex, "Image %u holds frame %d out of order after frame %d", i, frameIndex, lastFrameIndex);
+
+			lastFrameIndex = frameIndex;
+		}
+
+		// The first frame can never be dropped, since the queue starts empty.
+		AT_TEST_ASSERT(ATTestVWDecodeFrame(ATTestVWFramePath(prefix, 0)) == 0);
+
+		AT_TEST_ASSERT(!VDDoesPathExist(ATTestVWFramePath(prefix, kFrameCount).c_str()));
+		AT_TEST_ASSERT(VDDoesPathExist((prefix + L".wav").c_str()));
+	}
+
+	// Shutting down before any frame has been written produces no images.
+	{
+		const VDStringW prefix = dir.MakePath(L"empty");
+
+		ATTestVWDriver vw(prefix);
+		vw->Shutdown();
+		vw->CheckExceptions();
+
+		AT_TEST_ASSERT(!VDDoesPathExist(ATTestVWFramePath(prefix, 0).c_str()));
+	}
+
+	// A write error on the encoder side must surface through
+	// CheckExceptions() while recording continues, and shutdown must not
+	// stall on the frames that are dropped as a result. Block the fourth
+	// image by putting a directory in its place.
+	{
+		const VDStringW prefix = dir.MakePath(L"err");
+		const VDStringW blockedPath = ATTestVWFramePath(prefix, 3);
+		VDCreateDirectory(blockedPath.c_str());
+
+		ATTestVWDriver vw(prefix);
+
+		bool errorReported = false;
+		for(uint32 i = 0; i < 1000 && !errorReported; ++i) {
+			vw.WriteFrame(i);
+
+			try {
+				vw->CheckExceptions();
+			} catch(const MyError&) {
+				errorReported = true;
+			}
+
+			if (!errorReported)
+				VDThreadSleep(1);
+		}
+
+		AT_TEST_ASSERT(errorReported);
+
+		// Recording keeps accepting frames after the error until it is
+		// stopped, without stalling the caller.
+		for(uint32 i = 0; i < 10; ++i)
+			vw.WriteFrame(i);
+
+		vw->Shutdown();
+
+		// The error is only reported once.
+		vw->CheckExceptions();
+
+		for(uint32 i = 0; i < 3; ++i)
+			AT_TEST_ASSERT(ATTestVWDecodeFrame(ATTestVWFramePath(prefix, i)) >= 0);
+
+		const uint32 blockedAttrs = VDFileGetAttributes(blockedPath.c_str());
+		AT_TEST_ASSERT(blockedAttrs != kVDFileAttr_Invalid && (blockedAttrs & kVDFileAttr_Directory));
+	}
+
+	// Drive the PNG sequence encoder directly with a fixed mix of new and
+	// repeated frames. The images are compressed in parallel and can finish
+	// in any order, but must still be numbered consecutively from the first
+	// frame, each holding the frame that was current when it was queued.
+	{
+		const VDStringW prefix = dir.MakePath(L"direct");
+		vdautoptr<IATMediaEncoder> encoder(ATCreateMediaEncoderPNGSequence((prefix + L".png").c_str(), false));
+
+		// there is nothing to repeat yet, so this must not use up a number
+		encoder->WriteRepeatedVideo();
+
+		VDPixmapBuffer frame(kATTestVWWidth, kATTestVWHeight, nsVDPixmap::kPixFormat_XRGB8888);
+		vdfastvector<uint32> expectedFrames;
+
+		for(uint32 i = 0; i < 60; ++i) {
+			ATTestVWFillFrame(frame, i);
+			encoder->WriteVideo(frame);
+			expectedFrames.push_back(i);
+
+			// the encoder must not refer back to the caller's frame
+			memset(frame.data, 0xFF, frame.pitch * (size_t)kATTestVWHeight);
+
+			for(uint32 j = 0; j < i % 3; ++j) {
+				encoder->WriteRepeatedVideo();
+				expectedFrames.push_back(i);
+			}
+		}
+
+		MyError e;
+		AT_TEST_ASSERT(encoder->Finalize(e));
+		encoder.reset();
+
+		const uint32 imageCount = (uint32)expectedFrames.size();
+		for(uint32 i = 0; i < imageCount; ++i) {
+			const sint32 frameIndex = ATTestVWDecodeFrame(ATTestVWFramePath(prefix, i));
+
+			AT_TEST_ASSERTF(frameIndex == (sint32)expectedFrames[i], "Image %u holds frame %d instead of frame %u", i, frameIndex, expectedFrames[i]);
+		}
+
+		AT_TEST_ASSERT(!VDDoesPathExist(ATTestVWFramePath(prefix, imageCount).c_str()));
+	}
+
+	return 0;
+}
@@ -16,11 +16,307 @@
 //	with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdafx.h>
+#include <vd2/system/binary.h>
+#include <vd2/system/filesys.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/vdstl_hashmap.h>
 #include <at/atcore/propertyset.h>
 #include "blockdevvirtfat32.h"
 #include "idevhdimage.h"
 #include "test.h"
 
+namespace {
+	struct ATTestVFATFile {
+		VDStringW mName;
+		uint8 mShortName[11];
+		vdfastvector<uint8> mData;
+		uint32 mStartCluster;
+	};
+
+	// Read back a virtual FAT volume the way a FAT driver would, checking
+	// that both FATs match, that every chain is the right length and ends
+	// properly, and that no cluster is used twice or left allocated without
+	// an owner.
+	void ATTestVFATParse(IATBlockDevice& dev, bool fat16, vdvector<ATTestVFATFile>& files) {
+		files.clear();
+
+		// the volume starts after an 8-sector MBR area
+		uint8 sec[512];
+		dev.ReadSectors(sec, 8, 1);
+
+		AT_TEST_ASSERT(VDReadUnalignedLEU16(&sec[11]) == 512);
+		AT_TEST_ASSERT(sec[13] == 8);
+		AT_TEST_ASSERT(sec[16] == 2);
+
+		const uint32 reservedSectors = VDReadUnalignedLEU16(&sec[14]);
+		const uint32 rootEntries = VDReadUnalignedLEU16(&sec[17]);
+		const uint32 sectorsPerFAT = fat16 ? VDReadUnalignedLEU16(&sec[22]) : VDReadUnalignedLEU32(&sec[36]);
+		const uint32 rootDirCluster = fat16 ? 0 : VDReadUnalignedLEU32(&sec[44]);
+
+		AT_TEST_ASSERT(fat16 ? rootEntries == 512 : rootEntries == 0);
+
+		const uint32 fatStart = 8 + reservedSectors;
+		const uint32 rootDirStart = fatStart + 2 * sectorsPerFAT;
+		const uint32 dataStart = rootDirStart + rootEntries / 16;
+		const uint32 numFATEntries = sectorsPerFAT * (fat16 ? 256 : 128);
+
+		vdfastvector<uint8> fat(sectorsPerFAT * 512);
+		vdfastvector<uint8> fat2(sectorsPerFAT * 512);
+		dev.ReadSectors(fat.data(), fatStart, sectorsPerFAT);
+		dev.ReadSectors(fat2.data(), fatStart + sectorsPerFAT, sectorsPerFAT);
+		AT_TEST_ASSERT(!memcmp(fat.data(), fat2.data(), fat.size()));
+
+		const uint32 terminator = fat16 ? 0xFFF8 : 0x0FFFFFF8;
+		vdfastvector<bool> clusterUsed(numFATEntries, false);
+		uint32 clustersUsed = 0;
+
+		const auto readChain = [&](uint32 startCluster, uint32 clusterCount, vdfastvector<uint8>& data) {
+			uint32 cluster = startCluster;
+
+			for(uint32 i = 0; i < clusterCount; ++i) {
+				AT_TEST_ASSERT(cluster >= 2 && cluster < numFATEntries);
+				AT_TEST_ASSERT(!clusterUsed[cluster]);
+				clusterUsed[cluster] = true;
+				++clustersUsed;
+
+				const size_t offset = data.size();
+				data.resize(offset + 4096);
+				dev.ReadSectors(data.data() + offset, dataStart + (cluster - 2) * 8, 8);
+
+				cluster = fat16 ? VDReadUnalignedLEU16(&fat[cluster * 2]) : VDReadUnalignedLEU32(&fat[cluster * 4]) & 0x0FFFFFFF;
+			}
+
+			AT_TEST_ASSERT(cluster >= terminator);
+		};
+
+		// read the whole root directory
+		vdfastvector<uint8> dir;
+		if (fat16) {
+			dir.resize(rootEntries * 32);
+			dev.ReadSectors(dir.data(), rootDirStart, rootEntries / 16);
+		} else {
+			uint32 rootDirClusters = 0;
+
+			for(uint32 cluster = rootDirCluster; cluster >= 2 && cluster < terminator; ++rootDirClusters) {
+				AT_TEST_ASSERT(rootDirClusters < numFATEntries);
+				cluster = VDReadUnalignedLEU32(&fat[cluster * 4]) & 0x0FFFFFFF;
+			}
+
+			readChain(rootDirCluster, rootDirClusters, dir);
+		}
+
+		vdhashmap<VDStringW, uint32> nameLookup;
+		vdfastvector<uint16> longName;
+		const size_t numDirEntries = dir.size() / 32;
+
+		AT_TEST_ASSERT(numDirEntries >= 1 && dir[11] == 0x08);
+
+		for(size_t i = 1; i < numDirEntries; ++i) {
+			const uint8 *ent = &dir[i * 32];
+
+			if (!ent[0])
+				break;
+
+			AT_TEST_ASSERT(ent[0] != 0xE5);
+
+			if (ent[11] == 0x0F) {
+				// long name entries come last segment first
+				static constexpr uint8 kCharOffsets[13] { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+
+				if (ent[0] & 0x40)
+					longName.clear();
+
+				uint16 chars[13];
+				for(int j = 0; j < 13; ++j)
+					chars[j] = VDReadUnalignedLEU16(&ent[kCharOffsets[j]]);
+
+				longName.insert(longName.begin(), chars, chars + 13);
+				continue;
+			}
+
+			AT_TEST_ASSERT(!(ent[11] & 0x18));
+
+			ATTestVFATFile& file = files.push_back();
+			memcpy(file.mShortName, ent, 11);
+
+			if (!longName.empty()) {
+				for(uint16 c : longName) {
+					if (!c || c == 0xFFFF)
+						break;
+
+					file.mName += (wchar_t)c;
+				}
+
+				longName.clear();
+			} else {
+				for(int j = 0; j < 8 && ent[j] != ' '; ++j)
+					file.mName += (wchar_t)ent[j];
+
+				if (ent[8] != ' ') {
+					file.mName += L'.';
+
+					for(int j = 8; j < 11 && ent[j] != ' '; ++j)
+						file.mName += (wchar_t)ent[j];
+				}
+			}
+
+			AT_TEST_ASSERT(nameLookup.insert(file.mName).second);
+
+			const uint32 size = VDReadUnalignedLEU32(&ent[28]);
+			file.mStartCluster = ((uint32)VDReadUnalignedLEU16(&ent[20]) << 16) + VDReadUnalignedLEU16(&ent[26]);
+
+			if (size) {
+				readChain(file.mStartCluster, (size + 4095) >> 12, file.mData);
+				file.mData.resize(size);
+			} else
+				AT_TEST_ASSERT(file.mStartCluster == 0);
+		}
+
+		// short names must be unique too
+		for(size_t i = 0; i < files.size(); ++i) {
+			for(size_t j = i + 1; j < files.size(); ++j)
+				AT_TEST_ASSERT(memcmp(files[i].mShortName, files[j].mShortName, 11));
+		}
+
+		// every allocated cluster must belong to a chain
+		uint32 clustersAllocated = 0;
+		for(uint32 i = 2; i < numFATEntries; ++i) {
+			if (fat16 ? VDReadUnalignedLEU16(&fat[i * 2]) : VDReadUnalignedLEU32(&fat[i * 4]) & 0x0FFFFFFF)
+				++clustersAllocated;
+		}
+
+		AT_TEST_ASSERT(clustersAllocated == clustersUsed);
+	}
+
+	typedef vdhashmap<VDStringW, vdfastvector<uint8>> ATTestVFATTree;
+
+	bool ATTestVFATMatches(const vdvector<ATTestVFATFile>& files, const ATTestVFATTree& tree) {
+		if (files.size() != tree.size())
+			return false;
+
+		for(const ATTestVFATFile& file : files) {
+			auto it = tree.find(file.mName);
+
+			if (it == tree.end() || it->second.size() != file.mData.size() || memcmp(it->second.data(), file.mData.data(), file.mData.size()))
+				return false;
+		}
+
+		return true;
+	}
+
+	void ATTestVFATIncremental(bool fat16) {
+		ATTestTempDirectory dir;
+		ATTestRandom rng;
+		ATTestVFATTree tree;
+
+		const auto addFile = [&](const wchar_t *name, uint32 len) {
+			vdfastvector<uint8>& data = tree[VDStringW(name)];
+
+			data.resize(len);
+			for(uint8& v : data)
+				v = (uint8)rng.Next();
+
+			dir.AddFile(name, data.data(), data.size());
+		};
+
+		const auto removeFile = [&](const wchar_t *name) {
+			tree.erase(VDStringW(name));
+			AT_TEST_ASSERT(VDRemoveFile(dir.MakePath(name).c_str()));
+		};
+
+		addFile(L"KEEP.BIN", 10000);
+		addFile(L"GROW.BIN", 3000);
+		addFile(L"SHRINK.BIN", 20000);
+		addFile(L"Remove me.dat", 5000);
+		addFile(L"EMPTY.BIN", 0);
+		addFile(L"Same size rewrite.bin", 4096);
+
+		ATPropertySet pset;
+		pset.SetString("path", dir.GetPath());
+
+		vdrefptr<ATBlockDeviceVFAT32> dev(new ATBlockDeviceVFAT32(fat16));
+		dev->SetSettings(pset);
+		dev->Init();
+
+		vdvector<ATTestVFATFile> files;
+		ATTestVFATParse(*dev, fat16, files);
+		AT_TEST_ASSERT(ATTestVFATMatches(files, tree));
+
+		for(int step = 0; step < 3; ++step) {
+			// let go of the file the device has open, so it can be rewritten
+			dev->WarmReset();
+
+			switch(step) {
+				case 0:
+					removeFile(L"Remove me.dat");
+					addFile(L"GROW.BIN", 9000);
+					addFile(L"SHRINK.BIN", 100);
+					addFile(L"Same size rewrite.bin", 4096);
+					addFile(L"EMPTY.BIN", 1);
+					addFile(L"New file with a long name.xex", 7000);
+					break;
+
+				case 1:
+					// enough entries to push the FAT32 root directory past
+					// one cluster
+					for(uint32 i = 0; i < 150; ++i)
+						addFile(VDStringW().sprintf(L"F%03u.BIN", i).c_str(), 1 + i * 37);
+					break;
+
+				case 2:
+					for(uint32 i = 0; i < 150; i += 2)
+						removeFile(VDStringW().sprintf(L"F%03u.BIN", i).c_str());
+
+					removeFile(L"KEEP.BIN");
+					addFile(L"Another long name after removal.bin", 12345);
+					break;
+			}
+
+			// The directory watcher reports changes asynchronously, so the
+			// rescan may be skipped until it has caught up.
+			vdvector<ATTestVFATFile> prevFiles(std::move(files));
+
+			for(int tries = 0; ; ++tries) {
+				dev->RescanDynamicDisk();
+				ATTestVFATParse(*dev, fat16, files);
+
+				if (ATTestVFATMatches(files, tree))
+					break;
+
+				AT_TEST_ASSERTF(tries < 500, "Incremental rescan did not pick up changes (step %d)", step);
+				VDThreadSleep(10);
+			}
+
+			// files that kept their size must also have kept their clusters
+			for(const ATTestVFATFile& prevFile : prevFiles) {
+				for(const ATTestVFATFile& file : files) {
+					if (file.mName == prevFile.mName && file.mData.size() == prevFile.mData.size())
+						AT_TEST_ASSERT(file.mStartCluster == prevFile.mStartCluster);
+				}
+			}
+
+			// and the volume must hold the same files as one built from scratch
+			vdrefptr<ATBlockDeviceVFAT32> dev2(new ATBlockDeviceVFAT32(fat16));
+			dev2->SetSettings(pset);
+			dev2->Init();
+
+			vdvector<ATTestVFATFile> files2;
+			ATTestVFATParse(*dev2, fat16, files2);
+			AT_TEST_ASSERT(ATTestVFATMatches(files2, tree));
+
+			dev2->Shutdown();
+		}
+
+		dev->Shutdown();
+	}
+}
+
+DEFINE_TEST(IO_VirtFATIncremental) {
+	ATTestVFATIncremental(true);
+	ATTestVFATIncremental(false);
+	return 0;
+}
+
 DEFINE_TEST_NONAUTO(IO_VirtFAT16) {
 	vdrefptr<ATBlockDeviceVFAT32> vfImage(new ATBlockDeviceVFAT32(true));
 	ATPropertySet pset;
@@ -0,0 +1,477 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/cpuaccel.h>
+#include <vd2/system/file.h>
+#include <vd2/system/threadpool.h>
+#include <vd2/system/vdalloc.h>
+#include <vd2/system/zip.h>
+#include <vd2/Kasumi/pixmap.h>
+#include <vd2/Kasumi/pixmaputils.h>
+#include "videoencoder.h"
+#include "test.h"
+
+namespace {
+	int ATTestZMBVPopCount(uint32 v) {
+		int n = 0;
+
+		while(v) {
+			v &= v - 1;
+			++n;
+		}
+
+		return n;
+	}
+
+	bool ATTestZMBVEqual(const vdfastvector<uint8>& a, const vdfastvector<uint8>& b) {
+		return a.size() == b.size() && (a.empty() || !memcmp(a.data(), b.data(), a.size()));
+	}
+
+	void ATTestZMBVCheckKernels(const ATZMBVKernels& kernels, const ATZMBVKernels& ref, bool rgb32, ATTestRandom& rng) {
+		const uint32 bpp = rgb32 ? 4 : 1;
+		const ptrdiff_t pitch = 16 * bpp * 3;
+
+		// Blocks are taken from the middle of the buffer so that reference
+		// blocks can be offset in any direction, as with motion vectors.
+		vdblock<uint8> srcbuf(pitch * 48 + 16);
+		vdblock<uint8> refbuf(pitch * 48 + 16);
+		uint8 *const srcBase = srcbuf.data() + ((0 - (uintptr)srcbuf.data()) & 15) + pitch * 16 + 16 * bpp;
+		uint8 *const refBase = refbuf.data() + pitch * 16 + 16 * bpp;
+
+		for(int iter = 0; iter < 2000; ++iter) {
+			const uint32 h = 1 + rng.Next(16);
+			const int dx = (int)rng.Next(33) - 16;
+			const int dy = (int)rng.Next(33) - 16;
+			uint8 *refBlock = refBase + dy * pitch + dx * (int)bpp;
+
+			for(uint8& v : srcbuf)
+				v = (uint8)rng.Next();
+
+			for(uint8& v : refbuf)
+				v = (uint8)rng.Next();
+
+			// Mix fully random, nearly identical, fully inverted, and
+			// identical blocks so that both small and maximal bit counts
+			// are covered.
+			const int mode = iter % 4;
+
+			for(uint32 y = 0; y < 16; ++y) {
+				for(uint32 x = 0; x < 16 * bpp; ++x) {
+					const uint8 s = srcBase[pitch * y + x];
+					uint8& r = refBlock[pitch * y + x];
+
+					switch(mode) {
+						case 1: r = rng.Next(16) ? s : r; break;
+						case 2: r = ~s; break;
+						case 3: r = s; break;
+					}
+				}
+			}
+
+			// block difference for full width blocks
+			const int diff = ref.mpBlockDiff16(srcBase, refBlock, pitch, 16, h);
+
+			AT_TEST_ASSERTF(kernels.mpBlockDiff16(srcBase, refBlock, pitch, 16, h) == diff, "BlockDiff16 mismatch: rgb32=%d h=%u dx=%d dy=%d", rgb32, h, dx, dy);
+			AT_TEST_ASSERT(kernels.mpBlockDiff(srcBase, refBlock, pitch, 16, h) == diff);
+
+			// block difference for partial blocks against a plain bit count
+			const uint32 w = 1 + rng.Next(16);
+			int expectedDiff = 0;
+
+			for(uint32 y = 0; y < h; ++y) {
+				for(uint32 x = 0; x < w * bpp; ++x) {
+					if (rgb32 && (x & 3) == 3)
+						continue;
+
+					expectedDiff += ATTestZMBVPopCount(srcBase[pitch * y + x] ^ refBlock[pitch * y + x]);
+				}
+			}
+
+			AT_TEST_ASSERT(kernels.mpBlockDiff(srcBase, refBlock, pitch, w, h) == expectedDiff);
+
+			if (w == 16)
+				AT_TEST_ASSERT(diff == expectedDiff);
+
+			// XOR for full width blocks
+			uint8 xor0[16*16*4];
+			uint8 xor1[16*16*4];
+			memset(xor0, 0xCD, sizeof xor0);
+			memset(xor1, 0xCD, sizeof xor1);
+
+			ref.mpComputeXor16(xor0, srcBase, refBlock, pitch, 16 * bpp, h);
+			kernels.mpComputeXor16(xor1, srcBase, refBlock, pitch, 16 * bpp, h);
+			AT_TEST_ASSERTF(!memcmp(xor0, xor1, sizeof xor0), "ComputeXor16 mismatch: rgb32=%d h=%u dx=%d dy=%d", rgb32, h, dx, dy);
+
+			for(uint32 y = 0; y < h; ++y) {
+				for(uint32 x = 0; x < 16 * bpp; ++x) {
+					uint8 v = srcBase[pitch * y + x] ^ refBlock[pitch * y + x];
+
+					if (rgb32 && (x & 3) == 3)
+						v = 0;
+
+					AT_TEST_ASSERT(xor0[16 * bpp * y + x] == v);
+				}
+			}
+
+			// XOR for partial blocks, which keeps all bytes
+			memset(xor1, 0xCD, sizeof xor1);
+			kernels.mpComputeXor(xor1, srcBase, refBlock, pitch, w * bpp, h);
+
+			for(uint32 y = 0; y < h; ++y) {
+				for(uint32 x = 0; x < w * bpp; ++x)
+					AT_TEST_ASSERT(xor1[w * bpp * y + x] == (srcBase[pitch * y + x] ^ refBlock[pitch * y + x]));
+			}
+
+			if (w * bpp * h < sizeof xor1)
+				AT_TEST_ASSERT(xor1[w * bpp * h] == 0xCD);
+		}
+	}
+
+	// Minimal ZMBV decoder. Frames are decoded a keyframe group at a time,
+	// since the deflate stream runs across all frames from a keyframe up to
+	// the next one.
+	class ATTestZMBVDecoder {
+	public:
+		ATTestZMBVDecoder(uint32 w, uint32 h, bool rgb32)
+			: mWidth(w), mHeight(h), mBpp(rgb32 ? 4 : 1)
+		{
+			mFrame.resize(w * h * mBpp, 0);
+		}
+
+		void DecodeGroup(const vdvector<vdfastvector<uint8>>& frames, vdvector<vdfastvector<uint8>>& decodedFrames, vdvector<vdfastvector<uint8>>& payloads);
+
+	private:
+		void ReadPayload(IVDStream& stream, vdfastvector<uint8>& payload, uint32 len) {
+			const size_t offset = payload.size();
+			payload.resize(offset + len);
+			stream.Read(payload.data() + offset, (sint32)len);
+		}
+
+		const uint32 mWidth;
+		const uint32 mHeight;
+		const uint32 mBpp;
+		vdfastvector<uint8> mFrame;
+	};
+
+	void ATTestZMBVDecoder::DecodeGroup(const vdvector<vdfastvector<uint8>>& frames, vdvector<vdfastvector<uint8>>& decodedFrames, vdvector<vdfastvector<uint8>>& payloads) {
+		// Join the deflate data of all frames and terminate it with an empty
+		// final block; the encoder never ends the stream itself.
+		vdfastvector<uint8> zdata;
+
+		for(const vdfastvector<uint8>& frame : frames) {
+			if (frame.empty())
+				continue;
+
+			if (frame[0] & 1) {
+				AT_TEST_ASSERT(&frame == &frames.front());
+				AT_TEST_ASSERT(frame.size() >= 9);
+				AT_TEST_ASSERT(frame[1] == 0 && frame[2] == 1 && frame[3] == 1);
+				AT_TEST_ASSERT(frame[4] == (mBpp == 4 ? 8 : 4));
+				AT_TEST_ASSERT(frame[5] == 16 && frame[6] == 16);
+
+				// zlib header
+				AT_TEST_ASSERT(((frame[7] << 8) + frame[8]) % 31 == 0);
+				AT_TEST_ASSERT((frame[7] & 0x0F) == 8);
+
+				zdata.insert(zdata.end(), frame.begin() + 9, frame.end());
+			} else {
+				AT_TEST_ASSERT(frame[0] == 0);
+				zdata.insert(zdata.end(), frame.begin() + 1, frame.end());
+			}
+		}
+
+		zdata.push_back(0x03);
+		zdata.push_back(0x00);
+
+		VDMemoryStream ms(zdata.data(), (uint32)zdata.size());
+		vdautoptr<VDInflateStream<false>> inflater(new VDInflateStream<false>);
+		inflater->Init(&ms, zdata.size(), false);
+
+		const uint32 w = mWidth;
+		const uint32 h = mHeight;
+		const uint32 bpp = mBpp;
+		const uint32 bw = (w + 15) >> 4;
+		const uint32 bh = (h + 15) >> 4;
+		const uint32 bcount = bw * bh;
+
+		for(const vdfastvector<uint8>& frame : frames) {
+			vdfastvector<uint8>& payload = payloads.emplace_back();
+
+			if (frame.empty()) {
+				// dropped frame, repeats the previous one
+			} else if (frame[0] & 1) {
+				if (bpp == 1)
+					ReadPayload(*inflater, payload, 768);
+
+				ReadPayload(*inflater, payload, w * h * bpp);
+				memcpy(mFrame.data(), payload.data() + payload.size() - w * h * bpp, w * h * bpp);
+			} else {
+				ReadPayload(*inflater, payload, 2 * (bcount + (bcount & 1)));
+
+				const vdfastvector<uint8> prev(mFrame);
+
+				for(uint32 by = 0; by < bh; ++by) {
+					for(uint32 bx = 0; bx < bw; ++bx) {
+						// copy the vector out, as reading XOR data grows the payload
+						const uint8 mv0 = payload[(by * bw + bx) * 2];
+						const uint8 mv1 = payload[(by * bw + bx) * 2 + 1];
+						const bool hasXor = (mv0 & 1) != 0;
+						const int dx = (sint8)mv0 >> 1;
+						const int dy = (sint8)mv1 >> 1;
+						const uint32 x0 = bx * 16;
+						const uint32 y0 = by * 16;
+						const uint32 blockw = std::min<uint32>(16, w - x0);
+						const uint32 blockh = std::min<uint32>(16, h - y0);
+
+						size_t xorOffset = 0;
+						if (hasXor) {
+							xorOffset = payload.size();
+							ReadPayload(*inflater, payload, blockw * blockh * bpp);
+						}
+
+						for(uint32 y = 0; y < blockh; ++y) {
+							for(uint32 x = 0; x < blockw; ++x) {
+								const int sx = (int)(x0 + x) + dx;
+								const int sy = (int)(y0 + y) + dy;
+								uint8 *dst = &mFrame[((y0 + y) * w + x0 + x) * bpp];
+
+								for(uint32 i = 0; i < bpp; ++i) {
+									uint8 v = 0;
+
+									if (sx >= 0 && sy >= 0 && sx < (int)w && sy < (int)h)
+										v = prev[(sy * w + sx) * bpp + i];
+
+									if (hasXor)
+										v ^= payload[xorOffset + (y * blockw + x) * bpp + i];
+
+									dst[i] = v;
+								}
+							}
+						}
+					}
+				}
+			}
+
+			decodedFrames.push_back(mFrame);
+		}
+	}
+
+	// Encode a frame sequence with the given settings and check that it
+	// decodes back to the source. Returns the decompressed payload of each
+	// frame.
+	vdvector<vdfastvector<uint8>> ATTestZMBVEncodeDecode(const vdvector<VDPixmapBuffer>& frames, const bool *intra, const bool *encodeAll, bool rgb32, uint32 threadCount, uint32 bandBlockRows) {
+		const uint32 w = frames[0].w;
+		const uint32 h = frames[0].h;
+		const uint32 bpp = rgb32 ? 4 : 1;
+
+		VDThreadPool threadPool;
+		if (threadCount)
+			threadPool.Start(threadCount, "ZMBV test");
+
+		vdautoptr<IATVideoEncoder> encoder(ATCreateVideoEncoderZMBV(w, h, rgb32, threadPool, bandBlockRows));
+		ATTestZMBVDecoder decoder(w, h, rgb32);
+
+		vdvector<vdfastvector<uint8>> payloads;
+		vdvector<vdfastvector<uint8>> group;
+		vdvector<vdfastvector<uint8>> decodedFrames;
+		const size_t n = frames.size();
+
+		for(size_t i = 0; i <= n; ++i) {
+			if (i == n || intra[i]) {
+				if (!group.empty())
+					decoder.DecodeGroup(group, decodedFrames, payloads);
+
+				group.clear();
+			}
+
+			if (i == n)
+				break;
+
+			encoder->Compress(frames[i], intra[i], encodeAll[i]);
+
+			const uint8 *data = (const uint8 *)encoder->GetEncodedData();
+			group.emplace_back(data, data + encoder->GetEncodedLength());
+		}
+
+		AT_TEST_ASSERT(decodedFrames.size() == n);
+
+		for(size_t i = 0; i < n; ++i) {
+			const VDPixmap& src = frames[i];
+			const vdfastvector<uint8>& decoded = decodedFrames[i];
+
+			for(uint32 y = 0; y < h; ++y) {
+				const uint8 *srcRow = (const uint8 *)src.data + src.pitch * (ptrdiff_t)y;
+				const uint8 *decodedRow = decoded.data() + w * bpp * y;
+
+				for(uint32 x = 0; x < w * bpp; ++x) {
+					// ignore the dummy alpha byte
+					if (rgb32 && (x & 3) == 3)
+						continue;
+
+					AT_TEST_ASSERTF(srcRow[x] == decodedRow[x], "Frame %u mismatch at (%u,%u): threads=%u bandRows=%u", (unsigned)i, x / bpp, y, threadCount, bandBlockRows);
+				}
+			}
+		}
+
+		return payloads;
+	}
+}
+
+AT_DEFINE_TEST(IO_ZMBVKernels) {
+	ATTestRandom rng;
+
+	for(int rgb32 = 0; rgb32 < 2; ++rgb32) {
+		const ATZMBVKernels scalar = ATZMBVGetKernels_Scalar(rgb32 != 0);
+
+		ATTestZMBVCheckKernels(scalar, scalar, rgb32 != 0, rng);
+
+#if VD_CPU_X86 || VD_CPU_X64
+		if (CPUGetEnabledExtensions() & CPUF_SUPPORTS_SSE2)
+			ATTestZMBVCheckKernels(ATZMBVGetKernels_SSE2(rgb32 != 0), scalar, rgb32 != 0, rng);
+#endif
+
+#if VD_CPU_ARM64
+		ATTestZMBVCheckKernels(ATZMBVGetKernels_NEON(rgb32 != 0), scalar, rgb32 != 0, rng);
+#endif
+	}
+
+	return 0;
+}
+
+AT_DEFINE_TEST(IO_ZMBVEncoder) {
+	ATTestRandom rng;
+
+	// The size isn't a multiple of the block size, so there are partial
+	// blocks on the right and bottom, and a 32-bit frame is large enough to
+	// be deflated in several chunks.
+	static constexpr uint32 w = 328;
+	static constexpr uint32 h = 232;
+
+	for(int rgb32 = 0; rgb32 < 2; ++rgb32) {
+		const int format = rgb32 ? nsVDPixmap::kPixFormat_XRGB8888 : nsVDPixmap::kPixFormat_Pal8;
+		const uint32 bpp = rgb32 ? 4 : 1;
+
+		// Build a scene with detail at several scales so that motion search
+		// finds real matches, then a sequence that pans it, holds still, cuts
+		// to noise and back, and restarts with a new keyframe.
+		VDPixmapBuffer scene(w + 64, h + 64, format);
+		uint32 palette[256];
+
+		for(uint32 i = 0; i < 256; ++i)
+			palette[i] = rng.Next() & 0xFFFFFF;
+
+		for(sint32 y = 0; y < scene.h; ++y) {
+			uint8 *row = (uint8 *)scene.data + scene.pitch * (ptrdiff_t)y;
+
+			for(sint32 x = 0; x < scene.w; ++x) {
+				const uint32 v = ((x >> 3) * 7 + (y >> 2) * 13 + ((x ^ y) & 4 ? 3 : 0)) & 0xFF;
+
+				if (rgb32) {
+					row[x*4 + 0] = (uint8)v;
+					row[x*4 + 1] = (uint8)(v * 3 + y);
+					row[x*4 + 2] = (uint8)((x >> 3) + y);
+					row[x*4 + 3] = (uint8)rng.Next();
+				} else
+					row[x] = (uint8)v;
+			}
+		}
+
+		struct FrameDesc {
+			int mSceneX;
+			int mSceneY;
+			bool mbNoise;
+			bool mbIntra;
+			bool mbEncodeAll;
+		};
+
+		static constexpr FrameDesc kFrames[] = {
+			{ 32, 32, false, true,  false },
+			{ 35, 30, false, false, false },	// pan
+			{ 35, 30, false, false, false },	// no change, dropped
+			{ 35, 30, false, false, true  },	// no change, encoded anyway
+			{  0,  0, true,  false, false },	// cut to noise
+			{ 30, 36, false, false, false },	// cut back
+			{ 20, 40, false, true,  false },	// new keyframe
+			{ 22, 41, false, false, false },	// pan
+		};
+
+		static constexpr size_t kFrameCount = vdcountof(kFrames);
+
+		vdvector<VDPixmapBuffer> frames(kFrameCount);
+		bool intra[kFrameCount];
+		bool encodeAll[kFrameCount];
+
+		for(size_t i = 0; i < kFrameCount; ++i) {
+			const FrameDesc& fd = kFrames[i];
+			VDPixmapBuffer& frame = frames[i];
+
+			frame.init(w, h, format);
+			intra[i] = fd.mbIntra;
+			encodeAll[i] = fd.mbEncodeAll;
+
+			if (!rgb32)
+				memcpy((void *)frame.palette, palette, sizeof palette);
+
+			for(uint32 y = 0; y < h; ++y) {
+				uint8 *dst = (uint8 *)frame.data + frame.pitch * (ptrdiff_t)y;
+				const uint8 *src = (const uint8 *)scene.data + scene.pitch * (ptrdiff_t)(y + fd.mSceneY) + fd.mSceneX * bpp;
+
+				if (fd.mbNoise) {
+					for(uint32 x = 0; x < w * bpp; ++x)
+						dst[x] = (uint8)rng.Next();
+				} else
+					memcpy(dst, src, w * bpp);
+			}
+		}
+
+		// The single-threaded encode deflates each frame in one piece, while
+		// the threaded encodes split large frames into chunks, so matching
+		// payloads checks that chunked output inflates to the same data.
+		// Searching in bands gives different but equally valid vectors than
+		// searching the frame as a whole, and the bands must not depend on
+		// the thread count.
+		const auto payloads = ATTestZMBVEncodeDecode(frames, intra, encodeAll, rgb32 != 0, 0, 4);
+		const auto payloadsThreaded = ATTestZMBVEncodeDecode(frames, intra, encodeAll, rgb32 != 0, 3, 4);
+		const auto payloadsSingleBand = ATTestZMBVEncodeDecode(frames, intra, encodeAll, rgb32 != 0, 3, 0);
+		const auto payloadsSingleBandST = ATTestZMBVEncodeDecode(frames, intra, encodeAll, rgb32 != 0, 0, 0);
+
+		for(size_t i = 0; i < kFrameCount; ++i) {
+			AT_TEST_ASSERTF(ATTestZMBVEqual(payloads[i], payloadsThreaded[i]), "Threaded payload mismatch on frame %u", (unsigned)i);
+			AT_TEST_ASSERTF(ATTestZMBVEqual(payloadsSingleBand[i], payloadsSingleBandST[i]), "Threaded single band payload mismatch on frame %u", (unsigned)i);
+		}
+
+		// Banding only changes motion vector prediction, so keyframes are
+		// unaffected.
+		AT_TEST_ASSERT(ATTestZMBVEqual(payloads[0], payloadsSingleBand[0]));
+		AT_TEST_ASSERT(ATTestZMBVEqual(payloads[6], payloadsSingleBand[6]));
+
+		// the frame with no changes is dropped, and the next one is not
+		AT_TEST_ASSERT(payloads[2].empty());
+		AT_TEST_ASSERT(!payloads[3].empty());
+
+		// Panned frames should be coded mostly as motion vectors, in both
+		// search modes.
+		for(const auto *p : { &payloads, &payloadsSingleBand }) {
+			const uint32 frameBytes = w * h * bpp;
+
+			AT_TEST_ASSERT((*p)[1].size() < frameBytes / 4);
+			AT_TEST_ASSERT((*p)[7].size() < frameBytes / 4);
+		}
+	}
+
+	return 0;
+}
@@ -2,10 +2,47 @@
 #include <vd2/system/cpuaccel.h>
 #include <vd2/system/filesys.h>
 #include <vd2/system/memory.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/threadpool.h>
+#include <vd2/system/time.h>
+#include <vd2/system/vdalloc.h>
+#include <vd2/Kasumi/blitter.h>
 #include <vd2/Kasumi/pixmap.h>
+#include <vd2/Kasumi/pixmaputils.h>
 #include <vd2/Kasumi/resample.h>
 #include "test.h"
 
+namespace {
+	void ATTestKasumiFillNoise(VDPixmapBuffer& buf, uint32 seed) {
+		ATTestRandom rng(seed);
+		uint8 *p = (uint8 *)buf.base();
+
+		for(size_t i = 0, n = buf.size(); i < n; ++i)
+			p[i] = (uint8)rng.Next();
+	}
+
+	bool ATTestKasumiInitResampler(IVDPixmapResampler& r, const VDPixmap& dst, const VDPixmap& src) {
+		// use an inset, fractional destination rect to exercise clipping and
+		// partial coverage
+		const vdrect32f dstRect(3.5f, 2.25f, (float)dst.w - 5.0f, (float)dst.h - 1.5f);
+
+		return r.Init(dstRect, dst.w, dst.h, dst.format, vdrect32f(0.0f, 0.0f, (float)src.w, (float)src.h), src.w, src.h, src.format);
+	}
+
+	bool ATTestKasumiResample(VDPixmapBuffer& dst, const VDPixmapBuffer& src, IVDPixmapResampler::FilterMode filterMode, VDThreadPool *threadPool) {
+		vdautoptr<IVDPixmapResampler> r(VDCreatePixmapResampler());
+
+		r->SetFilters(filterMode, filterMode, false);
+		r->SetThreadPool(threadPool);
+
+		if (!ATTestKasumiInitResampler(*r, dst, src))
+			return false;
+
+		r->Process(dst, src);
+		return true;
+	}
+}
+
 AT_DEFINE_TEST_NONAUTO(Kasumi_Resampler) {
 	uint8 dst[32*32];
 	uint8 src[33*32];
@@ -60,3 +97,168 @@ AT_DEFINE_TEST_NONAUTO(Kasumi_Resampler) {
 
 	return 0;
 }
+
+AT_DEFINE_TEST(Kasumi_ResamplerBanded) {
+	VDThreadPool threadPool;
+	threadPool.Start(3, "Test resampler worker");
+
+	static constexpr IVDPixmapResampler::FilterMode kFilterModes[]={
+		IVDPixmapResampler::kFilterPoint,
+		IVDPixmapResampler::kFilterLinear,
+		IVDPixmapResampler::kFilterCubic,
+		IVDPixmapResampler::kFilterLanczos3,
+	};
+
+	static constexpr int kFormats[]={
+		nsVDPixmap::kPixFormat_XRGB8888,
+		nsVDPixmap::kPixFormat_Y8,
+		nsVDPixmap::kPixFormat_YUV420_Planar,
+	};
+
+	for(int format : kFormats) {
+		VDPixmapBuffer src(173, 129, format);
+		ATTestKasumiFillNoise(src, 12345);
+
+		for(const auto& [dw, dh] : { std::pair(421, 317), std::pair(97, 75) }) {
+			for(IVDPixmapResampler::FilterMode filterMode : kFilterModes) {
+				VDPixmapBuffer serial(dw, dh, format);
+				VDPixmapBuffer banded(dw, dh, format);
+				memset(serial.base(), 0xCD, serial.size());
+				memset(banded.base(), 0xCD, banded.size());
+
+				TEST_ASSERT(ATTestKasumiResample(serial, src, filterMode, nullptr));
+				TEST_ASSERT(ATTestKasumiResample(banded, src, filterMode, &threadPool));
+				TEST_ASSERTF(!memcmp(serial.base(), banded.base(), serial.size()), "Banded resample mismatch: format %d, %dx%d, filter %d", format, dw, dh, (int)filterMode);
+			}
+		}
+	}
+
+	// plain conversions, including ones with subsampled chroma planes
+	static constexpr std::pair<int, int> kConversions[]={
+		{ nsVDPixmap::kPixFormat_XRGB8888, nsVDPixmap::kPixFormat_YUV420_Planar },
+		{ nsVDPixmap::kPixFormat_YUV420_Planar, nsVDPixmap::kPixFormat_XRGB8888 },
+		{ nsVDPixmap::kPixFormat_YUV422_UYVY, nsVDPixmap::kPixFormat_YUV420_Planar_709 },
+		{ nsVDPixmap::kPixFormat_XRGB8888, nsVDPixmap::kPixFormat_RGB565 },
+	};
+
+	for(const auto& [srcFormat, dstFormat] : kConversions) {
+		VDPixmapBuffer src(322, 241, srcFormat);
+		ATTestKasumiFillNoise(src, 67890);
+
+		VDPixmapBuffer serial(322, 241, dstFormat);
+		VDPixmapBuffer banded(322, 241, dstFormat);
+		memset(serial.base(), 0xCD, serial.size());
+		memset(banded.base(), 0xCD, banded.size());
+
+		vdautoptr<IVDPixmapBlitter> serialBlitter(VDPixmapCreateBlitter(serial, src));
+		vdautoptr<IVDPixmapBlitter> bandedBlitter(VDPixmapCreateBlitter(banded, src, threadPool));
+
+		serialBlitter->Blit(serial, src);
+		bandedBlitter->Blit(banded, src);
+
+		TEST_ASSERTF(!memcmp(serial.base(), banded.base(), serial.size()), "Banded blit mismatch: format %d -> %d", srcFormat, dstFormat);
+	}
+
+	return 0;
+}
+
+AT_DEFINE_TEST(Kasumi_ResamplerAVX2) {
+	// The AVX2 stages must reproduce the SSE2 stages exactly, so resample with
+	// AVX2 masked off and compare against the unmasked run.
+	const long ex = CPUCheckForExtensions();
+
+#if VD_CPU_X86 || VD_CPU_X64
+	const long exNoAVX2 = ex & ~CPUF_SUPPORTS_AVX2;
+#else
+	const long exNoAVX2 = ex;
+#endif
+
+	static constexpr IVDPixmapResampler::FilterMode kFilterModes[]={
+		IVDPixmapResampler::kFilterPoint,
+		IVDPixmapResampler::kFilterLinear,
+		IVDPixmapResampler::kFilterCubic,
+		IVDPixmapResampler::kFilterLanczos3,
+		IVDPixmapResampler::kFilterSharpLinear,
+	};
+
+	static constexpr int kFormats[]={
+		nsVDPixmap::kPixFormat_XRGB8888,
+		nsVDPixmap::kPixFormat_Y8,
+		nsVDPixmap::kPixFormat_YUV420_Planar,
+	};
+
+	for(int format : kFormats) {
+		VDPixmapBuffer src(173, 129, format);
+		ATTestKasumiFillNoise(src, 24680);
+
+		// sizes that leave partial vectors at the ends of rows
+		for(const auto& [dw, dh] : { std::pair(421, 317), std::pair(97, 75), std::pair(61, 45) }) {
+			for(IVDPixmapResampler::FilterMode filterMode : kFilterModes) {
+				VDPixmapBuffer ref(dw, dh, format);
+				VDPixmapBuffer test(dw, dh, format);
+				memset(ref.base(), 0xCD, ref.size());
+				memset(test.base(), 0xCD, test.size());
+
+				CPUEnableExtensions(exNoAVX2);
+				const bool refOK = ATTestKasumiResample(ref, src, filterMode, nullptr);
+
+				CPUEnableExtensions(ex);
+				const bool testOK = ATTestKasumiResample(test, src, filterMode, nullptr);
+
+				TEST_ASSERT(refOK && testOK);
+				TEST_ASSERTF(!memcmp(ref.base(), test.base(), ref.size()), "AVX2 resample mismatch: format %d, %dx%d, filter %d", format, dw, dh, (int)filterMode);
+			}
+		}
+	}
+
+	CPUEnableExtensions(ex);
+	return 0;
+}
+
+AT_DEFINE_TEST_NONAUTO(Kasumi_ResamplerBench) {
+	// Typical video recording upscale: full overscan frame to 1080p.
+	VDPixmapBuffer src(456, 262, nsVDPixmap::kPixFormat_XRGB8888);
+	VDPixmapBuffer serial(1920, 1080, nsVDPixmap::kPixFormat_XRGB8888);
+	VDPixmapBuffer banded(1920, 1080, nsVDPixmap::kPixFormat_XRGB8888);
+
+	ATTestKasumiFillNoise(src, 1);
+
+	const uint32 maxThreads = VDGetLogicalProcessorCount();
+	double baseTime = 0;
+
+	for(IVDPixmapResampler::FilterMode filterMode : { IVDPixmapResampler::kFilterLinear, IVDPixmapResampler::kFilterLanczos3 }) {
+		memset(serial.base(), 0, serial.size());
+		TEST_ASSERT(ATTestKasumiResample(serial, src, filterMode, nullptr));
+
+		for(uint32 threads = 1; threads <= maxThreads; threads += threads) {
+			VDThreadPool threadPool;
+
+			if (threads > 1)
+				threadPool.Start(threads - 1, "Test resampler worker");
+
+			vdautoptr<IVDPixmapResampler> r(VDCreatePixmapResampler());
+			r->SetFilters(filterMode, filterMode, false);
+			r->SetThreadPool(threads > 1 ? &threadPool : nullptr);
+			TEST_ASSERT(ATTestKasumiInitResampler(*r, banded, src));
+
+			memset(banded.base(), 0, banded.size());
+
+			static constexpr int kIterations = 100;
+			const uint64 t0 = VDGetPreciseTick();
+
+			for(int i=0; i<kIterations; ++i)
+				r->Process(banded, src);
+
+			const double t = (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick() / (double)kIterations;
+
+			if (threads == 1)
+				baseTime = t;
+
+			printf("%s, %2u thread(s): %7.2fms/frame (%.2fx)\n", filterMode == IVDPixmapResampler::kFilterLinear ? "linear " : "lanczos3", threads, t * 1000.0, baseTime / t);
+
+			TEST_ASSERT(!memcmp(serial.base(), banded.base(), serial.size()));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,228 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/binary.h>
+#include <vd2/system/vdstl.h>
+#include <at/atnetwork/ethernetbus.h>
+#include <at/atnetwork/ethernetcapture.h>
+#include <at/atnetwork/ethernetframe.h>
+#include "test.h"
+#include "testnet.h"
+
+namespace {
+	constexpr ATEthernetAddr kATTestNetAdapterAddr { { 0x02, 0, 0, 0, 1, 1 } };
+	constexpr ATEthernetAddr kATTestNetEchoAddr { { 0x02, 0, 0, 0, 1, 2 } };
+	constexpr ATEthernetAddr kATTestNetBroadcastAddr { { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF } };
+	constexpr uint16 kATTestNetEtherType = 0x88B5;
+
+	// Stand-in for the emulated adapter, which sends frames on a fixed
+	// schedule and logs the frames it receives with their delivery times.
+	class ATTestNetScriptedAdapter final : public IATEthernetEndpoint, public IATEthernetClockEventSink {
+	public:
+		void Init(ATEthernetBus& bus, ATTestNetClock& clock, uint32 numFrames, uint32 alteredFrame) {
+			mpBus = &bus;
+			mpClock = &clock;
+			mNumFrames = numFrames;
+			mAlteredFrame = alteredFrame;
+			mEndpointId = bus.AddEndpoint(this);
+
+			clock.AddClockEvent(clock.GetTime() + 10, this, 0);
+		}
+
+		void Shutdown() {
+			mpBus->RemoveEndpoint(mEndpointId);
+		}
+
+		void OnClockEvent(uint32 eventid, uint32 userid) override {
+			uint8 frame[64];
+			const uint32 len = 10 + (userid * 7) % 40;
+
+			VDWriteUnalignedBEU16(frame, kATTestNetEtherType);
+
+			for(uint32 i = 2; i < len; ++i)
+				frame[i] = (uint8)(userid * 31 + i);
+
+			if (userid == mAlteredFrame)
+				frame[2] ^= 0xFF;
+
+			ATEthernetPacket pkt {};
+			pkt.mClockIndex = 0;
+			pkt.mTimestamp = 1;
+			pkt.mSrcAddr = kATTestNetAdapterAddr;
+			pkt.mDstAddr = kATTestNetEchoAddr;
+			pkt.mpData = frame;
+			pkt.mLength = len;
+			mpBus->TransmitFrame(mEndpointId, pkt);
+
+			if (userid + 1 < mNumFrames)
+				mpClock->AddClockEvent(mpClock->GetTime() + 5 + userid % 4, this, userid + 1);
+		}
+
+		void ReceiveFrame(const ATEthernetPacket& packet, ATEthernetFrameDecodedType decType, const void *decInfo) override {
+			uint8 hdr[18];
+			VDWriteUnalignedLEU32(&hdr[0], packet.mTimestamp);
+			VDWriteUnalignedLEU16(&hdr[4], (uint16)packet.mLength);
+			memcpy(&hdr[6], packet.mDstAddr.mAddr, 6);
+			memcpy(&hdr[12], packet.mSrcAddr.mAddr, 6);
+
+			mReceiveLog.insert(mReceiveLog.end(), hdr, hdr + 18);
+			mReceiveLog.insert(mReceiveLog.end(), packet.mpData, packet.mpData + packet.mLength);
+			++mFramesReceived;
+		}
+
+		ATEthernetBus *mpBus = nullptr;
+		ATTestNetClock *mpClock = nullptr;
+		uint32 mEndpointId = 0;
+		uint32 mNumFrames = 0;
+		uint32 mAlteredFrame = 0;
+		uint32 mFramesReceived = 0;
+		vdfastvector<uint8> mReceiveLog;
+	};
+
+	// Remote peer that answers each frame with a reversed copy, and with an
+	// extra broadcast frame for every fourth one.
+	class ATTestNetEchoPeer final : public IATEthernetEndpoint {
+	public:
+		void Init(ATEthernetBus& bus) {
+			mpBus = &bus;
+			mEndpointId = bus.AddEndpoint(this);
+		}
+
+		void Shutdown() {
+			mpBus->RemoveEndpoint(mEndpointId);
+		}
+
+		void ReceiveFrame(const ATEthernetPacket& packet, ATEthernetFrameDecodedType decType, const void *decInfo) override {
+			if (memcmp(packet.mDstAddr.mAddr, kATTestNetEchoAddr.mAddr, 6) || packet.mLength < 2 || VDReadUnalignedBEU16(packet.mpData) != kATTestNetEtherType)
+				return;
+
+			uint8 frame[64];
+			VDWriteUnalignedBEU16(frame, kATTestNetEtherType);
+
+			for(uint32 i = 2; i < packet.mLength; ++i)
+				frame[i] = packet.mpData[packet.mLength + 1 - i];
+
+			ATEthernetPacket pkt {};
+			pkt.mClockIndex = 0;
+			pkt.mTimestamp = 3;
+			pkt.mSrcAddr = kATTestNetEchoAddr;
+			pkt.mDstAddr = packet.mSrcAddr;
+			pkt.mpData = frame;
+			pkt.mLength = packet.mLength;
+			mpBus->TransmitFrame(mEndpointId, pkt);
+
+			if (!(++mFramesEchoed & 3)) {
+				frame[2] = (uint8)mFramesEchoed;
+
+				pkt.mTimestamp = 4;
+				pkt.mDstAddr = kATTestNetBroadcastAddr;
+				pkt.mLength = 3;
+				mpBus->TransmitFrame(mEndpointId, pkt);
+			}
+		}
+
+		ATEthernetBus *mpBus = nullptr;
+		uint32 mEndpointId = 0;
+		uint32 mFramesEchoed = 0;
+	};
+
+	void ATTestNetRunClock(ATTestNetClock& clock) {
+		while(clock.RunNextEvent())
+			AT_TEST_ASSERT(clock.GetTime() < 100000);
+	}
+
+	void ATTestNetReplayCapture(const wchar_t *path, uint32 numFrames, uint32 alteredFrame, const vdfastvector<uint8>& expectedLog) {
+		ATTestNetClock clock;
+		ATEthernetBus bus;
+		AT_TEST_ASSERT(bus.AddClock(&clock) == 0);
+
+		ATTestNetScriptedAdapter adapter;
+		adapter.Init(bus, clock, numFrames, alteredFrame);
+
+		ATEthernetCapturePlayer player;
+		player.Load(path);
+		player.Init(bus, 0);
+
+		ATTestNetRunClock(clock);
+
+		const ATEthernetCapturePlayer::Status status = player.GetStatus();
+		AT_TEST_ASSERT(player.IsFinished());
+		AT_TEST_ASSERT(status.mFramesPlayed == status.mFramesToPlay);
+		AT_TEST_ASSERT(status.mLocalFramesExpected == numFrames);
+
+		if (alteredFrame < numFrames) {
+			AT_TEST_ASSERT(status.mLocalFramesMatched == numFrames - 1);
+			AT_TEST_ASSERT(status.mLocalFramesDiverged == 1);
+		} else {
+			AT_TEST_ASSERT(status.mLocalFramesMatched == numFrames);
+			AT_TEST_ASSERT(status.mLocalFramesDiverged == 0);
+		}
+
+		// the adapter must see exactly what it saw while recording, at the
+		// same times
+		AT_TEST_ASSERT(adapter.mReceiveLog.size() == expectedLog.size());
+		AT_TEST_ASSERT(!memcmp(adapter.mReceiveLog.data(), expectedLog.data(), expectedLog.size()));
+
+		player.Shutdown();
+		adapter.Shutdown();
+	}
+}
+
+AT_DEFINE_TEST(Net_CaptureReplay) {
+	static constexpr uint32 kNumFrames = 50;
+
+	ATTestTempDirectory dir;
+	const VDStringW path = dir.MakePath(L"test.atcap");
+
+	// record a session between the adapter and the echo peer
+	vdfastvector<uint8> recordedLog;
+	uint32 recordedFrames = 0;
+	{
+		ATTestNetClock clock;
+		ATEthernetBus bus;
+		AT_TEST_ASSERT(bus.AddClock(&clock) == 0);
+
+		ATTestNetScriptedAdapter adapter;
+		ATTestNetEchoPeer peer;
+		adapter.Init(bus, clock, kNumFrames, ~UINT32_C(0));
+		peer.Init(bus);
+
+		ATEthernetCaptureWriter writer;
+		writer.Init(path.c_str(), bus, 0, adapter.mEndpointId);
+
+		ATTestNetRunClock(clock);
+
+		AT_TEST_ASSERT(adapter.mFramesReceived == kNumFrames + kNumFrames / 4);
+		AT_TEST_ASSERT(!writer.GetError());
+
+		recordedFrames = writer.GetFrameCount();
+		writer.Close();
+
+		recordedLog = adapter.mReceiveLog;
+
+		peer.Shutdown();
+		adapter.Shutdown();
+	}
+
+	AT_TEST_ASSERT(recordedFrames == kNumFrames * 2 + kNumFrames / 4);
+
+	// replay it without the peer, with the same and then different adapter output
+	ATTestNetReplayCapture(path.c_str(), kNumFrames, ~UINT32_C(0), recordedLog);
+	ATTestNetReplayCapture(path.c_str(), kNumFrames, 17, recordedLog);
+
+	return 0;
+}
@@ -169,6 +169,70 @@ AT_DEFINE_TEST(Net_NativeSockets) {
 		AT_TEST_ASSERT(recv(hs2.get(), &c, 1, 0) == 0);
 	}
 
+	// Run more connections than a single wait can handle, and have the
+	// native side echo a byte back on each one. Every socket must see its
+	// own network events.
+	{
+		static constexpr uint32 kNumSockets = 100;
+
+		ATNativeSocketHandle hs(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+		AT_TEST_ASSERT(hs.valid());
+
+		sockaddr_in localhost {};
+		localhost.sin_family = AF_INET;
+		localhost.sin_port = htons(6503);
+		localhost.sin_addr.S_un.S_addr = htonl(INADDR_LOOPBACK);
+		AT_TEST_ASSERT(0 == bind(hs.get(), (const sockaddr *)&localhost, sizeof localhost));
+		AT_TEST_ASSERT(0 == listen(hs.get(), SOMAXCONN));
+
+		vdvector<vdrefptr<IATStreamSocket>> sockets;
+		vdvector<ATNativeSocketHandle> accepted;
+
+		for(uint32 i = 0; i < kNumSockets; ++i) {
+			sockets.emplace_back(ATNetConnect(ATSocketAddress::CreateIPv4(0x7F000001, 6503)));
+			AT_TEST_ASSERT(sockets.back());
+		}
+
+		for(uint32 i = 0; i < kNumSockets; ++i) {
+			accepted.emplace_back(accept(hs.get(), nullptr, nullptr));
+			AT_TEST_ASSERT(accepted.back().valid());
+		}
+
+		const auto retryUntil = [](const vdfunction<bool()>& fn) {
+			const uint32 deadline = VDGetCurrentTick() + 5000;
+
+			while(!fn()) {
+				AT_TEST_ASSERT(VDGetCurrentTick() < deadline);
+				VDThreadSleep(1);
+			}
+		};
+
+		for(uint32 i = 0; i < kNumSockets; ++i) {
+			const uint8 c = (uint8)i;
+			retryUntil([&] { return sockets[i]->Send(&c, 1) == 1; });
+		}
+
+		// connections may be accepted in any order, so echo back whatever
+		// each one sends
+		for(ATNativeSocketHandle& h : accepted) {
+			char c;
+			AT_TEST_ASSERT(recv(h.get(), &c, 1, 0) == 1);
+
+			c ^= 0x80;
+			AT_TEST_ASSERT(send(h.get(), &c, 1, 0) == 1);
+		}
+
+		for(uint32 i = 0; i < kNumSockets; ++i) {
+			uint8 c = 0;
+			retryUntil([&] { return sockets[i]->Recv(&c, 1) == 1; });
+
+			AT_TEST_ASSERTF(c == (uint8)(i ^ 0x80), "Socket %u received wrong data: %02X", i, c);
+		}
+
+		for(auto& s : sockets)
+			s->CloseSocket(true);
+	}
+
 	ATSocketShutdown();
 	return 0;
 }
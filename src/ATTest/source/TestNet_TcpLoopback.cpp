@@ -0,0 +1,230 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/binary.h>
+#include <vd2/system/refcount.h>
+#include <vd2/system/time.h>
+#include <vd2/system/vdstl.h>
+#include <at/atnetwork/ethernetbus.h>
+#include <at/atnetwork/ethernetframe.h>
+#include <at/atnetwork/socket.h>
+#include "../../ATNetwork/h/ipstack.h"
+#include "../../ATNetwork/h/tcpstack.h"
+#include "test.h"
+#include "testnet.h"
+
+namespace {
+	// Minimal host with an IP and TCP stack on the bus, routing TCP traffic
+	// the same way as the gateway server.
+	class ATTestNetHost final : public IATEthernetEndpoint {
+	public:
+		void Init(ATEthernetBus& bus, uint8 id) {
+			mpBus = &bus;
+			mHwAddress = ATEthernetAddr { { 0x02, 0, 0, 0, 0, id } };
+			mIpAddress = VDToBE32(0xC0A80000 + id);
+			mEndpointId = bus.AddEndpoint(this);
+
+			mIpStack.Init(mHwAddress, mIpAddress, VDToBE32(0xFFFFFF00), &bus, 0, mEndpointId);
+			mTcpStack.Init(&mIpStack);
+		}
+
+		void Shutdown() {
+			mTcpStack.Shutdown();
+			mIpStack.Shutdown();
+			mpBus->RemoveEndpoint(mEndpointId);
+		}
+
+		void AddPeer(const ATTestNetHost& peer) {
+			mIpStack.AddArpEntry(peer.mIpAddress, peer.mHwAddress, false);
+		}
+
+		void ReceiveFrame(const ATEthernetPacket& packet, ATEthernetFrameDecodedType decType, const void *decInfo) override {
+			if (memcmp(packet.mDstAddr.mAddr, mHwAddress.mAddr, 6))
+				return;
+
+			++mFramesReceived;
+
+			if (decType == kATEthernetFrameDecodedType_IPv4) {
+				const ATIPv4HeaderInfo& iphdr = *(const ATIPv4HeaderInfo *)decInfo;
+
+				if (iphdr.mProtocol == 6 && iphdr.mDstAddr == mIpAddress)
+					mTcpStack.OnPacket(packet, iphdr, packet.mpData + 2 + iphdr.mDataOffset, iphdr.mDataLength);
+			}
+		}
+
+		ATEthernetBus *mpBus = nullptr;
+		ATEthernetAddr mHwAddress {};
+		uint32 mIpAddress = 0;
+		uint32 mEndpointId = 0;
+		uint32 mFramesReceived = 0;
+		ATNetIpStack mIpStack;
+		ATNetTcpStack mTcpStack;
+	};
+
+	uint8 ATTestNetPatternByte(uint32 pos) {
+		return (uint8)(pos * 7 + (pos >> 9));
+	}
+
+	class ATTestNetSender final : public vdrefcounted<IATSocketHandler> {
+	public:
+		ATTestNetSender(uint32 len) : mLength(len) {}
+
+		void Pump() {
+			uint8 buf[4096];
+
+			while(mSent < mLength) {
+				const uint32 tc = std::min<uint32>(sizeof buf, mLength - mSent);
+
+				for(uint32 i = 0; i < tc; ++i)
+					buf[i] = ATTestNetPatternByte(mSent + i);
+
+				const sint32 actual = mpSocket->Send(buf, tc);
+				if (actual <= 0)
+					break;
+
+				mSent += actual;
+			}
+		}
+
+		void OnSocketOpen() override {}
+		void OnSocketReadReady(uint32 len) override {}
+		void OnSocketWriteReady(uint32 len) override { Pump(); }
+		void OnSocketClose() override {}
+		void OnSocketError() override { mbError = true; }
+
+		vdrefptr<IATStreamSocket> mpSocket;
+		const uint32 mLength;
+		uint32 mSent = 0;
+		bool mbError = false;
+	};
+
+	class ATTestNetReceiver final : public vdrefcounted<IATSocketHandler>, public IATEmuNetSocketListener {
+	public:
+		bool OnSocketIncomingConnection(uint32 srcIpAddr, uint16 srcPort, uint32 dstIpAddr, uint16 dstPort, IATStreamSocket *socket, IATSocketHandler **handler) override {
+			mpSocket = socket;
+
+			AddRef();
+			*handler = this;
+			return true;
+		}
+
+		void OnSocketOpen() override {}
+
+		void OnSocketReadReady(uint32 len) override {
+			uint8 buf[4096];
+
+			for(;;) {
+				const sint32 actual = mpSocket->Recv(buf, sizeof buf);
+				if (actual <= 0)
+					break;
+
+				for(sint32 i = 0; i < actual; ++i) {
+					if (buf[i] != ATTestNetPatternByte(mReceived + i))
+						mbCorrupted = true;
+				}
+
+				mReceived += actual;
+			}
+		}
+
+		void OnSocketWriteReady(uint32 len) override {}
+		void OnSocketClose() override {}
+		void OnSocketError() override { mbError = true; }
+
+		vdrefptr<IATStreamSocket> mpSocket;
+		uint32 mReceived = 0;
+		bool mbCorrupted = false;
+		bool mbError = false;
+	};
+
+	struct ATTestNetTransferResult {
+		uint32 mEmulatedMS;
+		uint32 mDataFrames;
+		uint32 mAckFrames;
+		double mHostSeconds;
+	};
+
+	ATTestNetTransferResult ATTestNetRunTransfer(uint32 len) {
+		ATTestNetClock clock;
+		ATEthernetBus bus;
+		AT_TEST_ASSERT(bus.AddClock(&clock) == 0);
+
+		ATTestNetHost hostA;
+		ATTestNetHost hostB;
+		hostA.Init(bus, 1);
+		hostB.Init(bus, 2);
+		hostA.AddPeer(hostB);
+		hostB.AddPeer(hostA);
+
+		vdrefptr<ATTestNetReceiver> receiver(new ATTestNetReceiver);
+		AT_TEST_ASSERT(hostB.mTcpStack.Bind(1234, receiver));
+
+		vdrefptr<ATTestNetSender> sender(new ATTestNetSender(len));
+
+		const auto t0 = VDGetPreciseTick();
+
+		AT_TEST_ASSERT(hostA.mTcpStack.Connect(hostB.mIpAddress, 1234, *sender, ~sender->mpSocket));
+		sender->Pump();
+
+		while(receiver->mReceived < len) {
+			AT_TEST_ASSERT(!sender->mbError && !receiver->mbError);
+			AT_TEST_ASSERT(clock.RunNextEvent());
+			AT_TEST_ASSERT(clock.GetTime() < 10000000);
+		}
+
+		ATTestNetTransferResult result {};
+		result.mHostSeconds = (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick();
+		result.mEmulatedMS = clock.GetTime();
+		result.mDataFrames = hostB.mFramesReceived;
+		result.mAckFrames = hostA.mFramesReceived;
+
+		AT_TEST_ASSERT(!receiver->mbCorrupted);
+		AT_TEST_ASSERT(receiver->mReceived == len);
+
+		sender->mpSocket->CloseSocket(true);
+		receiver->mpSocket->CloseSocket(true);
+		sender->mpSocket.clear();
+		receiver->mpSocket.clear();
+
+		hostA.Shutdown();
+		hostB.Shutdown();
+		bus.ClearPendingFrames();
+
+		return result;
+	}
+}
+
+AT_DEFINE_TEST(Net_TcpLoopback) {
+	const ATTestNetTransferResult result = ATTestNetRunTransfer(1024 * 1024);
+
+	// ACKs should be coalesced across each burst of segments rather than sent
+	// for every segment.
+	AT_TEST_ASSERT(result.mAckFrames * 4 < result.mDataFrames);
+
+	return 0;
+}
+
+AT_DEFINE_TEST_NONAUTO(Net_TcpLoopbackBench) {
+	const uint32 len = 64 * 1024 * 1024;
+	const ATTestNetTransferResult result = ATTestNetRunTransfer(len);
+
+	printf("Transferred %u bytes in %.2fs emulated time (%.1f KB/s)\n", len, (double)result.mEmulatedMS / 1000.0, (double)len / 1024.0 / ((double)result.mEmulatedMS / 1000.0));
+	printf("Host time: %.3fs (%.1f MB/s)\n", result.mHostSeconds, (double)len / 1048576.0 / result.mHostSeconds);
+	printf("Frames: %u data, %u ACK\n", result.mDataFrames, result.mAckFrames);
+
+	return 0;
+}
@@ -87,11 +87,13 @@ AT_DEFINE_TEST(System_CRC) {
 			crc.Process(buf+j, 1);
 		uint32 v2 = crc.CRC();
 
+		uint32 v3 = VDCRCTable::CRC32.CRC(buf, i);
+
 		uint32 ref = kReferenceCRCs.v[i];
 
-		AT_TEST_TRACEF("%3d: %08X %08X != %08X", i, v, v2, ref);
+		AT_TEST_TRACEF("%3d: %08X %08X %08X != %08X", i, v, v2, v3, ref);
 
-		AT_TEST_ASSERTF(v == ref && v2 == ref, "FAIL %3d: %08X %08X != %08X\n", i, v, v2, ref);
+		AT_TEST_ASSERTF(v == ref && v2 == ref && v3 == ref, "FAIL %3d: %08X %08X %08X != %08X\n", i, v, v2, v3, ref);
 	}
 
 	return 0;
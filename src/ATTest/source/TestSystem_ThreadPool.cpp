@@ -0,0 +1,103 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/atomic.h>
+#include <vd2/system/error.h>
+#include <vd2/system/threadpool.h>
+#include <vd2/system/vdstl.h>
+#include "test.h"
+
+namespace {
+	void ATTestThreadPoolCheckParallelFor(VDThreadPool& pool, uint32 n) {
+		vdblock<VDAtomicInt> counts(n);
+		for(VDAtomicInt& count : counts)
+			count = 0;
+
+		pool.ParallelFor(n, [&](uint32 i) { ++counts[i]; });
+
+		for(uint32 i = 0; i < n; ++i)
+			AT_TEST_ASSERTF(counts[i] == 1, "Item %u of %u ran %d times", i, n, (int)counts[i]);
+	}
+
+	void ATTestThreadPoolRun(VDThreadPool& pool) {
+		// every item runs exactly once, including counts below the thread count
+		for(uint32 n : { 1, 2, 3, 17, 10000 })
+			ATTestThreadPoolCheckParallelFor(pool, n);
+
+		// nested ParallelFor() from within items must not deadlock, even when
+		// every worker is blocked in an inner loop
+		VDAtomicInt total = 0;
+		pool.ParallelFor(16,
+			[&](uint32) {
+				pool.ParallelFor(100, [&](uint32) { ++total; });
+			}
+		);
+
+		AT_TEST_ASSERT(total == 1600);
+
+		// an exception from an item stops the loop and comes back on the caller
+		VDAtomicInt ran = 0;
+		bool caught = false;
+
+		try {
+			pool.ParallelFor(100000,
+				[&](uint32 i) {
+					++ran;
+
+					if (i == 500)
+						throw MyError("item failed");
+				}
+			);
+		} catch(const MyError& e) {
+			caught = !strcmp(e.c_str(), "item failed");
+		}
+
+		AT_TEST_ASSERT(caught);
+		AT_TEST_ASSERT(ran < 100000);
+
+		// the pool is still usable afterward
+		ATTestThreadPoolCheckParallelFor(pool, 1000);
+
+		// posted tasks all run by the time the pool is shut down
+		VDAtomicInt posted = 0;
+		for(int i = 0; i < 1000; ++i)
+			pool.Post([&] { ++posted; });
+
+		pool.Shutdown();
+
+		AT_TEST_ASSERT(posted == 1000);
+	}
+}
+
+AT_DEFINE_TEST(System_ThreadPool) {
+	// A pool without workers runs everything serially on the caller.
+	{
+		VDThreadPool pool;
+		ATTestThreadPoolRun(pool);
+	}
+
+	for(uint32 threads : { 1, 3, 8 }) {
+		VDThreadPool pool;
+		pool.Start(threads, "Test thread pool worker");
+
+		AT_TEST_ASSERT(pool.GetThreadCount() == threads);
+
+		ATTestThreadPoolRun(pool);
+	}
+
+	return 0;
+}
@@ -0,0 +1,244 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <at/atvm/calltable.h>
+#include <at/atvm/compiler.h>
+#include <at/atvm/vm.h>
+#include "test.h"
+
+namespace {
+	// Stand-in for a custom device memory layer that logs the calls made on
+	// it, so that interpreted and replayed runs can be compared.
+	struct ATTestVMLayer final : public ATVMObject {
+		static const ATVMObjectClass kVMObjectClass;
+
+		uint32 mId = 0;
+		vdfastvector<sint32> *mpLog = nullptr;
+
+		void Log(sint32 method, sint32 arg1, sint32 arg2) {
+			mpLog->push_back((sint32)mId);
+			mpLog->push_back(method);
+			mpLog->push_back(arg1);
+			mpLog->push_back(arg2);
+		}
+
+		void VMCallSetOffset(sint32 offset) { Log(0, offset, 0); }
+		void VMCallSetModes(sint32 read, sint32 write) { Log(1, read, write); }
+		void VMCallSetReadOnly(sint32 ro) { Log(2, ro, 0); }
+		void VMCallReset() { Log(3, 0, 0); }
+	};
+
+	const ATVMObjectClass ATTestVMLayer::kVMObjectClass {
+		"MemoryLayer",
+		{
+			ATVMExternalMethod::Bind<&ATTestVMLayer::VMCallSetOffset>("set_offset"),
+			ATVMExternalMethod::Bind<&ATTestVMLayer::VMCallSetModes>("set_modes"),
+			ATVMExternalMethod::Bind<&ATTestVMLayer::VMCallSetReadOnly>("set_readonly"),
+			ATVMExternalMethod::Bind<&ATTestVMLayer::VMCallReset>("reset"),
+		}
+	};
+
+	// Register handlers in the style of custom device bank switching
+	// scripts, followed by ones that can't be precomputed.
+	const char kATTestVMCallTableScript[] = R"(
+int counter;
+
+function void onBankWrite() {
+	if ($address & 8) {
+		cart.set_modes(0, 0);
+	} else {
+		cart.set_modes(1, 0);
+		cart.set_offset(($value & 7) * 8192 + ($address & 1) * 65536);
+		cart.set_readonly($value >= 128);
+	}
+
+	if ($value == 255)
+		ram.set_modes(1, 1);
+}
+
+function int onBankRead() {
+	int bank = $address & 3;
+
+	ram.set_offset(bank * 16384);
+	return bank + 128;
+}
+
+function void onDisable() {
+	cart.set_modes(0, 0);
+	ram.set_readonly(1);
+}
+
+function void onCount() {
+	counter = counter + 1;
+	cart.set_offset(counter);
+}
+
+function void onLoop() {
+	int i = $value;
+
+	while(i > 16)
+		i = i - 16;
+
+	cart.set_offset(i);
+}
+
+function void onReset() {
+	cart.reset();
+}
+
+function void onMany() {
+	cart.set_offset(0);
+	cart.set_offset(1);
+	cart.set_offset(2);
+	cart.set_offset(3);
+	cart.set_offset(4);
+	cart.set_offset(5);
+	cart.set_offset(6);
+	cart.set_offset(7);
+	cart.set_offset($value);
+}
+)";
+
+	constexpr uint32 kATTestVMAddressVar = 0;
+	constexpr uint32 kATTestVMValueVar = 1;
+	constexpr uint32 kATTestVMMaxCalls = 8;
+
+	struct ATTestVMCallTableEnv {
+		ATVMDomain mDomain;
+		ATVMThread mThread;
+		ATTestVMLayer mCart;
+		ATTestVMLayer mRAM;
+		vdfastvector<sint32> mLog;
+		vdfastvector<bool> mLayerGlobals;
+		vdfastvector<ATVMExternalVoidMethod> mAllowedMethods;
+
+		ATTestVMCallTableEnv() {
+			ATVMCompiler compiler(mDomain);
+
+			compiler.DefineSpecialVariable("address");
+			compiler.DefineSpecialVariable("value");
+
+			mCart.mId = 1;
+			mCart.mpLog = &mLog;
+			mRAM.mId = 2;
+			mRAM.mpLog = &mLog;
+
+			compiler.DefineObjectVariable("cart", &mCart);
+			compiler.DefineObjectVariable("ram", &mRAM);
+
+			if (!compiler.CompileFile(kATTestVMCallTableScript, sizeof(kATTestVMCallTableScript) - 1) || !compiler.CompileDeferred())
+				throw AssertionException("Script compile failed: %s", compiler.GetError());
+
+			mLayerGlobals.resize(mDomain.mGlobalVariables.size(), false);
+			for(const char *name : { "cart", "ram" })
+				mLayerGlobals[compiler.GetVariable(name)->mIndex] = true;
+
+			for(const ATVMExternalMethod& method : ATTestVMLayer::kVMObjectClass.mMethods) {
+				if (strcmp(method.mpName, "reset"))
+					mAllowedMethods.push_back(method.mpVoidMethod);
+			}
+
+			mThread.Init(mDomain);
+		}
+
+		const ATVMFunction& GetFunction(const char *name) const {
+			for(const ATVMFunction *func : mDomain.mFunctions) {
+				if (!strcmp(func->mpName, name))
+					return *func;
+			}
+
+			throw AssertionException("Function not found: %s", name);
+		}
+
+		bool Analyze(ATVMCallTable::Analysis& analysis, const char *name, bool read) {
+			uint32 specialVars = 1U << kATTestVMAddressVar;
+			if (!read)
+				specialVars |= 1U << kATTestVMValueVar;
+
+			return ATVMCallTable::Analyze(analysis, GetFunction(name), specialVars, mLayerGlobals, mAllowedMethods);
+		}
+	};
+
+	// Check that replaying the call table produces the same calls and return
+	// value as interpreting the script, for every address and value.
+	void ATTestVMCallTableCompare(ATTestVMCallTableEnv& env, const char *name, bool read, bool expectIndexed) {
+		const ATVMFunction& func = env.GetFunction(name);
+
+		ATVMCallTable::Analysis analysis;
+		AT_TEST_ASSERTF(env.Analyze(analysis, name, read), "Function %s not precomputable", name);
+		AT_TEST_ASSERT(((analysis.mSpecialVarsUsed >> kATTestVMValueVar) & 1) == (expectIndexed ? 1U : 0U));
+
+		vdfastvector<sint32> refLog;
+
+		for(uint32 addr = 0; addr < 16; ++addr) {
+			env.mDomain.mSpecialVariables[kATTestVMAddressVar] = addr;
+
+			ATVMCallTable table;
+			AT_TEST_ASSERT(table.Build(env.mThread, func, analysis, kATTestVMValueVar, 256, kATTestVMMaxCalls));
+
+			// building must not have called the real methods
+			AT_TEST_ASSERT(env.mLog.empty());
+
+			for(uint32 value = 0; value < (read ? 1U : 256U); ++value) {
+				env.mDomain.mSpecialVariables[kATTestVMAddressVar] = addr;
+				env.mDomain.mSpecialVariables[kATTestVMValueVar] = value;
+
+				sint32 refResult = 0;
+				if (read)
+					refResult = env.mThread.RunInt(func);
+				else
+					env.mThread.RunVoid(func);
+
+				refLog.swap(env.mLog);
+				env.mLog.clear();
+
+				const sint32 result = table.Run(env.mDomain, value);
+
+				AT_TEST_ASSERTF(result == refResult && env.mLog.size() == refLog.size() && std::equal(refLog.begin(), refLog.end(), env.mLog.begin()),
+					"Mismatch for %s at address %u, value %u", name, addr, value);
+
+				env.mLog.clear();
+			}
+		}
+	}
+}
+
+AT_DEFINE_TEST(VM_CallTable) {
+	ATTestVMCallTableEnv env;
+
+	ATTestVMCallTableCompare(env, "onBankWrite", false, true);
+	ATTestVMCallTableCompare(env, "onBankRead", true, false);
+	ATTestVMCallTableCompare(env, "onDisable", false, false);
+
+	// reads can't see $value
+	ATVMCallTable::Analysis analysis;
+	AT_TEST_ASSERT(!env.Analyze(analysis, "onBankWrite", true));
+
+	// int globals, backward branches, and other methods are all rejected
+	AT_TEST_ASSERT(!env.Analyze(analysis, "onCount", false));
+	AT_TEST_ASSERT(!env.Analyze(analysis, "onLoop", false));
+	AT_TEST_ASSERT(!env.Analyze(analysis, "onReset", false));
+
+	// too many calls for one value fails the build
+	AT_TEST_ASSERT(env.Analyze(analysis, "onMany", false));
+
+	ATVMCallTable table;
+	AT_TEST_ASSERT(!table.Build(env.mThread, env.GetFunction("onMany"), analysis, kATTestVMValueVar, 256, kATTestVMMaxCalls));
+	AT_TEST_ASSERT(env.mLog.empty());
+
+	return 0;
+}
@@ -0,0 +1,158 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/time.h>
+#include <at/atvm/compiler.h>
+#include <at/atvm/vm.h>
+#include "test.h"
+
+namespace {
+	// Handlers in the style of custom device register scripts: address
+	// decoding on reads, counters and masking on writes, and a short loop.
+	const char kATTestVMScript[] = R"(
+int status;
+int counter;
+int latch;
+int bank;
+int checksum;
+
+function int onRead() {
+	if ($address == 0)
+		return status;
+
+	if ($address == 1) {
+		counter = counter + 1;
+		return counter & 255;
+	}
+
+	if ($address < 8)
+		return latch;
+
+	return 255;
+}
+
+function void onWrite() {
+	if ($address == 0) {
+		status = $value & 127;
+	} else if ($address == 2) {
+		latch = $value;
+		counter = counter - 2;
+	} else if ($address >= 4) {
+		bank = ($value >> 2) & 3;
+	}
+}
+
+function void onUpdate() {
+	int i = 16;
+	int sum = 0;
+
+	while(i > 0) {
+		sum = sum + (latch ^ i);
+		i = i - 1;
+	}
+
+	do {
+		sum = sum - 7;
+	} while(sum >= 100);
+
+	checksum = checksum + sum;
+}
+)";
+
+	struct ATTestVMResult {
+		sint64 mReadSum;
+		sint32 mGlobals[5];
+		uint32 mByteCodeLen;
+		double mSeconds;
+	};
+
+	ATTestVMResult ATTestRunVMScript(bool optimize, uint32 iterations) {
+		ATVMDomain domain;
+		ATVMCompiler compiler(domain);
+
+		compiler.SetOptimizationEnabled(optimize);
+		compiler.DefineSpecialVariable("address");
+		compiler.DefineSpecialVariable("value");
+
+		if (!compiler.CompileFile(kATTestVMScript, sizeof(kATTestVMScript) - 1) || !compiler.CompileDeferred())
+			throw AssertionException("Script compile failed: %s", compiler.GetError());
+
+		AT_TEST_ASSERT(domain.mFunctions.size() == 3);
+
+		const ATVMFunction& onRead = *domain.mFunctions[0];
+		const ATVMFunction& onWrite = *domain.mFunctions[1];
+		const ATVMFunction& onUpdate = *domain.mFunctions[2];
+
+		ATVMThread thread;
+		thread.Init(domain);
+
+		ATTestVMResult result {};
+		result.mByteCodeLen = onRead.mByteCodeLen + onWrite.mByteCodeLen + onUpdate.mByteCodeLen;
+
+		const auto t0 = VDGetPreciseTick();
+
+		for(uint32 i = 0; i < iterations; ++i) {
+			domain.mSpecialVariables[0] = i & 15;
+			domain.mSpecialVariables[1] = (i * 37) & 255;
+
+			thread.RunVoid(onWrite);
+			result.mReadSum += thread.RunInt(onRead);
+
+			if (!(i & 15))
+				thread.RunVoid(onUpdate);
+		}
+
+		result.mSeconds = (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick();
+
+		for(int i = 0; i < 5; ++i)
+			result.mGlobals[i] = domain.mGlobalVariables[i];
+
+		return result;
+	}
+
+	void ATTestCompareVMResults(const ATTestVMResult& ref, const ATTestVMResult& opt) {
+		AT_TEST_ASSERT(ref.mReadSum == opt.mReadSum);
+
+		for(int i = 0; i < 5; ++i)
+			AT_TEST_ASSERT(ref.mGlobals[i] == opt.mGlobals[i]);
+	}
+}
+
+AT_DEFINE_TEST(VM_Interpreter) {
+	// superinstructions must produce the same results as the unfused code
+	const ATTestVMResult ref = ATTestRunVMScript(false, 4096);
+	const ATTestVMResult opt = ATTestRunVMScript(true, 4096);
+
+	ATTestCompareVMResults(ref, opt);
+	AT_TEST_ASSERT(opt.mByteCodeLen < ref.mByteCodeLen);
+
+	return 0;
+}
+
+AT_DEFINE_TEST_NONAUTO(VM_InterpreterBench) {
+	const uint32 iterations = 4000000;
+
+	const ATTestVMResult ref = ATTestRunVMScript(false, iterations);
+	const ATTestVMResult opt = ATTestRunVMScript(true, iterations);
+
+	ATTestCompareVMResults(ref, opt);
+
+	printf("Unfused:           %4u bytes  %7.2f ns/iteration\n", ref.mByteCodeLen, ref.mSeconds * 1e+9 / (double)iterations);
+	printf("Superinstructions: %4u bytes  %7.2f ns/iteration\n", opt.mByteCodeLen, opt.mSeconds * 1e+9 / (double)iterations);
+
+	return 0;
+}
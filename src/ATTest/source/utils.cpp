@@ -16,8 +16,11 @@
 
 #include <stdafx.h>
 #include <vd2/system/atomic.h>
+#include <vd2/system/file.h>
+#include <vd2/system/filesys.h>
 #include <signal.h>
 #include <windows.h>
+#include "test.h"
 
 bool g_ATTestTracingEnabled;
 VDAtomicBool g_ATTestExitTestLoop;
@@ -55,3 +58,56 @@ void ATTestTraceF(const char *format, ...) {
 
 	putchar('\n');
 }
+
+///////////////////////////////////////////////////////////////////////////
+
+namespace {
+	void ATTestDeleteDirectoryTree(const VDStringW& path) {
+		VDDirectoryIterator it(VDMakePath(path.c_str(), L"*.*").c_str());
+
+		while(it.Next()) {
+			if (it.IsDirectory())
+				ATTestDeleteDirectoryTree(it.GetFullPath());
+			else
+				VDRemoveFile(it.GetFullPath().c_str());
+		}
+
+		VDRemoveDirectory(path.c_str());
+	}
+}
+
+ATTestTempDirectory::ATTestTempDirectory() {
+	wchar_t tempPath[MAX_PATH + 1] {};
+	if (!GetTempPathW(MAX_PATH + 1, tempPath))
+		throw ATTestAssertionException("Unable to get temporary path.");
+
+	static VDAtomicInt sCounter;
+
+	for(;;) {
+		mPath = VDMakePath(tempPath, VDStringW().sprintf(L"ATTest-%08X-%04X", GetCurrentProcessId(), (unsigned)(sCounter++ & 0xFFFF)).c_str());
+
+		if (CreateDirectoryW(mPath.c_str(), nullptr))
+			break;
+
+		if (GetLastError() != ERROR_ALREADY_EXISTS)
+			throw ATTestAssertionException(L"Unable to create temporary directory: %ls", mPath.c_str());
+	}
+}
+
+ATTestTempDirectory::~ATTestTempDirectory() {
+	ATTestDeleteDirectoryTree(mPath);
+}
+
+VDStringW ATTestTempDirectory::MakePath(const wchar_t *name) const {
+	return VDMakePath(mPath.c_str(), name);
+}
+
+VDStringW ATTestTempDirectory::AddFile(const wchar_t *name, const void *data, size_t len) const {
+	VDStringW path = MakePath(name);
+
+	VDFile f(path.c_str(), nsVDFile::kWrite | nsVDFile::kDenyAll | nsVDFile::kCreateAlways);
+	f.write(data, (long)len);
+	f.close();
+
+	return path;
+}
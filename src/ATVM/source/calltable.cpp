@@ -0,0 +1,183 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vd2/system/binary.h>
+#include <at/atvm/calltable.h>
+
+bool ATVMCallTable::Analyze(Analysis& analysis, const ATVMFunction& func, uint32 allowedSpecialVars, vdspan<const bool> readableGlobals, vdspan<const ATVMExternalVoidMethod> allowedMethods) {
+	analysis = Analysis();
+
+	const uint8 *bc = func.mpByteCode;
+	const uint32 len = func.mByteCodeLen;
+
+	for(uint32 ip = 0; ip < len; ip += ATVMGetOpcodeLength((ATVMOpcode)bc[ip])) {
+		const ATVMOpcode opcode = (ATVMOpcode)bc[ip];
+
+		switch(opcode) {
+			case ATVMOpcode::Nop:
+			case ATVMOpcode::Pop:
+			case ATVMOpcode::Dup:
+			case ATVMOpcode::ILLoad:
+			case ATVMOpcode::ILStore:
+			case ATVMOpcode::ILAddConst8:
+			case ATVMOpcode::IntConst:
+			case ATVMOpcode::IntConst8:
+			case ATVMOpcode::IntAdd:
+			case ATVMOpcode::IntSub:
+			case ATVMOpcode::IntMul:
+			case ATVMOpcode::IntDiv:
+			case ATVMOpcode::IntMod:
+			case ATVMOpcode::IntAnd:
+			case ATVMOpcode::IntOr:
+			case ATVMOpcode::IntXor:
+			case ATVMOpcode::IntAsr:
+			case ATVMOpcode::IntAsl:
+			case ATVMOpcode::Not:
+			case ATVMOpcode::And:
+			case ATVMOpcode::Or:
+			case ATVMOpcode::IntLt:
+			case ATVMOpcode::IntLe:
+			case ATVMOpcode::IntGt:
+			case ATVMOpcode::IntGe:
+			case ATVMOpcode::IntEq:
+			case ATVMOpcode::IntNe:
+			case ATVMOpcode::IntNeg:
+			case ATVMOpcode::IntNot:
+			case ATVMOpcode::ReturnVoid:
+			case ATVMOpcode::ReturnInt:
+				break;
+
+			// branches must be forward only so that evaluation terminates
+			case ATVMOpcode::Ljz:
+			case ATVMOpcode::Ljnz:
+			case ATVMOpcode::Ljmp:
+			case ATVMOpcode::ILCmpConst8Ljz:
+			case ATVMOpcode::IntCmpConst8Ljz:
+				if (VDReadUnalignedLES32(&bc[ip + ATVMGetOpcodeLength(opcode) - 4]) < 0)
+					return false;
+				break;
+
+			case ATVMOpcode::ISLoad:
+				if (bc[ip + 1] >= 32 || !(allowedSpecialVars & (UINT32_C(1) << bc[ip + 1])))
+					return false;
+
+				analysis.mSpecialVarsUsed |= UINT32_C(1) << bc[ip + 1];
+				break;
+
+			case ATVMOpcode::IVLoad:
+				if (bc[ip + 1] >= readableGlobals.size() || !readableGlobals[bc[ip + 1]])
+					return false;
+				break;
+
+			case ATVMOpcode::MethodCallVoid:
+				{
+					const uint32 argCount = bc[ip + 1];
+					const uint32 slot = bc[ip + 2];
+
+					if (argCount > kMaxMethodArgs || slot >= kMaxMethodSlots)
+						return false;
+
+					const ATVMExternalVoidMethod method = (ATVMExternalVoidMethod)func.mpMethodTable[slot];
+					if (std::find(allowedMethods.begin(), allowedMethods.end(), method) == allowedMethods.end())
+						return false;
+
+					analysis.mSlotArgCounts[slot] = (uint8)argCount;
+					analysis.mMethodSlots = std::max<uint32>(analysis.mMethodSlots, slot + 1);
+				}
+				break;
+
+			default:
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool ATVMCallTable::Build(ATVMThread& thread, const ATVMFunction& func, const Analysis& analysis, uint32 indexVar, uint32 numIndexValues, uint32 maxCallsPerValue) {
+	static constexpr auto kRecorders = []<uint32... T_Slots>(std::integer_sequence<uint32, T_Slots...>) {
+		return std::array<ATVMExternalVoidMethod, kMaxMethodSlots> { RecordCall<T_Slots>... };
+	}(std::make_integer_sequence<uint32, kMaxMethodSlots>());
+
+	// Run a copy of the function with the used method table entries swapped
+	// for versions that record the call instead.
+	void (*recordMethods[kMaxMethodSlots])() {};
+
+	for(uint32 i = 0; i < analysis.mMethodSlots; ++i)
+		recordMethods[i] = (void (*)())kRecorders[i];
+
+	ATVMFunction recordFunc(func);
+	recordFunc.mpMethodTable = recordMethods;
+
+	mbIndexed = (analysis.mSpecialVarsUsed & (UINT32_C(1) << indexVar)) != 0;
+
+	const uint32 numEntries = mbIndexed ? numIndexValues : 1;
+	mEntryStarts.clear();
+	mEntryStarts.resize(numEntries + 1, 0);
+	mCalls.clear();
+	mReturnValues.clear();
+	mReturnValues.resize(numEntries, 0);
+
+	ATVMDomain& domain = *thread.mpDomain;
+	const sint32 savedIndex = domain.mSpecialVariables[indexVar];
+	const bool returnsValue = func.mReturnType.mClass != ATVMTypeClass::Void;
+	bool success = true;
+
+	mpRecordAnalysis = &analysis;
+	mpRecordMethods = func.mpMethodTable;
+	domain.mpCallTableRecorder = this;
+
+	for(uint32 i = 0; i < numEntries; ++i) {
+		mEntryStarts[i] = (uint32)mCalls.size();
+
+		domain.mSpecialVariables[indexVar] = i;
+
+		if (returnsValue)
+			mReturnValues[i] = thread.RunInt(recordFunc);
+		else
+			thread.RunVoid(recordFunc);
+
+		if (mCalls.size() - mEntryStarts[i] > maxCallsPerValue) {
+			success = false;
+			break;
+		}
+	}
+
+	domain.mpCallTableRecorder = nullptr;
+	domain.mSpecialVariables[indexVar] = savedIndex;
+	mpRecordAnalysis = nullptr;
+	mpRecordMethods = nullptr;
+
+	mEntryStarts[numEntries] = (uint32)mCalls.size();
+	return success;
+}
+
+template<uint32 T_Slot>
+void ATVMCallTable::RecordCall(ATVMDomain& domain, const sint32 *args) {
+	ATVMCallTable& table = *domain.mpCallTableRecorder;
+	Call& call = table.mCalls.emplace_back();
+
+	call.mpMethod = (ATVMExternalVoidMethod)table.mpRecordMethods[T_Slot];
+
+	// the first argument is the object
+	const uint32 argCount = table.mpRecordAnalysis->mSlotArgCounts[T_Slot] + 1;
+	for(uint32 i = 0; i < kMaxMethodArgs + 1; ++i)
+		call.mArgs[i] = i < argCount ? args[i] : 0;
+}
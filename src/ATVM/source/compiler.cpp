@@ -595,6 +595,9 @@ bool ATVMCompiler::ParseFunction(ATVMFunction *func, const ATVMTypeInfo& returnT
 	if (mBreakTargetLabels.size() != 1)
 		return ReportError("Internal compiler error: Break stack invalid after function");
 
+	if (mbOptimize)
+		OptimizeByteCode();
+
 	uint32 bclen = (uint32)mByteCodeBuffer.size();
 
 	uint8 *byteCode = (uint8 *)mpDomain->mAllocator.Allocate(bclen);
@@ -677,6 +680,10 @@ bool ATVMCompiler::ParseFunction(ATVMFunction *func, const ATVMTypeInfo& returnT
 				case ATVMOpcode::Ljmp:
 				case ATVMOpcode::LoopChk:
 				case ATVMOpcode::Not:
+				case ATVMOpcode::IVCmpConst8Ljz:
+				case ATVMOpcode::ILCmpConst8Ljz:
+				case ATVMOpcode::IVAddConst8:
+				case ATVMOpcode::ILAddConst8:
 					// no stack change
 					break;
 
@@ -738,6 +745,7 @@ bool ATVMCompiler::ParseFunction(ATVMFunction *func, const ATVMTypeInfo& returnT
 				case ATVMOpcode::Ljnz:
 				case ATVMOpcode::Pop:
 				case ATVMOpcode::ReturnInt:
+				case ATVMOpcode::IntCmpConst8Ljz:
 					popCount = 1;
 					break;
 
@@ -784,9 +792,20 @@ bool ATVMCompiler::ParseFunction(ATVMFunction *func, const ATVMTypeInfo& returnT
 				continue;
 			} else if (opcode == ATVMOpcode::ReturnInt || opcode == ATVMOpcode::ReturnVoid) {
 				break;
+			} else if (opcode == ATVMOpcode::IVCmpConst8Ljz || opcode == ATVMOpcode::ILCmpConst8Ljz || opcode == ATVMOpcode::IntCmpConst8Ljz) {
+				const uint32 insnLen = ATVMGetOpcodeLength(opcode);
+				sint32 branchTarget = ip + VDReadUnalignedLES32(&byteCode[ip + insnLen - 4]) + insnLen;
+
+				traversalStack.push_back({branchTarget, stackId});
+
+				if (opcode == ATVMOpcode::ILCmpConst8Ljz && byteCode[ip + 1] >= func->mLocalSlotsRequired)
+					return ReportError("Bytecode validation failed (invalid local index)");
 			} else if (opcode == ATVMOpcode::ILStore || opcode == ATVMOpcode::ILLoad) {
 				if (byteCode[ip + 1] >= func->mLocalSlotsRequired)
 					return ReportError("Bytecode validation failed (invalid local index)");
+			} else if (opcode == ATVMOpcode::ILAddConst8) {
+				if (byteCode[ip + 1] >= func->mLocalSlotsRequired || byteCode[ip + 3] >= func->mLocalSlotsRequired)
+					return ReportError("Bytecode validation failed (invalid local index)");
 			}
 
 			ip += ATVMGetOpcodeLength(opcode);
@@ -800,6 +819,190 @@ bool ATVMCompiler::ParseFunction(ATVMFunction *func, const ATVMTypeInfo& returnT
 	return true;
 }
 
+// Peephole pass over the bytecode for the current function. This fuses the
+// most common sequences in device scripts into superinstructions:
+//
+//	IVLoad/ILLoad v; IntConst8 c; <compare>; Ljz/Ljnz		-> IVCmpConst8Ljz/ILCmpConst8Ljz
+//	IntConst8 c; <compare>; Ljz/Ljnz						-> IntCmpConst8Ljz
+//	IVLoad/ILLoad v; IntConst8 c; IntAdd/IntSub; IVStore/ILStore w	-> IVAddConst8/ILAddConst8
+//
+// A sequence is only fused if no branch lands inside of it. The fused code is
+// shorter, so all long branches are relocated afterward. The result still goes
+// through the normal bytecode validation.
+void ATVMCompiler::OptimizeByteCode() {
+	const uint8 *src = mByteCodeBuffer.data();
+	const uint32 len = (uint32)mByteCodeBuffer.size();
+
+	// find instruction boundaries and branch targets
+	vdfastvector<uint32> insnStarts;
+	vdfastvector<bool> isBranchTarget(len + 1, false);
+
+	uint32 ip = 0;
+	while(ip < len) {
+		const ATVMOpcode opcode = (ATVMOpcode)src[ip];
+		const uint32 insnLen = ATVMGetOpcodeLength(opcode);
+
+		if (len - ip < insnLen)
+			return;
+
+		insnStarts.push_back(ip);
+
+		switch(opcode) {
+			case ATVMOpcode::Ljz:
+			case ATVMOpcode::Ljnz:
+			case ATVMOpcode::Ljmp:
+				{
+					const sint32 target = (sint32)(ip + 5) + VDReadUnalignedLES32(&src[ip + 1]);
+
+					// leave bad branches for the validator to report
+					if (target < 0 || (uint32)target > len)
+						return;
+
+					isBranchTarget[target] = true;
+				}
+				break;
+
+			case ATVMOpcode::Jz:
+			case ATVMOpcode::Jnz:
+			case ATVMOpcode::Jmp:
+				// short branches aren't generated by the parser and would need
+				// their own relocation
+				return;
+
+			default:
+				break;
+		}
+
+		ip += insnLen;
+	}
+
+	const uint32 n = (uint32)insnStarts.size();
+
+	struct BranchFixup {
+		uint32 mPatchOffset;	// offset-after of branch offset to patch, in new code
+		uint32 mOldTarget;		// branch target in old code
+	};
+
+	vdfastvector<uint8> dst;
+	vdfastvector<uint32> newOffsets(len + 1, 0);
+	vdfastvector<BranchFixup> fixups;
+
+	dst.reserve(len);
+
+	const auto getCompareMask = [](ATVMOpcode opcode) -> uint8 {
+		switch(opcode) {
+			case ATVMOpcode::IntLt:	return kATVMCompareMask_Lt;
+			case ATVMOpcode::IntLe:	return kATVMCompareMask_Le;
+			case ATVMOpcode::IntGt:	return kATVMCompareMask_Gt;
+			case ATVMOpcode::IntGe:	return kATVMCompareMask_Ge;
+			case ATVMOpcode::IntEq:	return kATVMCompareMask_Eq;
+			case ATVMOpcode::IntNe:	return kATVMCompareMask_Ne;
+			default:
+				return 0;
+		}
+	};
+
+	for(uint32 i = 0; i < n; ) {
+		const auto opAt = [&](uint32 k) {
+			return i + k < n ? (ATVMOpcode)src[insnStarts[i + k]] : ATVMOpcode::Count;
+		};
+
+		const auto operandAt = [&](uint32 k, uint32 offset) {
+			return src[insnStarts[i + k] + offset];
+		};
+
+		const auto canFuse = [&](uint32 count) {
+			if (i + count > n)
+				return false;
+
+			for(uint32 k = 1; k < count; ++k) {
+				if (isBranchTarget[insnStarts[i + k]])
+					return false;
+			}
+
+			return true;
+		};
+
+		// emit the branch offset from the branch at instruction i+k, relative to
+		// the end of the new instruction
+		const auto emitBranchOffset = [&](uint32 k) {
+			const uint32 branchIP = insnStarts[i + k];
+
+			dst.resize(dst.size() + 4, 0);
+			fixups.push_back(BranchFixup { (uint32)dst.size(), branchIP + 5 + VDReadUnalignedLES32(&src[branchIP + 1]) });
+		};
+
+		newOffsets[insnStarts[i]] = (uint32)dst.size();
+
+		const ATVMOpcode op0 = opAt(0);
+
+		if ((op0 == ATVMOpcode::IVLoad || op0 == ATVMOpcode::ILLoad) && opAt(1) == ATVMOpcode::IntConst8 && canFuse(4)) {
+			const bool global = (op0 == ATVMOpcode::IVLoad);
+			const ATVMOpcode op2 = opAt(2);
+			const ATVMOpcode op3 = opAt(3);
+			const uint8 cmpMask = getCompareMask(op2);
+
+			if (cmpMask && (op3 == ATVMOpcode::Ljz || op3 == ATVMOpcode::Ljnz)) {
+				dst.push_back((uint8)(global ? ATVMOpcode::IVCmpConst8Ljz : ATVMOpcode::ILCmpConst8Ljz));
+				dst.push_back(operandAt(0, 1));
+				dst.push_back(operandAt(1, 1));
+				dst.push_back(op3 == ATVMOpcode::Ljnz ? cmpMask ^ kATVMCompareMask_All : cmpMask);
+				emitBranchOffset(3);
+				i += 4;
+				continue;
+			}
+
+			sint32 addend = (sint8)operandAt(1, 1);
+			if (op2 == ATVMOpcode::IntSub)
+				addend = -addend;
+
+			if ((op2 == ATVMOpcode::IntAdd || (op2 == ATVMOpcode::IntSub && addend <= 127))
+				&& op3 == (global ? ATVMOpcode::IVStore : ATVMOpcode::ILStore))
+			{
+				dst.push_back((uint8)(global ? ATVMOpcode::IVAddConst8 : ATVMOpcode::ILAddConst8));
+				dst.push_back(operandAt(0, 1));
+				dst.push_back((uint8)addend);
+				dst.push_back(operandAt(3, 1));
+				i += 4;
+				continue;
+			}
+		}
+
+		if (op0 == ATVMOpcode::IntConst8 && canFuse(3)) {
+			const uint8 cmpMask = getCompareMask(opAt(1));
+			const ATVMOpcode op2 = opAt(2);
+
+			if (cmpMask && (op2 == ATVMOpcode::Ljz || op2 == ATVMOpcode::Ljnz)) {
+				dst.push_back((uint8)ATVMOpcode::IntCmpConst8Ljz);
+				dst.push_back(operandAt(0, 1));
+				dst.push_back(op2 == ATVMOpcode::Ljnz ? cmpMask ^ kATVMCompareMask_All : cmpMask);
+				emitBranchOffset(2);
+				i += 3;
+				continue;
+			}
+		}
+
+		// no match -- copy the instruction through, relocating it if it's a branch
+		const uint32 insnStart = insnStarts[i];
+		const uint32 insnLen = ATVMGetOpcodeLength(op0);
+
+		if (op0 == ATVMOpcode::Ljz || op0 == ATVMOpcode::Ljnz || op0 == ATVMOpcode::Ljmp) {
+			dst.push_back((uint8)op0);
+			emitBranchOffset(0);
+		} else
+			dst.insert(dst.end(), src + insnStart, src + insnStart + insnLen);
+
+		++i;
+	}
+
+	newOffsets[len] = (uint32)dst.size();
+
+	for(const BranchFixup& fixup : fixups)
+		VDWriteUnalignedLES32(&dst[fixup.mPatchOffset - 4], (sint32)newOffsets[fixup.mOldTarget] - (sint32)fixup.mPatchOffset);
+
+	mByteCodeBuffer.swap(dst);
+}
+
 bool ATVMCompiler::ParseBlock(bool& hasReturn) {
 	for(;;) {
 		uint32 tok = Token();
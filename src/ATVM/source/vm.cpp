@@ -53,6 +53,17 @@ uint32 ATVMGetOpcodeLength(ATVMOpcode opcode) {
 		case ATVMOpcode::Jmp:
 			return 2;
 
+		case ATVMOpcode::IVAddConst8:
+		case ATVMOpcode::ILAddConst8:
+			return 4;
+
+		case ATVMOpcode::IntCmpConst8Ljz:
+			return 7;
+
+		case ATVMOpcode::IVCmpConst8Ljz:
+		case ATVMOpcode::ILCmpConst8Ljz:
+			return 8;
+
 		default:
 			return 1;
 	}
@@ -208,6 +219,25 @@ void ATVMThread::Abort() {
 	}
 }
 
+// Where the compiler supports taking the address of labels, the interpreter
+// uses threaded dispatch: each handler jumps straight to the next handler
+// through a table instead of looping back to a shared switch, which gives
+// the host branch predictor separate history for each opcode. MSVC doesn't
+// support this, so it gets the switch. Both check the stack and PC after each
+// instruction in debug builds.
+#define ATVM_CHECK_STATE()	\
+	VDASSERT(sp >= spbase);	\
+	VDASSERT((size_t)(pc - function->mpByteCode) < function->mByteCodeLen)
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define ATVM_THREADED_DISPATCH 1
+	#define ATVM_OP(op) op_##op
+	#define ATVM_NEXT() do { ATVM_CHECK_STATE(); goto *kDispatchTable[*pc++]; } while(false)
+#else
+	#define ATVM_OP(op) case ATVMOpcode::op
+	#define ATVM_NEXT() break
+#endif
+
 bool ATVMThread::Run() {
 	auto *prev = mpDomain->mpActiveThread;
 	mpDomain->mpActiveThread = this;
@@ -241,26 +271,86 @@ bool ATVMThread::Run() {
 		auto *bp = sp0 + frame.mBP;
 		[[maybe_unused]] auto *spbase = bp + function->mLocalSlotsRequired;
 
+#ifdef ATVM_THREADED_DISPATCH
+		static const void *const kDispatchTable[] = {
+			&&op_Nop,
+			&&op_Pop,
+			&&op_Dup,
+			&&op_IVLoad,
+			&&op_IVStore,
+			&&op_ILLoad,
+			&&op_ILStore,
+			&&op_ISLoad,
+			&&op_ITLoad,
+			&&op_IntConst,
+			&&op_IntConst8,
+			&&op_IntAdd,
+			&&op_IntSub,
+			&&op_IntMul,
+			&&op_IntDiv,
+			&&op_IntMod,
+			&&op_IntAnd,
+			&&op_IntOr,
+			&&op_IntXor,
+			&&op_IntAsr,
+			&&op_IntAsl,
+			&&op_Not,
+			&&op_And,
+			&&op_Or,
+			&&op_IntLt,
+			&&op_IntLe,
+			&&op_IntGt,
+			&&op_IntGe,
+			&&op_IntEq,
+			&&op_IntNe,
+			&&op_IntNeg,
+			&&op_IntNot,
+			&&op_Jz,
+			&&op_Jnz,
+			&&op_Jmp,
+			&&op_Ljz,
+			&&op_Ljnz,
+			&&op_Ljmp,
+			&&op_LoopChk,
+			&&op_MethodCallVoid,
+			&&op_MethodCallInt,
+			&&op_StaticMethodCallVoid,
+			&&op_StaticMethodCallInt,
+			&&op_FunctionCallVoid,
+			&&op_FunctionCallInt,
+			&&op_ReturnVoid,
+			&&op_ReturnInt,
+			&&op_IVCmpConst8Ljz,
+			&&op_ILCmpConst8Ljz,
+			&&op_IntCmpConst8Ljz,
+			&&op_IVAddConst8,
+			&&op_ILAddConst8,
+		};
+
+		static_assert(vdcountof(kDispatchTable) == (size_t)ATVMOpcode::Count, "dispatch table out of sync with opcodes");
+
+		ATVM_NEXT();
+		{
+#else
 		for(;;) {
-			ATVMOpcode opcode = (ATVMOpcode)*pc++;
-
-			switch(opcode) {
-				case ATVMOpcode::Nop:			break;
-				case ATVMOpcode::Pop:			--sp; break;
-				case ATVMOpcode::Dup:			*sp = sp[-1]; ++sp; break;
-				case ATVMOpcode::IVLoad:		*sp++ = vars[*pc++]; break;
-				case ATVMOpcode::IVStore:		vars[*pc++] = *--sp; break;
-				case ATVMOpcode::ILLoad:		*sp++ = bp[*pc++]; break;
-				case ATVMOpcode::ILStore:		bp[*pc++] = *--sp; break;
-				case ATVMOpcode::ISLoad:		*sp++ = svars[*pc++]; break;
-				case ATVMOpcode::ITLoad:		*sp++ = mThreadVariables[*pc++]; break;
-				case ATVMOpcode::IntConst:	*sp++ = VDReadUnalignedLES32(pc); pc += 4; break;
-				case ATVMOpcode::IntConst8:	*sp++ = (sint8)*pc++; break;
-				case ATVMOpcode::IntAdd:		sp[-2] = (sint32)((uint32)sp[-2] + (uint32)sp[-1]); --sp; break;
-				case ATVMOpcode::IntSub:		sp[-2] = (sint32)((uint32)sp[-2] - (uint32)sp[-1]); --sp; break;
-				case ATVMOpcode::IntMul:		sp[-2] *= sp[-1]; --sp; break;
-
-				case ATVMOpcode::IntDiv:
+			switch((ATVMOpcode)*pc++) {
+#endif
+				ATVM_OP(Nop):			ATVM_NEXT();
+				ATVM_OP(Pop):			--sp; ATVM_NEXT();
+				ATVM_OP(Dup):			*sp = sp[-1]; ++sp; ATVM_NEXT();
+				ATVM_OP(IVLoad):		*sp++ = vars[*pc++]; ATVM_NEXT();
+				ATVM_OP(IVStore):		vars[*pc++] = *--sp; ATVM_NEXT();
+				ATVM_OP(ILLoad):		*sp++ = bp[*pc++]; ATVM_NEXT();
+				ATVM_OP(ILStore):		bp[*pc++] = *--sp; ATVM_NEXT();
+				ATVM_OP(ISLoad):		*sp++ = svars[*pc++]; ATVM_NEXT();
+				ATVM_OP(ITLoad):		*sp++ = mThreadVariables[*pc++]; ATVM_NEXT();
+				ATVM_OP(IntConst):		*sp++ = VDReadUnalignedLES32(pc); pc += 4; ATVM_NEXT();
+				ATVM_OP(IntConst8):		*sp++ = (sint8)*pc++; ATVM_NEXT();
+				ATVM_OP(IntAdd):		sp[-2] = (sint32)((uint32)sp[-2] + (uint32)sp[-1]); --sp; ATVM_NEXT();
+				ATVM_OP(IntSub):		sp[-2] = (sint32)((uint32)sp[-2] - (uint32)sp[-1]); --sp; ATVM_NEXT();
+				ATVM_OP(IntMul):		sp[-2] *= sp[-1]; --sp; ATVM_NEXT();
+
+				ATVM_OP(IntDiv):
 					if (!sp[-1])
 						sp[-2] = 0;
 					else if (sp[-1] == -1)
@@ -268,39 +358,68 @@ bool ATVMThread::Run() {
 					else
 						sp[-2] /= sp[-1];
 					--sp;
-					break;
+					ATVM_NEXT();
 
-				case ATVMOpcode::IntMod:
+				ATVM_OP(IntMod):
 					if (sp[-1] >= -1 && sp[-1] <= 1)
 						sp[-2] = 0;
 					else
 						sp[-2] %= sp[-1];
 					--sp;
-					break;
-
-				case ATVMOpcode::IntAnd:		sp[-2] &= sp[-1]; --sp; break;
-				case ATVMOpcode::IntOr:		sp[-2] |= sp[-1]; --sp; break;
-				case ATVMOpcode::IntXor:		sp[-2] ^= sp[-1]; --sp; break;
-				case ATVMOpcode::IntAsr:		sp[-2] >>= sp[-1] & 31; --sp; break;
-				case ATVMOpcode::IntAsl:		sp[-2] <<= sp[-1] & 31; --sp; break;
-				case ATVMOpcode::Not:			sp[-1] = !sp[-1]; break;
-				case ATVMOpcode::And:			sp[-2] = sp[-2] && sp[-1]; --sp; break;
-				case ATVMOpcode::Or:			sp[-2] = sp[-2] || sp[-1]; --sp; break;
-				case ATVMOpcode::IntLt:		sp[-2] = sp[-2] <  sp[-1] ? 1 : 0; --sp; break;
-				case ATVMOpcode::IntLe:		sp[-2] = sp[-2] <= sp[-1] ? 1 : 0; --sp; break;
-				case ATVMOpcode::IntGt:		sp[-2] = sp[-2] >  sp[-1] ? 1 : 0; --sp; break;
-				case ATVMOpcode::IntGe:		sp[-2] = sp[-2] >= sp[-1] ? 1 : 0; --sp; break;
-				case ATVMOpcode::IntEq:		sp[-2] = sp[-2] == sp[-1] ? 1 : 0; --sp; break;
-				case ATVMOpcode::IntNe:		sp[-2] = sp[-2] != sp[-1] ? 1 : 0; --sp; break;
-				case ATVMOpcode::IntNeg:		sp[-1] = -sp[-1]; break;
-				case ATVMOpcode::IntNot:		sp[-1] = ~sp[-1]; break;
-				case ATVMOpcode::Jz:			++pc; if (!*--sp) pc += (sint8)pc[-1]; break;
-				case ATVMOpcode::Jnz:			++pc; if (*--sp) pc += (sint8)pc[-1]; break;
-				case ATVMOpcode::Jmp:			pc += (sint8)*pc + 4; break;
-				case ATVMOpcode::Ljz:			pc += 4; if (!*--sp) pc += VDReadUnalignedLES32(pc - 4); break;
-				case ATVMOpcode::Ljnz:		pc += 4; if (*--sp) pc += VDReadUnalignedLES32(pc - 4); break;
-				case ATVMOpcode::Ljmp:		pc += VDReadUnalignedLES32(pc) + 4; break;
-				case ATVMOpcode::LoopChk:
+					ATVM_NEXT();
+
+				ATVM_OP(IntAnd):		sp[-2] &= sp[-1]; --sp; ATVM_NEXT();
+				ATVM_OP(IntOr):			sp[-2] |= sp[-1]; --sp; ATVM_NEXT();
+				ATVM_OP(IntXor):		sp[-2] ^= sp[-1]; --sp; ATVM_NEXT();
+				ATVM_OP(IntAsr):		sp[-2] >>= sp[-1] & 31; --sp; ATVM_NEXT();
+				ATVM_OP(IntAsl):		sp[-2] <<= sp[-1] & 31; --sp; ATVM_NEXT();
+				ATVM_OP(Not):			sp[-1] = !sp[-1]; ATVM_NEXT();
+				ATVM_OP(And):			sp[-2] = sp[-2] && sp[-1]; --sp; ATVM_NEXT();
+				ATVM_OP(Or):			sp[-2] = sp[-2] || sp[-1]; --sp; ATVM_NEXT();
+				ATVM_OP(IntLt):			sp[-2] = sp[-2] <  sp[-1] ? 1 : 0; --sp; ATVM_NEXT();
+				ATVM_OP(IntLe):			sp[-2] = sp[-2] <= sp[-1] ? 1 : 0; --sp; ATVM_NEXT();
+				ATVM_OP(IntGt):			sp[-2] = sp[-2] >  sp[-1] ? 1 : 0; --sp; ATVM_NEXT();
+				ATVM_OP(IntGe):			sp[-2] = sp[-2] >= sp[-1] ? 1 : 0; --sp; ATVM_NEXT();
+				ATVM_OP(IntEq):			sp[-2] = sp[-2] == sp[-1] ? 1 : 0; --sp; ATVM_NEXT();
+				ATVM_OP(IntNe):			sp[-2] = sp[-2] != sp[-1] ? 1 : 0; --sp; ATVM_NEXT();
+				ATVM_OP(IntNeg):		sp[-1] = -sp[-1]; ATVM_NEXT();
+				ATVM_OP(IntNot):		sp[-1] = ~sp[-1]; ATVM_NEXT();
+				ATVM_OP(Jz):			++pc; if (!*--sp) pc += (sint8)pc[-1]; ATVM_NEXT();
+				ATVM_OP(Jnz):			++pc; if (*--sp) pc += (sint8)pc[-1]; ATVM_NEXT();
+				ATVM_OP(Jmp):			pc += (sint8)*pc + 4; ATVM_NEXT();
+				ATVM_OP(Ljz):			pc += 4; if (!*--sp) pc += VDReadUnalignedLES32(pc - 4); ATVM_NEXT();
+				ATVM_OP(Ljnz):			pc += 4; if (*--sp) pc += VDReadUnalignedLES32(pc - 4); ATVM_NEXT();
+				ATVM_OP(Ljmp):			pc += VDReadUnalignedLES32(pc) + 4; ATVM_NEXT();
+
+				ATVM_OP(IVCmpConst8Ljz):
+					pc += 7;
+					if (!(pc[-5] & ATVMCompareOutcome(vars[pc[-7]], (sint8)pc[-6])))
+						pc += VDReadUnalignedLES32(pc - 4);
+					ATVM_NEXT();
+
+				ATVM_OP(ILCmpConst8Ljz):
+					pc += 7;
+					if (!(pc[-5] & ATVMCompareOutcome(bp[pc[-7]], (sint8)pc[-6])))
+						pc += VDReadUnalignedLES32(pc - 4);
+					ATVM_NEXT();
+
+				ATVM_OP(IntCmpConst8Ljz):
+					pc += 6;
+					if (!(pc[-5] & ATVMCompareOutcome(*--sp, (sint8)pc[-6])))
+						pc += VDReadUnalignedLES32(pc - 4);
+					ATVM_NEXT();
+
+				ATVM_OP(IVAddConst8):
+					vars[pc[2]] = (sint32)((uint32)vars[pc[0]] + (uint32)(sint32)(sint8)pc[1]);
+					pc += 3;
+					ATVM_NEXT();
+
+				ATVM_OP(ILAddConst8):
+					bp[pc[2]] = (sint32)((uint32)bp[pc[0]] + (uint32)(sint32)(sint8)pc[1]);
+					pc += 3;
+					ATVM_NEXT();
+
+				ATVM_OP(LoopChk):
 					if (--loopSafetyCounter <= 0) {
 						[[unlikely]]
 						if (mpDomain->mInfiniteLoopHandler)
@@ -310,9 +429,9 @@ bool ATVMThread::Run() {
 						mbSuspended = false;
 						goto exit;
 					}
-					break;
+					ATVM_NEXT();
 
-				case ATVMOpcode::MethodCallVoid:
+				ATVM_OP(MethodCallVoid):
 					pc += 2;
 					sp -= pc[-2] + 1;
 					((ATVMExternalVoidMethod)function->mpMethodTable[pc[-1]])(*mpDomain, sp);
@@ -321,9 +440,9 @@ bool ATVMThread::Run() {
 						frame.mSP = (uint32)(sp - sp0);
 						goto exit;
 					}
-					break;
+					ATVM_NEXT();
 
-				case ATVMOpcode::MethodCallInt:
+				ATVM_OP(MethodCallInt):
 					pc += 2;
 					sp -= pc[-2];
 					sp[-1] = ((ATVMExternalIntMethod)function->mpMethodTable[pc[-1]])(*mpDomain, sp - 1);
@@ -332,9 +451,9 @@ bool ATVMThread::Run() {
 						frame.mSP = (uint32)(sp - sp0);
 						goto exit;
 					}
-					break;
+					ATVM_NEXT();
 
-				case ATVMOpcode::StaticMethodCallVoid:
+				ATVM_OP(StaticMethodCallVoid):
 					pc += 2;
 					sp -= pc[-2];
 					((ATVMExternalVoidMethod)function->mpMethodTable[pc[-1]])(*mpDomain, sp);
@@ -343,9 +462,9 @@ bool ATVMThread::Run() {
 						frame.mSP = (uint32)(sp - sp0);
 						goto exit;
 					}
-					break;
+					ATVM_NEXT();
 
-				case ATVMOpcode::StaticMethodCallInt:
+				ATVM_OP(StaticMethodCallInt):
 					pc += 2;
 					sp -= pc[-2] - 1;
 					sp[-1] = ((ATVMExternalIntMethod)function->mpMethodTable[pc[-1]])(*mpDomain, sp - 1);
@@ -354,11 +473,13 @@ bool ATVMThread::Run() {
 						frame.mSP = (uint32)(sp - sp0);
 						goto exit;
 					}
-					break;
+					ATVM_NEXT();
 
-				case ATVMOpcode::FunctionCallVoid:
-				case ATVMOpcode::FunctionCallInt:
+				ATVM_OP(FunctionCallVoid):
+				ATVM_OP(FunctionCallInt):
 					{
+						const bool returnsInt = ((ATVMOpcode)pc[-1] == ATVMOpcode::FunctionCallInt);
+
 						pc += 2;
 						sp -= pc[-2];
 
@@ -370,14 +491,14 @@ bool ATVMThread::Run() {
 						// if there is a return value, reserve space for it now in the current frame
 						// (this will be populated by the called function and may overlap the first
 						// argument)
-						if (opcode == ATVMOpcode::FunctionCallInt)
+						if (returnsInt)
 							++frame.mSP;
 						
 						if (mStackFrames.size() < 100) {
 							const uint32 newSP = (uint32)(sp - mArgStack.data());
 							mStackFrames.push_back(StackFrame { childFunc, nullptr, newSP, newSP });
 						} else {
-							if (opcode == ATVMOpcode::FunctionCallInt)
+							if (returnsInt)
 								*sp = 0;
 
 							if (mpDomain->mInfiniteLoopHandler)
@@ -390,20 +511,28 @@ bool ATVMThread::Run() {
 					}
 					goto update_frame;
 
-				case ATVMOpcode::ReturnInt:
+				ATVM_OP(ReturnInt):
 					*bp = sp[-1];
-					[[fallthrough]];
-				case ATVMOpcode::ReturnVoid:
+					goto return_void;
+
+				ATVM_OP(ReturnVoid):
+return_void:
 					mStackFrames.pop_back();
 					if (mStackFrames.empty())
 						goto exit;
 
 					goto update_frame;
+
+#ifdef ATVM_THREADED_DISPATCH
+		}
+#else
+				case ATVMOpcode::Count:
+					VDNEVERHERE;
 			}
 
-			VDASSERT(sp >= spbase);
-			VDASSERT((size_t)(pc - function->mpByteCode) < function->mByteCodeLen);
+			ATVM_CHECK_STATE();
 		}
+#endif
 
 update_frame:
 		;
@@ -18,10 +18,13 @@
 #ifndef f_ARTIFACTING_H
 #define f_ARTIFACTING_H
 
+#include <vd2/system/function.h>
 #include <vd2/system/memory.h>
+#include <vd2/system/vdalloc.h>
 #include "gtia.h"
 
 class vdfloat3x3;
+class VDThreadPool;
 namespace nsVDVecMath {
 	struct vdfloat32x3;
 }
@@ -54,6 +57,20 @@ public:
 		M = 312
 	};
 
+	// State carried from one scanline to the next. Only PAL chroma artifacting
+	// uses this.
+	struct alignas(16) DelayLine {
+		union {
+			uint8 mPAL8[N];
+			uint8 mPAL32[N*2*3];	// RGB24 @ 14MHz resolution
+			uint32 mPALUV[2][N];
+		};
+
+		// The PAL high artifacting final pass touches a few elements past the
+		// end of the chroma lines.
+		uint32 mPad[4];
+	};
+
 	void SuspendFrame();
 	void ResumeFrame();
 
@@ -69,16 +86,45 @@ public:
 		bool extendedRangeInput,
 		bool extendedRangeOutput,
 		bool deinterlacing);
-	void Artifact8(uint32 y, uint32 dst[N], const uint8 src[N], bool scanlineHasHiRes, bool temporaryUpdate, bool includeBlanking);
-	void Artifact32(uint32 y, uint32 *dst, uint32 width, bool temporaryUpdate, bool includeBlanking);
+	void Artifact8(uint32 y, uint32 dst[N], const uint8 src[N], bool scanlineHasHiRes, bool temporaryUpdate, bool includeBlanking) {
+		Artifact8(y, dst, src, scanlineHasHiRes, temporaryUpdate, includeBlanking, mDelayLine);
+	}
+
+	void Artifact32(uint32 y, uint32 *dst, uint32 width, bool temporaryUpdate, bool includeBlanking) {
+		Artifact32(y, dst, width, temporaryUpdate, includeBlanking, mDelayLine);
+	}
+
+	void Artifact8(uint32 y, uint32 dst[N], const uint8 src[N], bool scanlineHasHiRes, bool temporaryUpdate, bool includeBlanking, DelayLine& delayLine);
+	void Artifact32(uint32 y, uint32 *dst, uint32 width, bool temporaryUpdate, bool includeBlanking, DelayLine& delayLine);
 	void InterpolateScanlines(uint32 *dst, const uint32 *src1, const uint32 *src2, uint32 n);
 	void Deinterlace(uint32 frameY, uint32 *dst, const uint32 *src1, const uint32 *src2, uint32 n);
 
+	// Band-parallel artifacting. ForEachBand() splits scanlines [y1, y2) into
+	// horizontal bands and calls fn(bandY1, bandY2, delayLine) for each, on
+	// worker threads if display.parallel_artifacting is enabled. The first band
+	// continues from the engine's own delay line; the others get their own,
+	// which are first primed on the calling thread by primeFn(bandY1 - 1,
+	// delayLine) with PrimeDelayLine8/32(). Priming is done before any band
+	// runs, so in-place artifacting can prime from the original pixels.
+	// Blending history is kept per scanline, so the result is identical to
+	// artifacting sequentially.
+	void ForEachBand(uint32 y1, uint32 y2, const vdfunction<void(uint32, DelayLine&)>& primeFn, const vdfunction<void(uint32, uint32, DelayLine&)>& fn);
+
+	// Force ForEachBand() to use the given number of bands where the height
+	// allows, regardless of processor count and display.parallel_artifacting.
+	// Zero restores the automatic choice. Used to test banding against
+	// sequential artifacting.
+	void SetForcedBandCount(uint32 bandCount) { mForcedBandCount = bandCount; }
+	void PrimeDelayLine8(uint32 y, const uint8 src[N], bool scanlineHasHiRes, DelayLine& delayLine);
+	void PrimeDelayLine32(const uint32 *src, uint32 width, DelayLine& delayLine);
+
 private:
 	friend class ATPaletteCorrector;
 
-	void ArtifactPAL8(uint32 dst[N], const uint8 src[N]);
-	void ArtifactPAL32(uint32 *dst, uint32 width);
+	VDThreadPool& GetThreadPool();
+	void ResetDelayLine(DelayLine& delayLine);
+	void ArtifactPAL8(uint32 dst[N], const uint8 src[N], DelayLine& delayLine);
+	void ArtifactPAL32(uint32 *dst, uint32 width, DelayLine& delayLine);
 	void ArtifactCompressRange(uint32 *dst, uint32 width);
 
 	void ArtifactCompressRange_Scalar(uint32 *dst, uint32 width);
@@ -94,7 +140,7 @@ private:
 #endif
 
 	void ArtifactNTSCHi(uint32 dst[N*2], const uint8 src[N], bool scanlineHasHiRes, bool includeHBlank);
-	void ArtifactPALHi(uint32 dst[N*2], const uint8 src[N], bool scanlineHasHiRes, bool oddline);
+	void ArtifactPALHi(uint32 dst[N*2], const uint8 src[N], bool scanlineHasHiRes, bool oddline, DelayLine& delayLine);
 	void BlitNoArtifacts(uint32 dst[N], const uint8 src[N], bool scanlineHasHiRes);
 	void Blend(uint32 *VDRESTRICT dst, const uint32 *VDRESTRICT src, uint32 n);
 	void BlendExchange(uint32 *VDRESTRICT dst, uint32 *VDRESTRICT blendDst, uint32 n);
@@ -180,11 +226,14 @@ private:
 	alignas(16) sint16 mActiveLumaRamp[16];
 	alignas(16) sint16 mActiveArtifactRamp[31][4];
 
-	union {
-		uint8 mPALDelayLine[N];
-		uint8 mPALDelayLine32[N*2*3];	// RGB24 @ 14MHz resolution
-		VDALIGN(16) uint32 mPALDelayLineUV[2][N];
-	};
+	DelayLine mDelayLine;
+
+	static constexpr uint32 kMaxBands = 8;
+	static constexpr uint32 kMinBandHeight = 32;
+
+	DelayLine mBandDelayLines[kMaxBands - 1];
+	uint32 mForcedBandCount = 0;
+	vdautoptr<VDThreadPool> mpThreadPool;
 
 	union {
 		uint32 mPrevFrame7MHz[M*2][N];
@@ -21,12 +21,19 @@
 #include <vd2/system/file.h>
 #include <at/atcore/deviceimpl.h>
 #include <at/atcore/blockdevice.h>
+#include "directorywatcher.h"
 
 // ATBlockDeviceVFAT32
 //
 // Converts a host directory of files to a virtual FAT32 partition, reading the
 // file data from the live files. Currently read-only.
 //
+// Only the file list and cluster allocation are kept resident; FAT, directory,
+// and data sectors are all generated on demand. Rescans reuse the cluster
+// allocations of files that have not changed so that the bulk of the volume
+// stays put, and are skipped entirely if the directory watcher has not seen
+// any changes.
+//
 class ATBlockDeviceVFAT32 final : public ATDeviceT<IATBlockDevice, IATBlockDeviceDynamic> {
 public:
 	ATBlockDeviceVFAT32(bool useFat16);
@@ -58,9 +65,16 @@ public:
 	void RescanDynamicDisk() override;
 
 protected:
+	struct FileEntry;
+
 	void FormatVolume();
-	void BuildDirectory();
+	bool UpdateDirectory(bool preserveLayout);
 	void AutoSizeVolume();
+	void ReadDirectorySector(uint32 dirSector, uint8 *dst) const;
+	void GenerateDirEntries(const FileEntry& fe, uint8 *dst) const;
+
+	static void ComputeShortName(FileEntry& fe);
+	static uint32 ComputeDirSlotCount(const FileEntry& fe);
 
 	VDFile mFile;
 	sint32 mActiveFileIndex = -1;
@@ -76,19 +90,38 @@ protected:
 	struct FileEntry {
 		VDStringW mFileName;
 		uint8 mShortName[11];
-		vdfastvector<uint16> mLongName;
 		bool mbLFNRequired;
 		uint32 mFileSize;
 		uint32 mStartingCluster;
+		uint32 mClusterCount;
+		uint32 mDirSlot;			// first 32-byte directory slot, including LFN slots
+		uint32 mDirSlotCount;
 		VDDate mCreationDate;
 		VDDate mLastWriteDate;
 	};
 
+	static constexpr uint32 kRootDirFileIndex = ~(uint32)0;
+
+	// Run of clusters [mStart, mEnd) owned by a file or the root directory.
+	// Extents are sorted and never overlap; gaps are free clusters.
+	struct ClusterExtent {
+		uint32 mStart;
+		uint32 mEnd;
+		uint32 mFileIndex;
+	};
+
 	ATBlockDeviceGeometry mGeometry {};
 
 	vdvector<FileEntry> mFiles;
-	vdfastvector<uint8> mRootDirectory;
-	vdfastvector<uint32> mDataClusterBoundaries;
+	vdfastvector<ClusterExtent> mExtents;
+	uint32 mDirSlotCount = 0;
+	uint32 mRootDirCluster = 0;		// FAT32 only
+	uint32 mRootDirClusterCount = 0;
+	uint32 mClusterLimit = 2;
+	uint32 mAllocatedClusters = 0;
+
+	ATDirectoryWatcher mDirWatcher;
+	bool mbDirWatcherActive = false;
 
 	uint8 mBootSectors[512 * 16] {};
 };
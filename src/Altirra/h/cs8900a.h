@@ -33,6 +33,8 @@ public:
 	void ColdReset();
 	void WarmReset();
 
+	uint32 GetEndpointId() const { return mEthernetEndpointId; }
+
 	uint8 DebugReadByte(uint8 address);
 	uint8 ReadByte(uint8 address);
 	void WriteByte(uint8 address, uint8 value);
@@ -24,6 +24,7 @@
 #include <at/atcore/deviceindicators.h>
 #include <at/atcore/devicesioimpl.h>
 #include <at/atcore/devicepbi.h>
+#include <at/atvm/calltable.h>
 #include <at/atvm/vm.h>
 #include <at/atvm/compiler.h>
 
@@ -185,7 +186,8 @@ private:
 		Block,
 		Network,
 		Script,
-		Variable
+		Variable,
+		BankSwitch
 	};
 
 	enum class SerialFenceId : uint32 {
@@ -215,6 +217,11 @@ private:
 			uint8 mByteData;
 			uint16 mScriptFunctions[2];
 			uint32 mVariableIndex;
+
+			struct {
+				uint16 mActionIndex;
+				uint16 mDebugScriptFunction;
+			} mBankSwitch;
 		};
 	};
 
@@ -345,6 +352,9 @@ private:
 
 	void ReloadConfig();
 
+	void LowerScriptBindings();
+	uint8 RunBankSwitch(const ATVMCallTable& action, uint32 addr, uint8 value);
+
 	class MemberParser;
 
 	void ProcessDesc(const void *buf, size_t len);
@@ -413,6 +423,7 @@ private:
 	SIODeviceTable *mpSIODeviceTable = nullptr;
 
 	vdfastvector<const ATVMFunction *> mScriptFunctions;
+	vdvector<ATVMCallTable> mBankSwitchActions;
 	ATVMThread mVMThread;
 	ATVMThread mVMThreadSIO;
 	ATVMThread mVMThreadScriptInterrupt;
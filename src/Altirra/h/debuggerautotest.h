@@ -0,0 +1,58 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef f_AT_DEBUGGERAUTOTEST_H
+#define f_AT_DEBUGGERAUTOTEST_H
+
+#include <vd2/system/VDString.h>
+
+struct ATGTIAVideoHash;
+
+// Matching logic for .autotest_checkvideohash, .autotest_waitvideohash and
+// .autotest_assertvideohash. OnHash() is called from the GTIA video hash
+// callback and only records the outcome, as the debugger can't be broken
+// into from there; the active command stops the emulator when a frame
+// completes the command, and reports any assertion failure afterward.
+class ATAutotestVideoHashMatcher {
+public:
+	enum class Mode : uint8 {
+		Check,
+		Wait,
+		Assert
+	};
+
+	// line is the index into the line hashes (scanline - 8), or -1 to match
+	// the frame hash.
+	ATAutotestVideoHashMatcher(Mode mode, uint64 hash, sint32 line, bool printLines);
+
+	// Process the hashes for a frame. Returns true if this frame completed
+	// the command; later frames are ignored.
+	bool OnHash(const ATGTIAVideoHash& hash);
+
+	bool IsCompleted() const { return mbCompleted; }
+	bool IsFailed() const { return !mFailureMessage.empty(); }
+	const char *GetFailureMessage() const { return mFailureMessage.c_str(); }
+
+private:
+	bool mbCompleted = false;
+	Mode mMode;
+	bool mbPrintLines;
+	sint32 mLine;
+	uint64 mHash;
+	VDStringA mFailureMessage;
+};
+
+#endif
@@ -14,6 +14,11 @@ public:
 	ATDirectoryWatcher();
 	~ATDirectoryWatcher();
 
+	// Start watching. On return, any change made to the directory after
+	// the call will be reported, so the caller can safely scan the
+	// directory afterward. When polling, the initial directory walk runs
+	// on the watcher thread and everything is reported as changed once it
+	// completes.
 	void Init(const wchar_t *basePath, bool recursive = true);
 	void Shutdown();
 
@@ -22,9 +27,10 @@ public:
 
 protected:
 	void ThreadRun();
-	void RunPollThread();
+	void RunPollThread(bool ready);
+	void PollDirectory(uint32 *orderIndependentChecksum);
 	void PollDirectory(uint32 *orderIndependentChecksum, const VDStringSpanW& path, uint32 nestingLevel);
-	void RunNotifyThread();
+	bool RunNotifyThread(bool& ready);
 	void NotifyAllChanged();
 
 	VDStringW mBasePath;
@@ -34,6 +40,7 @@ protected:
 	char *mpChangeBuffer;
 	uint32 mChangeBufferSize;
 	bool mbRecursive;
+	VDSignal mReadySignal;
 
 	VDCriticalSection mMutex;
 	typedef vdhashset<VDStringW, vdstringhashi, vdstringpredi> ChangedDirs;
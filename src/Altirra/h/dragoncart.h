@@ -25,6 +25,8 @@
 class ATMemoryManager;
 class ATMemoryLayer;
 class ATEthernetBus;
+class ATEthernetCapturePlayer;
+class ATEthernetCaptureWriter;
 class ATEthernetSimClock;
 class IATEthernetGatewayServer;
 class IATNetSockWorker;
@@ -83,10 +85,23 @@ public:
 	void OpenPacketTrace(const wchar_t *path);
 	void ClosePacketTrace();
 
+	// Record all frames on the emulation network to a capture file. Closing
+	// the capture throws if writing to the file failed during the capture.
+	void OpenNetCapture(const wchar_t *path);
+	void CloseNetCapture();
+
+	// Replay a capture file in place of the gateway and host networking,
+	// which are restored when the replay is closed.
+	void OpenNetReplay(const wchar_t *path);
+	void CloseNetReplay();
+
 public:
 	void ReceiveFrame(const ATEthernetPacket& packet, ATEthernetFrameDecodedType decType, const void *decInfo) override;
 
 protected:
+	void InitNetwork();
+	void ShutdownNetwork();
+
 	static sint32 OnDebugRead(void *thisptr, uint32 addr);
 	static sint32 OnRead(void *thisptr, uint32 addr);
 	static bool OnWrite(void *thisptr, uint32 addr, uint8 value);
@@ -100,6 +115,7 @@ protected:
 	IATNetSockWorker *mpNetSockWorker;
 	IATNetSockVxlanTunnel *mpNetSockVxlanTunnel = nullptr;
 	uint32 mEthernetClockId;
+	IATAsyncDispatcher *mpAsyncDispatcher = nullptr;
 
 	ATDragonCartSettings mSettings;
 
@@ -110,6 +126,9 @@ protected:
 	uint32 mPacketTraceEndpointId = 0;
 	uint32 mPacketTraceStartTimestamp = 0;
 	sint64 mPacketTraceStartTime;
+
+	vdautoptr<ATEthernetCaptureWriter> mpNetCapture;
+	vdautoptr<ATEthernetCapturePlayer> mpNetReplay;
 };
 
 #endif
@@ -51,9 +51,23 @@ public:
 
 using ATGTIARawFrameFn = vdfunction<void(const VDPixmap& px)>;
 
+// Hashes of the raw rendered output for the 240 visible scanlines (8-247),
+// before artifacting and post-processing. Lines are hashed over the full
+// raw width, which is 8-bit palette indices for GTIA and 32-bit RGB for VBXE;
+// the frame hash is a hash of the line hashes. These are intended for fast
+// regression checks and are only stable within the same output format.
+struct ATGTIAVideoHash {
+	uint64 mFrameHash;
+	uint64 mLineHashes[240];
+	bool mbRgb32;
+};
+
+using ATGTIAVideoHashFn = vdfunction<void(const ATGTIAVideoHash& hash)>;
+
 class ATFrameBuffer;
 class ATFrameTracker;
 class ATArtifactingEngine;
+class VDDisplayScreenFXSoft;
 class ATSaveStateReader;
 class IATObjectState;
 class ATGTIARenderer;
@@ -225,6 +239,10 @@ struct ATVideoFrameProperties {
 	bool mbAccelScanlines;
 	bool mbAccelPalArtifacting;
 	bool mbAccelOutputCorrection;
+
+	// Distortion and/or bloom are enabled but not supported by the display, so they
+	// are being done on the CPU when the display requests emulated screen FX.
+	bool mbSoftScreenFX;
 };
 
 uint32 ATGetColorPresetCount();
@@ -303,6 +321,7 @@ public:
 
 	bool IsFrameInProgress() const { return mpFrame != NULL; }
 	bool AreAcceleratedEffectsAvailable() const;
+	bool AreSoftwareScreenEffectsAvailable() const;
 
 	enum class HDRAvailability : uint8 {
 		NoMinidriverSupport,
@@ -445,6 +464,11 @@ public:
 	void AddRawFrameCallback(const ATGTIARawFrameFn *fn);
 	void RemoveRawFrameCallback(const ATGTIARawFrameFn *fn);
 
+	// Video hash callbacks are only invoked for frames where hashing was
+	// active from the first visible scanline.
+	void AddVideoHashCallback(const ATGTIAVideoHashFn *fn);
+	void RemoveVideoHashCallback(const ATGTIAVideoHashFn *fn);
+
 	bool IsLastFrameBufferAvailable() const;
 	bool GetLastFrameBuffer(VDPixmapBuffer& pxbuf, VDPixmap& px) const;
 	bool GetLastFrameBufferRaw(VDPixmapBuffer& pxbuf, VDPixmap& px, float& par) const;
@@ -686,6 +710,7 @@ protected:
 	uint32		mPreArtifactFrameVisibleY2;
 
 	ATArtifactingEngine	*mpArtifactingEngine;
+	VDDisplayScreenFXSoft *mpSoftScreenFX;
 	vdrefptr<ATFrameBuffer> mpLastFrame;
 
 	ATGTIARenderer *mpRenderer;
@@ -698,6 +723,9 @@ protected:
 	ATGTIAColorTrace mColorTrace {};
 
 	ATNotifyList<const ATGTIARawFrameFn *> mRawFrameCallbacks;
+	ATNotifyList<const ATGTIAVideoHashFn *> mVideoHashCallbacks;
+	bool mbVideoHashActive = false;
+	ATGTIAVideoHash mVideoHash {};
 
 	VDLinearAllocator mNodeAllocator;
 };
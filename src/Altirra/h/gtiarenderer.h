@@ -78,6 +78,9 @@ class ATGTIARenderer : public VDAlignedObject<16> {
 	ATGTIARenderer(const ATGTIARenderer&);
 	ATGTIARenderer& operator=(const ATGTIARenderer&);
 public:
+	// Size of the merge and ANTIC buffers passed to BeginScanline().
+	static constexpr int kLineBufferSize = 228 + 12;
+
 	ATGTIARenderer();
 	~ATGTIARenderer();
 
@@ -86,9 +89,14 @@ public:
 	void SetCTIAMode();
 	void SetSECAMMode(bool secam) { mbSECAMMode = secam; }
 
+	// Enables splitting of spans with P/M graphics into runs with and without
+	// P/M data, so the runs without go through the fast renderers. This is on
+	// by default; turning it off is only useful for comparing the two paths.
+	void SetPMSpanSplitting(bool enable) { mbSplitPMSpans = enable; }
+
 	void ColdReset();
 
-	void BeginScanline(uint8 *dst, const uint8 *mergeBuffer, const uint8 *anticBuffer, bool hires);
+	void BeginScanline(int y, uint8 *dst, const uint8 *mergeBuffer, const uint8 *anticBuffer, bool hires);
 	void RenderScanline(int x2, bool pfgraphics, bool pmgraphics, bool mixed);
 	uint32 SenseScanline(int hpx1, int hpx2, const uint8 *weights) const;
 	void EndScanline();
@@ -110,7 +118,54 @@ protected:
 		uint8 mPad;
 	};
 
+	// Scanline memo. On static screens, most scanlines are rendered from the
+	// same inputs every frame, so the output of each whole-line render is kept
+	// along with everything it was rendered from and is reused when the same
+	// line comes up again with identical inputs. ANTIC's decoded playfield is
+	// part of the key, so this covers the display list, playfield and font data
+	// without having to track them separately. Only lines that are slower to
+	// render than to look up are cached: hires, GTIA mode and P/M lines. A row
+	// that misses kLineCacheMaxMisses frames in a row bypasses the cache for
+	// the next kLineCacheMissSkipFrames frames.
+	static constexpr int kLineCacheHeight = 312;
+	static constexpr int kLineCacheMaxChanges = 32;
+	static constexpr int kLineCacheEndX = 222;
+	static constexpr int kLineCacheMaxMisses = 4;
+	static constexpr int kLineCacheMissSkipFrames = 60;
+
+	struct LineCacheState {
+		uint8 mColorTable[24];
+		uint8 mPRIOR;
+		uint8 mFlags;
+		uint8 mTransition;
+		uint8 mChangeCount;
+		RegisterChange mChanges[kLineCacheMaxChanges];
+	};
+
+	struct LineCacheEntry {
+		bool mbValid;
+		uint8 mMissCount;
+		uint8 mSkipCount;
+		LineCacheState mState;
+		uint8 mMergeBuffer[kLineBufferSize];
+		uint8 mAnticBuffer[kLineBufferSize];
+		uint8 mOutput[kLineCacheEndX * 2];
+	};
+
+	bool InitLineCacheState(LineCacheState& state, int xend, bool pfgraphics, bool pmgraphics, bool mixed) const;
+
 	template<class T> void ExchangeState(T& io);
+
+	// Span renderers specialized by GTIA mode (PRIOR bits 6-7), hires mode, and
+	// whether P/M graphics need to go through the priority logic. One is picked
+	// from the table per span so the mode checks are not repeated per pixel.
+	typedef void (ATGTIARenderer::*RenderSpanFn)(int x1, int x2);
+	static const RenderSpanFn kRenderSpanFns[4][2][2];
+
+	template<uint8 T_Mode, bool T_Hires, bool T_PMGraphics> void RenderSpan(int x1, int x2);
+	template<uint8 T_Mode, bool T_Hires> void RenderSpanFast(int x1, int x2);
+	template<uint8 T_Mode, bool T_Hires> void RenderSpanFull(int x1, int x2);
+
 	void UpdateRegisters(const RegisterChange *changes, int count);
 	void RenderBlank(int x1);
 	void RenderLores(int x1, int x2);
@@ -143,6 +198,7 @@ protected:
 	uint8 mTransitionPhase;
 	bool mbVBlank;
 	bool mbSECAMMode;
+	bool mbSplitPMSpans = true;
 	uint8 mPRIOR;
 
 	const uint8 *mpPriTable;
@@ -151,6 +207,9 @@ protected:
 	typedef vdfastvector<RegisterChange> RegisterChanges;
 	RegisterChanges mRegisterChanges;
 
+	int mLineCacheY = -1;
+	vdblock<LineCacheEntry> mLineCache;
+
 	VDALIGN(16) uint8	mColorTable[24];
 	uint8	mPriorityTables[32][256];
 };
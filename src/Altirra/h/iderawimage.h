@@ -19,10 +19,11 @@
 #define f_AT_IDERAWIMAGE_H
 
 #include <at/atcore/blockdevice.h>
+#include <at/atcore/blockdevicecache.h>
 #include <at/atcore/deviceimpl.h>
 #include <vd2/system/file.h>
 
-class ATIDERawImage final : public ATDevice, public IATBlockDevice {
+class ATIDERawImage final : public ATDevice, public IATBlockDevice, public IATBlockDeviceCacheStats {
 	ATIDERawImage(const ATIDERawImage&) = delete;
 	ATIDERawImage& operator=(const ATIDERawImage&) = delete;
 public:
@@ -55,7 +56,13 @@ public:
 	void ReadSectors(void *data, uint32 lba, uint32 n) override;
 	void WriteSectors(const void *data, uint32 lba, uint32 n) override;
 
+public:
+	ATBlockDeviceCacheStats GetCacheStats() const override;
+
 protected:
+	void ReadSectorsDirect(void *data, uint32 lba, uint32 n);
+	void WriteSectorsDirect(const void *data, uint32 lba, uint32 n);
+
 	VDFile mFile;
 	VDStringW mPath;
 	uint32 mSectorCount;
@@ -63,6 +70,8 @@ protected:
 	bool mbReadOnly;
 
 	ATBlockDeviceGeometry mGeometry = {};
+
+	ATBlockDeviceCache mCache;
 };
 
 #endif
@@ -19,6 +19,7 @@
 #define f_AT_IDEVHDIMAGE_H
 
 #include <at/atcore/blockdevice.h>
+#include <at/atcore/blockdevicecache.h>
 #include <at/atcore/deviceimpl.h>
 #include <vd2/system/binary.h>
 #include <vd2/system/file.h>
@@ -75,7 +76,7 @@ struct ATVHDDynamicDiskHeader {
 	uint8	mReserved2[256];
 };
 
-class ATIDEVHDImage final : public IATBlockDevice, public IATBlockDeviceDirectAccess, public ATDevice {
+class ATIDEVHDImage final : public IATBlockDevice, public IATBlockDeviceDirectAccess, public IATBlockDeviceCacheStats, public ATDevice {
 	ATIDEVHDImage(const ATIDEVHDImage&) = delete;
 	ATIDEVHDImage& operator=(const ATIDEVHDImage&) = delete;
 public:
@@ -118,8 +119,13 @@ public:
 public:
 	VDStringW GetVHDDirectAccessPath() const override;
 
+public:
+	ATBlockDeviceCacheStats GetCacheStats() const override;
+
 private:
 	void InitCommon();
+	void ReadSectorsDirect(void *data, uint32 lba, uint32 n);
+	void WriteSectorsDirect(const void *data, uint32 lba, uint32 n);
 	void ReadDynamicDiskSectors(void *data, uint32 lba, uint32 n);
 	void WriteDynamicDiskSectors(const void *data, uint32 lba, uint32 n);
 	void SetCurrentBlock(uint32 blockIndex);
@@ -152,6 +158,8 @@ private:
 	ATVHDDynamicDiskHeader mDynamicHeader;
 
 	vdrefptr<ATIDEVHDImage> mpParentImage;
+
+	ATBlockDeviceCache mCache;
 };
 
 #endif
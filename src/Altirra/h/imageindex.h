@@ -0,0 +1,129 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef f_AT_IMAGEINDEX_H
+#define f_AT_IMAGEINDEX_H
+
+#include <vd2/system/function.h>
+#include <vd2/system/VDString.h>
+#include <vd2/system/vdstl.h>
+#include <vd2/system/vdstl_hashmap.h>
+#include <at/atcore/checksum.h>
+#include <at/atio/image.h>
+
+class VDThreadPool;
+enum class ATFirmwareDetection : uint32;
+enum ATSpecificFirmwareType : uint32;
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	Image index
+//
+//	The image index is a persistent catalog of image files, recording the
+//	VFS path and SHA-256 of the file contents for each image along with the
+//	detected image type, firmware identification, and compatibility
+//	database title, so that large libraries can be cataloged without
+//	reopening and rehashing every file on each scan.
+//
+//	Entries inside zip archives are indexed with zip:// VFS paths. The host
+//	file size and timestamp are recorded so that an update can reuse
+//	entries for files that have not changed.
+//
+//	Host files that were scanned but contain no recognizable image are
+//	recorded as a single negative entry under the host path, so that they
+//	are not reopened on the next scan either.
+//
+///////////////////////////////////////////////////////////////////////////
+
+struct ATImageIndexEntry {
+	VDStringW mPath;
+	uint64 mHostSize = 0;
+	uint64 mHostTimestamp = 0;
+	uint64 mSize = 0;
+	uint32 mCRC32 = 0;
+	ATChecksumSHA256 mSHA256 {};
+	ATImageType mImageType = kATImageType_None;
+
+	// Firmware type name as used by ATGetFirmwareTypeFromName(), or empty
+	// if the image was not recognized as firmware.
+	VDStringA mFirmwareType;
+	VDStringW mFirmwareName;
+	ATSpecificFirmwareType mSpecificFirmwareType {};
+	ATFirmwareDetection mFirmwareDetection {};
+
+	// UTF-8 title from the compatibility database, if any.
+	VDStringA mCompatTitle;
+
+	// False for a negative entry recording a host file with no image.
+	bool IsImage() const;
+};
+
+class ATImageIndex {
+public:
+	void Clear();
+
+	// Load/save the index. Load() throws on an invalid or truncated file.
+	void Load(const wchar_t *path);
+	void Save(const wchar_t *path) const;
+
+	// Returns the number of entries, including negative entries.
+	size_t GetCount() const { return mEntries.size(); }
+	const ATImageIndexEntry& GetEntry(size_t idx) const { return mEntries[idx]; }
+
+	const ATImageIndexEntry *FindByPath(const wchar_t *path) const;
+
+	// Same as FindByPath(), but only returns the entry if the host file
+	// still has the size and timestamp it had when it was indexed.
+	const ATImageIndexEntry *FindByPath(const wchar_t *path, uint64 hostSize, uint64 hostTimestamp) const;
+
+	void SetEntries(vdvector<ATImageIndexEntry>&& entries);
+
+private:
+	vdvector<ATImageIndexEntry> mEntries;
+	vdhashmap<VDStringW, size_t> mPathLookup;
+};
+
+// Return the path of the default index for a directory tree, which is
+// placed at the root of the tree.
+VDStringW ATImageIndexGetDefaultPath(const wchar_t *rootPath);
+
+// Load the default index at the root of a directory tree, if there is one.
+// Returns false with the index cleared if there is no usable index.
+bool ATImageIndexLoadForDirectory(ATImageIndex& index, const wchar_t *rootPath);
+
+struct ATImageIndexUpdateStats {
+	uint32 mFilesScanned = 0;
+	uint32 mFilesReused = 0;
+	uint32 mEntriesIndexed = 0;
+	uint32 mErrors = 0;
+};
+
+// Rescan the given directory tree and update the index. Files in the
+// previous index contents are reused when the host file is unchanged.
+// Scanning runs on the given thread pool; the progress callback, if any,
+// is called on the calling thread with (completed, total) counts.
+ATImageIndexUpdateStats ATImageIndexUpdate(
+	ATImageIndex& index,
+	const wchar_t *rootPath,
+	VDThreadPool& pool,
+	const vdfunction<void(uint32, uint32)>& progressFn);
+
+// Headless entry point for /buildindex: index the given directory into the
+// given index file and return a process exit code. Errors and a summary are
+// written to the console of the parent process.
+int ATImageIndexRunCommand(const wchar_t *rootPath, const wchar_t *indexPath);
+
+#endif
@@ -30,7 +30,20 @@ enum class ATMonitorMode : uint8;
 //
 class ATColorPaletteGenerator {
 public:
+	// Decoded signal parameters shared by all luma levels, for color output.
+	struct ColorSetup {
+		// Chroma offset in RGB for each hue, before gamma and color matching.
+		vdfloat3 mChroma[16];
+
+		// Color matching matrix to apply in linear RGB, if any.
+		std::optional<vdfloat3x3> mColorMatchingMatrix;
+
+		// Output gamma after the color matching matrix, or 0 for sRGB.
+		float mOutputGamma;
+	};
+
 	void Generate(const ATColorParams& colorParams, ATMonitorMode monitorMode);
+	static void ComputeColorSetup(const ATColorParams& colorParams, ColorSetup& setup);
 	static void GenerateMonoRamp(const ATColorParams& colorParams, ATMonitorMode monitorMode, uint32 ramp[256]);
 	static void GenerateMonoPersistenceRamp(const ATColorParams& colorParams, ATMonitorMode monitorMode, uint32 ramp[1024]);
 	static vdfloat32x3 ClipLinearColorToSRGB(vdfloat32x3 c);
@@ -47,4 +47,10 @@ public:
 
 IATColorPaletteSolver *ATCreateColorPaletteSolver();
 
+// Compute the score that the solver minimizes for a set of parameters, which
+// is the sum of squared RGB errors against the target palette excluding luma
+// 0 of each hue. The reference version uses exact pow() instead of the
+// vectorized approximation. This is only needed for testing.
+uint32 ATComputeColorPaletteSolverScore(const ATColorParams& params, const uint32 palette[256], bool reference);
+
 #endif
@@ -18,6 +18,33 @@
 #ifndef f_SAPCONVERTER_H
 #define f_SAPCONVERTER_H
 
+#include <vd2/system/VDString.h>
+#include <vd2/system/vdstl.h>
+
+struct ATSAPHeader {
+	char mType = 0;
+	sint32 mInitAddr = -1;
+	sint32 mPlayerAddr = -1;
+	sint32 mMusicAddr = -1;
+	uint8 mDefSong = 0;
+	uint8 mSongCount = 1;
+	bool mbPal = true;
+	bool mbStereo = false;
+	uint32 mFastPlay = 0;			// scanlines per player call, or 0 for once per frame
+
+	VDStringA mAuthor;
+	VDStringA mName;
+
+	// Song durations in milliseconds from TIME tags, in song order; 0 if
+	// missing or unparseable.
+	vdfastvector<uint32> mSongTimes;
+
+	// Offset of the binary section following the text header.
+	uint32 mDataOffset = 0;
+};
+
+void ATParseSAPHeader(const void *sap, uint32 len, ATSAPHeader& header);
+
 void ATConvertSAPToPlayer(const void *sap, uint32 len, vdfastvector<uint8>& result);
 void ATConvertSAPToPlayer(const wchar_t *outputPath, const wchar_t *inputPath);
 
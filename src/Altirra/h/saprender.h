@@ -0,0 +1,57 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef f_AT_SAPRENDER_H
+#define f_AT_SAPRENDER_H
+
+#include <vd2/system/VDString.h>
+#include <vd2/system/vdstl.h>
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	Headless SAP rendering
+//
+//	Plays SAP tunes with only a 6502, RAM and POKEY(s) and writes the output
+//	through the same filtering and resampling as audio recording, without
+//	the simulator, display or audio device. Type B, C and R files are
+//	supported; type D needs interrupts and the display and is rejected.
+//
+///////////////////////////////////////////////////////////////////////////
+
+struct ATSAPRenderJob {
+	VDStringW mSrcPath;
+	VDStringW mDstPath;
+	sint32 mSong = -1;				// -1 for the default song
+	uint32 mDefaultSeconds = 180;	// used if the song has no TIME tag
+
+	// results
+	bool mbSucceeded = false;
+	VDStringA mError;
+	double mAudioSeconds = 0;
+	double mHostSeconds = 0;
+};
+
+// Return the number of songs in a SAP file. Throws on error.
+uint32 ATGetSAPSongCount(const wchar_t *path);
+
+// Render a single job to a WAV file. Throws on error.
+void ATRenderSAPToWAV(ATSAPRenderJob& job);
+
+// Render a set of jobs in parallel. Errors are recorded per job rather than
+// thrown. A thread count of zero uses all logical processors.
+void ATRenderSAPBatch(vdvector<ATSAPRenderJob>& jobs, uint32 threadCount);
+
+#endif
@@ -440,6 +440,12 @@ public:
 
 	ATSnapshotStatus GetSnapshotStatus() const;
 	void CreateSnapshot(IATSerializable **snapshot, IATSerializable **snapInfo);
+
+	// Drain write-behind caches on block devices so that host disk images are
+	// consistent with the emulated state. This is done for snapshots that the
+	// user saves, but not for automatic rewind snapshots, which are taken too
+	// often to block on disk I/O.
+	void FlushBlockDevices();
 	bool ApplySnapshot(const IATSerializable& snapshot, ATStateLoadContext *context);
 
 	void UpdateFloatingBus();
@@ -23,4 +23,10 @@ bool ATStartupLogIsInited();
 void ATStartupLog(const char *msg);
 void ATStartupLog(VDStringSpanA msg);
 
+// Console used by the startup log and by headless command-line operations.
+// Attach returns false if there is no parent console; writes are dropped if
+// no console is attached.
+bool ATStartupAttachConsole();
+void ATStartupWriteConsole(VDStringSpanA s);
+
 #endif
@@ -58,6 +58,10 @@ public:
 
 	virtual void SetTracingSize(sint64 size) = 0;
 
+	// Number of video frames dropped by the recorder since recording started;
+	// cleared by SetRecordingPosition().
+	virtual void SetRecordingDroppedFrames(uint32 count) = 0;
+
 	virtual void SetAudioStatus(const ATUIAudioStatus *status) = 0;
 
 	virtual void SetAudioMonitor(bool secondary, ATAudioMonitor *monitor) = 0;
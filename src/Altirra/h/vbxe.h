@@ -20,12 +20,14 @@
 
 #include <vd2/system/vdstl.h>
 #include <at/atcore/scheduler.h>
+#include "vbxeoverlaytext.h"
 
 class ATConsoleOutput;
 class ATMemoryManager;
 class ATMemoryLayer;
 class ATIRQController;
 struct ATTraceContext;
+struct ATVBXEBlitCollisionState;
 class ATTraceChannelSimple;
 class ATTraceChannelFormatted;
 class ATPaletteCorrector;
@@ -295,6 +297,7 @@ private:
 	uint32 mBlitterStopTime = 0;
 	uint32 mBlitterEndScanTime = 0;
 	uint8 mBlitterMode;
+	uint32 (*mpBlitRowFn)(uint8 *dst, const uint8 *src, uint32 n, uint8 andMask, uint8 xorMask, ATVBXEBlitCollisionState& collision) = nullptr;
 	sint32 mBlitCyclesLeft;
 	sint32 mBlitCyclesPerRow;
 	sint32 mBlitCyclesSavedPerZero;
@@ -375,6 +378,9 @@ private:
 	uint8	mOvPriDecode[456*2];		// 14MHz (320) - priority,collision pairs
 	uint8	mOvTextTrans[912];			// 28MHz (640) - text translucency pixel masks
 
+	uint32	mOvTextCacheY = 0;
+	ATVBXEOverlayTextCache mOvTextCache;
+
 	struct AttrPixel {
 		uint8 mPFK;
 		uint8 mPF0;
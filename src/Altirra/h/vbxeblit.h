@@ -0,0 +1,91 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef f_AT_VBXEBLIT_H
+#define f_AT_VBXEBLIT_H
+
+#include <vd2/system/vdtypes.h>
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	VBXE blitter row kernels
+//
+//	These handle a single blitter row in the unzoomed, non-pattern case with
+//	+1 source and destination steps, which is what nearly all full-screen
+//	blits use. All blitter modes reduce to a per-byte function of the
+//	masked source byte and the destination byte, so they vectorize cleanly;
+//	collision detection is resolved in order by falling back to a scalar
+//	check only for chunks that could collide.
+//
+//	The source and destination rows must not wrap VBXE memory, and the
+//	destination must not start inside the source row after the source start,
+//	as the blitter's byte-serial behavior would then propagate written bytes.
+//	The source is not read if the AND mask is zero.
+//
+///////////////////////////////////////////////////////////////////////////
+
+struct ATVBXEBlitCollisionState {
+	uint8 mActiveMask;
+	uint8 mCode;
+};
+
+// Returns the number of zero bytes after masking, which the blitter uses to
+// credit cycles. Mode 0 always returns zero.
+using ATVBXEBlitRowFn = uint32 (*)(uint8 *dst, const uint8 *src, uint32 n, uint8 andMask, uint8 xorMask, ATVBXEBlitCollisionState& collision);
+
+ATVBXEBlitRowFn ATVBXEGetBlitRowFn_Scalar(uint8 mode);
+
+#if VD_CPU_X86 || VD_CPU_X64
+ATVBXEBlitRowFn ATVBXEGetBlitRowFn_SSE2(uint8 mode);
+#endif
+
+#if VD_CPU_ARM64
+ATVBXEBlitRowFn ATVBXEGetBlitRowFn_NEON(uint8 mode);
+#endif
+
+// Returns the best available kernel for the mode (0-6).
+ATVBXEBlitRowFn ATVBXEGetBlitRowFn(uint8 mode);
+
+// Scalar collision check for one source/destination byte pair. Used by the
+// vector kernels to resolve chunks that may collide.
+template<uint8 T_Mode>
+inline void ATVBXEBlitCheckCollision(uint8 c, uint8 d, ATVBXEBlitCollisionState& collision) {
+	if (!c || !d)
+		return;
+
+	if constexpr (T_Mode == 6) {
+		if ((c & 0x0f) && (d & 0x0f)) {
+			if ((1 << ((d >> 1) & 7)) & collision.mActiveMask) {
+				collision.mCode = (collision.mCode & 0xf0) + (d & 0x0f);
+				collision.mActiveMask = 0;
+			}
+		}
+
+		if ((c & 0xf0) && (d & 0xf0)) {
+			if ((1 << ((d >> 5) & 7)) & collision.mActiveMask) {
+				collision.mCode = (collision.mCode & 0x0f) + (d & 0xf0);
+				collision.mActiveMask = 0;
+			}
+		}
+	} else if constexpr (T_Mode != 0) {
+		if ((1 << (d >> 5)) & collision.mActiveMask) {
+			collision.mCode = d;
+			collision.mActiveMask = 0;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,79 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef f_AT_VBXEOVERLAYTEXT_H
+#define f_AT_VBXEOVERLAYTEXT_H
+
+#include <vd2/system/vdstl.h>
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	VBXE 80-column text overlay decoding
+//
+//	A text row is a run of character/attribute byte pairs in VBXE memory,
+//	displayed with one row of 8 pixel wide glyphs from a 2K character set
+//	per scanline. Each color clock is four pixels, or half a character.
+//
+///////////////////////////////////////////////////////////////////////////
+
+// Decode w color clocks of a text row starting at color clock x1, to one
+// byte per pixel in dst. With translucency enabled, the pixel masks for
+// translucent attributes also go to transDst; otherwise transDst is unused.
+// The text fetch wraps around VBXE memory; glyphRow is the selected row of
+// the character set.
+void ATVBXEDecodeOverlayText(uint8 *dst, uint8 *transDst, const uint8 *mem, uint32 textAddr, const uint8 *glyphRow, int x1, int w, bool trans);
+
+// Text overlay decode with dirty row tracking. The text bytes and the
+// character set contents that each scanline was last decoded from are kept
+// along with the decoded pixels, and the pixels are reused while neither
+// has changed. Memory is compared rather than tracked through writes, as
+// the CPU writes VBXE memory directly through the MEMAC windows. Only the
+// last character set is kept, so a display that switches character sets
+// partway down the screen is always decoded.
+class ATVBXEOverlayTextCache {
+public:
+	static constexpr uint32 kMaxLines = 248;
+	static constexpr int kMaxWidth = 170;
+
+	// Decode the whole overlay width of scanline y, as for
+	// ATVBXEDecodeOverlayText() with x1 = 0. Returns true if the line was
+	// unchanged and was copied from the last decode. Lines past the end of
+	// the cache, wider than kMaxWidth, or whose text wraps around VBXE
+	// memory are always decoded.
+	bool Decode(uint32 y, uint8 *dst, uint8 *transDst, const uint8 *mem, uint32 textAddr, uint32 chAddr, uint32 textRow, int w, bool trans);
+
+private:
+	struct LineEntry {
+		bool mbValid;
+		bool mbTrans;
+		uint8 mTextRow;
+		uint8 mWidth;
+		uint32 mCharsetGeneration;
+		uint8 mText[kMaxWidth];
+		uint8 mDecode[kMaxWidth * 4];
+		uint8 mTrans[kMaxWidth * 4];
+	};
+
+	vdblock<LineEntry> mLines;
+
+	// Contents of the character set last used, and a count that is bumped
+	// whenever a line is decoded with a different one.
+	bool mbCharsetValid = false;
+	uint32 mCharsetGeneration = 0;
+	uint8 mCharset[2048];
+};
+
+#endif
@@ -0,0 +1,105 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef f_AT_VIDEOENCODER_H
+#define f_AT_VIDEOENCODER_H
+
+#include <vd2/system/vdtypes.h>
+
+struct VDPixmap;
+class VDThreadPool;
+class VDException;
+
+class IATMediaEncoder {
+public:
+	virtual ~IATMediaEncoder() = default;
+
+	virtual sint64 GetCurrentSize() = 0;
+
+	virtual void WriteVideo(const VDPixmap& px) = 0;
+
+	// Write a frame that repeats the previous one, for frames that were
+	// dropped before reaching the encoder. Frames are only dropped when the
+	// encoder runs on its own thread, so synchronous encoders needn't
+	// implement this.
+	virtual void WriteRepeatedVideo() { VDFAIL("Encoder does not support repeated frames."); }
+
+	virtual void BeginAudioFrame(uint32 bytes, uint32 samples) = 0;
+	virtual void WriteAudio(const sint16 *data, uint32 bytes) = 0;
+	virtual void EndAudioFrame() = 0;
+	virtual bool Finalize(VDException& e) = 0;
+};
+
+// Numbered PNG image sequence (<prefix>-000000.png, ...) with a WAV audio
+// track, where the prefix is the filename without its extension. Images are
+// numbered consecutively from the first frame written.
+IATMediaEncoder *ATCreateMediaEncoderPNGSequence(const wchar_t *filename, bool stereo);
+
+
+class IATVideoEncoder {
+public:
+	virtual ~IATVideoEncoder() {}
+
+	virtual void Compress(const VDPixmap& px, bool intra, bool encodeAll) = 0;
+
+	virtual uint32 GetEncodedLength() const = 0;
+	virtual const void *GetEncodedData() const = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	ZMBV encoder
+//
+//	Block rows are motion searched in bands of bandBlockRows rows, which are
+//	processed in parallel on the thread pool; large frames are also deflated
+//	in parallel chunks on the same pool. The band size is fixed rather than
+//	derived from the thread count so that the output does not depend on the
+//	number of threads. A band size of zero searches the frame as one band.
+//
+///////////////////////////////////////////////////////////////////////////
+
+IATVideoEncoder *ATCreateVideoEncoderZMBV(uint32 w, uint32 h, bool rgb32, VDThreadPool& threadPool, uint32 bandBlockRows = 4);
+
+// Motion search kernels. BlockDiff returns the number of differing bits
+// between a source and a reference block, ignoring the dummy alpha byte in
+// 32-bit mode. ComputeXor writes the XOR of the two blocks to a packed
+// buffer; the general version takes the block width in bytes and copies all
+// bytes, while the 16-pixel version clears the alpha byte. The 16-pixel
+// kernels ignore the width and need a 16-byte aligned source and pitch.
+using ATZMBVBlockDiffFn = int (*)(const uint8 *src, const uint8 *ref, ptrdiff_t pitch, uint32 w, uint32 h);
+using ATZMBVComputeXorFn = void (*)(uint8 *dst, const uint8 *src, const uint8 *ref, ptrdiff_t pitch, uint32 w, uint32 h);
+
+struct ATZMBVKernels {
+	ATZMBVBlockDiffFn mpBlockDiff;
+	ATZMBVBlockDiffFn mpBlockDiff16;
+	ATZMBVComputeXorFn mpComputeXor;
+	ATZMBVComputeXorFn mpComputeXor16;
+};
+
+ATZMBVKernels ATZMBVGetKernels_Scalar(bool rgb32);
+
+#if VD_CPU_X86 || VD_CPU_X64
+ATZMBVKernels ATZMBVGetKernels_SSE2(bool rgb32);
+#endif
+
+#if VD_CPU_ARM64
+ATZMBVKernels ATZMBVGetKernels_NEON(bool rgb32);
+#endif
+
+// Returns the best kernels available on the current CPU.
+ATZMBVKernels ATZMBVGetKernels(bool rgb32);
+
+#endif
@@ -16,6 +16,7 @@ enum ATVideoEncoding : uint8 {
 	kATVideoEncoding_WMV9,
 	kATVideoEncoding_H264_AAC,
 	kATVideoEncoding_H264_MP3,
+	kATVideoEncoding_PNGSequence,
 	kATVideoEncodingCount
 };
 
@@ -17,6 +17,7 @@
 #ifndef f_AT_XEP80_H
 #define f_AT_XEP80_H
 
+#include <vd2/system/vdstl.h>
 #include <vd2/system/vectors.h>
 #include <vd2/Kasumi/pixmap.h>
 #include <vd2/Kasumi/pixmaputils.h>
@@ -62,6 +63,18 @@ public:
 
 	uint32 GetFrameLayoutChangeCount();
 	uint32 GetFrameChangeCount() const;
+
+	// Frame buffer rects updated by the last frame update, relative to the
+	// frame change count returned by GetFrameDirtyBaseChangeCount(). An empty
+	// list means the entire frame buffer was redrawn.
+	uint32 GetFrameDirtyBaseChangeCount() const { return mFrameDirtyBaseChangeCount; }
+	const vdfastvector<vdrect32>& GetFrameDirtyRects() const { return mFrameDirtyRects; }
+
+	// Enables redrawing only the text cells that have changed since the last
+	// frame update. This is on by default; turning it off is only useful for
+	// comparing the two paths.
+	void SetIncrementalRedraw(bool enable) { mbIncrementalRedraw = enable; }
+
 	const vdrect32 GetDisplayArea() const;
 	double GetPixelAspectRatio() const;
 
@@ -149,6 +162,7 @@ private:
 	void UpdateCursorAddr();
 	void InvalidateCursor();
 	void InvalidateFrame();
+	void InitFrame();
 
 	void RebuildBlockGraphics();
 	void RebuildActiveFont();
@@ -268,6 +282,32 @@ private:
 
 	uint8 mRowPtrs[25];
 
+	// Text mode glyph state last rendered into the frame buffer for each
+	// character cell, used to redraw only the cells that have changed. This
+	// is the resolved glyph offset, cursor mask and reverse mask rather than
+	// the VRAM byte so that attribute, cursor, and double width changes are
+	// caught as well.
+	struct RenderedCell {
+		uint16 mGlyph;
+		uint16 mCursor;
+		uint16 mReverse;
+
+		bool operator==(const RenderedCell&) const = default;
+	};
+
+	bool mbIncrementalRedraw = true;
+	bool mbRenderedCellsValid = false;
+	int mRenderedCols = 0;
+	int mRenderedRows = 0;
+	uint8 mRenderedCharWidth = 0;
+	uint8 mRenderedCharHeight = 0;
+	uint8 mRenderedPrefetch[2] {};
+	uint8 mRenderedRowFonts[25] {};
+	RenderedCell mRenderedCells[25][256] {};
+
+	uint32 mFrameDirtyBaseChangeCount = 0;
+	vdfastvector<vdrect32> mFrameDirtyRects;
+
 	uint8 mVRAM[8192];
 
 	// Fonts by character, for three different modes:
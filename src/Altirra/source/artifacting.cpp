@@ -64,6 +64,8 @@
 #include <vd2/system/color.h>
 #include <vd2/system/cpuaccel.h>
 #include <vd2/system/math.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/threadpool.h>
 #include <vd2/system/vecmath.h>
 #include <vd2/system/vectors.h>
 #include <vd2/system/zip.h>
@@ -181,6 +183,7 @@ namespace {
 
 ATConfigVarFloat g_ATCVDisplayPersistanceTc1("display.persistence_tc1", 0);
 ATConfigVarFloat g_ATCVDisplayPersistanceTc2("display.persistence_tc2", 0.247f);
+ATConfigVarBool g_ATCVDisplayParallelArtifacting("display.parallel_artifacting", true);
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -645,34 +648,17 @@ void ATArtifactingEngine::BeginFrame(
 		}
 	}
 
-	if (pal && chromaArtifacts) {
-		if (chromaArtifactHi) {
-#if defined(VD_CPU_AMD64)
-			memset(mPALDelayLineUV, 0, sizeof mPALDelayLineUV);
-#else
-#if defined(VD_CPU_X86)
-			if (SSE2_enabled) {
-				memset(mPALDelayLineUV, 0, sizeof mPALDelayLineUV);
-			} else
-#endif
-			{
-				VDMemset32(mPALDelayLineUV, 0x20002000, sizeof(mPALDelayLineUV) / sizeof(mPALDelayLineUV[0][0]));
-			}
-#endif
-		} else {
-			memset(mPALDelayLine32, 0, sizeof mPALDelayLine32);
-		}
-	}
+	ResetDelayLine(mDelayLine);
 }
 
-void ATArtifactingEngine::Artifact8(uint32 y, uint32 dst[N], const uint8 src[N], bool scanlineHasHiRes, bool temporaryUpdate, bool includeHBlank) {
+void ATArtifactingEngine::Artifact8(uint32 y, uint32 dst[N], const uint8 src[N], bool scanlineHasHiRes, bool temporaryUpdate, bool includeHBlank, DelayLine& delayLine) {
 	if (!mbChromaArtifacts)
 		BlitNoArtifacts(dst, src, scanlineHasHiRes);
 	else if (mbPAL) {
 		if (mbChromaArtifactsHi)
-			ArtifactPALHi(dst, src, scanlineHasHiRes, (y & 1) != 0);
+			ArtifactPALHi(dst, src, scanlineHasHiRes, (y & 1) != 0, delayLine);
 		else
-			ArtifactPAL8(dst, src);
+			ArtifactPAL8(dst, src, delayLine);
 	} else {
 		if (mbChromaArtifactsHi)
 			ArtifactNTSCHi(dst, src, scanlineHasHiRes, includeHBlank);
@@ -713,9 +699,9 @@ void ATArtifactingEngine::Artifact8(uint32 y, uint32 dst[N], const uint8 src[N],
 // If PAL chroma artifacts are enabled, then the input must be YRGB instead of XRGB, where Y is luminance. This
 // is used to speed up the chroma blending calculations.
 //
-void ATArtifactingEngine::Artifact32(uint32 y, uint32 *dst, uint32 width, bool temporaryUpdate, bool includeHBlank) {
+void ATArtifactingEngine::Artifact32(uint32 y, uint32 *dst, uint32 width, bool temporaryUpdate, bool includeHBlank, DelayLine& delayLine) {
 	if (mbPAL && mbChromaArtifacts)
-		ArtifactPAL32(dst, width);
+		ArtifactPAL32(dst, width, delayLine);
 	else if (mbExpandedRangeInput && !mbExpandedRangeOutput)
 		ArtifactCompressRange(dst, width);
 
@@ -792,11 +778,105 @@ void ATArtifactingEngine::Deinterlace(uint32 y, uint32 *VDRESTRICT dst, const ui
 	}
 }
 
-void ATArtifactingEngine::ArtifactPAL8(uint32 dst[N], const uint8 src[N]) {
+void ATArtifactingEngine::ForEachBand(uint32 y1, uint32 y2, const vdfunction<void(uint32, DelayLine&)>& primeFn, const vdfunction<void(uint32, uint32, DelayLine&)>& fn) {
+	if (y2 <= y1)
+		return;
+
+	const uint32 h = y2 - y1;
+	uint32 bandCount = 1;
+
+	if (mForcedBandCount)
+		bandCount = std::min<uint32>(std::min<uint32>(mForcedBandCount, kMaxBands), h / kMinBandHeight);
+	else if (g_ATCVDisplayParallelArtifacting && h >= kMinBandHeight * 2)
+		bandCount = std::min<uint32>(GetThreadPool().GetThreadCount() + 1, h / kMinBandHeight);
+
+	if (bandCount <= 1) {
+		fn(y1, y2, mDelayLine);
+		return;
+	}
+
+	const auto getBandStart = [=](uint32 band) { return y1 + (uint32)(((uint64)h * band) / bandCount); };
+
+	for(uint32 band = 1; band < bandCount; ++band) {
+		DelayLine& delayLine = mBandDelayLines[band - 1];
+
+		ResetDelayLine(delayLine);
+		primeFn(getBandStart(band) - 1, delayLine);
+	}
+
+	GetThreadPool().ParallelFor(bandCount,
+		[=, this, &fn](uint32 band) {
+			fn(getBandStart(band), getBandStart(band + 1), band ? mBandDelayLines[band - 1] : mDelayLine);
+		}
+	);
+
+	// leave the delay line as sequential artifacting would have
+	mDelayLine = mBandDelayLines[bandCount - 2];
+}
+
+VDThreadPool& ATArtifactingEngine::GetThreadPool() {
+	if (!mpThreadPool) {
+		const uint32 threadCount = std::min<uint32>(VDGetLogicalProcessorCount(), kMaxBands);
+
+		mpThreadPool = new VDThreadPool;
+
+		if (threadCount > 1)
+			mpThreadPool->Start(threadCount - 1, "Artifacting");
+	}
+
+	return *mpThreadPool;
+}
+
+void ATArtifactingEngine::PrimeDelayLine8(uint32 y, const uint8 src[N], bool scanlineHasHiRes, DelayLine& delayLine) {
+	if (!mbPAL || !mbChromaArtifacts)
+		return;
+
+	if (mbChromaArtifactsHi) {
+		alignas(16) uint32 tmp[N*2];
+
+		ArtifactPALHi(tmp, src, scanlineHasHiRes, (y & 1) != 0, delayLine);
+	} else
+		memcpy(delayLine.mPAL8, src, sizeof delayLine.mPAL8);
+}
+
+void ATArtifactingEngine::PrimeDelayLine32(const uint32 *src, uint32 width, DelayLine& delayLine) {
+	if (!mbPAL || !mbChromaArtifacts)
+		return;
+
+	VDASSERT(width <= N*2);
+
+	alignas(16) uint32 tmp[N*2];
+	memcpy(tmp, src, width * sizeof(uint32));
+
+	ArtifactPAL32(tmp, width, delayLine);
+}
+
+void ATArtifactingEngine::ResetDelayLine(DelayLine& delayLine) {
+	if (mbPAL && mbChromaArtifacts) {
+		if (mbChromaArtifactsHi) {
+#if defined(VD_CPU_AMD64)
+			memset(delayLine.mPALUV, 0, sizeof delayLine.mPALUV);
+#else
+#if defined(VD_CPU_X86)
+			if (SSE2_enabled) {
+				memset(delayLine.mPALUV, 0, sizeof delayLine.mPALUV);
+			} else
+#endif
+			{
+				VDMemset32(delayLine.mPALUV, 0x20002000, sizeof(delayLine.mPALUV) / sizeof(delayLine.mPALUV[0][0]));
+			}
+#endif
+		} else {
+			memset(delayLine.mPAL32, 0, sizeof delayLine.mPAL32);
+		}
+	}
+}
+
+void ATArtifactingEngine::ArtifactPAL8(uint32 dst[N], const uint8 src[N], DelayLine& delayLine) {
 	const uint32 *VDRESTRICT palette = mbBypassOutputCorrection ? mPalette : mbExpandedRangeOutput ? mCorrectedSignedPalette : mCorrectedPalette;
 
 	for(int i=0; i<N; ++i) {
-		uint8 prev = mPALDelayLine[i];
+		uint8 prev = delayLine.mPAL8[i];
 		uint8 next = src[i];
 		uint32 prevColor = palette[(prev & 0xf0) + (next & 0x0f)];
 		uint32 nextColor = palette[next];
@@ -804,20 +884,20 @@ void ATArtifactingEngine::ArtifactPAL8(uint32 dst[N], const uint8 src[N]) {
 		dst[i] = (prevColor | nextColor) - (((prevColor ^ nextColor) & 0xfefefe) >> 1);
 	}
 
-	memcpy(mPALDelayLine, src, sizeof mPALDelayLine);
+	memcpy(delayLine.mPAL8, src, sizeof delayLine.mPAL8);
 }
 
-void ATArtifactingEngine::ArtifactPAL32(uint32 *dst, uint32 width) {
+void ATArtifactingEngine::ArtifactPAL32(uint32 *dst, uint32 width, DelayLine& delayLine) {
 	bool compressOutput = mbExpandedRangeInput && !mbExpandedRangeOutput;
 
 #if defined(VD_CPU_X86) || defined(VD_CPU_X64)
 	if (SSE2_enabled) {
-		ATArtifactPAL32_SSE2(dst, mPALDelayLine32, width, compressOutput);
+		ATArtifactPAL32_SSE2(dst, delayLine.mPAL32, width, compressOutput);
 		return;
 	}
 #endif
 
-	ATArtifactPAL32(dst, mPALDelayLine32, width, compressOutput);
+	ATArtifactPAL32(dst, delayLine.mPAL32, width, compressOutput);
 }
 
 void ATArtifactingEngine::ArtifactCompressRange(uint32 *dst, uint32 width) {
@@ -1324,14 +1404,14 @@ void ATArtifactingEngine::ArtifactNTSCHi(uint32 dst[N*2], const uint8 src[N], bo
 	}
 }
 
-void ATArtifactingEngine::ArtifactPALHi(uint32 dst[N*2], const uint8 src0[N], bool scanlineHasHiRes, bool oddLine) {
+void ATArtifactingEngine::ArtifactPALHi(uint32 dst[N*2], const uint8 src0[N], bool scanlineHasHiRes, bool oddLine, DelayLine& delayLine) {
 	// encode to YUV
 	VDALIGN(16) uint32 ybuf[32 + N];
 	VDALIGN(16) uint32 ubuf[32 + N];
 	VDALIGN(16) uint32 vbuf[32 + N];
 
-	uint32 *const ulbuf = mPALDelayLineUV[0];
-	uint32 *const vlbuf = mPALDelayLineUV[1];
+	uint32 *const ulbuf = delayLine.mPALUV[0];
+	uint32 *const vlbuf = delayLine.mPALUV[1];
 
 	// Shift the source data by 2 hires pixels to center the kernels; this is
 	// needed since we can only grossly align the YUV arrays by 128-bit amounts
@@ -17,6 +17,7 @@
 
 #include <stdafx.h>
 #include <at/atcore/fft.h>
+#include <at/ataudio/audiofilters.h>
 #include "audiosampleplayer.h"
 #include "oshelper.h"
 #include "resource.h"
@@ -690,21 +691,12 @@ void ATAudioSamplePlayer::WriteAudio(const ATSyncAudioMixInfo& mixInfo) {
 
 				len -= blockLen;
 
-				// mix this block (must count up for MSVC to vectorize....)
-				if (dstR2) {
-					// mono-to-stereo (expected for edge mixing)
-					for(uint32 i=0; i<blockLen; ++i) {
-						const float sample = (float)*src++ * vol;
-						*dstL2++ += sample;
-						*dstR2++ += sample;
-					}
-				} else {
-					// mono (expected for normal mixing)
-					for(uint32 i=0; i<blockLen; ++i) {
-						const float sample = (float)*src++ * vol;
-						*dstL2++ += sample;
-					}
-				}
+				// mix this block -- mono normally, mono-to-stereo for edge mixing
+				ATFilterMixScaledMono16(dstL2, dstR2, src, blockLen, vol);
+				dstL2 += blockLen;
+
+				if (dstR2)
+					dstR2 += blockLen;
 
 				src = s->mpSample;
 				srcOffset = 0;
@@ -19,6 +19,7 @@
 #include <vd2/system/binary.h>
 #include <vd2/system/filesys.h>
 #include <vd2/system/hash.h>
+#include <vd2/system/vdstl_hashmap.h>
 #include <at/atcore/logging.h>
 #include <at/atcore/propertyset.h>
 #include "blockdevvirtfat32.h"
@@ -110,12 +111,34 @@ uint32 ATBlockDeviceVFAT32::GetSerialNumber() const {
 void ATBlockDeviceVFAT32::Init() {
 	mGeometry.mbSolidState = true;
 
-	BuildDirectory();
+	mFiles.clear();
+	mExtents.clear();
+	mSectorCount = 0;
+
+	// Start watching the folder so that rescans can be skipped when nothing
+	// has changed. This must happen before the initial scan so that changes
+	// made during the scan aren't missed. The watcher is only an
+	// optimization, so failure is not fatal; without it, every rescan is a
+	// full one.
+	mbDirWatcherActive = false;
+
+	if (!mPath.empty()) {
+		try {
+			mDirWatcher.Init(mPath.c_str(), false);
+			mbDirWatcherActive = true;
+		} catch(const MyError&) {
+		}
+	}
+
+	UpdateDirectory(false);
 	AutoSizeVolume();
 	FormatVolume();
 }
 
 void ATBlockDeviceVFAT32::Shutdown() {
+	mDirWatcher.Shutdown();
+	mbDirWatcherActive = false;
+
 	mFile.closeNT();
 	mActiveFileIndex = -1;
 }
@@ -178,42 +201,28 @@ void ATBlockDeviceVFAT32::ReadSectors(void *data, uint32 lba, uint32 n) {
 			// determine starting cluster managed by this FAT
 			uint32 mappedClusterStart = mbUseFAT16 ? offset << 8 : offset << 7;
 
-			// find the nearest extent
-			auto itEnd = mDataClusterBoundaries.end();
-			auto it = std::lower_bound(mDataClusterBoundaries.begin(), itEnd, mappedClusterStart + 1);
-			uint32 nextTerminator = it == mDataClusterBoundaries.end() ? ~(uint32)0 : *it - 1;
-			uint32 limit = mDataClusterBoundaries.back();
-
-			if (mbUseFAT16) {
-				for(uint32 i = 0; i < 256; ++i) {
-					uint16 link;
-
-					if (mappedClusterStart + i >= limit) {
-						link = 0;
-					} else if (mappedClusterStart + i == nextTerminator) {
-						link = 0xFFFF;
-						nextTerminator = *++it - 1;
-					} else {
-						link = mappedClusterStart + i + 1;
-					}
+			// find the first extent that ends after the start of this FAT sector
+			auto itEnd = mExtents.end();
+			auto it = std::partition_point(mExtents.begin(), itEnd,
+				[=](const ClusterExtent& ext) { return ext.mEnd <= mappedClusterStart; });
 
-					VDWriteUnalignedLEU16((char *)sector + 2 * i, link);
-				}
-			} else {
-				for(uint32 i = 0; i < 128; ++i) {
-					uint32 link;
-
-					if (mappedClusterStart + i >= limit) {
-						link = 0;
-					} else if (mappedClusterStart + i == nextTerminator) {
-						link = 0x0FFFFFFF;
-						nextTerminator = *++it - 1;
-					} else {
-						link = mappedClusterStart + i + 1;
-					}
+			const uint32 linksPerSector = mbUseFAT16 ? 256 : 128;
+			const uint32 terminator = mbUseFAT16 ? 0xFFFF : 0x0FFFFFFF;
 
+			for(uint32 i = 0; i < linksPerSector; ++i) {
+				const uint32 cluster = mappedClusterStart + i;
+				uint32 link = 0;
+
+				if (it != itEnd && it->mEnd <= cluster)
+					++it;
+
+				if (it != itEnd && it->mStart <= cluster)
+					link = (cluster + 1 == it->mEnd) ? terminator : cluster + 1;
+
+				if (mbUseFAT16)
+					VDWriteUnalignedLEU16((char *)sector + 2 * i, (uint16)link);
+				else
 					VDWriteUnalignedLEU32((char *)sector + 4 * i, link);
-				}
 			}
 
 			// if this is the first FAT sector, write the media type and clean
@@ -235,14 +244,7 @@ void ATBlockDeviceVFAT32::ReadSectors(void *data, uint32 lba, uint32 n) {
 		// check for root directory (FAT16 only)
 		if (mbUseFAT16) {
 			if (offset < 32) {
-				uint32 copyOffset = offset << 9;
-				uint32 copyMax = (uint32)mRootDirectory.size();
-				uint32 copyLen = copyOffset < copyMax ? std::min<uint32>(512, copyMax - copyOffset) : 0;
-
-				if (copyLen)
-					memcpy(sector, mRootDirectory.data() + copyOffset, copyLen);
-
-				memset((char *)sector + copyLen, 0, 512 - copyLen);
+				ReadDirectorySector(offset, sector);
 				continue;
 			}
 
@@ -250,15 +252,16 @@ void ATBlockDeviceVFAT32::ReadSectors(void *data, uint32 lba, uint32 n) {
 		}
 
 		// check if it is a data cluster
-		const auto it = std::upper_bound(mDataClusterBoundaries.begin(), mDataClusterBoundaries.end(), (offset >> 3) + 2);
-		const uint32 fileIndex = (uint32)(it - mDataClusterBoundaries.begin());
-		const uint32 fileCount = (uint32)mFiles.size();
+		const uint32 cluster = (offset >> 3) + 2;
+		const auto it = std::partition_point(mExtents.begin(), mExtents.end(),
+			[=](const ClusterExtent& ext) { return ext.mEnd <= cluster; });
 
-		if (fileIndex < (mbUseFAT16 ? fileCount : fileCount + 1)) {
-			if (fileIndex)
-				offset -= (mDataClusterBoundaries[fileIndex - 1] - 2)*8;
+		if (it != mExtents.end() && it->mStart <= cluster) {
+			const uint32 fileIndex = it->mFileIndex;
 
-			if (fileIndex < fileCount) {
+			offset -= (it->mStart - 2)*8;
+
+			if (fileIndex != kRootDirFileIndex) {
 				memset(sector, 0, 512);
 
 				try {
@@ -287,15 +290,8 @@ void ATBlockDeviceVFAT32::ReadSectors(void *data, uint32 lba, uint32 n) {
 				} catch(const MyError&) {
 				}
 			} else {
-				// root directory, copy the sector
-				uint32 copyOffset = offset << 9;
-				uint32 copyMax = (uint32)mRootDirectory.size();
-				uint32 copyLen = copyOffset < copyMax ? std::min<uint32>(512, copyMax - copyOffset) : 0;
-
-				if (copyLen)
-					memcpy(sector, mRootDirectory.data() + copyOffset, copyLen);
-
-				memset((char *)sector + copyLen, 0, 512 - copyLen);
+				// root directory
+				ReadDirectorySector(offset, sector);
 			}
 			continue;
 		}
@@ -310,25 +306,22 @@ void ATBlockDeviceVFAT32::WriteSectors(const void *data, uint32 lba, uint32 n) {
 }
 
 void ATBlockDeviceVFAT32::RescanDynamicDisk() {
-	vdrefptr tempDisk(new ATBlockDeviceVFAT32(mbUseFAT16));
+	// If the watcher hasn't seen anything, the current view is still valid.
+	if (mbDirWatcherActive && !mDirWatcher.CheckForChanges())
+		return;
 
-	tempDisk->mPath = mPath;
-	tempDisk->Init();
-
-	// close the current file
+	// close the current file, as file indices may shift
 	mFile.closeNT();
 	mActiveFileIndex = -1;
 	mActiveFilePos = -1;
 
-	mSectorCount = tempDisk->mSectorCount;
-	mSectorsPerFAT = tempDisk->mSectorsPerFAT;
-	mGeometry = tempDisk->mGeometry;
-
-	mFiles = std::move(tempDisk->mFiles);
-	mRootDirectory = std::move(tempDisk->mRootDirectory);
-	mDataClusterBoundaries = std::move(tempDisk->mDataClusterBoundaries);
+	// Try to keep existing files where they are; if that fragments a FAT16
+	// volume past its cluster limit, fall back to a fresh layout.
+	if (!UpdateDirectory(true))
+		UpdateDirectory(false);
 
-	VDBitAssign(mBootSectors, tempDisk->mBootSectors);
+	AutoSizeVolume();
+	FormatVolume();
 }
 
 void ATBlockDeviceVFAT32::FormatVolume() {
@@ -494,7 +487,7 @@ void ATBlockDeviceVFAT32::FormatVolume() {
 		VDWriteUnalignedLEU32(&mBootSectors[36], clustersPerFAT*8);
 
 		// set root directory cluster
-		VDWriteUnalignedLEU32(&mBootSectors[44], mDataClusterBoundaries.size() > 1 ? mDataClusterBoundaries.end()[-2] : 2);
+		VDWriteUnalignedLEU32(&mBootSectors[44], mRootDirCluster);
 	}
 
 	// set volume serial number
@@ -536,7 +529,7 @@ void ATBlockDeviceVFAT32::FormatVolume() {
 
 
 		// set free cluster count
-		VDWriteUnalignedLEU32(&mBootSectors[512 + 488], dataClusters - mDataClusterBoundaries.back());
+		VDWriteUnalignedLEU32(&mBootSectors[512 + 488], dataClusters - mAllocatedClusters);
 	}
 
 	const uint32 storageOffset = hiddenSectors + reservedSectors;
@@ -550,316 +543,513 @@ void ATBlockDeviceVFAT32::FormatVolume() {
 		g_ATLCVDisk("FAT32 layout: FAT 1 at %08X, FAT 2 at %08X, root directory at %08X-%08X\n"
 			, storageOffset
 			, storageOffset + mSectorsPerFAT
-			, storageOffset + mSectorsPerFAT*2 + 8 * (mDataClusterBoundaries.size() < 2 ? 0 : mDataClusterBoundaries.end()[-2] - 2)
-			, storageOffset + mSectorsPerFAT*2 + 8 * (mDataClusterBoundaries.back() - 2) - 1);
+			, storageOffset + mSectorsPerFAT*2 + 8 * (mRootDirCluster - 2)
+			, storageOffset + mSectorsPerFAT*2 + 8 * (mRootDirCluster + mRootDirClusterCount - 2) - 1);
 	}
 }
 
-void ATBlockDeviceVFAT32::BuildDirectory() {
-	mRootDirectory.clear();
-	mDataClusterBoundaries.clear();
-	mFiles.clear();
-
-	// create volume label
-	static constexpr uint8 kVolumeLabel[32] {
-		(uint8)'N',
-		(uint8)'O',
-		(uint8)' ',
-		(uint8)'N',
-		(uint8)'A',
-		(uint8)'M',
-		(uint8)'E',
-		(uint8)' ',
-		(uint8)' ',
-		(uint8)' ',
-		(uint8)' ',
-		0x08,
+bool ATBlockDeviceVFAT32::UpdateDirectory(bool preserveLayout) {
+	struct ShortName {
+		uint8 c[11];
 	};
 
-	mRootDirectory.resize(32);
-	memcpy(mRootDirectory.data(), kVolumeLabel, 32);
+	struct ShortNameHashPred {
+		size_t operator()(const ShortName& name) const {
+			size_t hash = 0;
 
-	uint32 nextCluster = 2;
-	if (!mPath.empty()) {
-		struct ShortName {
-			uint8 c[11];
-		};
+			for(int i=0; i<11; ++i)
+				hash = (hash * 31) + name.c[i];
+
+			return hash;
+		}
+
+		bool operator()(const ShortName& x, const ShortName& y) const {
+			return !memcmp(x.c, y.c, 11);
+		}
+	};
 
-		struct ShortNameHashPred {
-			size_t operator()(const ShortName& name) const {
-				size_t hash = 0;
+	std::unordered_set<ShortName, ShortNameHashPred, ShortNameHashPred> shortNames;
 
-				for(int i=0; i<11; ++i)
-					hash = (hash * 31) + name.c[i];
+	// Index the current file list by host name so that unchanged files can
+	// keep their short names and clusters.
+	vdhashmap<VDStringW, uint32, vdstringhashi, vdstringpredi> oldFileLookup;
 
-				return hash;
-			}
+	if (preserveLayout) {
+		uint32 index = 0;
 
-			bool operator()(const ShortName& x, const ShortName& y) const {
-				return !memcmp(x.c, y.c, 11);
-			}
-		};
+		for(const FileEntry& fe : mFiles)
+			oldFileLookup.insert(fe.mFileName).first->second = index++;
+	}
 
-		std::unordered_set<ShortName, ShortNameHashPred, ShortNameHashPred> shortNames;
+	vdvector<FileEntry> newFiles;
+	vdfastvector<bool> keptNames;
 
-		for(VDDirectoryIterator it(VDMakePath(mPath.c_str(), L"*.*").c_str()); it.Next() && mFiles.size() < 1000000; ) {
+	if (!mPath.empty()) {
+		for(VDDirectoryIterator it(VDMakePath(mPath.c_str(), L"*.*").c_str()); it.Next() && newFiles.size() < 1000000; ) {
 			if (it.IsDirectory())
 				continue;
 
 			if (!it.ResolveLinkSize())
 				continue;
 
-			sint32 size64 = it.GetSize();
+			sint64 size64 = it.GetSize();
 
 			if (size64 > 0xFFFFFFFF)
 				continue;
 
-			const uint32 size32 = (uint32)size64;
+			FileEntry& fe = newFiles.emplace_back();
+			fe.mFileName = it.GetName();
+			fe.mFileSize = (uint32)size64;
+			fe.mStartingCluster = 0;
+			fe.mClusterCount = (fe.mFileSize >> 12) + (fe.mFileSize & 0xFFF ? 1 : 0);
+			fe.mCreationDate = it.GetCreationDate();
+			fe.mLastWriteDate = it.GetLastWriteDate();
 
-			// compute the number of clusters needed for this file
-			const uint32 numClusters = (size32 >> 12) + (size32 & 0xFFF ? 1 : 0);
+			bool kept = false;
+			if (preserveLayout) {
+				auto itOld = oldFileLookup.find(fe.mFileName);
 
-			// if this is a FAT16 volume and we are out of space, end population; we
-			// stop a bit short of the theoretical max limit per general recommendations
-			// to avoid variance in FAT16 implementations
-			if (mbUseFAT16 && 65500 - nextCluster < numClusters)
-				break;
+				if (itOld != oldFileLookup.end()) {
+					const FileEntry& oldEntry = mFiles[itOld->second];
 
-			mFiles.emplace_back();
-			FileEntry& fe = mFiles.back();
-			fe.mFileName = it.GetName();
-			fe.mFileSize = size32;
-			fe.mStartingCluster = size32 ? nextCluster : 0;
-			fe.mbLFNRequired = false;
+					memcpy(fe.mShortName, oldEntry.mShortName, 11);
+					fe.mbLFNRequired = oldEntry.mbLFNRequired;
 
-			// convert filename to UTF-16
-			int nameLen = 0;
-			int extLen = 0;
-			bool inName = true;
-			bool inExt = false;
+					// The file can stay in place if it still fits in its old
+					// clusters; any clusters it no longer needs become free.
+					if (fe.mClusterCount && fe.mClusterCount <= oldEntry.mClusterCount)
+						fe.mStartingCluster = oldEntry.mStartingCluster;
 
-			memset(fe.mShortName, 0x20, sizeof fe.mShortName);
+					kept = true;
+				}
+			}
 
-			for(const wchar_t c : fe.mFileName) {
-				uint32 c32 = (uint32)c;
+			if (!kept)
+				ComputeShortName(fe);
 
-				if constexpr(sizeof(wchar_t) > 2) {
-					if (c32 >= 0x10000) {
-						c32 -= 0x10000;
+			keptNames.push_back(kept);
+		}
+	}
 
-						fe.mLongName.push_back((uint16)(0xD800 + (c32 >> 10)));
+	// Retained short names have priority, followed by new short names that
+	// don't need mangling; a conflicting unmangled name means the file has to
+	// be dropped.
+	const uint32 numCandidates = (uint32)newFiles.size();
 
-						c32 = 0xDC00 + (c32 & 0x3FF);
-					}
-				}
+	for(uint32 i = 0; i < numCandidates; ++i) {
+		if (keptNames[i]) {
+			ShortName shortName;
+			memcpy(shortName.c, newFiles[i].mShortName, 11);
+			shortNames.insert(shortName);
+		}
+	}
 
-				fe.mLongName.push_back((uint16)c32);
-
-				uint8 cleanChar = (uint8)'_';
-
-				switch(c) {
-					case L'$':
-					case L'%':
-					case L'\'':
-					case L'-':
-					case L'_':
-					case L'@':
-					case L'~':
-					case L'`':
-					case L'!':
-					case L'(':
-					case L')':
-					case L'{':
-					case L'}':
-					case L'^':
-					case L'#':
-					case L'&':
-					case L'.':		// not used in short encoding, but we need to pass it through
-						cleanChar = (uint8)c;
-						break;
-
-					default:
-						if ((c >= L'0' && c <= L'9') || (c >= L'A' && c <= L'Z'))
-							cleanChar = (uint8)c;
-						else {
-							if (c >= L'a' && c <= L'z')
-								cleanChar = (uint8)(c - L'a' + L'A');
-
-							fe.mbLFNRequired = true;
-						}
-						break;
-				}
+	vdfastvector<bool> dropped(numCandidates, false);
 
-				if (inName) {
-					if (c == '.') {
-						if (nameLen == 0) {
-							fe.mShortName[nameLen++] = (uint8)'_';
-							fe.mbLFNRequired = true;
-						}
+	for(uint32 i = 0; i < numCandidates; ++i) {
+		const FileEntry& fe = newFiles[i];
 
-						inName = false;
-						inExt = true;
-					} else if (nameLen < 8) {
-						fe.mShortName[nameLen++] = cleanChar;
-					} else {
-						fe.mbLFNRequired = true;
-					}
-				} else if (inExt) {
-					if (c == '.') {
-						inExt = false;
-					} else if (extLen < 3) {
-						fe.mShortName[8 + extLen++] = cleanChar;
-					} else {
-						fe.mbLFNRequired = true;
-					}
-				}
-			}
+		if (!keptNames[i] && !fe.mbLFNRequired) {
+			ShortName shortName;
+			memcpy(shortName.c, fe.mShortName, 11);
 
-			// if a long name is not required, then push it into the hash set
-			// first -- these short names have priority before we make the mangled
-			// names
-			if (!fe.mbLFNRequired) {
-				ShortName shortName;
-				memcpy(shortName.c, fe.mShortName, 11);
-				if (!shortNames.insert(shortName).second) { 
-					// hmm, we have a conflicting short name -- we're going to
-					// have to drop this entry
-					mFiles.pop_back();
-					continue;
-				}
-			}
+			if (!shortNames.insert(shortName).second)
+				dropped[i] = true;
+		}
+	}
 
-			nextCluster += numClusters;
-			mDataClusterBoundaries.push_back(nextCluster);
+	// Assign directory slots. Slot 0 is the volume label. The FAT16 root
+	// directory is fixed at 512 entries, so anything past that is dropped.
+	uint32 nextDirSlot = 1;
 
-			fe.mCreationDate = it.GetCreationDate();
-			fe.mLastWriteDate = it.GetLastWriteDate();
+	for(uint32 i = 0; i < numCandidates; ++i) {
+		if (dropped[i])
+			continue;
+
+		FileEntry& fe = newFiles[i];
+		fe.mDirSlotCount = ComputeDirSlotCount(fe);
+
+		if (mbUseFAT16 && 512 - nextDirSlot < fe.mDirSlotCount) {
+			dropped[i] = true;
+			continue;
 		}
 
-		// allocate short names for all entries that require long names
-		for(FileEntry& fe : mFiles) {
-			if (!fe.mbLFNRequired)
-				continue;
+		fe.mDirSlot = nextDirSlot;
+		nextDirSlot += fe.mDirSlotCount;
+	}
 
-			fe.mShortName[6] = (uint8)'~';
-			fe.mShortName[7] = (uint8)'1';
-			
-			for(;;) {
-				ShortName shortName;
-				memcpy(shortName.c, fe.mShortName, 11);
+	// Work out the root directory placement for FAT32. It can stay put if it
+	// hasn't outgrown its clusters.
+	uint32 rootDirCluster = 0;
+	uint32 rootDirClusterCount = 0;
 
-				if (shortNames.insert(shortName).second)
-					break;
+	if (!mbUseFAT16) {
+		rootDirClusterCount = (nextDirSlot * 32 + 4095) >> 12;
 
-				for(int i=7; i>0; --i) {
-					uint8& c = fe.mShortName[i];
-
-					if (c == (uint8)'~') {
-						fe.mShortName[i-1] = (uint8)'~';
-						c = (uint8)'1';
-						break;
-					} else if (c == (uint8)'9') {
-						c = (uint8)'0';
-					} else {
-						++c;
-						break;
-					}
+		if (preserveLayout && mRootDirCluster && rootDirClusterCount <= mRootDirClusterCount) {
+			rootDirCluster = mRootDirCluster;
+			rootDirClusterCount = mRootDirClusterCount;
+		}
+	}
+
+	// Find the end of the retained allocations; everything new goes after.
+	uint32 nextCluster = 2;
+
+	for(uint32 i = 0; i < numCandidates; ++i) {
+		const FileEntry& fe = newFiles[i];
+
+		if (!dropped[i] && fe.mStartingCluster)
+			nextCluster = std::max(nextCluster, fe.mStartingCluster + fe.mClusterCount);
+	}
+
+	if (rootDirCluster)
+		nextCluster = std::max(nextCluster, rootDirCluster + rootDirClusterCount);
+
+	// Allocate clusters for new and grown files. For FAT16, we stop a bit short
+	// of the theoretical max limit per general recommendations to avoid variance
+	// in FAT16 implementations.
+	for(uint32 i = 0; i < numCandidates; ++i) {
+		FileEntry& fe = newFiles[i];
+
+		if (dropped[i] || fe.mStartingCluster || !fe.mClusterCount)
+			continue;
+
+		if (mbUseFAT16 && 65500 - nextCluster < fe.mClusterCount) {
+			if (preserveLayout)
+				return false;
+
+			dropped[i] = true;
+			continue;
+		}
+
+		fe.mStartingCluster = nextCluster;
+		nextCluster += fe.mClusterCount;
+	}
+
+	if (!mbUseFAT16 && !rootDirCluster) {
+		rootDirCluster = nextCluster;
+		nextCluster += rootDirClusterCount;
+	}
+
+	// allocate short names for all new entries that require long names
+	for(uint32 i = 0; i < numCandidates; ++i) {
+		FileEntry& fe = newFiles[i];
+
+		if (dropped[i] || keptNames[i] || !fe.mbLFNRequired)
+			continue;
+
+		fe.mShortName[6] = (uint8)'~';
+		fe.mShortName[7] = (uint8)'1';
+		
+		for(;;) {
+			ShortName shortName;
+			memcpy(shortName.c, fe.mShortName, 11);
+
+			if (shortNames.insert(shortName).second)
+				break;
+
+			for(int j=7; j>0; --j) {
+				uint8& c = fe.mShortName[j];
+
+				if (c == (uint8)'~') {
+					fe.mShortName[j-1] = (uint8)'~';
+					c = (uint8)'1';
+					break;
+				} else if (c == (uint8)'9') {
+					c = (uint8)'0';
+				} else {
+					++c;
+					break;
 				}
 			}
 		}
+	}
 
-		// create root directory from all files
-		for(FileEntry& fe : mFiles) {
-			uint8 baseDirEnt[32] {};
-			memcpy(baseDirEnt, fe.mShortName, 11);
+	// Dropping files after slot assignment leaves holes in the directory;
+	// compact the list and reassign slots. This can only shrink the
+	// directory.
+	vdvector<FileEntry> files;
+	files.reserve(numCandidates);
+	nextDirSlot = 1;
 
-			const VDExpandedDate modLocalDate = VDGetLocalDate(fe.mLastWriteDate);
-			const VDExpandedDate creationLocalDate = VDGetLocalDate(fe.mCreationDate);
+	for(uint32 i = 0; i < numCandidates; ++i) {
+		if (dropped[i])
+			continue;
 
-			// set creation date
-			baseDirEnt[13] = (creationLocalDate.mMilliseconds / 10) + (creationLocalDate.mSecond & 1 ? 100 : 0);
-			VDWriteUnalignedLEU16(&baseDirEnt[14], (creationLocalDate.mSecond >> 1) + (creationLocalDate.mMinute << 5) + (creationLocalDate.mHour << 11));
-			VDWriteUnalignedLEU16(&baseDirEnt[16], creationLocalDate.mDay + (creationLocalDate.mMonth << 5) + ((std::clamp<uint32>(creationLocalDate.mYear, 1980, 1980 + 127) - 1980) << 9));
+		FileEntry& fe = files.emplace_back(std::move(newFiles[i]));
+		fe.mDirSlot = nextDirSlot;
+		nextDirSlot += fe.mDirSlotCount;
+	}
+
+	// build the sorted extent list
+	vdfastvector<ClusterExtent> extents;
+	uint32 allocatedClusters = 0;
+	uint32 fileIndex = 0;
 
-			// set modification date
-			VDWriteUnalignedLEU16(&baseDirEnt[22], (modLocalDate.mSecond >> 1) + (modLocalDate.mMinute << 5) + (modLocalDate.mHour << 11));
-			VDWriteUnalignedLEU16(&baseDirEnt[24], modLocalDate.mDay + (modLocalDate.mMonth << 5) + ((std::clamp<uint32>(modLocalDate.mYear, 1980, 1980 + 127) - 1980) << 9));
+	for(const FileEntry& fe : files) {
+		if (fe.mStartingCluster) {
+			extents.push_back({ fe.mStartingCluster, fe.mStartingCluster + fe.mClusterCount, fileIndex });
+			allocatedClusters += fe.mClusterCount;
+		}
+
+		++fileIndex;
+	}
 
-			// set accessed date (to mod date)
-			baseDirEnt[18] = baseDirEnt[24];
-			baseDirEnt[19] = baseDirEnt[25];
+	if (rootDirCluster) {
+		extents.push_back({ rootDirCluster, rootDirCluster + rootDirClusterCount, kRootDirFileIndex });
+		allocatedClusters += rootDirClusterCount;
+	}
 
-			// set starting cluster
-			VDWriteUnalignedLEU16(&baseDirEnt[20], (uint16)(fe.mStartingCluster >> 16));
-			VDWriteUnalignedLEU16(&baseDirEnt[26], (uint16)fe.mStartingCluster);
+	std::sort(extents.begin(), extents.end(),
+		[](const ClusterExtent& x, const ClusterExtent& y) { return x.mStart < y.mStart; });
 
-			// set file size
-			VDWriteUnalignedLEU32(&baseDirEnt[28], fe.mFileSize);
+	mFiles = std::move(files);
+	mExtents = std::move(extents);
+	mDirSlotCount = nextDirSlot;
+	mRootDirCluster = rootDirCluster;
+	mRootDirClusterCount = rootDirClusterCount;
+	mClusterLimit = nextCluster;
+	mAllocatedClusters = allocatedClusters;
+	return true;
+}
 
-			// check if LFN is required
-			if (fe.mbLFNRequired) {
-				// compute short name checksum
-				uint8 checksum = 0;
-				for(int i=0; i<11; ++i)
-					checksum = (uint8)((checksum >> 1) + (checksum << 7) + baseDirEnt[i]);
+void ATBlockDeviceVFAT32::ComputeShortName(FileEntry& fe) {
+	int nameLen = 0;
+	int extLen = 0;
+	bool inName = true;
+	bool inExt = false;
+
+	memset(fe.mShortName, 0x20, sizeof fe.mShortName);
+	fe.mbLFNRequired = false;
+
+	for(const wchar_t c : fe.mFileName) {
+		uint8 cleanChar = (uint8)'_';
+
+		switch(c) {
+			case L'$':
+			case L'%':
+			case L'\'':
+			case L'-':
+			case L'_':
+			case L'@':
+			case L'~':
+			case L'`':
+			case L'!':
+			case L'(':
+			case L')':
+			case L'{':
+			case L'}':
+			case L'^':
+			case L'#':
+			case L'&':
+			case L'.':		// not used in short encoding, but we need to pass it through
+				cleanChar = (uint8)c;
+				break;
 
-				// compute number of extents required
-				const uint32 numExtents = ((uint32)fe.mLongName.size() + 12) / 13;
+			default:
+				if ((c >= L'0' && c <= L'9') || (c >= L'A' && c <= L'Z'))
+					cleanChar = (uint8)c;
+				else {
+					if (c >= L'a' && c <= L'z')
+						cleanChar = (uint8)(c - L'a' + L'A');
 
-				// null terminate the long filename and pad, only if not already in whole extents
-				if (fe.mLongName.size() % 13) {
-					fe.mLongName.push_back(0);
-					fe.mLongName.resize(numExtents * 13, 0xFFFF);
+					fe.mbLFNRequired = true;
 				}
+				break;
+		}
 
-				// add space for new directory entries
-				mRootDirectory.resize(mRootDirectory.size() + 32 * numExtents);
-
-				// populate extents
-				uint8 *dst = &*(mRootDirectory.end() - 32);
-				const uint16 *src = fe.mLongName.data();
-				for(uint32 i = 0; i < numExtents; ++i) {
-					dst[0] = i + 1 + (i == numExtents - 1 ? 0x40 : 0x00);
-					dst[11] = 0x0F;
-					dst[12] = 0x00;
-					dst[13] = checksum;
-					dst[26] = 0;
-					dst[27] = 0;
-
-					VDWriteUnalignedLEU16(&dst[1], src[0]);
-					VDWriteUnalignedLEU16(&dst[3], src[1]);
-					VDWriteUnalignedLEU16(&dst[5], src[2]);
-					VDWriteUnalignedLEU16(&dst[7], src[3]);
-					VDWriteUnalignedLEU16(&dst[9], src[4]);
-					VDWriteUnalignedLEU16(&dst[14], src[5]);
-					VDWriteUnalignedLEU16(&dst[16], src[6]);
-					VDWriteUnalignedLEU16(&dst[18], src[7]);
-					VDWriteUnalignedLEU16(&dst[20], src[8]);
-					VDWriteUnalignedLEU16(&dst[22], src[9]);
-					VDWriteUnalignedLEU16(&dst[24], src[10]);
-					VDWriteUnalignedLEU16(&dst[28], src[11]);
-					VDWriteUnalignedLEU16(&dst[30], src[12]);
-
-					dst -= 32;
-					src += 13;
+		if (inName) {
+			if (c == '.') {
+				if (nameLen == 0) {
+					fe.mShortName[nameLen++] = (uint8)'_';
+					fe.mbLFNRequired = true;
 				}
+
+				inName = false;
+				inExt = true;
+			} else if (nameLen < 8) {
+				fe.mShortName[nameLen++] = cleanChar;
+			} else {
+				fe.mbLFNRequired = true;
 			}
+		} else if (inExt) {
+			if (c == '.') {
+				inExt = false;
+			} else if (extLen < 3) {
+				fe.mShortName[8 + extLen++] = cleanChar;
+			} else {
+				fe.mbLFNRequired = true;
+			}
+		}
+	}
+}
+
+uint32 ATBlockDeviceVFAT32::ComputeDirSlotCount(const FileEntry& fe) {
+	if (!fe.mbLFNRequired)
+		return 1;
 
-			// write entry to root directory
-			mRootDirectory.insert(mRootDirectory.end(), baseDirEnt, baseDirEnt + 32);
+	// count UTF-16 code units in the long name
+	uint32 len = 0;
+
+	for(const wchar_t c : fe.mFileName) {
+		++len;
+
+		if constexpr(sizeof(wchar_t) > 2) {
+			if ((uint32)c >= 0x10000)
+				++len;
 		}
 	}
 
-	// add root directory entry for FAT32
-	if (!mbUseFAT16) {
-		nextCluster += (mRootDirectory.size() + 4095) >> 12;
-		mDataClusterBoundaries.push_back(nextCluster);
+	return (len + 12) / 13 + 1;
+}
+
+void ATBlockDeviceVFAT32::ReadDirectorySector(uint32 dirSector, uint8 *dst) const {
+	memset(dst, 0, 512);
+
+	const uint32 slotStart = dirSector * 16;
+	const uint32 slotEnd = slotStart + 16;
+
+	if (slotStart >= mDirSlotCount)
+		return;
+
+	// create volume label
+	if (slotStart == 0) {
+		static constexpr uint8 kVolumeLabel[32] {
+			(uint8)'N',
+			(uint8)'O',
+			(uint8)' ',
+			(uint8)'N',
+			(uint8)'A',
+			(uint8)'M',
+			(uint8)'E',
+			(uint8)' ',
+			(uint8)' ',
+			(uint8)' ',
+			(uint8)' ',
+			0x08,
+		};
+
+		memcpy(dst, kVolumeLabel, 32);
+	}
+
+	// find the first file with entries in this sector
+	auto it = std::partition_point(mFiles.begin(), mFiles.end(),
+		[=](const FileEntry& fe) { return fe.mDirSlot + fe.mDirSlotCount <= slotStart; });
+
+	vdfastvector<uint8> entries;
+	for(; it != mFiles.end() && it->mDirSlot < slotEnd; ++it) {
+		const FileEntry& fe = *it;
+
+		entries.resize(fe.mDirSlotCount * 32);
+		GenerateDirEntries(fe, entries.data());
+
+		// clip the entries to this sector, as long entries can straddle
+		const uint32 copyStart = std::max(fe.mDirSlot, slotStart);
+		const uint32 copyEnd = std::min(fe.mDirSlot + fe.mDirSlotCount, slotEnd);
+
+		memcpy(dst + (copyStart - slotStart) * 32, entries.data() + (copyStart - fe.mDirSlot) * 32, (copyEnd - copyStart) * 32);
+	}
+}
+
+void ATBlockDeviceVFAT32::GenerateDirEntries(const FileEntry& fe, uint8 *dst) const {
+	// the short entry goes last, after any long name entries
+	uint8 *baseDirEnt = dst + (fe.mDirSlotCount - 1) * 32;
+	memset(baseDirEnt, 0, 32);
+	memcpy(baseDirEnt, fe.mShortName, 11);
+
+	const VDExpandedDate modLocalDate = VDGetLocalDate(fe.mLastWriteDate);
+	const VDExpandedDate creationLocalDate = VDGetLocalDate(fe.mCreationDate);
+
+	// set creation date
+	baseDirEnt[13] = (creationLocalDate.mMilliseconds / 10) + (creationLocalDate.mSecond & 1 ? 100 : 0);
+	VDWriteUnalignedLEU16(&baseDirEnt[14], (creationLocalDate.mSecond >> 1) + (creationLocalDate.mMinute << 5) + (creationLocalDate.mHour << 11));
+	VDWriteUnalignedLEU16(&baseDirEnt[16], creationLocalDate.mDay + (creationLocalDate.mMonth << 5) + ((std::clamp<uint32>(creationLocalDate.mYear, 1980, 1980 + 127) - 1980) << 9));
+
+	// set modification date
+	VDWriteUnalignedLEU16(&baseDirEnt[22], (modLocalDate.mSecond >> 1) + (modLocalDate.mMinute << 5) + (modLocalDate.mHour << 11));
+	VDWriteUnalignedLEU16(&baseDirEnt[24], modLocalDate.mDay + (modLocalDate.mMonth << 5) + ((std::clamp<uint32>(modLocalDate.mYear, 1980, 1980 + 127) - 1980) << 9));
+
+	// set accessed date (to mod date)
+	baseDirEnt[18] = baseDirEnt[24];
+	baseDirEnt[19] = baseDirEnt[25];
+
+	// set starting cluster
+	VDWriteUnalignedLEU16(&baseDirEnt[20], (uint16)(fe.mStartingCluster >> 16));
+	VDWriteUnalignedLEU16(&baseDirEnt[26], (uint16)fe.mStartingCluster);
+
+	// set file size
+	VDWriteUnalignedLEU32(&baseDirEnt[28], fe.mFileSize);
+
+	if (!fe.mbLFNRequired)
+		return;
+
+	// convert filename to UTF-16
+	vdfastvector<uint16> longName;
+
+	for(const wchar_t c : fe.mFileName) {
+		uint32 c32 = (uint32)c;
+
+		if constexpr(sizeof(wchar_t) > 2) {
+			if (c32 >= 0x10000) {
+				c32 -= 0x10000;
+
+				longName.push_back((uint16)(0xD800 + (c32 >> 10)));
+
+				c32 = 0xDC00 + (c32 & 0x3FF);
+			}
+		}
+
+		longName.push_back((uint16)c32);
+	}
+
+	// compute short name checksum
+	uint8 checksum = 0;
+	for(int i=0; i<11; ++i)
+		checksum = (uint8)((checksum >> 1) + (checksum << 7) + baseDirEnt[i]);
+
+	const uint32 numExtents = fe.mDirSlotCount - 1;
+
+	// null terminate the long filename and pad, only if not already in whole extents
+	if (longName.size() % 13) {
+		longName.push_back(0);
+		longName.resize(numExtents * 13, 0xFFFF);
+	}
+
+	// populate extents in reverse order, ending just before the short entry
+	uint8 *ext = baseDirEnt - 32;
+	const uint16 *src = longName.data();
+	for(uint32 i = 0; i < numExtents; ++i) {
+		memset(ext, 0, 32);
+
+		ext[0] = i + 1 + (i == numExtents - 1 ? 0x40 : 0x00);
+		ext[11] = 0x0F;
+		ext[12] = 0x00;
+		ext[13] = checksum;
+		ext[26] = 0;
+		ext[27] = 0;
+
+		VDWriteUnalignedLEU16(&ext[1], src[0]);
+		VDWriteUnalignedLEU16(&ext[3], src[1]);
+		VDWriteUnalignedLEU16(&ext[5], src[2]);
+		VDWriteUnalignedLEU16(&ext[7], src[3]);
+		VDWriteUnalignedLEU16(&ext[9], src[4]);
+		VDWriteUnalignedLEU16(&ext[14], src[5]);
+		VDWriteUnalignedLEU16(&ext[16], src[6]);
+		VDWriteUnalignedLEU16(&ext[18], src[7]);
+		VDWriteUnalignedLEU16(&ext[20], src[8]);
+		VDWriteUnalignedLEU16(&ext[22], src[9]);
+		VDWriteUnalignedLEU16(&ext[24], src[10]);
+		VDWriteUnalignedLEU16(&ext[28], src[11]);
+		VDWriteUnalignedLEU16(&ext[30], src[12]);
+
+		ext -= 32;
+		src += 13;
 	}
 }
 
 void ATBlockDeviceVFAT32::AutoSizeVolume() {
 	uint32 totalClustersNeeded = 0;
-	uint32 dataClustersNeeded = mDataClusterBoundaries.empty() ? 0 : mDataClusterBoundaries.back() - 2;
+	uint32 dataClustersNeeded = mClusterLimit - 2;
 	uint32 reservedSectorsNeeded = mbEnableMBR ? 8 : 0;
 
 	if (mbUseFAT16) {
@@ -881,5 +1071,7 @@ void ATBlockDeviceVFAT32::AutoSizeVolume() {
 		totalClustersNeeded += fatClustersNeeded*2 + dataClustersNeeded;
 	}
 
-	mSectorCount = totalClustersNeeded * 8 + reservedSectorsNeeded;
+	// Only ever grow the volume on a rescan, so that the FAT and data areas
+	// stay where they are when the new contents still fit.
+	mSectorCount = std::max<uint32>(mSectorCount, totalClustersNeeded * 8 + reservedSectorsNeeded);
 }
@@ -1299,6 +1299,17 @@ sint32 ATDeviceCustom::ReadControl(MemoryLayer& ml, uint32 addr) {
 
 		case AddressAction::Variable:
 			return 0xFF & mVMDomain.mGlobalVariables[binding.mVariableIndex];
+
+		case AddressAction::BankSwitch:
+			if constexpr (T_DebugOnly) {
+				// debug reads must not switch banks, so these still go through
+				// the debug version of the script
+				mVMDomain.mSpecialVariables[(int)SpecialVarIndex::Address] = addr;
+				mVMThread.mThreadVariables[(int)ThreadVarIndex::Timestamp] = ATSCHEDULER_GETTIME(mpScheduler);
+
+				return 0xFF & mVMThread.RunInt(*mScriptFunctions[binding.mBankSwitch.mDebugScriptFunction]);
+			} else
+				return RunBankSwitch(mBankSwitchActions[binding.mBankSwitch.mActionIndex], addr, 0);
 	}
 
 	return -1;
@@ -1329,11 +1340,143 @@ bool ATDeviceCustom::WriteControl(MemoryLayer& ml, uint32 addr, uint8 value) {
 		case AddressAction::Variable:
 			mVMDomain.mGlobalVariables[binding.mVariableIndex] = value;
 			return true;
+
+		case AddressAction::BankSwitch:
+			mVMDomain.mSpecialVariables[(int)SpecialVarIndex::Value] = value;
+
+			RunBankSwitch(mBankSwitchActions[binding.mBankSwitch.mActionIndex], addr, value);
+			return true;
 	}
 
 	return false;
 }
 
+uint8 ATDeviceCustom::RunBankSwitch(const ATVMCallTable& action, uint32 addr, uint8 value) {
+	// keep the special variables consistent with a script call, as other
+	// scripts can still see them; like a script call, only writes set $value
+	mVMDomain.mSpecialVariables[(int)SpecialVarIndex::Address] = addr;
+
+	return (uint8)action.Run(mVMDomain, value);
+}
+
+// Convert script bindings that do nothing but remap memory layers into
+// native bank switching actions. A script qualifies if it is a pure function
+// of $address and $value: straight-line or forward-branching code, no global
+// variable access other than to load memory layer objects, and no calls other
+// than set_offset(), set_modes(), and set_readonly() on memory layers. Such a
+// script is evaluated here for every address and value it can see, and the
+// recorded layer calls replace the VM call at access time. Everything else
+// stays scripted.
+void ATDeviceCustom::LowerScriptBindings() {
+	static constexpr uint32 kMaxCallsPerValue = 8;
+
+	if (mScriptFunctions.empty())
+		return;
+
+	// identify which globals hold memory layer objects
+	vdfastvector<bool> layerGlobals(mVMDomain.mGlobalVariables.size(), false);
+
+	for(const MemoryLayer *ml : mMemoryLayers) {
+		const ATVMTypeInfo *typeInfo = mpCompiler->GetVariable(ml->mpName);
+
+		if (typeInfo && typeInfo->mClass == ATVMTypeClass::ObjectLValue && typeInfo->mIndex < layerGlobals.size())
+			layerGlobals[typeInfo->mIndex] = true;
+	}
+
+	vdfastvector<ATVMExternalVoidMethod> layerMethods;
+	for(const ATVMExternalMethod& method : MemoryLayer::kVMObjectClass.mMethods) {
+		if (!strcmp(method.mpName, "set_offset") || !strcmp(method.mpName, "set_modes") || !strcmp(method.mpName, "set_readonly"))
+			layerMethods.push_back(method.mpVoidMethod);
+	}
+
+	struct ScriptInfo {
+		bool mbAnalyzed = false;
+		bool mbLowerable = false;
+		ATVMCallTable::Analysis mAnalysis;
+	};
+
+	// scripts are analyzed separately for read and write, as reads can't use $value
+	vdvector<ScriptInfo> scriptInfo(mScriptFunctions.size() * 2);
+	vdhashmap<uint64, uint32> actionLookup;
+	uint32 loweredBindings = 0;
+
+	const sint32 savedAddress = mVMDomain.mSpecialVariables[(int)SpecialVarIndex::Address];
+	const sint32 savedValue = mVMDomain.mSpecialVariables[(int)SpecialVarIndex::Value];
+
+	const auto lowerBinding = [&](AddressBinding& binding, uint32 addr, bool read) {
+		const uint32 funcCode = binding.mScriptFunctions[0];
+		const ATVMFunction& func = *mScriptFunctions[funcCode];
+		ScriptInfo& si = scriptInfo[funcCode * 2 + (read ? 1 : 0)];
+
+		if (!si.mbAnalyzed) {
+			si.mbAnalyzed = true;
+
+			uint32 allowedSpecialVars = 1U << (int)SpecialVarIndex::Address;
+			if (!read)
+				allowedSpecialVars |= 1U << (int)SpecialVarIndex::Value;
+
+			si.mbLowerable = ATVMCallTable::Analyze(si.mAnalysis, func, allowedSpecialVars, layerGlobals, layerMethods);
+		}
+
+		if (!si.mbLowerable)
+			return;
+
+		// actions can be shared by all bindings to the same script, unless the
+		// script looks at the address
+		const bool usesAddress = (si.mAnalysis.mSpecialVarsUsed & (1U << (int)SpecialVarIndex::Address)) != 0;
+		const uint64 key = ((uint64)funcCode << 18) + (read ? 0x20000 : 0) + (usesAddress ? addr : 0x10000);
+		uint32 actionIndex;
+
+		auto it = actionLookup.find(key);
+		if (it != actionLookup.end())
+			actionIndex = it->second;
+		else {
+			if (mBankSwitchActions.size() > 0xFFFF)
+				return;
+
+			mVMDomain.mSpecialVariables[(int)SpecialVarIndex::Address] = addr;
+
+			ATVMCallTable action;
+			if (!action.Build(mVMThread, func, si.mAnalysis, (uint32)SpecialVarIndex::Value, 256, kMaxCallsPerValue)) {
+				si.mbLowerable = false;
+				return;
+			}
+
+			actionIndex = (uint32)mBankSwitchActions.size();
+			mBankSwitchActions.emplace_back(std::move(action));
+			actionLookup.insert(key).first->second = actionIndex;
+		}
+
+		const uint16 debugFuncCode = binding.mScriptFunctions[1];
+
+		binding.mAction = AddressAction::BankSwitch;
+		binding.mBankSwitch.mActionIndex = (uint16)actionIndex;
+		binding.mBankSwitch.mDebugScriptFunction = debugFuncCode;
+		++loweredBindings;
+	};
+
+	for(MemoryLayer *ml : mMemoryLayers) {
+		if (!ml->mpReadBindings)
+			continue;
+
+		for(uint32 i = 0; i < ml->mSize; ++i) {
+			AddressBinding& rb = ml->mpReadBindings[i];
+			if (rb.mAction == AddressAction::Script)
+				lowerBinding(rb, ml->mAddressBase + i, true);
+
+			AddressBinding& wb = ml->mpWriteBindings[i];
+			if (wb.mAction == AddressAction::Script)
+				lowerBinding(wb, ml->mAddressBase + i, false);
+		}
+	}
+
+	mVMDomain.mSpecialVariables[(int)SpecialVarIndex::Address] = savedAddress;
+	mVMDomain.mSpecialVariables[(int)SpecialVarIndex::Value] = savedValue;
+
+	if (loweredBindings)
+		g_ATLCCustomDev("Converted %u script address bindings to native bank switching.\n", loweredBindings);
+}
+
 bool ATDeviceCustom::PostNetCommand(uint32 address, sint32 value, NetworkCommand cmd) {
 	if (!mpNetworkEngine)
 		return false;
@@ -1768,6 +1911,7 @@ void ATDeviceCustom::ShutdownCustomDevice() {
 
 	mMemoryLayers = {};
 	mSegments = {};
+	mBankSwitchActions.clear();
 	mpSIODeviceTable = nullptr;
 
 	mpScriptEventColdReset = nullptr;
@@ -2293,6 +2437,8 @@ void ATDeviceCustom::ProcessDesc(const void *buf, size_t len) {
 	mVMThreadSIO.Init(mVMDomain);
 	mVMThreadScriptInterrupt.Init(mVMDomain);
 
+	LowerScriptBindings();
+
 	if (!mpSIODeviceTable && compiler.IsSpecialVariableReferenced("sio"))
 		mpSIODeviceTable = mConfigAllocator.Allocate<SIODeviceTable>();
 }
@@ -23,6 +23,7 @@
 #include <vd2/system/error.h>
 #include <vd2/system/math.h>
 #include <vd2/system/strutil.h>
+#include <vd2/system/time.h>
 #include <vd2/system/unknown.h>
 #include <vd2/system/vdstl_hashset.h>
 #include <vd2/system/vdstl_hashmap.h>
@@ -78,6 +79,7 @@
 #include "fdc.h"
 #include "versioninfo.h"
 #include "hlefpaccelerator.h"
+#include "saprender.h"
 #include <at/atemulation/riot.h>
 #include <at/atemulation/ctc.h>
 
@@ -991,7 +993,18 @@ bool ATDebugger::Tick() {
 		IATDebuggerActiveCommand *acmd = mActiveCommands.back();
 
 		if (acmd->IsBusy()) {
-			if (!acmd->ProcessSubCommand(NULL)) {
+			bool continueCommand;
+
+			try {
+				continueCommand = acmd->ProcessSubCommand(NULL);
+			} catch(const MyError& e) {
+				// The command is expected to have broken into the debugger,
+				// which terminates it.
+				ATConsolePrintf("%s\n", e.gets());
+				return true;
+			}
+
+			if (!continueCommand) {
 				acmd->EndCommand();
 				acmd->Release();
 				mActiveCommands.pop_back();
@@ -12563,6 +12576,34 @@ stop:
 	ATConsolePrintf("%u symbols added.\n", found);
 }
 
+void ATConsoleCmdHDCache(ATDebuggerCmdParser& parser) {
+	parser >> 0;
+
+	bool found = false;
+	for(IATDevice *dev : g_sim.GetDeviceManager()->GetDevices(false, false, false)) {
+		auto *cache = vdpoly_cast<IATBlockDeviceCacheStats *>(dev);
+		if (!cache)
+			continue;
+
+		const ATBlockDeviceCacheStats stats = cache->GetCacheStats();
+		const uint64 reads = stats.mReadHitSectors + stats.mReadMissSectors;
+
+		VDStringW blurb;
+		dev->GetSettingsBlurb(blurb);
+
+		ATConsolePrintf("%ls:\n", blurb.c_str());
+		ATConsolePrintf("  Read hits:        %llu sectors (%.1f%%)\n", (unsigned long long)stats.mReadHitSectors, reads ? (double)stats.mReadHitSectors * 100.0 / (double)reads : 0.0);
+		ATConsolePrintf("  Read misses:      %llu sectors\n", (unsigned long long)stats.mReadMissSectors);
+		ATConsolePrintf("  Readahead:        %llu sectors\n", (unsigned long long)stats.mReadAheadSectors);
+		ATConsolePrintf("  Write-behind:     %llu sectors\n", (unsigned long long)stats.mWriteBehindSectors);
+		ATConsolePrintf("  Cached/dirty:     %u / %u sectors\n", stats.mCachedSectors, stats.mDirtySectors);
+		found = true;
+	}
+
+	if (!found)
+		ATConsoleWrite("No cached hard disk images active.\n");
+}
+
 void ATConsoleCmdIDE(ATDebuggerCmdParser& parser) {
 	parser >> 0;
 
@@ -13124,6 +13165,125 @@ void ATConsoleCmdNetPCapClose(ATDebuggerCmdParser& parser) {
 	vdpoly_cast<ATDragonCartEmulator *>(dc)->ClosePacketTrace();
 }
 
+void ATConsoleCmdNetRecord(ATDebuggerCmdParser& parser) {
+	ATDebuggerCmdPath pathArg(true, true);
+
+	parser >> pathArg >> 0;
+
+	IATDevice *dc = g_sim.GetDeviceManager()->GetDeviceByTag("dragoncart");
+
+	if (!dc)
+		throw MyError("No network emulation active.");
+
+	vdpoly_cast<ATDragonCartEmulator *>(dc)->OpenNetCapture(pathArg->c_str());
+
+	ATConsolePrintf("Network capture opened: %s\n", pathArg->c_str());
+}
+
+void ATConsoleCmdNetRecordClose(ATDebuggerCmdParser& parser) {
+	parser >> 0;
+
+	IATDevice *dc = g_sim.GetDeviceManager()->GetDeviceByTag("dragoncart");
+
+	if (!dc)
+		throw MyError("No network emulation active.");
+
+	vdpoly_cast<ATDragonCartEmulator *>(dc)->CloseNetCapture();
+
+	ATConsoleWrite("Network capture closed.\n");
+}
+
+void ATConsoleCmdNetReplay(ATDebuggerCmdParser& parser) {
+	ATDebuggerCmdPath pathArg(true, true);
+
+	parser >> pathArg >> 0;
+
+	IATDevice *dc = g_sim.GetDeviceManager()->GetDeviceByTag("dragoncart");
+
+	if (!dc)
+		throw MyError("No network emulation active.");
+
+	vdpoly_cast<ATDragonCartEmulator *>(dc)->OpenNetReplay(pathArg->c_str());
+
+	ATConsolePrintf("Replaying network capture: %s\n", pathArg->c_str());
+}
+
+void ATConsoleCmdNetReplayClose(ATDebuggerCmdParser& parser) {
+	parser >> 0;
+
+	IATDevice *dc = g_sim.GetDeviceManager()->GetDeviceByTag("dragoncart");
+
+	if (!dc)
+		throw MyError("No network emulation active.");
+
+	vdpoly_cast<ATDragonCartEmulator *>(dc)->CloseNetReplay();
+}
+
+void ATConsoleCmdSAPRender(ATDebuggerCmdParser& parser) {
+	ATDebuggerCmdSwitch allSw("a", false);
+	ATDebuggerCmdSwitchNumArg secondsSw("s", 1, 3600, 180);
+	ATDebuggerCmdSwitchNumArg threadsSw("t", 0, 256, 0);
+	ATDebuggerCmdPath srcArg(true, false);
+	ATDebuggerCmdPath dstArg(true, true);
+
+	parser >> allSw >> secondsSw >> threadsSw >> srcArg >> dstArg >> 0;
+
+	vdvector<ATSAPRenderJob> jobs;
+
+	for(VDDirectoryIterator it(srcArg->c_str()); it.Next(); ) {
+		if (it.IsDirectory())
+			continue;
+
+		const VDStringW srcPath = it.GetFullPath();
+		const VDStringW baseName = VDFileSplitExtLeft(VDStringW(it.GetName()));
+		const uint32 songCount = allSw ? ATGetSAPSongCount(srcPath.c_str()) : 1;
+
+		for(uint32 song = 0; song < songCount; ++song) {
+			ATSAPRenderJob& job = jobs.emplace_back();
+
+			job.mSrcPath = srcPath;
+			job.mDefaultSeconds = secondsSw.GetValue();
+
+			if (allSw) {
+				job.mSong = (sint32)song;
+				job.mDstPath = VDMakePath(dstArg->c_str(), VDStringW().sprintf(L"%ls-%02u.wav", baseName.c_str(), song + 1).c_str());
+			} else
+				job.mDstPath = VDMakePath(dstArg->c_str(), (baseName + L".wav").c_str());
+		}
+	}
+
+	if (jobs.empty())
+		throw MyError("No files matched: %ls", srcArg->c_str());
+
+	ATConsolePrintf("Rendering %u tune(s)...\n", (unsigned)jobs.size());
+
+	const uint64 t0 = VDGetPreciseTick();
+	ATRenderSAPBatch(jobs, (uint32)threadsSw.GetValue());
+	const double hostSeconds = (double)(sint64)(VDGetPreciseTick() - t0) * VDGetPreciseSecondsPerTick();
+
+	double audioSeconds = 0;
+	uint32 failed = 0;
+
+	for(const ATSAPRenderJob& job : jobs) {
+		if (job.mbSucceeded) {
+			audioSeconds += job.mAudioSeconds;
+
+			ATConsolePrintf("%ls: %.1fs rendered in %.2fs\n", job.mDstPath.c_str(), job.mAudioSeconds, job.mHostSeconds);
+		} else {
+			++failed;
+
+			ATConsolePrintf("%ls: FAILED: %s\n", job.mSrcPath.c_str(), job.mError.c_str());
+		}
+	}
+
+	ATConsolePrintf("%u rendered, %u failed; %.1fs of audio in %.2fs (%.1fx real time)\n"
+		, (unsigned)jobs.size() - failed
+		, failed
+		, audioSeconds
+		, hostSeconds
+		, hostSeconds > 0 ? audioSeconds / hostSeconds : 0.0);
+}
+
 void ATConsoleCmdCIODevs(ATDebuggerCmdParser& parser) {
 	parser >> 0;
 
@@ -13985,6 +14145,7 @@ void ATDebuggerInitCommands() {
 		{ ".fdc",				ATConsoleCmdFDC },
 		{ ".fpaccel",			ATConsoleCmdFPAccel },
 		{ ".gtia",				ATConsoleCmdGTIA },
+		{ ".hdcache",			ATConsoleCmdHDCache },
 		{ ".help",				ATConsoleCmdDumpHelp },
 		{ ".history",			ATConsoleCmdDumpHistory },
 		{ ".ide",				ATConsoleCmdIDE },
@@ -14003,6 +14164,11 @@ void ATDebuggerInitCommands() {
 		{ ".netstat",			ATConsoleCmdNetstat },
 		{ ".netpcap",			ATConsoleCmdNetPCap },
 		{ ".netpcapclose",		ATConsoleCmdNetPCapClose },
+		{ ".netrecord",			ATConsoleCmdNetRecord },
+		{ ".netrecordclose",	ATConsoleCmdNetRecordClose },
+		{ ".netreplay",			ATConsoleCmdNetReplay },
+		{ ".netreplayclose",	ATConsoleCmdNetReplayClose },
+		{ ".saprender",			ATConsoleCmdSAPRender },
 		{ ".onexeload",			ATConsoleCmdOnExeLoad },
 		{ ".onexerun",			ATConsoleCmdOnExeRun },
 		{ ".onexelist",			ATConsoleCmdOnExeList },
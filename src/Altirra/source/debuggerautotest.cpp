@@ -24,6 +24,7 @@
 #include <at/atui/uicommandmanager.h>
 #include "console.h"
 #include "debugger.h"
+#include "debuggerautotest.h"
 #include "devicemanager.h"
 #include "options.h"
 #include "simulator.h"
@@ -308,6 +309,153 @@ void ATDebuggerCmdAutotestWaitScreen(ATDebuggerCmdParser& parser) {
 	ATGetDebugger()->StartActiveCommand(new ATDebuggerActiveCmdCheckWaitScreen(true, checksum.GetValue()));
 }
 
+ATAutotestVideoHashMatcher::ATAutotestVideoHashMatcher(Mode mode, uint64 hash, sint32 line, bool printLines)
+	: mMode(mode)
+	, mbPrintLines(printLines)
+	, mLine(line)
+	, mHash(hash)
+{
+}
+
+bool ATAutotestVideoHashMatcher::OnHash(const ATGTIAVideoHash& hash) {
+	if (mbCompleted)
+		return false;
+
+	const uint64 value = mLine >= 0 ? hash.mLineHashes[mLine] : hash.mFrameHash;
+
+	switch(mMode) {
+		case Mode::Check:
+			if (mbPrintLines) {
+				for(int i = 0; i < 240; ++i)
+					ATConsolePrintf("Line %3d: %016llX\n", i + 8, (unsigned long long)hash.mLineHashes[i]);
+			}
+
+			ATConsolePrintf("Video hash (%s): %016llX\n", hash.mbRgb32 ? "RGB32" : "P8", (unsigned long long)hash.mFrameHash);
+			break;
+
+		case Mode::Wait:
+			if (value != mHash)
+				return false;
+			break;
+
+		case Mode::Assert:
+			if (value != mHash) {
+				if (mLine >= 0)
+					mFailureMessage.sprintf("Assertion failed: video hash for line %d is %016llX, expected %016llX", mLine + 8, (unsigned long long)value, (unsigned long long)mHash);
+				else
+					mFailureMessage.sprintf("Assertion failed: video hash is %016llX, expected %016llX", (unsigned long long)value, (unsigned long long)mHash);
+			}
+			break;
+	}
+
+	mbCompleted = true;
+	return true;
+}
+
+class ATDebuggerActiveCmdVideoHash final : public vdrefcounted<IATDebuggerActiveCommand> {
+public:
+	using Mode = ATAutotestVideoHashMatcher::Mode;
+
+	ATDebuggerActiveCmdVideoHash(Mode mode, uint64 hash, sint32 line, bool printLines);
+
+	virtual bool IsBusy() const override { return true; }
+	virtual const char *GetPrompt() override { return ""; }
+	virtual void BeginCommand(IATDebugger *debugger) override;
+	virtual void EndCommand() override;
+	virtual bool ProcessSubCommand(const char *s) override;
+
+private:
+	void ProcessHash(const ATGTIAVideoHash& hash);
+
+	ATGTIAVideoHashFn mVideoHashFn;
+	IATDebugger *mpDebugger = nullptr;
+	ATAutotestVideoHashMatcher mMatcher;
+};
+
+ATDebuggerActiveCmdVideoHash::ATDebuggerActiveCmdVideoHash(Mode mode, uint64 hash, sint32 line, bool printLines)
+	: mMatcher(mode, hash, line, printLines)
+{
+}
+
+void ATDebuggerActiveCmdVideoHash::BeginCommand(IATDebugger *debugger) {
+	mVideoHashFn = [this](const ATGTIAVideoHash& hash) { ProcessHash(hash); };
+	g_sim.GetGTIA().AddVideoHashCallback(&mVideoHashFn);
+	mpDebugger = debugger;
+	mpDebugger->Run(kATDebugSrcMode_Same);
+}
+
+void ATDebuggerActiveCmdVideoHash::EndCommand() {
+	g_sim.GetGTIA().RemoveVideoHashCallback(&mVideoHashFn);
+}
+
+bool ATDebuggerActiveCmdVideoHash::ProcessSubCommand(const char *s) {
+	if (mMatcher.IsFailed()) {
+		// Same as .autotest_assert. Breaking terminates this command, so keep
+		// it alive until the error is thrown.
+		vdrefptr<ATDebuggerActiveCmdVideoHash> holdThis(this);
+
+		mpDebugger->Break();
+		throw MyError("%s", mMatcher.GetFailureMessage());
+	}
+
+	return !mMatcher.IsCompleted();
+}
+
+void ATDebuggerActiveCmdVideoHash::ProcessHash(const ATGTIAVideoHash& hash) {
+	// This is called from within GTIA, so only stop here; an assertion
+	// failure is reported from ProcessSubCommand() once the emulator has
+	// stopped.
+	if (mMatcher.OnHash(hash))
+		mpDebugger->Stop();
+}
+
+namespace {
+	uint64 ATDebuggerParseVideoHash(const VDStringA& s) {
+		const char *str = s.c_str();
+
+		if (*str == '$')
+			++str;
+		else if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
+			str += 2;
+
+		char *end = nullptr;
+		const uint64 hash = strtoull(str, &end, 16);
+
+		if (!*str || *end)
+			throw MyError("Invalid video hash: %s", s.c_str());
+
+		return hash;
+	}
+
+	// Scanline arguments use the same numbering as the beam position (8-247).
+	sint32 ATDebuggerGetVideoHashLine(const ATDebuggerCmdSwitchNumArg& lineArg) {
+		return lineArg.IsValid() ? lineArg.GetValue() - 8 : -1;
+	}
+}
+
+void ATDebuggerCmdAutotestCheckVideoHash(ATDebuggerCmdParser& parser) {
+	ATDebuggerCmdSwitch linesSwitch("lines", false);
+	parser >> linesSwitch >> 0;
+
+	ATGetDebugger()->StartActiveCommand(new ATDebuggerActiveCmdVideoHash(ATDebuggerActiveCmdVideoHash::Mode::Check, 0, -1, linesSwitch));
+}
+
+void ATDebuggerCmdAutotestWaitVideoHash(ATDebuggerCmdParser& parser) {
+	ATDebuggerCmdSwitchNumArg lineArg("line", 8, 247);
+	ATDebuggerCmdName hashArg(true);
+	parser >> lineArg >> hashArg >> 0;
+
+	ATGetDebugger()->StartActiveCommand(new ATDebuggerActiveCmdVideoHash(ATDebuggerActiveCmdVideoHash::Mode::Wait, ATDebuggerParseVideoHash(*hashArg), ATDebuggerGetVideoHashLine(lineArg), false));
+}
+
+void ATDebuggerCmdAutotestAssertVideoHash(ATDebuggerCmdParser& parser) {
+	ATDebuggerCmdSwitchNumArg lineArg("line", 8, 247);
+	ATDebuggerCmdName hashArg(true);
+	parser >> lineArg >> hashArg >> 0;
+
+	ATGetDebugger()->StartActiveCommand(new ATDebuggerActiveCmdVideoHash(ATDebuggerActiveCmdVideoHash::Mode::Assert, ATDebuggerParseVideoHash(*hashArg), ATDebuggerGetVideoHashLine(lineArg), false));
+}
+
 class ATDebuggerActiveCmdCheckWait final : public vdrefcounted<IATDebuggerActiveCommand> {
 public:
 	ATDebuggerActiveCmdCheckWait(vdautoptr<ATDebugExpNode> expr);
@@ -660,6 +808,9 @@ void ATDebuggerInitAutotestCommands() {
 		{ ".autotest_bootimage",			ATDebuggerCmdAutotestBootImage },
 		{ ".autotest_checkscreen",			ATDebuggerCmdAutotestCheckScreen },
 		{ ".autotest_waitscreen",			ATDebuggerCmdAutotestWaitScreen },
+		{ ".autotest_checkvideohash",		ATDebuggerCmdAutotestCheckVideoHash },
+		{ ".autotest_waitvideohash",		ATDebuggerCmdAutotestWaitVideoHash },
+		{ ".autotest_assertvideohash",		ATDebuggerCmdAutotestAssertVideoHash },
 		{ ".autotest_wait",					ATDebuggerCmdAutotestWait },
 		{ ".autotest_saveimage",			ATDebuggerCmdAutotestSaveImage },
 		{ ".autotest_analyzerenderedimage",	ATDebuggerCmdAutotestAnalyzeRenderedImage },
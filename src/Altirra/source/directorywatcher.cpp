@@ -51,7 +51,12 @@ void ATDirectoryWatcher::Init(const wchar_t *basePath, bool recursive) {
 		if (!mhExitEvent)
 			throw (DWORD)GetLastError();
 
-		ThreadStart();
+		if (!ThreadStart())
+			throw (DWORD)GetLastError();
+
+		// Wait for the watch to be set up, so that changes made from here on
+		// aren't missed.
+		mReadySignal.wait();
 	} catch(DWORD err) {
 		Shutdown();
 
@@ -75,6 +80,11 @@ void ATDirectoryWatcher::Shutdown() {
 		mhDirChangeEvent = NULL;
 	}
 
+	if (mhDir != INVALID_HANDLE_VALUE) {
+		CloseHandle((HANDLE)mhDir);
+		mhDir = INVALID_HANDLE_VALUE;
+	}
+
 	if (mpChangeBuffer) {
 		delete[] mpChangeBuffer;
 		mpChangeBuffer = NULL;
@@ -126,35 +136,47 @@ bool ATDirectoryWatcher::CheckForChanges(vdfastvector<wchar_t>& strheap) {
 }
 
 void ATDirectoryWatcher::ThreadRun() {
-	if (mpChangeBuffer)
-		RunNotifyThread();
-	else
-		RunPollThread();
+	bool ready = false;
+
+	if (mpChangeBuffer && RunNotifyThread(ready))
+		return;
+
+	RunPollThread(ready);
 }
 
-void ATDirectoryWatcher::RunPollThread() {
+void ATDirectoryWatcher::RunPollThread(bool ready) {
 	uint32 delay = 1000;
 	uint32 lastChecksum[8] {};
-	bool firstPoll = true;
+
+	// Taking the baseline means walking the whole tree, which can take a
+	// while on a slow share, so don't hold up Init() for it. Anything that
+	// changes before the baseline is taken would be missed, so report
+	// everything as changed once it is.
+	if (!ready)
+		mReadySignal.signal();
+
+	PollDirectory(lastChecksum);
+	NotifyAllChanged();
 
 	for(;;) {
+		if (WAIT_TIMEOUT != WaitForSingleObject((HANDLE)mhExitEvent, delay))
+			break;
+
 		uint32 newChecksum[8] {};
-		PollDirectory(newChecksum, mBasePath, 0);
+		PollDirectory(newChecksum);
 
-		if (memcmp(newChecksum, lastChecksum, sizeof newChecksum) || firstPoll) {
+		if (memcmp(newChecksum, lastChecksum, sizeof newChecksum)) {
 			memcpy(lastChecksum, newChecksum, sizeof lastChecksum);
 
-			if (firstPoll)
-				firstPoll = false;
-			else
-				NotifyAllChanged();
+			NotifyAllChanged();
 		}
-
-		if (WAIT_TIMEOUT != WaitForSingleObject((HANDLE)mhExitEvent, delay))
-			break;
 	}
 }
 
+void ATDirectoryWatcher::PollDirectory(uint32 *orderIndependentChecksum) {
+	PollDirectory(orderIndependentChecksum, mBasePath, 0);
+}
+
 void ATDirectoryWatcher::PollDirectory(uint32 *orderIndependentChecksum, const VDStringSpanW& path, uint32 nestingLevel) {
 	ATChecksumEngineSHA256 mChecksumEngine;
 
@@ -196,7 +218,10 @@ void ATDirectoryWatcher::PollDirectory(uint32 *orderIndependentChecksum, const V
 	}
 }
 
-void ATDirectoryWatcher::RunNotifyThread() {
+// Returns true if the watch ended because of a shutdown request, or false if
+// change notifications stopped working and the caller should fall back to
+// polling.
+bool ATDirectoryWatcher::RunNotifyThread(bool& ready) {
 	OVERLAPPED ov;
 	HANDLE h[2] = { (HANDLE)mhExitEvent, (HANDLE)mhDirChangeEvent };
 	const DWORD dwNotifyFilter
@@ -209,6 +234,7 @@ void ATDirectoryWatcher::RunNotifyThread() {
 
 	VDStringW relPath;
 	vdfastvector<WCHAR> longPath;
+	bool exitRequested = true;
 
 	for(;;) {
 		DWORD dummyActual;
@@ -218,7 +244,27 @@ void ATDirectoryWatcher::RunNotifyThread() {
 		ResetEvent(ov.hEvent);
 
 		BOOL rdcResult = ReadDirectoryChangesW((HANDLE)mhDir, mpChangeBuffer, mChangeBufferSize, mbRecursive ? TRUE : FALSE, dwNotifyFilter, &dummyActual, &ov, NULL);
-		DWORD waitResult = WaitForMultipleObjects(rdcResult != 0 ? 2 : 1, h, FALSE, INFINITE);
+
+		if (!rdcResult) {
+			// The watch couldn't be set up (e.g. network share without change
+			// notification support). Anything since the last notification may
+			// have been missed, so report everything as changed before the
+			// poll loop takes over.
+			VDDEBUG("ReadDirectoryChangesW() failed on %ls, falling back to polling\n", mBasePath.c_str());
+
+			if (ready)
+				NotifyAllChanged();
+
+			exitRequested = false;
+			break;
+		}
+
+		if (!ready) {
+			ready = true;
+			mReadySignal.signal();
+		}
+
+		DWORD waitResult = WaitForMultipleObjects(2, h, FALSE, INFINITE);
 
 		if (waitResult != WAIT_OBJECT_0 + 1) {
 			// Timeout is impossible, so this must be error or wait signaled for the exit
@@ -226,10 +272,13 @@ void ATDirectoryWatcher::RunNotifyThread() {
 			break;
 		}
 
-		// Retrieve the overlapped I/O result.
+		// Retrieve the overlapped I/O result. If that fails, we don't know what
+		// was lost, so report everything as changed and try again.
 		DWORD actual = 0;
-		if (!GetOverlappedResult((HANDLE)mhDir, &ov, &actual, FALSE))
+		if (!GetOverlappedResult((HANDLE)mhDir, &ov, &actual, FALSE)) {
+			NotifyAllChanged();
 			continue;
+		}
 
 		// Zero bytes returned means we ran out of buffer, in which case we should just tag all
 		// directories as changed.
@@ -272,6 +321,8 @@ void ATDirectoryWatcher::RunNotifyThread() {
 
 	// Cancel any outstanding watch on the handle (must be done in this thread).
 	CancelIo((HANDLE)mhDir);
+
+	return exitRequested;
 }
 
 void ATDirectoryWatcher::NotifyAllChanged() {
@@ -26,6 +26,7 @@
 #include <at/atcore/propertyset.h>
 #include <at/atcore/scheduler.h>
 #include <at/atnetwork/ethernetbus.h>
+#include <at/atnetwork/ethernetcapture.h>
 #include <at/atnetwork/socket.h>
 #include <at/atnetwork/gatewayserver.h>
 #include <at/atnetworksockets/vxlantunnel.h>
@@ -402,31 +403,60 @@ void ATDragonCartEmulator::Init(ATMemoryManager *memmgr, ATScheduler *slowSched,
 	mpEthernetBus = new ATEthernetBus;
 	mEthernetClockId = mpEthernetBus->AddClock(mpEthernetClock);
 
-	if (settings.mTunnelAddr)
-		ATCreateNetSockVxlanTunnel(VDToBE32(settings.mTunnelAddr), settings.mTunnelSrcPort, settings.mTunnelTgtPort, mpEthernetBus, mEthernetClockId, dispatcher, &mpNetSockVxlanTunnel);
+	mpAsyncDispatcher = dispatcher;
+	InitNetwork();
 
-	if (settings.mAccessMode != ATDragonCartSettings::kAccessMode_None) {
+	mCS8900A.Init(mpEthernetBus, mEthernetClockId);
+}
+
+void ATDragonCartEmulator::Shutdown() {
+	ClosePacketTrace();
+
+	if (mpNetCapture) {
+		mpNetCapture->Shutdown();
+		mpNetCapture.reset();
+	}
+
+	if (mpNetReplay) {
+		mpNetReplay->Shutdown();
+		mpNetReplay.reset();
+	}
+
+	mCS8900A.Shutdown();
+
+	ShutdownNetwork();
+	mpAsyncDispatcher = nullptr;
+
+	vdsafedelete <<= mpEthernetBus, mpEthernetClock;
+
+	if (mpMemLayer) {
+		mpMemMgr->DeleteLayer(mpMemLayer);
+		mpMemLayer = NULL;
+	}
+
+	mpMemMgr = NULL;
+}
+
+void ATDragonCartEmulator::InitNetwork() {
+	if (mSettings.mTunnelAddr)
+		ATCreateNetSockVxlanTunnel(VDToBE32(mSettings.mTunnelAddr), mSettings.mTunnelSrcPort, mSettings.mTunnelTgtPort, mpEthernetBus, mEthernetClockId, mpAsyncDispatcher, &mpNetSockVxlanTunnel);
+
+	if (mSettings.mAccessMode != ATDragonCartSettings::kAccessMode_None) {
 		ATCreateEthernetGatewayServer(&mpGateway);
 		mpGateway->Init(mpEthernetBus, mEthernetClockId, VDToBE32(mSettings.mNetAddr), VDToBE32(mSettings.mNetMask), mSettings.mAccessMode == mSettings.kAccessMode_NAT);
 
 		ATCreateNetSockWorker(
 			mpGateway->GetUdpStack(),
 			mpGateway->GetTcpStack(),
-			settings.mAccessMode == ATDragonCartSettings::kAccessMode_NAT,
-			VDToBE32(settings.mForwardingAddr),
-			settings.mForwardingPort,
+			mSettings.mAccessMode == ATDragonCartSettings::kAccessMode_NAT,
+			VDToBE32(mSettings.mForwardingAddr),
+			mSettings.mForwardingPort,
 			&mpNetSockWorker);
 		mpGateway->SetBridgeListener(mpNetSockWorker->AsSocketListener(), mpNetSockWorker->AsUdpListener());
 	}
-
-	mCS8900A.Init(mpEthernetBus, mEthernetClockId);
 }
 
-void ATDragonCartEmulator::Shutdown() {
-	ClosePacketTrace();
-
-	mCS8900A.Shutdown();
-
+void ATDragonCartEmulator::ShutdownNetwork() {
 	vdsaferelease <<= mpNetSockVxlanTunnel;
 
 	if (mpNetSockWorker) {
@@ -435,14 +465,6 @@ void ATDragonCartEmulator::Shutdown() {
 	}
 
 	vdsaferelease <<= mpGateway;
-	vdsafedelete <<= mpEthernetBus, mpEthernetClock;
-
-	if (mpMemLayer) {
-		mpMemMgr->DeleteLayer(mpMemLayer);
-		mpMemLayer = NULL;
-	}
-
-	mpMemMgr = NULL;
 }
 
 void ATDragonCartEmulator::ColdReset() {
@@ -529,6 +551,52 @@ void ATDragonCartEmulator::ClosePacketTrace() {
 	mPacketTraceFile.reset();
 }
 
+void ATDragonCartEmulator::OpenNetCapture(const wchar_t *path) {
+	CloseNetCapture();
+
+	vdautoptr<ATEthernetCaptureWriter> writer(new ATEthernetCaptureWriter);
+	writer->Init(path, *mpEthernetBus, mEthernetClockId, mCS8900A.GetEndpointId());
+
+	mpNetCapture = std::move(writer);
+}
+
+void ATDragonCartEmulator::CloseNetCapture() {
+	if (mpNetCapture) {
+		vdautoptr<ATEthernetCaptureWriter> capture(std::move(mpNetCapture));
+
+		capture->Close();
+	}
+}
+
+void ATDragonCartEmulator::OpenNetReplay(const wchar_t *path) {
+	vdautoptr<ATEthernetCapturePlayer> player(new ATEthernetCapturePlayer);
+	player->Load(path);
+
+	if (mpNetReplay) {
+		mpNetReplay->Shutdown();
+		mpNetReplay.reset();
+	}
+
+	// Take down the gateway and host networking so that the only traffic
+	// reaching the adapter comes from the capture, and drop any frames still
+	// in flight from them.
+	ShutdownNetwork();
+	mpEthernetBus->ClearPendingFrames();
+
+	player->Init(*mpEthernetBus, mEthernetClockId);
+	mpNetReplay = std::move(player);
+}
+
+void ATDragonCartEmulator::CloseNetReplay() {
+	if (!mpNetReplay)
+		return;
+
+	mpNetReplay->Shutdown();
+	mpNetReplay.reset();
+
+	InitNetwork();
+}
+
 void ATDragonCartEmulator::ReceiveFrame(const ATEthernetPacket& packet, ATEthernetFrameDecodedType decType, const void *decInfo) {
 	const double deltaSeconds = (double)(mpEthernetClock->GetTimestamp(0) - mPacketTraceStartTimestamp) * mpEthernetClock->kSecondsPerTick;
 	const double wholeDeltaSeconds = floor(deltaSeconds);
@@ -564,6 +632,23 @@ void ATDragonCartEmulator::ReceiveFrame(const ATEthernetPacket& packet, ATEthern
 }
 
 void ATDragonCartEmulator::DumpConnectionInfo(ATConsoleOutput& output) {
+	if (mpNetCapture) {
+		if (const char *err = mpNetCapture->GetError())
+			output("Recording network capture: stopped after %u frames (%s)", mpNetCapture->GetFrameCount(), err);
+		else
+			output("Recording network capture: %u frames recorded", mpNetCapture->GetFrameCount());
+	}
+
+	if (mpNetReplay) {
+		const ATEthernetCapturePlayer::Status status = mpNetReplay->GetStatus();
+
+		output("Replaying network capture: %u/%u frames played%s", status.mFramesPlayed, status.mFramesToPlay, mpNetReplay->IsFinished() ? " (finished)" : "");
+		output("  Adapter frames: %u/%u matched, %u diverged", status.mLocalFramesMatched, status.mLocalFramesExpected, status.mLocalFramesDiverged);
+	}
+
+	if (!mpGateway)
+		return;
+
 	typedef vdfastvector<ATNetConnectionInfo> ConnInfos;
 	ConnInfos connInfos;
 
@@ -22,6 +22,7 @@
 #include <vd2/system/math.h>
 #include <vd2/system/vecmath.h>
 #include <vd2/VDDisplay/display.h>
+#include <vd2/VDDisplay/screenfxsoft.h>
 #include <vd2/Kasumi/pixmap.h>
 #include <vd2/Kasumi/pixmapops.h>
 #include <vd2/Kasumi/pixmaputils.h>
@@ -88,6 +89,8 @@ extern "C" void VDCDECL atasm_update_playfield_160_sse2(
 ATConfigVarInt32 g_ATCVDisplayDropCountThreshold("display.drop_count_threshold", 20);
 ATConfigVarFloat g_ATCVDisplayDropLagThreshold("display.drop_lag_threshold", 0.007f);
 ATConfigVarBool g_ATCVDisplayForceHdrRendering("display.force_hdr_rendering", false);
+ATConfigVarBool g_ATCVDisplaySoftScreenFX("display.soft_screenfx", true);
+ATConfigVarInt32 g_ATCVDisplaySoftScreenFXScale("display.soft_screenfx_scale", 2);
 ATConfigVarBool g_ATCVDevicesVbxeNtscOffset("devices.vbxe.ntsc_vertical_offset", true);
 
 ///////////////////////////////////////////////////////////////////////////
@@ -369,9 +372,10 @@ public:
 
 class ATFrameBuffer final : public VDVideoDisplayFrame, public IVDVideoDisplayScreenFXEngine {
 public:
-	ATFrameBuffer(ATFrameTracker *tracker, ATArtifactingEngine& artengine)
+	ATFrameBuffer(ATFrameTracker *tracker, ATArtifactingEngine& artengine, VDDisplayScreenFXSoft& softfx)
 		: mpTracker(tracker)
 		, mArtEngine(artengine)
+		, mSoftScreenFX(softfx)
 	{
 		if (mpTracker)
 			++mpTracker->mActiveFrames;
@@ -384,14 +388,16 @@ public:
 			--mpTracker->mActiveFrames;
 	}
 
-	VDPixmap ApplyScreenFX(const VDPixmap& px) override;
+	VDPixmap ApplyScreenFX(const VDPixmap& px, const vdsize32& outputSize) override;
 	VDPixmap ApplyScreenFX(VDPixmapBuffer& dst, const VDPixmap& px, bool enableSignedOutput);
 	void DuplicateField();
 
 	vdrefptr<ATFrameTracker> mpTracker;
 	ATArtifactingEngine& mArtEngine;
+	VDDisplayScreenFXSoft& mSoftScreenFX;
 	VDPixmapBuffer mBuffer;
 	VDPixmapBuffer mEmulatedFXBuffer {};
+	VDPixmapBuffer mSoftScreenFXStageBuffer {};
 	VDVideoDisplayScreenFXInfo mScreenFX {};
 
 	uint32 mViewX1 = 0;
@@ -404,11 +410,38 @@ public:
 	bool mbLowerField = false;			// computer rendered to lower field of interlaced frame
 	bool mbDuplicateField = false;		// set if the computer should render to _both_ fields
 	bool mbIncludeHBlank = false;
+	bool mbSoftScreenFX = false;		// distortion/bloom need to be done on the CPU
 	bool mbScanlineHasHires[312] {};
 };
 
-VDPixmap ATFrameBuffer::ApplyScreenFX(const VDPixmap& px) {
-	return ApplyScreenFX(mEmulatedFXBuffer, px, false);
+VDPixmap ATFrameBuffer::ApplyScreenFX(const VDPixmap& px, const vdsize32& outputSize) {
+	if (!mbSoftScreenFX)
+		return ApplyScreenFX(mEmulatedFXBuffer, px, false);
+
+	// Distortion and bloom are rendered at the output size, as on the 3D path, so
+	// that the warp doesn't get blurred again by the display's own scaling. If the
+	// display can't tell us the output size, use a fixed multiple of the source.
+	const VDPixmap stage = ApplyScreenFX(mSoftScreenFXStageBuffer, px, false);
+	uint32 dstw;
+	uint32 dsth;
+	float viewAspect;
+
+	if (outputSize.w > 0 && outputSize.h > 0) {
+		dstw = (uint32)std::min<sint32>(outputSize.w, 4096);
+		dsth = (uint32)std::min<sint32>(outputSize.h, 4096);
+		viewAspect = (float)outputSize.w / (float)outputSize.h;
+	} else {
+		const uint32 scale = (uint32)std::clamp<sint32>(g_ATCVDisplaySoftScreenFXScale, 1, 4);
+
+		dstw = stage.w * scale;
+		dsth = stage.h * scale;
+		viewAspect = (float)px.w * mRawPAR / (float)px.h;
+	}
+
+	VDPixmap result = mSoftScreenFX.Apply(mEmulatedFXBuffer, stage, dstw, dsth, viewAspect, mScreenFX);
+	result.palette = mpPalette;
+
+	return result;
 }
 
 VDPixmap ATFrameBuffer::ApplyScreenFX(VDPixmapBuffer& dstBuffer, const VDPixmap& px, bool enableSignedOutput) {
@@ -523,6 +556,70 @@ namespace {
 		{ 0, 2, 2, 0 },
 		{ 1, 2, 3, 0 },
 	};
+
+	// Fast non-cryptographic hash over a raw scanline, using the xxHash64
+	// structure of four independent 64-bit lanes. This is run on every visible
+	// scanline while a video hash is requested, so it needs to be much faster
+	// than the byte-serial checksums.
+	uint64 ATGTIAHashVideoData(const void *data, size_t len) {
+		static constexpr uint64 kPrime1 = 0x9E3779B185EBCA87ULL;
+		static constexpr uint64 kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+		static constexpr uint64 kPrime3 = 0x165667B19E3779F9ULL;
+		static constexpr uint64 kPrime4 = 0x85EBCA77C2B2AE63ULL;
+		static constexpr uint64 kPrime5 = 0x27D4EB2F165667C5ULL;
+
+		const auto rotl = [](uint64 v, int bits) { return (v << bits) + (v >> (64 - bits)); };
+		const auto round = [=](uint64 acc, uint64 v) { return rotl(acc + v * kPrime2, 31) * kPrime1; };
+		const auto merge = [=](uint64 acc, uint64 v) { return (acc ^ round(0, v)) * kPrime1 + kPrime4; };
+
+		const uint8 *VDRESTRICT src = (const uint8 *)data;
+		size_t left = len;
+		uint64 h;
+
+		if (left >= 32) {
+			uint64 v1 = kPrime1 + kPrime2;
+			uint64 v2 = kPrime2;
+			uint64 v3 = 0;
+			uint64 v4 = 0 - kPrime1;
+
+			do {
+				v1 = round(v1, VDReadUnalignedLEU64(src +  0));
+				v2 = round(v2, VDReadUnalignedLEU64(src +  8));
+				v3 = round(v3, VDReadUnalignedLEU64(src + 16));
+				v4 = round(v4, VDReadUnalignedLEU64(src + 24));
+				src += 32;
+				left -= 32;
+			} while(left >= 32);
+
+			h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+			h = merge(h, v1);
+			h = merge(h, v2);
+			h = merge(h, v3);
+			h = merge(h, v4);
+		} else
+			h = kPrime5;
+
+		h += len;
+
+		while(left >= 8) {
+			h = rotl(h ^ round(0, VDReadUnalignedLEU64(src)), 27) * kPrime1 + kPrime4;
+			src += 8;
+			left -= 8;
+		}
+
+		while(left) {
+			h = rotl(h ^ (*src++ * kPrime5), 11) * kPrime1;
+			--left;
+		}
+
+		h ^= h >> 33;
+		h *= kPrime2;
+		h ^= h >> 29;
+		h *= kPrime3;
+		h ^= h >> 32;
+
+		return h;
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -696,6 +793,7 @@ ATGTIAEmulator::ATGTIAEmulator()
 	, mbScanlinesEnabled(false)
 	, mPreArtifactFrameBuffer()
 	, mpArtifactingEngine(new ATArtifactingEngine)
+	, mpSoftScreenFX(new VDDisplayScreenFXSoft)
 	, mpRenderer(new ATGTIARenderer)
 	, mpUIRenderer(NULL)
 	, mpVBXE(NULL)
@@ -755,6 +853,7 @@ ATGTIAEmulator::~ATGTIAEmulator() {
 	}
 
 	delete mpArtifactingEngine;
+	delete mpSoftScreenFX;
 	delete mpRenderer;
 }
 
@@ -878,6 +977,10 @@ bool ATGTIAEmulator::AreAcceleratedEffectsAvailable() const {
 	return mpDisplay && mpDisplay->IsScreenFXPreferred();
 }
 
+bool ATGTIAEmulator::AreSoftwareScreenEffectsAvailable() const {
+	return g_ATCVDisplaySoftScreenFX;
+}
+
 ATGTIAEmulator::HDRAvailability ATGTIAEmulator::IsHDRRenderingAvailable() const {
 	if (!mpDisplay)
 		return HDRAvailability::NoMinidriverSupport;
@@ -1212,6 +1315,14 @@ void ATGTIAEmulator::RemoveRawFrameCallback(const ATGTIARawFrameFn *fn) {
 	mRawFrameCallbacks.Remove(fn);
 }
 
+void ATGTIAEmulator::AddVideoHashCallback(const ATGTIAVideoHashFn *fn) {
+	mVideoHashCallbacks.Add(fn);
+}
+
+void ATGTIAEmulator::RemoveVideoHashCallback(const ATGTIAVideoHashFn *fn) {
+	mVideoHashCallbacks.Remove(fn);
+}
+
 bool ATGTIAEmulator::IsLastFrameBufferAvailable() const {
 	return mpLastFrame != nullptr;
 }
@@ -1808,7 +1919,7 @@ bool ATGTIAEmulator::BeginFrame(uint32 y, bool force, bool drop) {
 		} else {
 			if ((!isFramePending || mbTurbo) && mpFrameTracker->mActiveFrames < 3) {
 				// create a new frame
-				ATFrameBuffer *fb = new ATFrameBuffer(mpFrameTracker, *mpArtifactingEngine);
+				ATFrameBuffer *fb = new ATFrameBuffer(mpFrameTracker, *mpArtifactingEngine, *mpSoftScreenFX);
 				mpFrame = fb;
 
 				fb->mPixmap.format = 0;
@@ -1863,7 +1974,7 @@ bool ATGTIAEmulator::BeginFrame(uint32 y, bool force, bool drop) {
 		// tracker as it doesn't get presented.
 		if (!mpFrame) {
 			if (!mpDroppedFrame) {
-				mpDroppedFrame = new ATFrameBuffer(nullptr, *mpArtifactingEngine);
+				mpDroppedFrame = new ATFrameBuffer(nullptr, *mpArtifactingEngine, *mpSoftScreenFX);
 				mpDroppedFrame->mbDroppedFrame = true;
 			}
 
@@ -1980,8 +2091,10 @@ bool ATGTIAEmulator::BeginFrame(uint32 y, bool force, bool drop) {
 
 		fb->mPixmap.data = (char *)fb->mPixmap.data + imageViewRect.left * (mFrameProperties.mbOutputRgb32 ? 4 : 1) + fb->mPixmap.pitch * imageViewRect.top;
 
-		// set up hardware screen FX
-		if (mFrameProperties.mbAccelPostProcess) {
+		// set up hardware screen FX, or the software fallback for distortion/bloom
+		fb->mbSoftScreenFX = mFrameProperties.mbSoftScreenFX;
+
+		if (mFrameProperties.mbAccelPostProcess || mFrameProperties.mbSoftScreenFX) {
 			const ATColorParams& params = mActiveColorParams;
 			const auto& ap = mpArtifactingEngine->GetArtifactingParams();
 
@@ -2098,6 +2211,13 @@ void ATGTIAEmulator::BeginScanline(int y, bool hires) {
 	mY = y;
 	mbPMRendered = false;
 
+	if (y == 8) {
+		mbVideoHashActive = !mVideoHashCallbacks.IsEmpty();
+
+		if (mbVideoHashActive)
+			memset(mVideoHash.mLineHashes, 0, sizeof mVideoHash.mLineHashes);
+	}
+
 	if (mpFrame) {
 		int yw = y;
 		int h = mRawFrame.h;
@@ -2125,6 +2245,15 @@ void ATGTIAEmulator::BeginScanline(int y, bool hires) {
 
 			mRawFrameCallbacks.NotifyAll([&](const ATGTIARawFrameFn *fn) { (*fn)(px); });
 		}
+
+		if (y == 248 && mbVideoHashActive) {
+			mbVideoHashActive = false;
+
+			mVideoHash.mbRgb32 = mFrameProperties.mbRenderRgb32;
+			mVideoHash.mFrameHash = ATGTIAHashVideoData(mVideoHash.mLineHashes, sizeof mVideoHash.mLineHashes) ^ (mVideoHash.mbRgb32 ? 1 : 0);
+
+			mVideoHashCallbacks.NotifyAll([this](const ATGTIAVideoHashFn *fn) { (*fn)(mVideoHash); });
+		}
 	}
 
 	memset(mMergeBuffer, 0, sizeof mMergeBuffer);
@@ -2134,7 +2263,9 @@ void ATGTIAEmulator::BeginScanline(int y, bool hires) {
 		mpVBXE->BeginScanline(y, (uint32*)mpDst, mMergeBuffer, mAnticData, mbHiresMode);
 	else if (mpDst) {
 		mpRenderer->SetVBlank((uint32)(y - 8) >= 240);
-		mpRenderer->BeginScanline(mpDst, mMergeBuffer, mAnticData, mbHiresMode);
+		static_assert(sizeof mMergeBuffer == ATGTIARenderer::kLineBufferSize && sizeof mAnticData == ATGTIARenderer::kLineBufferSize);
+
+		mpRenderer->BeginScanline(y, mpDst, mMergeBuffer, mAnticData, mbHiresMode);
 	}
 }
 
@@ -2157,6 +2288,15 @@ void ATGTIAEmulator::EndScanline(uint8 dlControl, bool pfrendered) {
 	else
 		mpRenderer->EndScanline();
 
+	if (mbVideoHashActive && mpDst && (unsigned)(mY - 8) < 240) {
+		size_t lineSize = mFrameProperties.mbRenderHoriz2x ? 912 : 456;
+
+		if (mFrameProperties.mbRenderRgb32)
+			lineSize *= 4;
+
+		mVideoHash.mLineHashes[mY - 8] = ATGTIAHashVideoData(mpDst, lineSize);
+	}
+
 	// move down buffers as necessary and offset all pending render changes by -scanline
 	if (mRCIndex >= 64) {
 		mRegisterChanges.erase(mRegisterChanges.begin(), mRegisterChanges.begin() + mRCIndex);
@@ -3256,12 +3396,31 @@ void ATGTIAEmulator::ApplyArtifacting(bool immediate) {
 			} else if (mFrameProperties.mbSoftScanlines)
 				h >>= 1;
 
+			// Artifacting is done in horizontal bands first; deinterlacing and scanline
+			// interpolation only write the in-between rows and run afterward.
+			if (doBlending) {
+				char *const dstrow0 = dstrow;
+				const ptrdiff_t rowpitch = mFrameProperties.mbSoftDeinterlace || mFrameProperties.mbSoftScanlines ? dstpitch * 2 : dstpitch;
+				const bool includeHBlank = mFrameProperties.mbIncludeHBlank;
+				ATArtifactingEngine& ae = *mpArtifactingEngine;
+
+				ae.ForEachBand(0, h,
+					[=, &ae](uint32 y, ATArtifactingEngine::DelayLine& delayLine) {
+						ae.PrimeDelayLine32((const uint32 *)(dstrow0 + rowpitch * y), 912, delayLine);
+					},
+					[=, &ae](uint32 y1, uint32 y2, ATArtifactingEngine::DelayLine& delayLine) {
+						for(uint32 row = y1; row < y2; ++row)
+							ae.Artifact32(row, (uint32 *)(dstrow0 + rowpitch * row), 912, immediate, includeHBlank, delayLine);
+					}
+				);
+			}
+
+			if (!mFrameProperties.mbSoftDeinterlace && !mFrameProperties.mbSoftScanlines)
+				return;
+
 			for(uint32 row=0; row<h; ++row) {
 				uint32 *dst = (uint32 *)dstrow;
 
-				if (doBlending)
-					mpArtifactingEngine->Artifact32(row, dst, 912, immediate, mFrameProperties.mbIncludeHBlank);
-
 				if (mFrameProperties.mbSoftDeinterlace) {
 					if (row) {
 						mpArtifactingEngine->Deinterlace(
@@ -3322,8 +3481,8 @@ void ATGTIAEmulator::ApplyArtifacting(bool immediate) {
 			dstpitch *= 2;
 	}
 
-	const uint8 *srcrow = (const uint8 *)mPreArtifactFrame.data;
-	ptrdiff_t srcpitch = mPreArtifactFrame.pitch;
+	const uint8 *const srcrow = (const uint8 *)mPreArtifactFrame.data;
+	const ptrdiff_t srcpitch = mPreArtifactFrame.pitch;
 
 	uint32 y1 = mPreArtifactFrameVisibleY1;
 	uint32 y2 = mPreArtifactFrameVisibleY2;
@@ -3331,25 +3490,44 @@ void ATGTIAEmulator::ApplyArtifacting(bool immediate) {
 	if (y1)
 		--y1;
 
-	if (mFrameProperties.mbSoftScanlines || mFrameProperties.mbSoftDeinterlace)
-		dstrow += dstpitch * 2 * y1;
-	else
-		dstrow += dstpitch * y1;
-
-	srcrow += srcpitch * y1;
-
 	// In PAL extended mode, we wrap the bottom 16 lines back up to the top, thus
 	// the weird adjustment here.
 	const uint32 vstart = mFrameProperties.mbOverscanPALExtended ? 24 : 8;
 	const uint32 w = mFrameProperties.mbOutputHoriz2x ? 912 : 456;
 
-	for(uint32 row=y1; row<y2; ++row) {
-		uint32 *dst = (uint32 *)dstrow;
-		const uint8 *src = srcrow;
+	// Artifact in horizontal bands from the buffered raw frame, then do the
+	// deinterlacing and scanline interpolation passes on the result.
+	{
+		const char *const dstrow0 = dstrow;
+		const ptrdiff_t rowpitch = mFrameProperties.mbSoftScanlines || mFrameProperties.mbSoftDeinterlace ? dstpitch * 2 : dstpitch;
+		const bool includeHBlank = mFrameProperties.mbIncludeHBlank;
+		const bool *const hiresLines = mbScanlinesWithHiRes;
+		ATArtifactingEngine& ae = *mpArtifactingEngine;
+
+		const auto hasHiRes = [=](uint32 row) {
+			const uint32 relativeRow = row - vstart;
 
-		uint32 relativeRow = row - vstart;
+			return relativeRow < 240 && hiresLines[relativeRow];
+		};
 
-		mpArtifactingEngine->Artifact8(row, dst, src, relativeRow < 240 && mbScanlinesWithHiRes[relativeRow], immediate, mFrameProperties.mbIncludeHBlank);
+		ae.ForEachBand(y1, y2,
+			[=, &ae](uint32 y, ATArtifactingEngine::DelayLine& delayLine) {
+				ae.PrimeDelayLine8(y, srcrow + srcpitch * y, hasHiRes(y), delayLine);
+			},
+			[=, &ae](uint32 band1, uint32 band2, ATArtifactingEngine::DelayLine& delayLine) {
+				for(uint32 row = band1; row < band2; ++row)
+					ae.Artifact8(row, (uint32 *)(dstrow0 + rowpitch * row), srcrow + srcpitch * row, hasHiRes(row), immediate, includeHBlank, delayLine);
+			}
+		);
+	}
+
+	if (!mFrameProperties.mbSoftScanlines && !mFrameProperties.mbSoftDeinterlace)
+		return;
+
+	dstrow += dstpitch * 2 * y1;
+
+	for(uint32 row=y1; row<y2; ++row) {
+		uint32 *dst = (uint32 *)dstrow;
 
 		if (mFrameProperties.mbSoftDeinterlace) {
 			if (row) {
@@ -3379,7 +3557,6 @@ void ATGTIAEmulator::ApplyArtifacting(bool immediate) {
 			dstrow += dstpitch;
 		}
 
-		srcrow += srcpitch;
 		dstrow += dstpitch;
 	}
 
@@ -3796,6 +3973,11 @@ void ATGTIAEmulator::SetFrameProperties() {
 	fp.mbAccelOutputCorrection = !preferSoftFX && rgb32 && outputCorrectionEnabled && !mpVBXE && !(fp.mbSoftBlending && mbBlendLinear);
 	fp.mbAccelPostProcess = fp.mbAccelScanlines || fp.mbAccelOutputCorrection || useAccelPALBlending || useAccelDistortion || useAccelBloom || canAccelXColor;
 
+	// If the display can't do distortion or bloom, fall back to doing them on the CPU
+	// as an emulated screen FX pass. Everything else is already being done by the
+	// soft postprocessing engine or the palette in this case.
+	fp.mbSoftScreenFX = !canAccelFX && (distortionEnabled || bloomEnabled) && g_ATCVDisplaySoftScreenFX;
+
 	fp.mbSoftOutputCorrection = outputCorrectionEnabled && !fp.mbAccelOutputCorrection && rgb32 && !mpVBXE;
 
 	fp.mbPaletteOutputCorrection = outputCorrectionEnabled && !fp.mbSoftOutputCorrection && !fp.mbAccelOutputCorrection;
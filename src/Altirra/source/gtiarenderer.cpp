@@ -16,6 +16,7 @@
 //	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 
 #include <stdafx.h>
+#include <vd2/system/binary.h>
 #include <vd2/system/cpuaccel.h>
 #include <at/atcore/snapshotimpl.h>
 #include "gtiarenderer.h"
@@ -90,7 +91,23 @@ void ATGTIARenderer::ColdReset() {
 	memset(mColorTable, 0, sizeof mColorTable);
 }
 
-void ATGTIARenderer::BeginScanline(uint8 *dst, const uint8 *mergeBuffer, const uint8 *anticBuffer, bool hires) {
+void ATGTIARenderer::BeginScanline(int y, uint8 *dst, const uint8 *mergeBuffer, const uint8 *anticBuffer, bool hires) {
+	mLineCacheY = -1;
+
+	if ((unsigned)y < kLineCacheHeight) {
+		if (mLineCache.empty()) {
+			mLineCache.resize(kLineCacheHeight);
+
+			for(LineCacheEntry& entry : mLineCache) {
+				entry.mbValid = false;
+				entry.mMissCount = 0;
+				entry.mSkipCount = 0;
+			}
+		}
+
+		mLineCacheY = y;
+	}
+
 	mpDst = dst;
 	mbHiresMode = hires;
 	mbGTIAEnableTransition = false;
@@ -111,6 +128,58 @@ void ATGTIARenderer::RenderScanline(int xend, bool pfgraphics, bool pmgraphics,
 	if (x1 >= xend)
 		return;
 
+	// Only a line rendered in one go up to the standard end point can go through
+	// the line cache; lines rendered in pieces for immediate screen updates
+	// are rendered normally. Plain lores lines without P/M graphics take the
+	// fast path, which costs about as much as checking the cache does, so
+	// only hires, GTIA mode and P/M lines are cached. A row that keeps
+	// changing every frame is also left alone for a while, since each miss
+	// costs the key comparison and the store on top of the render.
+	LineCacheEntry *cacheEntry = nullptr;
+	LineCacheState cacheState;
+	bool verifyCachedLine = false;
+
+	if (mLineCacheY >= 0) {
+		const bool cacheable = mbHiresMode || (mPRIOR & 0xC0) || pmgraphics;
+
+		if (cacheable && xend == kLineCacheEndX) {
+			LineCacheEntry& entry = mLineCache[mLineCacheY];
+
+			if (entry.mSkipCount)
+				--entry.mSkipCount;
+			else if (InitLineCacheState(cacheState, xend, pfgraphics, pmgraphics, mixed))
+				cacheEntry = &entry;
+		}
+
+		mLineCacheY = -1;
+	}
+
+	if (cacheEntry && cacheEntry->mbValid
+		&& !memcmp(&cacheEntry->mState, &cacheState, sizeof cacheState)
+		&& !memcmp(cacheEntry->mMergeBuffer, mpMergeBuffer, kLineBufferSize)
+		&& !memcmp(cacheEntry->mAnticBuffer, mpAnticBuffer, kLineBufferSize))
+	{
+		cacheEntry->mMissCount = 0;
+
+		// In analysis mode, render the line anyway and check it against the
+		// cached copy to catch any input missing from the key.
+		if (mpColorTable == kATAnalysisColorTable)
+			verifyCachedLine = true;
+		else {
+			memcpy(mpDst, cacheEntry->mOutput, sizeof cacheEntry->mOutput);
+
+			// advance register state the same way that the render loop would have
+			const int rcStart = mRCIndex;
+			while(mRCIndex < mRCCount && mRegisterChanges[mRCIndex].mPos < xend)
+				++mRCIndex;
+
+			UpdateRegisters(&mRegisterChanges[rcStart], mRCIndex - rcStart);
+
+			mX = xend;
+			return;
+		}
+	}
+
 	// render spans and process register changes
 	do {
 		int x2 = xend;
@@ -210,47 +279,33 @@ void ATGTIARenderer::RenderScanline(int xend, bool pfgraphics, bool pmgraphics,
 		// is that the bit pair patterns 00-11 produce PF0-PF3 instead of BAK + PF0-PF2 as
 		// usual.
 
-		switch(mPRIOR & 0xc0) {
-			case 0x00:
-				if (pmgraphics) {
-					if (mbHiresMode)
-						RenderMode8(x1, x2);
-					else
-						RenderLores(x1, x2);
-				} else {
-					if (mbHiresMode)
-						RenderMode8Fast(x1, x2);
-					else
-						RenderLoresFast(x1, x2);
-				}
-				break;
-
-			case 0x40:
-				if (pmgraphics)
-					RenderMode9(x1, x2);
-				else
-					RenderMode9Fast(x1, x2);
-				break;
-
-			case 0x80:
-				if (pmgraphics || mixed)
-					RenderMode10(x1, x2);
-				else
-					RenderMode10Fast(x1, x2);
-				break;
-
-			case 0xC0:
-				if (pmgraphics || mixed)
-					RenderMode11(x1, x2);
-				else
-					RenderMode11Fast(x1, x2);
-				break;
-		}
+		//
+		// Modes 10 and 11 also need the full renderers for mixed lines, as
+		// playfield data can appear in the merge buffer.
+
+		const bool fullRender = (mPRIOR & 0x80) ? pmgraphics || mixed : pmgraphics;
+
+		(this->*kRenderSpanFns[mPRIOR >> 6][mbHiresMode][fullRender])(x1, x2);
 
 		x1 = x2;
 	} while(x1 < xend);
 
 	mX = x1;
+
+	if (cacheEntry) {
+		VDASSERT(!verifyCachedLine || !memcmp(mpDst, cacheEntry->mOutput, sizeof cacheEntry->mOutput));
+
+		if (!verifyCachedLine && ++cacheEntry->mMissCount >= kLineCacheMaxMisses) {
+			cacheEntry->mMissCount = 0;
+			cacheEntry->mSkipCount = kLineCacheMissSkipFrames;
+		}
+
+		cacheEntry->mbValid = true;
+		cacheEntry->mState = cacheState;
+		memcpy(cacheEntry->mMergeBuffer, mpMergeBuffer, kLineBufferSize);
+		memcpy(cacheEntry->mAnticBuffer, mpAnticBuffer, kLineBufferSize);
+		memcpy(cacheEntry->mOutput, mpDst, sizeof cacheEntry->mOutput);
+	}
 }
 
 uint32 ATGTIARenderer::SenseScanline(int hpx1, int hpx2, const uint8 *weights) const {
@@ -426,6 +481,36 @@ void ATGTIARenderer::LoadState(IATSerializable *ser) {
 	UpdatePriorityTable();
 }
 
+bool ATGTIARenderer::InitLineCacheState(LineCacheState& state, int xend, bool pfgraphics, bool pmgraphics, bool mixed) const {
+	// Register changes at or past the end of the render don't affect the output,
+	// so they are left out of the key.
+	int numChanges = 0;
+	while(mRCIndex + numChanges < mRCCount && mRegisterChanges[mRCIndex + numChanges].mPos < xend)
+		++numChanges;
+
+	if (numChanges > kLineCacheMaxChanges)
+		return false;
+
+	memset(&state, 0, sizeof state);
+	memcpy(state.mColorTable, mColorTable, sizeof state.mColorTable);
+	state.mPRIOR = mPRIOR;
+	state.mFlags = (mbHiresMode ? 0x01 : 0)
+		+ (mbVBlank ? 0x02 : 0)
+		+ (mbSECAMMode ? 0x04 : 0)
+		+ (mpColorTable == kATAnalysisColorTable ? 0x08 : 0)
+		+ (pfgraphics ? 0x10 : 0)
+		+ (pmgraphics ? 0x20 : 0)
+		+ (mixed ? 0x40 : 0)
+		+ (mbGTIATransitionFromHiresMode ? 0x80 : 0);
+	state.mTransition = mbGTIAEnableTransition ? 0x80 + mTransitionPhase : 0;
+	state.mChangeCount = (uint8)numChanges;
+
+	if (numChanges)
+		memcpy(state.mChanges, &mRegisterChanges[mRCIndex], sizeof(RegisterChange) * numChanges);
+
+	return true;
+}
+
 void ATGTIARenderer::UpdateRegisters(const RegisterChange *rc, int count) {
 	while(count--) {
 		// process register change
@@ -1241,6 +1326,115 @@ void ATGTIARenderer::RenderMode11Fast(int x1, int x2) {
 	}
 }
 
+namespace {
+	// Returns true if any of eight pixels from the merge buffer need the
+	// priority logic, i.e. cannot be rendered by the fast renderer for the mode.
+	template<uint8 T_Mode, bool T_Hires>
+	bool ATGTIAPixelsNeedPriority(uint64 v) {
+		if constexpr (T_Mode != 0) {
+			// GTIA modes only see players, missiles and the fifth player (PF3).
+			return (v & 0xF8F8F8F8F8F8F8F8ULL) != 0;
+		} else if constexpr (T_Hires) {
+			// The hires renderer only handles BAK and PF2.
+			return (v & 0xFBFBFBFBFBFBFBFBULL) != 0;
+		} else {
+			// The lores renderer handles single playfield colors, which excludes
+			// PF3 from the fifth player overlapping PF0-PF2.
+			return ((v & 0xF0F0F0F0F0F0F0F0ULL) | ((v >> 3) & (v | (v >> 1) | (v >> 2)) & 0x0101010101010101ULL)) != 0;
+		}
+	}
+}
+
+template<uint8 T_Mode, bool T_Hires>
+void ATGTIARenderer::RenderSpanFast(int x1, int x2) {
+	if constexpr (T_Mode == 0) {
+		if constexpr (T_Hires)
+			RenderMode8Fast(x1, x2);
+		else
+			RenderLoresFast(x1, x2);
+	} else if constexpr (T_Mode == 1)
+		RenderMode9Fast(x1, x2);
+	else if constexpr (T_Mode == 2)
+		RenderMode10Fast(x1, x2);
+	else
+		RenderMode11Fast(x1, x2);
+}
+
+template<uint8 T_Mode, bool T_Hires>
+void ATGTIARenderer::RenderSpanFull(int x1, int x2) {
+	if constexpr (T_Mode == 0) {
+		if constexpr (T_Hires)
+			RenderMode8(x1, x2);
+		else
+			RenderLores(x1, x2);
+	} else if constexpr (T_Mode == 1)
+		RenderMode9(x1, x2);
+	else if constexpr (T_Mode == 2)
+		RenderMode10(x1, x2);
+	else
+		RenderMode11(x1, x2);
+}
+
+template<uint8 T_Mode, bool T_Hires, bool T_PMGraphics>
+void ATGTIARenderer::RenderSpan(int x1, int x2) {
+	if constexpr (!T_PMGraphics) {
+		RenderSpanFast<T_Mode, T_Hires>(x1, x2);
+	} else if constexpr (T_Mode == 2) {
+		// Mode 10 feeds the playfield through the P/M color registers, so every
+		// pixel needs the priority logic.
+		RenderSpanFull<T_Mode, T_Hires>(x1, x2);
+	} else {
+		if (!mbSplitPMSpans) {
+			RenderSpanFull<T_Mode, T_Hires>(x1, x2);
+			return;
+		}
+
+		// Players and missiles usually cover only a small part of a scanline, so
+		// split the span into runs of eight pixels with and without P/M data and
+		// send the runs without through the fast renderer. The last group can
+		// read past the end of the span into the merge buffer padding, which at
+		// worst sends a run through the full renderer unnecessarily.
+		const uint8 *VDRESTRICT src = mpMergeBuffer;
+
+		for(int x = x1; x < x2;) {
+			const bool needsPriority = ATGTIAPixelsNeedPriority<T_Mode, T_Hires>(VDReadUnalignedLEU64(src + x));
+			int xe = x + 8;
+
+			while(xe < x2 && ATGTIAPixelsNeedPriority<T_Mode, T_Hires>(VDReadUnalignedLEU64(src + xe)) == needsPriority)
+				xe += 8;
+
+			if (xe > x2)
+				xe = x2;
+
+			if (needsPriority)
+				RenderSpanFull<T_Mode, T_Hires>(x, xe);
+			else
+				RenderSpanFast<T_Mode, T_Hires>(x, xe);
+
+			x = xe;
+		}
+	}
+}
+
+const ATGTIARenderer::RenderSpanFn ATGTIARenderer::kRenderSpanFns[4][2][2] = {
+	{
+		{ &ATGTIARenderer::RenderSpan<0, false, false>, &ATGTIARenderer::RenderSpan<0, false, true> },
+		{ &ATGTIARenderer::RenderSpan<0, true, false>, &ATGTIARenderer::RenderSpan<0, true, true> },
+	},
+	{
+		{ &ATGTIARenderer::RenderSpan<1, false, false>, &ATGTIARenderer::RenderSpan<1, false, true> },
+		{ &ATGTIARenderer::RenderSpan<1, false, false>, &ATGTIARenderer::RenderSpan<1, false, true> },
+	},
+	{
+		{ &ATGTIARenderer::RenderSpan<2, false, false>, &ATGTIARenderer::RenderSpan<2, false, true> },
+		{ &ATGTIARenderer::RenderSpan<2, false, false>, &ATGTIARenderer::RenderSpan<2, false, true> },
+	},
+	{
+		{ &ATGTIARenderer::RenderSpan<3, false, false>, &ATGTIARenderer::RenderSpan<3, false, true> },
+		{ &ATGTIARenderer::RenderSpan<3, false, false>, &ATGTIARenderer::RenderSpan<3, false, true> },
+	},
+};
+
 void ATGTIARenderer::UpdatePriorityTable() {
 	mpPriTable = mPriorityTables[(mPRIOR & 15) + (mPRIOR & 32 ? 16 : 0)];
 }
@@ -47,6 +47,7 @@ int ATIDERawImage::Release() {
 void *ATIDERawImage::AsInterface(uint32 iid) {
 	switch(iid) {
 		case IATBlockDevice::kTypeID: return static_cast<IATBlockDevice *>(this);
+		case IATBlockDeviceCacheStats::kTypeID: return static_cast<IATBlockDeviceCacheStats *>(this);
 		default:
 			return ATDevice::AsInterface(iid);
 	}
@@ -115,29 +116,52 @@ void ATIDERawImage::Init(const wchar_t *path, bool write, bool solidState, uint3
 		mGeometry.mHeads = heads;
 		mGeometry.mSectorsPerTrack = spt;
 	}
+
+	mCache.Init(mSectorCount,
+		[this](void *data, uint32 lba, uint32 n) { ReadSectorsDirect(data, lba, n); },
+		[this](const void *data, uint32 lba, uint32 n) { WriteSectorsDirect(data, lba, n); },
+		write);
 }
 
 void ATIDERawImage::Shutdown() {
+	mCache.Shutdown();
 	mFile.closeNT();
 }
 
 void ATIDERawImage::Flush() {
+	mCache.Flush();
 }
 
 void ATIDERawImage::ReadSectors(void *data, uint32 lba, uint32 n) {
+	mCache.ReadSectors(data, lba, n);
+}
+
+void ATIDERawImage::WriteSectors(const void *data, uint32 lba, uint32 n) {
+	mCache.WriteSectors(data, lba, n);
+
+	// The file may not have been extended yet, but it will be once the
+	// write lands, so track the size here rather than in the direct path.
+	if (lba + n > mSectorCount) {
+		mSectorCount = lba + n;
+		mCache.SetSectorCount(mSectorCount);
+	}
+}
+
+ATBlockDeviceCacheStats ATIDERawImage::GetCacheStats() const {
+	return mCache.GetStats();
+}
+
+void ATIDERawImage::ReadSectorsDirect(void *data, uint32 lba, uint32 n) {
 	mFile.seek((sint64)lba << 9);
 
 	uint32 requested = n << 9;
 	uint32 actual = mFile.readData(data, requested);
 
-	if (requested < actual)
+	if (actual < requested)
 		memset((char *)data + actual, 0, requested - actual);
 }
 
-void ATIDERawImage::WriteSectors(const void *data, uint32 lba, uint32 n) {
+void ATIDERawImage::WriteSectorsDirect(const void *data, uint32 lba, uint32 n) {
 	mFile.seek((sint64)lba << 9);
 	mFile.write(data, 512 * n);
-
-	if (lba + n > mSectorCount)
-		mSectorCount = lba + n;
 }
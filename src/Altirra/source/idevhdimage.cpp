@@ -169,6 +169,7 @@ void *ATIDEVHDImage::AsInterface(uint32 iid) {
 	switch(iid) {
 		case IATBlockDevice::kTypeID: return static_cast<IATBlockDevice *>(this);
 		case IATBlockDeviceDirectAccess::kTypeID: return static_cast<IATBlockDeviceDirectAccess *>(this);
+		case IATBlockDeviceCacheStats::kTypeID: return static_cast<IATBlockDeviceCacheStats *>(this);
 		default:
 			return ATDevice::AsInterface(iid);
 	}
@@ -619,6 +620,11 @@ void ATIDEVHDImage::InitCommon() {
 	mCurrentBlockDataOffset = 0;
 	mbCurrentBlockBitmapDirty = false;
 	mbCurrentBlockAllocated = false;
+
+	mCache.Init(mSectorCount,
+		[this](void *data, uint32 lba, uint32 n) { ReadSectorsDirect(data, lba, n); },
+		[this](const void *data, uint32 lba, uint32 n) { WriteSectorsDirect(data, lba, n); },
+		!mbReadOnly);
 }
 
 void ATIDEVHDImage::Shutdown() {
@@ -628,14 +634,37 @@ void ATIDEVHDImage::Shutdown() {
 	} catch(const MyError&) {
 	}
 
+	mCache.Shutdown();
 	mFile.closeNT();
 }
 
 void ATIDEVHDImage::Flush() {
+	// The block bitmap is only touched by the direct path, so it is stable
+	// once the cache has drained. If draining fails partway, the blocks that
+	// were allocated before the failure still need their bitmap written.
+	try {
+		mCache.Flush();
+	} catch(...) {
+		FlushCurrentBlockBitmap();
+		throw;
+	}
+
 	FlushCurrentBlockBitmap();
 }
 
 void ATIDEVHDImage::ReadSectors(void *data, uint32 lba, uint32 n) {
+	mCache.ReadSectors(data, lba, n);
+}
+
+void ATIDEVHDImage::WriteSectors(const void *data, uint32 lba, uint32 n) {
+	mCache.WriteSectors(data, lba, n);
+}
+
+ATBlockDeviceCacheStats ATIDEVHDImage::GetCacheStats() const {
+	return mCache.GetStats();
+}
+
+void ATIDEVHDImage::ReadSectorsDirect(void *data, uint32 lba, uint32 n) {
 	if (mFooter.mDiskType == ATVHDFooter::kDiskTypeDynamic || mFooter.mDiskType == ATVHDFooter::kDiskTypeDifferencing) {
 		ReadDynamicDiskSectors(data, lba, n);
 	} else {
@@ -644,12 +673,12 @@ void ATIDEVHDImage::ReadSectors(void *data, uint32 lba, uint32 n) {
 		uint32 requested = n << 9;
 		uint32 actual = mFile.readData(data, requested);
 
-		if (requested < actual)
+		if (actual < requested)
 			memset((char *)data + actual, 0, requested - actual);
 	}
 }
 
-void ATIDEVHDImage::WriteSectors(const void *data, uint32 lba, uint32 n) {
+void ATIDEVHDImage::WriteSectorsDirect(const void *data, uint32 lba, uint32 n) {
 	if (mFooter.mDiskType == ATVHDFooter::kDiskTypeDynamic || mFooter.mDiskType == ATVHDFooter::kDiskTypeDifferencing) {
 		WriteDynamicDiskSectors(data, lba, n);
 	} else {
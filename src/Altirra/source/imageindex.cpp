@@ -0,0 +1,653 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <algorithm>
+#include <vd2/system/binary.h>
+#include <vd2/system/error.h>
+#include <vd2/system/file.h>
+#include <vd2/system/filesys.h>
+#include <vd2/system/text.h>
+#include <vd2/system/threadpool.h>
+#include <vd2/system/vdstl_hashmap.h>
+#include <vd2/system/zip.h>
+#include <at/atcore/vfs.h>
+#include "compatdb.h"
+#include "compatengine.h"
+#include "firmwaredetect.h"
+#include "firmwaremanager.h"
+#include "imageindex.h"
+#include "startuplogger.h"
+
+namespace {
+	constexpr uint32 kATImageIndexMagic = VDMAKEFOURCC('A', 'I', 'D', 'X');
+	constexpr uint32 kATImageIndexVersion = 1;
+
+	// Images larger than this are not indexed; this is well above the
+	// largest cartridge and disk images in practice.
+	constexpr uint64 kATImageIndexMaxFileSize = 256 * 1024 * 1024;
+
+	// Limits on how many zip members are held in memory awaiting a batched
+	// SHA-256 pass.
+	constexpr size_t kATImageIndexMaxPendingHashes = 16;
+	constexpr size_t kATImageIndexMaxPendingHashBytes = 16 * 1024 * 1024;
+
+	class ATImageIndexWriter {
+	public:
+		void Put8(uint8 v) { mBuffer.push_back(v); }
+		void Put32(uint32 v) { v = VDToLE32(v); Put(&v, 4); }
+		void Put64(uint64 v) { v = VDToLE64(v); Put(&v, 8); }
+		void PutString(const VDStringSpanA& s) { Put32((uint32)s.size()); Put(s.data(), s.size()); }
+		void PutString(const VDStringSpanW& s) { PutString(VDTextWToU8(s)); }
+		void Put(const void *p, size_t n) { mBuffer.insert(mBuffer.end(), (const uint8 *)p, (const uint8 *)p + n); }
+
+		vdfastvector<uint8> mBuffer;
+	};
+
+	class ATImageIndexReader {
+	public:
+		ATImageIndexReader(const uint8 *p, size_t n) : mpSrc(p), mpSrcEnd(p + n) {}
+
+		uint8 Get8() { uint8 v; Get(&v, 1); return v; }
+		uint32 Get32() { uint32 v; Get(&v, 4); return VDFromLE32(v); }
+		uint64 Get64() { uint64 v; Get(&v, 8); return VDFromLE64(v); }
+
+		void GetString(VDStringA& s) {
+			const uint32 len = Get32();
+
+			if (len > (size_t)(mpSrcEnd - mpSrc))
+				throw MyError("Image index is corrupted.");
+
+			s.assign((const char *)mpSrc, (const char *)mpSrc + len);
+			mpSrc += len;
+		}
+
+		void GetString(VDStringW& s) {
+			VDStringA s8;
+			GetString(s8);
+			s = VDTextU8ToW(s8);
+		}
+
+		void Get(void *p, size_t n) {
+			if (n > (size_t)(mpSrcEnd - mpSrc))
+				throw MyError("Image index is corrupted.");
+
+			memcpy(p, mpSrc, n);
+			mpSrc += n;
+		}
+
+	private:
+		const uint8 *mpSrc;
+		const uint8 *mpSrcEnd;
+	};
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool ATImageIndexEntry::IsImage() const {
+	return mImageType != kATImageType_None || mFirmwareDetection != ATFirmwareDetection::None;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ATImageIndex::Clear() {
+	mEntries.clear();
+	mPathLookup.clear();
+}
+
+void ATImageIndex::Load(const wchar_t *path) {
+	vdfastvector<uint8> buf;
+
+	{
+		VDFile f(path);
+		sint64 len = f.size();
+
+		if ((uint64)len > 0x7FFFFFFF)
+			throw MyError("Image index is too large.");
+
+		buf.resize((size_t)len);
+		f.read(buf.data(), (long)len);
+	}
+
+	ATImageIndexReader reader(buf.data(), buf.size());
+
+	if (reader.Get32() != kATImageIndexMagic || reader.Get32() != kATImageIndexVersion)
+		throw MyError("Unsupported image index format.");
+
+	const uint32 n = reader.Get32();
+
+	// Every entry takes at least this much; reject bogus counts before
+	// allocating anything.
+	if (n > buf.size() / 64)
+		throw MyError("Image index is corrupted.");
+
+	vdvector<ATImageIndexEntry> entries(n);
+
+	for(ATImageIndexEntry& e : entries) {
+		reader.GetString(e.mPath);
+		e.mHostSize = reader.Get64();
+		e.mHostTimestamp = reader.Get64();
+		e.mSize = reader.Get64();
+		e.mCRC32 = reader.Get32();
+		reader.Get(e.mSHA256.mDigest, sizeof e.mSHA256.mDigest);
+		e.mImageType = (ATImageType)reader.Get8();
+		reader.GetString(e.mFirmwareType);
+		reader.GetString(e.mFirmwareName);
+		e.mSpecificFirmwareType = (ATSpecificFirmwareType)reader.Get32();
+		e.mFirmwareDetection = (ATFirmwareDetection)reader.Get8();
+		reader.GetString(e.mCompatTitle);
+	}
+
+	SetEntries(std::move(entries));
+}
+
+void ATImageIndex::Save(const wchar_t *path) const {
+	ATImageIndexWriter writer;
+
+	writer.Put32(kATImageIndexMagic);
+	writer.Put32(kATImageIndexVersion);
+	writer.Put32((uint32)mEntries.size());
+
+	for(const ATImageIndexEntry& e : mEntries) {
+		writer.PutString(e.mPath);
+		writer.Put64(e.mHostSize);
+		writer.Put64(e.mHostTimestamp);
+		writer.Put64(e.mSize);
+		writer.Put32(e.mCRC32);
+		writer.Put(e.mSHA256.mDigest, sizeof e.mSHA256.mDigest);
+		writer.Put8((uint8)e.mImageType);
+		writer.PutString(e.mFirmwareType);
+		writer.PutString(e.mFirmwareName);
+		writer.Put32((uint32)e.mSpecificFirmwareType);
+		writer.Put8((uint8)e.mFirmwareDetection);
+		writer.PutString(e.mCompatTitle);
+	}
+
+	VDFile f(path, nsVDFile::kWrite | nsVDFile::kDenyAll | nsVDFile::kCreateAlways | nsVDFile::kSequential);
+	f.write(writer.mBuffer.data(), (long)writer.mBuffer.size());
+	f.close();
+}
+
+const ATImageIndexEntry *ATImageIndex::FindByPath(const wchar_t *path) const {
+	auto it = mPathLookup.find(VDStringW(path));
+
+	return it != mPathLookup.end() ? &mEntries[it->second] : nullptr;
+}
+
+const ATImageIndexEntry *ATImageIndex::FindByPath(const wchar_t *path, uint64 hostSize, uint64 hostTimestamp) const {
+	const ATImageIndexEntry *e = FindByPath(path);
+
+	if (e && (e->mHostSize != hostSize || e->mHostTimestamp != hostTimestamp))
+		return nullptr;
+
+	return e;
+}
+
+void ATImageIndex::SetEntries(vdvector<ATImageIndexEntry>&& entries) {
+	mEntries = std::move(entries);
+
+	mPathLookup.clear();
+
+	size_t idx = 0;
+	for(const ATImageIndexEntry& e : mEntries)
+		mPathLookup[e.mPath] = idx++;
+}
+
+VDStringW ATImageIndexGetDefaultPath(const wchar_t *rootPath) {
+	return VDMakePath(rootPath, L"Altirra.idx");
+}
+
+bool ATImageIndexLoadForDirectory(ATImageIndex& index, const wchar_t *rootPath) {
+	const VDStringW& path = ATImageIndexGetDefaultPath(rootPath);
+
+	try {
+		if (VDDoesPathExist(path.c_str())) {
+			index.Load(path.c_str());
+			return true;
+		}
+	} catch(const MyError&) {
+		// an unusable index is the same as no index; callers fall back to
+		// scanning the files themselves
+	}
+
+	index.Clear();
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+namespace {
+	struct ATImageIndexHostFile {
+		VDStringW mPath;
+		uint64 mSize;
+		uint64 mTimestamp;
+		bool mbArchive;
+	};
+
+	bool ATImageIndexIsCandidate(const wchar_t *name, uint64 size) {
+		// Empty files can't be images, so don't bother opening them.
+		if (!size || size > kATImageIndexMaxFileSize)
+			return false;
+
+		if (ATFirmwareAutodetectCheckSize(size))
+			return true;
+
+		return ATGetImageTypeForFileExtension(VDFileSplitExt(name)) != kATImageType_None;
+	}
+
+	void ATImageIndexEnumerate(const VDStringW& dir, vdvector<ATImageIndexHostFile>& files) {
+		VDDirectoryIterator it(VDMakePath(dir.c_str(), L"*.*").c_str());
+
+		while(it.Next()) {
+			if (it.GetAttributes() & (kVDFileAttr_System | kVDFileAttr_Hidden))
+				continue;
+
+			if (it.IsDirectory()) {
+				ATImageIndexEnumerate(it.GetFullPath(), files);
+				continue;
+			}
+
+			const uint64 size = (uint64)it.GetSize();
+			const wchar_t *name = it.GetName();
+			const bool isArchive = !vdwcsicmp(VDFileSplitExt(name), L".zip");
+
+			if (!isArchive && !ATImageIndexIsCandidate(name, size))
+				continue;
+
+			ATImageIndexHostFile& hf = files.push_back();
+			hf.mPath = it.GetFullPath();
+			hf.mSize = size;
+			hf.mTimestamp = it.GetLastWriteDate().mTicks;
+			hf.mbArchive = isArchive;
+		}
+	}
+
+	// Get the contents of an image, using the in-memory view when the VFS has
+	// one (mapped file or decompressed zip member) to avoid copying the image.
+	// Returns false if the image is too big to index.
+	bool ATImageIndexGetData(ATVFSFileView& view, vdfastvector<uint8>& buf, vdspan<const uint8>& data) {
+		if (view.HasMemoryView()) {
+			data = view.GetMemoryView();
+			return data.size() <= kATImageIndexMaxFileSize;
+		}
+
+		IVDRandomAccessStream& stream = view.GetStream();
+		const sint64 len = stream.Length();
+
+		if ((uint64)len > kATImageIndexMaxFileSize)
+			return false;
+
+		buf.resize((size_t)len);
+		stream.Seek(0);
+		stream.Read(buf.data(), (sint32)len);
+		data = vdspan<const uint8>(buf.data(), buf.data() + buf.size());
+		return true;
+	}
+
+	// Identify a single image from its contents. The CRC is passed in when
+	// already known, as it is for zip members. The SHA-256 is left to the
+	// caller so that it can be batched. Compressed contents are not looked
+	// into and are reported through isCompressed.
+	bool ATImageIndexIdentify(ATImageIndexEntry& e, ATVFSFileView& view, vdspan<const uint8> data, const wchar_t *name, const uint32 *knownCRC, bool& isCompressed) {
+		e.mSize = data.size();
+		e.mCRC32 = knownCRC ? *knownCRC : VDCRCTable::CRC32.CRC(data.data(), data.size());
+
+		IVDRandomAccessStream& stream = view.GetStream();
+		stream.Seek(0);
+		e.mImageType = ATDetectImageType(name, stream);
+		isCompressed = false;
+
+		switch(e.mImageType) {
+			case kATImageType_Zip:
+			case kATImageType_GZip:
+				e.mImageType = kATImageType_None;
+				isCompressed = true;
+				break;
+
+			default:
+				break;
+		}
+
+		ATFirmwareInfo fwInfo;
+		ATSpecificFirmwareType specificType;
+		e.mFirmwareDetection = ATFirmwareAutodetect(data.data(), (uint32)data.size(), fwInfo, specificType);
+
+		if (e.mFirmwareDetection != ATFirmwareDetection::None) {
+			e.mFirmwareType = ATGetFirmwareTypeName(fwInfo.mType);
+			e.mSpecificFirmwareType = specificType;
+
+			if (e.mFirmwareDetection == ATFirmwareDetection::SpecificImage)
+				e.mFirmwareName = fwInfo.mName;
+		}
+
+		return e.mImageType != kATImageType_None || e.mFirmwareDetection != ATFirmwareDetection::None;
+	}
+
+	// Zip member identified as an image whose SHA-256 has not been computed
+	// yet. The view is held to keep the decompressed data alive.
+	struct ATImageIndexPendingHash {
+		vdrefptr<ATVFSFileView> mpView;
+		vdfastvector<uint8> mBuffer;
+		size_t mEntryIndex;
+
+		vdspan<const uint8> GetData() const {
+			if (mpView->HasMemoryView())
+				return mpView->GetMemoryView();
+
+			return vdspan<const uint8>(mBuffer.data(), mBuffer.data() + mBuffer.size());
+		}
+	};
+
+	void ATImageIndexFlushHashes(vdvector<ATImageIndexPendingHash>& pending, vdvector<ATImageIndexEntry>& entries) {
+		const size_t n = pending.size();
+		if (!n)
+			return;
+
+		vdfastvector<const void *> srcs(n);
+		vdfastvector<size_t> lens(n);
+		vdfastvector<ATChecksumSHA256> digests(n);
+
+		for(size_t i = 0; i < n; ++i) {
+			const vdspan<const uint8> data = pending[i].GetData();
+
+			srcs[i] = data.data();
+			lens[i] = data.size();
+		}
+
+		ATComputeChecksumsSHA256(digests.data(), srcs.data(), lens.data(), n);
+
+		for(size_t i = 0; i < n; ++i)
+			entries[pending[i].mEntryIndex].mSHA256 = digests[i];
+
+		pending.clear();
+	}
+
+	// Scan a host file for images. Returns false if the file has contents
+	// that may be an image but couldn't be indexed.
+	bool ATImageIndexScanHostFileImages(const ATImageIndexHostFile& hf, vdvector<ATImageIndexEntry>& entries) {
+		vdrefptr<ATVFSFileView> view;
+		ATVFSOpenFileView(hf.mPath.c_str(), false, ~view);
+
+		if (!hf.mbArchive) {
+			ATImageIndexEntry e;
+			vdfastvector<uint8> buf;
+			vdspan<const uint8> data;
+			bool isCompressed = false;
+
+			if (!ATImageIndexGetData(*view, buf, data))
+				return false;
+
+			if (ATImageIndexIdentify(e, *view, data, hf.mPath.c_str(), nullptr, isCompressed)) {
+				e.mSHA256 = ATComputeChecksumSHA256(data.data(), data.size());
+				e.mPath = hf.mPath;
+				entries.push_back(std::move(e));
+			}
+
+			return !isCompressed;
+		}
+
+		vdrefptr<IATVFSZipArchive> zip = ATVFSOpenZipArchiveFromView(*view);
+		VDZipArchive& za = zip->GetZipArchive();
+		const sint32 n = za.GetFileCount();
+
+		// Members of an archive are typically many small images of similar
+		// size, so their SHA-256s are computed a group at a time to use the
+		// multi-buffer path.
+		vdvector<ATImageIndexPendingHash> pending;
+		size_t pendingBytes = 0;
+		bool complete = true;
+
+		for(sint32 i = 0; i < n; ++i) {
+			const VDZipArchive::FileInfo& fi = za.GetFileInfo(i);
+
+			if (!fi.mbSupported)
+				continue;
+
+			const wchar_t *name = fi.mDecodedFileName.c_str();
+			if (!ATImageIndexIsCandidate(name, fi.mUncompressedSize))
+				continue;
+
+			// Nested archives are not followed; images are indexed one level
+			// deep, which is also all that the image loader will browse.
+			if (!vdwcsicmp(VDFileSplitExt(name), L".zip"))
+				continue;
+
+			try {
+				vdrefptr<ATVFSFileView> memberView = zip->OpenStream(i);
+
+				ATImageIndexPendingHash ph;
+				vdspan<const uint8> data;
+				if (!ATImageIndexGetData(*memberView, ph.mBuffer, data))
+					continue;
+
+				ATImageIndexEntry e;
+				bool isCompressed;
+				if (ATImageIndexIdentify(e, *memberView, data, name, &fi.mCRC32, isCompressed)) {
+					e.mPath = ATMakeVFSPathForZipFile(hf.mPath.c_str(), name);
+
+					ph.mpView = std::move(memberView);
+					ph.mEntryIndex = entries.size();
+					entries.push_back(std::move(e));
+
+					pendingBytes += data.size();
+					pending.push_back(std::move(ph));
+
+					if (pending.size() >= kATImageIndexMaxPendingHashes || pendingBytes >= kATImageIndexMaxPendingHashBytes) {
+						ATImageIndexFlushHashes(pending, entries);
+						pendingBytes = 0;
+					}
+				} else if (isCompressed)
+					complete = false;
+			} catch(const MyError&) {
+				// skip damaged members but keep the rest of the archive
+				complete = false;
+			}
+		}
+
+		ATImageIndexFlushHashes(pending, entries);
+		return complete;
+	}
+
+	void ATImageIndexScanHostFile(const ATImageIndexHostFile& hf, vdvector<ATImageIndexEntry>& entries) {
+		// Record a file with nothing in it worth indexing as well, so that it
+		// can be skipped until it changes.
+		if (ATImageIndexScanHostFileImages(hf, entries) && entries.empty())
+			entries.push_back().mPath = hf.mPath;
+	}
+
+	bool ATImageIndexGetCompatRuleType(ATImageType type, ATCompatRuleType& ruleType) {
+		switch(type) {
+			case kATImageType_Cartridge:	ruleType = kATCompatRuleType_CartFileSHA256; return true;
+			case kATImageType_Disk:			ruleType = kATCompatRuleType_DiskFileSHA256; return true;
+			case kATImageType_Program:		ruleType = kATCompatRuleType_ExeFileSHA256; return true;
+			case kATImageType_Tape:			ruleType = kATCompatRuleType_TapeFileSHA256; return true;
+			default:						return false;
+		}
+	}
+}
+
+ATImageIndexUpdateStats ATImageIndexUpdate(
+	ATImageIndex& index,
+	const wchar_t *rootPath,
+	VDThreadPool& pool,
+	const vdfunction<void(uint32, uint32)>& progressFn)
+{
+	ATImageIndexUpdateStats stats;
+
+	vdvector<ATImageIndexHostFile> hostFiles;
+	ATImageIndexEnumerate(VDStringW(rootPath), hostFiles);
+
+	const uint32 n = (uint32)hostFiles.size();
+	stats.mFilesScanned = n;
+
+	// Group the existing entries by host file so unchanged files can be
+	// carried over without reopening them.
+	vdhashmap<VDStringW, vdfastvector<size_t>> prevByHost;
+	{
+		VDStringW hostPath;
+		const size_t prevCount = index.GetCount();
+
+		for(size_t i = 0; i < prevCount; ++i) {
+			if (ATVFSExtractFilePath(index.GetEntry(i).mPath.c_str(), &hostPath))
+				prevByHost[hostPath].push_back(i);
+		}
+	}
+
+	vdvector<vdvector<ATImageIndexEntry>> results(n);
+	vdfastvector<uint32> filesToScan;
+
+	for(uint32 i = 0; i < n; ++i) {
+		const ATImageIndexHostFile& hf = hostFiles[i];
+		auto it = prevByHost.find(hf.mPath);
+
+		if (it != prevByHost.end()) {
+			const ATImageIndexEntry& first = index.GetEntry(it->second.front());
+
+			if (first.mHostSize == hf.mSize && first.mHostTimestamp == hf.mTimestamp) {
+				for(size_t prevIdx : it->second)
+					results[i].push_back(index.GetEntry(prevIdx));
+
+				++stats.mFilesReused;
+				continue;
+			}
+		}
+
+		filesToScan.push_back(i);
+	}
+
+	// Scan in batches so that progress can be reported from this thread
+	// without needing the callback to be thread-safe.
+	const uint32 numToScan = (uint32)filesToScan.size();
+	const uint32 batchSize = std::max<uint32>(64, pool.GetThreadCount() * 16);
+	VDAtomicInt errors = 0;
+
+	for(uint32 batchStart = 0; batchStart < numToScan; batchStart += batchSize) {
+		if (progressFn)
+			progressFn(batchStart, numToScan);
+
+		const uint32 batchCount = std::min<uint32>(batchSize, numToScan - batchStart);
+
+		pool.ParallelFor(batchCount,
+			[&](uint32 j) {
+				const uint32 i = filesToScan[batchStart + j];
+				const ATImageIndexHostFile& hf = hostFiles[i];
+				vdvector<ATImageIndexEntry>& entries = results[i];
+
+				try {
+					ATImageIndexScanHostFile(hf, entries);
+				} catch(const MyError&) {
+					entries.clear();
+					++errors;
+				}
+
+				for(ATImageIndexEntry& e : entries) {
+					e.mHostSize = hf.mSize;
+					e.mHostTimestamp = hf.mTimestamp;
+				}
+			}
+		);
+	}
+
+	if (progressFn)
+		progressFn(numToScan, numToScan);
+
+	stats.mErrors = (uint32)errors;
+
+	vdvector<ATImageIndexEntry> entries;
+	for(vdvector<ATImageIndexEntry>& v : results) {
+		for(ATImageIndexEntry& e : v)
+			entries.push_back(std::move(e));
+	}
+
+	// Compat lookups go through the shared database view, so resolve them
+	// here on the calling thread. This is cheap compared to hashing.
+	vdfastvector<ATCompatKnownTag> tags;
+	for(ATImageIndexEntry& e : entries) {
+		ATCompatRuleType ruleType;
+
+		e.mCompatTitle.clear();
+
+		if (!ATImageIndexGetCompatRuleType(e.mImageType, ruleType))
+			continue;
+
+		const ATCompatMarker marker = ATCompatMarker::FromSHA256(ruleType, e.mSHA256);
+		const ATCompatDBTitle *title = ATCompatFindTitle(vdvector_view<const ATCompatMarker>(&marker, 1), tags, false);
+
+		if (title)
+			e.mCompatTitle = title->mName.c_str();
+	}
+
+	stats.mEntriesIndexed = (uint32)std::count_if(entries.begin(), entries.end(),
+		[](const ATImageIndexEntry& e) { return e.IsImage(); });
+
+	index.SetEntries(std::move(entries));
+	return stats;
+}
+
+namespace {
+	// Altirra is a GUI application and has no console of its own, so write
+	// to the console of the parent process if there is one. Output is
+	// silently dropped if the command wasn't run from a console.
+	void ATImageIndexPrint(const wchar_t *format, ...) {
+		static bool sbAttached = false;
+
+		if (!sbAttached) {
+			sbAttached = true;
+			ATStartupAttachConsole();
+		}
+
+		VDStringW s;
+		va_list val;
+		va_start(val, format);
+		s.append_vsprintf(format, val);
+		va_end(val);
+		s += L"\r\n";
+
+		ATStartupWriteConsole(VDTextWToU8(s));
+	}
+}
+
+int ATImageIndexRunCommand(const wchar_t *rootPath, const wchar_t *indexPath) {
+	ATImageIndex index;
+
+	try {
+		if (VDDoesPathExist(indexPath))
+			index.Load(indexPath);
+	} catch(const MyError& e) {
+		// rebuild from scratch if the old index is unusable
+		ATImageIndexPrint(L"Warning: Unable to load existing index, rebuilding: %ls", e.wc_str());
+		index.Clear();
+	}
+
+	try {
+		VDThreadPool pool;
+		pool.Start();
+
+		const ATImageIndexUpdateStats stats = ATImageIndexUpdate(index, rootPath, pool, nullptr);
+
+		pool.Shutdown();
+
+		index.Save(indexPath);
+
+		ATImageIndexPrint(L"Indexed %u images from %u files (%u unchanged, %u errors) into: %ls",
+			stats.mEntriesIndexed, stats.mFilesScanned, stats.mFilesReused, stats.mErrors, indexPath);
+	} catch(const MyError& e) {
+		ATImageIndexPrint(L"Error: %ls", e.wc_str());
+		return 10;
+	}
+
+	return 0;
+}
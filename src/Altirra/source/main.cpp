@@ -133,6 +133,7 @@
 #include "directorywatcher.h"
 
 #include "firmwaremanager.h"
+#include "imageindex.h"
 #include "devicemanager.h"
 #include "startuplogger.h"
 
@@ -2118,6 +2119,7 @@ void OnCommandQuickSaveState() {
 
 	try {
 		vdrefptr<IATSerializable> quickStateInfo;
+		g_sim.FlushBlockDevices();
 		g_sim.CreateSnapshot(~g_pATQuickState, ~quickStateInfo);
 	} catch(const MyError& e) {
 		e.post(g_hwnd, "Altirra Error");
@@ -2843,6 +2845,10 @@ void OnCommandRecordVideo() {
 		case kATVideoEncoding_H264_MP3:
 			s = VDGetSaveFileName('rvid', (VDGUIHandle)g_hwnd, L"Record raw video", L"MPEG-4/AVC (*.mp4)\0*.mp4\0", L"mp4");
 			break;
+
+		case kATVideoEncoding_PNGSequence:
+			s = VDGetSaveFileName('rvid', (VDGUIHandle)g_hwnd, L"Record raw video", L"PNG image sequence (*.png)\0*.png\0", L"png");
+			break;
 	}
 
 	if (s.empty())
@@ -4737,6 +4743,22 @@ int CALLBACK WinMain(HINSTANCE, HINSTANCE, LPSTR, int nCmdShow) {
 			if (g_ATCmdLine.FindAndRemoveSwitch(L"advconfig")) {
 				extern void ATUIShowDialogAdvancedConfiguration(VDGUIHandle h);
 				ATUIShowDialogAdvancedConfiguration(nullptr);
+			} else if (g_ATCmdLine.FindAndRemoveSwitch(L"buildindex", token)) {
+				const VDStringW rootPath(token);
+				VDStringW indexPath;
+
+				if (g_ATCmdLine.FindAndRemoveSwitch(L"indexfile", token))
+					indexPath = token;
+				else
+					indexPath = ATImageIndexGetDefaultPath(rootPath.c_str());
+
+				ATLoadConfigVars();
+				ATOptionsLoad();
+				ATCompatInit();
+
+				rval = ATImageIndexRunCommand(rootPath.c_str(), indexPath.c_str());
+
+				ATCompatShutdown();
 			} else {
 				ATStartupLog("Loading config var overrides");
 				ATLoadConfigVars();
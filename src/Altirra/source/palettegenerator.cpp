@@ -23,17 +23,10 @@
 
 extern ATConfigVarRGBColor g_ATCVDisplayMonoColorWhite;
 
-void ATColorPaletteGenerator::Generate(const ATColorParams& params, ATMonitorMode monitorMode) {
-	using namespace nsVDVecMath;
-
+void ATColorPaletteGenerator::ComputeColorSetup(const ATColorParams& params, ColorSetup& setup) {
 	const bool palQuirks = params.mbUsePALQuirks;
 	float angle = params.mHueStart * (nsVDMath::kfTwoPi / 360.0f);
 	float angleStep = params.mHueRange * (nsVDMath::kfTwoPi / (360.0f * 15.0f));
-	float gamma = 1.0f / params.mGammaCorrect;
-
-	float lumaRamp[16];
-
-	ATComputeLumaRamp(params.mLumaRampMode, lumaRamp);
 
 	// I/Q -> RGB coefficients
 	//
@@ -100,41 +93,85 @@ void ATColorPaletteGenerator::Generate(const ATColorParams& params, ATMonitorMod
 		{  0.0134474f, -0.1183897f,  1.0154096f },
 	}.transpose();
 
-	vdfloat3x3 mx;
-	bool useMatrix = false;
 	const vdfloat3x3 *toMat = nullptr;
 
-	mOutputGamma = 0;
+	setup.mOutputGamma = 0;
 
 	switch(params.mColorMatchingMode) {
 		case ATColorMatchingMode::SRGB:
-			mOutputGamma = 0;
+			setup.mOutputGamma = 0;
 			toMat = &tosRGB;
 			break;
 
 		case ATColorMatchingMode::Gamma22:
 			toMat = &tosRGB;
-			mOutputGamma = 2.2f;
+			setup.mOutputGamma = 2.2f;
 			break;
 
 		case ATColorMatchingMode::Gamma24:
 			toMat = &tosRGB;
-			mOutputGamma = 2.4f;
+			setup.mOutputGamma = 2.4f;
 			break;
 
 		case ATColorMatchingMode::AdobeRGB:
 			toMat = &toAdobeRGB;
-			mOutputGamma = 2.2f;
+			setup.mOutputGamma = 2.2f;
 			break;
 	}
 
 	if (toMat) {
 		const vdfloat3x3 *fromMat = palQuirks ? &fromPAL : &fromNTSC;
 
-		mx = (*fromMat) * (*toMat);
+		setup.mColorMatchingMatrix = (*fromMat) * (*toMat);
+	} else
+		setup.mColorMatchingMatrix.reset();
 
-		useMatrix = true;
+	for(int hue=0; hue<16; ++hue) {
+		float i = 0;
+		float q = 0;
+
+		if (hue) {
+			if (palQuirks) {
+				const ATPALPhaseInfo& palPhaseInfo = kATPALPhaseLookup[hue - 1];
+
+				float angle2 = angle + angleStep * palPhaseInfo.mEvenPhase;
+				float angle3 = angle + angleStep * palPhaseInfo.mOddPhase;
+
+				float i2 = cosf(angle2) * palPhaseInfo.mEvenInvert;
+				float q2 = sinf(angle2) * palPhaseInfo.mEvenInvert;
+				float i3 = cosf(angle3) * palPhaseInfo.mOddInvert;
+				float q3 = sinf(angle3) * palPhaseInfo.mOddInvert;
+
+				i = (i2 + i3) * (0.5f * params.mSaturation);
+				q = (q2 + q3) * (0.5f * params.mSaturation);
+			} else {
+				i = params.mSaturation * cos(angle);
+				q = params.mSaturation * sin(angle);
+				angle += angleStep;
+			}
+		}
+
+		const vdfloat2 iq { i, q };
+		setup.mChroma[hue] = vdfloat3 { nsVDMath::dot(iq, co_r), nsVDMath::dot(iq, co_g), nsVDMath::dot(iq, co_b) };
 	}
+}
+
+void ATColorPaletteGenerator::Generate(const ATColorParams& params, ATMonitorMode monitorMode) {
+	using namespace nsVDVecMath;
+
+	float gamma = 1.0f / params.mGammaCorrect;
+
+	float lumaRamp[16];
+
+	ATComputeLumaRamp(params.mLumaRampMode, lumaRamp);
+
+	ColorSetup setup;
+	ComputeColorSetup(params, setup);
+
+	bool useMatrix = setup.mColorMatchingMatrix.has_value();
+	const vdfloat3x3 mx = setup.mColorMatchingMatrix.value_or(vdfloat3x3::identity());
+
+	mOutputGamma = setup.mOutputGamma;
 
 	const float nativeGamma = 2.2f;
 
@@ -209,36 +246,8 @@ void ATColorPaletteGenerator::Generate(const ATColorParams& params, ATMonitorMod
 		uint32 *dstu = mUncorrectedPalette;
 
 		for(int hue=0; hue<16; ++hue) {
-			float i = 0;
-			float q = 0;
-
-			if (hue) {
-				if (palQuirks) {
-					const ATPALPhaseInfo& palPhaseInfo = kATPALPhaseLookup[hue - 1];
-
-					float angle2 = angle + angleStep * palPhaseInfo.mEvenPhase;
-					float angle3 = angle + angleStep * palPhaseInfo.mOddPhase;
-
-					float i2 = cosf(angle2) * palPhaseInfo.mEvenInvert;
-					float q2 = sinf(angle2) * palPhaseInfo.mEvenInvert;
-					float i3 = cosf(angle3) * palPhaseInfo.mOddInvert;
-					float q3 = sinf(angle3) * palPhaseInfo.mOddInvert;
-
-					i = (i2 + i3) * (0.5f * params.mSaturation);
-					q = (q2 + q3) * (0.5f * params.mSaturation);
-				} else {
-					i = params.mSaturation * cos(angle);
-					q = params.mSaturation * sin(angle);
-					angle += angleStep;
-				}
-			}
-
-			const vdfloat2 iq { i, q };
-			float cr = nsVDMath::dot(iq, co_r);
-			float cg = nsVDMath::dot(iq, co_g);
-			float cb = nsVDMath::dot(iq, co_b);
-
-			vdfloat32x3 chroma = vdfloat32x3::set(cr, cg, cb);
+			const vdfloat3& c = setup.mChroma[hue];
+			vdfloat32x3 chroma = vdfloat32x3::set(c.x, c.y, c.z);
 			vdfloat32x3x3 colorCorrectionMatrix = loadu(mx);
 
 			for(int luma=0; luma<16; ++luma) {
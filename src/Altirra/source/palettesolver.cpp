@@ -16,12 +16,229 @@
 
 #include <stdafx.h>
 #include <vd2/system/color.h>
+#include <vd2/system/vdalloc.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/threadpool.h>
 #include "palettesolver.h"
 #include "palettegenerator.h"
 #include "gtia.h"
+#include "gtiatables.h"
+
+namespace {
+	// Vectorized pow() for non-negative inputs, as exp2(y*log2(x)). Relative
+	// error is under 3e-6 over the range that the palette pipeline uses, which
+	// is far below the 8-bit quantization that the score is computed on.
+#if (defined(VD_CPU_X86) && _M_IX86_FP >= 2) || defined(VD_CPU_X64)
+	vdfloat32x4 ATPaletteSolverPow(vdfloat32x4 x, float y) {
+		// split into exponent and mantissa in [sqrt(0.5), sqrt(2))
+		const __m128i bits = _mm_castps_si128(x.v);
+		const __m128i e = _mm_srai_epi32(_mm_sub_epi32(bits, _mm_set1_epi32(0x3F3504F3)), 23);
+		const __m128 m = _mm_castsi128_ps(_mm_sub_epi32(bits, _mm_slli_epi32(e, 23)));
+
+		// log2(m) = 2/ln(2) * atanh(t), t = (m-1)/(m+1)
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 t = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+		const __m128 t2 = _mm_mul_ps(t, t);
+		__m128 p = _mm_add_ps(_mm_mul_ps(t2, _mm_set1_ps(1.0f / 7.0f)), _mm_set1_ps(1.0f / 5.0f));
+		p = _mm_add_ps(_mm_mul_ps(p, t2), _mm_set1_ps(1.0f / 3.0f));
+		p = _mm_add_ps(_mm_mul_ps(p, t2), one);
+
+		const __m128 lg = _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(_mm_mul_ps(p, t), _mm_set1_ps(2.8853900817779268f)));
+
+		// exp2(z) = 2^n * e^(f*ln(2)), z = n + f, |f| <= 0.5
+		const __m128 z = _mm_min_ps(_mm_max_ps(_mm_mul_ps(lg, _mm_set1_ps(y)), _mm_set1_ps(-126.0f)), _mm_set1_ps(126.0f));
+		const __m128i n = _mm_cvtps_epi32(z);
+		const __m128 g = _mm_mul_ps(_mm_sub_ps(z, _mm_cvtepi32_ps(n)), _mm_set1_ps(0.69314718055994531f));
+
+		__m128 q = _mm_add_ps(_mm_mul_ps(g, _mm_set1_ps(1.0f / 720.0f)), _mm_set1_ps(1.0f / 120.0f));
+		q = _mm_add_ps(_mm_mul_ps(q, g), _mm_set1_ps(1.0f / 24.0f));
+		q = _mm_add_ps(_mm_mul_ps(q, g), _mm_set1_ps(1.0f / 6.0f));
+		q = _mm_add_ps(_mm_mul_ps(q, g), _mm_set1_ps(0.5f));
+		q = _mm_add_ps(_mm_mul_ps(q, g), one);
+		q = _mm_add_ps(_mm_mul_ps(q, g), one);
+
+		return vdfloat32x4 { _mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(q), _mm_slli_epi32(n, 23))) };
+	}
+#elif defined(VD_CPU_ARM64)
+	vdfloat32x4 ATPaletteSolverPow(vdfloat32x4 x, float y) {
+		// split into exponent and mantissa in [sqrt(0.5), sqrt(2))
+		const int32x4_t bits = vreinterpretq_s32_f32(x.v);
+		const int32x4_t e = vshrq_n_s32(vsubq_s32(bits, vdupq_n_s32(0x3F3504F3)), 23);
+		const float32x4_t m = vreinterpretq_f32_s32(vsubq_s32(bits, vshlq_n_s32(e, 23)));
+
+		// log2(m) = 2/ln(2) * atanh(t), t = (m-1)/(m+1)
+		const float32x4_t one = vdupq_n_f32(1.0f);
+		const float32x4_t t = vdivq_f32(vsubq_f32(m, one), vaddq_f32(m, one));
+		const float32x4_t t2 = vmulq_f32(t, t);
+		float32x4_t p = vfmaq_f32(vdupq_n_f32(1.0f / 5.0f), t2, vdupq_n_f32(1.0f / 7.0f));
+		p = vfmaq_f32(vdupq_n_f32(1.0f / 3.0f), p, t2);
+		p = vfmaq_f32(one, p, t2);
+
+		const float32x4_t lg = vfmaq_f32(vcvtq_f32_s32(e), vmulq_f32(p, t), vdupq_n_f32(2.8853900817779268f));
+
+		// exp2(z) = 2^n * e^(f*ln(2)), z = n + f, |f| <= 0.5
+		const float32x4_t z = vminq_f32(vmaxq_f32(vmulq_n_f32(lg, y), vdupq_n_f32(-126.0f)), vdupq_n_f32(126.0f));
+		const int32x4_t n = vcvtnq_s32_f32(z);
+		const float32x4_t g = vmulq_n_f32(vsubq_f32(z, vcvtq_f32_s32(n)), 0.69314718055994531f);
+
+		float32x4_t q = vfmaq_f32(vdupq_n_f32(1.0f / 120.0f), g, vdupq_n_f32(1.0f / 720.0f));
+		q = vfmaq_f32(vdupq_n_f32(1.0f / 24.0f), q, g);
+		q = vfmaq_f32(vdupq_n_f32(1.0f / 6.0f), q, g);
+		q = vfmaq_f32(vdupq_n_f32(0.5f), q, g);
+		q = vfmaq_f32(one, q, g);
+		q = vfmaq_f32(one, q, g);
+
+		return vdfloat32x4 { vreinterpretq_f32_s32(vaddq_s32(vreinterpretq_s32_f32(q), vshlq_n_s32(n, 23))) };
+	}
+#else
+	vdfloat32x4 ATPaletteSolverPow(vdfloat32x4 x, float y) {
+		return nsVDVecMath::pow(x, y);
+	}
+#endif
+
+	// Target palette in planar form, four entries per vector, and the scoring
+	// function against it. The reference version uses exact pow() and only
+	// exists for testing the approximation.
+	struct ATPaletteSolverTarget {
+		void Init(const uint32 palette[256]);
+
+		template<bool T_Reference>
+		uint32 ComputeScore(const ATColorParams& params) const;
+
+		vdfloat32x4 mR[64];
+		vdfloat32x4 mG[64];
+		vdfloat32x4 mB[64];
+	};
+
+	void ATPaletteSolverTarget::Init(const uint32 palette[256]) {
+		for(int i=0; i<64; ++i) {
+			const uint32 *src = &palette[i*4];
+
+			mR[i] = vdfloat32x4::set((float)((src[0] >> 16) & 0xFF), (float)((src[1] >> 16) & 0xFF), (float)((src[2] >> 16) & 0xFF), (float)((src[3] >> 16) & 0xFF));
+			mG[i] = vdfloat32x4::set((float)((src[0] >>  8) & 0xFF), (float)((src[1] >>  8) & 0xFF), (float)((src[2] >>  8) & 0xFF), (float)((src[3] >>  8) & 0xFF));
+			mB[i] = vdfloat32x4::set((float)((src[0] >>  0) & 0xFF), (float)((src[1] >>  0) & 0xFF), (float)((src[2] >>  0) & 0xFF), (float)((src[3] >>  0) & 0xFF));
+		}
+	}
+
+	template<bool T_Reference>
+	uint32 ATPaletteSolverTarget::ComputeScore(const ATColorParams& params) const {
+		using namespace nsVDVecMath;
+
+		const auto powv = [](vdfloat32x4 x, float y) {
+			if constexpr (T_Reference)
+				return nsVDVecMath::pow(x, y);
+			else
+				return ATPaletteSolverPow(x, y);
+		};
+
+		// This follows ATColorPaletteGenerator::Generate() for the color monitor
+		// mode, but only computes the final palette, with each hue processed as
+		// four vectors of four luma levels in planar RGB. Errors are accumulated
+		// in float per hue, which is exact as all terms are integers well below
+		// 2^24.
+		ATColorPaletteGenerator::ColorSetup setup;
+		ATColorPaletteGenerator::ComputeColorSetup(params, setup);
+
+		float lumaRamp[16];
+		ATComputeLumaRamp(params.mLumaRampMode, lumaRamp);
+
+		vdfloat32x4 luma[4];
+		for(int i=0; i<4; ++i)
+			luma[i] = params.mContrast * vdfloat32x4::set(lumaRamp[i*4+0], lumaRamp[i*4+1], lumaRamp[i*4+2], lumaRamp[i*4+3]) + params.mBrightness;
+
+		const bool useMatrix = setup.mColorMatchingMatrix.has_value();
+		const vdfloat3x3 mx = setup.mColorMatchingMatrix.value_or(vdfloat3x3::identity());
+		const float gamma = 1.0f / params.mGammaCorrect;
+		const float outputScale = params.mIntensityScale * 255.0f;
+		const float nativeGamma = 2.2f;
+
+		// luma 0 of each hue is excluded from the error
+		const vdfloat32x4 firstWeight = vdfloat32x4::set(0.0f, 1.0f, 1.0f, 1.0f);
+
+		const auto encode = [&](vdfloat32x4 v) {
+			switch(params.mColorMatchingMode) {
+				case ATColorMatchingMode::AdobeRGB:
+				case ATColorMatchingMode::Gamma22:
+					return powv(max0(v), 1.0f / 2.2f);
+
+				case ATColorMatchingMode::Gamma24:
+					return powv(max0(v), 1.0f / 2.4f);
+
+				case ATColorMatchingMode::SRGB:
+				default:
+					return select(cmplt(v, vdfloat32x4::set1(0.0031308f)), v * 12.92f, 1.055f * powv(max0(v), 1.0f / 2.4f) - 0.055f);
+			}
+		};
+
+		const auto quantize = [&](vdfloat32x4 v) {
+			v = min(max0(powv(max0(v), gamma) * outputScale), vdfloat32x4::set1(255.0f));
+
+			// round to nearest even, same as the 8-bit packing in the generator
+			return (v + 12582912.0f) - 12582912.0f;
+		};
+
+		uint32 error = 0;
+
+		for(int hue=0; hue<16; ++hue) {
+			const vdfloat3& chroma = setup.mChroma[hue];
+			vdfloat32x4 hueError = vdfloat32x4::zero();
+
+			for(int i=0; i<4; ++i) {
+				vdfloat32x4 r = luma[i] + chroma.x;
+				vdfloat32x4 g = luma[i] + chroma.y;
+				vdfloat32x4 b = luma[i] + chroma.z;
+
+				if (useMatrix) {
+					r = powv(max0(r), nativeGamma);
+					g = powv(max0(g), nativeGamma);
+					b = powv(max0(b), nativeGamma);
+
+					const vdfloat32x4 r2 = r * mx.x.x + g * mx.y.x + b * mx.z.x;
+					const vdfloat32x4 g2 = r * mx.x.y + g * mx.y.y + b * mx.z.y;
+					const vdfloat32x4 b2 = r * mx.x.z + g * mx.y.z + b * mx.z.z;
+
+					r = encode(r2);
+					g = encode(g2);
+					b = encode(b2);
+				}
+
+				const int index = hue*4 + i;
+				const vdfloat32x4 dr = quantize(r) - mR[index];
+				const vdfloat32x4 dg = quantize(g) - mG[index];
+				const vdfloat32x4 db = quantize(b) - mB[index];
+				const vdfloat32x4 sqerr = dr*dr + dg*dg + db*db;
+
+				hueError += i ? sqerr : sqerr * firstWeight;
+			}
+
+			error += (uint32)(hueError.x() + hueError.y() + hueError.z() + hueError.w());
+		}
 
+		return error;
+	}
+}
+
+uint32 ATComputeColorPaletteSolverScore(const ATColorParams& params, const uint32 palette[256], bool reference) {
+	ATPaletteSolverTarget target;
+	target.Init(palette);
+
+	return reference ? target.ComputeScore<true>(params) : target.ComputeScore<false>(params);
+}
+
+// ATColorPaletteSolver
+//
+// The solver runs several independent populations in parallel. The first
+// starts from the initial state and the others are random restarts across
+// the parameter range. Each population is a separate local search with its
+// own heap, random generator, and step size schedule, so the results don't
+// depend on thread scheduling. Each Iterate() call advances all populations
+// by a batch of steps and reports the best solution across them.
+//
 class ATColorPaletteSolver final : public VDAlignedObject<16>, public IATColorPaletteSolver {
 public:
+	ATColorPaletteSolver();
+	~ATColorPaletteSolver();
+
 	void Init(const ATColorParams& initialState, const uint32 palette[256], bool lockHueStart, bool lockGamma) override;
 	void Reinit(const ATColorParams& initialState) override;
 	Status Iterate() override;
@@ -30,79 +247,204 @@ public:
 	void GetCurrentSolution(ATColorParams& params) const override;
 
 private:
-	uint32 ComputeScore(const ATColorParams& params) const;
-	uint8 FastRand() {
-		// Marsaglia Xorshift32 generator
-		mXorShift32State ^= mXorShift32State << 13;
-		mXorShift32State ^= mXorShift32State >> 17;
-		mXorShift32State ^= mXorShift32State << 5;
+	static constexpr uint32 kNumPopulations = 8;
+	static constexpr uint32 kHeapSize = 32;
+	static constexpr uint32 kStepsPerIteration = 16;
+
+	struct Population {
+		uint8 FastRand() {
+			// Marsaglia Xorshift32 generator
+			mXorShift32State ^= mXorShift32State << 13;
+			mXorShift32State ^= mXorShift32State >> 17;
+			mXorShift32State ^= mXorShift32State << 5;
+
+			return (uint8)mXorShift32State;
+		}
 
-		return (uint8)mXorShift32State;
-	}
+		float RandUnit() {
+			return (float)(FastRand() + ((uint32)FastRand() << 8)) / 65535.0f;
+		}
+
+		uint32 mXorShift32State = 1;
+		float mDeltaScale;
+		uint32 mPatienceCounter;
+		bool mbFinished;
+		ATColorParams mBestParams;
+		uint32 mBestError;
 
-	uint32 mXorShift32State = 1;
+		uint8 mHeapIndices[kHeapSize];
+		uint32 mErrorHeap[kHeapSize];
+		ATColorParams mParamHeap[kHeapSize];
+	};
+
+	void InitPopulation(Population& pop, uint32 index, const ATColorParams& initialState);
+	bool Step(Population& pop);
+	void ClampParams(ATColorParams& params) const;
+	uint32 ComputeScore(const ATColorParams& params) const;
 
-	uint32 mTargetPalette[256];
+	ATPaletteSolverTarget mTarget;
 
-	float mDeltaScale;
 	bool mbLockHueStart;
 	bool mbLockGamma;
 	ATColorParams mBestParams;
 	uint32 mBestError = ~UINT32_C(0);
-	uint32 mPatienceCounter = 0;
 
-	uint8 mHeapIndices[32];
-	uint32 mErrorHeap[32];
-	ATColorParams mParamHeap[32];
+	Population mPopulations[kNumPopulations];
+
+	vdautoptr<VDThreadPool> mpThreadPool;
 };
 
 IATColorPaletteSolver *ATCreateColorPaletteSolver() {
 	return new ATColorPaletteSolver;
 }
 
+ATColorPaletteSolver::ATColorPaletteSolver() {
+}
+
+ATColorPaletteSolver::~ATColorPaletteSolver() {
+}
+
 void ATColorPaletteSolver::Init(const ATColorParams& initialState, const uint32 palette[256], bool lockHueStart, bool lockGamma) {
 	mbLockHueStart = lockHueStart;
 	mbLockGamma = lockGamma;
 
-	for(int i=0; i<256; ++i)
-		mTargetPalette[i] = palette[i];
+	mTarget.Init(palette);
 
-	Reinit(initialState);
+	if (!mpThreadPool) {
+		mpThreadPool = new VDThreadPool;
+
+		if (VDGetLogicalProcessorCount() > 1)
+			mpThreadPool->Start(0, "Palette solver");
+	}
 
-	mBestError = ComputeScore(initialState);
+	Reinit(initialState);
 }
 
 void ATColorPaletteSolver::Reinit(const ATColorParams& initialState) {
+	const uint32 seed = (uint32)((VDGetPreciseTick() * UINT64_C(0x100000001)) >> 32);
+
+	mpThreadPool->ParallelFor(kNumPopulations,
+		[&, this](uint32 index) {
+			Population& pop = mPopulations[index];
+
+			// Spread the seeds so that the populations don't track each other;
+			// a zero state would also lock up the generator.
+			pop.mXorShift32State = (seed + index * 0x9E3779B9) | 1;
+
+			InitPopulation(pop, index, initialState);
+		}
+	);
+
 	mBestParams = initialState;
-	mDeltaScale = 1.0f;
-	mPatienceCounter = 0;
-	mXorShift32State = (uint32)((VDGetPreciseTick() * UINT64_C(0x100000001)) >> 32);
+	mBestError = ~UINT32_C(0);
 
-	std::fill(std::begin(mParamHeap), std::end(mParamHeap), initialState);
-	for(int i=0; i<32; ++i)
-		mHeapIndices[i] = i;
+	for(const Population& pop : mPopulations) {
+		if (pop.mBestError < mBestError) {
+			mBestError = pop.mBestError;
+			mBestParams = pop.mBestParams;
+		}
+	}
 }
 
 ATColorPaletteSolver::Status ATColorPaletteSolver::Iterate() {
-	if (++mPatienceCounter >= 1000) {
-		mPatienceCounter = 0;
+	mpThreadPool->ParallelFor(kNumPopulations,
+		[this](uint32 index) {
+			Population& pop = mPopulations[index];
+
+			for(uint32 i = 0; i < kStepsPerIteration && !pop.mbFinished; ++i) {
+				if (!Step(pop))
+					pop.mbFinished = true;
+			}
+		}
+	);
+
+	Status status = Status::Finished;
+
+	for(const Population& pop : mPopulations) {
+		if (!pop.mbFinished && status == Status::Finished)
+			status = Status::RunningNoImprovement;
+
+		if (pop.mBestError < mBestError) {
+			mBestError = pop.mBestError;
+			mBestParams = pop.mBestParams;
+			status = Status::RunningImproved;
+		}
+	}
+
+	return status;
+}
+
+void ATColorPaletteSolver::GetCurrentSolution(ATColorParams& params) const {
+	params = mBestParams;
+}
+
+void ATColorPaletteSolver::InitPopulation(Population& pop, uint32 index, const ATColorParams& initialState) {
+	pop.mDeltaScale = 1.0f;
+	pop.mPatienceCounter = 0;
+	pop.mbFinished = false;
+
+	const uint32 initialError = ComputeScore(initialState);
+
+	for(uint32 i=0; i<kHeapSize; ++i) {
+		ATColorParams& params = pop.mParamHeap[i];
+		params = initialState;
+
+		pop.mHeapIndices[i] = (uint8)i;
+		pop.mErrorHeap[i] = initialError;
+
+		// The first population refines the initial state; the rest are seeded
+		// at random across the parameter range, keeping one copy of the initial
+		// state, so that some start outside of the initial state's basin.
+		if (index && i) {
+			if (!mbLockHueStart)
+				params.mHueStart = -60.0f + 360.0f * pop.RandUnit();
+
+			params.mHueRange	= 540.0f * pop.RandUnit();
+			params.mBrightness	= -0.20f + 0.40f * pop.RandUnit();
+			params.mContrast	= 0.01f + 1.49f * pop.RandUnit();
+			params.mSaturation	= 0.01f + 0.74f * pop.RandUnit();
+
+			if (!mbLockGamma)
+				params.mGammaCorrect = 0.5f + 1.5f * pop.RandUnit();
 
-		mDeltaScale -= 0.02f;
+			ClampParams(params);
 
-		if (mDeltaScale < 0.01f)
-			return Status::Finished;
+			pop.mErrorHeap[i] = ComputeScore(params);
+		}
+	}
+
+	const auto minHeapPred = [&pop](uint8 i, uint8 j) {
+		return pop.mErrorHeap[i] < pop.mErrorHeap[j];
+	};
+
+	std::make_heap(std::begin(pop.mHeapIndices), std::end(pop.mHeapIndices), minHeapPred);
+
+	const uint8 best = *std::min_element(std::begin(pop.mHeapIndices), std::end(pop.mHeapIndices), minHeapPred);
+
+	pop.mBestParams = pop.mParamHeap[best];
+	pop.mBestError = pop.mErrorHeap[best];
+}
+
+bool ATColorPaletteSolver::Step(Population& pop) {
+	if (++pop.mPatienceCounter >= 1000) {
+		pop.mPatienceCounter = 0;
+
+		pop.mDeltaScale -= 0.02f;
+
+		if (pop.mDeltaScale < 0.01f)
+			return false;
 	}
 
-	uint8 dstIndex = mHeapIndices[0];
-	ATColorParams& dstParams = mParamHeap[dstIndex];
+	const float deltaScale = pop.mDeltaScale;
+	uint8 dstIndex = pop.mHeapIndices[0];
+	ATColorParams& dstParams = pop.mParamHeap[dstIndex];
 
-	if (!(FastRand() & 1)) {
+	if (!(pop.FastRand() & 1)) {
 		// crossover
-		const ATColorParams& srcParams1 = mParamHeap[mHeapIndices[((FastRand() * 31) >> 8) + 1]];
-		const ATColorParams& srcParams2 = mParamHeap[mHeapIndices[((FastRand() * 31) >> 8) + 1]];
+		const ATColorParams& srcParams1 = pop.mParamHeap[pop.mHeapIndices[((pop.FastRand() * 31) >> 8) + 1]];
+		const ATColorParams& srcParams2 = pop.mParamHeap[pop.mHeapIndices[((pop.FastRand() * 31) >> 8) + 1]];
 
-#if 1
-		uint8 mask = FastRand();
+		uint8 mask = pop.FastRand();
 		dstParams.mHueStart = (mask & 0x01 ? srcParams1 : srcParams2).mHueStart;
 		dstParams.mHueRange = (mask & 0x02 ? srcParams1 : srcParams2).mHueRange;
 		dstParams.mBrightness = (mask & 0x04 ? srcParams1 : srcParams2).mBrightness;
@@ -110,25 +452,15 @@ ATColorPaletteSolver::Status ATColorPaletteSolver::Iterate() {
 		dstParams.mSaturation = (mask & 0x10 ? srcParams1 : srcParams2).mSaturation;
 		dstParams.mGammaCorrect = (mask & 0x20 ? srcParams1 : srcParams2).mGammaCorrect;
 		dstParams.mColorMatchingMode = (mask & 0x40 ? srcParams1 : srcParams2).mColorMatchingMode;
-#else
-		uint8 mask = FastRand();
-		dstParams.mHueStart		= (srcParams1.mHueStart		+ srcParams2.mHueStart		) * 0.5f;
-		dstParams.mHueRange		= (srcParams1.mHueRange		+ srcParams2.mHueRange		) * 0.5f;
-		dstParams.mBrightness	= (srcParams1.mBrightness	+ srcParams2.mBrightness	) * 0.5f;
-		dstParams.mContrast		= (srcParams1.mContrast		+ srcParams2.mContrast		) * 0.5f;
-		dstParams.mSaturation	= (srcParams1.mSaturation	+ srcParams2.mSaturation	) * 0.5f;
-		dstParams.mGammaCorrect	= (srcParams1.mGammaCorrect	+ srcParams2.mGammaCorrect	) * 0.5f;
-		dstParams.mColorMatchingMode = (mask & 0x40 ? srcParams1 : srcParams2).mColorMatchingMode;
-#endif
 	} else {
 		// mutate
-		const ATColorParams& srcParams1 = mParamHeap[mHeapIndices[((FastRand() * 31) >> 8) + 1]];
+		const ATColorParams& srcParams1 = pop.mParamHeap[pop.mHeapIndices[((pop.FastRand() * 31) >> 8) + 1]];
 		dstParams = srcParams1;
 
-		if (FastRand() & 1) {
-			float delta = mDeltaScale * ((sint8)FastRand() / 128.0f);
+		if (pop.FastRand() & 1) {
+			float delta = deltaScale * ((sint8)pop.FastRand() / 128.0f);
 
-			switch((FastRand() * 6) >> 8) {
+			switch((pop.FastRand() * 6) >> 8) {
 				case 0:
 					dstParams.mHueStart	+= delta * 10.0f;
 					break;
@@ -154,80 +486,59 @@ ATColorPaletteSolver::Status ATColorPaletteSolver::Iterate() {
 					break;
 			}
 		} else {
-			dstParams.mHueStart		+= mDeltaScale * ((sint8)FastRand() / 128.0f) * 10.0f;
+			dstParams.mHueStart		+= deltaScale * ((sint8)pop.FastRand() / 128.0f) * 10.0f;
 
-			float hueRangeDelta = mDeltaScale * ((sint8)FastRand() / 128.0f) * 10.0f;
+			float hueRangeDelta = deltaScale * ((sint8)pop.FastRand() / 128.0f) * 10.0f;
 			dstParams.mHueStart		-= hueRangeDelta * 0.5f;
 			dstParams.mHueRange		+= hueRangeDelta;
 
-			dstParams.mBrightness	+= mDeltaScale * ((sint8)FastRand() / 128.0f) * 1.0f;
-			dstParams.mContrast		+= mDeltaScale * ((sint8)FastRand() / 128.0f) * 1.0f;
-			dstParams.mSaturation	+= mDeltaScale * ((sint8)FastRand() / 128.0f) * 1.0f;
+			dstParams.mBrightness	+= deltaScale * ((sint8)pop.FastRand() / 128.0f) * 1.0f;
+			dstParams.mContrast		+= deltaScale * ((sint8)pop.FastRand() / 128.0f) * 1.0f;
+			dstParams.mSaturation	+= deltaScale * ((sint8)pop.FastRand() / 128.0f) * 1.0f;
 
 			if (!mbLockGamma)
-				dstParams.mGammaCorrect	+= mDeltaScale * ((sint8)FastRand() / 128.0f) * 1.0f;
+				dstParams.mGammaCorrect	+= deltaScale * ((sint8)pop.FastRand() / 128.0f) * 1.0f;
 
-			if (FastRand() & 1)
+			if (pop.FastRand() & 1)
 				dstParams.mColorMatchingMode = srcParams1.mColorMatchingMode == ATColorMatchingMode::SRGB ? ATColorMatchingMode::None : ATColorMatchingMode::SRGB;
 		}
 	}
 
-	dstParams.mHueStart		= dstParams.mHueStart + 360.0f * truncf((dstParams.mHueStart - 60.0f) / 360.0f);
-	dstParams.mHueRange		= std::clamp(dstParams.mHueRange,		0.0f, 540.0f);
-	dstParams.mBrightness	= std::clamp(dstParams.mBrightness,		-0.20f, 0.20f);
-	dstParams.mContrast		= std::clamp(dstParams.mContrast,		0.01f, 1.5f);
-	dstParams.mSaturation	= std::clamp(dstParams.mSaturation,		0.01f, 0.75f);
-
-	if (!mbLockGamma)
-		dstParams.mGammaCorrect	= std::clamp(dstParams.mGammaCorrect,	0.5f, 2.0f);
+	ClampParams(dstParams);
 
 	uint32 error = ComputeScore(dstParams);
 
-	const auto minHeapPred = [this](uint8 i, uint8 j) {
-		return mErrorHeap[i] < mErrorHeap[j];
+	const auto minHeapPred = [&pop](uint8 i, uint8 j) {
+		return pop.mErrorHeap[i] < pop.mErrorHeap[j];
 	};
 
-	std::pop_heap(std::begin(mHeapIndices), std::end(mHeapIndices), minHeapPred);
+	std::pop_heap(std::begin(pop.mHeapIndices), std::end(pop.mHeapIndices), minHeapPred);
 
-	VDASSERT(std::end(mHeapIndices)[-1] == dstIndex);
-	mErrorHeap[dstIndex] = error;
+	VDASSERT(std::end(pop.mHeapIndices)[-1] == dstIndex);
+	pop.mErrorHeap[dstIndex] = error;
 
-	std::push_heap(std::begin(mHeapIndices), std::end(mHeapIndices), minHeapPred);
+	std::push_heap(std::begin(pop.mHeapIndices), std::end(pop.mHeapIndices), minHeapPred);
 
-	Status status = Status::RunningNoImprovement;
-
-	if (error < mBestError) {
-		mBestParams = dstParams;
-		mBestError = error;
-		mPatienceCounter = 0;
-		status = Status::RunningImproved;
+	if (error < pop.mBestError) {
+		pop.mBestParams = dstParams;
+		pop.mBestError = error;
+		pop.mPatienceCounter = 0;
 	}
 
-	return status;
+	return true;
 }
 
-void ATColorPaletteSolver::GetCurrentSolution(ATColorParams& params) const {
-	params = mBestParams;
+void ATColorPaletteSolver::ClampParams(ATColorParams& params) const {
+	params.mHueStart		= params.mHueStart + 360.0f * truncf((params.mHueStart - 60.0f) / 360.0f);
+	params.mHueRange		= std::clamp(params.mHueRange,		0.0f, 540.0f);
+	params.mBrightness		= std::clamp(params.mBrightness,	-0.20f, 0.20f);
+	params.mContrast		= std::clamp(params.mContrast,		0.01f, 1.5f);
+	params.mSaturation		= std::clamp(params.mSaturation,	0.01f, 0.75f);
+
+	if (!mbLockGamma)
+		params.mGammaCorrect	= std::clamp(params.mGammaCorrect,	0.5f, 2.0f);
 }
 
 uint32 ATColorPaletteSolver::ComputeScore(const ATColorParams& params) const {
-	ATColorPaletteGenerator gen;
-	gen.Generate(params, ATMonitorMode::Color);
-
-	uint32 error = 0;
-	for(int i=0; i<256; ++i) {
-		if (!(i & 15))
-			++i;
-
-		uint32 c = mTargetPalette[i];
-		uint32 d = gen.mPalette[i];
-
-		sint32 dr = (sint32)((c >> 16) & 0xFF) - (sint32)((d >> 16) & 0xFF);
-		sint32 dg = (sint32)((c >>  8) & 0xFF) - (sint32)((d >>  8) & 0xFF);
-		sint32 db = (sint32)((c >>  0) & 0xFF) - (sint32)((d >>  0) & 0xFF);
-
-		error += (uint32)(dr * dr + dg * dg + db * db);
-	}
-
-	return error;
+	return mTarget.ComputeScore<false>(params);
 }
@@ -19,6 +19,7 @@
 #include <vd2/system/binary.h>
 #include <vd2/system/error.h>
 #include <vd2/system/file.h>
+#include "sapconverter.h"
 
 #include "playsap-b.inl"
 #include "playsap-c.inl"
@@ -93,23 +94,15 @@ public:
 	ATUnsupportedSAPFileException() : MyError("The input SAP file is not supported.") {}
 };
 
-void ATConvertSAPToPlayer(const void *sap, uint32 len, vdfastvector<uint8>& result) {
+void ATParseSAPHeader(const void *sap, uint32 len, ATSAPHeader& header) {
 	if (len < 5 || memcmp("SAP\r\n", sap, 5))
 		throw ATInvalidSAPFileException();
 	
-	const char *s = (const char *)sap;
+	const char *const s0 = (const char *)sap;
+	const char *s = s0;
 	const char *end = s + len;
-	char type = 0;
-	sint32 initAddr = -1;
-	sint32 playerAddr = -1;
-	sint32 musicAddr = -1;
-	uint8 defSong = 0;
-	uint8 songCount = 1;
-	bool pal = true;
-	uint8 vcountsPerTick = 0;
-
-	VDStringA author;
-	VDStringA name;
+
+	header = ATSAPHeader();
 
 	for(;;) {
 		const char *linestart = s;
@@ -167,17 +160,17 @@ void ATConvertSAPToPlayer(const void *sap, uint32 len, vdfastvector<uint8>& resu
 			if (!argquoted)
 				throw ATInvalidSAPFileException();
 
-			author.assign(argStr.begin() + 1, argStr.end() - 1);
+			header.mAuthor.assign(argStr.begin() + 1, argStr.end() - 1);
 		} else if (typeStr == "NAME") {
 			if (!argquoted)
 				throw ATInvalidSAPFileException();
 
-			name.assign(argStr.begin() + 1, argStr.end() - 1);
+			header.mName.assign(argStr.begin() + 1, argStr.end() - 1);
 		} else if (typeStr == "TYPE") {
 			if (argStr.size() != 1)
 				throw ATUnsupportedSAPFileException();
 
-			type = argStr[0];
+			header.mType = argStr[0];
 		} else if (typeStr == "INIT") {
 			VDStringA str2(argStr);
 			char *term = nullptr;
@@ -186,7 +179,7 @@ void ATConvertSAPToPlayer(const void *sap, uint32 len, vdfastvector<uint8>& resu
 			if (!term || *term || addr >= 0x10000)
 				throw ATInvalidSAPFileException();
 
-			initAddr = (sint32)addr;
+			header.mInitAddr = (sint32)addr;
 		} else if (typeStr == "PLAYER") {
 			VDStringA str2(argStr);
 			char *term = nullptr;
@@ -195,7 +188,7 @@ void ATConvertSAPToPlayer(const void *sap, uint32 len, vdfastvector<uint8>& resu
 			if (!term || *term || addr >= 0x10000)
 				throw ATInvalidSAPFileException();
 
-			playerAddr = (sint32)addr;
+			header.mPlayerAddr = (sint32)addr;
 		} else if (typeStr == "MUSIC") {
 			VDStringA str2(argStr);
 			char *term = nullptr;
@@ -204,9 +197,11 @@ void ATConvertSAPToPlayer(const void *sap, uint32 len, vdfastvector<uint8>& resu
 			if (!term || *term || addr >= 0x10000)
 				throw ATInvalidSAPFileException();
 
-			musicAddr = (sint32)addr;
+			header.mMusicAddr = (sint32)addr;
 		} else if (typeStr == "NTSC") {
-			pal = false;
+			header.mbPal = false;
+		} else if (typeStr == "STEREO") {
+			header.mbStereo = true;
 		} else if (typeStr == "FASTPLAY") {
 			VDStringA str2(argStr);
 			char *term = nullptr;
@@ -215,12 +210,7 @@ void ATConvertSAPToPlayer(const void *sap, uint32 len, vdfastvector<uint8>& resu
 			if (!term || *term || !step)
 				throw ATInvalidSAPFileException();
 
-			if (step < 2)
-				throw ATUnsupportedSAPFileException();
-
-			step >>= 1;
-
-			vcountsPerTick = step > 255 ? 255 : (uint8)step;
+			header.mFastPlay = step > 0xFFFF ? 0xFFFF : (uint32)step;
 		} else if (typeStr == "DEFSONG") {
 			VDStringA str2(argStr);
 			char *term = nullptr;
@@ -232,7 +222,7 @@ void ATConvertSAPToPlayer(const void *sap, uint32 len, vdfastvector<uint8>& resu
 			if (defSongVal > 99)
 				throw ATUnsupportedSAPFileException();
 
-			defSong = (uint8)defSongVal;
+			header.mDefSong = (uint8)defSongVal;
 		} else if (typeStr == "SONGS") {
 			VDStringA str2(argStr);
 			char *term = nullptr;
@@ -244,18 +234,65 @@ void ATConvertSAPToPlayer(const void *sap, uint32 len, vdfastvector<uint8>& resu
 			if (songVal > 99)
 				throw ATUnsupportedSAPFileException();
 
-			songCount = (uint8)songVal;
+			header.mSongCount = (uint8)songVal;
+		} else if (typeStr == "TIME") {
+			// TIME mm:ss[.xxx] [LOOP]
+			VDStringA str2(argStr);
+			char *term = nullptr;
+			uint32 timeMS = 0;
+
+			unsigned long minutes = strtoul(str2.c_str(), &term, 10);
+			if (term && *term == ':') {
+				unsigned long seconds = strtoul(term + 1, &term, 10);
+
+				if (seconds < 60 && minutes < 1000) {
+					timeMS = (uint32)((minutes * 60 + seconds) * 1000);
+
+					if (*term == '.') {
+						uint32 scale = 100;
+
+						while(*++term >= '0' && *term <= '9') {
+							timeMS += (uint32)(*term - '0') * scale;
+							scale /= 10;
+						}
+					}
+				}
+			}
+
+			header.mSongTimes.push_back(timeMS);
 		}
 	}
 
+	header.mDataOffset = (uint32)(s - s0);
+}
+
+void ATConvertSAPToPlayer(const void *sap, uint32 len, vdfastvector<uint8>& result) {
+	ATSAPHeader header;
+	ATParseSAPHeader(sap, len, header);
+
+	const char *s = (const char *)sap + header.mDataOffset;
+	const char *end = (const char *)sap + len;
+	const char type = header.mType;
+	const sint32 initAddr = header.mInitAddr;
+	const sint32 playerAddr = header.mPlayerAddr;
+	const sint32 musicAddr = header.mMusicAddr;
+	const uint8 defSong = header.mDefSong;
+	const uint8 songCount = header.mSongCount;
+	const bool pal = header.mbPal;
+
+	VDStringA& author = header.mAuthor;
+	VDStringA& name = header.mName;
+
 	if (author.size() > 30)
 		author.resize(30);
 
 	if (name.size() > 30)
 		name.resize(30);
 
-	if (!vcountsPerTick)
-		vcountsPerTick = pal ? 312/2 : 262/2;
+	if (header.mFastPlay && header.mFastPlay < 2)
+		throw ATUnsupportedSAPFileException();
+
+	const uint8 vcountsPerTick = header.mFastPlay ? (uint8)std::min<uint32>(header.mFastPlay >> 1, 255) : pal ? 312/2 : 262/2;
 
 	if (type == 'B') {
 		if (initAddr < 0 || playerAddr < 0)
@@ -0,0 +1,465 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/binary.h>
+#include <vd2/system/error.h>
+#include <vd2/system/file.h>
+#include <vd2/system/threadpool.h>
+#include <vd2/system/time.h>
+#include <vd2/system/vdalloc.h>
+#include <at/atcore/scheduler.h>
+#include <at/atcore/wraptime.h>
+#include <at/atcpu/breakpoints.h>
+#include <at/atcpu/co6502.h>
+#include <at/atcpu/execstate.h>
+#include <at/atcpu/memorymap.h>
+#include <at/ataudio/audiofilters.h>
+#include <at/ataudio/audiooutput.h>
+#include <at/ataudio/pokey.h>
+#include <at/ataudio/pokeytables.h>
+#include "audiowriter.h"
+#include "sapconverter.h"
+#include "saprender.h"
+
+namespace {
+	constexpr uint32 kCyclesPerLine = 114;
+	constexpr uint32 kMaxSAPFileSize = 16 * 1024 * 1024;
+
+	// Return address pushed for INIT/PLAYER calls. This is in the unused
+	// page at $D500, so it can't collide with player code or data.
+	constexpr uint16 kReturnAddr = 0xD500;
+
+	// Limits on how long a routine may run before the tune is considered
+	// hung. INIT routines are allowed a lot longer as some depack their
+	// music data.
+	constexpr uint32 kMaxInitCycles = 20000000;
+	constexpr uint32 kMaxPlayCycles = 2000000;
+
+	void ATReadSAPFile(const wchar_t *path, vdfastvector<uint8>& data) {
+		VDFile f(path);
+
+		const sint64 len = f.size();
+		if (len > kMaxSAPFileSize)
+			throw MyError("SAP file is too large.");
+
+		data.resize((size_t)len);
+		f.read(data.data(), (long)len);
+	}
+}
+
+class ATSAPRenderer final
+	: public IATPokeyEmulatorConnections
+	, public IATSchedulerCallback
+	, public IATCPUBreakpointHandler
+	, public IATAudioTap
+{
+	ATSAPRenderer(const ATSAPRenderer&) = delete;
+	ATSAPRenderer& operator=(const ATSAPRenderer&) = delete;
+public:
+	ATSAPRenderer();
+	~ATSAPRenderer();
+
+	void Render(ATSAPRenderJob& job);
+
+public:
+	void PokeyAssertIRQ(bool cpuBased) override {}
+	void PokeyNegateIRQ(bool cpuBased) override {}
+	void PokeyBreak() override {}
+	bool PokeyIsInInterrupt() const override { return false; }
+	bool PokeyIsKeyPushOK(uint8 scanCode, bool cooldownExpired) const override { return true; }
+
+	void OnScheduledEvent(uint32 id) override;
+
+	bool CheckBreakpoint(uint32 pc) override;
+
+	void WriteRawAudio(const float *left, const float *right, uint32 count, uint32 timestamp) override;
+
+private:
+	enum : uint32 {
+		kEventId_Frame = 1
+	};
+
+	enum : uint32 {
+		kFilterOffset = 16,
+		kPreFilterOffset = kFilterOffset + ATAudioFilter::kFilterOverlap * 2,
+		kFilterBufferSize = 1536 + kPreFilterOffset
+	};
+
+	void LoadSegments(const uint8 *src, const uint8 *end);
+	void RunCall(uint16 addr, uint8 a, uint8 x, uint8 y, uint32 maxCycles, const char *what);
+	void RunIdle(uint32 t);
+
+	uint8 ReadPokey(uint32 addr) { return mPokey.ReadByte((uint8)addr); }
+	uint8 DebugReadPokey(uint32 addr) const { return mPokey.DebugReadByte((uint8)addr); }
+	void WritePokey(uint32 addr, uint8 v) { mPokey.WriteByte((uint8)addr, v); }
+
+	uint8 ReadAntic(uint32 addr) { return DebugReadAntic(addr); }
+	uint8 DebugReadAntic(uint32 addr) const;
+	void WriteAntic(uint32 addr, uint8 v) {}
+
+	ATScheduler mScheduler;
+	ATPokeyTables mPokeyTables;
+	ATPokeyEmulator mPokey { false };
+	ATPokeyEmulator mPokey2 { true };
+	ATCoProc6502 mCPU { false, false };
+
+	ATCoProcReadMemNode mPokeyReadNode;
+	ATCoProcWriteMemNode mPokeyWriteNode;
+	ATCoProcReadMemNode mAnticReadNode;
+	ATCoProcWriteMemNode mAnticWriteNode;
+
+	ATEvent *mpFrameEvent = nullptr;
+	uint32 mCyclesPerFrame = 0;
+	uint32 mFrameStartTime = 0;
+	uint32 mFrameCount = 0;
+	uint64 mSamplesWritten = 0;
+	bool mbCallReturned = false;
+	bool mbStereo = false;
+
+	vdautoptr<ATAudioWriter> mpWriter;
+
+	ATAudioFilter mFilters[2];
+	alignas(16) float mFilterBuffers[2][kFilterBufferSize] {};
+
+	uint8 mRAM[0x10000] {};
+	bool mBreakpointMap[0x10000] {};
+};
+
+ATSAPRenderer::ATSAPRenderer() {
+	mPokeyReadNode.BindMethods<&ATSAPRenderer::ReadPokey, &ATSAPRenderer::DebugReadPokey>(this);
+	mPokeyWriteNode.BindMethod<&ATSAPRenderer::WritePokey>(this);
+	mAnticReadNode.BindMethods<&ATSAPRenderer::ReadAntic, &ATSAPRenderer::DebugReadAntic>(this);
+	mAnticWriteNode.BindMethod<&ATSAPRenderer::WriteAntic>(this);
+
+	// Same output volume as the default audio output setting, so that renders
+	// match what is heard and recorded in the emulator.
+	for(ATAudioFilter& filter : mFilters)
+		filter.SetScale(0.5f);
+
+	mBreakpointMap[kReturnAddr] = true;
+}
+
+ATSAPRenderer::~ATSAPRenderer() {
+	mScheduler.UnsetEvent(mpFrameEvent);
+}
+
+void ATSAPRenderer::Render(ATSAPRenderJob& job) {
+	const uint64 startTick = VDGetPreciseTick();
+
+	// read and parse the SAP file
+	vdfastvector<uint8> sap;
+	ATReadSAPFile(job.mSrcPath.c_str(), sap);
+
+	ATSAPHeader hdr;
+	ATParseSAPHeader(sap.data(), (uint32)sap.size(), hdr);
+
+	const uint8 *src = sap.data() + hdr.mDataOffset;
+	const uint8 *const srcEnd = sap.data() + sap.size();
+
+	switch(hdr.mType) {
+		case 'B':
+			if (hdr.mInitAddr < 0 || hdr.mPlayerAddr < 0)
+				throw MyError("SAP file is missing the INIT or PLAYER address.");
+			break;
+
+		case 'C':
+			if (hdr.mMusicAddr < 0 || hdr.mPlayerAddr < 0)
+				throw MyError("SAP file is missing the MUSIC or PLAYER address.");
+			break;
+
+		case 'R':
+			break;
+
+		case 'D':
+			throw MyError("SAP type D files require the full emulator and cannot be rendered headless.");
+
+		default:
+			throw MyError("SAP type '%c' is not supported.", hdr.mType);
+	}
+
+	const uint32 song = job.mSong >= 0 ? (uint32)job.mSong : hdr.mDefSong;
+	if (song >= hdr.mSongCount)
+		throw MyError("Song %u does not exist (file has %u songs).", song + 1, hdr.mSongCount);
+
+	if (hdr.mType != 'R')
+		LoadSegments(src, srcEnd);
+
+	// set up the memory map: RAM everywhere except POKEY and ANTIC
+	ATCoProcMemoryMapView view(mCPU.GetReadMap(), mCPU.GetWriteMap());
+	view.SetMemory(0, 0x100, mRAM);
+	view.SetHandlers(0xD2, 0x01, mPokeyReadNode, mPokeyWriteNode);
+	view.SetHandlers(0xD4, 0x01, mAnticReadNode, mAnticWriteNode);
+
+	mCPU.SetBreakpointMap(mBreakpointMap, this);
+	mCPU.ColdReset();
+
+	// set up POKEYs, routing audio to us instead of an audio output
+	mbStereo = hdr.mbStereo;
+
+	mPokey.Init(this, &mScheduler, nullptr, &mPokeyTables);
+	mPokey.ColdReset();
+
+	if (mbStereo) {
+		mPokey2.Init(this, &mScheduler, nullptr, &mPokeyTables);
+		mPokey2.ColdReset();
+		mPokey.SetSlave(&mPokey2);
+	}
+
+	mPokey.SetAudioTap(this);
+	mPokey.WriteByte(0x0F, 0x03);
+
+	mpWriter = new ATAudioWriter(job.mDstPath.c_str(), false, mbStereo, hdr.mbPal, nullptr);
+
+	const uint32 linesPerFrame = hdr.mbPal ? 312 : 262;
+	const double clockRate = hdr.mbPal ? 1773447.0 : 1789772.5;
+
+	mCyclesPerFrame = linesPerFrame * kCyclesPerLine;
+	mFrameStartTime = mScheduler.GetTick();
+	mFrameCount = 0;
+	mSamplesWritten = 0;
+	mScheduler.SetEvent(mCyclesPerFrame, this, kEventId_Frame, mpFrameEvent);
+
+	// determine length
+	uint32 lengthMS = song < hdr.mSongTimes.size() ? hdr.mSongTimes[song] : 0;
+	if (!lengthMS)
+		lengthMS = job.mDefaultSeconds * 1000;
+
+	const uint32 totalFrames = (uint32)ceil((double)lengthMS / 1000.0 * clockRate / (double)mCyclesPerFrame);
+
+	// init tune
+	uint16 playAddr = (uint16)hdr.mPlayerAddr;
+
+	if (hdr.mType == 'B') {
+		RunCall((uint16)hdr.mInitAddr, (uint8)song, 0, 0, kMaxInitCycles, "INIT");
+	} else if (hdr.mType == 'C') {
+		RunCall((uint16)(hdr.mPlayerAddr + 3), 0x70, (uint8)hdr.mMusicAddr, (uint8)(hdr.mMusicAddr >> 8), kMaxInitCycles, "INIT");
+		RunCall((uint16)(hdr.mPlayerAddr + 3), 0x00, (uint8)song, 0, kMaxInitCycles, "INIT");
+		playAddr += 6;
+	}
+
+	// play; if the player overruns its slot, the next call starts immediately
+	const uint32 callPeriod = (hdr.mFastPlay ? hdr.mFastPlay : linesPerFrame) * kCyclesPerLine;
+	uint32 nextCallTime = mScheduler.GetTick();
+
+	while(mFrameCount < totalFrames) {
+		RunIdle(nextCallTime);
+
+		if (hdr.mType == 'R') {
+			// Each frame is AUDF1-AUDCTL for the first POKEY, followed by the
+			// same for the second POKEY in stereo files, which is mapped at
+			// $D210-D218 through the slave.
+			const uint32 frameSize = mbStereo ? 18 : 9;
+
+			if ((uint32)(srcEnd - src) < frameSize)
+				break;
+
+			for(uint32 i=0; i<9; ++i)
+				mPokey.WriteByte((uint8)i, src[i]);
+
+			if (mbStereo) {
+				for(uint32 i=0; i<9; ++i)
+					mPokey.WriteByte((uint8)(0x10 + i), src[9 + i]);
+			}
+
+			src += frameSize;
+		} else
+			RunCall(playAddr, 0, 0, 0, kMaxPlayCycles, "PLAYER");
+
+		nextCallTime += callPeriod;
+
+		const uint32 t = mScheduler.GetTick();
+		if (ATWrapTime{nextCallTime} < t)
+			nextCallTime = t;
+	}
+
+	// run out the current frame so that all audio up to here is flushed
+	RunIdle(mFrameStartTime + mCyclesPerFrame);
+
+	mScheduler.UnsetEvent(mpFrameEvent);
+	mPokey.SetAudioTap(nullptr);
+
+	mpWriter->CheckExceptions();
+	mpWriter->Finalize();
+	mpWriter.reset();
+
+	job.mAudioSeconds = (double)mSamplesWritten * 28.0 / clockRate;
+	job.mHostSeconds = (double)(sint64)(VDGetPreciseTick() - startTick) * VDGetPreciseSecondsPerTick();
+}
+
+void ATSAPRenderer::OnScheduledEvent(uint32 id) {
+	if (id == kEventId_Frame) {
+		mpFrameEvent = mScheduler.AddEvent(mCyclesPerFrame, this, kEventId_Frame);
+		mFrameStartTime = mScheduler.GetTick();
+		++mFrameCount;
+
+		mScheduler.UpdateTick64();
+		mPokey.AdvanceFrame(true, mScheduler.GetTick64());
+	}
+}
+
+bool ATSAPRenderer::CheckBreakpoint(uint32 pc) {
+	if (pc == kReturnAddr) {
+		mbCallReturned = true;
+		return true;
+	}
+
+	return false;
+}
+
+void ATSAPRenderer::WriteRawAudio(const float *left, const float *right, uint32 count, uint32 timestamp) {
+	VDASSERT(count <= kFilterBufferSize - kPreFilterOffset);
+
+	const int nch = mbStereo ? 2 : 1;
+
+	// Same post-POKEY filter chain as the audio output, so that the output
+	// matches a live recording.
+	for(int ch = 0; ch < nch; ++ch) {
+		float *buf = mFilterBuffers[ch];
+		const float *src = ch && right ? right : left;
+
+		memcpy(buf + kPreFilterOffset, src, sizeof(float) * count);
+
+		mFilters[ch].PreFilterDiff(buf + kPreFilterOffset, count);
+		mFilters[ch].PreFilterEdges(buf + kPreFilterOffset, count, 0);
+		mFilters[ch].Filter(buf + kFilterOffset, count);
+	}
+
+	mpWriter->WriteRawAudio(mFilterBuffers[0] + kFilterOffset, mbStereo ? mFilterBuffers[1] + kFilterOffset : nullptr, count, timestamp);
+
+	for(int ch = 0; ch < nch; ++ch)
+		memmove(mFilterBuffers[ch], mFilterBuffers[ch] + count, sizeof(float) * kPreFilterOffset);
+
+	mSamplesWritten += count;
+}
+
+void ATSAPRenderer::LoadSegments(const uint8 *src, const uint8 *end) {
+	if (end - src < 2 || src[0] != 0xFF || src[1] != 0xFF)
+		throw MyError("SAP file has no binary data.");
+
+	while(end - src >= 4) {
+		const uint16 start = VDReadUnalignedLEU16(src);
+		if (start == 0xFFFF) {
+			src += 2;
+			continue;
+		}
+
+		const uint16 last = VDReadUnalignedLEU16(src + 2);
+		src += 4;
+
+		const uint32 len = (uint32)(last - start) + 1;
+		if (last < start || (uint32)(end - src) < len)
+			throw MyError("SAP file has an invalid address range $%04X-%04X.", start, last);
+
+		if (last >= 0xD000 && start <= 0xD7FF)
+			throw MyError("SAP file loads data into hardware registers at $%04X-%04X.", start, last);
+
+		memcpy(&mRAM[start], src, len);
+		src += len;
+	}
+}
+
+void ATSAPRenderer::RunCall(uint16 addr, uint8 a, uint8 x, uint8 y, uint32 maxCycles, const char *what) {
+	// push return address for RTS
+	mRAM[0x1FF] = (uint8)((kReturnAddr - 1) >> 8);
+	mRAM[0x1FE] = (uint8)(kReturnAddr - 1);
+
+	ATCPUExecState state;
+	mCPU.GetExecState(state);
+	state.m6502.mPC = addr;
+	state.m6502.mA = a;
+	state.m6502.mX = x;
+	state.m6502.mY = y;
+	state.m6502.mS = 0xFD;
+	state.m6502.mP = 0x04;
+	mCPU.SetExecState(state);
+
+	mbCallReturned = false;
+	mScheduler.SetStopTime(mScheduler.GetTick() + maxCycles);
+
+	if (mCPU.Run(mScheduler))
+		throw MyError("SAP %s routine at $%04X did not return.", what, addr);
+
+	if (!mbCallReturned)
+		throw MyError("SAP %s routine at $%04X halted the CPU at $%04X.", what, addr, mCPU.GetPC());
+}
+
+void ATSAPRenderer::RunIdle(uint32 t) {
+	if (ATWrapTime{t} <= mScheduler.GetTick())
+		return;
+
+	mScheduler.SetStopTime(t);
+
+	while(mScheduler.mNextEventCounter != 0)
+		ATSCHEDULER_ADVANCE_N(&mScheduler, ATSCHEDULER_GETTIMETONEXT(&mScheduler));
+}
+
+uint8 ATSAPRenderer::DebugReadAntic(uint32 addr) const {
+	// Only VCOUNT is provided, for players that time multiple calls per
+	// frame off of it. WSYNC is not emulated.
+	if ((addr & 0x0F) == 0x0B)
+		return (uint8)std::min<uint32>((mScheduler.GetTick() - mFrameStartTime) / kCyclesPerLine, mCyclesPerFrame / kCyclesPerLine - 1) >> 1;
+
+	return 0xFF;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint32 ATGetSAPSongCount(const wchar_t *path) {
+	vdfastvector<uint8> sap;
+	ATReadSAPFile(path, sap);
+
+	ATSAPHeader hdr;
+	ATParseSAPHeader(sap.data(), (uint32)sap.size(), hdr);
+
+	return hdr.mSongCount;
+}
+
+void ATRenderSAPToWAV(ATSAPRenderJob& job) {
+	vdautoptr<ATSAPRenderer> renderer(new ATSAPRenderer);
+
+	job.mbSucceeded = false;
+	job.mError.clear();
+
+	renderer->Render(job);
+
+	job.mbSucceeded = true;
+}
+
+void ATRenderSAPBatch(vdvector<ATSAPRenderJob>& jobs, uint32 threadCount) {
+	VDThreadPool pool;
+
+	// The calling thread participates in ParallelFor(), so start one fewer
+	// worker than requested. Zero starts one per logical processor, less one.
+	if (threadCount != 1)
+		pool.Start(threadCount ? threadCount - 1 : 0, "SAP renderer");
+
+	pool.ParallelFor((uint32)jobs.size(),
+		[&jobs](uint32 index) {
+			ATSAPRenderJob& job = jobs[index];
+
+			try {
+				ATRenderSAPToWAV(job);
+			} catch(const MyError& e) {
+				job.mbSucceeded = false;
+				job.mError = e.c_str() ? e.c_str() : "Unknown error.";
+			} catch(const std::bad_alloc&) {
+				job.mbSucceeded = false;
+				job.mError = "Out of memory.";
+			}
+		}
+	);
+}
@@ -32,6 +32,7 @@
 #include <at/ataudio/pokeytables.h>
 #include <at/atcore/address.h>
 #include <at/atcore/asyncdispatcherimpl.h>
+#include <at/atcore/blockdevice.h>
 #include <at/atcore/bussignal.h>
 #include <at/atcore/cio.h>
 #include <at/atcore/consoleoutput.h>
@@ -3682,6 +3683,8 @@ bool ATSimulator::LoadState(ATSaveStateReader& reader, ATStateLoadContext *pctx)
 
 void ATSimulator::SaveState(const wchar_t *path) {
 	try {
+		FlushBlockDevices();
+
 		vdrefptr<IATSerializable> snapshot;
 		vdrefptr<IATSerializable> snapshotInfo;
 		CreateSnapshot(~snapshot, ~snapshotInfo);
@@ -4143,6 +4146,17 @@ namespace {
 	};
 }
 
+void ATSimulator::FlushBlockDevices() {
+	// Write errors stay latched in the device and are reported on the next
+	// disk write, so they are not fatal to the save.
+	for(IATBlockDevice *bdev : mpDeviceManager->GetInterfaces<IATBlockDevice>(false, false, false)) {
+		try {
+			bdev->Flush();
+		} catch(const MyError&) {
+		}
+	}
+}
+
 ATSnapshotStatus ATSimulator::GetSnapshotStatus() const {
 	ATSnapshotStatus status;
 
@@ -63,14 +63,13 @@ void ATStartupLogger::Init(const wchar_t *channels) {
 	mbEnabled = true;
 
 	// attach to parent console if we can, otherwise allocate a new one
-	if (!AttachConsole(ATTACH_PARENT_PROCESS))
+	if (!ATStartupAttachConsole())
 		AllocConsole();
 
 	// disable ctrl+C handling
 	SetConsoleCtrlHandler(CtrlHandler, TRUE);
 
-	DWORD actual;
-	WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), "\r\n", 2, &actual, nullptr);
+	ATStartupWriteConsole(VDStringSpanA("\r\n"));
 
 	mStartTick = VDGetPreciseTick();
 	mLastMsgTick = mStartTick;
@@ -159,8 +158,6 @@ void ATStartupLogger::Log(const char *msg) {
 
 void ATStartupLogger::Log(VDStringSpanA msg) {
 	if (mbEnabled) {
-		DWORD actual;
-		HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
 		char buf[32];
 
 		const uint64 t = VDGetPreciseTick();
@@ -168,19 +165,19 @@ void ATStartupLogger::Log(VDStringSpanA msg) {
 		snprintf(buf, 32, "[%6.3f] ", (double)(t - mStartTick) * scale);
 		buf[31] = 0;
 
-		WriteFile(h, buf, (DWORD)strlen(buf), &actual, nullptr);
+		ATStartupWriteConsole(VDStringSpanA(buf));
 
 		if (mbShowTimeDeltas) {
 			snprintf(buf, 32, "[%+6.3f] ", (double)(t - mLastMsgTick) * scale);
 			buf[31] = 0;
 
-			WriteFile(h, buf, (DWORD)strlen(buf), &actual, nullptr);
+			ATStartupWriteConsole(VDStringSpanA(buf));
 
 			mLastMsgTick = t;
 		}
 
-		WriteFile(h, msg.data(), (DWORD)msg.size(), &actual, nullptr);
-		WriteFile(h, "\r\n", 2, &actual, nullptr);
+		ATStartupWriteConsole(msg);
+		ATStartupWriteConsole(VDStringSpanA("\r\n"));
 	}
 }
 
@@ -363,3 +360,16 @@ void ATStartupLog(VDStringSpanA msg) {
 	if (g_pATStartupLogger)
 		g_pATStartupLogger->Log(msg);
 }
+
+bool ATStartupAttachConsole() {
+	return AttachConsole(ATTACH_PARENT_PROCESS) != 0;
+}
+
+void ATStartupWriteConsole(VDStringSpanA s) {
+	const HANDLE h = GetStdHandle(STD_OUTPUT_HANDLE);
+
+	if (h && h != INVALID_HANDLE_VALUE) {
+		DWORD actual;
+		WriteFile(h, s.data(), (DWORD)s.size(), &actual, nullptr);
+	}
+}
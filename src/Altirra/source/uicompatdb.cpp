@@ -37,6 +37,7 @@
 #include "cassette.h"
 #include "compatedb.h"
 #include "compatengine.h"
+#include "imageindex.h"
 #include "hleprogramloader.h"
 #include "oshelper.h"
 #include "disk.h"
@@ -1104,6 +1105,11 @@ void ATUIDialogCompatDB::OnUpdateChecksumsToSHA256() {
 	if (rulesToBeUpdated.empty()) {
 		nothingToDo = true;
 	} else {
+		// If the tree has been indexed, files that the index knows aren't
+		// disk, cartridge, or program images don't need to be loaded.
+		ATImageIndex index;
+		ATImageIndexLoadForDirectory(index, path.c_str());
+
 		std::deque<VDStringW> pathStack;
 
 		pathStack.push_back(path);
@@ -1126,6 +1132,11 @@ void ATUIDialogCompatDB::OnUpdateChecksumsToSHA256() {
 				} else if (it.GetSize() <= sizeLimit) {
 					const VDStringW& filePath = it.GetFullPath();
 
+					if (const ATImageIndexEntry *e = index.FindByPath(filePath.c_str(), (uint64)it.GetSize(), it.GetLastWriteDate().mTicks)) {
+						if (e->mImageType != kATImageType_Disk && e->mImageType != kATImageType_Cartridge && e->mImageType != kATImageType_Program)
+							continue;
+					}
+
 					if (progress.CheckForCancellationOrStatus())
 						progress.UpdateStatus(filePath.c_str());
 
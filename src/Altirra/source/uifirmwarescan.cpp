@@ -16,15 +16,18 @@
 //	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 
 #include <stdafx.h>
+#include <algorithm>
 #include <vd2/system/error.h>
 #include <vd2/system/file.h>
 #include <vd2/system/filesys.h>
 #include <vd2/system/thread.h>
+#include <vd2/system/threadpool.h>
 #include <vd2/Dita/services.h>
 #include <at/atcore/progress.h>
 #include <at/atnativeui/dialog.h>
 #include "firmwaremanager.h"
 #include "firmwaredetect.h"
+#include "imageindex.h"
 
 void ATUIScanForFirmware(VDGUIHandle hParent, ATFirmwareManager& fwmgr) {
 	const VDStringW& path = VDGetDirectory('FMWR', hParent, L"Select folder to scan for firmware");
@@ -35,10 +38,22 @@ void ATUIScanForFirmware(VDGUIHandle hParent, ATFirmwareManager& fwmgr) {
 	ATProgress progress;
 	progress.InitF(100, NULL, L"Scanning for firmware");
 
+	// If the folder has been indexed, use the recorded detection results for
+	// files that haven't changed instead of reading them again.
+	ATImageIndex index;
+	ATImageIndexLoadForDirectory(index, path.c_str());
+
+	struct ScanResult {
+		ATFirmwareInfo mInfo;
+		ATSpecificFirmwareType mSpecificType;
+		bool mbDetected = false;
+	};
+
 	VDDirectoryIterator it(VDMakePath(path.c_str(), L"*.*").c_str());
-	vdvector<VDStringW> pathsToScan;
+	vdvector<VDStringW> paths;
+	vdvector<ScanResult> results;
+	vdfastvector<uint32> pathsToScan;
 
-	ATFirmwareInfo info;
 	while(it.Next()) {
 		progress.Update(0);
 
@@ -53,42 +68,85 @@ void ATUIScanForFirmware(VDGUIHandle hParent, ATFirmwareManager& fwmgr) {
 		if (!ATFirmwareAutodetectCheckSize(size))
 			continue;
 
-		pathsToScan.push_back(it.GetFullPath());
+		const VDStringW& fullPath = it.GetFullPath();
+		const ATImageIndexEntry *e = index.FindByPath(fullPath.c_str(), (uint64)size, it.GetLastWriteDate().mTicks);
+
+		if (e && e->mFirmwareDetection != ATFirmwareDetection::SpecificImage)
+			continue;
+
+		ScanResult& result = results.push_back();
+
+		if (e) {
+			result.mInfo.mName = e->mFirmwareName;
+			result.mInfo.mType = ATGetFirmwareTypeFromName(e->mFirmwareType.c_str());
+			result.mInfo.mbVisible = true;
+			result.mInfo.mFlags = 0;
+			result.mSpecificType = e->mSpecificFirmwareType;
+			result.mbDetected = true;
+		} else
+			pathsToScan.push_back((uint32)paths.size());
+
+		paths.push_back(fullPath);
 	}
 
 	progress.Update(10);
 
-	size_t n = pathsToScan.size();
-	vdvector<ATFirmwareInfo> detectedFirmwares;
+	const uint32 n = (uint32)pathsToScan.size();
+
+	// Reading and checksumming the candidates dominates, so fan that out
+	// to worker threads and apply the results here in the original order.
 
-	for(size_t i=0; i<n; ++i) {
-		progress.Update((uint32)(10 + (i*90)/n));
-		const VDStringW& fullPath = pathsToScan[i];
-		try {
-			VDFile f(fullPath.c_str());
-			sint64 size = f.size();
+	VDThreadPool pool;
+	pool.Start();
 
-			if (!ATFirmwareAutodetectCheckSize(size))
-				continue;
+	const uint32 batchSize = std::max<uint32>(16, pool.GetThreadCount() * 4);
+	for(uint32 batchStart = 0; batchStart < n; batchStart += batchSize) {
+		progress.Update((uint32)(10 + ((uint64)batchStart*90)/n));
 
-			uint32 size32 = (uint32)size;
+		pool.ParallelFor(std::min<uint32>(batchSize, n - batchStart),
+			[&](uint32 j) {
+				const uint32 i = pathsToScan[batchStart + j];
+				const VDStringW& fullPath = paths[i];
+				ScanResult& result = results[i];
 
-			vdblock<char> buf(size32);
-			f.read(buf.data(), (long)buf.size());
+				try {
+					VDFile f(fullPath.c_str());
+					sint64 size = f.size();
 
-			ATSpecificFirmwareType specificType;
-			if (ATFirmwareAutodetect(buf.data(), (uint32)buf.size(), info, specificType) == ATFirmwareDetection::SpecificImage) {
-				ATFirmwareInfo& info2 = detectedFirmwares.push_back();
+					if (!ATFirmwareAutodetectCheckSize(size))
+						return;
 
-				info2 = std::move(info);
-				info2.mId = ATGetFirmwareIdFromPath(fullPath.c_str());
-				info2.mPath = fullPath;
+					uint32 size32 = (uint32)size;
 
-				if (specificType != kATSpecificFirmwareType_None && !fwmgr.GetSpecificFirmware(specificType))
-					fwmgr.SetSpecificFirmware(specificType, info2.mId);
+					vdblock<char> buf(size32);
+					f.read(buf.data(), (long)buf.size());
+
+					result.mbDetected = ATFirmwareAutodetect(buf.data(), (uint32)buf.size(), result.mInfo, result.mSpecificType) == ATFirmwareDetection::SpecificImage;
+				} catch(const MyError&) {
+				}
 			}
-		} catch(const MyError&) {
-		}
+		);
+	}
+
+	pool.Shutdown();
+
+	vdvector<ATFirmwareInfo> detectedFirmwares;
+
+	for(uint32 i=0, numResults=(uint32)results.size(); i<numResults; ++i) {
+		ScanResult& result = results[i];
+
+		if (!result.mbDetected)
+			continue;
+
+		const VDStringW& fullPath = paths[i];
+		ATFirmwareInfo& info2 = detectedFirmwares.push_back();
+
+		info2 = std::move(result.mInfo);
+		info2.mId = ATGetFirmwareIdFromPath(fullPath.c_str());
+		info2.mPath = fullPath;
+
+		if (result.mSpecificType != kATSpecificFirmwareType_None && !fwmgr.GetSpecificFirmware(result.mSpecificType))
+			fwmgr.SetSpecificFirmware(result.mSpecificType, info2.mId);
 	}
 
 	progress.Shutdown();
@@ -1722,6 +1722,7 @@ public:
 
 	void SetRecordingPosition();
 	void SetRecordingPosition(float time, sint64 size);
+	void SetRecordingDroppedFrames(uint32 count);
 
 	void SetTracingSize(sint64 size);
 
@@ -1795,6 +1796,7 @@ protected:
 	float	mCassettePos = 0;
 	int		mRecordingPos = -1;
 	sint64	mRecordingSize = -1;
+	uint32	mRecordingDroppedFrames = 0;
 	sint64	mTracingSize = -1;
 	bool	mbShowCassetteIndicator = false;
 	int		mShowCassetteIndicatorCounter = 0;
@@ -2235,6 +2237,7 @@ void ATUIRenderer::ReportError(const wchar_t *s) {
 void ATUIRenderer::SetRecordingPosition() {
 	mRecordingPos = -1;
 	mRecordingSize = -1;
+	mRecordingDroppedFrames = 0;
 	mpRecordingLabel->SetVisible(false);
 }
 
@@ -2261,14 +2264,31 @@ void ATUIRenderer::SetRecordingPosition(float time, sint64 size) {
 	int hours = mins / 60;
 	mins %= 60;
 
+	VDStringW s;
+	s.sprintf(L"R%02u:%02u:%02u", hours, mins, secs);
+
 	if (usemb)
-		mpRecordingLabel->SetTextF(L"R%02u:%02u:%02u (%.1fM)", hours, mins, secs, (float)csize / 10240.0f);
+		s.append_sprintf(L" (%.1fM)", (float)csize / 10240.0f);
 	else
-		mpRecordingLabel->SetTextF(L"R%02u:%02u:%02u (%uK)", hours, mins, secs, csize / 10);
+		s.append_sprintf(L" (%uK)", csize / 10);
+
+	if (mRecordingDroppedFrames)
+		s.append_sprintf(L" %u dropped", mRecordingDroppedFrames);
 
+	mpRecordingLabel->SetText(s.c_str());
 	mpRecordingLabel->SetVisible(true);
 }
 
+void ATUIRenderer::SetRecordingDroppedFrames(uint32 count) {
+	if (mRecordingDroppedFrames == count)
+		return;
+
+	mRecordingDroppedFrames = count;
+
+	// force the label to be rebuilt on the next position update
+	mRecordingPos = -1;
+}
+
 void ATUIRenderer::SetTracingSize(sint64 size) {
 	if (mTracingSize != size) {
 		mpTracingLabel->SetVisible(size >= 0);
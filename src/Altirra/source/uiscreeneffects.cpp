@@ -284,6 +284,10 @@ void ATAdjustScreenEffectsDialog::UpdateLabel(uint32 id) {
 
 void ATAdjustScreenEffectsDialog::UpdateEnables() {
 	const bool hwSupport = g_sim.GetGTIA().AreAcceleratedEffectsAvailable();
+
+	// distortion and bloom can fall back to the CPU if the display can't do them
+	const bool fxSupport = hwSupport || g_sim.GetGTIA().AreSoftwareScreenEffectsAvailable();
+
 	const ATGTIAEmulator::HDRAvailability hdrAvailability = g_sim.GetGTIA().IsHDRRenderingAvailable();
 	const bool hwHdrSupport = hdrAvailability == ATGTIAEmulator::HDRAvailability::Available;
 
@@ -323,32 +327,32 @@ void ATAdjustScreenEffectsDialog::UpdateEnables() {
 		}
 	}
 
-	const bool bloomEnabled = hwSupport && mBloomEnableView.GetChecked();
+	const bool bloomEnabled = fxSupport && mBloomEnableView.GetChecked();
 	const bool hdrEnabled = hwHdrSupport && mHDREnableView.GetChecked();
 
-	ShowControl(IDC_DISTORTION_X, hwSupport);
-	ShowControl(IDC_DISTORTION_Y, hwSupport);
-	ShowControl(IDC_LABEL_DISTORTION_X, hwSupport);
-	ShowControl(IDC_LABEL_DISTORTION_Y, hwSupport);
-	ShowControl(IDC_STATIC_DISTORTION_X, hwSupport);
-	ShowControl(IDC_STATIC_DISTORTION_Y, hwSupport);
-	mBloomEnableView.SetVisible(hwSupport);
-	mBloomScanlineCompensationView.SetVisible(hwSupport);
-	ShowControl(IDC_BLOOM_RADIUS, hwSupport);
-	ShowControl(IDC_BLOOM_DIRECT_INTENSITY, hwSupport);
-	ShowControl(IDC_BLOOM_INDIRECT_INTENSITY, hwSupport);
-	ShowControl(IDC_STATIC_BLOOM_RADIUS, hwSupport);
-	ShowControl(IDC_STATIC_BLOOM_DIRECT_INTENSITY, hwSupport);
-	ShowControl(IDC_STATIC_BLOOM_INDIRECT_INTENSITY, hwSupport);
-	ShowControl(IDC_LABEL_BLOOM_RADIUS, hwSupport);
-	ShowControl(IDC_LABEL_BLOOM_DIRECT_INTENSITY, hwSupport);
-	ShowControl(IDC_LABEL_BLOOM_INDIRECT_INTENSITY, hwSupport);
+	ShowControl(IDC_DISTORTION_X, fxSupport);
+	ShowControl(IDC_DISTORTION_Y, fxSupport);
+	ShowControl(IDC_LABEL_DISTORTION_X, fxSupport);
+	ShowControl(IDC_LABEL_DISTORTION_Y, fxSupport);
+	ShowControl(IDC_STATIC_DISTORTION_X, fxSupport);
+	ShowControl(IDC_STATIC_DISTORTION_Y, fxSupport);
+	mBloomEnableView.SetVisible(fxSupport);
+	mBloomScanlineCompensationView.SetVisible(fxSupport);
+	ShowControl(IDC_BLOOM_RADIUS, fxSupport);
+	ShowControl(IDC_BLOOM_DIRECT_INTENSITY, fxSupport);
+	ShowControl(IDC_BLOOM_INDIRECT_INTENSITY, fxSupport);
+	ShowControl(IDC_STATIC_BLOOM_RADIUS, fxSupport);
+	ShowControl(IDC_STATIC_BLOOM_DIRECT_INTENSITY, fxSupport);
+	ShowControl(IDC_STATIC_BLOOM_INDIRECT_INTENSITY, fxSupport);
+	ShowControl(IDC_LABEL_BLOOM_RADIUS, fxSupport);
+	ShowControl(IDC_LABEL_BLOOM_DIRECT_INTENSITY, fxSupport);
+	ShowControl(IDC_LABEL_BLOOM_INDIRECT_INTENSITY, fxSupport);
 
 	mBloomScanlineCompensationView.SetEnabled(bloomEnabled);
 	EnableControl(IDC_BLOOM_RADIUS, bloomEnabled);
 	EnableControl(IDC_BLOOM_DIRECT_INTENSITY, bloomEnabled);
 	EnableControl(IDC_BLOOM_INDIRECT_INTENSITY, bloomEnabled);
-	ShowControl(IDC_WARNING, !hwSupport);
+	ShowControl(IDC_WARNING, !fxSupport);
 
 	ShowControl(IDC_HDRWARNING, !hwHdrSupport);
 	ShowControl(IDC_ENABLEHDR, hwHdrSupport);
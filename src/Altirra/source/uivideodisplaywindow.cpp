@@ -1789,8 +1789,12 @@ void ATUIVideoDisplayWindow::Paint(IVDDisplayRenderer& rdr, sint32 w, sint32 h)
 
 		uint32 cc = vi.mFrameBufferChangeCount;
 		if (cc != mAltVOChangeCount) {
+			if (vi.mFrameBufferDirtyRectCount && vi.mFrameBufferDirtyBaseChangeCount == mAltVOChangeCount)
+				mAltVOImageView.Invalidate(vi.mpFrameBufferDirtyRects, vi.mFrameBufferDirtyRectCount);
+			else
+				mAltVOImageView.Invalidate();
+
 			mAltVOChangeCount = cc;
-			mAltVOImageView.Invalidate();
 		}
 
 		if (!vi.mbSignalValid) {
@@ -119,6 +119,7 @@ bool ATUIDialogVideoRecording::OnLoaded() {
 	mVideoCodecView.AddItem(L"Windows Media Video 9 + WMAv8 (WMV)");
 	mVideoCodecView.AddItem(L"H.264 + MP3 (MP4)");
 	mVideoCodecView.AddItem(L"H.264 + AAC (MP4)");
+	mVideoCodecView.AddItem(L"PNG image sequence + WAV (lossless)");
 
 	mResamplingModeView.AddItem(L"Bilinear - smooth resampling");
 	mResamplingModeView.AddItem(L"Sharp Bilinear - sharper resampling");
@@ -171,6 +172,7 @@ void ATUIDialogVideoRecording::OnDataExchange(bool write) {
 			case 4: mEncoding = kATVideoEncoding_WMV9; break;
 			case 5: mEncoding = kATVideoEncoding_H264_MP3; break;
 			case 6: mEncoding = kATVideoEncoding_H264_AAC; break;
+			case 7: mEncoding = kATVideoEncoding_PNGSequence; break;
 		}
 
 		if (IsButtonChecked(IDC_FRAMERATE_NORMAL))
@@ -225,6 +227,7 @@ void ATUIDialogVideoRecording::OnDataExchange(bool write) {
 			case kATVideoEncoding_WMV9:	mVideoCodecView.SetSelection(4); break;
 			case kATVideoEncoding_H264_MP3:	mVideoCodecView.SetSelection(5); break;
 			case kATVideoEncoding_H264_AAC:	mVideoCodecView.SetSelection(6); break;
+			case kATVideoEncoding_PNGSequence:	mVideoCodecView.SetSelection(7); break;
 				break;
 		}
 
@@ -332,6 +335,10 @@ void ATUIDialogVideoRecording::UpdateEnables() {
 			hasFullFrameOption = false;
 			break;
 
+		case 7:		// PNG sequence
+			hasFullFrameOption = false;
+			break;
+
 		default:
 			hasVideoBitrate = false;
 			hasAudioBitrate = false;
@@ -397,6 +404,11 @@ ATUIContextualHelpProvider::HelpEntry& ATUIDialogVideoRecording::OnGetDynamicHel
 					mTempHelpEntry.mLabel = L"Video encoding: H.264/AAC (MP4)";
 					mTempHelpEntry.mText = L"Records video in .MP4 format with H.264 video encoding and AAC audio encoding. This requires at least Windows 7.";
 					break;
+
+				case 7:
+					mTempHelpEntry.mLabel = L"Video encoding: PNG image sequence + WAV";
+					mTempHelpEntry.mText = L"Records each frame as a separate lossless .PNG image, numbered after the chosen file name, with the audio in a .WAV file alongside. Frames are compressed in parallel on all available CPU cores. This is intended for archival and for editing in other programs.";
+					break;
 			}
 			break;
 	}
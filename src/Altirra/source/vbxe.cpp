@@ -32,6 +32,7 @@
 #include "irqcontroller.h"
 #include "trace.h"
 #include "artifacting.h"
+#include "vbxeblit.h"
 
 using namespace ATGTIA;
 
@@ -1623,6 +1624,7 @@ void ATVBXEEmulator::EndFrame() {
 
 void ATVBXEEmulator::BeginScanline(uint32 y, uint32 *dst, const uint8 *mergeBuffer, const uint8 *anticBuffer, bool hires) {
 	mpDst = dst;
+	mOvTextCacheY = y;
 
 	mbHiresMode = hires;
 	mX = 0;
@@ -3158,7 +3160,12 @@ void ATVBXEEmulator::RenderOverlay(int x1, int x2) {
 				break;
 
 			case ATVBXEOverlayMode::Text:
-				RenderOverlay80Text(mOverlayDecode + x1f*4, xl, x1f - xl, x2f - x1f);
+				// Only a whole line can be reused from the last frame; lines
+				// rendered in pieces are decoded normally.
+				if (x1f == xl && x2f == xr2)
+					mOvTextCache.Decode(mOvTextCacheY, mOverlayDecode + xl*4, &mOvTextTrans[xl*4], mpMemory, mOvAddr, mChAddr, mOvTextRow, x2f - x1f, mbOvTrans);
+				else
+					RenderOverlay80Text(mOverlayDecode + x1f*4, xl, x1f - xl, x2f - x1f);
 				break;
 		}
 	}
@@ -3391,80 +3398,9 @@ void ATVBXEEmulator::RenderOverlayHR(uint8 *dst, int x1, int w) {
 }
 
 void ATVBXEEmulator::RenderOverlay80Text(uint8 *dst, int rx1, int x1, int w) {
-	static const uint32 kExpand4[16]={
-		0x00000000,
-		0xFF000000,
-		0x00FF0000,
-		0xFFFF0000,
-		0x0000FF00,
-		0xFF00FF00,
-		0x00FFFF00,
-		0xFFFFFF00,
-		0x000000FF,
-		0xFF0000FF,
-		0x00FF00FF,
-		0xFFFF00FF,
-		0x0000FFFF,
-		0xFF00FFFF,
-		0x00FFFFFF,
-		0xFFFFFFFF,
-	};
-
-	x1 += x1;
-
 	// Character sets are always aligned on a 2K boundary (11 bits), so the character
 	// data fetch never wraps around the memory base.
-	const uint8 *chbase = &mpMemory[mChAddr + mOvTextRow];
-
-	if (mbOvTrans) {
-		uint8 *transDst = &mOvTextTrans[rx1*4];
-
-		do {
-			const uint32 fetchAddr = (mOvAddr + ((x1 >> 1) & ~1)) & 0x7FFFF;
-			uint8 ch = VBXE_FETCH_NOWRAP(fetchAddr);
-			uint8 attr = VBXE_FETCH_NOWRAP(fetchAddr + 1);
-			uint8 data = chbase[(uint32)ch << 3];
-
-			uint32 baseColor = (uint32)(attr & 0x7f) * 0x01010101;
-			uint32 mask = kExpand4[x1 & 2 ? data & 15 : data >> 4];
-			uint32 result;
-
-			if (attr & 0x80) {
-				result = (~mask & 0x80808080) + baseColor;
-				*(uint32 *)transDst = 0xFFFFFFFF;
-			} else {
-				result = mask & baseColor;
-				*(uint32 *)transDst = mask;
-			}
-
-			*(uint32 *)dst = result;
-
-			dst += 4;
-			transDst += 4;
-			x1 += 2;
-		} while(--w);
-	} else {
-		do {
-			const uint32 fetchAddr = (mOvAddr + ((x1 >> 1) & ~1)) & 0x7FFFF;
-			uint8 ch = VBXE_FETCH_NOWRAP(fetchAddr);
-			uint8 attr = VBXE_FETCH_NOWRAP(fetchAddr + 1);
-			uint8 data = chbase[(uint32)ch << 3];
-
-			uint32 baseColor = (uint32)(attr & 0x7f) * 0x01010101;
-			uint32 mask = kExpand4[x1 & 2 ? data & 15 : data >> 4];
-			uint32 result;
-
-			if (attr & 0x80)
-				result = (~mask & 0x80808080) + baseColor;
-			else
-				result = (mask & baseColor) + (~mask & 0x80808080);
-
-			*(uint32 *)dst = result;
-
-			dst += 4;
-			x1 += 2;
-		} while(--w);
-	}
+	ATVBXEDecodeOverlayText(dst, &mOvTextTrans[rx1*4], mpMemory, mOvAddr, &mpMemory[mChAddr + mOvTextRow], x1, w, mbOvTrans);
 }
 
 void ATVBXEEmulator::RunBlitter() {
@@ -3592,6 +3528,28 @@ uint32 ATVBXEEmulator::RunBlitterRow() {
 		VDNEVERHERE;
 	}
 
+	// Unzoomed forward blits without a pattern go through the row kernels, as
+	// long as neither row wraps local memory and the destination doesn't trail
+	// the source within the row (the source isn't read with a zero AND mask).
+	// Cycle accounting is unchanged as the kernels return the same zero source
+	// byte count.
+	if (zoomX == 1 && srcStepX == 1 && dstStepX == 1 && !(mBlitPatternMode & 0x80)) {
+		const uint32 srcOffset = srcRowAddr & 0x7FFFF;
+		const uint32 dstOffset = dstRowAddr & 0x7FFFF;
+
+		if (dstOffset + width <= 0x80000
+			&& (!andMask || (srcOffset + width <= 0x80000 && (dstOffset <= srcOffset || dstOffset - srcOffset >= width))))
+		{
+			ATVBXEBlitCollisionState collision { mBlitActiveCollisionMask, mBlitCollisionCode };
+
+			zeroSourceBytes = mpBlitRowFn(mpMemory + dstOffset, mpMemory + srcOffset, width, andMask, xorMask, collision);
+
+			mBlitActiveCollisionMask = collision.mActiveMask;
+			mBlitCollisionCode = collision.mCode;
+			return zeroSourceBytes;
+		}
+	}
+
 	if constexpr (T_Mode == 0) {
 		if (zoomX == 1 && !(mBlitPatternMode & 0x80)) {
 			if (andMask == 0) {
@@ -3815,6 +3773,7 @@ void ATVBXEEmulator::LoadBCB(const uint8 (&bcb)[21]) {
 	mbBlitterContinue = (rawBltControl & 0x08) != 0;
 
 	mBlitterMode = rawBltControl & 7;
+	mpBlitRowFn = ATVBXEGetBlitRowFn(mBlitterMode);
 
 	mBlitZoomX = (rawBltZoom & 7) + 1;
 	mBlitZoomY = ((rawBltZoom >> 4) & 7) + 1;
@@ -0,0 +1,88 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/cpuaccel.h>
+#include "vbxeblit.h"
+
+namespace {
+	template<uint8 T_Mode>
+	uint32 ATVBXEBlitRow_Scalar(uint8 *dst, const uint8 *src, uint32 n, uint8 andMask, uint8 xorMask, ATVBXEBlitCollisionState& collision) {
+		uint32 zeroSourceBytes = 0;
+
+		for(uint32 x = 0; x < n; ++x) {
+			const uint8 c = andMask ? (src[x] & andMask) ^ xorMask : xorMask;
+
+			if constexpr (T_Mode == 0) {
+				dst[x] = c;
+				continue;
+			}
+
+			if (!c) {
+				++zeroSourceBytes;
+
+				if constexpr (T_Mode == 4)
+					dst[x] = 0;
+
+				continue;
+			}
+
+			const uint8 d = dst[x];
+
+			if (collision.mActiveMask)
+				ATVBXEBlitCheckCollision<T_Mode>(c, d, collision);
+
+			if constexpr (T_Mode == 1)
+				dst[x] = c;
+			else if constexpr (T_Mode == 2)
+				dst[x] = c + d;
+			else if constexpr (T_Mode == 3)
+				dst[x] = c | d;
+			else if constexpr (T_Mode == 4)
+				dst[x] = c & d;
+			else if constexpr (T_Mode == 5)
+				dst[x] = c ^ d;
+			else if constexpr (T_Mode == 6)
+				dst[x] = ((c & 0x0f) ? (c & 0x0f) : (d & 0x0f)) + ((c & 0xf0) ? (c & 0xf0) : (d & 0xf0));
+		}
+
+		return zeroSourceBytes;
+	}
+}
+
+ATVBXEBlitRowFn ATVBXEGetBlitRowFn_Scalar(uint8 mode) {
+	switch(mode) {
+		default:
+		case 0:	return ATVBXEBlitRow_Scalar<0>;
+		case 1:	return ATVBXEBlitRow_Scalar<1>;
+		case 2:	return ATVBXEBlitRow_Scalar<2>;
+		case 3:	return ATVBXEBlitRow_Scalar<3>;
+		case 4:	return ATVBXEBlitRow_Scalar<4>;
+		case 5:	return ATVBXEBlitRow_Scalar<5>;
+		case 6:	return ATVBXEBlitRow_Scalar<6>;
+	}
+}
+
+ATVBXEBlitRowFn ATVBXEGetBlitRowFn(uint8 mode) {
+#if VD_CPU_ARM64
+	return ATVBXEGetBlitRowFn_NEON(mode);
+#elif VD_CPU_X86 || VD_CPU_X64
+	if (SSE2_enabled)
+		return ATVBXEGetBlitRowFn_SSE2(mode);
+#endif
+
+	return ATVBXEGetBlitRowFn_Scalar(mode);
+}
@@ -0,0 +1,111 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	VBXE blitter acceleration - NEON intrinsics
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <arm_neon.h>
+#include "vbxeblit.h"
+
+namespace {
+	template<uint8 T_Mode>
+	uint32 ATVBXEBlitRow_NEON(uint8 *dst, const uint8 *src, uint32 n, uint8 andMask, uint8 xorMask, ATVBXEBlitCollisionState& collision) {
+		const uint8x16_t andv = vdupq_n_u8(andMask);
+		const uint8x16_t xorv = vdupq_n_u8(xorMask);
+		const uint8x16_t lowNibble = vdupq_n_u8(0x0f);
+		const uint8x16_t highNibble = vdupq_n_u8(0xf0);
+
+		uint32 zeroSourceBytes = 0;
+		uint32 n16 = n >> 4;
+
+		while(n16) {
+			// Zero counts are accumulated per lane as bytes, so flush at most every
+			// 255 chunks.
+			const uint32 batch = n16 < 255 ? n16 : 255;
+			n16 -= batch;
+
+			uint8x16_t zeroAccum = vdupq_n_u8(0);
+
+			for(uint32 i = 0; i < batch; ++i) {
+				const uint8x16_t c = andMask ? veorq_u8(vandq_u8(vld1q_u8(src), andv), xorv) : xorv;
+
+				if constexpr (T_Mode == 0) {
+					vst1q_u8(dst, c);
+				} else {
+					const uint8x16_t czero = vceqzq_u8(c);
+					zeroAccum = vsubq_u8(zeroAccum, czero);
+
+					const uint8x16_t d = vld1q_u8(dst);
+
+					// Collisions stop at the first hit, so any chunk that might collide
+					// needs an in-order scalar check. This must be done before the store.
+					if (collision.mActiveMask) {
+						const uint8x16_t cand = vbicq_u8(vtstq_u8(d, d), czero);
+
+						if (vmaxvq_u8(cand)) {
+							for(int j = 0; j < 16 && collision.mActiveMask; ++j)
+								ATVBXEBlitCheckCollision<T_Mode>(andMask ? (uint8)((src[j] & andMask) ^ xorMask) : xorMask, dst[j], collision);
+						}
+					}
+
+					uint8x16_t r;
+					if constexpr (T_Mode == 1)
+						r = vbslq_u8(czero, d, c);
+					else if constexpr (T_Mode == 2)
+						r = vaddq_u8(c, d);
+					else if constexpr (T_Mode == 3)
+						r = vorrq_u8(c, d);
+					else if constexpr (T_Mode == 4)
+						r = vandq_u8(c, d);
+					else if constexpr (T_Mode == 5)
+						r = veorq_u8(c, d);
+					else if constexpr (T_Mode == 6) {
+						// select nonzero source nibbles over destination nibbles
+						const uint8x16_t sel = vorrq_u8(vandq_u8(vtstq_u8(c, lowNibble), lowNibble), vandq_u8(vtstq_u8(c, highNibble), highNibble));
+
+						r = vbslq_u8(sel, c, d);
+					}
+
+					vst1q_u8(dst, r);
+				}
+
+				src += 16;
+				dst += 16;
+			}
+
+			if constexpr (T_Mode != 0)
+				zeroSourceBytes += vaddlvq_u8(zeroAccum);
+		}
+
+		n &= 15;
+		if (n)
+			zeroSourceBytes += ATVBXEGetBlitRowFn_Scalar(T_Mode)(dst, src, n, andMask, xorMask, collision);
+
+		return zeroSourceBytes;
+	}
+}
+
+ATVBXEBlitRowFn ATVBXEGetBlitRowFn_NEON(uint8 mode) {
+	switch(mode) {
+		default:
+		case 0:	return ATVBXEBlitRow_NEON<0>;
+		case 1:	return ATVBXEBlitRow_NEON<1>;
+		case 2:	return ATVBXEBlitRow_NEON<2>;
+		case 3:	return ATVBXEBlitRow_NEON<3>;
+		case 4:	return ATVBXEBlitRow_NEON<4>;
+		case 5:	return ATVBXEBlitRow_NEON<5>;
+		case 6:	return ATVBXEBlitRow_NEON<6>;
+	}
+}
@@ -0,0 +1,118 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	VBXE blitter acceleration - SSE2 intrinsics
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <intrin.h>
+#include <emmintrin.h>
+#include "vbxeblit.h"
+
+namespace {
+	template<uint8 T_Mode>
+	uint32 ATVBXEBlitRow_SSE2(uint8 *dst, const uint8 *src, uint32 n, uint8 andMask, uint8 xorMask, ATVBXEBlitCollisionState& collision) {
+		const __m128i andv = _mm_set1_epi8((char)andMask);
+		const __m128i xorv = _mm_set1_epi8((char)xorMask);
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i lowNibble = _mm_set1_epi8(0x0f);
+		const __m128i highNibble = _mm_set1_epi8((char)0xf0);
+
+		uint32 zeroSourceBytes = 0;
+		uint32 n16 = n >> 4;
+
+		while(n16) {
+			// Zero counts are accumulated per lane as bytes, so flush at most every
+			// 255 chunks.
+			const uint32 batch = n16 < 255 ? n16 : 255;
+			n16 -= batch;
+
+			__m128i zeroAccum = _mm_setzero_si128();
+
+			for(uint32 i = 0; i < batch; ++i) {
+				const __m128i c = andMask ? _mm_xor_si128(_mm_and_si128(_mm_loadu_si128((const __m128i *)src), andv), xorv) : xorv;
+
+				if constexpr (T_Mode == 0) {
+					_mm_storeu_si128((__m128i *)dst, c);
+				} else {
+					const __m128i czero = _mm_cmpeq_epi8(c, zero);
+					zeroAccum = _mm_sub_epi8(zeroAccum, czero);
+
+					const __m128i d = _mm_loadu_si128((const __m128i *)dst);
+
+					// Collisions stop at the first hit, so any chunk that might collide
+					// needs an in-order scalar check. This must be done before the store.
+					if (collision.mActiveMask) {
+						const __m128i dzero = _mm_cmpeq_epi8(d, zero);
+
+						if (_mm_movemask_epi8(_mm_or_si128(czero, dzero)) != 0xFFFF) {
+							for(int j = 0; j < 16 && collision.mActiveMask; ++j)
+								ATVBXEBlitCheckCollision<T_Mode>(andMask ? (uint8)((src[j] & andMask) ^ xorMask) : xorMask, dst[j], collision);
+						}
+					}
+
+					__m128i r;
+					if constexpr (T_Mode == 1)
+						r = _mm_or_si128(_mm_andnot_si128(czero, c), _mm_and_si128(czero, d));
+					else if constexpr (T_Mode == 2)
+						r = _mm_add_epi8(c, d);
+					else if constexpr (T_Mode == 3)
+						r = _mm_or_si128(c, d);
+					else if constexpr (T_Mode == 4)
+						r = _mm_and_si128(c, d);
+					else if constexpr (T_Mode == 5)
+						r = _mm_xor_si128(c, d);
+					else if constexpr (T_Mode == 6) {
+						// select nonzero source nibbles over destination nibbles
+						const __m128i lowSel = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(c, lowNibble), zero), lowNibble);
+						const __m128i highSel = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(c, highNibble), zero), highNibble);
+						const __m128i sel = _mm_or_si128(lowSel, highSel);
+
+						r = _mm_or_si128(_mm_and_si128(c, sel), _mm_andnot_si128(sel, d));
+					}
+
+					_mm_storeu_si128((__m128i *)dst, r);
+				}
+
+				src += 16;
+				dst += 16;
+			}
+
+			if constexpr (T_Mode != 0) {
+				const __m128i sums = _mm_sad_epu8(zeroAccum, zero);
+
+				zeroSourceBytes += (uint32)_mm_cvtsi128_si32(sums) + (uint32)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+			}
+		}
+
+		n &= 15;
+		if (n)
+			zeroSourceBytes += ATVBXEGetBlitRowFn_Scalar(T_Mode)(dst, src, n, andMask, xorMask, collision);
+
+		return zeroSourceBytes;
+	}
+}
+
+ATVBXEBlitRowFn ATVBXEGetBlitRowFn_SSE2(uint8 mode) {
+	switch(mode) {
+		default:
+		case 0:	return ATVBXEBlitRow_SSE2<0>;
+		case 1:	return ATVBXEBlitRow_SSE2<1>;
+		case 2:	return ATVBXEBlitRow_SSE2<2>;
+		case 3:	return ATVBXEBlitRow_SSE2<3>;
+		case 4:	return ATVBXEBlitRow_SSE2<4>;
+		case 5:	return ATVBXEBlitRow_SSE2<5>;
+		case 6:	return ATVBXEBlitRow_SSE2<6>;
+	}
+}
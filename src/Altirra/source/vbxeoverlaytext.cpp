@@ -0,0 +1,152 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include "vbxeoverlaytext.h"
+
+void ATVBXEDecodeOverlayText(uint8 *dst, uint8 *transDst, const uint8 *mem, uint32 textAddr, const uint8 *glyphRow, int x1, int w, bool trans) {
+	static const uint32 kExpand4[16]={
+		0x00000000,
+		0xFF000000,
+		0x00FF0000,
+		0xFFFF0000,
+		0x0000FF00,
+		0xFF00FF00,
+		0x00FFFF00,
+		0xFFFFFF00,
+		0x000000FF,
+		0xFF0000FF,
+		0x00FF00FF,
+		0xFFFF00FF,
+		0x0000FFFF,
+		0xFF00FFFF,
+		0x00FFFFFF,
+		0xFFFFFFFF,
+	};
+
+	x1 += x1;
+
+	if (trans) {
+		do {
+			const uint32 fetchAddr = (textAddr + ((x1 >> 1) & ~1)) & 0x7FFFF;
+			uint8 ch = mem[fetchAddr];
+			uint8 attr = mem[fetchAddr + 1];
+			uint8 data = glyphRow[(uint32)ch << 3];
+
+			uint32 baseColor = (uint32)(attr & 0x7f) * 0x01010101;
+			uint32 mask = kExpand4[x1 & 2 ? data & 15 : data >> 4];
+			uint32 result;
+
+			if (attr & 0x80) {
+				result = (~mask & 0x80808080) + baseColor;
+				*(uint32 *)transDst = 0xFFFFFFFF;
+			} else {
+				result = mask & baseColor;
+				*(uint32 *)transDst = mask;
+			}
+
+			*(uint32 *)dst = result;
+
+			dst += 4;
+			transDst += 4;
+			x1 += 2;
+		} while(--w);
+	} else {
+		do {
+			const uint32 fetchAddr = (textAddr + ((x1 >> 1) & ~1)) & 0x7FFFF;
+			uint8 ch = mem[fetchAddr];
+			uint8 attr = mem[fetchAddr + 1];
+			uint8 data = glyphRow[(uint32)ch << 3];
+
+			uint32 baseColor = (uint32)(attr & 0x7f) * 0x01010101;
+			uint32 mask = kExpand4[x1 & 2 ? data & 15 : data >> 4];
+			uint32 result;
+
+			if (attr & 0x80)
+				result = (~mask & 0x80808080) + baseColor;
+			else
+				result = (mask & baseColor) + (~mask & 0x80808080);
+
+			*(uint32 *)dst = result;
+
+			dst += 4;
+			x1 += 2;
+		} while(--w);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool ATVBXEOverlayTextCache::Decode(uint32 y, uint8 *dst, uint8 *transDst, const uint8 *mem, uint32 textAddr, uint32 chAddr, uint32 textRow, int w, bool trans) {
+	// Character pairs are fetched from even offsets, so an odd width still
+	// reads the attribute byte of the last character.
+	const uint32 textLen = (uint32)(w + 1) & ~1;
+	textAddr &= 0x7FFFF;
+
+	if (y >= kMaxLines || w <= 0 || w > kMaxWidth || textAddr + textLen > 0x80000) {
+		ATVBXEDecodeOverlayText(dst, transDst, mem, textAddr, mem + chAddr + textRow, 0, w, trans);
+		return false;
+	}
+
+	if (mLines.empty()) {
+		mLines.resize(kMaxLines);
+
+		for(LineEntry& line : mLines)
+			line.mbValid = false;
+	}
+
+	// The character set is 2K aligned, so this never wraps.
+	const uint8 *charset = mem + chAddr;
+	if (!mbCharsetValid || memcmp(mCharset, charset, sizeof mCharset)) {
+		memcpy(mCharset, charset, sizeof mCharset);
+		mbCharsetValid = true;
+		++mCharsetGeneration;
+	}
+
+	LineEntry& line = mLines[y];
+	const uint8 *text = mem + textAddr;
+	const size_t decodeLen = (size_t)w * 4;
+
+	if (line.mbValid
+		&& line.mbTrans == trans
+		&& line.mTextRow == textRow
+		&& line.mWidth == w
+		&& line.mCharsetGeneration == mCharsetGeneration
+		&& !memcmp(line.mText, text, textLen))
+	{
+		memcpy(dst, line.mDecode, decodeLen);
+
+		if (trans)
+			memcpy(transDst, line.mTrans, decodeLen);
+
+		return true;
+	}
+
+	ATVBXEDecodeOverlayText(dst, transDst, mem, textAddr, charset + textRow, 0, w, trans);
+
+	line.mbValid = true;
+	line.mbTrans = trans;
+	line.mTextRow = (uint8)textRow;
+	line.mWidth = (uint8)w;
+	line.mCharsetGeneration = mCharsetGeneration;
+	memcpy(line.mText, text, textLen);
+	memcpy(line.mDecode, dst, decodeLen);
+
+	if (trans)
+		memcpy(line.mTrans, transDst, decodeLen);
+
+	return false;
+}
@@ -8,11 +8,18 @@
 	#include <emmintrin.h>
 #endif
 
+#include <vd2/system/atomic.h>
+#include <vd2/system/binary.h>
 #include <vd2/system/cpuaccel.h>
 #include <vd2/system/error.h>
+#include <vd2/system/file.h>
+#include <vd2/system/filesys.h>
 #include <vd2/system/fraction.h>
 #include <vd2/system/int128.h>
 #include <vd2/system/math.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/threadpool.h>
+#include <vd2/system/time.h>
 #include <vd2/system/vdalloc.h>
 #include <vd2/Kasumi/blitter.h>
 #include <vd2/Kasumi/pixmapops.h>
@@ -29,7 +36,9 @@
 
 #include <at/atio/wav.h>
 #include "videowriter.h"
+#include "videoencoder.h"
 #include "aviwriter.h"
+#include "encode_png.h"
 #include "gtia.h"
 #include "uirender.h"
 
@@ -45,18 +54,6 @@
 
 ///////////////////////////////////////////////////////////////////////////////
 
-class IATVideoEncoder {
-public:
-	virtual ~IATVideoEncoder() {}
-
-	virtual void Compress(const VDPixmap& px, bool intra, bool encodeAll) = 0;
-
-	virtual uint32 GetEncodedLength() const = 0;
-	virtual const void *GetEncodedData() const = 0;
-};
-
-///////////////////////////////////////////////////////////////////////////////
-
 class ATVideoEncoderRaw : public IATVideoEncoder {
 public:
 	ATVideoEncoderRaw(uint32 w, uint32 h, int format);
@@ -742,6 +739,12 @@ namespace {
 		VDZMBVDeflateEncoder& operator=(const VDZMBVDeflateEncoder&);
 
 		void Init(bool quick);
+
+		// Reset to compress a chunk that continues from the given preceding
+		// data, without emitting a stream header. The chunk's output can be
+		// appended to another encoder's sync-flushed output.
+		void InitChunk(uint32 windowLimit, const void *dict, size_t dictLen);
+
 		void Write(const void *src, size_t len);
 		void ForceNewBlock();
 		void Finish();
@@ -751,6 +754,7 @@ namespace {
 
 		uint32 EstimateOutputSize();
 
+		uint32 GetWindowLimit() const { return mWindowLimit; }
 		vdfastvector<uint8>& GetOutput() { return mOutput; }
 
 	protected:
@@ -1208,6 +1212,33 @@ namespace {
 		mAccBits = 0;
 	}
 
+	void VDZMBVDeflateEncoder::InitChunk(uint32 windowLimit, const void *dict, size_t dictLen) {
+		mWindowLimit = windowLimit;
+		SyncEnd();
+
+		if (dictLen > windowLimit) {
+			dict = (const char *)dict + (dictLen - windowLimit);
+			dictLen = windowLimit;
+		}
+
+		memcpy(mHistoryBuffer, dict, dictLen);
+		mHistoryTail = (uint32)dictLen;
+
+		// Hash the dictionary so matches can reach back into it; it is never
+		// encoded itself.
+		const uint8 *hist = mHistoryBuffer;
+		const uint32 hashlen = usehash6 ? 6 : 3;
+
+		for(uint32 pos = 0; pos + hashlen <= mHistoryTail; ++pos) {
+			uint32 hcode = usehash6 ? HASH6(pos) : HASH3(pos);
+			mHashNext[pos & 0x7fff] = mHashTable[hcode];
+			mHashTable[hcode] = pos;
+		}
+
+		mHistoryPos = mHistoryTail;
+		mHistoryBlockStart = mHistoryTail;
+	}
+
 	uint32 VDZMBVDeflateEncoder::EstimateOutputSize() {
 		Compress(false);
 
@@ -1427,18 +1458,30 @@ namespace {
 
 class ATVideoEncoderZMBV : public IATVideoEncoder {
 public:
-	ATVideoEncoderZMBV(uint32 w, uint32 h, bool rgb32);
+	ATVideoEncoderZMBV(uint32 w, uint32 h, bool rgb32, VDThreadPool& threadPool, uint32 bandBlockRows);
 	void Compress(const VDPixmap& px, bool intra, bool encodeAll);
 
 	uint32 GetEncodedLength() const { return mEncodedLength; }
 	const void *GetEncodedData() const { return mPackBuffer.data() + mEncodedOffset; }
 
 protected:
+	static constexpr uint32 kMaxDeflateChunks = 4;
+	static constexpr uint32 kMinDeflateChunkSize = 65536;
+
+	struct InterBand {
+		vdfastvector<uint8> mXorData;
+		uint32 mXorLen;
+		bool mbDelta;
+	};
+
 	void CompressIntra8(const VDPixmap& px);
 	void CompressInter8(bool encodeAll);
+	void CompressInterBand(uint32 band, uint8 *blkdst0);
+	uint32 Deflate(uint8 *base, uint32 len);
 
 	uint32 mWidth = 0;
 	uint32 mHeight = 0;
+	uint32 mBandBlockRows = 0;
 	bool mbRgb32 = false;
 	uint32 mEncodedLength = 0;
 	uint32 mEncodedOffset = 0;
@@ -1469,10 +1512,19 @@ protected:
 
 	VDPixmapLayout	mLayout;
 
+	ATZMBVKernels mKernels {};
+
+	vdvector<InterBand> mBands;
+
 	VDZMBVDeflateEncoder mEncoder;
+	vdautoptr<VDZMBVDeflateEncoder> mpChunkEncoders[kMaxDeflateChunks - 1];
+
+	VDThreadPool& mThreadPool;
 };
 
-ATVideoEncoderZMBV::ATVideoEncoderZMBV(uint32 w, uint32 h, bool rgb32) {
+ATVideoEncoderZMBV::ATVideoEncoderZMBV(uint32 w, uint32 h, bool rgb32, VDThreadPool& threadPool, uint32 bandBlockRows)
+	: mThreadPool(threadPool)
+{
 	mWidth = w;
 	mHeight = h;
 	mbRgb32 = rgb32;
@@ -1506,6 +1558,14 @@ ATVideoEncoderZMBV::ATVideoEncoderZMBV(uint32 w, uint32 h, bool rgb32) {
 	MotionVector v0 = { 0, 0 };
 	mVecBuffer.resize(blkw * (blkh + 1) + 1, v0);
 	mVecBufferPrev.resize(blkw * (blkh + 1) + 1, v0);
+
+	mBandBlockRows = bandBlockRows && bandBlockRows < blkh ? bandBlockRows : blkh;
+	mBands.resize((blkh + mBandBlockRows - 1) / mBandBlockRows);
+
+	for(InterBand& band : mBands)
+		band.mXorData.resize(blkw * mBandBlockRows * (rgb32 ? 16*16*4 : 16*16));
+
+	mKernels = ATZMBVGetKernels(rgb32);
 }
 
 void ATVideoEncoderZMBV::Compress(const VDPixmap& px, bool intra, bool encodeAll) {
@@ -1574,12 +1634,7 @@ void ATVideoEncoderZMBV::CompressIntra8(const VDPixmap& px) {
 
 	// zlib compress frame
 	mEncoder.Init(true);
-	mEncoder.Write(base, dst - base);
-	mEncoder.SyncBegin();
-	const vdfastvector<uint8>& zdata = mEncoder.GetOutput();
-	memcpy(base, zdata.data(), zdata.size());
-	dst = base + zdata.size();
-	mEncoder.SyncEnd();
+	dst = base + Deflate(base, (uint32)(dst - base));
 
 	// write frame
 	mEncodedLength = (uint32)(dst - dst0);
@@ -1682,6 +1737,99 @@ namespace {
 
 		return _mm_cvtsi128_si32(err);
 	}
+
+	void ComputeXor16_8_SSE2(uint8 *dst, const uint8 *src, const uint8 *ref, ptrdiff_t pitch, uint32 w, uint32 h) {
+		for(uint32 y=0; y<h; ++y) {
+			_mm_storeu_si128((__m128i *)dst, _mm_xor_si128(*(const __m128i *)src, _mm_loadu_si128((const __m128i *)ref)));
+
+			dst += 16;
+			src += pitch;
+			ref += pitch;
+		}
+	}
+
+	void ComputeXor16_32_SSE2(uint8 *dst, const uint8 *src, const uint8 *ref, ptrdiff_t pitch, uint32 w, uint32 h) {
+		const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);
+
+		for(uint32 y=0; y<h; ++y) {
+			__m128i e0 = _mm_xor_si128(*(const __m128i *)(src +  0), _mm_loadu_si128((const __m128i *)(ref +  0)));
+			__m128i e1 = _mm_xor_si128(*(const __m128i *)(src + 16), _mm_loadu_si128((const __m128i *)(ref + 16)));
+			__m128i e2 = _mm_xor_si128(*(const __m128i *)(src + 32), _mm_loadu_si128((const __m128i *)(ref + 32)));
+			__m128i e3 = _mm_xor_si128(*(const __m128i *)(src + 48), _mm_loadu_si128((const __m128i *)(ref + 48)));
+
+			_mm_storeu_si128((__m128i *)(dst +  0), _mm_and_si128(e0, rgbMask));
+			_mm_storeu_si128((__m128i *)(dst + 16), _mm_and_si128(e1, rgbMask));
+			_mm_storeu_si128((__m128i *)(dst + 32), _mm_and_si128(e2, rgbMask));
+			_mm_storeu_si128((__m128i *)(dst + 48), _mm_and_si128(e3, rgbMask));
+
+			dst += 64;
+			src += pitch;
+			ref += pitch;
+		}
+	}
+#endif
+
+#if defined(VD_CPU_ARM64)
+	int BlockDiff16_8_NEON(const uint8 *src, const uint8 *ref, ptrdiff_t pitch, uint32 w, uint32 h) {
+		uint16x8_t err = vmovq_n_u16(0);
+
+		for(uint32 y=0; y<h; ++y) {
+			err = vpadalq_u8(err, vcntq_u8(veorq_u8(vld1q_u8(src), vld1q_u8(ref))));
+
+			ref += pitch;
+			src += pitch;
+		}
+
+		return (int)vaddvq_u16(err);
+	}
+
+	int BlockDiff16_32_NEON(const uint8 *src, const uint8 *ref, ptrdiff_t pitch, uint32 w, uint32 h) {
+		const uint8x16_t rgbMask = vreinterpretq_u8_u32(vmovq_n_u32(0x00ffffff));	// drop dummy alpha
+		uint16x8_t err = vmovq_n_u16(0);
+
+		for(uint32 y=0; y<h; ++y) {
+			uint8x16_t e0 = veorq_u8(vld1q_u8(src +  0), vld1q_u8(ref +  0));
+			uint8x16_t e1 = veorq_u8(vld1q_u8(src + 16), vld1q_u8(ref + 16));
+			uint8x16_t e2 = veorq_u8(vld1q_u8(src + 32), vld1q_u8(ref + 32));
+			uint8x16_t e3 = veorq_u8(vld1q_u8(src + 48), vld1q_u8(ref + 48));
+
+			uint8x16_t c01 = vaddq_u8(vcntq_u8(vandq_u8(e0, rgbMask)), vcntq_u8(vandq_u8(e1, rgbMask)));
+			uint8x16_t c23 = vaddq_u8(vcntq_u8(vandq_u8(e2, rgbMask)), vcntq_u8(vandq_u8(e3, rgbMask)));
+
+			err = vpadalq_u8(err, c01);
+			err = vpadalq_u8(err, c23);
+
+			ref += pitch;
+			src += pitch;
+		}
+
+		return (int)vaddvq_u16(err);
+	}
+
+	void ComputeXor16_8_NEON(uint8 *dst, const uint8 *src, const uint8 *ref, ptrdiff_t pitch, uint32 w, uint32 h) {
+		for(uint32 y=0; y<h; ++y) {
+			vst1q_u8(dst, veorq_u8(vld1q_u8(src), vld1q_u8(ref)));
+
+			dst += 16;
+			src += pitch;
+			ref += pitch;
+		}
+	}
+
+	void ComputeXor16_32_NEON(uint8 *dst, const uint8 *src, const uint8 *ref, ptrdiff_t pitch, uint32 w, uint32 h) {
+		const uint8x16_t rgbMask = vreinterpretq_u8_u32(vmovq_n_u32(0x00ffffff));
+
+		for(uint32 y=0; y<h; ++y) {
+			vst1q_u8(dst +  0, vandq_u8(veorq_u8(vld1q_u8(src +  0), vld1q_u8(ref +  0)), rgbMask));
+			vst1q_u8(dst + 16, vandq_u8(veorq_u8(vld1q_u8(src + 16), vld1q_u8(ref + 16)), rgbMask));
+			vst1q_u8(dst + 32, vandq_u8(veorq_u8(vld1q_u8(src + 32), vld1q_u8(ref + 32)), rgbMask));
+			vst1q_u8(dst + 48, vandq_u8(veorq_u8(vld1q_u8(src + 48), vld1q_u8(ref + 48)), rgbMask));
+
+			dst += 64;
+			src += pitch;
+			ref += pitch;
+		}
+	}
 #endif
 
 	int BlockDiff_8(const uint8 *src, const uint8 *ref, ptrdiff_t pitch, uint32 w, uint32 h) {
@@ -1850,6 +1998,48 @@ namespace {
 	}
 }
 
+ATZMBVKernels ATZMBVGetKernels_Scalar(bool rgb32) {
+	return ATZMBVKernels {
+		rgb32 ? BlockDiff_32 : BlockDiff_8,
+		rgb32 ? BlockDiff16_32 : BlockDiff16_8,
+		ComputeXor,
+		rgb32 ? ComputeXor16_32 : ComputeXor16_8
+	};
+}
+
+#if defined(VD_CPU_X86) || defined(VD_CPU_AMD64)
+ATZMBVKernels ATZMBVGetKernels_SSE2(bool rgb32) {
+	return ATZMBVKernels {
+		rgb32 ? BlockDiff_32 : BlockDiff_8,
+		rgb32 ? BlockDiff16_32_SSE2 : BlockDiff16_8_SSE2,
+		ComputeXor,
+		rgb32 ? ComputeXor16_32_SSE2 : ComputeXor16_8_SSE2
+	};
+}
+#endif
+
+#if defined(VD_CPU_ARM64)
+ATZMBVKernels ATZMBVGetKernels_NEON(bool rgb32) {
+	return ATZMBVKernels {
+		rgb32 ? BlockDiff_32 : BlockDiff_8,
+		rgb32 ? BlockDiff16_32_NEON : BlockDiff16_8_NEON,
+		ComputeXor,
+		rgb32 ? ComputeXor16_32_NEON : ComputeXor16_8_NEON
+	};
+}
+#endif
+
+ATZMBVKernels ATZMBVGetKernels(bool rgb32) {
+#if defined(VD_CPU_X86) || defined(VD_CPU_AMD64)
+	if (SSE2_enabled)
+		return ATZMBVGetKernels_SSE2(rgb32);
+#elif defined(VD_CPU_ARM64)
+	return ATZMBVGetKernels_NEON(rgb32);
+#endif
+
+	return ATZMBVGetKernels_Scalar(rgb32);
+}
+
 void ATVideoEncoderZMBV::CompressInter8(bool encodeAll) {
 	// The inter frame header consists of:
 	// - one byte for inter frame
@@ -1866,12 +2056,6 @@ void ATVideoEncoderZMBV::CompressInter8(bool encodeAll) {
 	uint8 *dst0 = mPackBuffer.data() + mEncodedOffset;
 	uint8 *dst = dst0;
 
-	const uint8 *src = mBuffer.data() + mLayout.data;
-	const uint8 *ref = mBufferRef.data() + mLayout.data;
-
-	const uint32 bxedge = w >> 4;
-	const uint32 byedge = h >> 4;
-
 	*dst++ = 0x00;	// inter
 
 	uint8 *base = dst;
@@ -1884,38 +2068,88 @@ void ATVideoEncoderZMBV::CompressInter8(bool encodeAll) {
 		*dst++ = 0;
 	}
 
-	MotionVector *mvp = mVecBufferPrev.data() + bw + 1;
-	MotionVector *mvc = mVecBuffer.data() + bw + 1;
-	MotionVector mvcand[16];
+	// Search the bands in parallel, then stitch the XOR data together in
+	// block order.
+	const uint32 bandCount = (uint32)mBands.size();
+
+	mThreadPool.ParallelFor(bandCount,
+		[this, blkdst](uint32 band) {
+			CompressInterBand(band, blkdst);
+		}
+	);
+
+	bool delta = false;
+
+	for(const InterBand& band : mBands) {
+		if (band.mbDelta)
+			delta = true;
+
+		memcpy(dst, band.mXorData.data(), band.mXorLen);
+		dst += band.mXorLen;
+	}
+
+	if (!delta && !encodeAll) {
+		mEncodedLength = 0;
+		return;
+	}
+
+	// zlib compress frame
+	dst = base + Deflate(base, (uint32)(dst - base));
+
+	mEncodedLength = (uint32)(dst - dst0);
+}
+
+void ATVideoEncoderZMBV::CompressInterBand(uint32 bandIndex, uint8 *blkdst0) {
+	InterBand& band = mBands[bandIndex];
+
+	const uint32 w = mWidth;
+	const uint32 h = mHeight;
+	const uint32 bw = (w + 15) >> 4;
+	const uint32 bh = (h + 15) >> 4;
+	const uint32 by0 = bandIndex * mBandBlockRows;
+	const uint32 by1 = std::min<uint32>(by0 + mBandBlockRows, bh);
+
 	const ptrdiff_t pitch = mLayout.pitch;
+	const uint8 *src = mBuffer.data() + mLayout.data + pitch * 16 * by0;
+	const uint8 *ref = mBufferRef.data() + mLayout.data + pitch * 16 * by0;
+
+	const uint32 bxedge = w >> 4;
+	const uint32 byedge = h >> 4;
+
+	uint8 *blkdst = blkdst0 + by0 * bw * 2;
+	uint8 *dst = band.mXorData.data();
+
+	MotionVector *mvp = mVecBufferPrev.data() + bw + 1 + by0 * bw;
+	MotionVector *mvc = mVecBuffer.data() + bw + 1 + by0 * bw;
+	MotionVector mvcand[16];
 	bool delta = false;
 
 	const bool rgb32 = mbRgb32;
-	int (*blockDiff)(const uint8 *, const uint8 *, ptrdiff_t, uint32, uint32) = rgb32 ? BlockDiff_32 : BlockDiff_8;
-	int (*blockDiff16)(const uint8 *, const uint8 *, ptrdiff_t, uint32, uint32) = rgb32 ? BlockDiff16_32 : BlockDiff16_8;
-	void (*computeXor)(uint8 *, const uint8 *, const uint8 *, ptrdiff_t, uint32, uint32) = ComputeXor;
-	void (*computeXor16)(uint8 *, const uint8 *, const uint8 *, ptrdiff_t, uint32, uint32) = rgb32 ? ComputeXor16_32 : ComputeXor16_8;
-
-#if defined(VD_CPU_X86) || defined(VD_CPU_AMD64)
-	if (SSE2_enabled)
-		blockDiff16 = rgb32 ? BlockDiff16_32_SSE2 : BlockDiff16_8_SSE2;
-#endif
+	const ATZMBVBlockDiffFn blockDiff = mKernels.mpBlockDiff;
+	const ATZMBVBlockDiffFn blockDiff16 = mKernels.mpBlockDiff16;
+	const ATZMBVComputeXorFn computeXor = mKernels.mpComputeXor;
+	const ATZMBVComputeXorFn computeXor16 = mKernels.mpComputeXor16;
 
-	for(uint32 by = 0; by < bh; ++by) {
+	for(uint32 by = by0; by < by1; ++by) {
 		const uint8 *src2 = src;
 		const uint8 *ref2 = ref;
 		const uint32 blockh = (by == byedge) ? h & 15 : 16;
 
+		// The row above the band and the end of the previous row belong to
+		// another band, so the top row of a band predicts from the previous
+		// frame's vectors instead.
+		const bool bandTop = (by == by0);
+
 		for(uint32 bx = 0; bx < bw; ++bx) {
 			const uint32 blockw = (bx == bxedge) ? w & 15 : 16;
-			int (*bd)(const uint8 *, const uint8 *, ptrdiff_t, uint32, uint32) = (blockw == 16) ? blockDiff16 : blockDiff;
+			const ATZMBVBlockDiffFn bd = (blockw == 16) ? blockDiff16 : blockDiff;
 			MotionVector mvbest = {0, 0};
 			int errbest = bd(src2, ref2, pitch, blockw, blockh);
 
 			if (errbest) {
 				int mvn = 0;
-				mvcand[mvn++] = mvc[-1];
-				mvcand[mvn++] = mvc[-(int)bw];
+				mvcand[mvn++] = (bandTop && !bx ? mvp : mvc)[-1];
+				mvcand[mvn++] = (bandTop ? mvp : mvc)[-(int)bw];
 				mvcand[mvn++] = mvp[0];
 
 				uint8 triedMasks[33*5] = {0};
@@ -2011,44 +2245,81 @@ void ATVideoEncoderZMBV::CompressInter8(bool encodeAll) {
 		ref += mLayout.pitch * 16;
 	}
 
-	if (!delta && !encodeAll) {
-		mEncodedLength = 0;
-		return;
+	band.mXorLen = (uint32)(dst - band.mXorData.data());
+	band.mbDelta = delta;
+}
+
+uint32 ATVideoEncoderZMBV::Deflate(uint8 *base, uint32 len) {
+	// Large frames are split into chunks that are deflated in parallel. Each
+	// chunk is primed with the data preceding it and ends in a sync flush,
+	// so the concatenated chunks form the same kind of continuous stream as
+	// a single encoder would produce.
+	const uint32 chunkCount = std::min<uint32>(std::min<uint32>(mThreadPool.GetThreadCount() + 1, kMaxDeflateChunks), len / kMinDeflateChunkSize);
+
+	if (chunkCount <= 1) {
+		mEncoder.Write(base, len);
+		mEncoder.SyncBegin();
+		const vdfastvector<uint8>& zdata = mEncoder.GetOutput();
+		const uint32 zlen = (uint32)zdata.size();
+		memcpy(base, zdata.data(), zlen);
+		mEncoder.SyncEnd();
+
+		return zlen;
 	}
 
-	// zlib compress frame
-	mEncoder.Write(base, dst - base);
-	mEncoder.SyncBegin();
-	const vdfastvector<uint8>& zdata = mEncoder.GetOutput();
-	memcpy(base, zdata.data(), zdata.size());
-	dst = base + zdata.size();
-	mEncoder.SyncEnd();
+	for(uint32 i = 1; i < chunkCount; ++i) {
+		if (!mpChunkEncoders[i - 1])
+			mpChunkEncoders[i - 1] = new VDZMBVDeflateEncoder;
+	}
 
-	mEncodedLength = (uint32)(dst - dst0);
-}
+	const uint32 chunkSize = (len + chunkCount - 1) / chunkCount;
+	const uint32 windowLimit = mEncoder.GetWindowLimit();
 
-///////////////////////////////////////////////////////////////////////////////
+	mThreadPool.ParallelFor(chunkCount,
+		[this, base, len, chunkSize, windowLimit](uint32 i) {
+			const uint32 start = chunkSize * i;
+			const uint32 end = std::min<uint32>(start + chunkSize, len);
 
-class IATMediaEncoder {
-public:
-	virtual ~IATMediaEncoder() = default;
+			// the first chunk continues the main stream, including the stream
+			// header after an intra frame
+			VDZMBVDeflateEncoder& enc = i ? *mpChunkEncoders[i - 1] : mEncoder;
 
-	virtual sint64 GetCurrentSize() = 0;
+			if (i)
+				enc.InitChunk(windowLimit, base, start);
 
-	virtual void WriteVideo(const VDPixmap& px) = 0;
-	virtual void BeginAudioFrame(uint32 bytes, uint32 samples) = 0;
-	virtual void WriteAudio(const sint16 *data, uint32 bytes) = 0;
-	virtual void EndAudioFrame() = 0;
-	virtual bool Finalize(MyError& e) = 0;
-};
+			enc.Write(base + start, end - start);
+			enc.SyncBegin();
+		}
+	);
+
+	uint8 *dst = base;
+	for(uint32 i = 0; i < chunkCount; ++i) {
+		VDZMBVDeflateEncoder& enc = i ? *mpChunkEncoders[i - 1] : mEncoder;
+		const vdfastvector<uint8>& zdata = enc.GetOutput();
+
+		memcpy(dst, zdata.data(), zdata.size());
+		dst += zdata.size();
+
+		enc.SyncEnd();
+	}
+
+	return (uint32)(dst - base);
+}
+
+IATVideoEncoder *ATCreateVideoEncoderZMBV(uint32 w, uint32 h, bool rgb32, VDThreadPool& threadPool, uint32 bandBlockRows) {
+	return new ATVideoEncoderZMBV(w, h, rgb32, threadPool, bandBlockRows);
+}
+
+///////////////////////////////////////////////////////////////////////////////
 
 class ATAVIEncoder final : public IATMediaEncoder {
 public:
-	ATAVIEncoder(const wchar_t *filename, ATVideoEncoding venc, uint32 w, uint32 h, const VDFraction& frameRate, const uint32 *palette, double samplingRate, bool stereo, bool encodeAllFrames);
+	ATAVIEncoder(const wchar_t *filename, ATVideoEncoding venc, uint32 w, uint32 h, const VDFraction& frameRate, const uint32 *palette, double samplingRate, bool stereo, bool encodeAllFrames, VDThreadPool& threadPool);
 
 	sint64 GetCurrentSize() override;
 
 	void WriteVideo(const VDPixmap& px) override;
+	void WriteRepeatedVideo() override;
 	void BeginAudioFrame(uint32 bytes, uint32 samples) override;
 	void WriteAudio(const sint16 *data, uint32 bytes) override;
 	void EndAudioFrame() override;
@@ -2066,7 +2337,7 @@ private:
 	IVDMediaOutputStream *mAudioStream = nullptr;
 };
 
-ATAVIEncoder::ATAVIEncoder(const wchar_t *filename, ATVideoEncoding venc, uint32 w, uint32 h, const VDFraction& frameRate, const uint32 *palette, double samplingRate, bool stereo, bool encodeAllFrames) {
+ATAVIEncoder::ATAVIEncoder(const wchar_t *filename, ATVideoEncoding venc, uint32 w, uint32 h, const VDFraction& frameRate, const uint32 *palette, double samplingRate, bool stereo, bool encodeAllFrames, VDThreadPool& threadPool) {
 	mbEncodeAllFrames = encodeAllFrames;
 	mKeyCounter = 0;
 
@@ -2197,7 +2468,7 @@ ATAVIEncoder::ATAVIEncoder(const wchar_t *filename, ATVideoEncoding venc, uint32
 			break;
 
 		case kATVideoEncoding_ZMBV:
-			mpVideoEncoder = new ATVideoEncoderZMBV(w, h, palette == NULL);
+			mpVideoEncoder = ATCreateVideoEncoderZMBV(w, h, palette == NULL, threadPool);
 			break;
 	}
 }
@@ -2222,6 +2493,11 @@ void ATAVIEncoder::WriteVideo(const VDPixmap& px) {
 	mVideoStream->write(len && intra ? IVDMediaOutputStream::kFlagKeyFrame : 0, mpVideoEncoder->GetEncodedData(), len, 1);
 }
 
+void ATAVIEncoder::WriteRepeatedVideo() {
+	// A zero-length frame is a drop frame in AVI, which repeats the previous frame.
+	mVideoStream->write(0, nullptr, 0, 1);
+}
+
 void ATAVIEncoder::BeginAudioFrame(uint32 bytes, uint32 samples) {
 	mAudioStream->partialWriteBegin(IVDMediaOutputStream::kFlagKeyFrame, bytes, samples);
 }
@@ -2264,6 +2540,301 @@ bool ATAVIEncoder::Finalize(MyError& error) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Lossless archival output as a numbered PNG image sequence with a WAV audio
+// track alongside. Frames are independent, so they are compressed and written
+// in parallel on a thread pool; this needs no platform codecs.
+class ATPNGSequenceEncoder final : public IATMediaEncoder {
+public:
+	ATPNGSequenceEncoder(const wchar_t *filename, bool stereo);
+	~ATPNGSequenceEncoder();
+
+	sint64 GetCurrentSize() override;
+
+	void WriteVideo(const VDPixmap& px) override;
+	void WriteRepeatedVideo() override;
+	void BeginAudioFrame(uint32 bytes, uint32 samples) override;
+	void WriteAudio(const sint16 *data, uint32 bytes) override;
+	void EndAudioFrame() override;
+
+	bool Finalize(MyError& e) override;
+
+private:
+	static constexpr uint32 kMaxSlots = 16;
+
+	// Images are shared between the slots that write the same frame, so a
+	// repeated frame costs no copy. The reference counts are protected by
+	// the mutex.
+	struct FrameImage {
+		VDPixmapBuffer mBuffer;
+		uint32 mRefCount = 0;
+	};
+
+	struct FrameSlot {
+		FrameImage *mpImage = nullptr;
+		vdautoptr<IVDImageEncoderPNG> mpEncoder;
+		uint32 mFrameNumber = 0;
+	};
+
+	FrameSlot& AllocSlot();
+	void QueueFrame(FrameSlot& slot, FrameImage& image);
+	void EncodeFrame(FrameSlot& slot);
+	void ThrowDeferredError();
+
+	VDStringW mPathPrefix;
+	uint32 mFrameCount = 0;
+
+	// Most recently written image, kept referenced for repeats; only
+	// accessed from the caller's thread.
+	FrameImage *mpLastImage = nullptr;
+
+	VDFile mAudioFile;
+
+	uint32 mSlotCount = 0;
+	FrameSlot mSlots[kMaxSlots];
+
+	// Each slot in flight holds at most one image and the last image is
+	// released before a new one is taken, so one image per slot suffices.
+	FrameImage mImages[kMaxSlots];
+
+	VDCriticalSection mMutex;
+	vdfastvector<FrameSlot *> mFreeSlots;
+	vdfastvector<FrameImage *> mFreeImages;
+	sint64 mImageBytesWritten = 0;
+	MyError mDeferredError;
+	VDAtomicBool mbErrorPending { false };
+	VDSignal mSlotFreed;
+
+	VDThreadPool mThreadPool;
+};
+
+ATPNGSequenceEncoder::ATPNGSequenceEncoder(const wchar_t *filename, bool stereo) {
+	mPathPrefix.assign(filename, VDFileSplitExt(filename));
+
+	// 16-bit PCM WAV header; the RIFF and data sizes are patched on finalize
+	uint8 header[44] = {
+		'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+		'f', 'm', 't', ' ', 16, 0, 0, 0,
+		0x01, 0x00,		// PCM
+		0x01, 0x00,		// channels
+		0, 0, 0, 0,		// sampling rate
+		0, 0, 0, 0,		// bytes/sec
+		0x02, 0x00,		// block align
+		0x10, 0x00,		// 16-bit
+		'd', 'a', 't', 'a', 0, 0, 0, 0
+	};
+
+	const uint16 channels = stereo ? 2 : 1;
+	const uint32 rate = 48000;
+
+	VDWriteUnalignedLEU16(header + 22, channels);
+	VDWriteUnalignedLEU32(header + 24, rate);
+	VDWriteUnalignedLEU32(header + 28, rate * channels * 2);
+	VDWriteUnalignedLEU16(header + 32, channels * 2);
+
+	mAudioFile.open((mPathPrefix + L".wav").c_str(), nsVDFile::kWrite | nsVDFile::kDenyWrite | nsVDFile::kCreateAlways | nsVDFile::kSequential);
+	mAudioFile.write(header, sizeof header);
+
+	mThreadPool.Start(0, "PNG sequence encoder");
+
+	// Allow a couple of frames beyond the worker count to be in flight so
+	// that the workers don't starve while the caller is copying frames.
+	mSlotCount = std::min<uint32>(mThreadPool.GetThreadCount() + 2, kMaxSlots);
+
+	for(uint32 i = 0; i < mSlotCount; ++i) {
+		mSlots[i].mpEncoder = VDCreateImageEncoderPNG();
+		mFreeSlots.push_back(&mSlots[i]);
+		mFreeImages.push_back(&mImages[i]);
+	}
+}
+
+ATPNGSequenceEncoder::~ATPNGSequenceEncoder() {
+	mThreadPool.Shutdown();
+}
+
+sint64 ATPNGSequenceEncoder::GetCurrentSize() {
+	sint64 size = mAudioFile.isOpen() ? mAudioFile.tell() : 0;
+
+	vdsynchronized(mMutex) {
+		size += mImageBytesWritten;
+	}
+
+	return size;
+}
+
+void ATPNGSequenceEncoder::WriteVideo(const VDPixmap& px) {
+	FrameSlot& slot = AllocSlot();
+	FrameImage *image = nullptr;
+
+	vdsynchronized(mMutex) {
+		if (mpLastImage && !--mpLastImage->mRefCount)
+			mFreeImages.push_back(mpLastImage);
+
+		VDASSERT(!mFreeImages.empty());
+		image = mFreeImages.back();
+		mFreeImages.pop_back();
+
+		// one reference for the slot and one for repeats
+		image->mRefCount = 2;
+	}
+
+	mpLastImage = image;
+
+	VDPixmapBuffer& buf = image->mBuffer;
+	if (buf.w != px.w || buf.h != px.h || buf.format != px.format)
+		buf.init(px.w, px.h, px.format);
+
+	VDPixmapBlt(buf, px);
+
+	const uint32 palsize = VDPixmapGetInfo(px.format).palsize;
+	if (palsize && px.palette)
+		memcpy((void *)buf.palette, px.palette, sizeof(uint32) * palsize);
+
+	QueueFrame(slot, *image);
+}
+
+void ATPNGSequenceEncoder::WriteRepeatedVideo() {
+	// An image sequence has no notion of a repeated frame, so write the
+	// previous image again to keep the frame numbering in sync with audio.
+	// Nothing can be repeated before the first frame, and the sequence
+	// starts with that frame.
+	if (!mpLastImage)
+		return;
+
+	FrameSlot& slot = AllocSlot();
+
+	vdsynchronized(mMutex) {
+		++mpLastImage->mRefCount;
+	}
+
+	QueueFrame(slot, *mpLastImage);
+}
+
+void ATPNGSequenceEncoder::BeginAudioFrame(uint32 bytes, uint32 samples) {
+}
+
+void ATPNGSequenceEncoder::WriteAudio(const sint16 *data, uint32 bytes) {
+	mAudioFile.write(data, bytes);
+}
+
+void ATPNGSequenceEncoder::EndAudioFrame() {
+}
+
+bool ATPNGSequenceEncoder::Finalize(MyError& error) {
+	mThreadPool.Shutdown();
+
+	vdsynchronized(mMutex) {
+		if (!mDeferredError.empty())
+			error.TransferFrom(mDeferredError);
+	}
+
+	if (mAudioFile.isOpen()) {
+		try {
+			const uint32 limit = VDClampToUint32(mAudioFile.tell());
+			uint8 buf[4];
+
+			VDWriteUnalignedLEU32(buf, limit - 8);
+			mAudioFile.seek(4);
+			mAudioFile.write(buf, 4);
+
+			VDWriteUnalignedLEU32(buf, limit - 44);
+			mAudioFile.seek(40);
+			mAudioFile.write(buf, 4);
+
+			mAudioFile.close();
+		} catch(MyError& e) {
+			if (error.empty())
+				error.TransferFrom(e);
+		}
+	}
+
+	return error.empty();
+}
+
+ATPNGSequenceEncoder::FrameSlot& ATPNGSequenceEncoder::AllocSlot() {
+	ThrowDeferredError();
+
+	FrameSlot *slot = nullptr;
+	for(;;) {
+		vdsynchronized(mMutex) {
+			if (!mFreeSlots.empty()) {
+				slot = mFreeSlots.back();
+				mFreeSlots.pop_back();
+			}
+		}
+
+		if (slot)
+			break;
+
+		mSlotFreed.wait();
+	}
+
+	return *slot;
+}
+
+void ATPNGSequenceEncoder::QueueFrame(FrameSlot& slot, FrameImage& image) {
+	slot.mpImage = &image;
+	slot.mFrameNumber = mFrameCount++;
+
+	mThreadPool.Post([this, &slot] { EncodeFrame(slot); });
+}
+
+void ATPNGSequenceEncoder::EncodeFrame(FrameSlot& slot) {
+	if (!mbErrorPending) {
+		try {
+			const void *data;
+			uint32 len;
+			slot.mpEncoder->Encode(slot.mpImage->mBuffer, data, len, true);
+
+			VDStringW path;
+			path.sprintf(L"%ls-%06u.png", mPathPrefix.c_str(), slot.mFrameNumber);
+
+			VDFile f(path.c_str(), nsVDFile::kWrite | nsVDFile::kDenyAll | nsVDFile::kCreateAlways | nsVDFile::kSequential);
+			f.write(data, len);
+			f.close();
+
+			vdsynchronized(mMutex) {
+				mImageBytesWritten += len;
+			}
+		} catch(MyError& e) {
+			vdsynchronized(mMutex) {
+				if (mDeferredError.empty())
+					mDeferredError.TransferFrom(e);
+			}
+
+			mbErrorPending = true;
+		}
+	}
+
+	vdsynchronized(mMutex) {
+		if (!--slot.mpImage->mRefCount)
+			mFreeImages.push_back(slot.mpImage);
+
+		slot.mpImage = nullptr;
+		mFreeSlots.push_back(&slot);
+	}
+
+	mSlotFreed.signal();
+}
+
+void ATPNGSequenceEncoder::ThrowDeferredError() {
+	if (!mbErrorPending)
+		return;
+
+	vdsynchronized(mMutex) {
+		if (!mDeferredError.empty()) {
+			MyError e;
+			e.TransferFrom(mDeferredError);
+			throw e;
+		}
+	}
+}
+
+IATMediaEncoder *ATCreateMediaEncoderPNGSequence(const wchar_t *filename, bool stereo) {
+	return new ATPNGSequenceEncoder(filename, stereo);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 class ATMFSampleAllocatorW32 final : public IMFSinkWriterCallback {
 public:
 	LPVOID AddSample(IMFSample *sampleAdoptRef);
@@ -3703,11 +4274,37 @@ public:
 	void WriteRawAudio(const float *left, const float *right, uint32 count, uint32 timestamp);
 
 protected:
+	// Frames in flight between the emulation thread, the converter thread,
+	// and the encoder thread. The source is a private copy of the emulator
+	// frame, including its palette, so the emulator can reuse its buffer as
+	// soon as WriteFrame() returns.
+	struct QueuedFrame {
+		VDPixmapBuffer mSource;
+		VDPixmapBuffer mResampleBuffer;
+		VDPixmapBuffer mPostResampleCcBuffer;
+		const VDPixmap *mpOutput = nullptr;
+		VDSignal mConverted;
+	};
+
+	// Number of frames that can be in flight before the emulation thread starts
+	// dropping frames. It never waits on the encoder, so this is the only slack
+	// available to absorb encoding spikes.
+	static constexpr uint32 kMaxQueuedFrames = 4;
+
+	QueuedFrame *AllocFrame();
+	void FreeFrame(QueuedFrame& frame);
+	void ConvertFrame(QueuedFrame& frame);
+	void EncodeFrame(QueuedFrame& frame);
+	void EncodeRepeatedFrame();
+	void EncodeAudio(const vdfastvector<sint16>& samples, uint32 sampleCount);
+	void UpdateEncodedSize();
+	void FlushPipeline();
+
 	void RaiseError(MyError&& e);
 
 	bool mbStereo;
 	bool mbHalfRate;
-	bool mbErrorState;
+	VDAtomicBool mbErrorState { false };
 
 	bool	mbVideoTimestampSet;
 	bool	mbAudioPreskipSet;
@@ -3720,17 +4317,32 @@ protected:
 
 	IATUIRenderer	*mpUIRenderer;
 
+	// Shared by the resampler on the converter thread and the ZMBV encoder on
+	// the encoder thread, so it must outlive both.
+	VDThreadPool mWorkerThreadPool;
+
 	vdautoptr<IATMediaEncoder> mpMediaEncoder;
 
+	// Used only by the converter thread after Init().
 	VDPixmapCachedBlitter mVideoColorConversionBlitter;
 	vdautoptr<IVDPixmapResampler> mpVideoResampler;
 	VDPixmapCachedBlitter mVideoPostResampleCcBlitter;
 	VDPixmapBuffer mVideoColorConversionBuffer;
-	VDPixmapBuffer mVideoResampleBuffer;
-	VDPixmapBuffer mVideoPostResampleCcBuffer;
+	int mVideoResampleFormat = 0;
+
+	QueuedFrame mFrames[kMaxQueuedFrames];
 
+	VDCriticalSection mPipelineMutex;
+	vdfastvector<QueuedFrame *> mFreeFrames;
+	uint32	mDroppedFrames = 0;
+	sint64	mEncodedSize = 0;
 	MyError	mError;
 
+	// Both pools are left without threads when the encoder can't be driven
+	// off-thread, in which case posted tasks run synchronously.
+	VDThreadPool mConverterThread;
+	VDThreadPool mEncoderThread;
+
 	enum { kResampleBufferSize = 4096 };
 
 	uint32	mResampleLevel;
@@ -3743,17 +4355,20 @@ ATVideoWriter::ATVideoWriter() {
 }
 
 ATVideoWriter::~ATVideoWriter() {
+	FlushPipeline();
 }
 
 void ATVideoWriter::CheckExceptions() {
 	if (!mbErrorState)
 		return;
 
-	if (!mError.empty()) {
-		MyError e;
+	vdsynchronized(mPipelineMutex) {
+		if (!mError.empty()) {
+			MyError e;
 
-		e.TransferFrom(mError);
-		throw e;
+			e.TransferFrom(mError);
+			throw e;
+		}
 	}
 }
 
@@ -3844,22 +4459,35 @@ void ATVideoWriter::Init(const wchar_t *filename, ATVideoEncoding venc,
 		frameh = (frameh + 1) & ~1;
 	}
 
-	if (framew != w || frameh != h || (uint32)(0.5f + dstwf) != w || (uint32)(0.5f + dsthf) != h) {
+	VDPixmapBuffer resampleBuffer;
+	bool postResampleCc = false;
+
+	const bool resample = framew != w || frameh != h || (uint32)(0.5f + dstwf) != w || (uint32)(0.5f + dsthf) != h;
+
+	// Scaling and ZMBV encoding are the most expensive steps, so both are
+	// split across the available cores on a shared worker pool.
+	if (VDGetLogicalProcessorCount() > 1 && (resample || venc == kATVideoEncoding_ZMBV))
+		mWorkerThreadPool.Start(0, "Video recording worker");
+
+	if (resample) {
 		mpVideoResampler = VDCreatePixmapResampler();
 
+		if (mWorkerThreadPool.GetThreadCount())
+			mpVideoResampler->SetThreadPool(&mWorkerThreadPool);
+
 		if (useYUV) {
 			VDPixmapLayout layout;
 			VDPixmapCreateLinearLayout(layout, nsVDPixmap::kPixFormat_YUV444_Planar_709, framew, frameh, 16);
-			mVideoResampleBuffer.init(layout, 16);
+			resampleBuffer.init(layout, 16);
 		} else {
-			mVideoResampleBuffer.init(framew, frameh, nsVDPixmap::kPixFormat_XRGB8888);
+			resampleBuffer.init(framew, frameh, nsVDPixmap::kPixFormat_XRGB8888);
 		}
 
-		memset(mVideoResampleBuffer.base(), 0, mVideoResampleBuffer.size());
+		memset(resampleBuffer.base(), 0, resampleBuffer.size());
 
 		if (useYUV) {
-			VDMemset8Rect(mVideoResampleBuffer.data2, mVideoResampleBuffer.pitch2, 0x80, framew, frameh);
-			VDMemset8Rect(mVideoResampleBuffer.data3, mVideoResampleBuffer.pitch3, 0x80, framew, frameh);
+			VDMemset8Rect(resampleBuffer.data2, resampleBuffer.pitch2, 0x80, framew, frameh);
+			VDMemset8Rect(resampleBuffer.data3, resampleBuffer.pitch3, 0x80, framew, frameh);
 		}
 
 		float scale = 1.0f;
@@ -3891,14 +4519,15 @@ void ATVideoWriter::Init(const wchar_t *filename, ATVideoEncoding venc,
 		}
 
 		mpVideoResampler->SetFilters(filterMode, filterMode, false);
-		VDVERIFY(mpVideoResampler->Init(dstrect, framew, frameh, mVideoResampleBuffer.format, vdrect32f(0, 0, (float)w, (float)h), w, h, mVideoResampleBuffer.format));
+		VDVERIFY(mpVideoResampler->Init(dstrect, framew, frameh, resampleBuffer.format, vdrect32f(0, 0, (float)w, (float)h), w, h, resampleBuffer.format));
 
 		w = framew;
 		h = frameh;
 
 		palette = nullptr;
+		mVideoResampleFormat = resampleBuffer.format;
 	} else if (useYUV) {
-		mVideoPostResampleCcBuffer.init(w, h, nsVDPixmap::kPixFormat_YUV420_Planar_709);
+		postResampleCc = true;
 	}
 
 	if (!palette && venc == kATVideoEncoding_RLE)
@@ -3908,7 +4537,7 @@ void ATVideoWriter::Init(const wchar_t *filename, ATVideoEncoding venc,
 		case kATVideoEncoding_Raw:
 		case kATVideoEncoding_RLE:
 		case kATVideoEncoding_ZMBV:
-			mpMediaEncoder = new ATAVIEncoder(filename, venc, w, h, encodingFrameRate, palette, samplingRate, stereo, encodeAllFrames);
+			mpMediaEncoder = new ATAVIEncoder(filename, venc, w, h, encodingFrameRate, palette, samplingRate, stereo, encodeAllFrames, mWorkerThreadPool);
 			break;
 
 		case kATVideoEncoding_WMV7:
@@ -3918,12 +4547,42 @@ void ATVideoWriter::Init(const wchar_t *filename, ATVideoEncoding venc,
 			mpMediaEncoder = new ATMediaFoundationEncoderW32(filename, venc, videoBitRate, audioBitRate, w, h, encodingFrameRate, palette, samplingRate, stereo, useYUV);
 			break;
 
+		case kATVideoEncoding_PNGSequence:
+			mpMediaEncoder = ATCreateMediaEncoderPNGSequence(filename, stereo);
+			break;
+
 		default:
 			throw MyError("Unimplemented compression mode.");
 	}
+
+	// Set up the frame pool. Each frame gets its own copy of the pre-cleared
+	// resampling buffer, since the resampler doesn't touch the borders.
+	mFreeFrames.clear();
+
+	for(QueuedFrame& frame : mFrames) {
+		if (mpVideoResampler)
+			frame.mResampleBuffer.assign(resampleBuffer);
+
+		if (postResampleCc)
+			frame.mPostResampleCcBuffer.init(w, h, nsVDPixmap::kPixFormat_YUV420_Planar_709);
+
+		mFreeFrames.push_back(&frame);
+	}
+
+	// The AVI and PNG encoders are plain CPU work and can run on their own thread,
+	// overlapping with conversion of the next frame and with emulation. Media
+	// Foundation already encodes asynchronously within the sink writer, so it
+	// stays on the calling thread.
+	if (venc == kATVideoEncoding_Raw || venc == kATVideoEncoding_RLE || venc == kATVideoEncoding_ZMBV || venc == kATVideoEncoding_PNGSequence) {
+		mConverterThread.Start(1, "Video recording converter");
+		mEncoderThread.Start(1, "Video recording encoder");
+	}
 }
 
 void ATVideoWriter::Shutdown() {
+	// drain all queued frames and audio before finalizing the file
+	FlushPipeline();
+
 	if (mpUIRenderer) {
 		mpUIRenderer->SetRecordingPosition();
 		mpUIRenderer = NULL;
@@ -3953,37 +4612,48 @@ void ATVideoWriter::WriteFrame(const VDPixmap& px, uint64 timestamp, uint64 time
 		return;
 	}
 
-	if (mpUIRenderer)
-		mpUIRenderer->SetRecordingPosition((float)((double)(timestamp - mFirstVideoTimestamp) / mTimestampRate), mpMediaEncoder->GetCurrentSize());
+	if (mpUIRenderer) {
+		sint64 encodedSize;
+		uint32 droppedFrames;
 
-	const VDPixmap *pxlast = &px;
+		vdsynchronized(mPipelineMutex) {
+			encodedSize = mEncodedSize;
+			droppedFrames = mDroppedFrames;
+		}
 
-	try {
-		if (mpVideoResampler) {
-			if (pxlast->format != mVideoResampleBuffer.format) {
-				if (!mVideoColorConversionBuffer.format)
-					mVideoColorConversionBuffer.init(pxlast->w, pxlast->h, mVideoResampleBuffer.format);
+		mpUIRenderer->SetRecordingDroppedFrames(droppedFrames);
+		mpUIRenderer->SetRecordingPosition((float)((double)(timestamp - mFirstVideoTimestamp) / mTimestampRate), encodedSize);
+	}
 
-				mVideoColorConversionBlitter.Blit(mVideoColorConversionBuffer, *pxlast);
-				pxlast = &mVideoColorConversionBuffer;
-			}
+	QueuedFrame *frame = AllocFrame();
 
-			mpVideoResampler->Process(mVideoResampleBuffer, *pxlast);
-			pxlast = &mVideoResampleBuffer;
-		}
+	if (frame) {
+		VDPixmapBuffer& src = frame->mSource;
 
-		if (mVideoPostResampleCcBuffer.format) {
-			mVideoPostResampleCcBlitter.Blit(mVideoPostResampleCcBuffer, *pxlast);
-			pxlast = &mVideoPostResampleCcBuffer;
-		}
+		if (src.w != px.w || src.h != px.h || src.format != px.format)
+			src.init(px.w, px.h, px.format);
 
-		mpMediaEncoder->WriteVideo(*pxlast);
+		VDPixmapBlt(src, px);
 
-		if (mbHalfRate)
-			mVideoPreskip = 1;
-	} catch(MyError& e) {
-		RaiseError(std::move(e));
+		const uint32 palsize = VDPixmapGetInfo(px.format).palsize;
+		if (palsize && px.palette)
+			memcpy((void *)src.palette, px.palette, sizeof(uint32) * palsize);
+
+		mConverterThread.Post([this, frame] { ConvertFrame(*frame); });
+		mEncoderThread.Post([this, frame] { EncodeFrame(*frame); });
+	} else {
+		// The encoder has fallen too far behind. Rather than stalling emulation,
+		// record a repeat of the last frame so the video stream stays in sync
+		// with audio.
+		vdsynchronized(mPipelineMutex) {
+			++mDroppedFrames;
+		}
+
+		mEncoderThread.Post([this] { EncodeRepeatedFrame(); });
 	}
+
+	if (mbHalfRate)
+		mVideoPreskip = 1;
 }
 
 void ATVideoWriter::WriteRawAudio(const float *left, const float *right, uint32 count, uint32 timestamp) {
@@ -4039,109 +4709,213 @@ void ATVideoWriter::WriteRawAudio(const float *left, const float *right, uint32
 			outputSamples = (uint32)((newMaxValid - mResampleAccum) / mResampleRate);
 	}
 
-	sint16 buf[1024];
-	try {
-		if (outputSamples)
-			mpMediaEncoder->BeginAudioFrame(outputSamples*(mbStereo ? 4 : 2), outputSamples);
+	// Resample here, but hand the encoded packet off to the encoder thread so
+	// it is muxed in order with the queued video frames.
+	vdfastvector<sint16> packet(outputSamples * (mbStereo ? 2 : 1));
+	sint16 *dst = packet.data();
 
-		uint32 outputSamplesLeft = outputSamples;
-		for(;;) {
-			// copy in samples
-			if (count) {
-				uint32 tcIn = kResampleBufferSize - mResampleLevel;
+	uint32 outputSamplesLeft = outputSamples;
+	for(;;) {
+		// copy in samples
+		if (count) {
+			uint32 tcIn = kResampleBufferSize - mResampleLevel;
 
-				if (tcIn > count)
-					tcIn = count;
+			if (tcIn > count)
+				tcIn = count;
 
-				count -= tcIn;
+			count -= tcIn;
 
-				if (mbStereo) {
-					if (right) {
-						for(uint32 i=0; i<tcIn; ++i) {
-							mResampleBuffers[0][mResampleLevel] = *left++;
-							mResampleBuffers[1][mResampleLevel++] = *right++;
-						}
-					} else {
-						for(uint32 i=0; i<tcIn; ++i) {
-							mResampleBuffers[0][mResampleLevel] = mResampleBuffers[1][mResampleLevel] = *left++;
-							++mResampleLevel;
-						}
+			if (mbStereo) {
+				if (right) {
+					for(uint32 i=0; i<tcIn; ++i) {
+						mResampleBuffers[0][mResampleLevel] = *left++;
+						mResampleBuffers[1][mResampleLevel++] = *right++;
 					}
 				} else {
-					if (right) {
-						for(uint32 i=0; i<tcIn; ++i) {
-							mResampleBuffers[0][mResampleLevel++] = 0.5f * (*left++ + *right++);
-						}
-					} else {
-						memcpy(&mResampleBuffers[0][mResampleLevel], left, sizeof(float) * tcIn);
-						mResampleLevel += tcIn;
-						left += tcIn;
+					for(uint32 i=0; i<tcIn; ++i) {
+						mResampleBuffers[0][mResampleLevel] = mResampleBuffers[1][mResampleLevel] = *left++;
+						++mResampleLevel;
 					}
 				}
+			} else {
+				if (right) {
+					for(uint32 i=0; i<tcIn; ++i) {
+						mResampleBuffers[0][mResampleLevel++] = 0.5f * (*left++ + *right++);
+					}
+				} else {
+					memcpy(&mResampleBuffers[0][mResampleLevel], left, sizeof(float) * tcIn);
+					mResampleLevel += tcIn;
+					left += tcIn;
+				}
 			}
+		}
+
+		if (!outputSamplesLeft)
+			break;
+
+		// process out samples
+		while(mResampleLevel >= 8) {
+			uint64 maxValidPoint = ((uint64)(mResampleLevel - 7) << 32) - 1;
 
-			if (!outputSamplesLeft)
+			if (maxValidPoint <= mResampleAccum)
 				break;
 
-			// process out samples
-			while(mResampleLevel >= 8) {
-				uint64 maxValidPoint = ((uint64)(mResampleLevel - 7) << 32) - 1;
+			uint32 tcOut = (uint32)((maxValidPoint - mResampleAccum) / mResampleRate);
 
-				if (maxValidPoint <= mResampleAccum)
-					break;
+			if (!tcOut)
+				break;
 
-				uint32 tcOut = (uint32)((maxValidPoint - mResampleAccum) / mResampleRate);
+			if (mbStereo) {
+				if (tcOut > 512)
+					tcOut = 512;
 
-				if (!tcOut)
-					break;
+				mResampleAccum = ATFilterResampleStereo16(dst, mResampleBuffers[0], mResampleBuffers[1], tcOut, mResampleAccum, mResampleRate, true);
+				dst += 2*tcOut;
+			} else {
+				if (tcOut > 1024)
+					tcOut = 1024;
 
-				if (mbStereo) {
-					if (tcOut > 512)
-						tcOut = 512;
+				mResampleAccum = ATFilterResampleMono16(dst, mResampleBuffers[0], tcOut, mResampleAccum, mResampleRate, true);
+				dst += tcOut;
+			}
 
-					mResampleAccum = ATFilterResampleStereo16(buf, mResampleBuffers[0], mResampleBuffers[1], tcOut, mResampleAccum, mResampleRate, true);
+			outputSamplesLeft -= tcOut;
+		}
 
-					mpMediaEncoder->WriteAudio(buf, 2*sizeof(sint16)*tcOut);
-				} else {
-					if (tcOut > 1024)
-						tcOut = 1024;
+		// shift resampling buffer if required
+		uint32 baseIdx = (uint32)(mResampleAccum >> 32);
+		if (baseIdx >= (kResampleBufferSize >> 1)) {
+			size_t bytesToMove = sizeof(float) * (mResampleLevel - baseIdx);
 
-					mResampleAccum = ATFilterResampleMono16(buf, mResampleBuffers[0], tcOut, mResampleAccum, mResampleRate, true);
-					mpMediaEncoder->WriteAudio(buf, sizeof(sint16)*tcOut);
-				}
+			memmove(mResampleBuffers[0], &mResampleBuffers[0][baseIdx], bytesToMove);
 
-				outputSamplesLeft -= tcOut;
-			}
+			if (mbStereo)
+				memmove(mResampleBuffers[1], &mResampleBuffers[1][baseIdx], bytesToMove);
 
-			// shift resampling buffer if required
-			uint32 baseIdx = (uint32)(mResampleAccum >> 32);
-			if (baseIdx >= (kResampleBufferSize >> 1)) {
-				size_t bytesToMove = sizeof(float) * (mResampleLevel - baseIdx);
+			mResampleAccum = (uint32)mResampleAccum;
+			mResampleLevel -= baseIdx;
+		}
+	}
 
-				memmove(mResampleBuffers[0], &mResampleBuffers[0][baseIdx], bytesToMove);
+	VDASSERT(!count);
+	VDASSERT(dst == packet.data() + packet.size());
 
-				if (mbStereo)
-					memmove(mResampleBuffers[1], &mResampleBuffers[1][baseIdx], bytesToMove);
+	if (outputSamples)
+		mEncoderThread.Post([this, packet = std::move(packet), outputSamples] { EncodeAudio(packet, outputSamples); });
+}
+
+ATVideoWriter::QueuedFrame *ATVideoWriter::AllocFrame() {
+	vdsynchronized(mPipelineMutex) {
+		if (!mFreeFrames.empty()) {
+			QueuedFrame *frame = mFreeFrames.back();
+			mFreeFrames.pop_back();
+			return frame;
+		}
+	}
+
+	return nullptr;
+}
+
+void ATVideoWriter::FreeFrame(QueuedFrame& frame) {
+	vdsynchronized(mPipelineMutex) {
+		mFreeFrames.push_back(&frame);
+	}
+}
+
+void ATVideoWriter::ConvertFrame(QueuedFrame& frame) {
+	const VDPixmap *pxlast = &frame.mSource;
+
+	try {
+		if (mpVideoResampler) {
+			if (pxlast->format != mVideoResampleFormat) {
+				if (!mVideoColorConversionBuffer.format)
+					mVideoColorConversionBuffer.init(pxlast->w, pxlast->h, mVideoResampleFormat);
 
-				mResampleAccum = (uint32)mResampleAccum;
-				mResampleLevel -= baseIdx;
+				mVideoColorConversionBlitter.Blit(mVideoColorConversionBuffer, *pxlast);
+				pxlast = &mVideoColorConversionBuffer;
 			}
+
+			mpVideoResampler->Process(frame.mResampleBuffer, *pxlast);
+			pxlast = &frame.mResampleBuffer;
 		}
 
-		if (outputSamples)
-			mpMediaEncoder->EndAudioFrame();
+		if (frame.mPostResampleCcBuffer.format) {
+			mVideoPostResampleCcBlitter.Blit(frame.mPostResampleCcBuffer, *pxlast);
+			pxlast = &frame.mPostResampleCcBuffer;
+		}
+	} catch(MyError& e) {
+		RaiseError(std::move(e));
+		pxlast = nullptr;
+	}
+
+	frame.mpOutput = pxlast;
+	frame.mConverted.signal();
+}
 
-		VDASSERT(!count);
+void ATVideoWriter::EncodeFrame(QueuedFrame& frame) {
+	frame.mConverted.wait();
 
+	if (frame.mpOutput && !mbErrorState) {
+		try {
+			mpMediaEncoder->WriteVideo(*frame.mpOutput);
+			UpdateEncodedSize();
+		} catch(MyError& e) {
+			RaiseError(std::move(e));
+		}
+	}
+
+	FreeFrame(frame);
+}
+
+void ATVideoWriter::EncodeRepeatedFrame() {
+	if (mbErrorState)
+		return;
+
+	try {
+		mpMediaEncoder->WriteRepeatedVideo();
+		UpdateEncodedSize();
 	} catch(MyError& e) {
 		RaiseError(std::move(e));
 	}
 }
 
+void ATVideoWriter::EncodeAudio(const vdfastvector<sint16>& samples, uint32 sampleCount) {
+	if (mbErrorState)
+		return;
+
+	try {
+		const uint32 bytes = (uint32)(samples.size() * sizeof(sint16));
+
+		mpMediaEncoder->BeginAudioFrame(bytes, sampleCount);
+		mpMediaEncoder->WriteAudio(samples.data(), bytes);
+		mpMediaEncoder->EndAudioFrame();
+		UpdateEncodedSize();
+	} catch(MyError& e) {
+		RaiseError(std::move(e));
+	}
+}
+
+void ATVideoWriter::UpdateEncodedSize() {
+	const sint64 size = mpMediaEncoder->GetCurrentSize();
+
+	vdsynchronized(mPipelineMutex) {
+		mEncodedSize = size;
+	}
+}
+
+void ATVideoWriter::FlushPipeline() {
+	// Shutting down a pool runs any remaining tasks on this thread. The
+	// converter goes first so that frames the encoder is waiting on are done.
+	mConverterThread.Shutdown();
+	mEncoderThread.Shutdown();
+}
+
 void ATVideoWriter::RaiseError(MyError&& e) {
-	if (!mbErrorState) {
-		mbErrorState = true;
-		mError = std::move(e);
+	vdsynchronized(mPipelineMutex) {
+		if (!mbErrorState) {
+			mError = std::move(e);
+			mbErrorState = true;
+		}
 	}
 }
 
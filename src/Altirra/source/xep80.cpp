@@ -363,12 +363,6 @@ void ATXEP80Emulator::UpdateFrame() {
 	//
 	// ...we can display expect sizes up to about 820x350.
 
-	mFrame.init(((int)mHorzBlankStart + 1) * (int)mCharWidth, ((int)mVertBlankStart + 1) * (int)mCharHeight, nsVDPixmap::kPixFormat_Pal1);
-	mFrame.palette = mPalette;
-
-	VDMemset8Rect(mFrame.data, mFrame.pitch, 0, (mFrame.w + 7) >> 3, mFrame.h);
-
-	uint8 *VDRESTRICT row = (uint8 *)mFrame.data;
 	const uint16 reverseMask = mbReverseVideo ? 0xFFFF : 0x00;
 
 	// Attribute latch format (0 = enabled):
@@ -385,7 +379,13 @@ void ATXEP80Emulator::UpdateFrame() {
 	const uint8 attrMask = charBlinkState ? 0 : 0x04;
 	const uint8 attrs[2] = { (uint8)(mAttrA | attrMask), (uint8)(mAttrB | attrMask) };
 
+	bool fullRedraw = true;
+
 	if (mbGraphicsMode) {
+		mbRenderedCellsValid = false;
+		InitFrame();
+
+		uint8 *VDRESTRICT row = (uint8 *)mFrame.data;
 		uint32 vramaddr = mHomeAddr;
 		uint8 wrapbuf[256 + 1];		// +1 for double width
 
@@ -587,8 +587,12 @@ void ATXEP80Emulator::UpdateFrame() {
 		if (mbInvalidBlockGraphics && (mAttrA & mAttrB & 0x80))
 			RebuildBlockGraphics();
 
-		if (mbInvalidActiveFont)
+		// Rebuilding the active font can change any glyph, which the cell
+		// tracking below can't see.
+		if (mbInvalidActiveFont) {
 			RebuildActiveFont();
+			mbRenderedCellsValid = false;
+		}
 
 		int linebuf[256];
 		uint16 cursorbuf[256];
@@ -614,6 +618,40 @@ void ATXEP80Emulator::UpdateFrame() {
 		if (rows > 25)
 			rows = 25;
 
+		// Only redraw character cells whose glyph state has changed since they
+		// were last drawn, unless the layout has changed. If the prefetch timing
+		// is jittering, the start of each ATASCII row has to be redrawn every
+		// frame as well.
+		const bool prefetchJitter = incorrectlyPrefetchedChars != incorrectlyPrefetchedChars2;
+
+		if (mbIncrementalRedraw
+			&& mbRenderedCellsValid
+			&& mFrame.w == ((int)mHorzBlankStart + 1) * (int)mCharWidth
+			&& mFrame.h == ((int)mVertBlankStart + 1) * (int)mCharHeight
+			&& mRenderedCols == cols
+			&& mRenderedRows == rows
+			&& mRenderedCharWidth == mCharWidth
+			&& mRenderedCharHeight == mCharHeight
+			&& mRenderedPrefetch[0] == incorrectlyPrefetchedChars
+			&& mRenderedPrefetch[1] == incorrectlyPrefetchedChars2)
+		{
+			fullRedraw = false;
+		} else {
+			InitFrame();
+
+			mbRenderedCellsValid = true;
+			mRenderedCols = cols;
+			mRenderedRows = rows;
+			mRenderedCharWidth = mCharWidth;
+			mRenderedCharHeight = mCharHeight;
+			mRenderedPrefetch[0] = (uint8)incorrectlyPrefetchedChars;
+			mRenderedPrefetch[1] = (uint8)incorrectlyPrefetchedChars2;
+		}
+
+		mFrameDirtyRects.clear();
+
+		uint8 *VDRESTRICT row = (uint8 *)mFrame.data;
+
 		// This EOL check looks like a terrible hack, but it's correct.
 		//
 		// In external character generator mode, the NS405 never sees the character
@@ -637,7 +675,8 @@ void ATXEP80Emulator::UpdateFrame() {
 
 		for(int y=0; y<rows; ++y) {
 			uint32 vramaddr = ((uint32)mRowPtrs[y] << 8) + mScrollX;
-			const uint16 *VDRESTRICT rowfont = mActiveFonts[vramaddr & 0x4000 ? 2 : vramaddr & 0x2000 ? 1 : 0];
+			const uint8 rowFontIndex = vramaddr & 0x4000 ? 2 : vramaddr & 0x2000 ? 1 : 0;
+			const uint16 *VDRESTRICT rowfont = mActiveFonts[rowFontIndex];
 			const bool internalCharset = (vramaddr & 0x4000) != 0;
 			const int eolChar = internalCharset ? -1 : 0x9B;
 
@@ -697,12 +736,45 @@ void ATXEP80Emulator::UpdateFrame() {
 				}
 			}
 
-			for(int line=0; line<mCharHeight; ++line) {
-				uint32 accum = 0;
-				int shift = 16;
+			// determine the span of cells to redraw
+			RenderedCell *VDRESTRICT renderedCells = mRenderedCells[y];
+			int dirtyX1 = 0;
+			int dirtyX2 = cols;
+
+			if (!fullRedraw && mRenderedRowFonts[y] == rowFontIndex) {
+				dirtyX1 = cols;
+				dirtyX2 = 0;
+
+				for(int x=0; x<cols; ++x) {
+					if (renderedCells[x] != RenderedCell { (uint16)linebuf[x], cursorbuf[x], rvsbuf[x] }) {
+						if (dirtyX1 > x)
+							dirtyX1 = x;
 
-				uint16 *rowdst = (uint16 *)row;
+						dirtyX2 = x + 1;
+					}
+				}
+
+				if (prefetchJitter && !internalCharset) {
+					dirtyX1 = 0;
 
+					if (dirtyX2 < incorrectlyPrefetchedChars2)
+						dirtyX2 = incorrectlyPrefetchedChars2;
+				}
+			}
+
+			if (dirtyX1 < dirtyX2) {
+				mRenderedRowFonts[y] = rowFontIndex;
+
+				for(int x=dirtyX1; x<dirtyX2; ++x)
+					renderedCells[x] = RenderedCell { (uint16)linebuf[x], cursorbuf[x], rvsbuf[x] };
+
+				if (!fullRedraw)
+					mFrameDirtyRects.emplace_back(dirtyX1 * mCharWidth, y * mCharHeight, dirtyX2 * mCharWidth, (y + 1) * mCharHeight);
+			}
+
+			const int dirtyPixelX = dirtyX1 * mCharWidth;
+
+			for(int line=0; line<mCharHeight; ++line) {
 				// Compute prefetch timing. The NS405 seems to have a one-char
 				// variance in prefetch timing, probably due to the 8048 core;
 				// we drive an LFSR to provide the psuedorandom pattern. It's
@@ -718,8 +790,21 @@ void ATXEP80Emulator::UpdateFrame() {
 
 				mPrefetchLFSR >>= 1;
 
-				int limit = internalCharset ? 0 : prefetch;
-				int x = 0;
+				// The LFSR must keep stepping on clean rows to keep the jitter
+				// pattern the same as a full redraw.
+				if (dirtyX1 >= dirtyX2) {
+					row += mFrame.pitch;
+					continue;
+				}
+
+				// Start with any pixels from preceding clean cells that share the
+				// first word.
+				uint16 *rowdst = (uint16 *)row + (dirtyPixelX >> 4);
+				int shift = 16 - (dirtyPixelX & 15);
+				uint32 accum = (uint32)(VDSwizzleU16(*rowdst) & ~(0xFFFF >> (dirtyPixelX & 15))) << 16;
+
+				int limit = internalCharset ? 0 : std::min<int>(prefetch, dirtyX2);
+				int x = dirtyX1;
 				for(int pass=0; pass<2; ++pass) {
 					for(; x<limit; ++x) {
 						const int charoffset = linebuf[x];
@@ -737,15 +822,18 @@ void ATXEP80Emulator::UpdateFrame() {
 					if (!pass) {
 						// end of prefetch, do the rest of the line with the
 						// intended character row
-						limit = cols;
+						limit = dirtyX2;
 
 						if (line)
 							++rowfont;
 					}
 				}
 
+				// merge in any pixels from following clean cells sharing the last word
 				if (shift < 16) {
-					*rowdst++ = (uint16)VDSwizzleU32(accum);
+					const uint32 keepMask = 0xFFFF >> (16 - shift);
+
+					*rowdst = VDSwizzleU16((uint16)(((accum >> 16) & ~keepMask) | (VDSwizzleU16(*rowdst) & keepMask)));
 				}
 
 				row += mFrame.pitch;
@@ -753,7 +841,16 @@ void ATXEP80Emulator::UpdateFrame() {
 		}
 	}
 
-	++mFrameChangeCount;
+	if (fullRedraw) {
+		mFrameDirtyRects.clear();
+		++mFrameChangeCount;
+	} else if (mFrameDirtyRects.empty()) {
+		// nothing actually changed, so revert the pending change
+		mFrameChangeCount &= ~UINT32_C(1);
+	} else {
+		mFrameDirtyBaseChangeCount = mFrameChangeCount - 1;
+		++mFrameChangeCount;
+	}
 }
 
 uint32 ATXEP80Emulator::GetFrameLayoutChangeCount() {
@@ -2229,6 +2326,13 @@ void ATXEP80Emulator::InvalidateFrame() {
 	mFrameChangeCount |= 1;
 }
 
+void ATXEP80Emulator::InitFrame() {
+	mFrame.init(((int)mHorzBlankStart + 1) * (int)mCharWidth, ((int)mVertBlankStart + 1) * (int)mCharHeight, nsVDPixmap::kPixFormat_Pal1);
+	mFrame.palette = mPalette;
+
+	VDMemset8Rect(mFrame.data, mFrame.pitch, 0, (mFrame.w + 7) >> 3, mFrame.h);
+}
+
 void ATXEP80Emulator::RebuildBlockGraphics() {
 	mbInvalidBlockGraphics = false;
 
@@ -2645,7 +2749,7 @@ private:
 	IATDevicePortManager *mpPIA = nullptr;
 	vdrefptr<IATPrinterOutput> mpDefaultPrinter;
 
-	ATDeviceVideoInfo mVideoInfo;
+	ATDeviceVideoInfo mVideoInfo {};
 	ATDeviceBusSingleChild mParallelBus;
 
 	ATXEP80Emulator mXEP80;
@@ -2786,6 +2890,11 @@ const ATDeviceVideoInfo& ATDeviceXEP80::GetVideoInfo() {
 	mVideoInfo.mFrameBufferLayoutChangeCount = mXEP80.GetFrameLayoutChangeCount();
 	mVideoInfo.mFrameBufferChangeCount = mXEP80.GetFrameChangeCount();
 
+	const auto& dirtyRects = mXEP80.GetFrameDirtyRects();
+	mVideoInfo.mFrameBufferDirtyBaseChangeCount = mXEP80.GetFrameDirtyBaseChangeCount();
+	mVideoInfo.mpFrameBufferDirtyRects = dirtyRects.data();
+	mVideoInfo.mFrameBufferDirtyRectCount = (uint32)dirtyRects.size();
+
 	const auto textDisplayInfo = mXEP80.GetTextDisplayInfo();
 	mVideoInfo.mTextRows = textDisplayInfo.mRows;
 	mVideoInfo.mTextColumns = textDisplayInfo.mColumns;
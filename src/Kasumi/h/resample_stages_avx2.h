@@ -0,0 +1,44 @@
+#ifndef f_VD2_KASUMI_RESAMPLE_STAGES_AVX2_H
+#define f_VD2_KASUMI_RESAMPLE_STAGES_AVX2_H
+
+#include "resample_stages_reference.h"
+
+///////////////////////////////////////////////////////////////////////////
+//
+// resampler stages (AVX2, AMD64)
+//
+// The table stages produce identical output to the SSE2 stages, including
+// filtering of the alpha channel for 8888.
+//
+///////////////////////////////////////////////////////////////////////////
+
+class VDResamplerSeparablePointRowStageAVX2 final : public VDResamplerRowStageSeparablePoint32 {
+public:
+	void Process(void *dst, const void *src, uint32 w, uint32 u, uint32 dudx) override;
+};
+
+class VDResamplerSeparableTableRowStageAVX2 final : public VDResamplerRowStageSeparableTable32 {
+public:
+	VDResamplerSeparableTableRowStageAVX2(const IVDResamplerFilter& filter);
+
+	void Process(void *dst, const void *src, uint32 w, uint32 u, uint32 dudx) override;
+};
+
+class VDResamplerSeparableTableColStageAVX2 final : public VDResamplerColStageSeparableTable32 {
+public:
+	VDResamplerSeparableTableColStageAVX2(const IVDResamplerFilter& filter);
+
+	void Process(void *dst, const void *const *src, uint32 w, sint32 phase) override;
+};
+
+class VDResamplerSeparableTableColStage8AVX2 final : public VDResamplerColStageSeparableTable8 {
+public:
+	VDResamplerSeparableTableColStage8AVX2(const IVDResamplerFilter& filter);
+
+	void Process(void *dst, const void *const *src, uint32 w, sint32 phase) override;
+
+private:
+	bool mbUseFastLerp;
+};
+
+#endif
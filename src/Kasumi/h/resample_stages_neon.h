@@ -0,0 +1,36 @@
+#ifndef f_VD2_KASUMI_RESAMPLE_STAGES_NEON_H
+#define f_VD2_KASUMI_RESAMPLE_STAGES_NEON_H
+
+#include "resample_stages_reference.h"
+
+///////////////////////////////////////////////////////////////////////////
+//
+// resampler stages (NEON, ARM64)
+//
+// The table stages use the same 2.14 fixed point arithmetic as the SSE2
+// stages, including filtering of the alpha channel for 8888.
+//
+///////////////////////////////////////////////////////////////////////////
+
+class VDResamplerSeparableTableRowStageNEON final : public VDResamplerRowStageSeparableTable32 {
+public:
+	VDResamplerSeparableTableRowStageNEON(const IVDResamplerFilter& filter);
+
+	void Process(void *dst, const void *src, uint32 w, uint32 u, uint32 dudx) override;
+};
+
+class VDResamplerSeparableTableColStageNEON final : public VDResamplerColStageSeparableTable32 {
+public:
+	VDResamplerSeparableTableColStageNEON(const IVDResamplerFilter& filter);
+
+	void Process(void *dst, const void *const *src, uint32 w, sint32 phase) override;
+};
+
+class VDResamplerSeparableTableColStage8NEON final : public VDResamplerColStageSeparableTable8 {
+public:
+	VDResamplerSeparableTableColStage8NEON(const IVDResamplerFilter& filter);
+
+	void Process(void *dst, const void *const *src, uint32 w, sint32 phase) override;
+};
+
+#endif
@@ -1,11 +1,13 @@
 #ifndef f_VD2_KASUMI_UBERBLIT_GEN_H
 #define f_VD2_KASUMI_UBERBLIT_GEN_H
 
+#include <vd2/system/function.h>
 #include <vd2/system/vectors.h>
 #include "uberblit.h"
 
 class IVDPixmapGenSrc;
 struct VDPixmapGenYCbCrBasis;
+class VDThreadPool;
 
 class VDPixmapUberBlitterDirectCopy : public IVDPixmapBlitter {
 public:
@@ -24,13 +26,27 @@ public:
 	void Blit(const VDPixmap& dst, const VDPixmap& src);
 	void Blit(const VDPixmap& dst, const vdrect32 *rDst, const VDPixmap& src);
 
+	// Blit only plane 0 rows [y1, y2) of the destination area, in row quanta
+	// for chunky formats. Rows of subsampled planes follow from the plane 0
+	// rows, so y1 must be a multiple of GetBandAlignment(). Every row comes out
+	// the same as with a full blit.
+	void BlitRows(const VDPixmap& dst, const vdrect32 *rDst, const VDPixmap& src, sint32 y1, sint32 y2);
+
+	// Returns true if bands can be blitted independently. Generators cache
+	// rows assuming the access pattern of a single consumer, so this is only
+	// the case when no generator output is shared.
+	bool IsBandable() const { return mbBandable; }
+
+	sint32 GetRowCount(const VDPixmap& dst, const vdrect32 *rDst) const;
+	sint32 GetBandAlignment(const VDPixmap& dst) const;
+
 protected:
-	void Blit(const VDPixmap& dst, const vdrect32 *rDst);
-	void Blit3(const VDPixmap& dst, const vdrect32 *rDst);
-	void Blit3Split(const VDPixmap& dst, const vdrect32 *rDst);
-	void Blit3Separated(const VDPixmap& px, const vdrect32 *rDst);
-	void Blit2(const VDPixmap& dst, const vdrect32 *rDst);
-	void Blit2Separated(const VDPixmap& px, const vdrect32 *rDst);
+	void Blit(const VDPixmap& dst, const vdrect32 *rDst, sint32 ystart, sint32 yend);
+	void Blit3(const VDPixmap& dst, const vdrect32 *rDst, sint32 ystart, sint32 yend);
+	void Blit3Split(const VDPixmap& dst, const vdrect32 *rDst, sint32 ystart, sint32 yend);
+	void Blit3Separated(const VDPixmap& px, const vdrect32 *rDst, sint32 ystart, sint32 yend);
+	void Blit2(const VDPixmap& dst, const vdrect32 *rDst, sint32 ystart, sint32 yend);
+	void Blit2Separated(const VDPixmap& px, const vdrect32 *rDst, sint32 ystart, sint32 yend);
 
 	friend class VDPixmapUberBlitterGenerator;
 
@@ -55,6 +71,37 @@ protected:
 
 	bool mbIndependentChromaPlanes;
 	bool mbIndependentPlanes;
+	bool mbBandable;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//	VDPixmapUberBlitterBanded
+//
+//	Splits the destination into horizontal bands and blits them in parallel
+//	on a thread pool. Generators cache rows and so can't be shared between
+//	threads; instead, each band gets its own copy of the generator chain,
+//	built by the same factory. Output is identical to the serial blit.
+//	VDPixmapCreateBandedBlitter() falls back to a plain blitter if the chain
+//	isn't bandable or the pool has no threads.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+class VDPixmapUberBlitterBanded : public IVDPixmapBlitter {
+public:
+	VDPixmapUberBlitterBanded(VDThreadPool& threadPool);
+	~VDPixmapUberBlitterBanded();
+
+	// Takes ownership of the first chain, which must be bandable. The others
+	// are created with the factory.
+	bool Init(VDPixmapUberBlitter *chain0, const vdfunction<VDPixmapUberBlitter *()>& factory);
+
+	void Blit(const VDPixmap& dst, const VDPixmap& src);
+	void Blit(const VDPixmap& dst, const vdrect32 *rDst, const VDPixmap& src);
+
+protected:
+	VDThreadPool& mThreadPool;
+	vdfastvector<VDPixmapUberBlitter *> mChains;
 };
 
 class VDPixmapUberBlitterGenerator {
@@ -141,7 +188,7 @@ public:
 	void lanczos3v(float yoffset, float yfactor, uint32 h);
 	void lanczos3(float xoffset, float xfactor, uint32 w, float yoffset, float yfactor, uint32 h);
 
-	IVDPixmapBlitter *create();
+	VDPixmapUberBlitter *create();
 
 protected:
 	void MarkDependency(IVDPixmapGen *dst, IVDPixmapGen *src);
@@ -170,7 +217,8 @@ protected:
 	vdfastvector<SourceEntry> mSources;
 };
 
-void VDPixmapGenerate(void *dst, ptrdiff_t pitch, sint32 bpr, sint32 height, IVDPixmapGen *gen, int genIndex);
+void VDPixmapGenerate(void *dst, ptrdiff_t pitch, sint32 bpr, sint32 y1, sint32 y2, IVDPixmapGen *gen, int genIndex);
+IVDPixmapBlitter *VDPixmapCreateBandedBlitter(VDThreadPool& threadPool, const vdfunction<VDPixmapUberBlitter *()>& factory);
 IVDPixmapBlitter *VDCreatePixmapUberBlitterDirectCopy(const VDPixmap& dst, const VDPixmap& src);
 IVDPixmapBlitter *VDCreatePixmapUberBlitterDirectCopy(const VDPixmapLayout& dst, const VDPixmapLayout& src);
 
@@ -43,6 +43,7 @@ public:
 	void SetSplineFactor(double A) { mSplineFactor = A; }
 	void SetSharpnessFactors(float x, float y) { mSharpnessFactorX = x; mSharpnessFactorY = y; }
 	void SetFilters(FilterMode h, FilterMode v, bool interpolationOnly);
+	void SetThreadPool(VDThreadPool *threadPool) { mpThreadPool = threadPool; }
 	bool Init(uint32 dw, uint32 dh, int dstformat, uint32 sw, uint32 sh, int srcformat);
 	bool Init(const vdrect32f& dstrect, uint32 dw, uint32 dh, int dstformat, const vdrect32f& srcrect, uint32 sw, uint32 sh, int srcformat);
 	void Shutdown();
@@ -50,6 +51,7 @@ public:
 	void Process(const VDPixmap& dst, const VDPixmap& src);
 
 protected:
+	IVDPixmapBlitter *CreatePlaneBlitter(uint32 sw, uint32 sh, uint32 srcToken, uint32 srcbpr, uint32 dw, uint32 dh, float xoffset, float yoffset, float xfactor, float yfactor);
 	void ApplyFilters(VDPixmapUberBlitterGenerator& gen, uint32 dw, uint32 dh, float xoffset, float yoffset, float xfactor, float yfactor);
 
 	vdautoptr<IVDPixmapBlitter> mpBlitter;
@@ -60,6 +62,7 @@ protected:
 	FilterMode			mFilterH;
 	FilterMode			mFilterV;
 	bool				mbInterpOnly;
+	VDThreadPool		*mpThreadPool = nullptr;
 
 	vdrect32			mDstRectPlane0;
 	vdrect32			mDstRectPlane12;
@@ -205,18 +208,14 @@ bool VDPixmapResampler::Init(const vdrect32f& dstrect0, uint32 dw, uint32 dh, in
 		yoffset2 = (((float)mDstRectPlane12.top  + 0.5f) - dstrect2.top ) * yfactor + srcrect2.top;
 	}
 
-	VDPixmapUberBlitterGenerator gen;
-
 	switch(srcformat) {
 		case nsVDPixmap::kPixFormat_XRGB8888:
-			gen.ldsrc(0, 0, 0, 0, sw, sh, VDPixmapGetFormatTokenFromFormat(srcformat), sw*4);
-			ApplyFilters(gen, mDstRectPlane0.width(), mDstRectPlane0.height(), xoffset, yoffset, xfactor, yfactor);
+			mpBlitter = CreatePlaneBlitter(sw, sh, VDPixmapGetFormatTokenFromFormat(srcformat), sw*4, mDstRectPlane0.width(), mDstRectPlane0.height(), xoffset, yoffset, xfactor, yfactor);
 			break;
 
 		case nsVDPixmap::kPixFormat_Y8:
 		case nsVDPixmap::kPixFormat_Y8_FR:
-			gen.ldsrc(0, 0, 0, 0, sw, sh, kVDPixType_8, sw);
-			ApplyFilters(gen, mDstRectPlane0.width(), mDstRectPlane0.height(), xoffset, yoffset, xfactor, yfactor);
+			mpBlitter = CreatePlaneBlitter(sw, sh, kVDPixType_8, sw, mDstRectPlane0.width(), mDstRectPlane0.height(), xoffset, yoffset, xfactor, yfactor);
 			break;
 
 		case nsVDPixmap::kPixFormat_YUV444_Planar:
@@ -225,25 +224,20 @@ bool VDPixmapResampler::Init(const vdrect32f& dstrect0, uint32 dw, uint32 dh, in
 		case nsVDPixmap::kPixFormat_YUV444_Planar_709_FR:
 		case nsVDPixmap::kPixFormat_YUV422_Planar:
 		case nsVDPixmap::kPixFormat_YUV420_Planar:
-			gen.ldsrc(0, 0, 0, 0, sw, sh, kVDPixType_8, sw);
-			ApplyFilters(gen, mDstRectPlane0.width(), mDstRectPlane0.height(), xoffset, yoffset, xfactor, yfactor);
+			mpBlitter = CreatePlaneBlitter(sw, sh, kVDPixType_8, sw, mDstRectPlane0.width(), mDstRectPlane0.height(), xoffset, yoffset, xfactor, yfactor);
 
 			{
 				const VDPixmapFormatInfo& info = VDPixmapGetInfo(dstformat);
 				uint32 subsw = -(-(sint32)sw >> info.auxwbits);
 				uint32 subsh = -(-(sint32)sh >> info.auxhbits);
 
-				VDPixmapUberBlitterGenerator gen2;
-				gen2.ldsrc(0, 0, 0, 0, subsw, subsh, kVDPixType_8, subsw);
-				ApplyFilters(gen2, mDstRectPlane12.width(), mDstRectPlane12.height(), xoffset2, yoffset2, xfactor, yfactor);
-				mpBlitter2 = gen2.create();
+				mpBlitter2 = CreatePlaneBlitter(subsw, subsh, kVDPixType_8, subsw, mDstRectPlane12.width(), mDstRectPlane12.height(), xoffset2, yoffset2, xfactor, yfactor);
 				if (!mpBlitter2)
 					return false;
 			}
 			break;
 	}
 
-	mpBlitter = gen.create();
 	if (!mpBlitter)
 		return false;
 
@@ -304,6 +298,20 @@ void VDPixmapResampler::Process(const VDPixmap& dst, const VDPixmap& src) {
 	}
 }
 
+IVDPixmapBlitter *VDPixmapResampler::CreatePlaneBlitter(uint32 sw, uint32 sh, uint32 srcToken, uint32 srcbpr, uint32 dw, uint32 dh, float xoffset, float yoffset, float xfactor, float yfactor) {
+	auto factory = [=, this]() -> VDPixmapUberBlitter * {
+		VDPixmapUberBlitterGenerator gen;
+		gen.ldsrc(0, 0, 0, 0, sw, sh, srcToken, srcbpr);
+		ApplyFilters(gen, dw, dh, xoffset, yoffset, xfactor, yfactor);
+		return gen.create();
+	};
+
+	if (mpThreadPool)
+		return VDPixmapCreateBandedBlitter(*mpThreadPool, factory);
+
+	return factory();
+}
+
 void VDPixmapResampler::ApplyFilters(VDPixmapUberBlitterGenerator& gen, uint32 dw, uint32 dh, float xoffset, float yoffset, float xfactor, float yfactor) {
 	switch(mFilterH) {
 		case kFilterPoint:
@@ -0,0 +1,264 @@
+//	VirtualDub - Video processing and capture application
+//	Graphics support library
+//	Copyright (C) 1998-2018 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <intrin.h>
+#include <vd2/Kasumi/resample_kernels.h>
+#include "resample_stages_avx2.h"
+
+namespace {
+	// Vertical table filter over a byte stream. Since all channels are filtered
+	// independently, this serves both 8 and 8888 formats. The filter must be
+	// swizzled into coefficient pairs and have an even number of taps.
+	VD_CPU_TARGET("avx2")
+	void VDResamplerColumnTableAVX2(uint8 *dst, const uint8 *const *src, uint32 offset, uint32 n, const sint32 *filter, uint32 ksize) {
+		const __m256i round = _mm256_set1_epi32(0x2000);
+		const __m256i zero = _mm256_setzero_si256();
+
+		for(; offset + 32 <= n; offset += 32) {
+			__m256i acc0 = round;
+			__m256i acc1 = round;
+			__m256i acc2 = round;
+			__m256i acc3 = round;
+
+			for(uint32 k = 0; k < ksize; k += 2) {
+				const __m256i a = _mm256_loadu_si256((const __m256i *)(src[k] + offset));
+				const __m256i b = _mm256_loadu_si256((const __m256i *)(src[k+1] + offset));
+				const __m256i coeff = _mm256_set1_epi32(filter[k]);
+				const __m256i lo = _mm256_unpacklo_epi8(a, b);
+				const __m256i hi = _mm256_unpackhi_epi8(a, b);
+
+				acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), coeff));
+				acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), coeff));
+				acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), coeff));
+				acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), coeff));
+			}
+
+			const __m256i rlo = _mm256_packs_epi32(_mm256_srai_epi32(acc0, 14), _mm256_srai_epi32(acc1, 14));
+			const __m256i rhi = _mm256_packs_epi32(_mm256_srai_epi32(acc2, 14), _mm256_srai_epi32(acc3, 14));
+
+			_mm256_storeu_si256((__m256i *)(dst + offset), _mm256_packus_epi16(rlo, rhi));
+		}
+
+		for(; offset < n; ++offset) {
+			sint32 v = 0x2000;
+
+			for(uint32 k = 0; k < ksize; k += 2) {
+				const sint32 coeffPair = filter[k];
+
+				v += (sint32)src[k][offset] * (sint16)coeffPair;
+				v += (sint32)src[k+1][offset] * (coeffPair >> 16);
+			}
+
+			v >>= 14;
+
+			if ((uint32)v >= 0x100)
+				v = ~v >> 31;
+
+			dst[offset] = (uint8)v;
+		}
+	}
+
+	// Two-tap vertical filter with 7-bit coefficients, matching the SSSE3 fast
+	// path of the SSE2 stage. n must be a multiple of 4.
+	VD_CPU_TARGET("avx2")
+	void VDResamplerColumnLerpAVX2(uint8 *dst, const uint8 *row0, const uint8 *row1, uint32 n, const sint32 *filter) {
+		// reduce filter from 2.14 to -1.7 -- we use negative so we can get 0..128 range
+		const uint8 f0 = (uint8)(0 - (((sint16)filter[0] + 64) >> 7));
+		const uint8 f1 = (uint8)(0x80 - f0);
+		const __m256i rowFilter = _mm256_set1_epi16((sint16)(uint16)(((uint32)f1 << 8) + f0));
+		const __m256i round = _mm256_set1_epi16(0x40);
+		uint32 offset = 0;
+
+		for(; offset + 32 <= n; offset += 32) {
+			const __m256i a = _mm256_loadu_si256((const __m256i *)(row0 + offset));
+			const __m256i b = _mm256_loadu_si256((const __m256i *)(row1 + offset));
+			const __m256i lo = _mm256_srai_epi16(_mm256_sub_epi16(round, _mm256_maddubs_epi16(_mm256_unpacklo_epi8(a, b), rowFilter)), 7);
+			const __m256i hi = _mm256_srai_epi16(_mm256_sub_epi16(round, _mm256_maddubs_epi16(_mm256_unpackhi_epi8(a, b), rowFilter)), 7);
+
+			_mm256_storeu_si256((__m256i *)(dst + offset), _mm256_packus_epi16(lo, hi));
+		}
+
+		const __m128i rowFilter1 = _mm256_castsi256_si128(rowFilter);
+		const __m128i round1 = _mm256_castsi256_si128(round);
+
+		for(; offset < n; offset += 4) {
+			const __m128i x = _mm_unpacklo_epi8(_mm_loadu_si32(row0 + offset), _mm_loadu_si32(row1 + offset));
+			const __m128i r = _mm_srai_epi16(_mm_sub_epi16(round1, _mm_maddubs_epi16(x, rowFilter1)), 7);
+
+			_mm_storeu_si32(dst + offset, _mm_packus_epi16(r, r));
+		}
+	}
+
+	bool VDResamplerFilterHasNoOvershoot(const sint32 *filter, size_t n) {
+		while(n--) {
+			sint32 v = *filter++;
+
+			if (v < 0 || v > 0x4000)
+				return false;
+		}
+
+		return true;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+VD_CPU_TARGET("avx2")
+void VDResamplerSeparablePointRowStageAVX2::Process(void *dst0, const void *src0, uint32 w, uint32 u, uint32 dudx) {
+	uint32 *dst = (uint32 *)dst0;
+	const uint32 *src = (const uint32 *)src0;
+
+	if (w >= 8) {
+		const __m256i ustep = _mm256_set1_epi32(dudx * 8);
+		__m256i uv = _mm256_add_epi32(_mm256_set1_epi32(u), _mm256_mullo_epi32(_mm256_set1_epi32(dudx), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+
+		do {
+			_mm256_storeu_si256((__m256i *)dst, _mm256_i32gather_epi32((const int *)src, _mm256_srli_epi32(uv, 16), 4));
+			uv = _mm256_add_epi32(uv, ustep);
+			dst += 8;
+			u += dudx * 8;
+			w -= 8;
+		} while(w >= 8);
+	}
+
+	while(w--) {
+		*dst++ = src[u >> 16];
+		u += dudx;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+VDResamplerSeparableTableRowStageAVX2::VDResamplerSeparableTableRowStageAVX2(const IVDResamplerFilter& filter)
+	: VDResamplerRowStageSeparableTable32(filter)
+{
+	VDResamplerSwizzleTable(mFilterBank.data(), (uint32)mFilterBank.size() >> 1);
+}
+
+VD_CPU_TARGET("avx2")
+void VDResamplerSeparableTableRowStageAVX2::Process(void *dst0, const void *src0, uint32 w, uint32 u, uint32 dudx) {
+	uint32 *dst = (uint32 *)dst0;
+	const uint32 *src = (const uint32 *)src0;
+	const uint32 ksize = (uint32)mFilterBank.size() >> 8;
+	const sint32 *filterBase = mFilterBank.data();
+
+	// Interleaves the channels of two adjacent source pixels into 16-bit pairs
+	// to match the coefficient pairs in the swizzled table.
+	const __m256i interleave = _mm256_setr_epi8(
+		0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1,
+		0, -1, 4, -1, 1, -1, 5, -1, 2, -1, 6, -1, 3, -1, 7, -1
+	);
+
+	// Four pixels at a time, two per accumulator with one in each half.
+	const __m256i round = _mm256_set1_epi32(0x2000);
+
+	for(; w >= 4; w -= 4) {
+		const uint32 *src0 = src + (u >> 16);
+		const sint32 *filter0 = filterBase + ksize*((u >> 8) & 0xff);
+		u += dudx;
+		const uint32 *src1 = src + (u >> 16);
+		const sint32 *filter1 = filterBase + ksize*((u >> 8) & 0xff);
+		u += dudx;
+		const uint32 *src2 = src + (u >> 16);
+		const sint32 *filter2 = filterBase + ksize*((u >> 8) & 0xff);
+		u += dudx;
+		const uint32 *src3 = src + (u >> 16);
+		const sint32 *filter3 = filterBase + ksize*((u >> 8) & 0xff);
+		u += dudx;
+
+		__m256i acc01 = round;
+		__m256i acc23 = round;
+
+		for(uint32 k = 0; k < ksize; k += 2) {
+			const __m256i p01 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadl_epi64((const __m128i *)(src0 + k))), _mm_loadl_epi64((const __m128i *)(src1 + k)), 1);
+			const __m256i p23 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadl_epi64((const __m128i *)(src2 + k))), _mm_loadl_epi64((const __m128i *)(src3 + k)), 1);
+			const __m256i c01 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi32(filter0[k])), _mm_set1_epi32(filter1[k]), 1);
+			const __m256i c23 = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi32(filter2[k])), _mm_set1_epi32(filter3[k]), 1);
+
+			acc01 = _mm256_add_epi32(acc01, _mm256_madd_epi16(_mm256_shuffle_epi8(p01, interleave), c01));
+			acc23 = _mm256_add_epi32(acc23, _mm256_madd_epi16(_mm256_shuffle_epi8(p23, interleave), c23));
+		}
+
+		// low half holds pixels 0/2 and high half pixels 1/3 after packing
+		__m256i r = _mm256_packs_epi32(_mm256_srai_epi32(acc01, 14), _mm256_srai_epi32(acc23, 14));
+		r = _mm256_packus_epi16(r, r);
+
+		_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1)));
+		dst += 4;
+	}
+
+	const __m128i interleave1 = _mm256_castsi256_si128(interleave);
+	const __m128i round1 = _mm_set1_epi32(0x2000);
+
+	while(w--) {
+		const uint32 *src0 = src + (u >> 16);
+		const sint32 *filter0 = filterBase + ksize*((u >> 8) & 0xff);
+		u += dudx;
+
+		__m128i acc = round1;
+
+		for(uint32 k = 0; k < ksize; k += 2)
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_shuffle_epi8(_mm_loadl_epi64((const __m128i *)(src0 + k)), interleave1), _mm_set1_epi32(filter0[k])));
+
+		acc = _mm_srai_epi32(acc, 14);
+		acc = _mm_packs_epi32(acc, acc);
+		acc = _mm_packus_epi16(acc, acc);
+
+		*dst++ = (uint32)_mm_cvtsi128_si32(acc);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+VDResamplerSeparableTableColStageAVX2::VDResamplerSeparableTableColStageAVX2(const IVDResamplerFilter& filter)
+	: VDResamplerColStageSeparableTable32(filter)
+{
+	VDResamplerSwizzleTable(mFilterBank.data(), (uint32)mFilterBank.size() >> 1);
+}
+
+void VDResamplerSeparableTableColStageAVX2::Process(void *dst, const void *const *src, uint32 w, sint32 phase) {
+	const uint32 ksize = (uint32)mFilterBank.size() >> 8;
+
+	VDResamplerColumnTableAVX2((uint8 *)dst, (const uint8 *const *)src, 0, w*4, mFilterBank.data() + ksize*((phase >> 8) & 0xff), ksize);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+VDResamplerSeparableTableColStage8AVX2::VDResamplerSeparableTableColStage8AVX2(const IVDResamplerFilter& filter)
+	: VDResamplerColStageSeparableTable8(filter)
+{
+	mbUseFastLerp = VDResamplerFilterHasNoOvershoot(mFilterBank.data(), mFilterBank.size());
+
+	VDResamplerSwizzleTable(mFilterBank.data(), (uint32)mFilterBank.size() >> 1);
+}
+
+void VDResamplerSeparableTableColStage8AVX2::Process(void *dst, const void *const *src, uint32 w, sint32 phase) {
+	const uint32 ksize = (uint32)mFilterBank.size() >> 8;
+	const sint32 *filter = mFilterBank.data() + ksize*((phase >> 8) & 0xff);
+	uint32 offset = 0;
+
+	// The SSE2 stage only takes the fast path for whole groups of four.
+	if (ksize == 2 && mbUseFastLerp) {
+		offset = w & ~3;
+
+		if (offset)
+			VDResamplerColumnLerpAVX2((uint8 *)dst, (const uint8 *)src[0], (const uint8 *)src[1], offset, filter);
+	}
+
+	VDResamplerColumnTableAVX2((uint8 *)dst, (const uint8 *const *)src, offset, w, filter, ksize);
+}
@@ -0,0 +1,130 @@
+//	VirtualDub - Video processing and capture application
+//	Graphics support library
+//	Copyright (C) 1998-2018 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <arm_neon.h>
+#include <vd2/Kasumi/resample_kernels.h>
+#include "resample_stages_neon.h"
+
+namespace {
+	// Vertical table filter over a byte stream. Since all channels are filtered
+	// independently, this serves both 8 and 8888 formats.
+	void VDResamplerColumnTableNEON(uint8 *dst, const uint8 *const *src, uint32 n, const sint32 *filter, uint32 ksize) {
+		const int32x4_t round = vdupq_n_s32(0x2000);
+		uint32 offset = 0;
+
+		for(; offset + 16 <= n; offset += 16) {
+			int32x4_t acc0 = round;
+			int32x4_t acc1 = round;
+			int32x4_t acc2 = round;
+			int32x4_t acc3 = round;
+
+			for(uint32 k = 0; k < ksize; ++k) {
+				const uint8x16_t a = vld1q_u8(src[k] + offset);
+				const int16x8_t lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(a)));
+				const int16x8_t hi = vreinterpretq_s16_u16(vmovl_high_u8(a));
+				const sint16 coeff = (sint16)filter[k];
+
+				acc0 = vmlal_n_s16(acc0, vget_low_s16(lo), coeff);
+				acc1 = vmlal_high_n_s16(acc1, lo, coeff);
+				acc2 = vmlal_n_s16(acc2, vget_low_s16(hi), coeff);
+				acc3 = vmlal_high_n_s16(acc3, hi, coeff);
+			}
+
+			const uint16x8_t rlo = vcombine_u16(vqshrun_n_s32(acc0, 14), vqshrun_n_s32(acc1, 14));
+			const uint16x8_t rhi = vcombine_u16(vqshrun_n_s32(acc2, 14), vqshrun_n_s32(acc3, 14));
+
+			vst1q_u8(dst + offset, vcombine_u8(vqmovn_u16(rlo), vqmovn_u16(rhi)));
+		}
+
+		for(; offset < n; ++offset) {
+			sint32 v = 0x2000;
+
+			for(uint32 k = 0; k < ksize; ++k)
+				v += (sint32)src[k][offset] * filter[k];
+
+			v >>= 14;
+
+			if ((uint32)v >= 0x100)
+				v = ~v >> 31;
+
+			dst[offset] = (uint8)v;
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+VDResamplerSeparableTableRowStageNEON::VDResamplerSeparableTableRowStageNEON(const IVDResamplerFilter& filter)
+	: VDResamplerRowStageSeparableTable32(filter)
+{
+}
+
+void VDResamplerSeparableTableRowStageNEON::Process(void *dst0, const void *src0, uint32 w, uint32 u, uint32 dudx) {
+	uint32 *dst = (uint32 *)dst0;
+	const uint32 *src = (const uint32 *)src0;
+	const uint32 ksize = (uint32)mFilterBank.size() >> 8;
+	const sint32 *filterBase = mFilterBank.data();
+	const int32x4_t round = vdupq_n_s32(0x2000);
+
+	// Filter widths are always even, so taps are taken in pairs of pixels.
+	do {
+		const uint32 *src2 = src + (u >> 16);
+		const sint32 *filter = filterBase + ksize*((u >> 8) & 0xff);
+		u += dudx;
+
+		int32x4_t acc0 = round;
+		int32x4_t acc1 = vdupq_n_s32(0);
+
+		for(uint32 k = 0; k < ksize; k += 2) {
+			const int16x8_t p = vreinterpretq_s16_u16(vmovl_u8(vld1_u8((const uint8 *)(src2 + k))));
+
+			acc0 = vmlal_n_s16(acc0, vget_low_s16(p), (sint16)filter[k]);
+			acc1 = vmlal_high_n_s16(acc1, p, (sint16)filter[k+1]);
+		}
+
+		const uint16x4_t r = vqshrun_n_s32(vaddq_s32(acc0, acc1), 14);
+
+		vst1_lane_u32(dst++, vreinterpret_u32_u8(vqmovn_u16(vcombine_u16(r, r))), 0);
+	} while(--w);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+VDResamplerSeparableTableColStageNEON::VDResamplerSeparableTableColStageNEON(const IVDResamplerFilter& filter)
+	: VDResamplerColStageSeparableTable32(filter)
+{
+}
+
+void VDResamplerSeparableTableColStageNEON::Process(void *dst, const void *const *src, uint32 w, sint32 phase) {
+	const uint32 ksize = (uint32)mFilterBank.size() >> 8;
+
+	VDResamplerColumnTableNEON((uint8 *)dst, (const uint8 *const *)src, w*4, mFilterBank.data() + ksize*((phase >> 8) & 0xff), ksize);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+VDResamplerSeparableTableColStage8NEON::VDResamplerSeparableTableColStage8NEON(const IVDResamplerFilter& filter)
+	: VDResamplerColStageSeparableTable8(filter)
+{
+}
+
+void VDResamplerSeparableTableColStage8NEON::Process(void *dst, const void *const *src, uint32 w, sint32 phase) {
+	const uint32 ksize = (uint32)mFilterBank.size() >> 8;
+
+	VDResamplerColumnTableNEON((uint8 *)dst, (const uint8 *const *)src, w, mFilterBank.data() + ksize*((phase >> 8) & 0xff), ksize);
+}
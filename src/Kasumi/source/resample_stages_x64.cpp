@@ -425,9 +425,10 @@ namespace {
 		for(unsigned i = 0; i < T_Rows; ++i)
 			rows[i] = src[i];
 
-		__m128i rowFilters[T_Rows];
-		for(unsigned i = 0; i < T_Rows; ++i)
-			rowFilters[i] = _mm_shuffle_epi32(_mm_loadu_si32(&filter[i*2]), 0);
+		// the swizzled table holds each coefficient pair twice
+		__m128i rowFilters[T_Rows / 2];
+		for(unsigned i = 0; i < T_Rows / 2; ++i)
+			rowFilters[i] = _mm_shuffle_epi32(_mm_loadu_si32(&filter[i*4]), 0);
 
 
 		const __m128i zero = _mm_setzero_si128();
@@ -638,11 +638,32 @@ IVDPixmapBlitter *VDPixmapCreateBlitter(const VDPixmap& dst, const VDPixmap& src
 	return VDPixmapCreateBlitter(dstlayout, srclayout);
 }
 
+IVDPixmapBlitter *VDPixmapCreateBlitter(const VDPixmap& dst, const VDPixmap& src, VDThreadPool& threadPool) {
+	const VDPixmapLayout& dstlayout = VDPixmapToLayoutFromBase(dst, dst.data);
+	const VDPixmapLayout& srclayout = VDPixmapToLayoutFromBase(src, src.data);
+
+	return VDPixmapCreateBlitter(dstlayout, srclayout, threadPool);
+}
+
+static VDPixmapUberBlitter *VDPixmapCreateUberBlitter(const VDPixmapLayout& dst, const VDPixmapLayout& src);
+
 IVDPixmapBlitter *VDPixmapCreateBlitter(const VDPixmapLayout& dst, const VDPixmapLayout& src) {
 	if (src.format == dst.format) {
 		return VDCreatePixmapUberBlitterDirectCopy(dst, src);
 	}
 
+	return VDPixmapCreateUberBlitter(dst, src);
+}
+
+IVDPixmapBlitter *VDPixmapCreateBlitter(const VDPixmapLayout& dst, const VDPixmapLayout& src, VDThreadPool& threadPool) {
+	if (src.format == dst.format) {
+		return VDCreatePixmapUberBlitterDirectCopy(dst, src);
+	}
+
+	return VDPixmapCreateBandedBlitter(threadPool, [&] { return VDPixmapCreateUberBlitter(dst, src); });
+}
+
+static VDPixmapUberBlitter *VDPixmapCreateUberBlitter(const VDPixmapLayout& dst, const VDPixmapLayout& src) {
 	uint32 srcToken = VDPixmapGetFormatTokenFromFormat(src.format);
 	uint32 dstToken = VDPixmapGetFormatTokenFromFormat(dst.format);
 
@@ -17,6 +17,7 @@
 //	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 
 #include <stdafx.h>
+#include <vd2/system/threadpool.h>
 #include <vd2/system/vdalloc.h>
 #include <vd2/Kasumi/pixmaputils.h>
 #include "uberblit.h"
@@ -44,16 +45,16 @@
 	#include "uberblit_ycbcr_sse2_intrin.h"
 #endif
 
-void VDPixmapGenerate(void *dst, ptrdiff_t pitch, sint32 bpr, sint32 height, IVDPixmapGen *gen, int genIndex) {
-	for(sint32 y=0; y<height; ++y) {
+void VDPixmapGenerate(void *dst, ptrdiff_t pitch, sint32 bpr, sint32 y1, sint32 y2, IVDPixmapGen *gen, int genIndex) {
+	for(sint32 y=y1; y<y2; ++y) {
 		memcpy(dst, gen->GetRow(y, genIndex), bpr);
 		vdptrstep(dst, pitch);
 	}
 	VDCPUCleanupExtensions();
 }
 
-void VDPixmapGenerateFast(void *dst, ptrdiff_t pitch, sint32 height, IVDPixmapGen *gen) {
-	for(sint32 y=0; y<height; ++y) {
+void VDPixmapGenerateFast(void *dst, ptrdiff_t pitch, sint32 y1, sint32 y2, IVDPixmapGen *gen) {
+	for(sint32 y=y1; y<y2; ++y) {
 		gen->ProcessRow(dst, y);
 		vdptrstep(dst, pitch);
 	}
@@ -161,6 +162,12 @@ void VDPixmapUberBlitter::Blit(const VDPixmap& dst, const VDPixmap& src) {
 }
 
 void VDPixmapUberBlitter::Blit(const VDPixmap& dst, const vdrect32 *rDst, const VDPixmap& src) {
+	BlitRows(dst, rDst, src, 0, GetRowCount(dst, rDst));
+}
+
+void VDPixmapUberBlitter::BlitRows(const VDPixmap& dst, const vdrect32 *rDst, const VDPixmap& src, sint32 y1, sint32 y2) {
+	VDASSERT(y1 % GetBandAlignment(dst) == 0);
+
 	for(Sources::const_iterator it(mSources.begin()), itEnd(mSources.end()); it!=itEnd; ++it) {
 		const SourceEntry& se = *it;
 		const void *p = nullptr;
@@ -189,21 +196,45 @@ void VDPixmapUberBlitter::Blit(const VDPixmap& dst, const vdrect32 *rDst, const
 
 	if (mOutputs[2].mpSrc) {
 		if (mbIndependentPlanes)
-			Blit3Separated(dst, rDst);
+			Blit3Separated(dst, rDst, y1, y2);
 		else if (mbIndependentChromaPlanes)
-			Blit3Split(dst, rDst);
+			Blit3Split(dst, rDst, y1, y2);
 		else
-			Blit3(dst, rDst);
+			Blit3(dst, rDst, y1, y2);
 	} else if (mOutputs[1].mpSrc) {
 		if (mbIndependentPlanes)
-			Blit2Separated(dst, rDst);
+			Blit2Separated(dst, rDst, y1, y2);
 		else
-			Blit2(dst, rDst);
+			Blit2(dst, rDst, y1, y2);
 	} else
-		Blit(dst, rDst);
+		Blit(dst, rDst, y1, y2);
 }
 
-void VDPixmapUberBlitter::Blit(const VDPixmap& dst, const vdrect32 *rDst) {
+sint32 VDPixmapUberBlitter::GetRowCount(const VDPixmap& dst, const vdrect32 *rDst) const {
+	const VDPixmapFormatInfo& formatInfo = VDPixmapGetInfo(dst.format);
+
+	// multi-plane blits always cover the full destination
+	if (!rDst || mOutputs[1].mpSrc) {
+		if (formatInfo.qchunky)
+			return -(-dst.h >> formatInfo.qhbits);
+
+		return dst.h;
+	}
+
+	if (formatInfo.qchunky)
+		return (rDst->bottom + formatInfo.qh - 1) / formatInfo.qh - rDst->top / formatInfo.qh;
+
+	return rDst->bottom - rDst->top;
+}
+
+sint32 VDPixmapUberBlitter::GetBandAlignment(const VDPixmap& dst) const {
+	if (!mOutputs[1].mpSrc)
+		return 1;
+
+	return 1 << VDPixmapGetInfo(dst.format).auxhbits;
+}
+
+void VDPixmapUberBlitter::Blit(const VDPixmap& dst, const vdrect32 *rDst, sint32 ystart, sint32 yend) {
 	const VDPixmapFormatInfo& formatInfo = VDPixmapGetInfo(dst.format);
 
 	mOutputs[0].mpSrc->AddWindowRequest(0, 0);
@@ -241,15 +272,23 @@ void VDPixmapUberBlitter::Blit(const VDPixmap& dst, const vdrect32 *rDst) {
 		h = y2 - y1;
 	}
 
+	if (yend > h)
+		yend = h;
+
+	if (ystart >= yend)
+		return;
+
 	uint32 bpr = formatInfo.qsize * w;
 
+	p = vdptroffset(p, dst.pitch * ystart);
+
 	if (mOutputs[0].mSrcIndex == 0)
-		VDPixmapGenerateFast(p, dst.pitch, h, mOutputs[0].mpSrc);
+		VDPixmapGenerateFast(p, dst.pitch, ystart, yend, mOutputs[0].mpSrc);
 	else
-		VDPixmapGenerate(p, dst.pitch, bpr, h, mOutputs[0].mpSrc, mOutputs[0].mSrcIndex);
+		VDPixmapGenerate(p, dst.pitch, bpr, ystart, yend, mOutputs[0].mpSrc, mOutputs[0].mSrcIndex);
 }
 
-void VDPixmapUberBlitter::Blit3(const VDPixmap& px, const vdrect32 *rDst) {
+void VDPixmapUberBlitter::Blit3(const VDPixmap& px, const vdrect32 *rDst, sint32 ystart, sint32 yend) {
 	const VDPixmapFormatInfo& formatInfo = VDPixmapGetInfo(px.format);
 	IVDPixmapGen *gen = mOutputs[1].mpSrc;
 	int idx = mOutputs[1].mSrcIndex;
@@ -278,17 +317,23 @@ void VDPixmapUberBlitter::Blit3(const VDPixmap& px, const vdrect32 *rDst) {
 		qh = -(-qh >> formatInfo.qhbits);
 	}
 
-	uint32 height = qh;
+	if (yend > qh)
+		yend = qh;
+
+	if (ystart >= yend)
+		return;
+
+	uint32 height = yend;
 	uint32 bpr = formatInfo.qsize * qw;
 	uint32 bpr2 = formatInfo.auxsize * -(-px.w >> formatInfo.auxwbits);
-	uint8 *dst = (uint8 *)px.data;
-	uint8 *dst2 = (uint8 *)px.data2;
-	uint8 *dst3 = (uint8 *)px.data3;
+	uint32 y2 = (uint32)ystart >> formatInfo.auxhbits;
 	ptrdiff_t pitch = px.pitch;
 	ptrdiff_t pitch2 = px.pitch2;
 	ptrdiff_t pitch3 = px.pitch3;
-	uint32 y2 = 0;
-	for(uint32 y=0; y<height; ++y) {
+	uint8 *dst = (uint8 *)px.data + pitch * ystart;
+	uint8 *dst2 = (uint8 *)px.data2 + pitch2 * y2;
+	uint8 *dst3 = (uint8 *)px.data3 + pitch3 * y2;
+	for(uint32 y=ystart; y<height; ++y) {
 		memcpy(dst, gen->GetRow(y, idx), bpr);
 		vdptrstep(dst, pitch);
 
@@ -306,7 +351,7 @@ void VDPixmapUberBlitter::Blit3(const VDPixmap& px, const vdrect32 *rDst) {
 	VDCPUCleanupExtensions();
 }
 
-void VDPixmapUberBlitter::Blit3Split(const VDPixmap& px, const vdrect32 *rDst) {
+void VDPixmapUberBlitter::Blit3Split(const VDPixmap& px, const vdrect32 *rDst, sint32 ystart, sint32 yend) {
 	const VDPixmapFormatInfo& formatInfo = VDPixmapGetInfo(px.format);
 	IVDPixmapGen *gen = mOutputs[1].mpSrc;
 	int idx = mOutputs[1].mSrcIndex;
@@ -335,30 +380,36 @@ void VDPixmapUberBlitter::Blit3Split(const VDPixmap& px, const vdrect32 *rDst) {
 		qh = -(-qh >> formatInfo.qhbits);
 	}
 
-	uint32 height = qh;
+	if (yend > qh)
+		yend = qh;
+
+	if (ystart >= yend)
+		return;
+
+	uint32 height = yend;
 	uint32 bpr = formatInfo.qsize * qw;
-	uint8 *dst = (uint8 *)px.data;
 	ptrdiff_t pitch = px.pitch;
+	uint8 *dst = (uint8 *)px.data + pitch * ystart;
 
 	if (idx == 0) {
-		for(uint32 y=0; y<height; ++y) {
+		for(uint32 y=ystart; y<height; ++y) {
 			gen->ProcessRow(dst, y);
 			vdptrstep(dst, pitch);
 		}
 	} else {
-		for(uint32 y=0; y<height; ++y) {
+		for(uint32 y=ystart; y<height; ++y) {
 			memcpy(dst, gen->GetRow(y, idx), bpr);
 			vdptrstep(dst, pitch);
 		}
 	}
 
 	uint32 bpr2 = -(-px.w >> formatInfo.auxwbits) * formatInfo.auxsize;
-	uint8 *dst2 = (uint8 *)px.data2;
-	uint8 *dst3 = (uint8 *)px.data3;
+	uint32 y2 = (uint32)ystart >> formatInfo.auxhbits;
 	ptrdiff_t pitch2 = px.pitch2;
 	ptrdiff_t pitch3 = px.pitch3;
-	uint32 y2 = 0;
-	for(uint32 y=0; y<height; ++y) {
+	uint8 *dst2 = (uint8 *)px.data2 + pitch2 * y2;
+	uint8 *dst3 = (uint8 *)px.data3 + pitch3 * y2;
+	for(uint32 y=ystart; y<height; ++y) {
 		if (!auxaccum) {
 			memcpy(dst2, gen1->GetRow(y2, idx1), bpr2);
 			vdptrstep(dst2, pitch2);
@@ -373,7 +424,7 @@ void VDPixmapUberBlitter::Blit3Split(const VDPixmap& px, const vdrect32 *rDst) {
 	VDCPUCleanupExtensions();
 }
 
-void VDPixmapUberBlitter::Blit3Separated(const VDPixmap& px, const vdrect32 *rDst) {
+void VDPixmapUberBlitter::Blit3Separated(const VDPixmap& px, const vdrect32 *rDst, sint32 ystart, sint32 yend) {
 	const VDPixmapFormatInfo& formatInfo = VDPixmapGetInfo(px.format);
 	IVDPixmapGen *gen = mOutputs[1].mpSrc;
 	int idx = mOutputs[1].mSrcIndex;
@@ -397,48 +448,55 @@ void VDPixmapUberBlitter::Blit3Separated(const VDPixmap& px, const vdrect32 *rDs
 		qh = -(-qh >> formatInfo.qhbits);
 	}
 
-	uint32 height = qh;
+	if (yend > qh)
+		yend = qh;
+
+	if (ystart >= yend)
+		return;
+
+	uint32 height = yend;
 	uint32 bpr = formatInfo.qsize * qw;
-	uint8 *dst = (uint8 *)px.data;
 	ptrdiff_t pitch = px.pitch;
+	uint8 *dst = (uint8 *)px.data + pitch * ystart;
 
 	if (idx == 0) {
-		for(uint32 y=0; y<height; ++y) {
+		for(uint32 y=ystart; y<height; ++y) {
 			gen->ProcessRow(dst, y);
 			vdptrstep(dst, pitch);
 		}
 	} else {
-		for(uint32 y=0; y<height; ++y) {
+		for(uint32 y=ystart; y<height; ++y) {
 			memcpy(dst, gen->GetRow(y, idx), bpr);
 			vdptrstep(dst, pitch);
 		}
 	}
 
 	uint32 bpr2 = -(-px.w >> formatInfo.auxwbits) * formatInfo.auxsize;
-	uint32 h2 = -(-px.h >> formatInfo.auxhbits);
-	uint8 *dst2 = (uint8 *)px.data2;
+	uint32 h2start = (uint32)ystart >> formatInfo.auxhbits;
+	uint32 h2 = -(-(sint32)height >> formatInfo.auxhbits);
 	ptrdiff_t pitch2 = px.pitch2;
+	uint8 *dst2 = (uint8 *)px.data2 + pitch2 * h2start;
 	if (idx1 == 0) {
-		for(uint32 y2=0; y2<h2; ++y2) {
+		for(uint32 y2=h2start; y2<h2; ++y2) {
 			gen1->ProcessRow(dst2, y2);
 			vdptrstep(dst2, pitch2);
 		}
 	} else {
-		for(uint32 y2=0; y2<h2; ++y2) {
+		for(uint32 y2=h2start; y2<h2; ++y2) {
 			memcpy(dst2, gen1->GetRow(y2, idx1), bpr2);
 			vdptrstep(dst2, pitch2);
 		}
 	}
 
-	uint8 *dst3 = (uint8 *)px.data3;
 	ptrdiff_t pitch3 = px.pitch3;
+	uint8 *dst3 = (uint8 *)px.data3 + pitch3 * h2start;
 	if (idx2 == 0) {
-		for(uint32 y2=0; y2<h2; ++y2) {
+		for(uint32 y2=h2start; y2<h2; ++y2) {
 			gen2->ProcessRow(dst3, y2);
 			vdptrstep(dst3, pitch3);
 		}
 	} else {
-		for(uint32 y2=0; y2<h2; ++y2) {
+		for(uint32 y2=h2start; y2<h2; ++y2) {
 			memcpy(dst3, gen2->GetRow(y2, idx2), bpr2);
 			vdptrstep(dst3, pitch3);
 		}
@@ -447,7 +505,7 @@ void VDPixmapUberBlitter::Blit3Separated(const VDPixmap& px, const vdrect32 *rDs
 	VDCPUCleanupExtensions();
 }
 
-void VDPixmapUberBlitter::Blit2(const VDPixmap& px, const vdrect32 *rDst) {
+void VDPixmapUberBlitter::Blit2(const VDPixmap& px, const vdrect32 *rDst, sint32 ystart, sint32 yend) {
 	const VDPixmapFormatInfo& formatInfo = VDPixmapGetInfo(px.format);
 	IVDPixmapGen *gen = mOutputs[0].mpSrc;
 	int idx = mOutputs[0].mSrcIndex;
@@ -472,15 +530,21 @@ void VDPixmapUberBlitter::Blit2(const VDPixmap& px, const vdrect32 *rDst) {
 		qh = -(-qh >> formatInfo.qhbits);
 	}
 
-	uint32 height = qh;
+	if (yend > qh)
+		yend = qh;
+
+	if (ystart >= yend)
+		return;
+
+	uint32 height = yend;
 	uint32 bpr = formatInfo.qsize * qw;
 	uint32 bpr2 = formatInfo.auxsize * -(-px.w >> formatInfo.auxwbits);
-	uint8 *dst = (uint8 *)px.data;
-	uint8 *dst2 = (uint8 *)px.data2;
+	uint32 y2 = (uint32)ystart >> formatInfo.auxhbits;
 	ptrdiff_t pitch = px.pitch;
 	ptrdiff_t pitch2 = px.pitch2;
-	uint32 y2 = 0;
-	for(uint32 y=0; y<height; ++y) {
+	uint8 *dst = (uint8 *)px.data + pitch * ystart;
+	uint8 *dst2 = (uint8 *)px.data2 + pitch2 * y2;
+	for(uint32 y=ystart; y<height; ++y) {
 		memcpy(dst, gen->GetRow(y, idx), bpr);
 		vdptrstep(dst, pitch);
 
@@ -496,7 +560,7 @@ void VDPixmapUberBlitter::Blit2(const VDPixmap& px, const vdrect32 *rDst) {
 	VDCPUCleanupExtensions();
 }
 
-void VDPixmapUberBlitter::Blit2Separated(const VDPixmap& px, const vdrect32 *rDst) {
+void VDPixmapUberBlitter::Blit2Separated(const VDPixmap& px, const vdrect32 *rDst, sint32 ystart, sint32 yend) {
 	const VDPixmapFormatInfo& formatInfo = VDPixmapGetInfo(px.format);
 	IVDPixmapGen *gen = mOutputs[0].mpSrc;
 	int idx = mOutputs[0].mSrcIndex;
@@ -516,34 +580,41 @@ void VDPixmapUberBlitter::Blit2Separated(const VDPixmap& px, const vdrect32 *rDs
 		qh = -(-qh >> formatInfo.qhbits);
 	}
 
-	uint32 height = qh;
+	if (yend > qh)
+		yend = qh;
+
+	if (ystart >= yend)
+		return;
+
+	uint32 height = yend;
 	uint32 bpr = formatInfo.qsize * qw;
-	uint8 *dst = (uint8 *)px.data;
 	ptrdiff_t pitch = px.pitch;
+	uint8 *dst = (uint8 *)px.data + pitch * ystart;
 
 	if (idx == 0) {
-		for(uint32 y=0; y<height; ++y) {
+		for(uint32 y=ystart; y<height; ++y) {
 			gen->ProcessRow(dst, y);
 			vdptrstep(dst, pitch);
 		}
 	} else {
-		for(uint32 y=0; y<height; ++y) {
+		for(uint32 y=ystart; y<height; ++y) {
 			memcpy(dst, gen->GetRow(y, idx), bpr);
 			vdptrstep(dst, pitch);
 		}
 	}
 
 	uint32 bpr2 = -(-px.w >> formatInfo.auxwbits) * formatInfo.auxsize;
-	uint32 h2 = -(-px.h >> formatInfo.auxhbits);
-	uint8 *dst2 = (uint8 *)px.data2;
+	uint32 h2start = (uint32)ystart >> formatInfo.auxhbits;
+	uint32 h2 = -(-(sint32)height >> formatInfo.auxhbits);
 	ptrdiff_t pitch2 = px.pitch2;
+	uint8 *dst2 = (uint8 *)px.data2 + pitch2 * h2start;
 	if (idx1 == 0) {
-		for(uint32 y2=0; y2<h2; ++y2) {
+		for(uint32 y2=h2start; y2<h2; ++y2) {
 			gen1->ProcessRow(dst2, y2);
 			vdptrstep(dst2, pitch2);
 		}
 	} else {
-		for(uint32 y2=0; y2<h2; ++y2) {
+		for(uint32 y2=h2start; y2<h2; ++y2) {
 			memcpy(dst2, gen1->GetRow(y2, idx1), bpr2);
 			vdptrstep(dst2, pitch2);
 		}
@@ -552,6 +623,85 @@ void VDPixmapUberBlitter::Blit2Separated(const VDPixmap& px, const vdrect32 *rDs
 	VDCPUCleanupExtensions();
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+VDPixmapUberBlitterBanded::VDPixmapUberBlitterBanded(VDThreadPool& threadPool)
+	: mThreadPool(threadPool)
+{
+}
+
+VDPixmapUberBlitterBanded::~VDPixmapUberBlitterBanded() {
+	while(!mChains.empty()) {
+		delete mChains.back();
+		mChains.pop_back();
+	}
+}
+
+bool VDPixmapUberBlitterBanded::Init(VDPixmapUberBlitter *chain0, const vdfunction<VDPixmapUberBlitter *()>& factory) {
+	const uint32 n = mThreadPool.GetThreadCount() + 1;
+
+	mChains.reserve(n);
+	mChains.push_back(chain0);
+
+	for(uint32 i=1; i<n; ++i) {
+		VDPixmapUberBlitter *chain = factory();
+		if (!chain)
+			return false;
+
+		mChains.push_back(chain);
+	}
+
+	return true;
+}
+
+void VDPixmapUberBlitterBanded::Blit(const VDPixmap& dst, const VDPixmap& src) {
+	Blit(dst, NULL, src);
+}
+
+void VDPixmapUberBlitterBanded::Blit(const VDPixmap& dst, const vdrect32 *rDst, const VDPixmap& src) {
+	// Bands that are too short spend more time priming the vertical filter
+	// windows and waking threads than they save.
+	static constexpr sint32 kMinBandRows = 32;
+
+	VDPixmapUberBlitter& chain0 = *mChains[0];
+	const sint32 rows = chain0.GetRowCount(dst, rDst);
+	const sint32 align = chain0.GetBandAlignment(dst);
+	uint32 bands = (uint32)mChains.size();
+
+	if (rows < kMinBandRows * 2)
+		bands = 1;
+	else if ((uint32)(rows / kMinBandRows) < bands)
+		bands = (uint32)(rows / kMinBandRows);
+
+	if (bands <= 1) {
+		chain0.Blit(dst, rDst, src);
+		return;
+	}
+
+	mThreadPool.ParallelFor(bands,
+		[&](uint32 band) {
+			const sint32 y1 = (sint32)(((sint64)rows * band / bands) / align * align);
+			const sint32 y2 = band + 1 < bands ? (sint32)(((sint64)rows * (band + 1) / bands) / align * align) : rows;
+
+			mChains[band]->BlitRows(dst, rDst, src, y1, y2);
+		}
+	);
+}
+
+IVDPixmapBlitter *VDPixmapCreateBandedBlitter(VDThreadPool& threadPool, const vdfunction<VDPixmapUberBlitter *()>& factory) {
+	vdautoptr<VDPixmapUberBlitter> chain0(factory());
+
+	if (!chain0 || !chain0->IsBandable() || !threadPool.GetThreadCount())
+		return chain0.release();
+
+	vdautoptr<VDPixmapUberBlitterBanded> blitter(new VDPixmapUberBlitterBanded(threadPool));
+
+	if (!blitter->Init(chain0.release(), factory))
+		return nullptr;
+
+	return blitter.release();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 VDPixmapUberBlitterGenerator::VDPixmapUberBlitterGenerator() {
 }
@@ -1613,7 +1763,7 @@ void VDPixmapUberBlitterGenerator::ycbcr_to_ycbcr_generic(const VDPixmapGenYCbCr
 	args[2] = StackEntry(src, 2);
 }
 
-IVDPixmapBlitter *VDPixmapUberBlitterGenerator::create() {
+VDPixmapUberBlitter *VDPixmapUberBlitterGenerator::create() {
 	vdautoptr<VDPixmapUberBlitter> blitter(new VDPixmapUberBlitter);
 
 	int numStackEntries = (int)mStack.size();
@@ -1630,6 +1780,34 @@ IVDPixmapBlitter *VDPixmapUberBlitterGenerator::create() {
 
 	mStack.clear();
 
+	// Determine if the blitter can run in bands. A band starting mid-image only
+	// reproduces the rows of a full blit if every generator is pulled by a
+	// single consumer; shared generators see interleaved requests whose
+	// caching depends on the rows already consumed.
+	{
+		vdfastvector<uint8> consumers(mGenerators.size(), 0);
+
+		for(int i=0; i<3; ++i) {
+			if (blitter->mOutputs[i].mpSrc)
+				++consumers[std::find(mGenerators.begin(), mGenerators.end(), blitter->mOutputs[i].mpSrc) - mGenerators.begin()];
+		}
+
+		vdfastvector<Dependency> deps(mDependencies);
+		std::sort(deps.begin(), deps.end(),
+			[](const Dependency& x, const Dependency& y) {
+				return x.mSrcIdx != y.mSrcIdx ? x.mSrcIdx < y.mSrcIdx : x.mDstIdx < y.mDstIdx;
+			}
+		);
+
+		// a consumer reading several outputs of the same generator counts once
+		for(auto it = deps.begin(); it != deps.end(); ++it) {
+			if (it == deps.begin() || it[-1].mSrcIdx != it->mSrcIdx || it[-1].mDstIdx != it->mDstIdx)
+				++consumers[it->mSrcIdx];
+		}
+
+		blitter->mbBandable = std::find_if(consumers.begin(), consumers.end(), [](uint8 n) { return n > 1; }) == consumers.end();
+	}
+
 	// If this blitter has three outputs, determine if outputs 1 and 2 are independent
 	// from output 0.
 	blitter->mbIndependentChromaPlanes = true;
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <vd2/system/atomic.h>
 #include <vd2/system/function.h>
+#include <vd2/system/math.h>
 #include <vd2/system/thread.h>
 #include <vd2/system/vdalloc.h>
 #include <vd2/system/vdtypes.h>
@@ -206,6 +207,7 @@ private:
 	void RequestUpdate();
 	void VerifyDriverResult(bool result);
 	void UpdateCoordinateMapping();
+	vdsize32 GetDestSize() const;
 	bool CheckForMonitorChange();
 	void CheckAndRespondToMonitorChange();
 	bool IsOnSecondaryMonitor() const;
@@ -1384,7 +1386,7 @@ bool VDVideoDisplayWindow::SyncSetSource(bool bAutoUpdate, const SourceInfoEx& p
 
 				if (useEmulatedFX) {
 					mSourceEmulatedFX = mSource;
-					mSourceEmulatedFX.pixmap = mpSourceScreenFXEngine->ApplyScreenFX(mSource.pixmap);
+					mSourceEmulatedFX.pixmap = mpSourceScreenFXEngine->ApplyScreenFX(mSource.pixmap, GetDestSize());
 					const VDPixmapFormatInfo& info = VDPixmapGetInfo(mSourceEmulatedFX.pixmap.format);
 					mSourceEmulatedFX.bpp = info.qsize >> info.qhbits;
 					mSourceEmulatedFX.bpr = (((mSourceEmulatedFX.pixmap.w-1) >> info.qwbits)+1) * info.qsize;
@@ -1715,7 +1717,7 @@ bool VDVideoDisplayWindow::InitMiniDriver() {
 	bool useEmulatedFX = !mpMiniDriver->SetScreenFX(mbSourceUseScreenFX ? &mSourceScreenFX : nullptr);
 	if (useEmulatedFX && !mSourceEmulatedFX.pixmap.data) {
 		mSourceEmulatedFX = mSource;
-		mSourceEmulatedFX.pixmap = mpSourceScreenFXEngine->ApplyScreenFX(mSource.pixmap);
+		mSourceEmulatedFX.pixmap = mpSourceScreenFXEngine->ApplyScreenFX(mSource.pixmap, GetDestSize());
 
 		const VDPixmapFormatInfo& info = VDPixmapGetInfo(mSourceEmulatedFX.pixmap.format);
 		mSourceEmulatedFX.bpp = info.qsize >> info.qhbits;
@@ -1814,25 +1816,35 @@ void VDVideoDisplayWindow::VerifyDriverResult(bool result) {
 }
 
 void VDVideoDisplayWindow::UpdateCoordinateMapping() {
-	if (!mbSourceUseScreenFX || mbSourceEmulatedFXEnabled || mSourceScreenFX.mDistortionX == 0.0f) {
+	// Distortion may also be done by the emulated screen FX engine, so the mapping is
+	// still needed when the driver can't do it.
+	if (!mbSourceUseScreenFX || mSourceScreenFX.mDistortionX == 0.0f) {
 		mbDistortionMappingValid = false;
 	} else {
+		const vdsize32 destSize = GetDestSize();
 		float destAspect = 1;
 
-		if (mbDestRectEnabled) {
-			if (!mDestRectF.empty())
-				destAspect = mDestRectF.width() / mDestRectF.height();
-		} else {
-			RECT r;
-			if (mhwndChild && GetClientRect(mhwndChild, &r) && r.right > 0 && r.bottom > 0)
-				destAspect = (float)r.right / (float)r.bottom;
-		}
+		if (destSize.w > 0 && destSize.h > 0)
+			destAspect = (float)destSize.w / (float)destSize.h;
 
 		mbDistortionMappingValid = true;
 		mDistortionMapping.Init(mSourceScreenFX.mDistortionX, mSourceScreenFX.mDistortionYRatio, destAspect);
 	}
 }
 
+vdsize32 VDVideoDisplayWindow::GetDestSize() const {
+	if (mbDestRectEnabled) {
+		if (!mDestRectF.empty())
+			return vdsize32(VDCeilToInt32(mDestRectF.width()), VDCeilToInt32(mDestRectF.height()));
+	} else {
+		RECT r;
+		if (mhwndChild && GetClientRect(mhwndChild, &r) && r.right > 0 && r.bottom > 0)
+			return vdsize32(r.right, r.bottom);
+	}
+
+	return vdsize32(0, 0);
+}
+
 bool VDVideoDisplayWindow::CheckForMonitorChange() {
 	HMONITOR hmon = NULL;
 
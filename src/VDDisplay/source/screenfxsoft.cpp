@@ -0,0 +1,564 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2009-2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdafx.h>
+#include <vd2/system/cpuaccel.h>
+#include <vd2/system/math.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/threadpool.h>
+#include <vd2/system/vecmath.h>
+#include <vd2/Kasumi/pixmap.h>
+#include <vd2/Kasumi/pixmapops.h>
+#include <vd2/VDDisplay/display.h>
+#include <vd2/VDDisplay/screenfxsoft.h>
+#include <vd2/VDDisplay/internal/bloom.h>
+#include <vd2/VDDisplay/internal/screenfx.h>
+
+#if defined(VD_CPU_X86) || defined(VD_CPU_X64)
+#include <intrin.h>
+#endif
+
+namespace {
+	constexpr uint32 kMaxSumRows = 12;
+	constexpr uint32 kMinTileHeight = 8;
+
+	vdfloat32x4 VDDSoftFXLoad(const vdfloat4& v) {
+		return nsVDVecMath::loadu(v);
+	}
+
+	void VDDSoftFXStore(vdfloat4& dst, const vdfloat32x4& v) {
+		memcpy(&dst, &v, sizeof dst);
+	}
+
+	// dst[i] = sum(rows[k][i] * weights[k]). The destination may alias one of
+	// the source rows. n is always a multiple of 4.
+	void VDDSoftFXSumRows(float *dst, const float *const *rows, const float *weights, uint32 numRows, uint32 n) {
+		vdfloat32x4 w[kMaxSumRows];
+
+		for(uint32 k=0; k<numRows; ++k)
+			w[k] = vdfloat32x4::set1(weights[k]);
+
+		for(uint32 i=0; i<n; i += 4) {
+			vdfloat32x4 sum = VDDSoftFXLoad(*(const vdfloat4 *)(rows[0] + i)) * w[0];
+
+			for(uint32 k=1; k<numRows; ++k)
+				sum += VDDSoftFXLoad(*(const vdfloat4 *)(rows[k] + i)) * w[k];
+
+			VDDSoftFXStore(*(vdfloat4 *)(dst + i), sum);
+		}
+	}
+
+#if defined(VD_CPU_X86) || defined(VD_CPU_X64)
+	// Same as the vecmath version, just twice as wide. This deliberately uses
+	// separate multiplies and adds instead of FMA so that the result is
+	// bit-identical to the SSE2 and NEON paths and doesn't depend on the CPU.
+	VD_CPU_TARGET("avx2")
+	void VDDSoftFXSumRows_AVX2(float *dst, const float *const *rows, const float *weights, uint32 numRows, uint32 n) {
+		__m256 w[kMaxSumRows];
+
+		for(uint32 k=0; k<numRows; ++k)
+			w[k] = _mm256_set1_ps(weights[k]);
+
+		uint32 i = 0;
+		for(; i + 8 <= n; i += 8) {
+			__m256 sum = _mm256_mul_ps(_mm256_loadu_ps(rows[0] + i), w[0]);
+
+			for(uint32 k=1; k<numRows; ++k)
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(rows[k] + i), w[k]));
+
+			_mm256_storeu_ps(dst + i, sum);
+		}
+
+		if (i < n) {
+			__m128 sum = _mm_mul_ps(_mm_loadu_ps(rows[0] + i), _mm256_castps256_ps128(w[0]));
+
+			for(uint32 k=1; k<numRows; ++k)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm256_castps256_ps128(w[k])));
+
+			_mm_storeu_ps(dst + i, sum);
+		}
+	}
+#endif
+
+	// Horizontal half of the 13-tap downsampling filter. The filter is not
+	// separable, so two partial results are produced per output pixel: the
+	// outer taps (E) and the inner taps (B). See BloomDown().
+	template<bool T_Clamp>
+	void VDDSoftFXDownRow(vdfloat4 *VDRESTRICT e, vdfloat4 *VDRESTRICT b, const vdfloat4 *VDRESTRICT src, sint32 srcw, uint32 x1, uint32 x2) {
+		const vdfloat32x4 k25 = vdfloat32x4::set1(0.25f);
+		const vdfloat32x4 k50 = vdfloat32x4::set1(0.50f);
+		const vdfloat32x4 k75 = vdfloat32x4::set1(0.75f);
+
+		const auto px = [=](sint32 i) {
+			if constexpr (T_Clamp)
+				i = std::clamp<sint32>(i, 0, srcw - 1);
+
+			return VDDSoftFXLoad(src[i]);
+		};
+
+		for(uint32 x = x1; x < x2; ++x) {
+			const sint32 sx = (sint32)x * 2;
+
+			VDDSoftFXStore(e[x], (px(sx - 2) + px(sx + 3)) * k25 + (px(sx - 1) + px(sx + 2)) * k75);
+			VDDSoftFXStore(b[x], (px(sx) + px(sx + 1)) * k50);
+		}
+	}
+
+	// Horizontal half of the 2x upsampling filter. Each source pixel produces
+	// two output pixels with a [1 5 7 3]/16 kernel, mirrored for the right
+	// output pixel.
+	template<bool T_Clamp>
+	void VDDSoftFXUpRow(vdfloat4 *VDRESTRICT dst, const vdfloat4 *VDRESTRICT src, sint32 srcw, uint32 dstw, uint32 c1, uint32 c2) {
+		const vdfloat32x4 k1 = vdfloat32x4::set1(1.0f / 16.0f);
+		const vdfloat32x4 k3 = vdfloat32x4::set1(3.0f / 16.0f);
+		const vdfloat32x4 k5 = vdfloat32x4::set1(5.0f / 16.0f);
+		const vdfloat32x4 k7 = vdfloat32x4::set1(7.0f / 16.0f);
+
+		const auto px = [=](sint32 i) {
+			if constexpr (T_Clamp)
+				i = std::clamp<sint32>(i, 0, srcw - 1);
+
+			return VDDSoftFXLoad(src[i]);
+		};
+
+		for(uint32 c = c1; c < c2; ++c) {
+			const sint32 sc = (sint32)c;
+			const vdfloat32x4 p0 = px(sc - 2);
+			const vdfloat32x4 p1 = px(sc - 1);
+			const vdfloat32x4 p2 = px(sc);
+			const vdfloat32x4 p3 = px(sc + 1);
+			const vdfloat32x4 p4 = px(sc + 2);
+
+			VDDSoftFXStore(dst[c*2], p0*k1 + p1*k5 + p2*k7 + p3*k3);
+
+			if (c*2 + 1 < dstw)
+				VDDSoftFXStore(dst[c*2 + 1], p1*k3 + p2*k7 + p3*k5 + p4*k1);
+		}
+	}
+
+	uint32 VDDSoftFXLerp8(uint32 a, uint32 b, uint32 f) {
+		const uint32 rb = (a & 0xFF00FF) * (256 - f) + (b & 0xFF00FF) * f;
+		const uint32 g = (a & 0x00FF00) * (256 - f) + (b & 0x00FF00) * f;
+
+		return ((rb >> 8) & 0xFF00FF) + ((g >> 8) & 0x00FF00);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+VDDisplayScreenFXSoft::VDDisplayScreenFXSoft() {
+	mpSumRows = GetSumRowsFn();
+
+	for(uint32 i=0; i<256; ++i) {
+		const float x = (float)i / 255.0f;
+
+		mSRGBToLinear[i] = x <= 0.04045f ? x / 12.92f : powf((x + 0.055f) / 1.055f, 2.4f);
+	}
+
+	for(uint32 i=0; i<kLinearToSRGBTableSize; ++i) {
+		const float x = (float)i / (float)(kLinearToSRGBTableSize - 1);
+		const float y = x < 0.0031308f ? x * 12.92f : 1.055f * powf(x, 1.0f / 2.4f) - 0.055f;
+
+		mLinearToSRGB[i] = (uint8)VDRoundToInt(std::clamp(y, 0.0f, 1.0f) * 255.0f);
+	}
+}
+
+VDDisplayScreenFXSoft::~VDDisplayScreenFXSoft() {
+}
+
+VDDisplayScreenFXSoft::SumRowsFn VDDisplayScreenFXSoft::GetSumRowsFn() {
+#if defined(VD_CPU_X86) || defined(VD_CPU_X64)
+	if (VDCheckAllExtensionsEnabled(VDCPUF_SUPPORTS_AVX | VDCPUF_SUPPORTS_AVX2))
+		return VDDSoftFXSumRows_AVX2;
+#endif
+
+	return VDDSoftFXSumRows;
+}
+
+bool VDDisplayScreenFXSoft::IsRequired(const VDVideoDisplayScreenFXInfo& screenFX) {
+	return screenFX.mDistortionX > 0 || screenFX.mbBloomEnabled;
+}
+
+VDPixmap VDDisplayScreenFXSoft::Apply(VDPixmapBuffer& dst, const VDPixmap& src, uint32 dstw, uint32 dsth, float viewAspect, const VDVideoDisplayScreenFXInfo& screenFX) {
+	VDASSERT(src.format == nsVDPixmap::kPixFormat_XRGB8888);
+	VDASSERT(src.data != dst.data);
+
+	if (!mpThreadPool) {
+		mpThreadPool = new VDThreadPool;
+
+		if (VDGetLogicalProcessorCount() > 1)
+			mpThreadPool->Start(0, "Screen FX");
+	}
+
+	dst.init(dstw, dsth, nsVDPixmap::kPixFormat_XRGB8888);
+
+	// Distortion is done first as a resampling pass, which also handles any
+	// scaling to the output size; bloom then runs on the output image, same as
+	// on the 3D path.
+	const bool resample = screenFX.mDistortionX > 0 || dstw != (uint32)src.w || dsth != (uint32)src.h;
+	VDPixmap bloomSrc = src;
+
+	if (resample) {
+		UpdateDistortionMap(src.w, src.h, dstw, dsth, viewAspect, std::max(screenFX.mDistortionX, 0.0f), screenFX.mDistortionYRatio);
+
+		if (screenFX.mbBloomEnabled) {
+			mResampleBuffer.init(dstw, dsth, nsVDPixmap::kPixFormat_XRGB8888);
+			Resample(mResampleBuffer, src);
+			bloomSrc = mResampleBuffer;
+		} else
+			Resample(dst, src);
+	}
+
+	if (screenFX.mbBloomEnabled)
+		Bloom(dst, bloomSrc, (float)dstw / (float)src.w, screenFX);
+	else if (!resample)
+		VDPixmapBlt(dst, src);
+
+	return dst;
+}
+
+void VDDisplayScreenFXSoft::ForEachRowTile(uint32 h, const vdfunction<void(uint32, uint32)>& fn) {
+	const uint32 threads = mpThreadPool->GetThreadCount() + 1;
+	const uint32 tileCount = std::min<uint32>(h / kMinTileHeight, threads * 4);
+
+	if (tileCount <= 1 || threads <= 1) {
+		fn(0, h);
+		return;
+	}
+
+	mpThreadPool->ParallelFor(tileCount,
+		[=, &fn](uint32 tile) {
+			fn((uint32)(((uint64)h * tile) / tileCount), (uint32)(((uint64)h * (tile + 1)) / tileCount));
+		}
+	);
+}
+
+void VDDisplayScreenFXSoft::UpdateDistortionMap(uint32 srcw, uint32 srch, uint32 dstw, uint32 dsth, float viewAspect, float distortionX, float distortionYRatio) {
+	if (mDistortionSrcW == srcw
+		&& mDistortionSrcH == srch
+		&& mDistortionDstW == dstw
+		&& mDistortionDstH == dsth
+		&& mDistortionAspect == viewAspect
+		&& mDistortionX == distortionX
+		&& mDistortionYRatio == distortionYRatio)
+	{
+		return;
+	}
+
+	mDistortionSrcW = srcw;
+	mDistortionSrcH = srch;
+	mDistortionDstW = dstw;
+	mDistortionDstH = dsth;
+	mDistortionAspect = viewAspect;
+	mDistortionX = distortionX;
+	mDistortionYRatio = distortionYRatio;
+
+	VDDisplayDistortionMapping mapping;
+	mapping.Init(distortionX, distortionYRatio, viewAspect);
+
+	mDistortionMap.resize(dstw * dsth);
+
+	ForEachRowTile(dsth,
+		[=, this](uint32 y1, uint32 y2) {
+			const float dx = 1.0f / (float)dstw;
+			const float dy = 1.0f / (float)dsth;
+			const float maxX = (float)(srcw - 1);
+			const float maxY = (float)(srch - 1);
+
+			for(uint32 y = y1; y < y2; ++y) {
+				DistortionEntry *VDRESTRICT entry = &mDistortionMap[dstw * y];
+
+				for(uint32 x = 0; x < dstw; ++x) {
+					vdfloat2 pt { ((float)x + 0.5f) * dx, ((float)y + 0.5f) * dy };
+
+					entry->mbValid = mapping.MapScreenToImage(pt);
+
+					// convert to 24.8 texel coordinates for bilinear sampling
+					const sint32 u = VDRoundToInt(std::clamp(pt.x * (float)srcw - 0.5f, 0.0f, maxX) * 256.0f);
+					const sint32 v = VDRoundToInt(std::clamp(pt.y * (float)srch - 0.5f, 0.0f, maxY) * 256.0f);
+
+					entry->mX = (uint16)(u >> 8);
+					entry->mY = (uint16)(v >> 8);
+					entry->mFracX = (uint8)u;
+					entry->mFracY = (uint8)v;
+					++entry;
+				}
+			}
+		}
+	);
+}
+
+void VDDisplayScreenFXSoft::Resample(const VDPixmap& dst, const VDPixmap& src) {
+	ForEachRowTile(dst.h,
+		[&dst, &src, this](uint32 y1, uint32 y2) {
+			const uint32 w = dst.w;
+			const uint32 srcLastX = src.w - 1;
+			const uint32 srcLastY = src.h - 1;
+
+			for(uint32 y = y1; y < y2; ++y) {
+				const DistortionEntry *VDRESTRICT entry = &mDistortionMap[w * y];
+				uint32 *VDRESTRICT dstRow = (uint32 *)((char *)dst.data + dst.pitch * y);
+
+				for(uint32 x = 0; x < w; ++x, ++entry) {
+					if (!entry->mbValid) {
+						dstRow[x] = 0;
+						continue;
+					}
+
+					const uint32 sx = entry->mX;
+					const uint32 sy = entry->mY;
+					const ptrdiff_t dx = sx < srcLastX ? 4 : 0;
+					const ptrdiff_t dy = sy < srcLastY ? src.pitch : 0;
+					const char *p = (const char *)src.data + src.pitch * sy + sx * 4;
+
+					const uint32 top = VDDSoftFXLerp8(*(const uint32 *)p, *(const uint32 *)(p + dx), entry->mFracX);
+					const uint32 bot = VDDSoftFXLerp8(*(const uint32 *)(p + dy), *(const uint32 *)(p + dy + dx), entry->mFracX);
+
+					dstRow[x] = VDDSoftFXLerp8(top, bot, entry->mFracY);
+				}
+			}
+		}
+	);
+}
+
+void VDDisplayScreenFXSoft::Bloom(const VDPixmap& dst, const VDPixmap& src, float baseRadius, const VDVideoDisplayScreenFXInfo& screenFX) {
+	// Size the pyramid. Each level is half the size of the previous one,
+	// rounded up.
+	uint32 w = dst.w;
+	uint32 h = dst.h;
+	size_t tempSize = 0;
+
+	for(uint32 i = 0; i < kBloomLevels; ++i) {
+		BloomLevel& level = mBloomLevels[i];
+
+		level.mWidth = w;
+		level.mHeight = h;
+		level.mPixels.resize(w * h);
+
+		// Downsampling needs (next width) x (this height) of temp space, and
+		// upsampling needs (this width) x (next height).
+		const uint32 w2 = (w + 1) >> 1;
+		const uint32 h2 = (h + 1) >> 1;
+		tempSize = std::max<size_t>(tempSize, std::max<size_t>((size_t)w2 * h, (size_t)w * h2));
+
+		w = w2;
+		h = h2;
+	}
+
+	mBloomTemp[0].resize(tempSize);
+	mBloomTemp[1].resize(tempSize);
+
+	// Convert the source image to linear.
+	BloomLevel& base = mBloomLevels[0];
+
+	ForEachRowTile(base.mHeight,
+		[&src, &base, this](uint32 y1, uint32 y2) {
+			const float *VDRESTRICT lut = mSRGBToLinear;
+
+			for(uint32 y = y1; y < y2; ++y) {
+				const uint32 *VDRESTRICT srcRow = (const uint32 *)((const char *)src.data + src.pitch * y);
+				vdfloat4 *VDRESTRICT dstRow = base.GetRow(y);
+
+				for(uint32 x = 0; x < base.mWidth; ++x) {
+					const uint32 px = srcRow[x];
+
+					dstRow[x] = vdfloat4 { lut[px & 0xFF], lut[(px >> 8) & 0xFF], lut[(px >> 16) & 0xFF], 0.0f };
+				}
+			}
+		}
+	);
+
+	// Compute the downsampling pyramid.
+	for(uint32 i = 1; i < kBloomLevels; ++i)
+		BloomDown(mBloomLevels[i], mBloomLevels[i - 1]);
+
+	// Compute the upsampling pyramid, blending each level into the next
+	// larger one.
+	VDDBloomV2ControlParams controlParams {};
+	controlParams.mbRenderLinear = false;
+	controlParams.mBaseRadius = baseRadius;
+	controlParams.mAdjustRadius = screenFX.mBloomRadius;
+	controlParams.mDirectIntensity = screenFX.mBloomDirectIntensity;
+	controlParams.mIndirectIntensity = screenFX.mBloomIndirectIntensity;
+
+	const VDDBloomV2RenderParams renderParams = VDDComputeBloomV2Parameters(controlParams);
+
+	for(int i = 4; i >= 0; --i)
+		BloomUp(mBloomLevels[i + 1], mBloomLevels[i + 2], renderParams.mPassBlendFactors[4 - i].x, renderParams.mPassBlendFactors[4 - i].y, nullptr);
+
+	// Final pass: upsample the bloom onto the base image, then apply the
+	// shoulder curve and convert back to sRGB.
+	const vdfloat32x4 shoulderA = vdfloat32x4::set1(renderParams.mShoulder.x);
+	const vdfloat32x4 shoulderB = vdfloat32x4::set1(renderParams.mShoulder.y);
+	const vdfloat32x4 shoulderC = vdfloat32x4::set1(renderParams.mShoulder.z);
+	const vdfloat32x4 shoulderD = vdfloat32x4::set1(renderParams.mShoulder.w);
+	const vdfloat32x4 midSlope = vdfloat32x4::set1(renderParams.mThresholds.x);
+	const vdfloat32x4 shoulderStart = vdfloat32x4::set1(renderParams.mThresholds.y);
+	const vdfloat32x4 limit = vdfloat32x4::set1(renderParams.mThresholds.z);
+	const vdfloat32x4 tableScale = vdfloat32x4::set1((float)(kLinearToSRGBTableSize - 1));
+
+	BloomUp(base, mBloomLevels[1], renderParams.mPassBlendFactors[5].x, renderParams.mPassBlendFactors[5].y,
+		[&, this](uint32 y, vdfloat4 *row) {
+			uint32 *VDRESTRICT dstRow = (uint32 *)((char *)dst.data + dst.pitch * y);
+			const uint8 *VDRESTRICT lut = mLinearToSRGB;
+			const uint32 w = base.mWidth;
+
+			for(uint32 i = 0; i < w; ++i) {
+				const vdfloat32x4 x = nsVDVecMath::min(VDDSoftFXLoad(row[i]), limit);
+				const vdfloat32x4 mid = midSlope * x;
+				const vdfloat32x4 shoulder = ((shoulderA * x + shoulderB) * x + shoulderC) * x + shoulderD;
+				const vdfloat32x4 r = nsVDVecMath::saturate(nsVDVecMath::select(nsVDVecMath::cmpgt(x, shoulderStart), shoulder, mid)) * tableScale;
+
+				vdfloat4 v;
+				VDDSoftFXStore(v, r);
+
+				dstRow[i] = (uint32)lut[(uint32)(v.x + 0.5f)]
+					+ ((uint32)lut[(uint32)(v.y + 0.5f)] << 8)
+					+ ((uint32)lut[(uint32)(v.z + 0.5f)] << 16);
+			}
+		}
+	);
+}
+
+void VDDisplayScreenFXSoft::BloomDown(BloomLevel& dst, BloomLevel& src) {
+	// The downsampling filter is the 13-tap filter from the 3D path, expressed
+	// in texels instead of bilinear samples. Per axis, the outer samples cover
+	// E = [1 3 0 0 3 1]/4 and the inner sample B = [0 0 1 1 0 0]/2 around the
+	// 2x2 block being reduced, and the 2D kernel is:
+	//
+	//	w1*E*E' + w2*(E*B' + B*E') + w3*B*B'
+	//
+	// This isn't separable, so the horizontal pass produces both E and B, and
+	// the vertical pass combines them.
+	const uint32 srcw = src.mWidth;
+	const uint32 srch = src.mHeight;
+	const uint32 dstw = dst.mWidth;
+	vdfloat4 *const tempE = mBloomTemp[0].data();
+	vdfloat4 *const tempB = mBloomTemp[1].data();
+
+	ForEachRowTile(srch,
+		[=, &src](uint32 y1, uint32 y2) {
+			// interior outputs need source pixels [2x-2, 2x+3]
+			const uint32 xi1 = std::min<uint32>(1, dstw);
+			const uint32 xi2 = srcw >= 4 ? std::clamp<uint32>((srcw - 4) / 2 + 1, xi1, dstw) : xi1;
+
+			for(uint32 y = y1; y < y2; ++y) {
+				const vdfloat4 *srcRow = src.GetRow(y);
+				vdfloat4 *e = tempE + dstw * y;
+				vdfloat4 *b = tempB + dstw * y;
+
+				VDDSoftFXDownRow<true>(e, b, srcRow, srcw, 0, xi1);
+				VDDSoftFXDownRow<false>(e, b, srcRow, srcw, xi1, xi2);
+				VDDSoftFXDownRow<true>(e, b, srcRow, srcw, xi2, dstw);
+			}
+		}
+	);
+
+	static constexpr float w1 =  7.0f / 124.0f;
+	static constexpr float w2 = 16.0f / 124.0f;
+	static constexpr float w3 = 32.0f / 124.0f;
+	static constexpr float kE[6] { 0.25f, 0.75f, 0.0f, 0.0f, 0.75f, 0.25f };
+	static constexpr float kB[6] { 0.0f, 0.0f, 0.5f, 0.5f, 0.0f, 0.0f };
+
+	float weights[12];
+	for(int k = 0; k < 6; ++k) {
+		weights[k] = w1 * kE[k] + w2 * kB[k];
+		weights[k + 6] = w2 * kE[k] + w3 * kB[k];
+	}
+
+	ForEachRowTile(dst.mHeight,
+		[=, &dst, &weights, this](uint32 y1, uint32 y2) {
+			const float *rows[12];
+
+			for(uint32 y = y1; y < y2; ++y) {
+				for(int k = 0; k < 6; ++k) {
+					const uint32 sy = (uint32)std::clamp<sint32>((sint32)y * 2 - 2 + k, 0, (sint32)srch - 1);
+
+					rows[k] = (const float *)(tempE + dstw * sy);
+					rows[k + 6] = (const float *)(tempB + dstw * sy);
+				}
+
+				mpSumRows((float *)dst.GetRow(y), rows, weights, 12, dstw * 4);
+			}
+		}
+	);
+}
+
+void VDDisplayScreenFXSoft::BloomUp(BloomLevel& dst, BloomLevel& src, float srcFactor, float dstFactor, const vdfunction<void(uint32, vdfloat4 *)>& rowFn) {
+	// dst = upsample(src) * srcFactor + dst * dstFactor, matching the blend
+	// state on the 3D path. The upsampling filter is [1 5 7 3]/16 per axis,
+	// mirrored for odd output pixels.
+	const uint32 srcw = src.mWidth;
+	const uint32 srch = src.mHeight;
+	const uint32 dstw = dst.mWidth;
+	vdfloat4 *const temp = mBloomTemp[0].data();
+
+	ForEachRowTile(srch,
+		[=, &src](uint32 y1, uint32 y2) {
+			// interior source pixels need neighbors [c-2, c+2]
+			const uint32 c1 = std::min<uint32>(2, srcw);
+			const uint32 c2 = srcw >= 4 ? srcw - 2 : c1;
+
+			for(uint32 y = y1; y < y2; ++y) {
+				const vdfloat4 *srcRow = src.GetRow(y);
+				vdfloat4 *tempRow = temp + dstw * y;
+
+				VDDSoftFXUpRow<true>(tempRow, srcRow, srcw, dstw, 0, c1);
+				VDDSoftFXUpRow<false>(tempRow, srcRow, srcw, dstw, c1, c2);
+				VDDSoftFXUpRow<true>(tempRow, srcRow, srcw, dstw, c2, srcw);
+			}
+		}
+	);
+
+	static constexpr float kEven[4] { 1.0f / 16.0f, 5.0f / 16.0f, 7.0f / 16.0f, 3.0f / 16.0f };
+	static constexpr float kOdd[4] { 3.0f / 16.0f, 7.0f / 16.0f, 5.0f / 16.0f, 1.0f / 16.0f };
+
+	float evenWeights[5];
+	float oddWeights[5];
+
+	for(int k = 0; k < 4; ++k) {
+		evenWeights[k] = kEven[k] * srcFactor;
+		oddWeights[k] = kOdd[k] * srcFactor;
+	}
+
+	evenWeights[4] = dstFactor;
+	oddWeights[4] = dstFactor;
+
+	ForEachRowTile(dst.mHeight,
+		[=, &dst, &rowFn, &evenWeights, &oddWeights, this](uint32 y1, uint32 y2) {
+			const float *rows[5];
+
+			for(uint32 y = y1; y < y2; ++y) {
+				// even rows take source rows [c-2, c+1], odd rows [c-1, c+2]
+				const sint32 base = (sint32)(y >> 1) - ((y & 1) ? 1 : 2);
+
+				for(int k = 0; k < 4; ++k) {
+					const uint32 sy = (uint32)std::clamp<sint32>(base + k, 0, (sint32)srch - 1);
+
+					rows[k] = (const float *)(temp + dstw * sy);
+				}
+
+				vdfloat4 *dstRow = dst.GetRow(y);
+				rows[4] = (const float *)dstRow;
+
+				mpSumRows((float *)dstRow, rows, (y & 1) ? oddWeights : evenWeights, 5, dstw * 4);
+
+				if (rowFn)
+					rowFn(y, dstRow);
+			}
+		}
+	);
+}
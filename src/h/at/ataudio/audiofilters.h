@@ -38,6 +38,19 @@ uint64 ATFilterResampleStereo16(sint16 *d, const float *s1, const float *s2, uin
 
 void ATFilterComputeSymmetricFIR_8_32F(float *dst, size_t n, const float *kernel);
 
+// Mixing helpers. These all accumulate or write float sample blocks with the
+// same per-sample arithmetic as a scalar loop, so results do not depend on
+// which implementation is selected.
+
+// dstL[i] += src[i]*scale, and same into dstR if not null.
+void ATFilterMixScaledMono16(float *dstL, float *dstR, const sint16 *src, uint32 n, float scale);
+
+// dstL[i] += src[i], dstR[i] += src[i].
+void ATFilterMixMonoToStereo(float *dstL, float *dstR, const float *src, uint32 n);
+
+// dstL[i] = dstR[i] = (srcL[i] + srcR[i]) * 0.5.
+void ATFilterDownmixStereoToMono(float *dstL, float *dstR, const float *srcL, const float *srcR, uint32 n);
+
 class ATAudioFilter {
 	ATAudioFilter(const ATAudioFilter&) = delete;
 	ATAudioFilter& operator=(const ATAudioFilter&) = delete;
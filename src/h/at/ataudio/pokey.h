@@ -32,6 +32,7 @@
 #include <at/atcore/scheduler.h>
 
 class IATAudioOutput;
+class IATAudioTap;
 class ATPokeyEmulator;
 class ATSaveStateReader;
 class ATAudioFilter;
@@ -123,6 +124,10 @@ public:
 	void	SetSlave(ATPokeyEmulator *slave);
 	void	SetCassette(IATPokeyCassetteDevice *dev);
 	void	SetAudioLog(ATPokeyAudioLog *log);
+
+	// Receive raw output blocks directly when no audio output is attached, for
+	// rendering without the audio engine.
+	void	SetAudioTap(IATAudioTap *tap) { mpAudioTap = tap; }
 	void	SetConsoleOutput(ATConsoleOutput *output);
 
 	void	Set5200Mode(bool enable);
@@ -425,6 +430,7 @@ private:
 	bool	mbIrqAsserted;
 
 	IATAudioOutput *mpAudioOut = nullptr;
+	IATAudioTap *mpAudioTap = nullptr;
 	ATConsoleOutput *mpConsoleOut = nullptr;
 
 	typedef vdfastvector<IATPokeySIODevice *> Devices;
@@ -60,4 +60,21 @@ public:
 	virtual void RescanDynamicDisk() = 0;
 };
 
+struct ATBlockDeviceCacheStats {
+	uint64 mReadHitSectors;
+	uint64 mReadMissSectors;
+	uint64 mReadAheadSectors;
+	uint64 mWriteBehindSectors;
+	uint32 mCachedSectors;
+	uint32 mDirtySectors;
+};
+
+// Implemented by block devices that front their storage with a sector cache.
+class IATBlockDeviceCacheStats {
+public:
+	static constexpr uint32 kTypeID = "IATBlockDeviceCacheStats"_vdtypeid;
+
+	virtual ATBlockDeviceCacheStats GetCacheStats() const = 0;
+};
+
 #endif
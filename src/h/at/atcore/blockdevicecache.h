@@ -0,0 +1,134 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Core library - block device sector cache
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+//
+//	As a special exception, this library can also be redistributed and/or
+//	modified under an alternate license. See COPYING.RMT in the same source
+//	archive for details.
+
+#ifndef f_AT_ATCORE_BLOCKDEVICECACHE_H
+#define f_AT_ATCORE_BLOCKDEVICECACHE_H
+
+#include <vd2/system/Error.h>
+#include <vd2/system/function.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/threadpool.h>
+#include <vd2/system/vdstl.h>
+#include <vd2/system/vdstl_hashmap.h>
+#include <at/atcore/blockdevice.h>
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	ATBlockDeviceCache
+//
+//	Sector cache for block devices backed by host files. Reads are served
+//	from the cache where possible, with sequential reads triggering
+//	readahead on a worker thread. In write-behind mode, writes complete into
+//	the cache and are written to the backing store on the worker thread;
+//	Flush() waits for them to land.
+//
+//	The backing read/write functions are called from both the emulation
+//	thread and the worker thread, but never concurrently.
+//
+///////////////////////////////////////////////////////////////////////////
+
+class ATBlockDeviceCache {
+	ATBlockDeviceCache(const ATBlockDeviceCache&) = delete;
+	ATBlockDeviceCache& operator=(const ATBlockDeviceCache&) = delete;
+public:
+	using ReadFn = vdfunction<void(void *, uint32, uint32)>;
+	using WriteFn = vdfunction<void(const void *, uint32, uint32)>;
+
+	ATBlockDeviceCache();
+	~ATBlockDeviceCache();
+
+	void Init(uint32 sectorCount, ReadFn readFn, WriteFn writeFn, bool writeBehind);
+
+	// Flush pending writes and drop the cache. Errors from the final flush
+	// are discarded.
+	void Shutdown();
+
+	bool IsInited() const { return mpReadFn != nullptr; }
+
+	// Update the sector count when the backing store grows; readahead is
+	// clamped to this.
+	void SetSectorCount(uint32 sectorCount);
+
+	void ReadSectors(void *data, uint32 lba, uint32 n);
+	void WriteSectors(const void *data, uint32 lba, uint32 n);
+
+	// Wait for all pending writes to reach the backing store. Rethrows the
+	// first error from a deferred write, if any; once a deferred write has
+	// failed, all subsequent writes and flushes fail with the same error.
+	void Flush();
+
+	ATBlockDeviceCacheStats GetStats() const;
+
+private:
+	static constexpr uint32 kLineShift = 4;
+	static constexpr uint32 kSectorsPerLine = 1 << kLineShift;
+	static constexpr uint32 kMaxLines = 1024;
+	static constexpr uint32 kMaxDirtyLines = kMaxLines / 4;
+	static constexpr uint32 kReadAheadLines = 8;
+
+	struct Line {
+		uint32 mLineIndex;
+		uint16 mValidMask;
+		uint16 mDirtyMask;
+		uint64 mLastUse;
+		bool mbWritePending;
+		uint8 mData[kSectorsPerLine][512];
+	};
+
+	Line *FindLine(uint32 lineIndex);
+	Line *AllocLine(uint32 lineIndex);
+	void FillLine(uint32 lineIndex, const uint8 *src, uint32 count);
+	uint32 GetLineSectorCount(uint32 lineIndex) const;
+
+	void QueueWrite(Line& line);
+	void QueueReadAhead(uint32 lineIndex);
+	void WaitForIdle();
+	void RunWriteBehind();
+	void RunReadAhead(uint32 startLine, uint32 endLine);
+	void ThrowDeferredError();
+
+	ReadFn mpReadFn;
+	WriteFn mpWriteFn;
+	uint32 mSectorCount = 0;
+	bool mbWriteBehind = false;
+
+	mutable VDCriticalSection mMutex;
+	VDCriticalSection mIOMutex;
+
+	vdvector<Line> mLines;
+	vdhashmap<uint32, Line *> mLineLookup;
+	uint64 mUseCounter = 0;
+
+	vdfastvector<Line *> mWriteQueue;
+	bool mbWriteTaskQueued = false;
+	uint32 mPendingTasks = 0;
+	uint32 mDirtyLineCount = 0;
+	uint32 mReadAheadLimit = 0;
+	uint32 mLastReadEnd = ~(uint32)0;
+	VDSignal mTaskDone;
+	MyError mDeferredError;
+
+	ATBlockDeviceCacheStats mStats {};
+
+	VDThreadPool mWorker;
+};
+
+#endif
@@ -39,6 +39,11 @@ bool operator!=(const ATChecksumSHA256& x, const ATChecksumSHA256& y);
 
 ATChecksumSHA256 ATComputeChecksumSHA256(const void *src, size_t len);
 
+// Compute SHA-256 checksums of several independent buffers. This is faster
+// than hashing them one at a time on CPUs without SHA extensions, as the
+// block function can then run across multiple buffers in SIMD lanes.
+void ATComputeChecksumsSHA256(ATChecksumSHA256 *dst, const void *const *srcs, const size_t *lens, size_t n);
+
 struct ATChecksumStateSHA256 {
 	alignas(16) uint32 H[8];
 };
@@ -50,6 +50,14 @@ struct ATDeviceVideoInfo {
 	// change.
 	uint32 mFrameBufferChangeCount;
 
+	// Optional list of frame buffer rects that changed to get from
+	// mFrameBufferDirtyBaseChangeCount to mFrameBufferChangeCount. If the
+	// list is empty or the base count doesn't match the last change count
+	// seen, the entire frame buffer must be treated as changed.
+	uint32 mFrameBufferDirtyBaseChangeCount;
+	const vdrect32 *mpFrameBufferDirtyRects;
+	uint32 mFrameBufferDirtyRectCount;
+
 	// Size of the text screen in characters.
 	int mTextRows;
 	int mTextColumns;
@@ -38,6 +38,7 @@
 #include <vd2/system/error.h>
 #include <vd2/system/function.h>
 #include <vd2/system/refcount.h>
+#include <vd2/system/vdstl.h>
 #include <vd2/system/VDString.h>
 
 class IVDRandomAccessStream;
@@ -155,13 +156,38 @@ public:
 	const wchar_t *GetFileName() const { return mFileName.c_str(); }
 	virtual bool IsSourceReadOnly() const = 0;
 
+	// Returns true if the full contents of the file are available as a
+	// read-only span in memory, either in a mapped file or in a buffer owned
+	// by the view. The span is stable for the lifetime of the view, so
+	// loaders may reference it directly while holding a reference on the
+	// view instead of copying the data out through the stream.
+	bool HasMemoryView() const { return mbHasMemoryView; }
+	vdspan<const uint8> GetMemoryView() const { return mMemoryView; }
+
+	// Returns true if the memory view is backed by a mapping of a host file,
+	// either directly or through an archive. Such a view pins the file (it
+	// can't be truncated or replaced while mapped) and its contents change if
+	// the file is written in place, so it should only be used to load from and
+	// not held on to.
+	bool IsMemoryViewMapped() const { return mbMemoryViewMapped; }
+
 	void SetTryOpenSibling(ATVFSOpenSiblingFn fn);
 	vdrefptr<ATVFSFileView> TryOpenSibling(const wchar_t *name) const;
 
 protected:
+	void SetMemoryView(vdspan<const uint8> span, bool mapped) {
+		mMemoryView = span;
+		mbHasMemoryView = true;
+		mbMemoryViewMapped = mapped;
+	}
+
 	IVDRandomAccessStream *mpStream;
 	VDStringW mFileName;
 
+	vdspan<const uint8> mMemoryView;
+	bool mbHasMemoryView = false;
+	bool mbMemoryViewMapped = false;
+
 	ATVFSOpenSiblingFn mpOpenSiblingFn;
 };
 
@@ -25,6 +25,7 @@
 #include <at/atio/image.h>
 
 class IVDRandomAccessStream;
+class ATVFSFileView;
 
 class VDINTERFACE IATBlobImage : public IATImage {
 public:
@@ -38,6 +39,11 @@ public:
 
 void ATLoadBlobImage(ATImageType type, const wchar_t *path, IATBlobImage **ppImage);
 void ATLoadBlobImage(ATImageType type, IVDRandomAccessStream& stream, IATBlobImage **ppImage);
+
+// Load a blob image from a VFS view. If the view holds its contents in its own
+// memory buffer, the image references it directly and holds a reference on the
+// view instead of copying the data; mapped host files are always copied.
+void ATLoadBlobImage(ATImageType type, ATVFSFileView& view, IATBlobImage **ppImage);
 void ATCreateBlobImage(ATImageType type, const void *src, uint32 len, IATBlobImage **ppImage);
 
 #endif	// f_AT_ATIO_BLOBIMAGE_H
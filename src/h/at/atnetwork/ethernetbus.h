@@ -4,6 +4,13 @@
 #include <vd2/system/vdstl.h>
 #include <at/atnetwork/ethernet.h>
 
+class IATEthernetBusMonitor {
+public:
+	// Called for every frame as it is delivered to the endpoints on the bus,
+	// with the ID of the endpoint that sent it.
+	virtual void OnFrameDelivered(uint32 sourceId, const ATEthernetPacket& packet) = 0;
+};
+
 class ATEthernetBus final : public IATEthernetSegment, protected IATEthernetClockEventSink {
 	ATEthernetBus(const ATEthernetBus&);
 	ATEthernetBus& operator=(const ATEthernetBus&);
@@ -21,12 +28,22 @@ public:
 	virtual void ClearPendingFrames();
 	virtual void TransmitFrame(uint32 source, const ATEthernetPacket& packet);
 
+	// Deliver a frame immediately to all endpoints other than the source,
+	// bypassing the transmit queue and latency. The packet timestamp is
+	// ignored and replaced with the current time on the packet's clock.
+	void DeliverFrame(uint32 source, const ATEthernetPacket& packet);
+
+	void SetMonitor(IATEthernetBusMonitor *monitor) { mpMonitor = monitor; }
+
 protected:
 	virtual void OnClockEvent(uint32 eventid, uint32 userid);
 
+	void DispatchFrame(uint32 source, const ATEthernetPacket& packet);
+
 protected:
 	uint32 mNextEndpoint;
 	uint32 mNextPacketId;
+	IATEthernetBusMonitor *mpMonitor = nullptr;
 
 	struct Endpoint {
 		IATEthernetEndpoint *mpEndpoint;
@@ -43,6 +60,7 @@ protected:
 		uint32 mSourceId;
 		uint32 mClockEventId;
 		uint32 mNextPacketId;
+		uint32 mLastPacketId;		// last packet in chain (chain head only)
 		ATEthernetPacket mPacket;
 	};
 
@@ -0,0 +1,157 @@
+#ifndef f_AT_ATNETWORK_ETHERNETCAPTURE_H
+#define f_AT_ATNETWORK_ETHERNETCAPTURE_H
+
+#include <vd2/system/binary.h>
+#include <vd2/system/error.h>
+#include <vd2/system/vdalloc.h>
+#include <vd2/system/vdstl.h>
+#include <at/atnetwork/ethernetbus.h>
+
+class VDFileStream;
+class VDBufferedWriteStream;
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Ethernet capture files
+//
+// A capture records every frame delivered on an Ethernet bus, with the
+// emulated time since the start of the capture and whether it was sent by
+// the local (emulated) adapter. Replaying a capture feeds back the frames
+// from everything other than the local adapter at the same emulated times
+// relative to the start of replay, in place of the gateway and the host
+// sockets behind it. This makes network traffic reproducible as long as
+// the capture and replay are started from the same emulation state.
+//
+// Frames sent by the local adapter during replay are checked against the
+// capture to detect when the emulation has diverged from the recording.
+//
+///////////////////////////////////////////////////////////////////////////
+
+struct ATEthernetCaptureFileHeader {
+	uint32 mSignature;
+	uint32 mVersion;
+
+	static constexpr uint32 kSignature = VDMAKEFOURCC('A', 'T', 'E', 'C');
+	static constexpr uint32 kVersion = 1;
+};
+
+struct ATEthernetCaptureRecordHeader {
+	uint32 mTimeDelta;			// clock ticks since the previous record (or start of capture)
+	uint16 mLength;				// payload length, starting at the ethertype
+	uint8 mFlags;
+	uint8 mPad;
+	uint8 mDstAddr[6];
+	uint8 mSrcAddr[6];
+
+	static constexpr uint8 kFlag_Local = 0x01;		// sent by the local adapter
+};
+
+static_assert(sizeof(ATEthernetCaptureRecordHeader) == 20);
+
+class ATEthernetCaptureWriter final : public IATEthernetBusMonitor {
+	ATEthernetCaptureWriter(const ATEthernetCaptureWriter&) = delete;
+	ATEthernetCaptureWriter& operator=(const ATEthernetCaptureWriter&) = delete;
+public:
+	ATEthernetCaptureWriter();
+	~ATEthernetCaptureWriter();
+
+	// Begin capturing all frames on the bus; timestamps are relative to the
+	// time of this call. Frames sent by localEndpointId are tagged as local.
+	void Init(const wchar_t *path, ATEthernetBus& bus, uint32 clockIndex, uint32 localEndpointId);
+
+	// Stop capturing and finish the file. Throws the first write error from
+	// the capture, if any; the capture is stopped either way.
+	void Close();
+
+	// Stop capturing, discarding any write error.
+	void Shutdown();
+
+	uint32 GetFrameCount() const { return mFrameCount; }
+
+	// Returns the write error that stopped the capture, or null if none.
+	const char *GetError() const { return mbErrorState ? mError.c_str() : nullptr; }
+
+public:
+	void OnFrameDelivered(uint32 sourceId, const ATEthernetPacket& packet) override;
+
+private:
+	ATEthernetBus *mpBus = nullptr;
+	IATEthernetClock *mpClock = nullptr;
+	uint32 mLocalEndpointId = 0;
+	uint32 mLastTimestamp = 0;
+	uint32 mFrameCount = 0;
+
+	// Write errors can't be thrown from frame delivery, which happens inside
+	// the emulation, so they are latched until Close().
+	bool mbErrorState = false;
+	MyError mError;
+
+	vdautoptr<VDFileStream> mpFile;
+	vdautoptr<VDBufferedWriteStream> mpStream;
+};
+
+class ATEthernetCapturePlayer final : public IATEthernetEndpoint, public IATEthernetClockEventSink {
+	ATEthernetCapturePlayer(const ATEthernetCapturePlayer&) = delete;
+	ATEthernetCapturePlayer& operator=(const ATEthernetCapturePlayer&) = delete;
+public:
+	struct Status {
+		uint32 mFramesPlayed;
+		uint32 mFramesToPlay;
+		uint32 mLocalFramesMatched;
+		uint32 mLocalFramesDiverged;
+		uint32 mLocalFramesExpected;
+	};
+
+	ATEthernetCapturePlayer();
+	~ATEthernetCapturePlayer();
+
+	// Load a capture file. Throws on I/O errors or a malformed capture.
+	void Load(const wchar_t *path);
+
+	// Load a capture from memory; the data is copied.
+	void Load(const void *data, size_t len);
+
+	// Begin replaying the loaded capture onto the bus, with timestamps
+	// relative to the time of this call. Frames that are already due are
+	// delivered immediately.
+	void Init(ATEthernetBus& bus, uint32 clockIndex);
+	void Shutdown();
+
+	bool IsFinished() const { return mNextRecord >= mRecords.size(); }
+	Status GetStatus() const;
+
+public:
+	void ReceiveFrame(const ATEthernetPacket& packet, ATEthernetFrameDecodedType decType, const void *decInfo) override;
+	void OnClockEvent(uint32 eventid, uint32 userid) override;
+
+private:
+	struct Record {
+		uint32 mTime;
+		uint32 mOffset;
+		uint32 mLength;
+		bool mbLocal;
+	};
+
+	void ParseRecords();
+	void DeliverDueFrames();
+
+	ATEthernetBus *mpBus = nullptr;
+	IATEthernetClock *mpClock = nullptr;
+	uint32 mClockIndex = 0;
+	uint32 mEndpointId = 0;
+	uint32 mClockEventId = 0;
+	uint32 mStartTime = 0;
+
+	uint32 mNextRecord = 0;
+	uint32 mNextLocalRecord = 0;
+	uint32 mFramesPlayed = 0;
+	uint32 mFramesToPlay = 0;
+	uint32 mLocalFramesMatched = 0;
+	uint32 mLocalFramesDiverged = 0;
+	uint32 mLocalFramesExpected = 0;
+
+	vdfastvector<uint8> mData;
+	vdfastvector<Record> mRecords;
+};
+
+#endif
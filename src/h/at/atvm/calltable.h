@@ -0,0 +1,87 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef f_AT_ATVM_CALLTABLE_H
+#define f_AT_ATVM_CALLTABLE_H
+
+#include <vd2/system/vdstl.h>
+#include <at/atvm/vm.h>
+
+///////////////////////////////////////////////////////////////////////////
+// ATVMCallTable
+//
+// Precomputed form of a script function whose only effect is to call a
+// set of allowed void methods, with arguments that depend only on special
+// variables. The function is run ahead of time for each value of one of
+// the special variables, recording the calls and the return value, and
+// Run() then replays the recorded calls for a value through the same
+// method thunks that the VM would have called.
+//
+class ATVMCallTable {
+public:
+	static constexpr uint32 kMaxMethodSlots = 16;
+	static constexpr uint32 kMaxMethodArgs = 3;
+
+	struct Analysis {
+		uint32 mSpecialVarsUsed = 0;	// mask of special variables read
+		uint32 mMethodSlots = 0;		// method table entries used
+		uint8 mSlotArgCounts[kMaxMethodSlots] {};
+	};
+
+	// Check whether a function can be precomputed. It can only read the
+	// special variables in the allowedSpecialVars mask and the globals set
+	// in readableGlobals (normally object variables), can only branch
+	// forward, and can only call methods in allowedMethods.
+	static bool Analyze(Analysis& analysis, const ATVMFunction& func, uint32 allowedSpecialVars, vdspan<const bool> readableGlobals, vdspan<const ATVMExternalVoidMethod> allowedMethods);
+
+	// Precompute a function that has passed Analyze(), for each of the
+	// numIndexValues values of the index special variable, or just once if
+	// the function doesn't read it. Other special variables must be set
+	// beforehand. Fails if any value makes more than maxCallsPerValue calls.
+	bool Build(ATVMThread& thread, const ATVMFunction& func, const Analysis& analysis, uint32 indexVar, uint32 numIndexValues, uint32 maxCallsPerValue);
+
+	// Replay the calls for a value of the index variable and return the
+	// function's return value, or 0 for a void function.
+	sint32 Run(ATVMDomain& domain, uint32 indexValue) const {
+		const uint32 entry = mbIndexed ? indexValue : 0;
+		const Call *VDRESTRICT call = mCalls.data() + mEntryStarts[entry];
+		const Call *callEnd = mCalls.data() + mEntryStarts[entry + 1];
+
+		for(; call != callEnd; ++call)
+			call->mpMethod(domain, call->mArgs);
+
+		return mReturnValues[entry];
+	}
+
+private:
+	struct Call {
+		ATVMExternalVoidMethod mpMethod;
+		sint32 mArgs[kMaxMethodArgs + 1];
+	};
+
+	template<uint32 T_Slot>
+	static void RecordCall(ATVMDomain& domain, const sint32 *args);
+
+	bool mbIndexed = false;
+	vdfastvector<uint32> mEntryStarts;
+	vdfastvector<Call> mCalls;
+	vdfastvector<sint32> mReturnValues;
+
+	const Analysis *mpRecordAnalysis = nullptr;
+	void (*const *mpRecordMethods)() = nullptr;
+};
+
+#endif
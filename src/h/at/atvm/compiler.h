@@ -93,6 +93,10 @@ public:
 
 	bool CompileFile(const char *src, size_t len);
 
+	// Enable or disable the peephole pass that fuses common bytecode sequences
+	// into superinstructions (default on).
+	void SetOptimizationEnabled(bool enabled) { mbOptimize = enabled; }
+
 	const char *GetError() const;
 	std::pair<uint32, uint32> GetErrorLinePos() const;
 
@@ -151,6 +155,7 @@ private:
 	bool ParseOption();
 	bool ParseFunction();
 	bool ParseFunction(ATVMFunction *func, const ATVMTypeInfo& returnType, ATVMFunctionFlags asyncAllowedMask, ATVMConditionalMask conditionalMask);
+	void OptimizeByteCode();
 	bool ParseBlock(bool& hasReturn);
 	bool ParseStatement(uint32 tok, bool& hasReturn);
 	bool ParseIfStatement(bool& hasReturn);
@@ -218,6 +223,7 @@ private:
 	sint32 mErrorPos = -1;
 
 	bool mbCompileDebugCode = false;
+	bool mbOptimize = true;
 
 	ATVMDomain *mpDomain = nullptr;
 	vdfastvector<uint8> mByteCodeBuffer;
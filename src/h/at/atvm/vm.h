@@ -26,6 +26,7 @@
 
 struct ATVMObject;
 struct ATVMFunction;
+class ATVMCallTable;
 class ATVMDomain;
 class ATVMThread;
 
@@ -76,9 +77,36 @@ enum class ATVMOpcode : uint8 {
 	FunctionCallVoid,	// argcount.b, methodindex.b
 	FunctionCallInt,	// argcount.b, methodindex.b
 	ReturnVoid,
-	ReturnInt
+	ReturnInt,
+
+	// Superinstructions -- these are never emitted directly by the parser, only
+	// by the peephole pass when fusing the equivalent sequences.
+	IVCmpConst8Ljz,		// varIdx.b, const.b, cmpMask.b, offset.l
+	ILCmpConst8Ljz,		// localIdx.b, const.b, cmpMask.b, offset.l
+	IntCmpConst8Ljz,	// const.b, cmpMask.b, offset.l
+	IVAddConst8,		// srcVarIdx.b, const.b, dstVarIdx.b
+	ILAddConst8,		// srcLocalIdx.b, const.b, dstLocalIdx.b
+
+	Count
+};
+
+// Comparison masks for the fused compare-and-branch opcodes. The mask holds
+// the outcomes for which the comparison is true; the branch is taken when the
+// comparison is false, as with the Ljz that it replaces.
+enum ATVMCompareMask : uint8 {
+	kATVMCompareMask_Lt = 0x01,
+	kATVMCompareMask_Eq = 0x02,
+	kATVMCompareMask_Gt = 0x04,
+	kATVMCompareMask_Le = kATVMCompareMask_Lt | kATVMCompareMask_Eq,
+	kATVMCompareMask_Ge = kATVMCompareMask_Gt | kATVMCompareMask_Eq,
+	kATVMCompareMask_Ne = kATVMCompareMask_Lt | kATVMCompareMask_Gt,
+	kATVMCompareMask_All = kATVMCompareMask_Lt | kATVMCompareMask_Eq | kATVMCompareMask_Gt
 };
 
+inline uint8 ATVMCompareOutcome(sint32 x, sint32 y) {
+	return x < y ? kATVMCompareMask_Lt : x == y ? kATVMCompareMask_Eq : kATVMCompareMask_Gt;
+}
+
 uint32 ATVMGetOpcodeLength(ATVMOpcode opcode);
 
 struct ATVMObject {};
@@ -259,6 +287,7 @@ public:
 	vdfastvector<ATVMThread *> mThreads;
 
 	ATVMThread *mpActiveThread = nullptr;
+	ATVMCallTable *mpCallTableRecorder = nullptr;
 
 	vdfunction<void(const char *)> mInfiniteLoopHandler;
 
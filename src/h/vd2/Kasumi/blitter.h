@@ -5,6 +5,7 @@
 
 struct VDPixmap;
 struct VDPixmapLayout;
+class VDThreadPool;
 
 class IVDPixmapBlitter {
 public:
@@ -16,6 +17,12 @@ public:
 IVDPixmapBlitter *VDPixmapCreateBlitter(const VDPixmap& dst, const VDPixmap& src);
 IVDPixmapBlitter *VDPixmapCreateBlitter(const VDPixmapLayout& dst, const VDPixmapLayout& src);
 
+// Banded variants: conversions are split into horizontal bands that run in
+// parallel on the thread pool, with identical output. The pool must outlive
+// the blitter.
+IVDPixmapBlitter *VDPixmapCreateBlitter(const VDPixmap& dst, const VDPixmap& src, VDThreadPool& threadPool);
+IVDPixmapBlitter *VDPixmapCreateBlitter(const VDPixmapLayout& dst, const VDPixmapLayout& src, VDThreadPool& threadPool);
+
 class VDPixmapCachedBlitter {
 	VDPixmapCachedBlitter(const VDPixmapCachedBlitter&);
 	VDPixmapCachedBlitter& operator=(const VDPixmapCachedBlitter&);
@@ -4,6 +4,7 @@
 #include <vd2/system/vectors.h>
 
 struct VDPixmap;
+class VDThreadPool;
 
 class IVDPixmapResampler {
 public:
@@ -20,6 +21,12 @@ public:
 	virtual void SetSplineFactor(double A) = 0;
 	virtual void SetSharpnessFactors(float x, float y) = 0;
 	virtual void SetFilters(FilterMode h, FilterMode v, bool interpolationOnly) = 0;
+
+	// Split processing into horizontal bands run in parallel on the given pool;
+	// output is identical. Takes effect on the next Init(). The pool must
+	// outlive the resampler.
+	virtual void SetThreadPool(VDThreadPool *threadPool) = 0;
+
 	virtual bool Init(uint32 dw, uint32 dh, int dstformat, uint32 sw, uint32 sh, int srcformat) = 0;
 	virtual bool Init(const vdrect32f& dstrect, uint32 dw, uint32 dh, int dstformat, const vdrect32f& srcrect, uint32 sw, uint32 sh, int srcformat) = 0;
 	virtual void Shutdown() = 0;
@@ -63,8 +63,9 @@ class IVDVideoDisplayScreenFXEngine {
 public:
 	// Apply screen FX to an image in software; returns resulting image. The source image buffer must
 	// not be modified, and the engine must keep the result image alive as long as the original submitted
-	// frame.
-	virtual VDPixmap ApplyScreenFX(const VDPixmap& px) = 0;
+	// frame. outputSize is the size of the area the image will be displayed in, or 0x0 if not known;
+	// the result may be produced at that size instead of the source size.
+	virtual VDPixmap ApplyScreenFX(const VDPixmap& px, const vdsize32& outputSize) = 0;
 };
 
 enum class VDDHDRAvailability : uint8 {
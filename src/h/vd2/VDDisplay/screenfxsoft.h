@@ -0,0 +1,116 @@
+//	Altirra - Atari 800/800XL/5200 emulator
+//	Copyright (C) 2009-2024 Avery Lee
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License as published by
+//	the Free Software Foundation; either version 2 of the License, or
+//	(at your option) any later version.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License along
+//	with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef f_VD2_VDDISPLAY_SCREENFXSOFT_H
+#define f_VD2_VDDISPLAY_SCREENFXSOFT_H
+
+#include <vd2/system/function.h>
+#include <vd2/system/vdalloc.h>
+#include <vd2/system/vdstl.h>
+#include <vd2/system/vectors.h>
+#include <vd2/Kasumi/pixmaputils.h>
+
+struct VDVideoDisplayScreenFXInfo;
+class VDThreadPool;
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	VDDisplayScreenFXSoft
+//
+//	CPU implementation of the screen effects that otherwise need the 3D
+//	display path: distortion and bloom. Scanlines, PAL blending and color
+//	correction are expected to already have been applied by the frame
+//	source. The bloom filter chain matches the V2 pyramid used by the 3D
+//	path, run on the output image instead of the display buffer.
+//
+//	Each pass is split into row tiles that run on a thread pool.
+//
+///////////////////////////////////////////////////////////////////////////
+
+class VDDisplayScreenFXSoft {
+	VDDisplayScreenFXSoft(const VDDisplayScreenFXSoft&) = delete;
+	VDDisplayScreenFXSoft& operator=(const VDDisplayScreenFXSoft&) = delete;
+public:
+	VDDisplayScreenFXSoft();
+	~VDDisplayScreenFXSoft();
+
+	// Returns true if the screen FX settings include anything that Apply()
+	// would do.
+	static bool IsRequired(const VDVideoDisplayScreenFXInfo& screenFX);
+
+	// Apply distortion and bloom to an XRGB8888 image, producing a dstw x dsth
+	// XRGB8888 image in dst. viewAspect is the display aspect ratio of the
+	// image and is used to shape the distortion. The source may not alias
+	// the destination buffer.
+	VDPixmap Apply(VDPixmapBuffer& dst, const VDPixmap& src, uint32 dstw, uint32 dsth, float viewAspect, const VDVideoDisplayScreenFXInfo& screenFX);
+
+	// Vertical filter kernel: dst[i] = sum(rows[k][i] * weights[k]) for n
+	// floats, n a multiple of 4 and numRows <= 12. Returns the version for
+	// the currently enabled CPU extensions; all versions give identical
+	// results. Exposed for testing.
+	using SumRowsFn = void (*)(float *dst, const float *const *rows, const float *weights, uint32 numRows, uint32 n);
+	static SumRowsFn GetSumRowsFn();
+
+private:
+	static constexpr uint32 kBloomLevels = 7;
+	static constexpr uint32 kLinearToSRGBTableSize = 16384;
+
+	struct DistortionEntry {
+		uint16 mX;
+		uint16 mY;
+		uint8 mFracX;
+		uint8 mFracY;
+		bool mbValid;
+	};
+
+	struct BloomLevel {
+		uint32 mWidth = 0;
+		uint32 mHeight = 0;
+		vdfastvector<vdfloat4> mPixels;
+
+		vdfloat4 *GetRow(uint32 y) { return mPixels.data() + mWidth * y; }
+	};
+
+	void ForEachRowTile(uint32 h, const vdfunction<void(uint32, uint32)>& fn);
+	void UpdateDistortionMap(uint32 srcw, uint32 srch, uint32 dstw, uint32 dsth, float viewAspect, float distortionX, float distortionYRatio);
+	void Resample(const VDPixmap& dst, const VDPixmap& src);
+	void Bloom(const VDPixmap& dst, const VDPixmap& src, float baseRadius, const VDVideoDisplayScreenFXInfo& screenFX);
+	void BloomDown(BloomLevel& dst, BloomLevel& src);
+	void BloomUp(BloomLevel& dst, BloomLevel& src, float srcFactor, float dstFactor, const vdfunction<void(uint32, vdfloat4 *)>& rowFn);
+
+	SumRowsFn mpSumRows = nullptr;
+
+	vdautoptr<VDThreadPool> mpThreadPool;
+
+	VDPixmapBuffer mResampleBuffer;
+
+	vdfastvector<DistortionEntry> mDistortionMap;
+	uint32 mDistortionSrcW = 0;
+	uint32 mDistortionSrcH = 0;
+	uint32 mDistortionDstW = 0;
+	uint32 mDistortionDstH = 0;
+	float mDistortionAspect = 0;
+	float mDistortionX = 0;
+	float mDistortionYRatio = 0;
+
+	BloomLevel mBloomLevels[kBloomLevels];
+	vdfastvector<vdfloat4> mBloomTemp[2];
+
+	float mSRGBToLinear[256];
+	uint8 mLinearToSRGB[kLinearToSRGBTableSize];
+};
+
+#endif
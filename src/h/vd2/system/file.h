@@ -167,6 +167,34 @@ protected:
 
 ///////////////////////////////////////////////////////////////////////////
 
+// Read-only memory mapping of an entire open file. The mapped view is
+// independent of the file handle and remains valid after the file is closed,
+// until Unmap() is called or the mapping is destroyed.
+class VDFileMapping {
+	VDFileMapping(const VDFileMapping&) = delete;
+	VDFileMapping& operator=(const VDFileMapping&) = delete;
+public:
+	VDFileMapping() = default;
+	~VDFileMapping();
+
+	// Attempt to map the file for read access. The path is used to screen
+	// out network and optical drives, where I/O errors would turn into page
+	// faults on access. Returns false without throwing if the file is empty,
+	// larger than maxSize, or cannot be mapped.
+	bool TryMapReadOnly(const VDFile& file, const wchar_t *path, uint64 maxSize);
+	void Unmap();
+
+	bool IsMapped() const { return mpView != nullptr; }
+	const void *GetData() const { return mpView; }
+	size_t GetSize() const { return mSize; }
+
+private:
+	void *mpView = nullptr;
+	size_t mSize = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
 template<class T>
 class VDFileUnbufferAllocator {
 public:
@@ -0,0 +1,88 @@
+//	VirtualDub - Video processing and capture application
+//	System library component
+//	Copyright (C) 1998-2024 Avery Lee, All Rights Reserved.
+//
+//	Beginning with 1.6.0, the VirtualDub system library is licensed
+//	differently than the remainder of VirtualDub.  This particular file is
+//	thus licensed as follows (the "zlib" license):
+//
+//	This software is provided 'as-is', without any express or implied
+//	warranty.  In no event will the authors be held liable for any
+//	damages arising from the use of this software.
+//
+//	Permission is granted to anyone to use this software for any purpose,
+//	including commercial applications, and to alter it and redistribute it
+//	freely, subject to the following restrictions:
+//
+//	1.	The origin of this software must not be misrepresented; you must
+//		not claim that you wrote the original software. If you use this
+//		software in a product, an acknowledgment in the product
+//		documentation would be appreciated but is not required.
+//	2.	Altered source versions must be plainly marked as such, and must
+//		not be misrepresented as being the original software.
+//	3.	This notice may not be removed or altered from any source
+//		distribution.
+
+#ifndef f_VD2_SYSTEM_THREADPOOL_H
+#define f_VD2_SYSTEM_THREADPOOL_H
+
+#include <deque>
+#include <vd2/system/vdtypes.h>
+#include <vd2/system/function.h>
+#include <vd2/system/thread.h>
+#include <vd2/system/vdstl.h>
+
+///////////////////////////////////////////////////////////////////////////
+//
+//	VDThreadPool
+//
+//	Fixed-size pool of worker threads for fanning out independent,
+//	CPU-bound work. Unlike VDScheduler, tasks are plain functions that run
+//	to completion.
+//
+//	ParallelFor() also runs work items on the calling thread and picks up
+//	queued tasks while waiting, so it is safe to call from within a task
+//	and a pool without workers simply runs serially.
+//
+///////////////////////////////////////////////////////////////////////////
+
+class VDThreadPool {
+	VDThreadPool(const VDThreadPool&) = delete;
+	VDThreadPool& operator=(const VDThreadPool&) = delete;
+public:
+	VDThreadPool();
+	~VDThreadPool();
+
+	// Start worker threads. A count of zero selects one fewer than the
+	// number of logical processors, since the thread issuing work usually
+	// participates. The debug name must have static duration.
+	void Start(uint32 threadCount = 0, const char *debugName = "Thread pool worker");
+
+	// Run all remaining queued tasks and stop the worker threads.
+	void Shutdown();
+
+	uint32 GetThreadCount() const { return (uint32)mThreads.size(); }
+
+	// Queue a task for execution on a worker thread. Tasks must not throw.
+	// If the pool has no workers, the task runs immediately.
+	void Post(vdfunction<void()> fn);
+
+	// Run fn(i) for every i in [0, n) and return once all calls have
+	// completed. The first exception thrown by an item stops issue of
+	// further items and is rethrown on the calling thread.
+	void ParallelFor(uint32 n, const vdfunction<void(uint32)>& fn);
+
+private:
+	class WorkerThread;
+
+	bool TryRunTask();
+	void RunWorker();
+
+	VDCriticalSection mMutex;
+	VDSemaphore mTaskSema;
+	std::deque<vdfunction<void()>> mTasks;
+	vdfastvector<WorkerThread *> mThreads;
+	volatile bool mbExit = false;
+};
+
+#endif
@@ -426,6 +426,16 @@ namespace nsVDVecMath {
 		};
 	}
 
+	[[nodiscard]]
+	inline vdfloat32x4 max0(vdfloat32x4 x) {
+		return vdfloat32x4 {
+			x.v[0] > 0.0f ? x.v[0] : 0.0f,
+			x.v[1] > 0.0f ? x.v[1] : 0.0f,
+			x.v[2] > 0.0f ? x.v[2] : 0.0f,
+			x.v[3] > 0.0f ? x.v[3] : 0.0f,
+		};
+	}
+
 	[[nodiscard]]
 	inline vdfloat32x3 max(vdfloat32x3 x, vdfloat32x3 y) {
 		return vdfloat32x3 {
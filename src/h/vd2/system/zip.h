@@ -333,6 +333,11 @@ public:
 	sint32			FindFile(const wchar_t *decodedName, bool caseSensitive) const;
 
 	IVDStream		*OpenRawStream(sint32 idx);
+
+	// Return the offset of the raw (possibly compressed) data for a file
+	// within the archive stream. This requires reading the local header, as
+	// its variable-length fields can differ from the central directory.
+	uint64			GetRawDataOffset(sint32 idx);
 	IVDInflateStream *OpenDecodedStream(sint32 idx, bool allowLarge = false);
 
 	// Read the raw contents of the file into the given buffer. Returns true if
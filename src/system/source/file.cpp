@@ -498,3 +498,52 @@ void *VDFile::AllocUnbuffer(size_t nBytes) {
 void VDFile::FreeUnbuffer(void *p) {
 	VirtualFree(p, 0, MEM_RELEASE);
 }
+
+///////////////////////////////////////////////////////////////////////////////
+//
+//	VDFileMapping
+//
+///////////////////////////////////////////////////////////////////////////////
+
+VDFileMapping::~VDFileMapping() {
+	Unmap();
+}
+
+bool VDFileMapping::TryMapReadOnly(const VDFile& file, const wchar_t *path, uint64 maxSize) {
+	Unmap();
+
+	HANDLE h = file.getRawHandle();
+	if (!h || GetFileType(h) != FILE_TYPE_DISK)
+		return false;
+
+	if (!path || !IsHardDrivePath(path))
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(h, &size) || size.QuadPart <= 0 || (uint64)size.QuadPart > maxSize || (uint64)size.QuadPart > (uint64)SIZE_MAX)
+		return false;
+
+	HANDLE hMapping = CreateFileMappingW(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!hMapping)
+		return false;
+
+	// The view holds a reference on the section, so we don't need to keep
+	// the mapping handle around.
+	void *p = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(hMapping);
+
+	if (!p)
+		return false;
+
+	mpView = p;
+	mSize = (size_t)size.QuadPart;
+	return true;
+}
+
+void VDFileMapping::Unmap() {
+	if (mpView) {
+		UnmapViewOfFile(mpView);
+		mpView = nullptr;
+		mSize = 0;
+	}
+}
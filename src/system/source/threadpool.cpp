@@ -0,0 +1,215 @@
+//	VirtualDub - Video processing and capture application
+//	System library component
+//	Copyright (C) 1998-2024 Avery Lee, All Rights Reserved.
+//
+//	Beginning with 1.6.0, the VirtualDub system library is licensed
+//	differently than the remainder of VirtualDub.  This particular file is
+//	thus licensed as follows (the "zlib" license):
+//
+//	This software is provided 'as-is', without any express or implied
+//	warranty.  In no event will the authors be held liable for any
+//	damages arising from the use of this software.
+//
+//	Permission is granted to anyone to use this software for any purpose,
+//	including commercial applications, and to alter it and redistribute it
+//	freely, subject to the following restrictions:
+//
+//	1.	The origin of this software must not be misrepresented; you must
+//		not claim that you wrote the original software. If you use this
+//		software in a product, an acknowledgment in the product
+//		documentation would be appreciated but is not required.
+//	2.	Altered source versions must be plainly marked as such, and must
+//		not be misrepresented as being the original software.
+//	3.	This notice may not be removed or altered from any source
+//		distribution.
+
+#include <stdafx.h>
+#include <algorithm>
+#include <exception>
+#include <vd2/system/atomic.h>
+#include <vd2/system/threadpool.h>
+
+class VDThreadPool::WorkerThread final : public VDThread {
+public:
+	WorkerThread(VDThreadPool& parent, const char *debugName)
+		: VDThread(debugName)
+		, mParent(parent)
+	{
+	}
+
+	void ThreadRun() override {
+		mParent.RunWorker();
+	}
+
+private:
+	VDThreadPool& mParent;
+};
+
+VDThreadPool::VDThreadPool()
+	: mTaskSema(0)
+{
+}
+
+VDThreadPool::~VDThreadPool() {
+	Shutdown();
+}
+
+void VDThreadPool::Start(uint32 threadCount, const char *debugName) {
+	VDASSERT(mThreads.empty());
+
+	if (!threadCount) {
+		threadCount = VDGetLogicalProcessorCount();
+
+		if (threadCount)
+			--threadCount;
+	}
+
+	mbExit = false;
+	mThreads.reserve(threadCount);
+
+	for(uint32 i=0; i<threadCount; ++i) {
+		WorkerThread *thread = new WorkerThread(*this, debugName);
+
+		if (!thread->ThreadStart()) {
+			delete thread;
+			break;
+		}
+
+		mThreads.push_back(thread);
+	}
+}
+
+void VDThreadPool::Shutdown() {
+	if (mThreads.empty())
+		return;
+
+	mbExit = true;
+
+	for(size_t i=0; i<mThreads.size(); ++i)
+		mTaskSema.Post();
+
+	for(WorkerThread *thread : mThreads) {
+		thread->ThreadWait();
+		delete thread;
+	}
+
+	mThreads.clear();
+
+	// run anything that was queued after the workers stopped picking up tasks
+	while(TryRunTask())
+		;
+}
+
+void VDThreadPool::Post(vdfunction<void()> fn) {
+	if (mThreads.empty()) {
+		fn();
+		return;
+	}
+
+	vdsynchronized(mMutex) {
+		mTasks.push_back(std::move(fn));
+	}
+
+	mTaskSema.Post();
+}
+
+void VDThreadPool::ParallelFor(uint32 n, const vdfunction<void(uint32)>& fn) {
+	if (!n)
+		return;
+
+	struct State {
+		const vdfunction<void(uint32)> *mpFn;
+		uint32 mCount;
+		VDAtomicInt mNextIndex { 0 };
+		VDAtomicInt mPendingHelpers { 0 };
+		VDSignal mHelpersDone;
+		VDCriticalSection mErrorLock;
+		std::exception_ptr mException;
+
+		void Run() {
+			for(;;) {
+				const uint32 idx = (uint32)mNextIndex.postinc();
+				if (idx >= mCount)
+					break;
+
+				try {
+					(*mpFn)(idx);
+				} catch(...) {
+					vdsynchronized(mErrorLock) {
+						if (!mException)
+							mException = std::current_exception();
+					}
+
+					mNextIndex = (int)mCount;
+				}
+			}
+		}
+	} state;
+
+	state.mpFn = &fn;
+	state.mCount = n;
+
+	const uint32 numHelpers = std::min<uint32>(GetThreadCount(), n - 1);
+	state.mPendingHelpers = (int)numHelpers;
+
+	for(uint32 i=0; i<numHelpers; ++i) {
+		Post(
+			[&state] {
+				state.Run();
+
+				// must be the last access to the state, as the issuing thread
+				// may return as soon as the count hits zero
+				if (!state.mPendingHelpers.dec())
+					state.mHelpersDone.signal();
+			}
+		);
+	}
+
+	state.Run();
+
+	// Help drain the queue while waiting; this also runs any of our own
+	// helpers that haven't been picked up yet, which avoids deadlocking when
+	// all workers are themselves blocked in ParallelFor(). Once the queue is
+	// empty, all of our helpers are running and we can block. The signal
+	// must always be consumed, even if the count has already reached zero,
+	// as the last helper may still be about to touch it.
+	if (numHelpers) {
+		while(state.mPendingHelpers != 0 && TryRunTask())
+			;
+
+		state.mHelpersDone.wait();
+	}
+
+	if (state.mException)
+		std::rethrow_exception(state.mException);
+}
+
+bool VDThreadPool::TryRunTask() {
+	vdfunction<void()> fn;
+
+	vdsynchronized(mMutex) {
+		if (mTasks.empty())
+			return false;
+
+		fn = std::move(mTasks.front());
+		mTasks.pop_front();
+	}
+
+	fn();
+	return true;
+}
+
+void VDThreadPool::RunWorker() {
+	for(;;) {
+		mTaskSema.Wait();
+
+		if (mbExit) {
+			while(TryRunTask())
+				;
+
+			break;
+		}
+
+		TryRunTask();
+	}
+}
@@ -253,7 +253,26 @@ void VDCRCTable::Init(uint32 crc) {
 	InitConst(crc);
 }
 
+#if defined(VD_CPU_X86) || defined(VD_CPU_X64)
+uint32 VDCRC32Update_CLMUL(uint32 crc, const void *src, size_t len);
+#elif defined(VD_CPU_ARM64)
+uint32 VDCRC32Update_ARM64_CRC32(uint32 crc, const void *src, size_t len);
+#endif
+
 uint32 VDCRCTable::Process(uint32 crc, const void *src0, size_t count) const {
+	// Route the standard CRC-32 through the same folded/instruction-based
+	// paths that VDCRCChecker uses, as this is also used for whole-image
+	// checksums.
+	if (this == &CRC32 && count) {
+#if defined(VD_CPU_X86) || defined(VD_CPU_X64)
+		if (CPUGetEnabledExtensions() & CPUF_SUPPORTS_CLMUL)
+			return VDCRC32Update_CLMUL(crc, src0, count);
+#elif defined(VD_CPU_ARM64)
+		if (CPUGetEnabledExtensions() & VDCPUF_SUPPORTS_CRC32)
+			return VDCRC32Update_ARM64_CRC32(crc, src0, count);
+#endif
+	}
+
 	const uint8 *src = (const uint8 *)src0;
 
 	// This code is from the PNG spec.
@@ -2678,6 +2697,12 @@ sint32 VDZipArchive::FindFile(const wchar_t *decodedName, bool caseSensitive) co
 }
 
 IVDStream *VDZipArchive::OpenRawStream(sint32 idx) {
+	mpStream->Seek(GetRawDataOffset(idx));
+
+	return mpStream;
+}
+
+uint64 VDZipArchive::GetRawDataOffset(sint32 idx) {
 	const FileInfoInternal& fi = mDirectory[idx];
 
 	mpStream->Seek(fi.mDataStart);
@@ -2688,9 +2713,7 @@ IVDStream *VDZipArchive::OpenRawStream(sint32 idx) {
 	if (hdr.signature != ZipFileHeader::kSignature)
 		throw MyError("Bad header for file in zip archive");
 
-	mpStream->Seek(fi.mDataStart + sizeof(hdr) + hdr.filename_len + hdr.extrafield_len);
-
-	return mpStream;
+	return (uint64)fi.mDataStart + sizeof(hdr) + hdr.filename_len + hdr.extrafield_len;
 }
 
 IVDInflateStream *VDZipArchive::OpenDecodedStream(sint32 idx, bool allowLarge) {